@@ -11,6 +11,7 @@
 #include "DXUT.h"
 #include "SDKMesh.h"
 #include "SDKMisc.h"
+#include "../../tpot/SDKMeshParser.h"
 
 //--------------------------------------------------------------------------------------
 void CDXUTSDKMesh::LoadMaterials( ID3D11Device* pd3dDevice, SDKMESH_MATERIAL* pMaterials, UINT numMaterials,
@@ -326,7 +327,7 @@ HRESULT CDXUTSDKMesh::CreateFromFile( ID3D11Device* pDev11,
     V_RETURN( DXUTFindDXSDKMediaFileCch( m_strPathW, sizeof( m_strPathW ) / sizeof( WCHAR ), szFileName ) );
 
     // Open the file
-    m_hFile = CreateFile( m_strPathW, FILE_READ_DATA, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN,
+    m_hFile = CreateFile( m_strPathW, FILE_READ_DATA, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
                           NULL );
     if( INVALID_HANDLE_VALUE == m_hFile )
         return DXUTERR_MEDIANOTFOUND;
@@ -344,39 +345,57 @@ HRESULT CDXUTSDKMesh::CreateFromFile( ID3D11Device* pDev11,
     LARGE_INTEGER FileSize;
     GetFileSizeEx( m_hFile, &FileSize );
     UINT cBytes = FileSize.LowPart;
-
-    // Allocate memory
-    m_pStaticMeshData = new BYTE[ cBytes ];
-    if( !m_pStaticMeshData )
+    if( FileSize.HighPart != 0 || cBytes < sizeof( SDKMESH_HEADER ) )
     {
         CloseHandle( m_hFile );
-        return E_OUTOFMEMORY;
+        m_hFile = 0;
+        return E_FAIL;
     }
 
-    // Read in the file
-    DWORD dwBytesRead;
-    if( !ReadFile( m_hFile, m_pStaticMeshData, cBytes, &dwBytesRead, NULL ) )
-        hr = E_FAIL;
-
+    // Map the file read only instead of reading it into the heap. Only the
+    // static part is copied by CreateFromMemory for the pointer fixup; vertex
+    // and index data are uploaded straight from the view, which stays mapped
+    // for GetRawVerticesAt / GetRawIndicesAt until Destroy
+    m_hFileMappingObject = CreateFileMapping( m_hFile, NULL, PAGE_READONLY, 0, 0, NULL );
     CloseHandle( m_hFile );
+    m_hFile = 0;
+    if( !m_hFileMappingObject )
+        return E_FAIL;
 
-    if( SUCCEEDED( hr ) )
-    {
-        hr = CreateFromMemory( pDev11,
-                               pDev9,
-                               m_pStaticMeshData,
-                               cBytes,
-                               bCreateAdjacencyIndices,
-                               false,
-                               pLoaderCallbacks11,
-                               pLoaderCallbacks9 );
-        if( FAILED( hr ) )
-            delete []m_pStaticMeshData;
+    BYTE* pView = ( BYTE* )MapViewOfFile( m_hFileMappingObject, FILE_MAP_READ, 0, 0, 0 );
+    if( !pView )
+    {
+        UnmapFile();
+        return E_OUTOFMEMORY;
     }
+    m_MappedPointers.Add( pView );
+
+    hr = CreateFromMemory( pDev11,
+                           pDev9,
+                           pView,
+                           cBytes,
+                           bCreateAdjacencyIndices,
+                           true,
+                           pLoaderCallbacks11,
+                           pLoaderCallbacks9 );
+    if( FAILED( hr ) )
+        UnmapFile();
 
     return hr;
 }
 
+//--------------------------------------------------------------------------------------
+void CDXUTSDKMesh::UnmapFile()
+{
+    for( int i = 0; i < m_MappedPointers.GetSize(); i++ )
+        UnmapViewOfFile( m_MappedPointers[i] );
+    m_MappedPointers.RemoveAll();
+
+    if( m_hFileMappingObject )
+        CloseHandle( m_hFileMappingObject );
+    m_hFileMappingObject = 0;
+}
+
 HRESULT CDXUTSDKMesh::CreateFromMemory( ID3D11Device* pDev11,
                                         IDirect3DDevice9* pDev9,
                                         BYTE* pData,
@@ -387,20 +406,29 @@ HRESULT CDXUTSDKMesh::CreateFromMemory( ID3D11Device* pDev11,
                                         SDKMESH_CALLBACKS9* pLoaderCallbacks9 )
 {
     HRESULT hr = E_FAIL;
-    D3DXVECTOR3 lower; 
-    D3DXVECTOR3 upper; 
-    
+
     m_pDev9 = pDev9;
 	m_pDev11 = pDev11;
 
     // Set outstanding resources to zero
     m_NumOutstandingResources = 0;
 
-    if( bCopyStatic )
+    // Every offset and size is checked before any of them is followed; the
+    // buffer, subset and bounds views stay valid through the fixup below
+    tpot::SDKMeshParser parser;
+    switch( parser.parse( pData, DataBytes ) )
     {
-        SDKMESH_HEADER* pHeader = ( SDKMESH_HEADER* )pData;
+        case tpot::SDKMESH_ERROR::NONE:
+            break;
+        case tpot::SDKMESH_ERROR::VERSION:
+            return E_NOINTERFACE;
+        default:
+            return E_FAIL;
+    }
 
-        SIZE_T StaticSize = ( SIZE_T )( pHeader->HeaderSize + pHeader->NonBufferDataSize );
+    if( bCopyStatic )
+    {
+        SIZE_T StaticSize = parser.staticSize();
         m_pHeapData = new BYTE[ StaticSize ];
         if( !m_pHeapData )
             return hr;
@@ -433,25 +461,11 @@ HRESULT CDXUTSDKMesh::CreateFromMemory( ID3D11Device* pDev11,
         m_pMeshArray[i].pFrameInfluences = ( UINT* )( m_pStaticMeshData + m_pMeshArray[i].FrameInfluenceOffset );
     }
 
-    // error condition
-    if( m_pMeshHeader->Version != SDKMESH_FILE_VERSION )
-    {
-        hr = E_NOINTERFACE;
-        goto Error;
-    }
-
-    // Setup buffer data pointer
-    BYTE* pBufferData = pData + m_pMeshHeader->HeaderSize + m_pMeshHeader->NonBufferDataSize;
-
-    // Get the start of the buffer data
-    UINT64 BufferDataStart = m_pMeshHeader->HeaderSize + m_pMeshHeader->NonBufferDataSize;
-
     // Create VBs
     m_ppVertices = new BYTE*[m_pMeshHeader->NumVertexBuffers];
     for( UINT i = 0; i < m_pMeshHeader->NumVertexBuffers; i++ )
     {
-        BYTE* pVertices = NULL;
-        pVertices = ( BYTE* )( pBufferData + ( m_pVertexBufferArray[i].DataOffset - BufferDataStart ) );
+        BYTE* pVertices = ( BYTE* )parser.vertexData( i ).data();
 
         if( pDev11 )
             CreateVertexBuffer( pDev11, &m_pVertexBufferArray[i], pVertices, pLoaderCallbacks11 );
@@ -465,8 +479,7 @@ HRESULT CDXUTSDKMesh::CreateFromMemory( ID3D11Device* pDev11,
     m_ppIndices = new BYTE*[m_pMeshHeader->NumIndexBuffers];
     for( UINT i = 0; i < m_pMeshHeader->NumIndexBuffers; i++ )
     {
-        BYTE* pIndices = NULL;
-        pIndices = ( BYTE* )( pBufferData + ( m_pIndexBufferArray[i].DataOffset - BufferDataStart ) );
+        BYTE* pIndices = ( BYTE* )parser.indexData( i ).data();
 
         if( pDev11 )
             CreateIndexBuffer( pDev11, &m_pIndexBufferArray[i], pIndices, pLoaderCallbacks11 );
@@ -495,96 +508,13 @@ HRESULT CDXUTSDKMesh::CreateFromMemory( ID3D11Device* pDev11,
     if( !m_pWorldPoseFrameMatrices )
         goto Error;
 
-    SDKMESH_SUBSET* pSubset = NULL;
-    D3D11_PRIMITIVE_TOPOLOGY PrimType;
-
-    // update bounding volume 
-    SDKMESH_MESH* currentMesh = &m_pMeshArray[0];
-    int tris = 0;
-    for (UINT meshi=0; meshi < m_pMeshHeader->NumMeshes; ++meshi) {
-        lower.x = FLT_MAX; lower.y = FLT_MAX; lower.z = FLT_MAX;
-        upper.x = -FLT_MAX; upper.y = -FLT_MAX; upper.z = -FLT_MAX;
-        currentMesh = GetMesh( meshi );
-        INT indsize;
-        if (m_pIndexBufferArray[currentMesh->IndexBuffer].IndexType == IT_16BIT ) {
-            indsize = 2;
-        }else {
-            indsize = 4;        
-        }
-
-        for( UINT subset = 0; subset < currentMesh->NumSubsets; subset++ )
-        {
-            pSubset = GetSubset( meshi, subset ); //&m_pSubsetArray[ currentMesh->pSubsets[subset] ];
-
-            PrimType = GetPrimitiveType11( ( SDKMESH_PRIMITIVE_TYPE )pSubset->PrimitiveType );
-            assert( PrimType == D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST );// only triangle lists are handled.
-
-            UINT IndexCount = ( UINT )pSubset->IndexCount;
-            UINT IndexStart = ( UINT )pSubset->IndexStart;
-
-            /*if( bAdjacent )
-            {
-                IndexCount *= 2;
-                IndexStart *= 2;
-            }*/
-     
-        //BYTE* pIndices = NULL;
-            //m_ppIndices[i]
-            UINT *ind = ( UINT * )m_ppIndices[currentMesh->IndexBuffer];
-            FLOAT *verts =  ( FLOAT* )m_ppVertices[currentMesh->VertexBuffers[0]];
-            UINT stride = (UINT)m_pVertexBufferArray[currentMesh->VertexBuffers[0]].StrideBytes;
-            assert (stride % 4 == 0);
-            stride /=4;
-            for (UINT vertind = IndexStart; vertind < IndexStart + IndexCount; ++vertind) {
-                UINT current_ind=0;
-                if (indsize == 2) {
-                    UINT ind_div2 = vertind / 2;
-                    current_ind = ind[ind_div2];
-                    if (vertind %2 ==0) {
-                        current_ind = current_ind << 16;
-                        current_ind = current_ind >> 16;
-                    }else {
-                        current_ind = current_ind >> 16;
-                    }
-                }else {
-                    current_ind = ind[vertind];
-                }
-                tris++;
-                D3DXVECTOR3 *pt = (D3DXVECTOR3*)&(verts[stride * current_ind]);
-                if (pt->x < lower.x) {
-                    lower.x = pt->x;
-                }
-                if (pt->y < lower.y) {
-                    lower.y = pt->y;
-                }
-                if (pt->z < lower.z) {
-                    lower.z = pt->z;
-                }
-                if (pt->x > upper.x) {
-                    upper.x = pt->x;
-                }
-                if (pt->y > upper.y) {
-                    upper.y = pt->y;
-                }
-                if (pt->z > upper.z) {
-                    upper.z = pt->z;
-                }
-                //BYTE** m_ppVertices;
-                //BYTE** m_ppIndices;
-            }
-            //pd3dDeviceContext->DrawIndexed( IndexCount, IndexStart, VertexStart );
-        }
-
-        D3DXVECTOR3 half = upper - lower;
-        half *=0.5f;
-
-        currentMesh->BoundingBoxCenter = lower + half;
-        currentMesh->BoundingBoxExtents = half;
-
+    // Bounding volumes, from the positions each subset draws
+    for( UINT i = 0; i < m_pMeshHeader->NumMeshes; i++ )
+    {
+        const tpot::SDKMeshParser::BOUNDS& bounds = parser.meshBounds( i );
+        m_pMeshArray[i].BoundingBoxCenter = D3DXVECTOR3( bounds.center );
+        m_pMeshArray[i].BoundingBoxExtents = D3DXVECTOR3( bounds.extents );
     }
-    // Update 
-        
-
 
     hr = S_OK;
 Error:
@@ -1171,6 +1101,9 @@ void CDXUTSDKMesh::Destroy()
     SAFE_DELETE_ARRAY( m_ppVertices );
     SAFE_DELETE_ARRAY( m_ppIndices );
 
+    // m_ppVertices / m_ppIndices pointed into the view
+    UnmapFile();
+
     m_pMeshHeader = NULL;
     m_pVertexBufferArray = NULL;
     m_pIndexBufferArray = NULL;
@@ -303,6 +303,7 @@ private:
     HANDLE m_hFile;
     HANDLE m_hFileMappingObject;
     CGrowableArray <BYTE*> m_MappedPointers;
+    void                            UnmapFile();
     IDirect3DDevice9* m_pDev9;
     ID3D11Device* m_pDev11;
     ID3D11DeviceContext* m_pDevContext11;
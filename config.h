@@ -17,6 +17,19 @@
 #define IDC_MODE_OFF     11
 #define IDC_MODE_TAA   12
 #define IDC_MODE_CAMMOVE   13
+#define IDC_RENDER_SCALE        14
+#define IDC_RENDER_SCALE_STATIC 15
+#define IDC_JITTER              16
+#define IDC_RT_FORMAT           17
+#define IDC_TAA_HISTORY         18
+#define IDC_TILE_SKIP           19
+#define IDC_FUSED_PRESENT       20
+#define IDC_TONEMAP             21
+#define IDC_DITHER              22
+#define IDC_TAA_CLAMP           23
+#define IDC_DEPTH_REJECT        24
+#define IDC_DYNAMIC_RESOLUTION  25
+#define IDC_MODE_CHECKERBOARD   26
 
 
 #endif // CONFIG_H__
\ No newline at end of file
@@ -1,6 +1,8 @@
 cbuffer cbConstants : register( b0 )
 {
     float4x4 g_f4x4WorldViewProjection;        // World * View * Projection matrix
+	float4   g_fUvScale;                       // used part of the pooled texture
+	float4   g_fPresent;                       // tone map, exposure, dither, frame
 }
 
 // Textures
@@ -31,16 +33,66 @@ PS_RenderSceneInput VS( VS_RenderSceneInput In )
     PS_RenderSceneInput O;
     
 	O.Position = mul(float4(In.Position, 1.0f), g_f4x4WorldViewProjection);
-    O.TexCoord = In.TexCoord;
+    O.TexCoord = In.TexCoord * g_fUvScale.xy;
 
     return O;    
 }
 
+// Same as taa.hlsl and PresentPixel in tpot/TaaPresent.cpp
+uint PresentHash(uint2 pos, uint frame)
+{
+	uint h = pos.x * 1973 + pos.y * 9277 + frame * 26699;
+	h = (h ^ 61) ^ (h >> 16);
+	h *= 9;
+	h ^= h >> 4;
+	h *= 0x27d4eb2d;
+	h ^= h >> 15;
+	return h;
+}
+
+float3 LinearToSRGB(float3 c)
+{
+	return (c <= 0.0031308) ? 12.92 * c : 1.055 * pow(c, 1.0 / 2.4) - 0.055;
+}
+
+float3 SRGBToLinear(float3 c)
+{
+	return (c <= 0.04045) ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4);
+}
+
+// Colour for the sRGB back buffer: exposure, tone map, then the dither in
+// steps of its 8 bits. The view encodes to sRGB again.
+float4 Present(float4 color, float2 position)
+{
+	float3 c = color.rgb * g_fPresent.y;
+	if (g_fPresent.x == 1.0f) c = c / (1.0f + c);
+	c = saturate(c);
+	if (g_fPresent.z != 0.0f){
+		float d = (float)(PresentHash(uint2(position), (uint)g_fPresent.w) & 0xffff) / 65536.0f - 0.5f;
+		c = SRGBToLinear(saturate(LinearToSRGB(c) + d / 255.0f));
+	}
+	return float4(c, color.a);
+}
+
 PS_RenderOutput PS( PS_RenderSceneInput In )
 {
     PS_RenderOutput O;
 
-	O.Color = g_txScene.Sample(g_SampleLinear, In.TexCoord);
+	O.Color = Present(g_txScene.Sample(g_SampleLinear, In.TexCoord), In.Position.xy);
 
     return O;
 }
+
+// Present of a YCoCg history (taa.hlsl EncodeYCoCg)
+PS_RenderOutput PS_YCoCg( PS_RenderSceneInput In )
+{
+	PS_RenderOutput O;
+
+	float4 texel = g_txScene.Sample(g_SampleLinear, In.TexCoord);
+	float co = texel.y - 0.5;
+	float cg = texel.z - 0.5;
+	float t = texel.x - cg;
+	O.Color = Present(float4(t + co, texel.x + cg, t - co, texel.w), In.Position.xy);
+
+	return O;
+}
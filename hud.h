@@ -10,19 +10,35 @@ enum E_MODE
 	OFF,
 	TAA,
 	CAMMOVE,
+	CHECKERBOARD,
 };
 
 extern E_MODE                    g_iMode;
 extern UINT g_iBlendWeight;
 extern UINT g_iBlurSize;
+extern UINT g_iRenderScale;
+extern bool g_bDynamicResolution;
+extern tpot::DynamicResolution g_DynamicResolution;
+extern tpot::JITTER::TYPE g_iJitter;
+extern tpot::RENDER_TARGET::FORMAT g_iRtFormat;
+extern tpot::TAA_HISTORY::ID g_iTaaHistory;
+extern tpot::TAA_CLAMP::ID g_iTaaClamp;
+extern bool g_bDepthReject;
+extern bool g_bTileSkip;
+extern bool g_bFusedPresent;
+extern tpot::TONEMAP::ID g_iTonemap;
+extern bool g_bDither;
 class MyHud
 {
 	CDXUTDialog                         g_HUD;                   // manages the 3D   
 	CDXUTDialog                         g_SampleUI;              // dialog for sample specific controls
+	CDXUTDialog                         g_OptionUI;              // render target and resolve options
 	CDXUTTextHelper*                    g_pTxtHelper;
+	enum{ STATS_LINES = 3 };
+	WCHAR                               stats_[STATS_LINES][128]; // renderer statistics lines
 
 public:
-	MyHud():g_pTxtHelper(nullptr){}
+	MyHud():g_pTxtHelper(nullptr){for (auto &x : stats_) x[0] = 0;}
 	~MyHud(){}
 
 	void create(ID3D11Device* pd3dDevice, ID3D11DeviceContext *pd3dImmediateContext, CDXUTDialogResourceManager *pDialogResourceManager)
@@ -33,6 +49,7 @@ public:
 
 		g_HUD.Init(pDialogResourceManager);
 		g_SampleUI.Init(pDialogResourceManager);
+		g_OptionUI.Init(pDialogResourceManager);
 
 		g_HUD.SetCallback( OnGUIEvent ); int iY = 20;
 		g_HUD.AddButton( IDC_TOGGLEFULLSCREEN, L"Toggle full screen", 0, iY, 170, 22 );
@@ -56,7 +73,53 @@ public:
 		g_SampleUI.AddRadioButton(IDC_MODE_OFF, IDC_MODE, L"OFF", 20, iY += 26, 170, 22);
 		g_SampleUI.AddRadioButton(IDC_MODE_TAA, IDC_MODE, L"TAA", 20, iY += 26, 170, 22);
 		g_SampleUI.AddRadioButton(IDC_MODE_CAMMOVE, IDC_MODE, L"Move Camera", 20, iY += 26, 170, 22);
+		g_SampleUI.AddRadioButton(IDC_MODE_CHECKERBOARD, IDC_MODE, L"Checkerboard", 20, iY += 26, 170, 22);
 		g_SampleUI.GetRadioButton(IDC_MODE_TAA)->SetChecked(true);
+
+		// render targets and resolve, a column left of g_SampleUI
+		g_OptionUI.SetCallback( OnGUIEvent ); iY = 10;
+		swprintf_s(sz, L"Render Scale: %3d%%", g_iRenderScale);
+		g_OptionUI.AddStatic(IDC_RENDER_SCALE_STATIC, sz, 10, iY, 150, 22);
+		g_OptionUI.AddSlider(IDC_RENDER_SCALE, 10, iY += 24, 150, 22, 50, 100, (int)(g_iRenderScale));
+		g_OptionUI.GetSlider(IDC_RENDER_SCALE)->SetEnabled(!g_bDynamicResolution);
+		g_OptionUI.AddCheckBox(IDC_DYNAMIC_RESOLUTION, L"Dynamic resolution", 10, iY += 26, 150, 22, g_bDynamicResolution);
+
+		CDXUTComboBox *pCombo;
+		g_OptionUI.AddComboBox(IDC_JITTER, 10, iY += 30, 150, 22, 0, false, &pCombo);
+		pCombo->AddItem(L"Jitter: Halton", (void*)(size_t)tpot::JITTER::HALTON);
+		pCombo->AddItem(L"Jitter: 4x4 Grid", (void*)(size_t)tpot::JITTER::GRID);
+		pCombo->AddItem(L"Jitter: R2", (void*)(size_t)tpot::JITTER::R2);
+		pCombo->AddItem(L"Jitter: Sobol", (void*)(size_t)tpot::JITTER::SOBOL);
+		pCombo->AddItem(L"Jitter: Blue Noise", (void*)(size_t)tpot::JITTER::BLUE_NOISE);
+		pCombo->SetSelectedByData((void*)(size_t)g_iJitter);
+
+		g_OptionUI.AddComboBox(IDC_RT_FORMAT, 10, iY += 30, 150, 22, 0, false, &pCombo);
+		pCombo->AddItem(L"Targets: RGBA32F", (void*)(size_t)tpot::RENDER_TARGET::RGBA32F);
+		pCombo->AddItem(L"Targets: RGBA16F", (void*)(size_t)tpot::RENDER_TARGET::RGBA16F);
+		pCombo->AddItem(L"Targets: R11G11B10F", (void*)(size_t)tpot::RENDER_TARGET::R11G11B10F);
+		pCombo->AddItem(L"Targets: RGBA8 sRGB", (void*)(size_t)tpot::RENDER_TARGET::RGBA8_SRGB);
+		pCombo->SetSelectedByData((void*)(size_t)g_iRtFormat);
+
+		g_OptionUI.AddComboBox(IDC_TAA_HISTORY, 10, iY += 30, 150, 22, 0, false, &pCombo);
+		pCombo->AddItem(L"History: RGB", (void*)(size_t)tpot::TAA_HISTORY::RGB);
+		pCombo->AddItem(L"History: YCoCg 64bit", (void*)(size_t)tpot::TAA_HISTORY::YCOCG64);
+		pCombo->AddItem(L"History: YCoCg 32bit", (void*)(size_t)tpot::TAA_HISTORY::YCOCG32);
+		pCombo->SetSelectedByData((void*)(size_t)g_iTaaHistory);
+
+		g_OptionUI.AddComboBox(IDC_TAA_CLAMP, 10, iY += 30, 150, 22, 0, false, &pCombo);
+		pCombo->AddItem(L"Clamp: Chroma", (void*)(size_t)tpot::TAA_CLAMP::CHROMA);
+		pCombo->AddItem(L"Clamp: Variance (CS)", (void*)(size_t)tpot::TAA_CLAMP::VARIANCE);
+		pCombo->SetSelectedByData((void*)(size_t)g_iTaaClamp);
+
+		g_OptionUI.AddCheckBox(IDC_TILE_SKIP, L"Skip converged tiles", 10, iY += 30, 150, 22, g_bTileSkip);
+		g_OptionUI.AddCheckBox(IDC_FUSED_PRESENT, L"Resolve to back buffer", 10, iY += 26, 150, 22, g_bFusedPresent);
+		g_OptionUI.AddCheckBox(IDC_DEPTH_REJECT, L"Depth rejection", 10, iY += 26, 150, 22, g_bDepthReject);
+
+		g_OptionUI.AddComboBox(IDC_TONEMAP, 10, iY += 30, 150, 22, 0, false, &pCombo);
+		pCombo->AddItem(L"Tone map: None", (void*)(size_t)tpot::TONEMAP::NONE);
+		pCombo->AddItem(L"Tone map: Reinhard", (void*)(size_t)tpot::TONEMAP::REINHARD);
+		pCombo->SetSelectedByData((void*)(size_t)g_iTonemap);
+		g_OptionUI.AddCheckBox(IDC_DITHER, L"Dither", 10, iY += 30, 150, 22, g_bDither);
 	}
 
 	void ReleasingSwapChain()
@@ -72,8 +135,12 @@ public:
 	{
 		g_HUD.SetLocation( pBackBufferSurfaceDesc->Width - 170, 0 );
 		g_HUD.SetSize( 170, 170 );
-		g_SampleUI.SetLocation( pBackBufferSurfaceDesc->Width - 170, pBackBufferSurfaceDesc->Height - 300 );
-		g_SampleUI.SetSize( 170, 300 );
+		// both fit 640x480 below g_HUD, and stay on screen when it is smaller
+		int iHeight = (int)pBackBufferSurfaceDesc->Height;
+		g_SampleUI.SetLocation( pBackBufferSurfaceDesc->Width - 170, (320 < iHeight) ? iHeight - 320 : 0 );
+		g_SampleUI.SetSize( 170, 320 );
+		g_OptionUI.SetLocation( pBackBufferSurfaceDesc->Width - 340, (350 < iHeight) ? iHeight - 350 : 0 );
+		g_OptionUI.SetSize( 170, 350 );
 	}
 
 	void OnEvent( int nControlID )
@@ -97,6 +164,41 @@ public:
 			g_SampleUI.GetStatic(IDC_BLUR_SIZE_STATIC)->SetText(sz);
 		}
 			break;
+		case IDC_RENDER_SCALE:
+			setRenderScale(g_OptionUI.GetSlider(IDC_RENDER_SCALE)->GetValue());
+			break;
+		case IDC_DYNAMIC_RESOLUTION:
+			g_bDynamicResolution = g_OptionUI.GetCheckBox(IDC_DYNAMIC_RESOLUTION)->GetChecked();
+			g_OptionUI.GetSlider(IDC_RENDER_SCALE)->SetEnabled(!g_bDynamicResolution);
+			g_DynamicResolution.reset(g_iRenderScale);
+			break;
+		case IDC_JITTER:
+			g_iJitter = (tpot::JITTER::TYPE)(size_t)g_OptionUI.GetComboBox(IDC_JITTER)->GetSelectedData();
+			break;
+		case IDC_RT_FORMAT:
+			g_iRtFormat = (tpot::RENDER_TARGET::FORMAT)(size_t)g_OptionUI.GetComboBox(IDC_RT_FORMAT)->GetSelectedData();
+			break;
+		case IDC_TAA_HISTORY:
+			g_iTaaHistory = (tpot::TAA_HISTORY::ID)(size_t)g_OptionUI.GetComboBox(IDC_TAA_HISTORY)->GetSelectedData();
+			break;
+		case IDC_TAA_CLAMP:
+			g_iTaaClamp = (tpot::TAA_CLAMP::ID)(size_t)g_OptionUI.GetComboBox(IDC_TAA_CLAMP)->GetSelectedData();
+			break;
+		case IDC_TILE_SKIP:
+			g_bTileSkip = g_OptionUI.GetCheckBox(IDC_TILE_SKIP)->GetChecked();
+			break;
+		case IDC_FUSED_PRESENT:
+			g_bFusedPresent = g_OptionUI.GetCheckBox(IDC_FUSED_PRESENT)->GetChecked();
+			break;
+		case IDC_DEPTH_REJECT:
+			g_bDepthReject = g_OptionUI.GetCheckBox(IDC_DEPTH_REJECT)->GetChecked();
+			break;
+		case IDC_TONEMAP:
+			g_iTonemap = (tpot::TONEMAP::ID)(size_t)g_OptionUI.GetComboBox(IDC_TONEMAP)->GetSelectedData();
+			break;
+		case IDC_DITHER:
+			g_bDither = g_OptionUI.GetCheckBox(IDC_DITHER)->GetChecked();
+			break;
 		case IDC_TOGGLE_LINES:
 //				g_bDrawWires = g_SampleUI.GetCheckBox( IDC_TOGGLE_LINES )->GetChecked();
 				break;
@@ -109,6 +211,9 @@ public:
 			case IDC_MODE_CAMMOVE:
 				g_iMode = CAMMOVE;
 				break;
+			case IDC_MODE_CHECKERBOARD:
+				g_iMode = CHECKERBOARD;
+				break;
 		}
 	}
 			
@@ -124,15 +229,35 @@ public:
 		result = g_SampleUI.MsgProc( hWnd, uMsg, wParam, lParam );
 		if( result ) return true;
 
+		result = g_OptionUI.MsgProc( hWnd, uMsg, wParam, lParam );
+		if( result ) return true;
+
 		return false;
 	}
 
+	// The slider follows the dynamic resolution
+	void setRenderScale( UINT scale )
+	{
+		g_iRenderScale = scale;
+		g_OptionUI.GetSlider(IDC_RENDER_SCALE)->SetValue((int)scale);
+
+		WCHAR sz[100];
+		swprintf_s(sz, L"Render Scale: %3d%%", g_iRenderScale);
+		g_OptionUI.GetStatic(IDC_RENDER_SCALE_STATIC)->SetText(sz);
+	}
+
+	void setStats( const WCHAR *sz, UINT line = 0 )
+	{
+		if (line < STATS_LINES) wcsncpy_s(stats_[line], sz, _TRUNCATE);
+	}
+
 	void render( float fElapsedTime )
 	{
 		// Render the HUD
 		DXUT_BeginPerfEvent( DXUT_PERFEVENTCOLOR, L"HUD / Stats" );
 		g_HUD.OnRender( fElapsedTime );
 		g_SampleUI.OnRender( fElapsedTime );
+		g_OptionUI.OnRender( fElapsedTime );
 		RenderText();
 		DXUT_EndPerfEvent();
 	}
@@ -144,6 +269,9 @@ private:
 		g_pTxtHelper->SetForegroundColor( D3DXCOLOR( 1.0f, 1.0f, 0.0f, 1.0f ) );
 		g_pTxtHelper->DrawTextLine( DXUTGetFrameStats( DXUTIsVsyncEnabled() ) );
 		g_pTxtHelper->DrawTextLine( DXUTGetDeviceStats() );
+		for (auto &x : stats_){
+			if (x[0]) g_pTxtHelper->DrawTextLine( x );
+		}
 
 		g_pTxtHelper->End();
 	}
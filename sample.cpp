@@ -11,7 +11,9 @@
 #include "resource.h"
 #include "config.h"
 #include "tpot/renderer.h"
-#include "tpot/mesh.h"
+#include "tpot/D3D11Device.h"
+#include "tpot/TaaFrame.h"
+#include "tpot/DynamicResolution.h"
 #include "hud.h"
 
 using namespace tpot;
@@ -22,12 +24,17 @@ using namespace tpot;
 Renderer							*g_pRenderer;
 MyHud								g_hud;
 CModelViewerCamera                  g_Camera;                // A model viewing camera
-Mesh								*g_pMesh;
-Mesh								*g_pSceneMesh;
-Mesh								*g_pPoleMesh;
-Mesh								*g_pQuadMesh;
+UINT                                 g_mesh;
+UINT                                 g_mesh_scene;
+UINT                                 g_mesh_pole;
+UINT                                 g_mesh_quad;
 UINT                                 g_rt_color;
+UINT                                 g_rt_depth[2];
 UINT                                 g_rt_taa[2];
+UINT                                 g_rt_tile[2];
+TaaFrame                             g_frame;
+DynamicResolution                    g_DynamicResolution(MakeDynamicResolutionParam(1000.0f / 60.0f));
+float                                g_fCpuTime = -1.0f;       // ms of the last OnD3D11FrameRender
 
 CDXUTDialogResourceManager          g_DialogResourceManager; // manager for shared resources of dialogs
 CD3DSettingsDlg                     g_D3DSettingsDlg;        // Device settings dialog
@@ -38,6 +45,17 @@ CD3DSettingsDlg                     g_D3DSettingsDlg;        // Device settings
 E_MODE                    g_iMode = TAA;
 UINT g_iBlendWeight = 8;
 UINT g_iBlurSize = 2;
+UINT g_iRenderScale = 100;	// scene resolution in percent per axis
+bool g_bDynamicResolution = false;	// g_iRenderScale follows the frame time
+JITTER::TYPE g_iJitter = JITTER::HALTON;
+RENDER_TARGET::FORMAT g_iRtFormat = RENDER_TARGET::RGBA16F;	// rt_color and rt_taa
+TAA_HISTORY::ID g_iTaaHistory = TAA_HISTORY::RGB;
+TAA_CLAMP::ID g_iTaaClamp = TAA_CLAMP::CHROMA;
+bool g_bDepthReject = true;	// Move Camera: drop the history of disoccluded pixels
+bool g_bTileSkip = true;	// skip converged tiles in the TAA resolve
+bool g_bFusedPresent = true;	// the TAA resolve draws the back buffer, no DECAL pass
+TONEMAP::ID g_iTonemap = TONEMAP::NONE;
+bool g_bDither = false;
 
 //--------------------------------------------------------------------------------------
 // Forward declarations 
@@ -217,22 +235,23 @@ bool CALLBACK IsD3D11DeviceAcceptable( const CD3D11EnumAdapterInfo *AdapterInfo,
 HRESULT CALLBACK OnD3D11CreateDevice( ID3D11Device* pd3dDevice, const DXGI_SURFACE_DESC* pBackBufferSurfaceDesc,
                                       void* pUserContext )
 {
-	g_pRenderer = new Renderer( pd3dDevice );
+	D3D11Device *pDevice = new D3D11Device( pd3dDevice );
+	g_pRenderer = new Renderer( pDevice );
 	HRESULT hr;
-	V_RETURN(g_DialogResourceManager.OnD3D11CreateDevice(pd3dDevice, g_pRenderer->pd3dImmediateContext()));
+	V_RETURN(g_DialogResourceManager.OnD3D11CreateDevice(pd3dDevice, pDevice->pd3dImmediateContext()));
 	V_RETURN(g_D3DSettingsDlg.OnD3D11CreateDevice(pd3dDevice));
 
-	g_hud.create(pd3dDevice, g_pRenderer->pd3dImmediateContext(), &g_DialogResourceManager);
+	g_hud.create(pd3dDevice, pDevice->pd3dImmediateContext(), &g_DialogResourceManager);
 
-	g_pMesh = Mesh::create( MESH_TYPE_EMBEDDED, pd3dDevice, nullptr );
-	g_pSceneMesh = Mesh::create( MESH_TYPE_SDKMESH, pd3dDevice, L"ColumnScene\\scene.sdkmesh" );
-	g_pPoleMesh = Mesh::create( MESH_TYPE_SDKMESH, pd3dDevice, L"ColumnScene\\poles.sdkmesh" );
+	g_mesh = g_pRenderer->createMesh( MESH_TYPE_EMBEDDED, nullptr );
+	g_mesh_scene = g_pRenderer->createMesh( MESH_TYPE_TMESH, L"ColumnScene\\scene.tmesh" );
+	g_mesh_pole = g_pRenderer->createMesh( MESH_TYPE_TMESH, L"ColumnScene\\Poles.tmesh" );
 
 	VTX_DECAL quad_vertex[] = { 
-			{ D3DXVECTOR3(0, 0, 0), D3DXVECTOR2(0, 0) },
-			{ D3DXVECTOR3(1, 0, 0), D3DXVECTOR2(1, 0) },
-			{ D3DXVECTOR3(0, 1, 0), D3DXVECTOR2(0, 1) },
-			{ D3DXVECTOR3(1, 1, 0), D3DXVECTOR2(1, 1) },
+			{ { 0, 0, 0 }, { 0, 0 } },
+			{ { 1, 0, 0 }, { 1, 0 } },
+			{ { 0, 1, 0 }, { 0, 1 } },
+			{ { 1, 1, 0 }, { 1, 1 } },
 	};
 	WORD quad_index[] = { 0, 1, 2, 1, 3, 2 };
 	VERTEX_LIST_MESH_PARAM quad_param = {
@@ -240,12 +259,24 @@ HRESULT CALLBACK OnD3D11CreateDevice( ID3D11Device* pd3dDevice, const DXGI_SURFA
 		quad_vertex, sizeof(quad_vertex) / sizeof(quad_vertex[0]),
 		quad_index, sizeof(quad_index) / sizeof(quad_index[0]),
 	};
-	g_pQuadMesh = Mesh::create(MESH_TYPE_TRIANGLELIST, pd3dDevice, &quad_param);
-
-	g_rt_color = g_pRenderer->create(RENDER_TARGET::HDR_SCREEN, pBackBufferSurfaceDesc->Width, pBackBufferSurfaceDesc->Height);
-	g_rt_color = g_pRenderer->create(RENDER_TARGET::HDR_SCREEN, pBackBufferSurfaceDesc->Width, pBackBufferSurfaceDesc->Height);
-	g_rt_taa[0] = g_pRenderer->create(RENDER_TARGET::HDR_SCREEN, pBackBufferSurfaceDesc->Width, pBackBufferSurfaceDesc->Height);
-	g_rt_taa[1] = g_pRenderer->create(RENDER_TARGET::HDR_SCREEN, pBackBufferSurfaceDesc->Width, pBackBufferSurfaceDesc->Height);
+	g_mesh_quad = g_pRenderer->createMesh(MESH_TYPE_TRIANGLELIST, &quad_param);
+
+	UINT width = pBackBufferSurfaceDesc->Width;
+	UINT height = pBackBufferSurfaceDesc->Height;
+	g_rt_color = g_pRenderer->create(RENDER_TARGET::HDR_SCREEN, width, height, 1.0f, g_iRtFormat);
+	g_rt_depth[0] = g_pRenderer->create(RENDER_TARGET::DEPTH, width, height);
+	g_rt_depth[1] = g_pRenderer->create(RENDER_TARGET::DEPTH, width, height);
+	g_rt_taa[0] = g_pRenderer->create(RENDER_TARGET::HDR_SCREEN, width, height, 1.0f, g_iRtFormat);
+	g_rt_taa[1] = g_pRenderer->create(RENDER_TARGET::HDR_SCREEN, width, height, 1.0f, g_iRtFormat);
+	g_rt_tile[0] = g_pRenderer->create(RENDER_TARGET::HDR_SCREEN, width, height, 1.0f / (float)TAA_TILE_SIZE, RENDER_TARGET::RGBA16F);
+	g_rt_tile[1] = g_pRenderer->create(RENDER_TARGET::HDR_SCREEN, width, height, 1.0f / (float)TAA_TILE_SIZE, RENDER_TARGET::RGBA16F);
+
+	TAA_FRAME_RESOURCES res = {
+		g_rt_color, { g_rt_depth[0], g_rt_depth[1] }, { g_rt_taa[0], g_rt_taa[1] },
+		g_mesh_scene, g_mesh_pole, g_mesh_quad,
+		{ g_rt_tile[0], g_rt_tile[1] },
+	};
+	g_frame.create(res);
 
     return S_OK;
 }
@@ -254,8 +285,6 @@ HRESULT CALLBACK OnD3D11CreateDevice( ID3D11Device* pd3dDevice, const DXGI_SURFA
 //--------------------------------------------------------------------------------------
 // Create any D3D11 resources that depend on the back buffer
 //--------------------------------------------------------------------------------------
-UINT scereen_width = 640;
-UINT scereen_height = 480;
 HRESULT CALLBACK OnD3D11ResizedSwapChain(ID3D11Device* pd3dDevice, IDXGISwapChain* pSwapChain,
                                           const DXGI_SURFACE_DESC* pBackBufferSurfaceDesc, void* pUserContext )
 {
@@ -265,15 +294,14 @@ HRESULT CALLBACK OnD3D11ResizedSwapChain(ID3D11Device* pd3dDevice, IDXGISwapChai
     g_Camera.SetWindow( pBackBufferSurfaceDesc->Width, pBackBufferSurfaceDesc->Height );
     g_Camera.SetButtonMasks( MOUSE_MIDDLE_BUTTON, MOUSE_WHEEL, MOUSE_LEFT_BUTTON );
 
-	g_pRenderer->ResizedSwapChain(pd3dDevice, pBackBufferSurfaceDesc);
+	g_pRenderer->ResizedSwapChain(pBackBufferSurfaceDesc->Width, pBackBufferSurfaceDesc->Height);
 
 	HRESULT hr;
 	V(g_DialogResourceManager.OnD3D11ResizedSwapChain(pd3dDevice, pBackBufferSurfaceDesc));
 	V(g_D3DSettingsDlg.OnD3D11ResizedSwapChain(pd3dDevice, pBackBufferSurfaceDesc));
 	g_hud.Resize(pd3dDevice, pBackBufferSurfaceDesc);
 
-	scereen_width = pBackBufferSurfaceDesc->Width;
-	scereen_height = pBackBufferSurfaceDesc->Height;
+	g_frame.resize(pBackBufferSurfaceDesc->Width, pBackBufferSurfaceDesc->Height);
 
     return S_OK;
 }
@@ -292,175 +320,69 @@ void CALLBACK OnD3D11FrameRender( ID3D11Device* pd3dDevice, ID3D11DeviceContext*
 		return;
 	}
 
-    // WVP
-    D3DXMATRIX mViewProjection;
-    D3DXMATRIX mProj = *g_Camera.GetProjMatrix();
-    D3DXMATRIX mView = *g_Camera.GetViewMatrix();
-
-	D3DXMATRIX mOffset;
-	static int frame_sub = 0;
-#if 0
-	const static float offset_tbl[16][2] = {
-		{ 0.0f / 4.0f, 0.0f / 4.0f },
-		{ 0.0f / 4.0f, 2.0f / 4.0f },
-		{ 2.0f / 4.0f, 2.0f / 4.0f },
-		{ 2.0f / 4.0f, 0.0f / 4.0f },
-
-		{ 1.0f / 4.0f, 0.0f / 4.0f },
-		{ 1.0f / 4.0f, 2.0f / 4.0f },
-		{ 3.0f / 4.0f, 2.0f / 4.0f },
-		{ 3.0f / 4.0f, 0.0f / 4.0f },
-
-		{ 0.0f / 4.0f, 1.0f / 4.0f },
-		{ 0.0f / 4.0f, 3.0f / 4.0f },
-		{ 2.0f / 4.0f, 3.0f / 4.0f },
-		{ 2.0f / 4.0f, 1.0f / 4.0f },
-
-		{ 1.0f / 4.0f, 1.0f / 4.0f },
-		{ 1.0f / 4.0f, 3.0f / 4.0f },
-		{ 3.0f / 4.0f, 3.0f / 4.0f },
-		{ 3.0f / 4.0f, 1.0f / 4.0f },
-	};
-	frame_sub = (frame_sub + 1) & 0xf;
-#else
-	const static float offset_tbl[8][2] = {
-		// http://en.wikipedia.org/wiki/Halton_sequence
-			{ 1.0f / 2.0f, 1.0f / 3.0f },
-			{ 1.0f / 4.0f, 2.0f / 3.0f },
-			{ 3.0f / 4.0f, 1.0f / 9.0f },
-			{ 1.0f / 8.0f, 4.0f / 9.0f },
-			{ 5.0f / 8.0f, 7.0f / 9.0f },
-			{ 3.0f / 8.0f, 2.0f / 9.0f },
-			{ 7.0f / 8.0f, 5.0f / 9.0f },
-			{ 1.0f / 16.0f, 8.0f / 9.0f },
-
-	};
-	frame_sub = (frame_sub + 1) & 0x7;
-#endif
-	D3DXMatrixTranslation(&mOffset, offset_tbl[frame_sub][0] / (float)scereen_width, offset_tbl[frame_sub][1] / (float)scereen_height, 0.0f);
-
-	if (g_iMode == TAA || g_iMode == CAMMOVE){
-		mViewProjection = mView * mProj * mOffset;
-	}
-	else{
-		mViewProjection = mView * mProj;
-	}
-
-	g_pRenderer->pushRenderTarget();
-
-	static unsigned int bFrame = 0;
-	bFrame = 1 - bFrame;
-
-	g_pRenderer->setRenderTarget(g_rt_color);
+	LARGE_INTEGER cpu_begin;
+	QueryPerformanceCounter(&cpu_begin);
 
-    // Clear the render target and depth stencil
-	g_pRenderer->Clear( 0xff080808 );
-	g_pRenderer->ClearDepth( 1.0f );
-
-	g_pRenderer->set(VS::SCENE);
-	g_pRenderer->set(PS::SCENE);
-	g_pRenderer->set(0, SAMPLER_STATE::LINEAR);
-
-	CB_SCENE* pCBscene = (CB_SCENE*)g_pRenderer->Map();
-	D3DXMatrixTranspose(&pCBscene->mViewProjection, &mViewProjection);
-	g_pRenderer->UmMap();
-
-	g_pRenderer->setCB_VS();
-
-	g_pRenderer->Draw(g_pSceneMesh);
-	g_pRenderer->Draw(g_pPoleMesh);
-
-	if (g_iMode == TAA)
-	{
-		g_pRenderer->setRenderTarget(g_rt_taa[bFrame]);
-		g_pRenderer->setDepth(~(UINT)0);
-		g_pRenderer->set(DEPTH_STATE::DISABLE);
-
-		D3DXMATRIX m;
-		D3DXMatrixScaling(&m, (float)scereen_width, (float)scereen_height, 1.0f);
-		mViewProjection = m * g_pRenderer->screenProjMatrix();
-
-		g_pQuadMesh->texture(g_pRenderer->getTexture(g_rt_taa[1 - bFrame]), 0);
-		g_pQuadMesh->texture(g_pRenderer->getTexture(g_rt_color), 1);
-		g_pRenderer->set(VS::TAA);
-		g_pRenderer->set(PS::TAA);
-		g_pRenderer->set(0, SAMPLER_STATE::LINEAR);
-		CB_TAA* pCBdecal = (CB_TAA*)g_pRenderer->Map();
-		D3DXMatrixTranspose(&pCBdecal->mViewProjection, &mViewProjection);
-		pCBdecal->fRate = 1.0f / (float)g_iBlendWeight;
-		static bool init = false;
-		if (!init){
-			init = true;
-			pCBdecal->fRate = 1.0f;
-		}
-		pCBdecal->inv_screen_size[0] = 1.0f / (float)scereen_width;
-		pCBdecal->inv_screen_size[1] = 1.0f / (float)scereen_height;
-		pCBdecal->fBlurSize = 0.1f * (float)g_iBlurSize;
-		g_pRenderer->UmMap();
-		g_pRenderer->setCB_VS();
-		g_pRenderer->setCB_PS();
-		g_pRenderer->Draw(g_pQuadMesh);
-		g_pQuadMesh->texture(nullptr, 0);
-		g_pQuadMesh->texture(nullptr, 1);
-
-		g_pRenderer->popRenderTarget();
-		g_pRenderer->Clear(0x00101010);
-		g_pRenderer->ClearDepth(1.0f);
-
-		{
-			g_pQuadMesh->texture(g_pRenderer->getTexture(g_rt_taa[bFrame]), 0);
-			g_pRenderer->set(VS::DECAL);
-			g_pRenderer->set(PS::DECAL);
-			CB_DECAL* pCBdecal = (CB_DECAL*)g_pRenderer->Map();
-			D3DXMatrixTranspose(&pCBdecal->mViewProjection, &mViewProjection);
-			g_pRenderer->setCB_VS();
-			g_pRenderer->UmMap();
-			g_pRenderer->Draw(g_pQuadMesh);
-			g_pQuadMesh->texture(nullptr, 0);
-		}
-	}
-	else{
-		g_pRenderer->popRenderTarget();
-		g_pRenderer->Clear(0x00101010);
-		g_pRenderer->set(DEPTH_STATE::DISABLE);
-
-		D3DXMATRIX m;
-		D3DXMatrixScaling(&m, (float)scereen_width, (float)scereen_height, 1.0f);
-		mViewProjection = m * g_pRenderer->screenProjMatrix();
-
-		g_pQuadMesh->texture(g_pRenderer->getTexture(g_rt_color), 0);
-		g_pRenderer->set(VS::DECAL);
-		g_pRenderer->set(PS::DECAL);
-		CB_DECAL* pCBdecal = (CB_DECAL*)g_pRenderer->Map();
-		D3DXMatrixTranspose(&pCBdecal->mViewProjection, &mViewProjection);
-		g_pRenderer->setCB_VS();
-		g_pRenderer->UmMap();
-		g_pRenderer->Draw(g_pQuadMesh);
-		g_pQuadMesh->texture(nullptr, 0);
+	// Timings of earlier frames pick this one's scale; the other modes render at full size
+	if (g_bDynamicResolution && g_iMode == TAA){
+		float gpu_ms;
+		if (!g_pRenderer->getGpuTime(&gpu_ms)) gpu_ms = -1.0f;
+		UINT scale = g_DynamicResolution.update(g_fCpuTime, gpu_ms);
+		if (scale != g_iRenderScale) g_hud.setRenderScale(scale);
 	}
 
-#if 1
-	{// _[^[Qbg̉
-		D3DXMATRIX mS, m;
-		D3DXMatrixScaling(&mS, 100.0f, 100.0f, 1.0f);
-		D3DXMatrixTranslation(&m, 0.0f, (float)scereen_height - 100.0f, 0.0f);
-		mViewProjection = mS * m * g_pRenderer->screenProjMatrix();
-
-		g_pQuadMesh->texture(g_pRenderer->getTexture(g_rt_color));
-		g_pRenderer->set(VS::DECAL);
-		g_pRenderer->set(PS::DECAL);
-		CB_DECAL* pCBdecal = (CB_DECAL*)g_pRenderer->Map();
-		D3DXMatrixTranspose(&pCBdecal->mViewProjection, &mViewProjection);
-		g_pRenderer->UmMap();
-		g_pRenderer->setCB_VS();
-		g_pRenderer->Draw(g_pQuadMesh);
+	// D3DXMATRIX and tpot::MATRIX share the layout
+	TAA_FRAME_PARAM param;
+	memcpy(&param.mView, g_Camera.GetViewMatrix(), sizeof(MATRIX));
+	memcpy(&param.mProj, g_Camera.GetProjMatrix(), sizeof(MATRIX));
+	param.mode = (TAA_MODE::ID)g_iMode;
+	param.blend_weight = g_iBlendWeight;
+	param.blur_size = g_iBlurSize;
+	param.render_scale = g_iRenderScale;
+	param.jitter = g_iJitter;
+	param.format = g_iRtFormat;
+	param.history = g_iTaaHistory;
+	param.tile_skip = g_bTileSkip;
+	param.fused_present = g_bFusedPresent;
+	param.clamp = g_iTaaClamp;
+	param.depth_reject = g_bDepthReject;
+	param.tonemap = g_iTonemap;
+	param.exposure = 1.0f;
+	param.dither = g_bDither;
+	// a mesh that finishes loading changes converged tiles
+	param.scene_revision = (g_pRenderer->isMeshReady(g_mesh_scene) ? 1 : 0) + (g_pRenderer->isMeshReady(g_mesh_pole) ? 1 : 0);
+
+	g_frame.render(g_pRenderer, param);
+
+	const tpot::BINDING_STATS &stats = g_pRenderer->stats();
+	WCHAR sz[128];
+	swprintf_s(sz, L"Bindings: %u submitted, %u filtered, %u forwarded",
+		stats.total(stats.submitted), stats.total(stats.filtered), stats.total(stats.forwarded));
+	g_hud.setStats(sz);
+
+	const float MB = 1.0f / (1024.0f * 1024.0f);
+	swprintf_s(sz, L"Render targets: %.1f MB (color %.1f, depth 2x %.1f, history 2x %.1f)",
+		MB * (float)g_pRenderer->getTotalBytes(), MB * (float)g_pRenderer->getBytes(g_rt_color),
+		MB * (float)g_pRenderer->getBytes(g_rt_depth[0]), MB * (float)g_pRenderer->getBytes(g_rt_taa[0]));
+	g_hud.setStats(sz, 1);
+
+	if (g_bDynamicResolution && g_iMode != TAA){
+		swprintf_s(sz, L"Dynamic resolution: TAA mode only");
+	}else if (g_bDynamicResolution){
+		swprintf_s(sz, L"Dynamic resolution: CPU %.1f ms, GPU %.1f ms%s",
+			g_DynamicResolution.cpuTime(), g_DynamicResolution.gpuTime(), g_DynamicResolution.cpuBound() ? L" (CPU bound)" : L"");
+	}else{
+		sz[0] = 0;
 	}
-#endif
-
-
-	g_pRenderer->set(DEPTH_STATE::UNUSED);
+	g_hud.setStats(sz, 2);
 
 	g_hud.render(fElapsedTime);
+	g_pRenderer->endFrame();
+
+	LARGE_INTEGER cpu_end, frequency;
+	QueryPerformanceCounter(&cpu_end);
+	QueryPerformanceFrequency(&frequency);
+	g_fCpuTime = (float)(1000.0 * (double)(cpu_end.QuadPart - cpu_begin.QuadPart) / (double)frequency.QuadPart);
 }
 
 //--------------------------------------------------------------------------------------
@@ -486,10 +408,5 @@ void CALLBACK OnD3D11DestroyDevice( void* pUserContext )
 	g_D3DSettingsDlg.OnD3D11DestroyDevice();
 	g_hud.destroy();
 
-	SAFE_DELETE(g_pQuadMesh);
-	SAFE_DELETE(g_pSceneMesh);
-	SAFE_DELETE(g_pPoleMesh);
-	SAFE_DELETE(g_pMesh);
-
 	SAFE_DELETE( g_pRenderer );
 }
@@ -2,11 +2,27 @@ cbuffer cbConstants : register( b0 )
 {
     float4x4 g_f4x4WorldViewProjection;        // World * View * Projection matrix
 	float4   g_fParams;                        // screen_width, screen_height, blending weight, blur_size
+	float4   g_fUpsample;                      // render_width, render_height, jitter_x, jitter_y (render pixels)
+	float4x4 g_f4x4Reprojection;               // current jittered clip space -> previous unjittered clip space
+	float4   g_fUvScale;                       // used part of the pooled textures: g_txAcc xy, g_txScene zw
+	float4   g_fTile;                          // threshold, frames to converge, 1: ignore and reset the mask, unused
+	float4   g_fPresent;                       // PS_Present*: tone map, exposure, dither, frame
+	float4   g_fDepthReject;                   // PS_Reproject, PS_Checkerboard: projection _33, _43, threshold (0: off), unused
+	float4   g_fCheckerboard;                  // PS_Checker*: phase of this frame (0, 1), unused
 }
 
 // Textures
 Texture2D         g_txAcc      : register(t0);
 Texture2D         g_txScene     : register(t1);
+Texture2D         g_txDepth     : register(t2);
+Texture2D         g_txTile      : register(t3);
+Texture2D         g_txPrevDepth : register(t4);
+
+// PS_Present*: the history, next to the back buffer as SV_Target0
+RWTexture2D<float4> g_uavHistory : register(u1);
+
+// CS_Variance: the new history (Device::Dispatch)
+RWTexture2D<float4> g_uavOut : register(u0);
 
 // Samplers
 SamplerState                g_SampleLinear      : register(s0);
@@ -56,14 +72,116 @@ float3 YCbCr2RGB(float3 ycc)
 	return float3(dot(ycc, YCbCr2R), dot(ycc, YCbCr2G), dot(ycc, YCbCr2B));
 }
 
+// Convergence mask: one texel per TILE_SIZE^2 pixels of the history, the
+// count rounded as rt_tile's size, so the last row and column take the remainder
+static const int TILE_SIZE = 16;
 
+int2 TileCount()
+{
+	int2 size = int2(round(1.0f / g_fParams.xy));
+	return max(1, (size + TILE_SIZE / 2) / TILE_SIZE);
+}
 
-PS_RenderOutput PS( PS_RenderSceneInput In )
+bool TileConverged(float2 position)
+{
+	if (g_fTile.z != 0.0f) return false;
+	int2 tile = min(int2(position) / TILE_SIZE, TileCount() - 1);
+	return g_fTile.y <= g_txTile.Load(int3(tile, 0)).y;
+}
+
+// g_txAcc is a pooled texture that may be larger than the history, so the
+// WRAP sampler would reach texels past the used area. Texels are loaded
+// and wrapped within size instead, as ResolveTAA and SampleLinear do.
+int2 WrapTexel(int2 p, int2 size)
+{
+	return (p % size + size) % size;
+}
+
+// Bilinear fetch of g_txAcc at uv, wrapped within size
+float4 SampleAccWrap(float2 uv, int2 size)
+{
+	float2 t = uv * size - 0.5f;
+	float2 f = floor(t);
+	float2 w = t - f;
+	int2 p0 = WrapTexel(int2(f), size);
+	int2 p1 = WrapTexel(p0 + 1, size);
+	float4 top = lerp(g_txAcc.Load(int3(p0.x, p0.y, 0)), g_txAcc.Load(int3(p1.x, p0.y, 0)), w.x);
+	float4 bottom = lerp(g_txAcc.Load(int3(p0.x, p1.y, 0)), g_txAcc.Load(int3(p1.x, p1.y, 0)), w.x);
+	return lerp(top, bottom, w.y);
+}
+
+// SampleAccWrap from the centre of pixel p plus an offset in texels along
+// one axis: only the two taps along that axis have a weight
+float4 AccTap(int2 p, float2 offset, int2 size)
+{
+	float2 f = floor(offset);
+	int2 axis = (offset.x != 0.0f) ? int2(1, 0) : int2(0, 1);
+	float w = dot(offset - f, float2(axis));
+	int2 p0 = WrapTexel(p + int2(f), size);
+	int2 p1 = WrapTexel(p0 + axis, size);
+	return lerp(g_txAcc.Load(int3(p0, 0)), g_txAcc.Load(int3(p1, 0)), w);
+}
+
+// YCoCg history texel (TAA_HISTORY::YCOCG*): Y, Co + 0.5, Cg + 0.5, A.
+// The bias keeps it in range of an UNORM target.
+float4 EncodeYCoCg(float4 rgba)
+{
+	return float4(
+		dot(rgba.rgb, float3( 0.25, 0.5,  0.25)),
+		dot(rgba.rgb, float3( 0.5,  0.0, -0.5 )) + 0.5,
+		dot(rgba.rgb, float3(-0.25, 0.5, -0.25)) + 0.5,
+		rgba.a);
+}
+
+float4 DecodeYCoCg(float4 texel)
+{
+	float co = texel.y - 0.5;
+	float cg = texel.z - 0.5;
+	float t = texel.x - cg;
+	return float4(t + co, texel.x + cg, t - co, texel.w);
+}
+
+// Same as decal.hlsl and PresentPixel in tpot/TaaPresent.cpp
+uint PresentHash(uint2 pos, uint frame)
 {
-    PS_RenderOutput O;
+	uint h = pos.x * 1973 + pos.y * 9277 + frame * 26699;
+	h = (h ^ 61) ^ (h >> 16);
+	h *= 9;
+	h ^= h >> 4;
+	h *= 0x27d4eb2d;
+	h ^= h >> 15;
+	return h;
+}
 
-	O.Color = 0;
+float3 LinearToSRGB(float3 c)
+{
+	return (c <= 0.0031308) ? 12.92 * c : 1.055 * pow(c, 1.0 / 2.4) - 0.055;
+}
 
+float3 SRGBToLinear(float3 c)
+{
+	return (c <= 0.04045) ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4);
+}
+
+// Colour for the sRGB back buffer: exposure, tone map, then the dither in
+// steps of its 8 bits. The view encodes to sRGB again.
+float4 Present(float4 color, float2 position)
+{
+	float3 c = color.rgb * g_fPresent.y;
+	if (g_fPresent.x == 1.0f) c = c / (1.0f + c);
+	c = saturate(c);
+	if (g_fPresent.z != 0.0f){
+		float d = (float)(PresentHash(uint2(position), (uint)g_fPresent.w) & 0xffff) / 65536.0f - 0.5f;
+		c = SRGBToLinear(saturate(LinearToSRGB(c) + d / 255.0f));
+	}
+	return float4(c, color.a);
+}
+
+
+
+// The resolves of PS and PS_YCoCg, shared with PS_Present*
+float4 Resolve( PS_RenderSceneInput In )
+{
 	float2 neighbor_offset[4] = {
 			{ 0, +1 },
 			{ 0, -1 },
@@ -71,13 +189,14 @@ PS_RenderOutput PS( PS_RenderSceneInput In )
 			{-1,  0 },
 	};
 
-	float4 center_color = g_txScene.Sample(g_SampleLinear, In.TexCoord);
+	int2 size = int2(round(1.0f / g_fParams.xy));
+	float4 center_color = g_txScene.Sample(g_SampleLinear, In.TexCoord * g_fUvScale.zw);
 
 	float4 neighbor_sum = center_color;
 
 	for (int i = 0; i < 4; i++){
 		// ߖT̓_
-		float4 neighbor = g_txAcc.Sample(g_SampleLinear, In.TexCoord + neighbor_offset[i] * g_fParams.xy * g_fParams.w);
+		float4 neighbor = AccTap(int2(In.Position.xy), neighbor_offset[i] * g_fParams.w, size);
 		float3 color_diff = abs(neighbor.xyz - center_color.xyz);
 		float3 ycc = RGB2YCbCr(color_diff.xyz);		// SƂ̍YCbCrŌ
 		const float cbcr_threshhold = 0.32f;
@@ -88,7 +207,374 @@ PS_RenderOutput PS( PS_RenderSceneInput In )
 		}
 		neighbor_sum += neighbor;
 	}
-	O.Color = neighbor_sum / 5.0f;
+	return neighbor_sum / 5.0f;
+}
+
+PS_RenderOutput PS( PS_RenderSceneInput In )
+{
+	PS_RenderOutput O;
+
+	if (TileConverged(In.Position.xy)) discard;// keeps the history of the frame before last, within g_fTile.x
+
+	O.Color = Resolve(In);
+
+	return O;
+}
+
+// PS with a YCoCg history: the neighbours are clamped in the stored space,
+// so only the scene centre is converted. decal.hlsl PS_YCoCg presents it.
+float4 ResolveYCoCg( PS_RenderSceneInput In )
+{
+	float2 neighbor_offset[4] = {
+			{ 0, +1 },
+			{ 0, -1 },
+			{+1,  0 },
+			{-1,  0 },
+	};
+
+	int2 size = int2(round(1.0f / g_fParams.xy));
+	float4 center = EncodeYCoCg(g_txScene.Sample(g_SampleLinear, In.TexCoord * g_fUvScale.zw));
+
+	float4 neighbor_sum = center;
+
+	for (int i = 0; i < 4; i++){
+		float4 neighbor = AccTap(int2(In.Position.xy), neighbor_offset[i] * g_fParams.w, size);
+		float3 diff = neighbor.xyz - center.xyz;
+		const float cocg_threshhold = 0.16f;// Co, Cg are half of an RGB difference
+		float cocg_len = length(diff.yz);
+		if (cocg_threshhold < cocg_len){
+			neighbor.xyz = center.xyz + (cocg_threshhold / cocg_len) * diff;
+		}
+		neighbor_sum += neighbor;
+	}
+	return neighbor_sum / 5.0f;
+}
+
+PS_RenderOutput PS_YCoCg( PS_RenderSceneInput In )
+{
+	PS_RenderOutput O;
+
+	if (TileConverged(In.Position.xy)) discard;
+
+	O.Color = ResolveYCoCg(In);
+
+	return O;
+}
+
+// Resolve and present in one pass, no DECAL blit of the history: SV_Target0
+// is the back buffer (Device::setPresentTarget), the history is written to
+// g_uavHistory. Converged tiles keep their texels and present g_txAcc, which
+// is within g_fTile.x of what the two pass present reads there.
+PS_RenderOutput PS_Present( PS_RenderSceneInput In )
+{
+	PS_RenderOutput O;
+
+	int2 pos = int2(In.Position.xy);
+	float4 history;
+	if (TileConverged(In.Position.xy)){
+		history = g_txAcc.Load(int3(pos, 0));
+	}else{
+		history = Resolve(In);
+		g_uavHistory[pos] = history;
+	}
+	O.Color = Present(history, In.Position.xy);
+
+	return O;
+}
+
+PS_RenderOutput PS_PresentYCoCg( PS_RenderSceneInput In )
+{
+	PS_RenderOutput O;
+
+	int2 pos = int2(In.Position.xy);
+	float4 texel;
+	if (TileConverged(In.Position.xy)){
+		texel = g_txAcc.Load(int3(pos, 0));
+	}else{
+		texel = ResolveYCoCg(In);
+		g_uavHistory[pos] = texel;
+	}
+	O.Color = Present(DecodeYCoCg(texel), In.Position.xy);
+
+	return O;
+}
+
+// Temporal upsampling: g_txScene is rendered at a fraction of the output size.
+// Each low resolution sample is splatted with a tent of one output pixel
+// around its jittered position and accumulated into the full size history.
+PS_RenderOutput PS_Upsample( PS_RenderSceneInput In )
+{
+	PS_RenderOutput O;
+
+	float2 render_size = g_fUpsample.xy;
+	float2 jitter = g_fUpsample.zw;
+
+	if (1.0f <= g_fParams.z){// no history yet
+		O.Color = g_txScene.Sample(g_SampleLinear, In.TexCoord * g_fUvScale.zw);
+		return O;
+	}
+
+	float2 render_pos = In.TexCoord * render_size;
+	float2 sample_idx = clamp(floor(render_pos - jitter), 0, render_size - 1);
+	float2 d = (render_pos - (sample_idx + 0.5f + jitter)) / (render_size * g_fParams.xy);// in output pixels
+	float2 tent = saturate(1.0f - abs(d));
+	float4 sample_color = g_txScene.Load(int3(sample_idx, 0));
+
+	// clamp the history to the 3x3 neighbourhood of the current samples
+	float4 color_min = sample_color;
+	float4 color_max = sample_color;
+	for (int y = -1; y <= 1; y++){
+		for (int x = -1; x <= 1; x++){
+			float4 c = g_txScene.Load(int3(clamp(sample_idx + float2(x, y), 0, render_size - 1), 0));
+			color_min = min(color_min, c);
+			color_max = max(color_max, c);
+		}
+	}
+	float4 history = clamp(g_txAcc.Sample(g_SampleLinear, In.TexCoord * g_fUvScale.xy), color_min, color_max);
+
+	O.Color = lerp(history, sample_color, tent.x * tent.y * g_fParams.z);
+
+	return O;
+}
+
+// Same as DepthRejected in tpot/TaaDisocclusion.h
+bool DepthRejected(float expected, float history)
+{
+	if (!(0.0f < g_fDepthReject.z)) return false;
+	float z = g_fDepthReject.y / (expected - g_fDepthReject.x);
+	return !(abs(g_fDepthReject.y / (history - g_fDepthReject.x) - z) <= g_fDepthReject.z * z);
+}
+
+// Whether the previous depth buffer has another surface where this one was:
+// none of the 2x2 texels of the history fetch is within the threshold
+bool Disoccluded(float2 history_uv, float expected, int2 render_size)
+{
+	int2 p = int2(floor(history_uv * render_size - 0.5f));
+	for (int j = 0; j < 2; j++){
+		for (int i = 0; i < 2; i++){
+			float history = g_txPrevDepth.Load(int3(clamp(p + int2(i, j), 0, render_size - 1), 0)).r;
+			if (!DepthRejected(expected, history)) return false;
+		}
+	}
+	return true;
+}
+
+// Camera motion: the history is fetched where the current surface was in the
+// previous frame, found from the depth buffer of the scene pass, and clamped
+// to the 3x3 neighbourhood of the current scene as in PS_Upsample.
+// Pixels that were off screen, or behind something else in the previous
+// depth buffer (g_fDepthReject), fall back to the current scene.
+PS_RenderOutput PS_Reproject( PS_RenderSceneInput In )
+{
+	PS_RenderOutput O;
+
+	float2 render_size = g_fUpsample.xy;
+	float4 center_color = g_txScene.Sample(g_SampleLinear, In.TexCoord * g_fUvScale.zw);
+
+	int2 idx = min(int2(In.TexCoord * render_size), int2(render_size) - 1);
+	float depth = g_txDepth.Load(int3(idx, 0)).r;
+	float4 prev = mul(float4(In.TexCoord.x * 2.0f - 1.0f, 1.0f - In.TexCoord.y * 2.0f, depth, 1.0f), g_f4x4Reprojection);
+	float2 history_uv = float2(0.5f, -0.5f) * prev.xy / prev.w + 0.5f;
+
+	if (1.0f <= g_fParams.z || any(history_uv != saturate(history_uv))
+		|| (0.0f < g_fDepthReject.z && Disoccluded(history_uv, prev.z / prev.w, int2(render_size)))){
+		O.Color = center_color;
+		return O;
+	}
+
+	float4 color_min = center_color;
+	float4 color_max = center_color;
+	for (int y = -1; y <= 1; y++){
+		for (int x = -1; x <= 1; x++){
+			float4 c = g_txScene.Load(int3(clamp(idx + int2(x, y), 0, int2(render_size) - 1), 0));
+			color_min = min(color_min, c);
+			color_max = max(color_max, c);
+		}
+	}
+	float4 history = clamp(SampleAccWrap(history_uv, int2(round(1.0f / g_fParams.xy))), color_min, color_max);
+
+	O.Color = lerp(history, center_color, g_fParams.z);
+
+	return O;
+}
+
+// Checkerboard rendering: the scene pass shades the pixels of one phase,
+// the other phase the next frame. Same as CheckerboardShaded in tpot/TaaCheckerboard.h
+bool CheckerShaded(int2 p)
+{
+	return ((p.x + p.y + (int)g_fCheckerboard.x) & 1) == 0;
+}
+
+// Drawn before the scene: depth 0 on the pixels of the other phase, so that
+// early depth keeps PS_RenderScene off them. No colour is written.
+void PS_CheckerMask( PS_RenderSceneInput In )
+{
+	if (CheckerShaded(int2(In.Position.xy))) discard;
+}
+
+// Neighbours past the edge are mirrored, which keeps them on shaded pixels
+int2 CheckerMirror(int2 p, int2 size)
+{
+	return (p < 0) ? -p : (size <= p) ? 2 * (size - 1) - p : p;
+}
+
+// Same as CheckerboardDisoccluded in tpot/TaaCheckerboard.h: a pixel that was
+// not shaded has no depth, so the history is kept when one of the 2x2 texels
+// of the previous depth buffer is within the view depth range of the shaded
+// neighbours. The texels PS_CheckerMask left at 0 never are.
+bool CheckerDisoccluded(float2 history_uv, float d_min, float d_max, int2 size)
+{
+	if (!(0.0f < g_fDepthReject.z)) return false;
+	float z_min = g_fDepthReject.y / (d_min - g_fDepthReject.x) * (1.0f - g_fDepthReject.z);
+	float z_max = g_fDepthReject.y / (d_max - g_fDepthReject.x) * (1.0f + g_fDepthReject.z);
+
+	int2 p = int2(floor(history_uv * size - 0.5f));
+	for (int j = 0; j < 2; j++){
+		for (int i = 0; i < 2; i++){
+			float d = g_txPrevDepth.Load(int3(clamp(p + int2(i, j), 0, size - 1), 0)).r;
+			float z = g_fDepthReject.y / (d - g_fDepthReject.x);
+			if (z_min <= z && z <= z_max) return false;
+		}
+	}
+	return true;
+}
+
+// Checkerboard resolve into the full size history. Shaded pixels are copied,
+// the others take the history where the nearest shaded neighbour's surface
+// was last frame, unless CheckerDisoccluded. Between history texels the
+// bilinear fetch blurs, so its weight falls to 0 halfway between them, in
+// favour of the mean of the two neighbours across the weaker gradient.
+PS_RenderOutput PS_Checkerboard( PS_RenderSceneInput In )
+{
+	PS_RenderOutput O;
+
+	int2 size = int2(g_fUpsample.xy);
+	int2 p = int2(In.Position.xy);
+	if (CheckerShaded(p)){
+		O.Color = g_txScene.Load(int3(p, 0));
+		return O;
+	}
+
+	const int2 offsets[4] = { int2(-1, 0), int2(1, 0), int2(0, -1), int2(0, 1) };
+	float4 c[4];
+	float d_min = 1.0f;
+	float d_max = 0.0f;
+	for (int i = 0; i < 4; i++){
+		int2 n = CheckerMirror(p + offsets[i], size);
+		c[i] = g_txScene.Load(int3(n, 0));
+		float d = g_txDepth.Load(int3(n, 0)).r;
+		d_min = min(d_min, d);
+		d_max = max(d_max, d);
+	}
+
+	float3 RGB2Y = { 0.29900, 0.58700, 0.11400 };
+	float h = abs(dot(c[0].rgb, RGB2Y) - dot(c[1].rgb, RGB2Y));
+	float v = abs(dot(c[2].rgb, RGB2Y) - dot(c[3].rgb, RGB2Y));
+	bool edge_x = (p.x == 0 || p.x == size.x - 1);
+	bool edge_y = (p.y == 0 || p.y == size.y - 1);
+	if (edge_x != edge_y){// the pair along the edge of the image
+		h = edge_x ? 1.0f : 0.0f;
+		v = edge_y ? 1.0f : 0.0f;
+	}
+	float4 horizontal = 0.5f * (c[0] + c[1]);
+	float4 vertical = 0.5f * (c[2] + c[3]);
+	float4 spatial = (h < v) ? horizontal : (v < h) ? vertical : 0.5f * (horizontal + vertical);
+
+	float4 prev = mul(float4(In.TexCoord.x * 2.0f - 1.0f, 1.0f - In.TexCoord.y * 2.0f, d_min, 1.0f), g_f4x4Reprojection);
+	float2 history_uv = float2(0.5f, -0.5f) * prev.xy / prev.w + 0.5f;
+	if (1.0f <= g_fParams.z || any(history_uv != saturate(history_uv))
+		|| CheckerDisoccluded(history_uv, d_min, d_max, size)){
+		O.Color = spatial;
+		return O;
+	}
+
+	float2 f = abs(frac(history_uv * size) - 0.5f);// distance to the texel centre
+	float weight = (1.0f - 2.0f * f.x) * (1.0f - 2.0f * f.y);
+	float4 history = SampleAccWrap(history_uv, size);
+	O.Color = lerp(spatial, history, weight);
+
+	return O;
+}
+
+// Renders rt_tile: x the largest change of the resolve in the tile (g_txAcc
+// the new history, g_txScene the one it read), y the frames it stayed below
+// g_fTile.x. Converged tiles were not resolved and are not compared again.
+PS_RenderOutput PS_TileMask( PS_RenderSceneInput In )
+{
+	PS_RenderOutput O;
+
+	int2 tile = int2(In.Position.xy);
+	float2 prev = g_txTile.Load(int3(tile, 0)).xy;
+	if (g_fTile.z != 0.0f){
+		O.Color = 0;
+		return O;
+	}
+	if (g_fTile.y <= prev.y){
+		O.Color = float4(prev, 0, 0);
+		return O;
+	}
+
+	int2 count = TileCount();
+	int2 begin = tile * TILE_SIZE;
+	int2 end = (tile == count - 1) ? int2(round(1.0f / g_fParams.xy)) : begin + TILE_SIZE;
+	float change = 0;
+	for (int y = begin.y; y < end.y; y++){
+		for (int x = begin.x; x < end.x; x++){
+			float3 d = abs(g_txAcc.Load(int3(x, y, 0)).rgb - g_txScene.Load(int3(x, y, 0)).rgb);
+			change = max(change, max(d.r, max(d.g, d.b)));
+		}
+	}
+	O.Color = float4(change, (change < g_fTile.x) ? prev.y + 1.0f : 0.0f, 0, 0);
 
 	return O;
 }
+
+// Variance clipping (TAA_CLAMP::VARIANCE), same as tpot/TaaVariance.cpp.
+// A group loads its tile of the scene and a one texel apron once into
+// groupshared memory; the 3x3 mean and deviation of the scene come from
+// there. The history is read once, pulled toward the mean until it is
+// within VARIANCE_GAMMA deviations, and blended with g_fParams.z.
+static const int VARIANCE_GROUP = 8;		// TAA_VARIANCE_GROUP
+static const int VARIANCE_TILE = VARIANCE_GROUP + 2;
+static const float VARIANCE_GAMMA = 1.0f;
+static const float VARIANCE_EPSILON = 1.0e-4f;
+
+groupshared float4 g_tile[VARIANCE_TILE][VARIANCE_TILE];
+
+[numthreads(VARIANCE_GROUP, VARIANCE_GROUP, 1)]
+void CS_Variance( uint3 group : SV_GroupID, uint3 thread : SV_GroupThreadID, uint index : SV_GroupIndex )
+{
+	int2 size = int2(round(1.0f / g_fParams.xy));
+	int2 origin = int2(group.xy) * VARIANCE_GROUP - 1;
+
+	for (int i = (int)index; i < VARIANCE_TILE * VARIANCE_TILE; i += VARIANCE_GROUP * VARIANCE_GROUP){
+		int2 t = int2(i % VARIANCE_TILE, i / VARIANCE_TILE);
+		g_tile[t.y][t.x] = g_txScene.Load(int3(clamp(origin + t, 0, size - 1), 0));
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	int2 pos = int2(group.xy * VARIANCE_GROUP + thread.xy);
+	if (any(size <= pos)) return;
+
+	float4 m1 = 0;
+	float4 m2 = 0;
+	for (int y = 0; y < 3; y++){
+		for (int x = 0; x < 3; x++){
+			float4 c = g_tile[thread.y + y][thread.x + x];
+			m1 += c;
+			m2 += c * c;
+		}
+	}
+	m1 /= 9.0f;
+	m2 /= 9.0f;
+	float4 sigma = sqrt(max(m2 - m1 * m1, 0.0f));
+	float4 center = g_tile[thread.y + 1][thread.x + 1];
+
+	float4 history = g_txAcc.Load(int3(pos, 0));
+	float3 d = history.rgb - m1.rgb;
+	float3 e = abs(d) / (VARIANCE_GAMMA * sigma.rgb + VARIANCE_EPSILON);
+	float t = max(e.r, max(e.g, e.b));
+	if (1.0f < t) history.rgb = m1.rgb + d / t;
+
+	g_uavOut[pos] = lerp(history, center, g_fParams.z);
+}
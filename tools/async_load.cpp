@@ -0,0 +1,540 @@
+//--------------------------------------------------------------------------------------
+// File: async_load.cpp
+//
+// Portable checks of AsyncLoader against a fake device that only accepts
+// creation from the device thread, and the .tmesh load of the sample done
+// synchronously against in the background, e.g.:
+//   g++ -O2 -std=c++11 -pthread -Itpot tools/async_load.cpp tpot/AsyncLoader.cpp tpot/ThreadPool.cpp
+//       tpot/TMeshFile.cpp tpot/MeshOptimizer.cpp tpot/SDKMeshParser.cpp tpot/Lz4.cpp tpot/MappedFile.cpp
+//
+//   async_load selftest [-threads N] [-seed S]
+//       ordering, waits, budgets, fences, failures, cancels, shutdown with work
+//       in flight, a random stress run and the sample meshes loaded for real
+//   async_load bench [-threads N] [-frame_us U] [-budget BYTES] [-iterations N] [file.tmesh ...]
+//       device thread time of a synchronous load against the longest frame
+//       stall and the frames to readiness of the background one, averaged
+//       over the iterations
+//--------------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AsyncLoader.h"
+#include "TMeshFile.h"
+#include "selftest.h"
+
+using namespace tpot;
+
+typedef std::chrono::high_resolution_clock CLOCK;
+
+static double usSince(CLOCK::time_point t0)
+{
+	return std::chrono::duration<double, std::micro>(CLOCK::now() - t0).count();
+}
+
+// Stands in for ID3D11Device: objects may only be made on the thread that
+// created it, and every byte handed over is read once, as an upload would.
+// checksum() is the sum of one hash per object, whatever the order.
+class FakeDevice
+{
+	std::thread::id owner_;
+	std::atomic<unsigned> wrong_thread_;
+	unsigned objects_;
+	unsigned long long bytes_;
+	unsigned long long checksum_;
+
+public:
+	FakeDevice() : owner_(std::this_thread::get_id()), wrong_thread_(0), objects_(0), bytes_(0), checksum_(0){}
+
+	unsigned create(const void *data, size_t bytes)
+	{
+		if (std::this_thread::get_id() != owner_){
+			wrong_thread_++;
+			return 0;
+		}
+		const unsigned char *p = (const unsigned char*)data;
+		unsigned long long h = 14695981039346656037ull;
+		for (size_t i = 0; i < bytes; i++){
+			h ^= p[i];
+			h *= 1099511628211ull;
+		}
+		checksum_ += h;
+		bytes_ += bytes;
+		return ++objects_;
+	}
+
+	unsigned wrongThread() const { return wrong_thread_; }
+	unsigned objects() const { return objects_; }
+	unsigned long long bytes() const { return bytes_; }
+	unsigned long long checksum() const { return checksum_; }
+};
+
+// TMesh of mesh.cpp on the fake device: the file decoded on a worker,
+// buffers made on the device thread, which then queues the textures.
+// Ready once the buffers and every texture are in.
+class FakeTMesh
+{
+	std::shared_ptr<TMeshData> data_;
+	AsyncLoader::JOB job_;
+	std::vector<AsyncLoader::JOB> textures_;
+	unsigned buffers_;
+
+	// as TMesh: files the converter did not optimize are reordered on the loader thread
+	static bool loadData(TMeshData *data, const std::string &path)
+	{
+		if (data->load(path.c_str()) != TMESH_ERROR::NONE) return false;
+		if (!(data->reader().header().flags & TMESH_FLAG::OPTIMIZED)) data->optimize();
+		return true;
+	}
+
+	bool create(FakeDevice &device, AsyncLoader *loader, const std::string &dir)
+	{
+		const TMeshReader &reader = data_->reader();
+		for (unsigned i = 0; i < reader.sections().size(); i++){
+			if (data_->data(i) && device.create(data_->data(i), (size_t)reader.sections()[i].bytes)) buffers_++;
+		}
+		for (unsigned m = 0; m < reader.materials().size(); m++){
+			const char *texture = reader.string(reader.materials()[m].diffuse_texture);
+			if (texture[0] == '\0') continue;
+			auto bytes = std::make_shared<std::vector<unsigned char> >();
+			std::string path = dir + texture;
+			FakeDevice *dev = &device;
+			if (loader){
+				textures_.push_back(loader->submit([bytes, path]{ return readFile(path, bytes.get()); },
+					[bytes, dev]{ return dev->create(bytes->data(), bytes->size()) != 0; }));
+			}else if (!readFile(path, bytes.get()) || !device.create(bytes->data(), bytes->size())){
+				return false;
+			}
+		}
+		data_.reset();	// unmaps the file
+		return true;
+	}
+
+public:
+	FakeTMesh() : job_(0), buffers_(0){}
+
+	bool loadSync(FakeDevice &device, const std::string &path, const std::string &dir)
+	{
+		data_ = std::make_shared<TMeshData>();
+		return loadData(data_.get(), path) && create(device, nullptr, dir);
+	}
+
+	void load(FakeDevice &device, AsyncLoader &loader, const std::string &path, const std::string &dir)
+	{
+		std::shared_ptr<TMeshData> data = std::make_shared<TMeshData>();
+		data_ = data;
+		FakeDevice *dev = &device;
+		AsyncLoader *l = &loader;
+		job_ = loader.submit([data, path]{ return loadData(data.get(), path); },
+			[this, dev, l, dir]{ return create(*dev, l, dir); });
+	}
+
+	bool ready(const AsyncLoader &loader) const
+	{
+		if (loader.state(job_) != LOAD_STATE::READY) return false;
+		for (AsyncLoader::JOB t : textures_){
+			if (!loader.isFinished(t)) return false;
+		}
+		return true;
+	}
+	unsigned buffers() const { return buffers_; }
+	unsigned textures() const { return (unsigned)textures_.size(); }
+};
+
+static std::string dirOf(const std::string &path)
+{
+	size_t slash = path.find_last_of("/\\");
+	return (slash == std::string::npos) ? std::string() : path.substr(0, slash + 1);
+}
+
+struct OPTIONS
+{
+	unsigned threads;
+	unsigned seed;
+	unsigned frame_us;
+	size_t   budget;
+	int      iterations;
+	std::vector<std::string> files;
+};
+
+static CheckReport report;
+
+static void sleepUs(unsigned us)
+{
+	std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+// Loads finish out of order: each create runs once, loaded jobs oldest
+// first, and a slow load holds back nothing behind it
+static void testOrder(const OPTIONS &opt)
+{
+	AsyncLoader loader(opt.threads);
+	FakeDevice device;
+	std::vector<int> created;
+	std::atomic<unsigned> loads_on_device_thread(0);
+	std::thread::id device_thread = std::this_thread::get_id();
+	const int N = 32;
+	std::vector<AsyncLoader::JOB> jobs;
+	for (int i = 0; i < 2 * N; i++){
+		unsigned us = (i < N) ? (N - i) * 50 : 0;
+		jobs.push_back(loader.submit([us, &loads_on_device_thread, device_thread]{
+			if (std::this_thread::get_id() == device_thread) loads_on_device_thread++;
+			sleepUs(us);
+			return true;
+		}, [i, &created, &device]{
+			created.push_back(i);
+			return device.create(&i, sizeof(i)) != 0;
+		}));
+		if (i == N - 1) loader.finish();
+	}
+	for (AsyncLoader::JOB j : jobs){
+		while (!loader.isFinished(j) && loader.state(j) != LOAD_STATE::LOADED) std::this_thread::yield();
+	}
+	loader.pump();
+
+	bool once = (int)created.size() == 2 * N;
+	std::vector<int> seen(2 * N, 0);
+	for (int i : created) once = once && seen[i]++ == 0;
+	bool in_order = once;
+	for (int i = N; in_order && i < 2 * N; i++) in_order = created[i] == i;
+	report("create_once", once && loader.completed() == (AsyncLoader::JOB)(2 * N) && loader.stats().created == (unsigned)(2 * N),
+		"created=" + std::to_string(created.size()) + " completed=" + std::to_string(loader.completed()));
+	report("oldest_first", in_order, "");
+	report("load_off_device_thread", loads_on_device_thread == 0, "on_device_thread=" + std::to_string(loads_on_device_thread));
+	report("create_on_device_thread", device.wrongThread() == 0, "wrong_thread=" + std::to_string(device.wrongThread()));
+
+	// the slow load holds a worker, the fast one needs another
+	AsyncLoader two(2);
+	std::atomic<bool> release(false);
+	AsyncLoader::JOB slow = two.submit([&release]{ while (!release) std::this_thread::yield(); return true; }, nullptr);
+	AsyncLoader::JOB fast = two.submit([]{ return true; }, nullptr);
+	two.finish(fast);
+	bool overtaken = two.state(slow) == LOAD_STATE::LOADING && two.completed() < slow;
+	release = true;
+	two.finish();
+	report("no_head_of_line_blocking", overtaken && two.state(fast) == LOAD_STATE::READY && two.completed() == fast, "");
+}
+
+// A job waits for earlier ones, failed or not; a failed load skips its create
+static void testWaits(const OPTIONS &opt)
+{
+	AsyncLoader loader(opt.threads);
+	std::vector<std::string> created;
+	AsyncLoader::JOB texture = loader.submit([]{ sleepUs(2000); return true; }, [&]{ created.push_back("texture"); return true; });
+	AsyncLoader::JOB broken = loader.submit([]{ return false; }, [&]{ created.push_back("broken"); return true; });
+	AsyncLoader::JOB mesh = loader.submit([]{ return true; }, [&]{ created.push_back("mesh"); return true; }, 0, { texture, broken });
+	AsyncLoader::JOB future = loader.submit(nullptr, [&]{ created.push_back("later"); return true; }, 0, { 99 });
+
+	// the mesh loads first but may not be created before the texture
+	unsigned early = 0;
+	while (!loader.isFinished(texture)){
+		loader.pump();
+		if (loader.state(mesh) == LOAD_STATE::READY && !loader.isFinished(texture)) early++;
+	}
+	loader.finish();
+
+	std::string order;
+	for (auto &s : created) order += s + " ";
+	bool texture_first = false;
+	for (auto &s : created){
+		if (s == "texture") texture_first = true;
+		if (s == "mesh") break;
+	}
+	report("waits", early == 0 && created.size() == 3 && texture_first
+		&& loader.state(broken) == LOAD_STATE::FAILED && loader.state(mesh) == LOAD_STATE::READY, order);
+	report("wait_on_later_job_ignored", loader.state(future) == LOAD_STATE::READY, "");
+}
+
+// pump() stops at the budget but always makes progress
+static void testBudget(const OPTIONS &opt)
+{
+	AsyncLoader loader(opt.threads);
+	const int N = 10;
+	std::vector<AsyncLoader::JOB> jobs;
+	for (int i = 0; i < N; i++) jobs.push_back(loader.submit([]{ return true; }, []{ return true; }, 400));
+	AsyncLoader::JOB huge = loader.submit([]{ return true; }, []{ return true; }, 5000);
+	jobs.push_back(huge);
+	for (AsyncLoader::JOB j : jobs){
+		while (loader.state(j) != LOAD_STATE::LOADED) std::this_thread::yield();
+	}
+
+	std::vector<unsigned> per_pump;
+	while (loader.completed() < loader.submitted()) per_pump.push_back(loader.pump(1000));
+
+	std::string detail;
+	for (unsigned n : per_pump) detail += std::to_string(n) + " ";
+	report("budget", per_pump.size() == 6 && per_pump[0] == 2 && per_pump[5] == 1 && loader.stats().max_pump_cost == 5000, detail);
+}
+
+// Fences: completed() never passes an unfinished job and ends at submitted()
+static void testFences(const OPTIONS &opt)
+{
+	AsyncLoader loader(opt.threads);
+	std::mt19937 rng(opt.seed);
+	const int N = 200;
+	for (int i = 0; i < N; i++){
+		unsigned us = rng() % 200;
+		loader.submit([us]{ sleepUs(us); return true; }, []{ return true; });
+	}
+
+	unsigned violations = 0, backwards = 0;
+	AsyncLoader::JOB last = 0;
+	while (loader.completed() < loader.submitted()){
+		loader.pump(1);
+		AsyncLoader::JOB fence = loader.completed();
+		if (fence < last) backwards++;
+		for (AsyncLoader::JOB j = 1; j <= fence; j++){
+			if (!loader.isFinished(j)) violations++;
+		}
+		last = fence;
+	}
+	report("fences", violations == 0 && backwards == 0 && loader.completed() == (AsyncLoader::JOB)N,
+		"violations=" + std::to_string(violations) + " backwards=" + std::to_string(backwards));
+}
+
+static void testCancel(const OPTIONS &opt)
+{
+	AsyncLoader loader(opt.threads);
+	std::atomic<bool> release(false);
+	unsigned creates = 0;
+	AsyncLoader::JOB loading = loader.submit([&]{ while (!release) std::this_thread::yield(); return true; }, [&]{ creates++; return true; });
+	AsyncLoader::JOB loaded = loader.submit(nullptr, [&]{ creates++; return true; });
+	AsyncLoader::JOB failing = loader.submit(nullptr, []{ return false; });
+	AsyncLoader::JOB self = 0;
+	self = loader.submit(nullptr, [&]{ loader.cancel(self); creates++; return true; });
+
+	while (loader.state(loading) != LOAD_STATE::LOADING) std::this_thread::yield();
+	loader.cancel(loading);
+	loader.cancel(loaded);
+	release = true;
+	loader.finish();
+
+	report("cancel", creates == 1 && loader.state(loading) == LOAD_STATE::CANCELLED && loader.state(loaded) == LOAD_STATE::CANCELLED
+		&& loader.state(self) == LOAD_STATE::CANCELLED && loader.completed() == loader.submitted(),
+		"creates=" + std::to_string(creates));
+	report("create_failure", loader.state(failing) == LOAD_STATE::FAILED, "");
+}
+
+// Destroyed with loads queued and running: no create() runs, nothing leaks
+static void testShutdown(const OPTIONS &opt)
+{
+	std::atomic<unsigned> loads(0);
+	unsigned creates = 0;
+	{
+		AsyncLoader loader(opt.threads);
+		for (int i = 0; i < 100; i++){
+			auto payload = std::make_shared<std::vector<unsigned char> >(1024);
+			loader.submit([&loads, payload]{ sleepUs(100); loads++; return true; }, [&creates, payload]{ creates++; return true; });
+		}
+		sleepUs(300);
+	}
+	report("shutdown_in_flight", creates == 0 && loads < 100, "loads_run=" + std::to_string(loads));
+}
+
+// Random jobs, waits, failures, cancels and budgets; every invariant after each pump
+static void testStress(const OPTIONS &opt)
+{
+	AsyncLoader loader(opt.threads);
+	FakeDevice device;
+	std::mt19937 rng(opt.seed + 1);
+	const int N = 2000;
+
+	struct RECORD
+	{
+		std::atomic<int> loads;
+		int creates;
+		bool load_ok;
+		bool create_ok;
+		std::vector<AsyncLoader::JOB> after;
+		bool waits_done;	// when create() ran
+	};
+	std::vector<std::unique_ptr<RECORD> > records(N + 1);
+	unsigned bad = 0;
+
+	for (int i = 1; i <= N; i++){
+		records[i].reset(new RECORD());
+		RECORD *r = records[i].get();
+		r->loads = 0;
+		r->creates = 0;
+		r->load_ok = rng() % 10 != 0;
+		r->create_ok = rng() % 20 != 0;
+		r->waits_done = false;
+		for (unsigned k = rng() % 4; k; k--){
+			if (1 < i) r->after.push_back(1 + rng() % (i - 1));
+		}
+		unsigned us = rng() % 50;
+		AsyncLoader *l = &loader;
+		FakeDevice *dev = &device;
+		AsyncLoader::JOB job = loader.submit([r, us]{ r->loads++; sleepUs(us); return r->load_ok; }, [r, l, dev, i]{
+			r->creates++;
+			r->waits_done = true;
+			for (AsyncLoader::JOB a : r->after) r->waits_done = r->waits_done && l->isFinished(a);
+			return dev->create(&i, sizeof(i)) != 0 && r->create_ok;
+		}, rng() % 4096, r->after);
+		if (job != (AsyncLoader::JOB)i) bad++;
+
+		if (rng() % 25 == 0) loader.cancel(1 + rng() % i);
+		if (rng() % 8 == 0) loader.pump(rng() % 8192);
+	}
+	loader.finish();
+
+	unsigned created = 0, cancelled = 0;
+	for (int i = 1; i <= N; i++){
+		RECORD &r = *records[i];
+		LOAD_STATE::ID s = loader.state(i);
+		if (1 < r.loads || 1 < r.creates || (r.creates && (!r.load_ok || !r.waits_done))) bad++;
+		if (s == LOAD_STATE::READY && !(r.creates == 1 && r.create_ok)) bad++;
+		if (s == LOAD_STATE::FAILED && !(!r.load_ok || !r.create_ok)) bad++;
+		if (s != LOAD_STATE::READY && s != LOAD_STATE::FAILED && s != LOAD_STATE::CANCELLED) bad++;
+		created += r.creates;
+		cancelled += s == LOAD_STATE::CANCELLED;
+	}
+	report("stress", bad == 0 && device.wrongThread() == 0 && loader.completed() == (AsyncLoader::JOB)N,
+		"jobs=" + std::to_string(N) + " created=" + std::to_string(created) + " cancelled=" + std::to_string(cancelled)
+		+ " bad=" + std::to_string(bad));
+}
+
+// The sample meshes through the loader match a synchronous load byte for byte
+static void testMeshes(const OPTIONS &opt)
+{
+	FakeDevice sync_device;
+	unsigned sync_buffers = 0, sync_ok = 0;
+	for (const std::string &f : opt.files){
+		FakeTMesh mesh;
+		sync_ok += mesh.loadSync(sync_device, f, dirOf(f));
+		sync_buffers += mesh.buffers();
+	}
+
+	AsyncLoader loader(opt.threads);
+	FakeDevice device;
+	std::vector<std::unique_ptr<FakeTMesh> > meshes;
+	for (const std::string &f : opt.files){
+		meshes.push_back(std::unique_ptr<FakeTMesh>(new FakeTMesh()));
+		meshes.back()->load(device, loader, f, dirOf(f));
+	}
+	unsigned not_ready_early = 0;
+	for (auto &m : meshes) not_ready_early += !m->ready(loader);
+
+	loader.finish();
+	unsigned ready = 0, buffers = 0, textures = 0;
+	for (auto &m : meshes){
+		ready += m->ready(loader);
+		buffers += m->buffers();
+		textures += m->textures();
+	}
+	char detail[160];
+	snprintf(detail, sizeof(detail), "meshes=%u buffers=%u textures=%u bytes=%llu", ready, buffers, textures, device.bytes());
+	report("meshes", sync_ok == opt.files.size() && ready == opt.files.size() && not_ready_early == opt.files.size()
+		&& buffers == sync_buffers && device.checksum() == sync_device.checksum() && device.wrongThread() == 0, detail);
+
+	// a missing file fails its job, it does not hang
+	FakeTMesh missing;
+	missing.load(device, loader, "Media/missing.tmesh", "Media/");
+	loader.finish();
+	report("missing_mesh", !missing.ready(loader) && loader.completed() == loader.submitted(), "");
+}
+
+static int selftest(const OPTIONS &opt)
+{
+	printf("check,result,detail\n");
+	testOrder(opt);
+	testWaits(opt);
+	testBudget(opt);
+	testFences(opt);
+	testCancel(opt);
+	testShutdown(opt);
+	testStress(opt);
+	testMeshes(opt);
+	return report.ok() ? 0 : 1;
+}
+
+// Frames of frame_us each until every mesh is ready, the device thread
+// pumping once a frame, against the whole load done on the device thread
+static int bench(const OPTIONS &opt)
+{
+	printf("mode,threads,budget,frames,device_thread_us,worst_frame_us,until_ready_us\n");
+	double sync_total = 0;
+	for (int it = 0; it < opt.iterations; it++){
+		FakeDevice device;
+		CLOCK::time_point t0 = CLOCK::now();
+		for (const std::string &f : opt.files){
+			FakeTMesh mesh;
+			if (!mesh.loadSync(device, f, dirOf(f))) return 1;
+		}
+		sync_total += usSince(t0);
+	}
+	double sync_us = sync_total / opt.iterations;
+	printf("sync,0,0,1,%.1f,%.1f,%.1f\n", sync_us, sync_us, sync_us);
+
+	double device_total = 0, worst_total = 0, ready_total = 0;
+	unsigned frames_total = 0;
+	for (int it = 0; it < opt.iterations; it++){
+		AsyncLoader loader(opt.threads);
+		FakeDevice device;
+		std::vector<std::unique_ptr<FakeTMesh> > meshes;
+		CLOCK::time_point t0 = CLOCK::now();
+		for (const std::string &f : opt.files){
+			meshes.push_back(std::unique_ptr<FakeTMesh>(new FakeTMesh()));
+			meshes.back()->load(device, loader, f, dirOf(f));
+		}
+		double device_us = usSince(t0);
+		double worst = device_us;
+
+		for (;;){
+			bool all = true;
+			for (auto &m : meshes) all = all && m->ready(loader);
+			if (all || loader.completed() == loader.submitted()) break;
+			sleepUs(opt.frame_us);	// the rest of the frame
+			CLOCK::time_point p = CLOCK::now();
+			loader.pump(opt.budget);
+			double us = usSince(p);
+			device_us += us;
+			if (worst < us) worst = us;
+			frames_total++;
+		}
+		ready_total += usSince(t0);
+		device_total += device_us;
+		worst_total += worst;
+	}
+	printf("async,%u,%u,%.1f,%.1f,%.1f,%.1f\n", opt.threads, (unsigned)opt.budget, (double)frames_total / opt.iterations,
+		device_total / opt.iterations, worst_total / opt.iterations, ready_total / opt.iterations);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	std::string cmd = (1 < argc) ? argv[1] : "";
+	OPTIONS opt;
+	opt.threads = 2;
+	opt.seed = 1;
+	opt.frame_us = 1000;
+	opt.budget = 256 * 1024;
+	opt.iterations = 200;
+	for (int i = 2; i < argc; i++){
+		std::string a = argv[i];
+		bool value = i + 1 < argc;
+		if (a == "-threads" && value) opt.threads = atoi(argv[++i]);
+		else if (a == "-seed" && value) opt.seed = atoi(argv[++i]);
+		else if (a == "-frame_us" && value) opt.frame_us = atoi(argv[++i]);
+		else if (a == "-budget" && value) opt.budget = atoi(argv[++i]);
+		else if (a == "-iterations" && value) opt.iterations = atoi(argv[++i]);
+		else opt.files.push_back(a);
+	}
+	if (opt.iterations < 1) opt.iterations = 1;
+	if (opt.files.empty()){
+		opt.files.push_back("Media/ColumnScene/scene.tmesh");
+		opt.files.push_back("Media/ColumnScene/Poles.tmesh");
+	}
+
+	if (cmd == "selftest") return selftest(opt);
+	if (cmd == "bench") return bench(opt);
+
+	fprintf(stderr, "usage: async_load selftest|bench ...\n");
+	return 1;
+}
@@ -0,0 +1,313 @@
+//--------------------------------------------------------------------------------------
+// File: dynres.cpp
+//
+// Drives the DynamicResolution controller with synthetic or recorded frame
+// timings, without Windows or a GPU, e.g.:
+//   g++ -O2 -std=c++11 -Itpot tools/dynres.cpp tpot/DynamicResolution.cpp
+//
+//   dynres selftest                  bounds, hysteresis, cooldown, CPU bound and replay checks
+//   dynres replay [options] trace.csv
+//                                    feeds a recorded trace, one "cpu_ms,gpu_ms" line per
+//                                    frame (gpu_ms < 0: none), and prints the scale per frame
+//   dynres sim [options]             closed loop on a GPU cost model whose load steps every
+//                                    quarter; one CSV line for the controller and one for a
+//                                    fixed scale of 100, or per frame with -frames_csv
+//
+// options:
+//   -target MS       frame time to hold (default 16.667)
+//   -min N, -max N   scale bounds in percent (default 50, 100)
+//   -step N          scale granularity in percent (default 5)
+//   -smoothing F     weight of a new timing (default 0.1)
+//   -cooldown N      frames a change holds (default 8)
+// sim only:
+//   -frames N        (default 2000)
+//   -fixed MS        GPU time that does not scale with the pixels (default 2)
+//   -pixel MS        GPU time of the pixels at a scale of 100 (default 18)
+//   -cpu MS          CPU time per frame (default 6)
+//   -noise F         +- relative noise of both timings (default 0.05)
+//   -latency N       frames until a GPU timing comes back (default 3)
+//   -frames_csv      one line per frame instead of the summary
+//--------------------------------------------------------------------------------------
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include <vector>
+#include "DynamicResolution.h"
+#include "selftest.h"
+
+using namespace tpot;
+
+struct TIMING
+{
+	float cpu_ms;
+	float gpu_ms;
+};
+
+struct SIM
+{
+	unsigned frames = 2000;
+	float fixed_ms = 2.0f;
+	float pixel_ms = 18.0f;
+	float cpu_ms = 6.0f;
+	float noise = 0.05f;
+	unsigned latency = 3;
+	bool frames_csv = false;
+};
+
+// Deterministic noise in [-1, 1)
+struct NOISE
+{
+	unsigned state = 12345u;
+	float next(){
+		state = state * 1664525u + 1013904223u;
+		return (float)(state >> 8) * (2.0f / 16777216.0f) - 1.0f;
+	}
+};
+
+// Load of the pixels per quarter of the run
+static float loadAt(unsigned frame, unsigned frames)
+{
+	static const float LOAD[] = { 0.6f, 1.0f, 1.5f, 0.8f };
+	return LOAD[(4 * frame / (frames ? frames : 1)) & 3];
+}
+
+struct SIM_RESULT
+{
+	unsigned over;		// frames whose GPU time missed the target
+	double   scale_sum;
+	double   gpu_sum;
+	unsigned changes;
+};
+
+// GPU time = fixed + pixel * load * (scale / 100)^2, timings come back latency frames late.
+// dynamic == false keeps the scale at 100.
+static SIM_RESULT simulate(const SIM &opt, const DYNAMIC_RESOLUTION_PARAM &param, bool dynamic, bool print)
+{
+	DynamicResolution controller(param);
+	NOISE noise;
+	std::deque<float> in_flight;
+	SIM_RESULT r = {};
+	unsigned scale = dynamic ? controller.scale() : 100;
+
+	for (unsigned f = 0; f < opt.frames; f++){
+		float area = 0.0001f * (float)(scale * scale);
+		float gpu = (opt.fixed_ms + opt.pixel_ms * loadAt(f, opt.frames) * area) * (1.0f + opt.noise * noise.next());
+		float cpu = opt.cpu_ms * (1.0f + opt.noise * noise.next());
+		if (param.target_ms < gpu) r.over++;
+		r.scale_sum += scale;
+		r.gpu_sum += gpu;
+
+		in_flight.push_back(gpu);
+		float measured = -1.0f;
+		if (opt.latency < in_flight.size()){
+			measured = in_flight.front();
+			in_flight.pop_front();
+		}
+		if (print) printf("%u,%.3f,%.3f,%.3f,%u\n", f, cpu, gpu, controller.gpuTime(), scale);
+		if (dynamic) scale = controller.update(cpu, measured);
+	}
+	r.changes = controller.changes();
+	return r;
+}
+
+static bool readTrace(const char *path, std::vector<TIMING> *trace)
+{
+	FILE *fp = fopen(path, "r");
+	if (!fp) return false;
+	char line[256];
+	while (fgets(line, sizeof(line), fp)){
+		TIMING t;
+		if (sscanf(line, "%f,%f", &t.cpu_ms, &t.gpu_ms) == 2) trace->push_back(t); // the header does not parse
+	}
+	fclose(fp);
+	return true;
+}
+
+static int selftest()
+{
+	const float T = 1000.0f / 60.0f;
+	DYNAMIC_RESOLUTION_PARAM param = MakeDynamicResolutionParam(T);
+	EXPECT(param.grow_below < param.aim && param.aim < param.shrink_above);
+
+	// starts at the top, holds within the band
+	DynamicResolution d(param);
+	EXPECT(d.scale() == param.max_scale);
+	for (int i = 0; i < 500; i++){
+		d.update(5.0f, T * (0.82f + 0.16f * (float)(i % 7) / 6.0f));
+	}
+	EXPECT(d.scale() == param.max_scale && d.changes() == 0);
+
+	// over budget: shrinks once the average is over, by the square root of the ratio
+	d.reset(100);
+	for (int i = 0; i < 20; i++) d.update(5.0f, 0.85f * T);
+	unsigned frames = 0;
+	while (d.update(5.0f, 1.3f * T) == 100 && frames < 100) frames++;
+	EXPECT(2 < frames && frames < 10);	// averaged, not the first frame
+	EXPECT(d.scale() <= 95 && 85 <= d.scale() && d.scale() % param.step == 0);
+	EXPECT(d.gpuTime() < T);	// the average moved with the scale
+
+	// the cooldown holds whatever comes in
+	unsigned s = d.scale();
+	for (unsigned i = 0; i < param.cooldown; i++) EXPECT(d.update(5.0f, 10.0f * T) == s);
+	EXPECT(d.update(5.0f, 2.0f * T) == s);	// averaging again, one spike is not enough
+	for (int i = 0; i < 100; i++) d.update(5.0f, 10.0f * T);
+	EXPECT(d.scale() == param.min_scale);	// bounded
+
+	// under budget: grows, up to the bound
+	for (int i = 0; i < 500; i++) d.update(5.0f, 0.2f * T);
+	EXPECT(d.scale() == param.max_scale);
+
+	// CPU bound: fewer pixels would not help
+	d.reset(100);
+	for (int i = 0; i < 500; i++) d.update(2.0f * T, 0.9f * T);
+	EXPECT(d.scale() == 100 && d.cpuBound());
+
+	// without GPU timings the CPU one decides
+	d.reset(100);
+	for (int i = 0; i < 500; i++) d.update(2.0f * T, -1.0f);
+	EXPECT(d.scale() < 100 && !d.cpuBound());
+
+	// nothing measured is ignored
+	d.reset(80);
+	for (int i = 0; i < 50; i++) d.update(NAN, NAN);
+	EXPECT(d.scale() == 80 && d.cpuTime() < 0.0f && d.gpuTime() < 0.0f);
+
+	// bounds and step of reset() / setParam()
+	d.reset(37);
+	EXPECT(d.scale() == param.min_scale);
+	d.reset(99);
+	EXPECT(d.scale() == 95);
+	DYNAMIC_RESOLUTION_PARAM narrow = param;
+	narrow.max_scale = 75;
+	d.setParam(narrow);
+	EXPECT(d.scale() == 75);
+
+	// closed loop on the cost model: settles within the band and stays there
+	SIM sim;
+	sim.frames = 4000;
+	sim.noise = 0.0f;
+	sim.pixel_ms = 30.0f;	// 100: twice the target
+	{
+		DynamicResolution c(param);
+		std::deque<float> in_flight;
+		unsigned scale = c.scale(), settled_changes = 0;
+		for (unsigned f = 0; f < sim.frames; f++){
+			float gpu = sim.fixed_ms + sim.pixel_ms * 0.0001f * (float)(scale * scale);
+			in_flight.push_back(gpu);
+			float measured = (sim.latency < in_flight.size()) ? in_flight.front() : -1.0f;
+			if (sim.latency < in_flight.size()) in_flight.pop_front();
+			unsigned next = c.update(sim.cpu_ms, measured);
+			if (sim.frames / 2 <= f && next != scale) settled_changes++;
+			scale = next;
+		}
+		float gpu = sim.fixed_ms + sim.pixel_ms * 0.0001f * (float)(scale * scale);
+		EXPECT(settled_changes == 0);
+		EXPECT(gpu <= param.shrink_above * T);
+		EXPECT(param.grow_below * T <= gpu || scale + param.step > param.max_scale);
+	}
+
+	// a trace gives the same scales every time
+	{
+		std::vector<TIMING> trace;
+		NOISE n;
+		for (int i = 0; i < 3000; i++){
+			float load = (i / 500) % 2 ? 1.4f : 0.7f;
+			TIMING t = { 6.0f * (1.0f + 0.3f * n.next()), T * load * (1.0f + 0.3f * n.next()) };
+			trace.push_back(t);
+		}
+		DynamicResolution a(param), b(param);
+		std::vector<unsigned> sa;
+		for (auto &t : trace) sa.push_back(a.update(t.cpu_ms, t.gpu_ms));
+		for (size_t i = 0; i < trace.size(); i++) EXPECT(b.update(trace[i].cpu_ms, trace[i].gpu_ms) == sa[i]);
+		EXPECT(0 < a.changes());
+	}
+
+	printf("selftest ok\n");
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc == 2 && strcmp(argv[1], "selftest") == 0) return selftest();
+
+	bool replay = (2 <= argc && strcmp(argv[1], "replay") == 0);
+	bool sim = (2 <= argc && strcmp(argv[1], "sim") == 0);
+	DYNAMIC_RESOLUTION_PARAM param = MakeDynamicResolutionParam(1000.0f / 60.0f);
+	SIM opt;
+	const char *path = nullptr;
+	bool ok = replay || sim;
+	for (int i = 2; i < argc && ok; i++){
+		const char *a = argv[i];
+		bool has_value = (i + 1 < argc);
+		if (strcmp(a, "-target") == 0 && has_value){
+			param.target_ms = (float)atof(argv[++i]);
+		}else if (strcmp(a, "-min") == 0 && has_value){
+			param.min_scale = (unsigned)atoi(argv[++i]);
+		}else if (strcmp(a, "-max") == 0 && has_value){
+			param.max_scale = (unsigned)atoi(argv[++i]);
+		}else if (strcmp(a, "-step") == 0 && has_value){
+			param.step = (unsigned)atoi(argv[++i]);
+		}else if (strcmp(a, "-smoothing") == 0 && has_value){
+			param.smoothing = (float)atof(argv[++i]);
+		}else if (strcmp(a, "-cooldown") == 0 && has_value){
+			param.cooldown = (unsigned)atoi(argv[++i]);
+		}else if (sim && strcmp(a, "-frames") == 0 && has_value){
+			opt.frames = (unsigned)atoi(argv[++i]);
+		}else if (sim && strcmp(a, "-fixed") == 0 && has_value){
+			opt.fixed_ms = (float)atof(argv[++i]);
+		}else if (sim && strcmp(a, "-pixel") == 0 && has_value){
+			opt.pixel_ms = (float)atof(argv[++i]);
+		}else if (sim && strcmp(a, "-cpu") == 0 && has_value){
+			opt.cpu_ms = (float)atof(argv[++i]);
+		}else if (sim && strcmp(a, "-noise") == 0 && has_value){
+			opt.noise = (float)atof(argv[++i]);
+		}else if (sim && strcmp(a, "-latency") == 0 && has_value){
+			opt.latency = (unsigned)atoi(argv[++i]);
+		}else if (sim && strcmp(a, "-frames_csv") == 0){
+			opt.frames_csv = true;
+		}else if (replay && !path && a[0] != '-'){
+			path = a;
+		}else{
+			ok = false;
+		}
+	}
+	ok = ok && 0.0f < param.target_ms && 0.0f < param.smoothing && param.smoothing <= 1.0f
+		&& param.min_scale <= param.max_scale && 0 < param.max_scale;
+
+	if (ok && replay && path){
+		std::vector<TIMING> trace;
+		if (!readTrace(path, &trace)){
+			fprintf(stderr, "%s: cannot read\n", path);
+			return 1;
+		}
+		DynamicResolution controller(param);
+		printf("frame,cpu_ms,gpu_ms,avg_cpu_ms,avg_gpu_ms,scale\n");
+		for (size_t f = 0; f < trace.size(); f++){
+			unsigned scale = controller.update(trace[f].cpu_ms, trace[f].gpu_ms);
+			printf("%u,%.3f,%.3f,%.3f,%.3f,%u\n", (unsigned)f, trace[f].cpu_ms, trace[f].gpu_ms,
+				controller.cpuTime(), controller.gpuTime(), scale);
+		}
+		return 0;
+	}
+
+	if (ok && sim){
+		if (opt.frames_csv){
+			printf("frame,cpu_ms,gpu_ms,avg_gpu_ms,scale\n");
+			simulate(opt, param, true, true);
+			return 0;
+		}
+		printf("controller,over_budget_pct,mean_scale,mean_gpu_ms,changes\n");
+		for (int dynamic = 1; 0 <= dynamic; dynamic--){
+			SIM_RESULT r = simulate(opt, param, dynamic != 0, false);
+			double n = opt.frames ? (double)opt.frames : 1.0;
+			printf("%s,%.1f,%.1f,%.2f,%u\n", dynamic ? "dynamic" : "fixed_100",
+				100.0 * r.over / n, r.scale_sum / n, r.gpu_sum / n, r.changes);
+		}
+		return 0;
+	}
+
+	fprintf(stderr, "usage: dynres selftest | replay [options] trace.csv | sim [options]\n");
+	return 2;
+}
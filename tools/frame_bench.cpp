@@ -0,0 +1,586 @@
+//--------------------------------------------------------------------------------------
+// File: frame_bench.cpp
+//
+// CPU cost of building OnD3D11FrameRender's frame: tpot::TaaFrame on a
+// Renderer over RecordingDevice, so no Windows or GPU is needed, e.g.:
+//   g++ -O2 -std=c++11 -pthread -Itpot tools/frame_bench.cpp tpot/TaaFrame.cpp tpot/renderer.cpp
+//       tpot/RecordingDevice.cpp tpot/UploadRing.cpp tpot/RenderTargetPool.cpp tpot/RenderTargetFormat.cpp
+//       tpot/JitterSequence.cpp tpot/Matrix.cpp tpot/TaaHistory.cpp tpot/ThreadPool.cpp tpot/TaaPresent.cpp
+//       tpot/TaaVariance.cpp tpot/simd.cpp tpot/TaaDisocclusion.cpp
+//
+//   frame_bench [options]          one CSV line per mode
+//   frame_bench -dump [options]    the command stream of one frame per mode
+//   frame_bench -verify [options]  checks that the state cache leaves the
+//                                  state seen by every draw unchanged, and
+//                                  that a mesh finishing loading resets the
+//                                  tile mask of the taa mode, and that a
+//                                  shrunk history moving to a new surface
+//                                  or a new history encoding restarts it
+//
+// options:
+//   -mode off|taa|cammove|checkerboard|all  (default all)
+//   -size WxH                  back buffer (default 1920x1080)
+//   -scale N                   g_iRenderScale in percent, taa mode only (default 100)
+//   -blend N                   g_iBlendWeight (default 8)
+//   -blur N                    g_iBlurSize (default 2)
+//   -jitter TYPE               halton|grid|r2|sobol|bluenoise (default halton)
+//   -frames N                  timed frames per mode (default 100000)
+//   -nocache                   Renderer::setStateCache(false)
+//   -ring BYTES                constant data upload ring (default 65536)
+//   -format FORMAT             rt_color and rt_taa: rgba32f|rgba16f|r11g11b10f|rgb10a2|rgba8|rgba8_srgb
+//                              (default rgba16f), rt_mb is every render target texture
+//   -history rgb|ycocg64|ycocg32  rt_taa encoding of the taa mode (default rgb)
+//   -tileskip                  TAA_FRAME_PARAM::tile_skip, adds the mask pass
+//   -fused                     TAA_FRAME_PARAM::fused_present, the taa resolve draws the back buffer
+//   -clamp chroma|variance     TAA_FRAME_PARAM::clamp, variance resolves with a dispatch (default chroma)
+//   -depthreject               TAA_FRAME_PARAM::depth_reject, cammove and checkerboard read last frame's depth too
+//   -tonemap none|reinhard     of the back buffer (default none)
+//   -dither                    8 bit dither of the back buffer
+//   -drag PIXELS               the window is dragged back and forth by up to PIXELS
+//                              every frame, rt_* count the render target surfaces
+//--------------------------------------------------------------------------------------
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <map>
+#include <vector>
+#include "renderer.h"
+#include "RecordingDevice.h"
+#include "TaaFrame.h"
+
+using namespace tpot;
+
+struct OPTIONS
+{
+	int mode = -1;	// all
+	unsigned width = 1920;
+	unsigned height = 1080;
+	unsigned scale = 100;
+	unsigned blend = 8;
+	unsigned blur = 2;
+	JITTER::TYPE jitter = JITTER::HALTON;
+	int frames = 100000;
+	unsigned ring = RecordingDevice::RING_SIZE;
+	unsigned drag = 0;
+	RENDER_TARGET::FORMAT format = RENDER_TARGET::RGBA16F;
+	TAA_HISTORY::ID history = TAA_HISTORY::RGB;
+	bool tile_skip = false;
+	bool fused = false;
+	TAA_CLAMP::ID clamp = TAA_CLAMP::CHROMA;
+	bool depth_reject = false;
+	TONEMAP::ID tonemap = TONEMAP::NONE;
+	bool dither = false;
+	bool dump = false;
+	bool verify = false;
+	bool cache = true;
+};
+
+static const char *MODE_NAME[TAA_MODE::MAX] = { "off", "taa", "cammove", "checkerboard" };
+
+static bool parseOptions(int argc, char *argv[], OPTIONS &opt)
+{
+	for (int i = 0; i < argc; i++){
+		const char *a = argv[i];
+		bool has_value = i + 1 < argc;
+		if (strcmp(a, "-mode") == 0 && has_value){
+			const char *m = argv[++i];
+			opt.mode = -2;
+			for (int j = 0; j < TAA_MODE::MAX; j++){
+				if (strcmp(m, MODE_NAME[j]) == 0) opt.mode = j;
+			}
+			if (strcmp(m, "all") == 0) opt.mode = -1;
+			if (opt.mode == -2) return false;
+		}else if (strcmp(a, "-size") == 0 && has_value){
+			if (sscanf(argv[++i], "%ux%u", &opt.width, &opt.height) != 2) return false;
+		}else if (strcmp(a, "-scale") == 0 && has_value){
+			opt.scale = (unsigned)atoi(argv[++i]);
+		}else if (strcmp(a, "-blend") == 0 && has_value){
+			opt.blend = (unsigned)atoi(argv[++i]);
+		}else if (strcmp(a, "-blur") == 0 && has_value){
+			opt.blur = (unsigned)atoi(argv[++i]);
+		}else if (strcmp(a, "-jitter") == 0 && has_value){
+			if (!JITTER::parse(argv[++i], &opt.jitter)) return false;
+		}else if (strcmp(a, "-frames") == 0 && has_value){
+			opt.frames = atoi(argv[++i]);
+		}else if (strcmp(a, "-ring") == 0 && has_value){
+			opt.ring = (unsigned)atoi(argv[++i]);
+		}else if (strcmp(a, "-format") == 0 && has_value){
+			if (!RENDER_TARGET::parse(argv[++i], &opt.format) || RENDER_TARGET::isDepth(opt.format)) return false;
+		}else if (strcmp(a, "-history") == 0 && has_value){
+			if (!TAA_HISTORY::parse(argv[++i], &opt.history)) return false;
+		}else if (strcmp(a, "-tileskip") == 0){
+			opt.tile_skip = true;
+		}else if (strcmp(a, "-fused") == 0){
+			opt.fused = true;
+		}else if (strcmp(a, "-clamp") == 0 && has_value){
+			if (!TAA_CLAMP::parse(argv[++i], &opt.clamp)) return false;
+		}else if (strcmp(a, "-depthreject") == 0){
+			opt.depth_reject = true;
+		}else if (strcmp(a, "-tonemap") == 0 && has_value){
+			if (!TONEMAP::parse(argv[++i], &opt.tonemap)) return false;
+		}else if (strcmp(a, "-dither") == 0){
+			opt.dither = true;
+		}else if (strcmp(a, "-drag") == 0 && has_value){
+			opt.drag = (unsigned)atoi(argv[++i]);
+		}else if (strcmp(a, "-dump") == 0){
+			opt.dump = true;
+		}else if (strcmp(a, "-verify") == 0){
+			opt.verify = true;
+		}else if (strcmp(a, "-nocache") == 0){
+			opt.cache = false;
+		}else{
+			return false;
+		}
+	}
+	return 0 < opt.frames && 0 < opt.width && 0 < opt.height && 0 < opt.scale && 0 < opt.blend;
+}
+
+// Resources as OnD3D11CreateDevice makes them
+static TAA_FRAME_RESOURCES createResources(Renderer &renderer, const OPTIONS &opt)
+{
+	TAA_FRAME_RESOURCES res;
+
+	renderer.createMesh(MESH_TYPE_EMBEDDED, nullptr);
+	res.scene_mesh = renderer.createMesh(MESH_TYPE_TMESH, (void*)L"ColumnScene\\scene.tmesh");
+	res.pole_mesh = renderer.createMesh(MESH_TYPE_TMESH, (void*)L"ColumnScene\\Poles.tmesh");
+
+	VTX_DECAL quad_vertex[] = {
+		{ { 0, 0, 0 }, { 0, 0 } },
+		{ { 1, 0, 0 }, { 1, 0 } },
+		{ { 0, 1, 0 }, { 0, 1 } },
+		{ { 1, 1, 0 }, { 1, 1 } },
+	};
+	WORD quad_index[] = { 0, 1, 2, 1, 3, 2 };
+	VERTEX_LIST_MESH_PARAM quad_param = {
+		VS::DECAL,
+		quad_vertex, sizeof(quad_vertex) / sizeof(quad_vertex[0]),
+		quad_index, sizeof(quad_index) / sizeof(quad_index[0]),
+	};
+	res.quad_mesh = renderer.createMesh(MESH_TYPE_TRIANGLELIST, &quad_param);
+
+	res.rt_color = renderer.create(RENDER_TARGET::HDR_SCREEN, opt.width, opt.height, 1.0f, opt.format);
+	res.rt_depth[0] = renderer.create(RENDER_TARGET::DEPTH, opt.width, opt.height);
+	res.rt_depth[1] = renderer.create(RENDER_TARGET::DEPTH, opt.width, opt.height);
+	res.rt_taa[0] = renderer.create(RENDER_TARGET::HDR_SCREEN, opt.width, opt.height, 1.0f, opt.format);
+	res.rt_taa[1] = renderer.create(RENDER_TARGET::HDR_SCREEN, opt.width, opt.height, 1.0f, opt.format);
+	res.rt_tile[0] = renderer.create(RENDER_TARGET::HDR_SCREEN, opt.width, opt.height, 1.0f / (float)TAA_TILE_SIZE, RENDER_TARGET::RGBA16F);
+	res.rt_tile[1] = renderer.create(RENDER_TARGET::HDR_SCREEN, opt.width, opt.height, 1.0f / (float)TAA_TILE_SIZE, RENDER_TARGET::RGBA16F);
+	return res;
+}
+
+// g_Camera orbiting the scene, a new view every frame
+static void camera(TAA_FRAME_PARAM &param, int frame, const OPTIONS &opt)
+{
+	const float PI = 3.14159265f;
+	float a = atan2f(-10.5f, 3.0f) + 0.01f * (float)frame;
+	float r = sqrtf(3.0f * 3.0f + 10.5f * 10.5f);
+	const float eye[3] = { r * cosf(a), 4.5f, r * sinf(a) };
+	const float at[3] = { 0.0f, 0.0f, 0.0f };
+	const float up[3] = { 0.0f, 1.0f, 0.0f };
+	param.mView = MatrixLookAtLH(eye, at, up);
+	param.mProj = MatrixPerspectiveFovLH(PI / 4.0f, (float)opt.width / (float)opt.height, 0.1f, 100.0f);
+}
+
+static void dump(const RecordingDevice &device)
+{
+	size_t pos = 0;
+	RECORD r;
+	while (device.read(&pos, &r)){
+		printf("  %-20s %d", COMMAND::name(r.id), (int)r.arg);
+		if (r.id == COMMAND::UNMAP){
+			printf(" (%u bytes)", r.payload_size * (unsigned)sizeof(UINT));
+		}else{
+			for (UINT i = 0; i < r.payload_size; i++) printf(" 0x%08x", r.payload[i]);
+		}
+		printf("\n");
+	}
+}
+
+// Everything a draw or dispatch sees, replayed from a stream; ~0 where nothing was bound this frame
+struct DRAW_STATE
+{
+	enum{
+		SLOTS = 8,
+	};
+	UINT mesh, render_target, depth_target, uav;
+	UINT shader[STAGE::MAX], cb[STAGE::MAX], sampler[SLOTS], texture[SLOTS];
+	UINT rasterizer, depth, layout;
+	std::vector<UINT> constants[STAGE::MAX];	// contents of the bound constant buffers
+
+	DRAW_STATE() : mesh(~0u), render_target(~0u), depth_target(~0u), uav(~0u), rasterizer(~0u), depth(~0u), layout(~0u)
+	{
+		for (int i = 0; i < STAGE::MAX; i++) shader[i] = cb[i] = ~0u;
+		for (int i = 0; i < SLOTS; i++) sampler[i] = texture[i] = ~0u;
+	}
+
+	bool operator==(const DRAW_STATE &o) const
+	{
+		if (mesh != o.mesh || render_target != o.render_target || depth_target != o.depth_target || uav != o.uav) return false;
+		if (rasterizer != o.rasterizer || depth != o.depth || layout != o.layout) return false;
+		for (int i = 0; i < STAGE::MAX; i++){
+			if (shader[i] != o.shader[i] || cb[i] != o.cb[i] || constants[i] != o.constants[i]) return false;
+		}
+		for (int i = 0; i < SLOTS; i++){
+			if (sampler[i] != o.sampler[i] || texture[i] != o.texture[i]) return false;
+		}
+		return true;
+	}
+};
+
+static std::vector<DRAW_STATE> replay(const RecordingDevice &device, const TAA_FRAME_RESOURCES &res)
+{
+	std::vector<DRAW_STATE> draws;
+	DRAW_STATE s;
+	std::map<UINT, std::vector<UINT> > ring;	// contents by ring offset
+	UINT mapped = ~0u;
+
+	size_t pos = 0;
+	RECORD r;
+	while (device.read(&pos, &r)){
+		switch (r.id){
+		case COMMAND::SET_RENDER_TARGET:
+			// RenderTargets::set: DEPTH ids change the depth buffer, ~0 unbinds it
+			if (r.arg == res.rt_depth[0] || r.arg == res.rt_depth[1] || r.arg == ~0u) s.depth_target = r.arg; else s.render_target = r.arg;
+			s.uav = ~0u;
+			break;
+		case COMMAND::POP_RENDER_TARGET: s.render_target = s.depth_target = ~0u - 1; s.uav = ~0u; break;
+		case COMMAND::SET_PRESENT_TARGET: s.render_target = ~0u - 1; s.depth_target = ~0u; s.uav = r.arg; break;
+		case COMMAND::SET_TEXTURE: if (r.arg < DRAW_STATE::SLOTS) s.texture[r.arg] = r.payload[0]; break;
+		case COMMAND::SET_SAMPLER: if ((r.arg >> 8) < DRAW_STATE::SLOTS) s.sampler[r.arg >> 8] = r.arg & 0xff; break;
+		case COMMAND::SET_RASTERIZER: s.rasterizer = r.arg; break;
+		case COMMAND::SET_DEPTH: s.depth = r.arg; break;
+		case COMMAND::SET_VS: s.shader[STAGE::VS] = r.arg; break;
+		case COMMAND::SET_HS: s.shader[STAGE::HS] = r.arg; break;
+		case COMMAND::SET_DS: s.shader[STAGE::DS] = r.arg; break;
+		case COMMAND::SET_GS: s.shader[STAGE::GS] = r.arg; break;
+		case COMMAND::SET_PS: s.shader[STAGE::PS] = r.arg; break;
+		case COMMAND::SET_CS: s.shader[STAGE::CS] = r.arg; break;
+		case COMMAND::DISABLE: s.shader[r.arg] = ~0u - 1; break;
+		case COMMAND::SET_CB: s.cb[r.arg] = r.payload[0]; break;
+		case COMMAND::MAP: mapped = r.payload[0]; break;
+		case COMMAND::UNMAP: ring[mapped].assign(r.payload, r.payload + r.payload_size); break;
+		case COMMAND::SET_INPUT_LAYOUT: s.layout = r.arg; break;
+		case COMMAND::DRAW:
+			s.mesh = r.arg;
+			for (int i = 0; i < STAGE::MAX; i++){
+				s.constants[i] = (s.cb[i] != ~0u) ? ring[s.cb[i]] : std::vector<UINT>();
+			}
+			draws.push_back(s);
+			if (r.arg == res.scene_mesh || r.arg == res.pole_mesh) s.texture[0] = ~0u - 1; // SDKMESH diffuse
+			break;
+		case COMMAND::DISPATCH:{// the UAV is bound for the dispatch only
+			DRAW_STATE d = s;
+			d.mesh = ~0u;
+			d.uav = r.arg;
+			for (int i = 0; i < STAGE::MAX; i++){
+				d.constants[i] = (d.cb[i] != ~0u) ? ring[d.cb[i]] : std::vector<UINT>();
+			}
+			draws.push_back(d);
+			break;
+		}
+		default:
+			break;
+		}
+	}
+	return draws;
+}
+
+// As OnD3D11FrameRender: the count of meshes that finished loading
+static UINT sceneRevision(Renderer &renderer, const TAA_FRAME_RESOURCES &res)
+{
+	return (renderer.isMeshReady(res.scene_mesh) ? 1 : 0) + (renderer.isMeshReady(res.pole_mesh) ? 1 : 0);
+}
+
+static TAA_FRAME_PARAM frameParam(TAA_MODE::ID mode, const OPTIONS &opt)
+{
+	TAA_FRAME_PARAM param;
+	param.mode = mode;
+	param.blend_weight = opt.blend;
+	param.blur_size = opt.blur;
+	param.render_scale = opt.scale;
+	param.jitter = opt.jitter;
+	param.format = opt.format;
+	param.history = opt.history;
+	param.tile_skip = opt.tile_skip;
+	param.fused_present = opt.fused;
+	param.clamp = opt.clamp;
+	param.depth_reject = opt.depth_reject;
+	param.tonemap = opt.tonemap;
+	param.exposure = 1.0f;
+	param.dither = opt.dither;
+	param.scene_revision = 0;
+	return param;
+}
+
+static void run(TAA_MODE::ID mode, const OPTIONS &opt, bool cache, std::vector<DRAW_STATE> *draws = nullptr)
+{
+	RecordingDevice *pDevice = new RecordingDevice(opt.ring);
+	Renderer renderer(pDevice);
+	renderer.setStateCache(cache);
+	TaaFrame frame;
+	TAA_FRAME_RESOURCES res = createResources(renderer, opt);
+	frame.create(res);
+	renderer.ResizedSwapChain(opt.width, opt.height);
+	frame.resize(opt.width, opt.height);
+
+	TAA_FRAME_PARAM param = frameParam(mode, opt);
+	param.scene_revision = sceneRevision(renderer, res);
+
+	// warm up: first frame history reset and render target rescale
+	for (int i = 0; i < 2; i++){
+		camera(param, i, opt);
+		pDevice->reset();
+		frame.render(&renderer, param);
+	}
+
+	if (draws){
+		*draws = replay(*pDevice, res);
+		return;
+	}
+	if (opt.dump){
+		printf("%s:\n", MODE_NAME[mode]);
+		dump(*pDevice);
+		return;
+	}
+
+	size_t commands = 0, bytes = 0;
+	size_t submitted = 0, filtered = 0, forwarded = 0;
+	size_t cb_bytes = 0, maps = 0, waits = 0;
+	size_t rt_created = 0, rt_destroyed = 0;
+	pDevice->takeRingStats(nullptr);
+	pDevice->takePoolStats();
+	double ms = 0.0;
+	for (int i = 0; i < opt.frames; i++){
+		camera(param, i + 2, opt);
+		pDevice->reset();
+		if (opt.drag){// triangle wave, one pixel per frame each way
+			unsigned d = (unsigned)i % (2 * opt.drag);
+			d = (d < opt.drag) ? d : 2 * opt.drag - d;
+			renderer.ResizedSwapChain(opt.width + d, opt.height + d / 2);
+			frame.resize(opt.width + d, opt.height + d / 2);
+		}
+
+		auto t0 = std::chrono::high_resolution_clock::now();
+		frame.render(&renderer, param);
+		ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+
+		for (int c = 0; c < COMMAND::MAX; c++) commands += pDevice->count((COMMAND::ID)c);
+		bytes += pDevice->size();
+		UINT w;
+		UploadRing::STATS ring = pDevice->takeRingStats(&w);
+		waits += w;
+		cb_bytes += ring.bytes;
+		maps += ring.allocations;
+		const BINDING_STATS &stats = renderer.stats();
+		submitted += stats.total(stats.submitted);
+		filtered += stats.total(stats.filtered);
+		forwarded += stats.total(stats.forwarded);
+		RenderTargetPool::STATS pool = pDevice->takePoolStats();
+		rt_created += pool.created;
+		rt_destroyed += pool.destroyed;
+	}
+
+	double n = (double)opt.frames;
+	printf("%s,%d,%.3f,%.1f,%.1f,%u,%.1f,%.1f,%.1f,%.1f,%.1f,%u,%u,%u,%.1f\n", MODE_NAME[mode], opt.frames,
+		1000.0 * ms / n, (double)commands / n, (double)bytes / n, pDevice->count(COMMAND::DRAW),
+		(double)submitted / n, (double)filtered / n, (double)forwarded / n,
+		(double)maps / n, (double)cb_bytes / n, (unsigned)waits,
+		(unsigned)rt_created, (unsigned)rt_destroyed, (double)renderer.getTotalBytes() / (1024.0 * 1024.0));
+}
+
+static bool verify(TAA_MODE::ID mode, const OPTIONS &opt)
+{
+	std::vector<DRAW_STATE> ref, cached;
+	run(mode, opt, false, &ref);
+	run(mode, opt, true, &cached);
+
+	bool ok = (ref.size() == cached.size());
+	for (size_t i = 0; ok && i < ref.size(); i++){
+		if (!(ref[i] == cached[i])){
+			fprintf(stderr, "%s: draw %u sees different state with the cache\n", MODE_NAME[mode], (unsigned)i);
+			ok = false;
+		}
+	}
+	printf("%s,%u draws,%s\n", MODE_NAME[mode], (unsigned)ref.size(), ok ? "ok" : "MISMATCH");
+	return ok;
+}
+
+// The taa mode through PS or PS_YCoCg with tile skip, the camera still
+static TAA_FRAME_PARAM stillParam(const OPTIONS &opt)
+{
+	TAA_FRAME_PARAM param = frameParam(TAA_MODE::TAA, opt);
+	param.render_scale = 100;
+	param.clamp = TAA_CLAMP::CHROMA;
+	param.history = TAA_HISTORY::RGB;
+	param.tile_skip = true;
+	camera(param, 0, opt);
+	return param;
+}
+
+// A CB_TAA float the TAA resolve of the recorded frame sees, fallback without one
+static float taaConstant(const RecordingDevice &device, const TAA_FRAME_RESOURCES &res, size_t offset, float fallback)
+{
+	std::vector<DRAW_STATE> draws = replay(device, res);
+	for (auto &d : draws){
+		const size_t index = offset / sizeof(UINT);
+		if (d.shader[STAGE::PS] != PS::TAA && d.shader[STAGE::PS] != PS::TAA_YCOCG) continue;
+		if (d.constants[STAGE::PS].size() <= index) continue;
+		float value;
+		memcpy(&value, &d.constants[STAGE::PS][index], sizeof(value));
+		return value;
+	}
+	return fallback;
+}
+
+// Whether the TAA resolve of the recorded frame ignores and resets the tile mask
+static bool tileReset(const RecordingDevice &device, const TAA_FRAME_RESOURCES &res)
+{
+	return taaConstant(device, res, offsetof(CB_TAA, tile) + 2 * sizeof(float), 1.0f) != 0.0f;
+}
+
+// Whether the TAA resolve of the recorded frame ignores the history
+static bool historyReset(const RecordingDevice &device, const TAA_FRAME_RESOURCES &res)
+{
+	return taaConstant(device, res, offsetof(CB_TAA, fRate), 1.0f) == 1.0f;
+}
+
+// A still camera with tile skip: the pole mesh finishes loading after the
+// mask has converged, its tiles must be resolved again
+static bool verifyTileReset(const OPTIONS &opt)
+{
+	RecordingDevice *pDevice = new RecordingDevice(opt.ring);
+	Renderer renderer(pDevice);
+	TaaFrame frame;
+	TAA_FRAME_RESOURCES res = createResources(renderer, opt);
+	frame.create(res);
+	renderer.ResizedSwapChain(opt.width, opt.height);
+	frame.resize(opt.width, opt.height);
+
+	TAA_FRAME_PARAM param = stillParam(opt);
+
+	const int READY = 4 * (int)TAA_TILE_FRAMES;
+	pDevice->setLoading(res.pole_mesh, true);
+	bool ok = true;
+	for (int i = 0; i < 2 * READY; i++){
+		if (i == READY) pDevice->setLoading(res.pole_mesh, false);
+		param.scene_revision = sceneRevision(renderer, res);
+		pDevice->reset();
+		frame.render(&renderer, param);
+		bool expected = (i == 0 || i == READY);
+		if (tileReset(*pDevice, res) != expected){
+			fprintf(stderr, "taa: frame %d %s the tile mask\n", i, expected ? "keeps" : "resets");
+			ok = false;
+		}
+	}
+	printf("taa,tile reset when a mesh is ready after %d frames,%s\n", READY, ok ? "ok" : "FAIL");
+	return ok;
+}
+
+// The window shrinks by a pool bucket: rt_taa keeps its surface until the
+// size has settled, then moves to a new one and the history starts over
+static bool verifyShrink(const OPTIONS &opt)
+{
+	RecordingDevice *pDevice = new RecordingDevice(opt.ring);
+	Renderer renderer(pDevice);
+	TaaFrame frame;
+	TAA_FRAME_RESOURCES res = createResources(renderer, opt);
+	frame.create(res);
+	renderer.ResizedSwapChain(opt.width, opt.height);
+	frame.resize(opt.width, opt.height);
+
+	TAA_FRAME_PARAM param = stillParam(opt);
+
+	const int RESIZE = 2 * (int)TAA_TILE_FRAMES;
+	UINT width = (RenderTargetPool::GRANULARITY < opt.width) ? opt.width - RenderTargetPool::GRANULARITY : opt.width;
+	UINT generation = renderer.getGeneration(res.rt_taa[0]);
+	int moved = -1;
+	bool ok = true;
+	for (int i = 0; i < RESIZE + 2 * RenderTargetPool::STABLE_FRAMES; i++){
+		if (i == RESIZE){
+			renderer.ResizedSwapChain(width, opt.height);
+			frame.resize(width, opt.height);
+		}
+		pDevice->reset();
+		frame.render(&renderer, param);
+		bool lost = (renderer.getGeneration(res.rt_taa[0]) != generation);
+		generation = renderer.getGeneration(res.rt_taa[0]);
+		if (lost && RESIZE < i) moved = i;
+
+		if (tileReset(*pDevice, res) != (i == 0 || i == RESIZE || lost)){
+			fprintf(stderr, "taa: frame %d gets the tile mask wrong\n", i);
+			ok = false;
+		}
+		if (historyReset(*pDevice, res) != (i == 0 || lost)){
+			fprintf(stderr, "taa: frame %d %s the history\n", i, lost ? "keeps" : "resets");
+			ok = false;
+		}
+	}
+	ok = ok && 0 <= moved;
+	printf("taa,history reset when a shrunk target moves after %d frames,%s\n", moved - RESIZE, ok ? "ok" : "FAIL");
+	return ok;
+}
+
+// rt_taa switches encoding every few frames, YCoCg64 keeping the format of
+// an RGBA16F RGB history: each switch restarts the history
+static bool verifyHistorySwitch(const OPTIONS &opt)
+{
+	RecordingDevice *pDevice = new RecordingDevice(opt.ring);
+	Renderer renderer(pDevice);
+	TaaFrame frame;
+	TAA_FRAME_RESOURCES res = createResources(renderer, opt);
+	frame.create(res);
+	renderer.ResizedSwapChain(opt.width, opt.height);
+	frame.resize(opt.width, opt.height);
+
+	TAA_FRAME_PARAM param = stillParam(opt);
+	param.format = RENDER_TARGET::RGBA16F;
+
+	const TAA_HISTORY::ID HISTORY[] = { TAA_HISTORY::RGB, TAA_HISTORY::YCOCG64, TAA_HISTORY::YCOCG32, TAA_HISTORY::RGB };
+	const int SWITCH = 4;
+	bool ok = true;
+	for (int i = 0; i < SWITCH * (int)(sizeof(HISTORY) / sizeof(HISTORY[0])); i++){
+		param.history = HISTORY[i / SWITCH];
+		pDevice->reset();
+		frame.render(&renderer, param);
+		bool expected = (i % SWITCH == 0);
+		if (historyReset(*pDevice, res) != expected || tileReset(*pDevice, res) != expected){
+			fprintf(stderr, "taa: frame %d %s the history\n", i, expected ? "keeps" : "resets");
+			ok = false;
+		}
+	}
+	printf("taa,history reset when the encoding changes,%s\n", ok ? "ok" : "FAIL");
+	return ok;
+}
+
+int main(int argc, char *argv[])
+{
+	OPTIONS opt;
+	if (!parseOptions(argc - 1, argv + 1, opt)){
+		fprintf(stderr, "usage: frame_bench [-dump|-verify] [-nocache] [-ring BYTES] [-drag PIXELS] [-format FORMAT] [-history ENCODING] [-tileskip] [-fused] [-clamp chroma|variance] [-depthreject] [-tonemap none|reinhard] [-dither] [-mode off|taa|cammove|checkerboard|all] [-size WxH] [-scale N] [-blend N] [-blur N] [-jitter TYPE] [-frames N]\n");
+		return 1;
+	}
+
+	if (opt.verify){
+		bool ok = true;
+		for (int m = 0; m < TAA_MODE::MAX; m++){
+			if (opt.mode < 0 || opt.mode == m) ok = verify((TAA_MODE::ID)m, opt) && ok;
+		}
+		if (opt.mode < 0 || opt.mode == TAA_MODE::TAA){
+			ok = verifyTileReset(opt) && ok;
+			ok = verifyShrink(opt) && ok;
+			ok = verifyHistorySwitch(opt) && ok;
+		}
+		return ok ? 0 : 1;
+	}
+
+	if (!opt.dump) printf("mode,frames,us_per_frame,commands_per_frame,bytes_per_frame,draws_per_frame,"
+		"bindings_submitted,bindings_filtered,bindings_forwarded,cb_allocations_per_frame,cb_bytes_per_frame,cb_waits,"
+		"rt_created,rt_destroyed,rt_mb\n");
+	for (int m = 0; m < TAA_MODE::MAX; m++){
+		if (opt.mode < 0 || opt.mode == m) run((TAA_MODE::ID)m, opt, opt.cache);
+	}
+	return 0;
+}
@@ -0,0 +1,597 @@
+//--------------------------------------------------------------------------------------
+// File: mesh_opt.cpp
+//
+// Vertex cache, overdraw and vertex fetch ordering of MeshOptimizer measured
+// on the sample meshes and a shuffled grid, e.g.:
+//   g++ -O2 -std=c++11 -pthread -Itpot tools/mesh_opt.cpp tpot/MeshOptimizer.cpp tpot/TMeshFile.cpp
+//       tpot/ThreadPool.cpp tpot/SDKMeshParser.cpp tpot/Lz4.cpp tpot/MappedFile.cpp
+//
+//   mesh_opt stats [file.sdkmesh ...]
+//       ACMR and ATVR at FIFO 16 and 32, overdraw and overfetch of the
+//       source order against Forsyth, Tipsify, Tipsify + overdraw, the
+//       OptimizeMeshOrder choice and that + vertex fetch (what the loader
+//       and tmesh_convert -optimize do), triangle list subsets summed per file
+//   mesh_opt selftest [-threads N]
+//       triangles kept, remaps valid, a shuffled grid and nested spheres
+//       improve, the kept order never worse than the source, degenerate
+//       input, and TMeshData::optimize() on a pool
+//       writing the same bytes as without
+//   mesh_opt bench [-threads N] [-iterations N] [file.sdkmesh ...]
+//       time of each pass per file, and TMeshData::optimize() of a grid cut
+//       into many subsets serially against on a pool
+//--------------------------------------------------------------------------------------
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "MeshOptimizer.h"
+#include "SDKMeshParser.h"
+#include "ThreadPool.h"
+#include "TMeshFile.h"
+#include "selftest.h"
+
+using namespace tpot;
+
+typedef std::chrono::high_resolution_clock CLOCK;
+
+static double usSince(CLOCK::time_point t0)
+{
+	return std::chrono::duration<double, std::micro>(CLOCK::now() - t0).count();
+}
+
+// One triangle list with its own vertices, positions at position bytes in
+struct SUBSET
+{
+	std::string                name;
+	std::vector<unsigned>      indices;
+	std::vector<unsigned char> vertices;
+	unsigned                   vertex_count;
+	unsigned                   stride;
+	unsigned                   position;
+
+	const float *positions() const { return (const float*)(vertices.data() + position); }
+};
+
+// Triangle list subsets of an .sdkmesh, through its raw .tmesh conversion
+static bool loadSubsets(const char *path, std::vector<SUBSET> *out)
+{
+	std::vector<unsigned char> bytes, image;
+	SDKMeshParser parser;
+	std::string error;
+	TMeshReader reader;
+	if (!readFile(path, &bytes) || parser.parse(bytes.data(), bytes.size()) != SDKMESH_ERROR::NONE
+		|| !TMeshConvert(parser, 0, &image, &error) || reader.parse(image.data(), image.size()) != TMESH_ERROR::NONE){
+		fprintf(stderr, "%s: cannot load\n", path);
+		return false;
+	}
+
+	out->clear();
+	for (const TMESH_MESH &mesh : reader.meshes()){
+		const TMESH_STREAM &stream = reader.streams()[mesh.streams[0]];
+		unsigned position = ~0u;
+		for (unsigned e = 0; e < stream.element_count; e++){
+			if (strcmp(reader.string(stream.elements[e].semantic), "POSITION") == 0
+				&& stream.elements[e].format == TMESH_FORMAT::R32G32B32_FLOAT) position = stream.elements[e].offset;
+		}
+		const TMESH_INDEX_BUFFER &ib = reader.indexBuffers()[mesh.index_buffer];
+		std::vector<unsigned char> vertices((size_t)reader.sections()[stream.section].bytes), indices((size_t)reader.sections()[ib.section].bytes);
+		if (position == ~0u || !reader.read(stream.section, vertices.data()) || !reader.read(ib.section, indices.data())) continue;
+
+		for (unsigned k = 0; k < mesh.subset_count; k++){
+			const TMESH_SUBSET &subset = reader.subsets()[mesh.first_subset + k];
+			if (subset.topology != 4) continue;
+			SUBSET s;
+			s.name = std::string(path) + ":" + reader.string(mesh.name);
+			s.vertex_count = stream.vertex_count - subset.base_vertex;
+			s.stride = stream.stride;
+			s.position = position;
+			s.vertices.assign(vertices.begin() + (size_t)subset.base_vertex * stream.stride, vertices.end());
+			for (unsigned i = 0; i < subset.index_count; i++){
+				unsigned v = 0;
+				memcpy(&v, indices.data() + (size_t)(subset.index_start + i) * TMeshFormatBytes(ib.format), TMeshFormatBytes(ib.format));
+				s.indices.push_back(v);
+			}
+			out->push_back(s);
+		}
+	}
+	return true;
+}
+
+// An n x n quad grid in the xy plane facing +z, triangles shuffled and
+// vertices in random order: the worst case for every cache
+static SUBSET shuffledGrid(unsigned n, unsigned seed)
+{
+	SUBSET s;
+	s.name = "grid" + std::to_string(n);
+	s.vertex_count = (n + 1) * (n + 1);
+	s.stride = 20;
+	s.position = 0;
+	std::mt19937 rng(seed);
+	std::vector<unsigned> order(s.vertex_count);
+	for (unsigned i = 0; i < order.size(); i++) order[i] = i;
+	std::shuffle(order.begin(), order.end(), rng);
+
+	s.vertices.resize(s.vertex_count * s.stride);
+	for (unsigned y = 0; y <= n; y++){
+		for (unsigned x = 0; x <= n; x++){
+			float v[5] = { (float)x, (float)y, 0.0f, (float)x / n, (float)y / n };
+			memcpy(&s.vertices[order[y * (n + 1) + x] * s.stride], v, sizeof(v));
+		}
+	}
+	std::vector<unsigned> quads(n * n);
+	for (unsigned i = 0; i < quads.size(); i++) quads[i] = i;
+	std::shuffle(quads.begin(), quads.end(), rng);
+	for (unsigned q : quads){
+		unsigned x = q % n, y = q / n;
+		unsigned a = order[y * (n + 1) + x], b = order[y * (n + 1) + x + 1], c = order[(y + 1) * (n + 1) + x], d = order[(y + 1) * (n + 1) + x + 1];
+		unsigned tri[6] = { a, b, c, b, d, c };
+		s.indices.insert(s.indices.end(), tri, tri + 6);
+	}
+	return s;
+}
+
+// A UV sphere inside a larger one, both facing out, the inner drawn first:
+// seen from anywhere outside, all of the inner one is overdraw
+static SUBSET nestedSpheres(unsigned segments)
+{
+	SUBSET s;
+	s.name = "nested_spheres";
+	s.stride = 12;
+	s.position = 0;
+	unsigned rings = segments / 2;
+	std::vector<float> positions;
+	for (int sphere = 0; sphere < 2; sphere++){
+		float radius = sphere ? 2.0f : 1.0f;
+		unsigned base = (unsigned)positions.size() / 3;
+		for (unsigned r = 0; r <= rings; r++){
+			float theta = 3.14159265f * r / rings;
+			for (unsigned k = 0; k <= segments; k++){
+				float phi = 2.0f * 3.14159265f * k / segments;
+				positions.push_back(radius * sinf(theta) * cosf(phi));
+				positions.push_back(radius * sinf(theta) * sinf(phi));
+				positions.push_back(radius * cosf(theta));
+			}
+		}
+		for (unsigned r = 0; r < rings; r++){
+			for (unsigned k = 0; k < segments; k++){
+				unsigned a = base + r * (segments + 1) + k, b = a + 1, c = a + segments + 1, d = c + 1;
+				unsigned tri[6] = { a, c, b, b, c, d };
+				s.indices.insert(s.indices.end(), tri, tri + 6);
+			}
+		}
+	}
+	s.vertex_count = (unsigned)positions.size() / 3;
+	s.vertices.resize(positions.size() * sizeof(float));
+	memcpy(s.vertices.data(), positions.data(), s.vertices.size());
+	return s;
+}
+
+struct ORDER{
+	enum ID{
+		SOURCE,
+		FORSYTH,
+		TIPSIFY,
+		OVERDRAW,	// Tipsify + overdraw
+		BEST,		// OptimizeMeshOrder
+		VFETCH,		// OptimizeMeshOrder + vertex fetch
+
+		MAX,
+	};
+};
+static const char *const ORDER_NAME[ORDER::MAX] = { "source", "forsyth", "tipsify", "tipsify_overdraw", "best", "best_vfetch" };
+
+// The subset reordered; vertices too for VFETCH
+static SUBSET reorder(const SUBSET &src, ORDER::ID order)
+{
+	SUBSET s = src;
+	size_t count = src.indices.size();
+	std::vector<unsigned> clusters, cached(count);
+	switch (order){
+	case ORDER::SOURCE:
+		break;
+	case ORDER::FORSYTH:
+		OptimizeVertexCacheForsyth(s.indices.data(), src.indices.data(), count, src.vertex_count);
+		break;
+	case ORDER::TIPSIFY:
+		OptimizeVertexCacheTipsify(s.indices.data(), src.indices.data(), count, src.vertex_count);
+		break;
+	case ORDER::OVERDRAW:
+		OptimizeVertexCacheTipsify(cached.data(), src.indices.data(), count, src.vertex_count, 16, &clusters);
+		OptimizeOverdraw(s.indices.data(), cached.data(), count, src.positions(), src.vertex_count, src.stride, clusters);
+		break;
+	case ORDER::BEST:
+	case ORDER::VFETCH:
+		OptimizeMeshOrder(s.indices.data(), src.indices.data(), count, src.positions(), src.vertex_count, src.stride);
+		if (order == ORDER::VFETCH){
+			std::vector<unsigned> remap(src.vertex_count);
+			OptimizeVertexFetchRemap(remap.data(), s.indices.data(), count, src.vertex_count);
+			RemapIndices(s.indices.data(), s.indices.data(), count, remap.data());
+			RemapVertices(s.vertices.data(), src.vertices.data(), src.vertex_count, src.stride, remap.data());
+		}
+		break;
+	default:
+		break;
+	}
+	return s;
+}
+
+// Totals over subsets, so the ratios weigh each triangle alike
+struct TOTALS
+{
+	unsigned long long triangles, vertices, transformed16, transformed32, covered, shaded, fetched, referenced_bytes;
+
+	void add(const SUBSET &s)
+	{
+		VCACHE_STATS c16 = AnalyzeVertexCache(s.indices.data(), s.indices.size(), s.vertex_count, 16);
+		VCACHE_STATS c32 = AnalyzeVertexCache(s.indices.data(), s.indices.size(), s.vertex_count, 32);
+		OVERDRAW_STATS o = AnalyzeOverdraw(s.indices.data(), s.indices.size(), s.positions(), s.vertex_count, s.stride);
+		VFETCH_STATS f = AnalyzeVertexFetch(s.indices.data(), s.indices.size(), s.vertex_count, s.stride);
+		triangles += c16.triangles;
+		vertices += c16.vertices;
+		transformed16 += c16.transformed;
+		transformed32 += c32.transformed;
+		covered += o.covered;
+		shaded += o.shaded;
+		fetched += f.bytes_fetched;
+		referenced_bytes += (unsigned long long)c16.vertices * s.stride;
+	}
+	double acmr16() const { return triangles ? (double)transformed16 / triangles : 0; }
+	double atvr16() const { return vertices ? (double)transformed16 / vertices : 0; }
+	double acmr32() const { return triangles ? (double)transformed32 / triangles : 0; }
+	double overdraw() const { return covered ? (double)shaded / covered : 0; }
+	double overfetch() const { return referenced_bytes ? (double)fetched / referenced_bytes : 0; }
+};
+
+static std::vector<const char*> mediaFiles(const std::vector<const char*> &args)
+{
+	std::vector<const char*> files = args;
+	if (files.empty()){
+		files.push_back("Media/ColumnScene/Poles.sdkmesh");
+		files.push_back("Media/ColumnScene/scene.sdkmesh");
+	}
+	return files;
+}
+
+static int stats(const std::vector<const char*> &files)
+{
+	printf("mesh,order,triangles,acmr16,atvr16,acmr32,overdraw,overfetch\n");
+	std::vector<std::pair<std::string, std::vector<SUBSET> > > meshes;
+	for (const char *path : files){
+		std::vector<SUBSET> subsets;
+		if (!loadSubsets(path, &subsets)) return 1;
+		meshes.push_back(std::make_pair(std::string(path), subsets));
+	}
+	meshes.push_back(std::make_pair(std::string("synthetic_grid64"), std::vector<SUBSET>(1, shuffledGrid(64, 1))));
+	meshes.push_back(std::make_pair(std::string("synthetic_nested_spheres"), std::vector<SUBSET>(1, nestedSpheres(48))));
+
+	for (const auto &m : meshes){
+		for (int o = 0; o < ORDER::MAX; o++){
+			TOTALS t = {};
+			for (const SUBSET &s : m.second) t.add(reorder(s, (ORDER::ID)o));
+			printf("%s,%s,%llu,%.3f,%.3f,%.3f,%.3f,%.3f\n", m.first.c_str(), ORDER_NAME[o], t.triangles,
+				t.acmr16(), t.atvr16(), t.acmr32(), t.overdraw(), t.overfetch());
+		}
+	}
+	return 0;
+}
+
+static CheckReport report;
+
+// Triangles by the bytes of their vertices, rotated to the smallest first
+static std::vector<std::string> triangles(const SUBSET &s)
+{
+	std::vector<std::string> out;
+	for (size_t i = 0; i + 3 <= s.indices.size(); i += 3){
+		std::string key[3];
+		for (int k = 0; k < 3; k++) key[k].assign((const char*)s.vertices.data() + (size_t)s.indices[i + k] * s.stride, s.stride);
+		int first = (key[1] < key[0]) ? 1 : 0;
+		first = (key[2] < key[first]) ? 2 : first;
+		out.push_back(key[first] + key[(first + 1) % 3] + key[(first + 2) % 3]);
+	}
+	std::sort(out.begin(), out.end());
+	return out;
+}
+
+static void testPreserved(const std::vector<SUBSET> &subsets)
+{
+	for (const SUBSET &s : subsets){
+		std::vector<std::string> before = triangles(s);
+		for (int o = ORDER::FORSYTH; o < ORDER::MAX; o++){
+			SUBSET r = reorder(s, (ORDER::ID)o);
+			report("triangles_kept_" + std::string(ORDER_NAME[o]) + ":" + s.name, triangles(r) == before && r.indices.size() == s.indices.size(), "");
+		}
+	}
+}
+
+// Poles' cylinders are too coarse for Tipsify + overdraw to keep the source ACMR
+static void testNeverWorse(const std::vector<SUBSET> &subsets)
+{
+	for (const SUBSET &s : subsets){
+		TOTALS before = {}, after = {};
+		before.add(s);
+		after.add(reorder(s, ORDER::BEST));
+		char detail[160];
+		snprintf(detail, sizeof(detail), "acmr %.3f -> %.3f, overdraw %.3f -> %.3f", before.acmr16(), after.acmr16(), before.overdraw(), after.overdraw());
+		report("best_never_worse:" + s.name, after.transformed16 <= before.transformed16 && after.shaded <= before.shaded, detail);
+	}
+}
+
+static void testRemap(const SUBSET &s)
+{
+	// half the vertices unused: they go last, after the referenced ones
+	SUBSET half = s;
+	half.indices.resize(half.indices.size() / 2 / 3 * 3);
+	std::vector<unsigned> remap(half.vertex_count);
+	size_t referenced = OptimizeVertexFetchRemap(remap.data(), half.indices.data(), half.indices.size(), half.vertex_count);
+	std::vector<char> hit(half.vertex_count, 0);
+	bool permutation = true;
+	for (unsigned r : remap){
+		permutation = permutation && r < half.vertex_count && !hit[r];
+		if (r < half.vertex_count) hit[r] = 1;
+	}
+	VCACHE_STATS c = AnalyzeVertexCache(half.indices.data(), half.indices.size(), half.vertex_count);
+	std::vector<unsigned> first_use(half.indices.size());
+	RemapIndices(first_use.data(), half.indices.data(), half.indices.size(), remap.data());
+	unsigned next = 0;
+	bool ordered = true;
+	for (unsigned v : first_use){
+		if (v == next) next++;
+		else ordered = ordered && v < next;
+	}
+	report("remap_permutation", permutation && referenced == c.vertices, "referenced=" + std::to_string(referenced) + " of " + std::to_string(half.vertex_count));
+	report("remap_first_use_order", ordered && next == referenced, "");
+}
+
+static void testImproves()
+{
+	SUBSET grid = shuffledGrid(64, 2);
+	TOTALS before = {}, forsyth = {}, tipsify = {}, all = {};
+	before.add(grid);
+	forsyth.add(reorder(grid, ORDER::FORSYTH));
+	tipsify.add(reorder(grid, ORDER::TIPSIFY));
+	all.add(reorder(grid, ORDER::VFETCH));
+	char detail[160];
+	snprintf(detail, sizeof(detail), "acmr %.3f -> forsyth %.3f tipsify %.3f", before.acmr16(), forsyth.acmr16(), tipsify.acmr16());
+	report("grid_vertex_cache", forsyth.acmr16() < 0.8 && tipsify.acmr16() < 0.8 && before.acmr16() > 1.5, detail);
+	snprintf(detail, sizeof(detail), "overfetch %.3f -> %.3f", before.overfetch(), all.overfetch());
+	report("grid_vertex_fetch", all.overfetch() < 1.5 && all.overfetch() < before.overfetch(), detail);
+
+	SUBSET spheres = nestedSpheres(48);
+	TOTALS in = {}, out = {};
+	in.add(spheres);
+	out.add(reorder(spheres, ORDER::OVERDRAW));
+	snprintf(detail, sizeof(detail), "overdraw %.3f -> %.3f, acmr %.3f -> %.3f", in.overdraw(), out.overdraw(), in.acmr16(), out.acmr16());
+	report("nested_spheres_overdraw", out.overdraw() < in.overdraw() && out.overdraw() < 1.1, detail);
+}
+
+static void testDegenerate()
+{
+	std::vector<unsigned> clusters;
+	unsigned out[9] = { 7, 7, 7, 7, 7, 7, 7, 7, 7 };
+	float positions[12] = { 0, 0, 0, 1, 0, 0, 0, 1, 0, 1, 1, 0 };
+
+	OptimizeVertexCacheForsyth(out, nullptr, 0, 0);
+	OptimizeVertexCacheTipsify(out, nullptr, 0, 0, 16, &clusters);
+	OptimizeOverdraw(out, nullptr, 0, positions, 0, 12, clusters);
+	VCACHE_STATS c = AnalyzeVertexCache(nullptr, 0, 0);
+	OVERDRAW_STATS o = AnalyzeOverdraw(nullptr, 0, positions, 0, 12);
+	report("empty", out[0] == 7 && clusters.empty() && c.acmr == 0 && o.overdraw == 1.0f, "");
+
+	// a repeated vertex, an unused one, a triangle with no area and a stray index
+	unsigned in[8] = { 0, 0, 1, 1, 2, 3, 3, 3 };
+	SUBSET s;
+	s.name = "degenerate";
+	s.vertex_count = 5;
+	s.stride = 12;
+	s.position = 0;
+	s.vertices.assign((unsigned char*)positions, (unsigned char*)positions + sizeof(positions));
+	s.vertices.resize(5 * 12, 0);
+	s.indices.assign(in, in + 6);
+	testPreserved(std::vector<SUBSET>(1, s));
+
+	unsigned tail[8];
+	memcpy(tail, in, sizeof(in));
+	OptimizeVertexCacheTipsify(tail, in, 8, 5);
+	report("partial_triangle_untouched", tail[6] == 3 && tail[7] == 3, "");
+}
+
+// A one mesh .tmesh of a shuffled grid split into bands, one subset each
+static std::vector<unsigned char> gridTMesh(unsigned n, unsigned bands, unsigned seed)
+{
+	SUBSET grid = shuffledGrid(n, seed);
+	std::vector<unsigned> quads(grid.indices.size() / 6);
+	std::vector<std::vector<unsigned> > band(bands);
+	for (size_t q = 0; q < quads.size(); q++){
+		float y;
+		memcpy(&y, &grid.vertices[grid.indices[q * 6] * grid.stride + 4], 4);
+		unsigned b = std::min(bands - 1, (unsigned)(y * bands / n));
+		band[b].insert(band[b].end(), grid.indices.begin() + q * 6, grid.indices.begin() + q * 6 + 6);
+	}
+
+	const char strings[] = "POSITION\0TEXCOORD\0grid\0";
+	TMESH_STREAM stream;
+	memset(&stream, 0, sizeof(stream));
+	stream.section = 7;
+	stream.vertex_count = grid.vertex_count;
+	stream.stride = grid.stride;
+	stream.element_count = 2;
+	stream.elements[0].semantic = 0;
+	stream.elements[0].format = TMESH_FORMAT::R32G32B32_FLOAT;
+	stream.elements[1].semantic = 9;
+	stream.elements[1].format = TMESH_FORMAT::R32G32_FLOAT;
+	stream.elements[1].offset = 12;
+	TMESH_INDEX_BUFFER ib;
+	memset(&ib, 0, sizeof(ib));
+	ib.section = 8;
+	ib.index_count = (unsigned)grid.indices.size();
+	ib.format = TMESH_FORMAT::R32_UINT;
+	TMESH_MESH mesh;
+	memset(&mesh, 0, sizeof(mesh));
+	mesh.name = 18;
+	mesh.stream_count = 1;
+	mesh.subset_count = bands;
+	std::vector<TMESH_SUBSET> subsets;
+	std::vector<unsigned> indices;
+	for (unsigned b = 0; b < bands; b++){
+		TMESH_SUBSET s = { TMESH_NO_STRING, 4, 0, (unsigned)indices.size(), (unsigned)band[b].size(), 0 };
+		subsets.push_back(s);
+		indices.insert(indices.end(), band[b].begin(), band[b].end());
+	}
+	TMESH_MATERIAL material;
+	memset(&material, 0, sizeof(material));
+	material.name = material.diffuse_texture = material.normal_texture = material.specular_texture = TMESH_NO_STRING;
+	unsigned draw = 0;
+
+	const void *data[9] = { &stream, &ib, &mesh, subsets.data(), &material, &draw, strings, grid.vertices.data(), indices.data() };
+	size_t bytes[9] = { sizeof(stream), sizeof(ib), sizeof(mesh), subsets.size() * sizeof(TMESH_SUBSET), sizeof(material), sizeof(draw),
+		sizeof(strings), grid.vertices.size(), indices.size() * sizeof(unsigned) };
+	TMESH_HEADER header;
+	memset(&header, 0, sizeof(header));
+	header.magic = TMESH_MAGIC;
+	header.version = TMESH_VERSION;
+	header.section_count = 9;
+	header.stream_count = header.index_buffer_count = header.mesh_count = header.material_count = header.draw_count = 1;
+	header.subset_count = bands;
+	header.string_bytes = sizeof(strings);
+
+	std::vector<unsigned char> out(sizeof(header) + 9 * sizeof(TMESH_SECTION), 0);
+	TMESH_SECTION sections[9];
+	for (unsigned i = 0; i < 9; i++){
+		out.resize((out.size() + TMESH_ALIGNMENT - 1) / TMESH_ALIGNMENT * TMESH_ALIGNMENT, 0);
+		if (i == TMESH_SECTION_TYPE::VERTEX_DATA) header.header_bytes = (unsigned)out.size();
+		sections[i].type = i;
+		sections[i].compression = TMESH_COMPRESSION::NONE;
+		sections[i].offset = out.size();
+		sections[i].stored_bytes = sections[i].bytes = bytes[i];
+		out.insert(out.end(), (const unsigned char*)data[i], (const unsigned char*)data[i] + bytes[i]);
+	}
+	out.resize((out.size() + TMESH_ALIGNMENT - 1) / TMESH_ALIGNMENT * TMESH_ALIGNMENT, 0);
+	header.file_bytes = out.size();
+	memcpy(out.data(), &header, sizeof(header));
+	memcpy(out.data() + sizeof(header), sections, sizeof(sections));
+	return out;
+}
+
+// Data sections of a loaded and optimized file, concatenated
+static std::vector<unsigned char> optimizedData(const char *path, ThreadPool *pool, unsigned *subsets)
+{
+	std::vector<unsigned char> out;
+	TMeshData data;
+	if (data.load(path) != TMESH_ERROR::NONE) return out;
+	*subsets = data.optimize(pool);
+	for (unsigned i = 0; i < data.reader().sections().size(); i++){
+		const TMESH_SECTION &s = data.reader().sections()[i];
+		if (s.type < TMESH_SECTION_TYPE::VERTEX_DATA) continue;
+		out.insert(out.end(), (const unsigned char*)data.data(i), (const unsigned char*)data.data(i) + s.bytes);
+	}
+	return out;
+}
+
+static void testThreaded(unsigned threads)
+{
+	const char *path = "mesh_opt_grid.tmesh";
+	std::vector<unsigned char> image = gridTMesh(96, 24, 3);
+	TMeshReader reader;
+	TMESH_ERROR::ID id = reader.parse(image.data(), image.size());
+	report("grid_tmesh_valid", id == TMESH_ERROR::NONE && writeFile(path, image), TMeshErrorName(id));
+
+	ThreadPool pool(threads);
+	unsigned serial_subsets = 0, pool_subsets = 0;
+	std::vector<unsigned char> serial = optimizedData(path, nullptr, &serial_subsets);
+	std::vector<unsigned char> parallel = optimizedData(path, &pool, &pool_subsets);
+	remove(path);
+	report("threaded_equals_serial", !serial.empty() && serial == parallel && serial_subsets == 24 && pool_subsets == 24,
+		"threads=" + std::to_string(pool.size()) + " subsets=" + std::to_string(pool_subsets));
+
+	// the vertex fetch pass ran: the first triangle uses vertices 0, 1, 2
+	std::vector<unsigned char> original(image.begin() + (size_t)reader.sections()[8].offset, image.end());
+	unsigned first[3];
+	memcpy(first, serial.data() + reader.sections()[7].bytes, sizeof(first));
+	report("fetch_order_applied", first[0] == 0 && first[1] == 1 && first[2] == 2 && original != serial, "");
+}
+
+static int selftest(unsigned threads)
+{
+	printf("check,result,detail\n");
+	std::vector<SUBSET> subsets;
+	for (const char *path : mediaFiles(std::vector<const char*>())){
+		std::vector<SUBSET> s;
+		report(std::string("load:") + path, loadSubsets(path, &s) && !s.empty(), "");
+		subsets.insert(subsets.end(), s.begin(), s.end());
+	}
+	subsets.push_back(shuffledGrid(32, 4));
+	subsets.push_back(nestedSpheres(24));
+	testPreserved(subsets);
+	testNeverWorse(subsets);
+	testRemap(shuffledGrid(32, 5));
+	testImproves();
+	testDegenerate();
+	testThreaded(threads);
+	return report.ok() ? 0 : 1;
+}
+
+static int bench(const std::vector<const char*> &files, unsigned threads, int iterations)
+{
+	printf("mesh,pass,threads,subsets,triangles,us\n");
+	for (const char *path : files){
+		std::vector<SUBSET> subsets;
+		if (!loadSubsets(path, &subsets)) return 1;
+		unsigned long long triangles = 0;
+		for (const SUBSET &s : subsets) triangles += s.indices.size() / 3;
+		for (int o = ORDER::FORSYTH; o < ORDER::MAX; o++){
+			CLOCK::time_point t0 = CLOCK::now();
+			for (int i = 0; i < iterations; i++){
+				for (const SUBSET &s : subsets) reorder(s, (ORDER::ID)o);
+			}
+			printf("%s,%s,1,%u,%llu,%.1f\n", path, ORDER_NAME[o], (unsigned)subsets.size(), triangles, usSince(t0) / iterations);
+		}
+	}
+
+	// load time optimize() of a bigger file, per subset on the pool
+	const char *path = "mesh_opt_bench.tmesh";
+	const unsigned n = 256, bands = 64;
+	if (!writeFile(path, gridTMesh(n, bands, 6))) return 1;
+	ThreadPool pool(threads);
+	for (int mode = 0; mode < 2; mode++){
+		int runs = std::max(1, iterations / 20);
+		double us = 0;
+		for (int i = 0; i < runs; i++){
+			TMeshData data;
+			if (data.load(path) != TMESH_ERROR::NONE) return 1;
+			CLOCK::time_point t0 = CLOCK::now();
+			data.optimize(mode ? &pool : nullptr);
+			us += usSince(t0);
+		}
+		printf("synthetic_grid%u,tmesh_optimize,%u,%u,%u,%.1f\n", n, mode ? pool.size() : 0, bands, n * n * 2, us / runs);
+	}
+	remove(path);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	std::string cmd = (1 < argc) ? argv[1] : "";
+	unsigned threads = 4;
+	int iterations = 100;
+	std::vector<const char*> files;
+	for (int i = 2; i < argc; i++){
+		std::string a = argv[i];
+		bool value = i + 1 < argc;
+		if (a == "-threads" && value) threads = atoi(argv[++i]);
+		else if (a == "-iterations" && value) iterations = atoi(argv[++i]);
+		else files.push_back(argv[i]);
+	}
+	if (iterations < 1) iterations = 1;
+
+	if (cmd == "stats") return stats(mediaFiles(files));
+	if (cmd == "selftest") return selftest(threads);
+	if (cmd == "bench") return bench(mediaFiles(files), threads, iterations);
+
+	fprintf(stderr, "usage: mesh_opt stats|selftest|bench ...\n");
+	return 1;
+}
@@ -0,0 +1,287 @@
+//--------------------------------------------------------------------------------------
+// File: rt_pool.cpp
+//
+// Checks the RenderTargetPool bookkeeping behind RenderTargets, shows
+// what it saves on a window drag and what the render targets of TaaFrame
+// cost per format, without Windows or a GPU, e.g.:
+//   g++ -O2 -std=c++11 -Itpot tools/rt_pool.cpp tpot/RenderTargetPool.cpp tpot/RenderTargetFormat.cpp
+//
+//   rt_pool selftest                 grow/shrink/reuse/evict and byte size checks
+//   rt_pool drag [options]           one CSV line per granularity and stable frames
+//   rt_pool bytes [-size WxH] [-scale N]
+//                                    one CSV line per colour format: rt_color at
+//                                    N percent, rt_depth (d24s8) and 2 rt_taa
+//
+// options:
+//   -size WxH        window before the drag (default 1280x720)
+//   -pixels N        dragged by up to N pixels and back (default 400)
+//   -speed N         pixels per frame (default 8)
+//   -targets N       screen sized targets, as TaaFrame's colour, depth and 2 history (default 4)
+//   -frames N        (default 1000)
+//--------------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <set>
+#include <vector>
+#include "RenderTargetPool.h"
+#include "types.h"
+#include "selftest.h"
+
+using namespace tpot;
+
+// What a backend would hold, by surface
+struct BACKEND
+{
+	std::set<unsigned> alive;
+	bool ok = true;
+
+	RenderTargetPool::CREATE create(){
+		return [this](unsigned surface, const RT_SURFACE_DESC &){
+			if (!alive.insert(surface).second) ok = false; // created twice
+		};
+	}
+	RenderTargetPool::DESTROY destroy(){
+		return [this](unsigned surface){
+			if (!alive.erase(surface)) ok = false; // never created
+		};
+	}
+};
+
+static int selftest()
+{
+	const unsigned N = 4;	// stable frames
+	BACKEND backend;
+	RenderTargetPool pool(backend.create(), backend.destroy(), 128, N);
+
+	EXPECT(RenderTargetPool::bucket(1, 128) == 128);
+	EXPECT(RenderTargetPool::bucket(128, 128) == 128);
+	EXPECT(RenderTargetPool::bucket(129, 128) == 256);
+
+	// byte sizes
+	EXPECT(RENDER_TARGET::bytes(RENDER_TARGET::RGBA32F, 3840, 2160) == 132710400ULL);
+	EXPECT(RENDER_TARGET::bytes(RENDER_TARGET::RGBA16F, 3840, 2160) == 66355200ULL);
+	EXPECT(RENDER_TARGET::bytes(RENDER_TARGET::R11G11B10F, 3840, 2160) == 33177600ULL);
+	EXPECT(RENDER_TARGET::bytes(RENDER_TARGET::D24S8, 65536, 65536) == 17179869184ULL);	// no 32 bit overflow
+	EXPECT(RENDER_TARGET::bytesPerPixel(RENDER_TARGET::FORMAT_MAX) == 0);
+	for (int i = 0; i < RENDER_TARGET::FORMAT_MAX; i++){
+		RENDER_TARGET::FORMAT format;
+		EXPECT(RENDER_TARGET::parse(RENDER_TARGET::name((RENDER_TARGET::FORMAT)i), &format) && format == i);
+		EXPECT(0 < RENDER_TARGET::bytesPerPixel(format));
+	}
+	EXPECT(RENDER_TARGET::isDepth(RENDER_TARGET::defaultFormat(RENDER_TARGET::DEPTH)));
+	EXPECT(!RENDER_TARGET::isDepth(RENDER_TARGET::defaultFormat(RENDER_TARGET::HDR_SCREEN)));
+
+	// a new format is a new surface at once
+	{
+		BACKEND other;
+		RenderTargetPool formats(other.create(), other.destroy(), 128, N);
+		unsigned t = formats.create(RENDER_TARGET::RGBA32F, 0, 1000, 500);
+		unsigned s32 = formats.surface(t);
+		formats.setFormat(t, RENDER_TARGET::RGBA16F);
+		EXPECT(formats.surface(t) != s32 && formats.desc(formats.surface(t)).format == RENDER_TARGET::RGBA16F);
+		formats.tick();
+		EXPECT(!formats.alive(s32) && formats.surfaceCount() == 1 && other.ok);
+	}
+
+	// allocated at the bucket, drawn at the requested size
+	unsigned a = pool.create(1, 0, 1000, 500);
+	EXPECT(pool.width(a) == 1000 && pool.height(a) == 500);
+	EXPECT(pool.desc(pool.surface(a)).width == 1024 && pool.desc(pool.surface(a)).height == 512);
+	unsigned sa = pool.surface(a);
+
+	// within the bucket: nothing is created
+	pool.resize(a, 1020, 400);
+	EXPECT(pool.surface(a) == sa && pool.width(a) == 1020 && pool.height(a) == 400);
+	RenderTargetPool::STATS s = pool.takeStats();
+	EXPECT(s.created == 1 && s.resized == 1 && s.deferred == 1);
+
+	// smaller bucket: kept until stable for N ticks
+	for (unsigned i = 0; i + 1 < N; i++){
+		pool.tick();
+		EXPECT(pool.surface(a) == sa);
+	}
+	pool.resize(a, 1000, 500);	// back before it settled, the count restarts
+	for (unsigned i = 0; i < N; i++){
+		pool.tick();
+		EXPECT(pool.surface(a) == sa);
+	}
+	EXPECT(pool.takeStats().created == 0);
+
+	pool.resize(a, 600, 300);
+	for (unsigned i = 0; i < N; i++) pool.tick();
+	EXPECT(pool.surface(a) != sa);
+	EXPECT(pool.desc(pool.surface(a)).width == 640 && pool.desc(pool.surface(a)).height == 384);
+	EXPECT(pool.surfaceCount() == 2);	// the old one idles in the pool
+
+	// growing past the surface: at once, the idle surface is an exact match
+	pool.resize(a, 1000, 500);
+	EXPECT(pool.surface(a) == sa);
+	s = pool.takeStats();
+	EXPECT(s.created == 1 && s.reused == 1 && s.destroyed == 0);
+
+	// idle surfaces are destroyed by the next tick
+	pool.tick();
+	EXPECT(pool.surfaceCount() == 1 && pool.takeStats().destroyed == 1);
+
+	// the key: same size of another format or bind flags is a different surface
+	unsigned b = pool.create(2, 0, 1000, 500);
+	unsigned c = pool.create(1, 8, 1000, 500);
+	unsigned d = pool.create(1, 0, 1000, 500);
+	EXPECT(pool.surface(b) != sa && pool.surface(c) != sa && pool.surface(d) != sa);
+	EXPECT(pool.surfaceCount() == 4);
+	EXPECT(pool.pixels() == 4ULL * 1024 * 512);
+
+	// targets resized together keep matching sizes (colour and depth must)
+	for (int f = 0; f < 200; f++){
+		unsigned w = 700 + (unsigned)(f * 37) % 500, h = 300 + (unsigned)(f * 13) % 400;
+		pool.resize(a, w, h);
+		pool.resize(b, w, h);
+		if (f % 3 == 0) pool.tick();
+		EXPECT(pool.desc(pool.surface(a)).width == pool.desc(pool.surface(b)).width);
+		EXPECT(pool.desc(pool.surface(a)).height == pool.desc(pool.surface(b)).height);
+		EXPECT(w <= pool.desc(pool.surface(a)).width && h <= pool.desc(pool.surface(a)).height);
+	}
+
+	// the backend saw every surface created once and destroyed once
+	EXPECT(backend.ok && backend.alive.size() == pool.surfaceCount());
+
+	// 0 stable frames: every change gets an exact bucket on the next tick
+	BACKEND other;
+	RenderTargetPool eager(other.create(), other.destroy(), 64, 0);
+	unsigned e = eager.create(1, 0, 100, 100);
+	eager.resize(e, 60, 60);
+	eager.tick();
+	EXPECT(eager.desc(eager.surface(e)).width == 64);
+
+	printf("selftest ok\n");
+	return 0;
+}
+
+struct DRAG
+{
+	unsigned width = 1280;
+	unsigned height = 720;
+	unsigned pixels = 400;
+	unsigned speed = 8;
+	unsigned targets = 4;
+	unsigned frames = 1000;
+};
+
+static int drag(const DRAG &opt)
+{
+	static const unsigned GRANULARITY[] = { 1, 64, 128, 256 };
+	static const unsigned STABLE[] = { 0, 8, 30 };
+
+	// destroy/create on every resize, as RenderTarget::ResizedSwapChain did
+	unsigned long long naive = 0;
+	unsigned prev_w = opt.width, prev_h = opt.height;
+
+	printf("granularity,stable_frames,created,destroyed,reused,peak_mpixels,final_mpixels\n");
+	for (auto g : GRANULARITY){
+		for (auto n : STABLE){
+			BACKEND backend;
+			RenderTargetPool pool(backend.create(), backend.destroy(), g, n);
+			for (unsigned t = 0; t < opt.targets; t++) pool.create(t ? 1 : 2, 0, opt.width, opt.height);
+			pool.takeStats();
+
+			unsigned created = 0, destroyed = 0, reused = 0;
+			unsigned long long peak = 0;
+			for (unsigned f = 0; f < opt.frames; f++){
+				unsigned d = (f * opt.speed) % (2 * opt.pixels);
+				d = (d < opt.pixels) ? d : 2 * opt.pixels - d;
+				unsigned w = opt.width + d, h = opt.height + d / 2;
+				if (g == GRANULARITY[0] && n == STABLE[0]){
+					if (w != prev_w || h != prev_h) naive += opt.targets;
+					prev_w = w;
+					prev_h = h;
+				}
+
+				pool.tick();
+				for (unsigned t = 0; t < opt.targets; t++) pool.resize(t, w, h);
+				RenderTargetPool::STATS s = pool.takeStats();
+				created += s.created;
+				destroyed += s.destroyed;
+				reused += s.reused;
+				if (peak < pool.pixels()) peak = pool.pixels();
+			}
+			printf("%u,%u,%u,%u,%u,%.2f,%.2f\n", g, n, created, destroyed, reused,
+				1e-6 * (double)peak, 1e-6 * (double)pool.pixels());
+			if (!backend.ok) return 1;
+		}
+	}
+	printf("destroy/create on every resize: %llu created\n", naive);
+	return 0;
+}
+
+static int bytes(int argc, char *argv[])
+{
+	unsigned width = 1920, height = 1080, scale = 100;
+	for (int i = 0; i < argc; i++){
+		bool has_value = (i + 1 < argc);
+		if (strcmp(argv[i], "-size") == 0 && has_value){
+			if (sscanf(argv[++i], "%ux%u", &width, &height) != 2) return 2;
+		}else if (strcmp(argv[i], "-scale") == 0 && has_value){
+			scale = (unsigned)atoi(argv[++i]);
+		}else{
+			return 2;
+		}
+	}
+	if (!width || !height || !scale) return 2;
+
+	// as RenderTargets: scaled, then rounded up to the pool's buckets
+	auto size = [](unsigned s, unsigned percent){
+		unsigned v = (unsigned)((float)s * 0.01f * (float)percent + 0.5f);
+		return RenderTargetPool::bucket(v ? v : 1, RenderTargetPool::GRANULARITY);
+	};
+	unsigned rw = size(width, scale), rh = size(height, scale);
+	unsigned fw = size(width, 100), fh = size(height, 100);
+	unsigned long long depth = RENDER_TARGET::bytes(RENDER_TARGET::D24S8, rw, rh);
+
+	const double MB = 1.0 / (1024.0 * 1024.0);
+	double ref = 0.0;
+	printf("format,bytes_per_pixel,color_mb,history_mb,depth_mb,total_mb,vs_rgba32f\n");
+	for (int i = 0; i < RENDER_TARGET::FORMAT_MAX; i++){
+		RENDER_TARGET::FORMAT format = (RENDER_TARGET::FORMAT)i;
+		if (RENDER_TARGET::isDepth(format)) continue;
+		unsigned long long color = RENDER_TARGET::bytes(format, rw, rh);
+		unsigned long long history = 2 * RENDER_TARGET::bytes(format, fw, fh);
+		double total = MB * (double)(color + history + depth);
+		if (format == RENDER_TARGET::RGBA32F) ref = total;
+		printf("%s,%u,%.1f,%.1f,%.1f,%.1f,%.2f\n", RENDER_TARGET::name(format), RENDER_TARGET::bytesPerPixel(format),
+			MB * (double)color, MB * (double)history, MB * (double)depth, total, ref / total);
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc == 2 && strcmp(argv[1], "selftest") == 0) return selftest();
+	if (2 <= argc && strcmp(argv[1], "bytes") == 0 && bytes(argc - 2, argv + 2) == 0) return 0;
+
+	if (2 <= argc && strcmp(argv[1], "drag") == 0){
+		DRAG opt;
+		bool ok = true;
+		for (int i = 2; i < argc && ok; i++){
+			const char *a = argv[i];
+			bool has_value = (i + 1 < argc);
+			if (strcmp(a, "-size") == 0 && has_value){
+				ok = sscanf(argv[++i], "%ux%u", &opt.width, &opt.height) == 2;
+			}else if (strcmp(a, "-pixels") == 0 && has_value){
+				opt.pixels = (unsigned)atoi(argv[++i]);
+			}else if (strcmp(a, "-speed") == 0 && has_value){
+				opt.speed = (unsigned)atoi(argv[++i]);
+			}else if (strcmp(a, "-targets") == 0 && has_value){
+				opt.targets = (unsigned)atoi(argv[++i]);
+			}else if (strcmp(a, "-frames") == 0 && has_value){
+				opt.frames = (unsigned)atoi(argv[++i]);
+			}else{
+				ok = false;
+			}
+		}
+		if (ok && 0 < opt.pixels && 0 < opt.targets) return drag(opt);
+	}
+
+	fprintf(stderr, "usage: rt_pool selftest | drag [-size WxH] [-pixels N] [-speed N] [-targets N] [-frames N] | bytes [-size WxH] [-scale N]\n");
+	return 2;
+}
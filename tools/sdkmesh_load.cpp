@@ -0,0 +1,147 @@
+//--------------------------------------------------------------------------------------
+// File: sdkmesh_load.cpp
+//
+// Portable check of the memory mapped load of CDXUTSDKMesh::CreateFromFile:
+// the static part (headers, meshes, subsets, frames, materials) is copied for
+// the pointer fixup, vertex and index data are read straight from the read
+// only view. Compared with reading the whole file into the heap, e.g.:
+//   g++ -O2 -std=c++11 -Itpot tools/sdkmesh_load.cpp tpot/SDKMeshParser.cpp tpot/MappedFile.cpp
+//
+//   sdkmesh_load [-iterations N] [file.sdkmesh ...]
+//       default Media/ColumnScene/Poles.sdkmesh and Media/ColumnScene/scene.sdkmesh
+//--------------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "SDKMeshParser.h"
+#include "selftest.h"
+
+using namespace tpot;
+
+// Stands in for the upload of a buffer: every byte is read once
+static unsigned long long checksum(const unsigned char *p, size_t n)
+{
+	unsigned long long h = 14695981039346656037ull;
+	for (size_t i = 0; i < n; i++){
+		h ^= p[i];
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+
+// What CreateFromMemory with bCopyStatic does with the file: the static part
+// into the heap, each buffer from the view
+struct LOAD
+{
+	std::vector<unsigned char> heap;	// static part
+	std::vector<unsigned long long> sums;	// per vertex buffer, then per index buffer
+	unsigned vertex_buffers;
+	unsigned index_buffers;
+	unsigned long long buffer_bytes;
+};
+
+static bool load(const unsigned char *data, size_t size, LOAD *out)
+{
+	SDKMeshParser parser;
+	if (parser.parse(data, size) != SDKMESH_ERROR::NONE) return false;
+	out->heap.assign(data, data + parser.staticSize());
+
+	out->sums.clear();
+	out->vertex_buffers = (unsigned)parser.vertexBuffers().size();
+	out->index_buffers = (unsigned)parser.indexBuffers().size();
+	out->buffer_bytes = 0;
+	for (unsigned i = 0; i < out->vertex_buffers; i++){
+		Span<unsigned char> vb = parser.vertexData(i);
+		out->sums.push_back(checksum(vb.data(), vb.size()));
+		out->buffer_bytes += vb.size();
+	}
+	for (unsigned i = 0; i < out->index_buffers; i++){
+		Span<unsigned char> ib = parser.indexData(i);
+		out->sums.push_back(checksum(ib.data(), ib.size()));
+		out->buffer_bytes += ib.size();
+	}
+	return true;
+}
+
+static double elapsedUs(std::chrono::high_resolution_clock::time_point t0)
+{
+	return std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - t0).count();
+}
+
+int main(int argc, char *argv[])
+{
+	int iterations = 200;
+	std::vector<const char*> files;
+	for (int i = 1; i < argc; i++){
+		if (strcmp(argv[i], "-iterations") == 0 && i + 1 < argc){
+			iterations = atoi(argv[++i]);
+		}else if (argv[i][0] == '-'){
+			fprintf(stderr, "usage: sdkmesh_load [-iterations N] [file.sdkmesh ...]\n");
+			return 1;
+		}else{
+			files.push_back(argv[i]);
+		}
+	}
+	if (files.empty()){
+		files.push_back("Media/ColumnScene/Poles.sdkmesh");
+		files.push_back("Media/ColumnScene/scene.sdkmesh");
+	}
+	iterations = (0 < iterations) ? iterations : 1;
+
+	typedef std::chrono::high_resolution_clock CLOCK;
+	bool ok = true;
+	std::string report = "file,bytes,vertex_buffers,index_buffers,buffer_bytes,read_heap_bytes,mapped_heap_bytes,read_us,mapped_us\n";
+	printf("file,check,result\n");
+	for (const char *path : files){
+		std::vector<unsigned char> bytes;
+		MappedFile view;
+		LOAD from_read, from_view;
+		bool read = readFile(path, &bytes);
+		bool mapped = view.open(path);
+		bool parsed_read = read && load(bytes.data(), bytes.size(), &from_read);
+		bool parsed_view = mapped && load(view.data(), view.size(), &from_view);
+
+		struct CHECK{ const char *name; bool pass; };
+		const CHECK checks[] = {
+			{ "mapped", mapped },
+			{ "same_bytes", read && mapped && view.size() == bytes.size() && memcmp(view.data(), bytes.data(), bytes.size()) == 0 },
+			{ "parsed", parsed_read && parsed_view },
+			{ "same_buffers", parsed_read && parsed_view && from_read.sums == from_view.sums },
+			{ "static_only_copied", parsed_view && from_view.heap.size() < view.size() },
+		};
+		for (const CHECK &c : checks){
+			ok = ok && c.pass;
+			printf("%s,%s,%s\n", path, c.name, c.pass ? "ok" : "FAIL");
+		}
+		if (!parsed_read || !parsed_view) continue;
+		view.close();
+
+		// the old path: new[] of the whole file, ReadFile, fix up in place
+		CLOCK::time_point t0 = CLOCK::now();
+		for (int i = 0; i < iterations; i++){
+			readFile(path, &bytes);
+			load(bytes.data(), bytes.size(), &from_read);
+		}
+		double read_us = elapsedUs(t0) / iterations;
+
+		t0 = CLOCK::now();
+		for (int i = 0; i < iterations; i++){
+			view.open(path);
+			load(view.data(), view.size(), &from_view);
+			view.close();
+		}
+		double mapped_us = elapsedUs(t0) / iterations;
+
+		char line[512];
+		snprintf(line, sizeof(line), "%s,%u,%u,%u,%llu,%u,%u,%.1f,%.1f\n", path, (unsigned)bytes.size(),
+			from_view.vertex_buffers, from_view.index_buffers, from_view.buffer_bytes,
+			(unsigned)bytes.size(), (unsigned)from_view.heap.size(), read_us, mapped_us);
+		report += line;
+	}
+	printf("\n%s", report.c_str());
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,249 @@
+//--------------------------------------------------------------------------------------
+// File: sdkmesh_parse.cpp
+//
+// Checks and times tpot::SDKMeshParser, the bounds checked reader behind
+// CDXUTSDKMesh, e.g.:
+//   g++ -O2 -std=c++11 -Itpot tools/sdkmesh_parse.cpp tpot/SDKMeshParser.cpp
+// add -g -fsanitize=address,undefined to catch a read past a truncated copy.
+//
+//   sdkmesh_parse selftest [file.sdkmesh ...]
+//       media files parse, bounds match the old CDXUTSDKMesh loop, every
+//       truncation and each targeted corruption is rejected with its error,
+//       random byte flips never read out of bounds
+//   sdkmesh_parse bench [-iterations N] [file.sdkmesh ...]
+//--------------------------------------------------------------------------------------
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "SDKMeshParser.h"
+#include "selftest.h"
+
+using namespace tpot;
+
+template<class T>
+static T load(const std::vector<unsigned char> &bytes, unsigned long long offset)
+{
+	T v;
+	memcpy(&v, &bytes[(size_t)offset], sizeof(v));
+	return v;
+}
+
+template<class T>
+static void store(std::vector<unsigned char> &bytes, unsigned long long offset, const T &v)
+{
+	memcpy(&bytes[(size_t)offset], &v, sizeof(v));
+}
+
+// The bounding box loop CreateFromMemory had before the parser: stream 0,
+// float3 at the start of the vertex, VertexStart not applied
+static void oldBounds(const SDKMeshParser &parser, unsigned m, float center[3], float extents[3])
+{
+	const SDKMESH_FILE_MESH &mesh = parser.meshes()[m];
+	const SDKMESH_FILE_INDEX_BUFFER &ib = parser.indexBuffers()[mesh.IndexBuffer];
+	const unsigned char *indices = parser.indexData(mesh.IndexBuffer).data();
+	const unsigned char *verts = parser.vertexData(mesh.VertexBuffers[0]).data();
+	unsigned long long stride = parser.vertexBuffers()[mesh.VertexBuffers[0]].StrideBytes;
+
+	float lower[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float upper[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (unsigned id : parser.meshSubsets(m)){
+		const SDKMESH_FILE_SUBSET &subset = parser.subsets()[id];
+		for (unsigned long long i = subset.IndexStart; i < subset.IndexStart + subset.IndexCount; i++){
+			unsigned index = 0;
+			memcpy(&index, indices + i * (ib.IndexType ? 4 : 2), ib.IndexType ? 4 : 2);
+			float pt[3];
+			memcpy(pt, verts + stride * index, sizeof(pt));
+			for (int c = 0; c < 3; c++){
+				if (pt[c] < lower[c]) lower[c] = pt[c];
+				if (pt[c] > upper[c]) upper[c] = pt[c];
+			}
+		}
+	}
+	for (int c = 0; c < 3; c++){
+		extents[c] = (upper[c] - lower[c]) * 0.5f;
+		center[c] = lower[c] + extents[c];
+	}
+}
+
+static const CORRUPTION<SDKMeshParser, SDKMESH_ERROR::ID> CORRUPTIONS[] = {
+	{ "version", SDKMESH_ERROR::VERSION, [](std::vector<unsigned char> &b, const SDKMeshParser &){
+		store<unsigned>(b, offsetof(SDKMESH_FILE_HEADER, Version), 100);
+	} },
+	{ "big_endian", SDKMESH_ERROR::ENDIAN, [](std::vector<unsigned char> &b, const SDKMeshParser &){
+		b[offsetof(SDKMESH_FILE_HEADER, IsBigEndian)] = 1;
+	} },
+	{ "static_size", SDKMESH_ERROR::STATIC_SIZE, [](std::vector<unsigned char> &b, const SDKMeshParser &){
+		store<unsigned long long>(b, offsetof(SDKMESH_FILE_HEADER, NonBufferDataSize), ~0ull - 8);
+	} },
+	{ "mesh_table_past_static", SDKMESH_ERROR::TABLE, [](std::vector<unsigned char> &b, const SDKMeshParser &p){
+		store<unsigned long long>(b, offsetof(SDKMESH_FILE_HEADER, MeshDataOffset), p.staticSize() - 8);
+	} },
+	{ "subset_table_misaligned", SDKMESH_ERROR::TABLE, [](std::vector<unsigned char> &b, const SDKMeshParser &p){
+		store<unsigned long long>(b, offsetof(SDKMESH_FILE_HEADER, SubsetDataOffset), p.header().SubsetDataOffset + 1);
+	} },
+	{ "vertex_count_huge", SDKMESH_ERROR::TABLE, [](std::vector<unsigned char> &b, const SDKMeshParser &){
+		store<unsigned>(b, offsetof(SDKMESH_FILE_HEADER, NumVertexBuffers), 0x7fffffff);
+	} },
+	{ "vertex_data_past_end", SDKMESH_ERROR::VERTEX_BUFFER, [](std::vector<unsigned char> &b, const SDKMeshParser &p){
+		store<unsigned long long>(b, p.header().VertexStreamHeadersOffset + offsetof(SDKMESH_FILE_VERTEX_BUFFER, DataOffset), b.size() - 4);
+	} },
+	{ "vertex_offset_wraps", SDKMESH_ERROR::VERTEX_BUFFER, [](std::vector<unsigned char> &b, const SDKMeshParser &p){
+		store<unsigned long long>(b, p.header().VertexStreamHeadersOffset + offsetof(SDKMESH_FILE_VERTEX_BUFFER, SizeBytes), ~0ull);
+	} },
+	{ "vertices_past_size", SDKMESH_ERROR::VERTEX_BUFFER, [](std::vector<unsigned char> &b, const SDKMeshParser &p){
+		unsigned long long at = p.header().VertexStreamHeadersOffset + offsetof(SDKMESH_FILE_VERTEX_BUFFER, NumVertices);
+		store<unsigned long long>(b, at, load<unsigned long long>(b, at) + 1);
+	} },
+	{ "index_type", SDKMESH_ERROR::INDEX_BUFFER, [](std::vector<unsigned char> &b, const SDKMeshParser &p){
+		store<unsigned>(b, p.header().IndexStreamHeadersOffset + offsetof(SDKMESH_FILE_INDEX_BUFFER, IndexType), 2);
+	} },
+	{ "indices_past_size", SDKMESH_ERROR::INDEX_BUFFER, [](std::vector<unsigned char> &b, const SDKMeshParser &p){
+		store<unsigned long long>(b, p.header().IndexStreamHeadersOffset + offsetof(SDKMESH_FILE_INDEX_BUFFER, NumIndices), ~0ull / 2);
+	} },
+	{ "mesh_index_buffer", SDKMESH_ERROR::MESH, [](std::vector<unsigned char> &b, const SDKMeshParser &p){
+		store<unsigned>(b, p.header().MeshDataOffset + offsetof(SDKMESH_FILE_MESH, IndexBuffer), p.header().NumIndexBuffers);
+	} },
+	{ "mesh_stream", SDKMESH_ERROR::MESH, [](std::vector<unsigned char> &b, const SDKMeshParser &p){
+		store<unsigned>(b, p.header().MeshDataOffset + offsetof(SDKMESH_FILE_MESH, VertexBuffers), 0xffffff00u);
+	} },
+	{ "mesh_subset_list", SDKMESH_ERROR::MESH, [](std::vector<unsigned char> &b, const SDKMeshParser &p){
+		store<unsigned long long>(b, p.header().MeshDataOffset + offsetof(SDKMESH_FILE_MESH, SubsetOffset), b.size());
+	} },
+	{ "subset_index_range", SDKMESH_ERROR::SUBSET, [](std::vector<unsigned char> &b, const SDKMeshParser &p){
+		store<unsigned long long>(b, p.header().SubsetDataOffset + offsetof(SDKMESH_FILE_SUBSET, IndexCount), ~0ull);
+	} },
+	{ "subset_material", SDKMESH_ERROR::SUBSET, [](std::vector<unsigned char> &b, const SDKMeshParser &p){
+		store<unsigned>(b, p.header().SubsetDataOffset + offsetof(SDKMESH_FILE_SUBSET, MaterialID), p.header().NumMaterials);
+	} },
+	{ "index_value", SDKMESH_ERROR::INDEX_VALUE, [](std::vector<unsigned char> &b, const SDKMeshParser &p){
+		const SDKMESH_FILE_INDEX_BUFFER &ib = p.indexBuffers()[0];
+		unsigned v = (unsigned)p.vertexBuffers()[0].NumVertices;
+		memcpy(&b[(size_t)ib.DataOffset], &v, ib.IndexType ? 4 : 2);
+	} },
+	{ "frame_cycle", SDKMESH_ERROR::FRAME, [](std::vector<unsigned char> &b, const SDKMeshParser &p){
+		store<unsigned>(b, p.header().FrameDataOffset + offsetof(SDKMESH_FILE_FRAME, SiblingFrame), 0);
+	} },
+	{ "frame_mesh", SDKMESH_ERROR::FRAME, [](std::vector<unsigned char> &b, const SDKMeshParser &p){
+		store<unsigned>(b, p.header().FrameDataOffset + offsetof(SDKMESH_FILE_FRAME, Mesh), p.header().NumMeshes);
+	} },
+	{ "material_name", SDKMESH_ERROR::NAME, [](std::vector<unsigned char> &b, const SDKMeshParser &p){
+		memset(&b[(size_t)(p.header().MaterialDataOffset + offsetof(SDKMESH_FILE_MATERIAL, DiffuseTexture))], 'a', SDKMESH_MAX_PATH);
+	} },
+};
+
+static std::vector<const char*> mediaFiles(int argc, char *argv[], int first)
+{
+	std::vector<const char*> files;
+	for (int i = first; i < argc; i++){
+		if (argv[i][0] != '-') files.push_back(argv[i]);
+	}
+	if (files.empty()){
+		files.push_back("Media/ColumnScene/Poles.sdkmesh");
+		files.push_back("Media/ColumnScene/scene.sdkmesh");
+	}
+	return files;
+}
+
+static int selftest(const std::vector<const char*> &files)
+{
+	CheckReport report;
+
+	printf("file,check,result,detail\n");
+	for (const char *path : files){
+		std::vector<unsigned char> bytes;
+		SDKMeshParser parser;
+		bool read = readFile(path, &bytes);
+		SDKMESH_ERROR::ID id = read ? parser.parse(bytes.data(), bytes.size()) : SDKMESH_ERROR::TRUNCATED;
+		report(path, "parse", read && id == SDKMESH_ERROR::NONE, SDKMeshErrorName(id));
+		if (id != SDKMESH_ERROR::NONE) continue;
+
+		float max_diff = 0.0f;
+		for (unsigned m = 0; m < parser.meshes().size(); m++){
+			float center[3], extents[3];
+			oldBounds(parser, m, center, extents);
+			const SDKMeshParser::BOUNDS &b = parser.meshBounds(m);
+			for (int c = 0; c < 3; c++){
+				max_diff = fmaxf(max_diff, fmaxf(fabsf(center[c] - b.center[c]), fabsf(extents[c] - b.extents[c])));
+			}
+		}
+		char detail[64];
+		snprintf(detail, sizeof(detail), "max_diff=%g", max_diff);
+		report(path, "bounds_match_old_loop", max_diff == 0.0f, detail);
+
+		// each prefix in a buffer of its own size, so a read past it is caught
+		unsigned accepted = 0;
+		for (size_t n = 0; n < bytes.size(); n++){
+			std::vector<unsigned char> prefix(bytes.begin(), bytes.begin() + n);
+			SDKMeshParser p;
+			if (p.parse(prefix.empty() ? nullptr : prefix.data(), n) == SDKMESH_ERROR::NONE) accepted++;
+		}
+		snprintf(detail, sizeof(detail), "sizes=%u accepted=%u", (unsigned)bytes.size(), accepted);
+		report(path, "truncations_rejected", accepted == 0, detail);
+
+		checkCorruptions(report, path, bytes, parser, CORRUPTIONS, SDKMeshErrorName);
+
+		// random flips in the static part, where every offset lives
+		std::mt19937 rng(1234);
+		unsigned trials = 20000, rejected = 0;
+		for (unsigned t = 0; t < trials; t++){
+			std::vector<unsigned char> bad = bytes;
+			unsigned flips = 1 + rng() % 4;
+			for (unsigned f = 0; f < flips; f++){
+				bad[rng() % parser.staticSize()] ^= (unsigned char)(1u << (rng() % 8));
+			}
+			SDKMeshParser p;
+			if (p.parse(bad.data(), bad.size()) != SDKMESH_ERROR::NONE) rejected++;
+		}
+		snprintf(detail, sizeof(detail), "trials=%u rejected=%u", trials, rejected);
+		report(path, "random_flips", true, detail);
+	}
+	return report.ok() ? 0 : 1;
+}
+
+static int bench(const std::vector<const char*> &files, int iterations)
+{
+	typedef std::chrono::high_resolution_clock CLOCK;
+	printf("file,bytes,meshes,subsets,indices,parse_us,MB_per_s\n");
+	for (const char *path : files){
+		std::vector<unsigned char> bytes;
+		SDKMeshParser parser;
+		if (!readFile(path, &bytes) || parser.parse(bytes.data(), bytes.size()) != SDKMESH_ERROR::NONE){
+			printf("%s,FAIL\n", path);
+			return 1;
+		}
+		unsigned long long indices = 0;
+		for (const SDKMESH_FILE_SUBSET &s : parser.subsets()) indices += s.IndexCount;
+
+		CLOCK::time_point t0 = CLOCK::now();
+		for (int i = 0; i < iterations; i++) parser.parse(bytes.data(), bytes.size());
+		double us = std::chrono::duration<double, std::micro>(CLOCK::now() - t0).count() / iterations;
+		printf("%s,%u,%u,%u,%llu,%.2f,%.0f\n", path, (unsigned)bytes.size(), (unsigned)parser.meshes().size(),
+			(unsigned)parser.subsets().size(), indices, us, (double)bytes.size() / us);
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	std::string cmd = (1 < argc) ? argv[1] : "";
+	int iterations = 10000;
+	for (int i = 2; i + 1 < argc; i++){
+		if (strcmp(argv[i], "-iterations") == 0){
+			iterations = atoi(argv[i + 1]);
+			argv[i + 1] = (char*)"-";
+		}
+	}
+	iterations = (0 < iterations) ? iterations : 1;
+
+	if (cmd == "selftest") return selftest(mediaFiles(argc, argv, 2));
+	if (cmd == "bench") return bench(mediaFiles(argc, argv, 2), iterations);
+
+	fprintf(stderr, "usage: sdkmesh_parse selftest|bench [-iterations N] [file.sdkmesh ...]\n");
+	return 1;
+}
@@ -0,0 +1,78 @@
+#ifndef TPOT_TOOLS_SELFTEST_H__
+#define TPOT_TOOLS_SELFTEST_H__
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// The selftest commands of the tools: returns 1 from the calling function
+// on the first failed condition, naming it and its line
+#define EXPECT(c) do{ if (!(c)){ fprintf(stderr, "selftest: %s failed (line %d)\n", #c, __LINE__); return 1; } }while(0)
+
+// The whole file, false when it is missing or empty
+inline bool readFile(const std::string &path, std::vector<unsigned char> *data)
+{
+	FILE *fp = fopen(path.c_str(), "rb");
+	if (!fp) return false;
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	data->resize(0 < size ? (size_t)size : 0);
+	bool ok = (0 < size) && fread(data->data(), 1, data->size(), fp) == data->size();
+	fclose(fp);
+	return ok;
+}
+
+inline bool writeFile(const std::string &path, const std::vector<unsigned char> &data)
+{
+	FILE *fp = fopen(path.c_str(), "wb");
+	if (!fp) return false;
+	bool ok = fwrite(data.data(), 1, data.size(), fp) == data.size();
+	return (fclose(fp) == 0) && ok;
+}
+
+// The check commands print one CSV line per check, [file,]check,ok|FAIL,detail,
+// and exit with 1 when any of them failed
+class CheckReport
+{
+	bool ok_;
+
+public:
+	CheckReport() : ok_(true) {}
+
+	void operator()(const std::string &check, bool pass, const std::string &detail){
+		ok_ = ok_ && pass;
+		printf("%s,%s,%s\n", check.c_str(), pass ? "ok" : "FAIL", detail.c_str());
+	}
+	void operator()(const char *file, const std::string &check, bool pass, const std::string &detail){
+		ok_ = ok_ && pass;
+		printf("%s,%s,%s,%s\n", file, check.c_str(), pass ? "ok" : "FAIL", detail.c_str());
+	}
+
+	bool ok() const { return ok_; }
+};
+
+// One corruption of a valid file and the error PARSER::parse must give
+template<class PARSER, class ERROR_ID>
+struct CORRUPTION
+{
+	const char *name;
+	ERROR_ID expect;
+	void (*apply)(std::vector<unsigned char> &bytes, const PARSER &parser);
+};
+
+// Each corruption on a copy of the file a parser accepted, one corrupt_<name> row each
+template<class PARSER, class ERROR_ID, size_t N>
+void checkCorruptions(CheckReport &report, const char *file, const std::vector<unsigned char> &bytes, const PARSER &parser,
+	const CORRUPTION<PARSER, ERROR_ID> (&corruptions)[N], const char *(*errorName)(ERROR_ID))
+{
+	for (const CORRUPTION<PARSER, ERROR_ID> &c : corruptions){
+		std::vector<unsigned char> bad = bytes;
+		c.apply(bad, parser);
+		PARSER p;
+		ERROR_ID got = p.parse(bad.data(), bad.size());
+		report(file, std::string("corrupt_") + c.name, got == c.expect, errorName(got));
+	}
+}
+
+#endif // TPOT_TOOLS_SELFTEST_H__
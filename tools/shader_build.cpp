@@ -0,0 +1,147 @@
+//--------------------------------------------------------------------------------------
+// File: shader_build.cpp
+//
+// Runs the startup shader build of Shader::Shader (BuildShaders over the
+// ShaderPermutations table) with a stub compiler, so the scheduling can be
+// timed and checked without Windows or the HLSL compiler, e.g.:
+//   g++ -O2 -std=c++11 -pthread -Itpot tools/shader_build.cpp tpot/ShaderPermutation.cpp
+//       tpot/JobGraph.cpp tpot/ThreadPool.cpp tpot/ShaderCache.cpp
+//
+//   shader_build [options]   one CSV line per thread count
+//
+// options:
+//   -ms N          stub compile time per permutation (default 40)
+//   -threads N     only this many workers (default 0,1,2,4,... up to hardware)
+//   -fail N        the stub fails permutation N; its create must be skipped
+//   -cache DIR     keys the stub blobs with ShaderCache in DIR, the second pass hits
+//   -dir DIR       where the .hlsl files are (default .)
+//--------------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ShaderPermutation.h"
+#include "ShaderCache.h"
+#include "ThreadPool.h"
+
+using namespace tpot;
+
+struct OPTIONS
+{
+	int ms = 40;
+	int threads = -1;
+	int fail = -1;
+	const char *cache = nullptr;
+	std::string dir = ".";
+};
+
+// false on a check failure
+static bool build(unsigned threads, const OPTIONS &opt, ShaderCache *pCache, SHADER_BUILD_STATS *stats)
+{
+	UINT count;
+	const SHADER_PERMUTATION *perm = ShaderPermutations(&count);
+	std::thread::id owner = std::this_thread::get_id();
+	std::vector<int> created(count, 0);
+	bool ok = true;
+
+	auto compile = [&](UINT i, std::vector<char> *blob){
+		if ((int)i == opt.fail) return false;
+
+		std::string path = opt.dir + "/" + perm[i].file;
+		ShaderCache::KEY key = ShaderCache::key(path.c_str(), perm[i].entry, perm[i].profile, perm[i].macros, 0);
+		if (pCache && pCache->load(key, blob)) return true;
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(opt.ms));
+		blob->assign((const char*)&key, (const char*)&key + sizeof(key));
+		if (pCache) pCache->store(key, blob->data(), blob->size());
+		return true;
+	};
+	auto create = [&](UINT i, const std::vector<char> &blob){
+		if (std::this_thread::get_id() != owner){
+			fprintf(stderr, "%s created off the owner thread\n", perm[i].name);
+			ok = false;
+		}
+		if (blob.size() != sizeof(ShaderCache::KEY)){
+			fprintf(stderr, "%s created without its blob\n", perm[i].name);
+			ok = false;
+		}
+		created[i]++;
+		return true;
+	};
+
+	std::unique_ptr<ThreadPool> pool(threads ? new ThreadPool(threads) : nullptr);
+	bool built = BuildShaders(pool.get(), count, compile, create, stats);
+
+	for (UINT i = 0; i < count; i++){
+		int expected = ((int)i == opt.fail) ? 0 : 1;
+		if (created[i] != expected){
+			fprintf(stderr, "%s created %d times, expected %d\n", perm[i].name, created[i], expected);
+			ok = false;
+		}
+	}
+	if (built != (opt.fail < 0 || (int)count <= opt.fail)){
+		fprintf(stderr, "BuildShaders returned %d\n", (int)built);
+		ok = false;
+	}
+	return ok;
+}
+
+int main(int argc, char *argv[])
+{
+	OPTIONS opt;
+	for (int i = 1; i < argc; i++){
+		const char *a = argv[i];
+		bool has_value = (i + 1 < argc);
+		if (strcmp(a, "-ms") == 0 && has_value){
+			opt.ms = atoi(argv[++i]);
+		}else if (strcmp(a, "-threads") == 0 && has_value){
+			opt.threads = atoi(argv[++i]);
+		}else if (strcmp(a, "-fail") == 0 && has_value){
+			opt.fail = atoi(argv[++i]);
+		}else if (strcmp(a, "-cache") == 0 && has_value){
+			opt.cache = argv[++i];
+		}else if (strcmp(a, "-dir") == 0 && has_value){
+			opt.dir = argv[++i];
+		}else{
+			fprintf(stderr, "usage: shader_build [-ms N] [-threads N] [-fail N] [-cache DIR] [-dir DIR]\n");
+			return 2;
+		}
+	}
+
+	std::vector<unsigned> threads;
+	if (0 <= opt.threads){
+		threads.push_back((unsigned)opt.threads);
+	}else{
+		unsigned hw = std::thread::hardware_concurrency();
+		threads.push_back(0);
+		for (unsigned t = 1; t < hw; t *= 2) threads.push_back(t);
+		if (hw) threads.push_back(hw);
+	}
+
+	std::unique_ptr<ShaderCache> cache(opt.cache ? new ShaderCache(opt.cache) : nullptr);
+	if (cache) cache->trim(0);
+
+	bool ok = true;
+	double serial_ms = 0.0;
+	printf("threads,permutations,failed,wall_ms,compile_ms,speedup%s\n", cache ? ",cache_hits" : "");
+	for (size_t t = 0; t < threads.size(); t++){
+		for (int pass = 0; pass < (cache ? 2 : 1); pass++){
+			if (cache && pass == 0) cache->trim(0);
+			ShaderCache::STATS before = cache ? cache->stats() : ShaderCache::STATS();
+
+			SHADER_BUILD_STATS stats;
+			ok = build(threads[t], opt, cache.get(), &stats) && ok;
+			if (t == 0 && pass == 0) serial_ms = stats.wall_ms;
+
+			printf("%u,%u,%u,%.1f,%.1f,%.2f", threads[t], stats.compiled + stats.failed, stats.failed,
+				stats.wall_ms, stats.compile_ms, serial_ms / stats.wall_ms);
+			if (cache) printf(",%u", cache->stats().hits - before.hits);
+			printf("\n");
+		}
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+//--------------------------------------------------------------------------------------
+// File: shader_cache.cpp
+//
+// Inspects the ShaderCache directory Shader::Shader writes, and checks
+// the cache logic without Windows or the HLSL compiler, e.g.:
+//   g++ -O2 -std=c++11 -pthread -Itpot tools/shader_cache.cpp tpot/ShaderCache.cpp
+//
+//   shader_cache key FILE ENTRY PROFILE [NAME=VALUE ...]   the key a compile would use
+//   shader_cache list DIR                                  blobs, least recently used first
+//   shader_cache check DIR                                 loads every blob, drops bad ones
+//   shader_cache trim DIR BYTES                            LRU eviction down to BYTES
+//   shader_cache selftest DIR                              store/load/evict/corrupt in DIR
+//--------------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include "ShaderCache.h"
+#include "selftest.h"
+
+using namespace tpot;
+
+static int key(int argc, char *argv[])
+{
+	if (argc < 3) return 2;
+
+	std::vector<std::string> name, value;
+	for (int i = 3; i < argc; i++){
+		const char *eq = strchr(argv[i], '=');
+		name.push_back(eq ? std::string(argv[i], eq - argv[i]) : std::string(argv[i]));
+		value.push_back(eq ? std::string(eq + 1) : std::string());
+	}
+	std::vector<SHADER_MACRO> macros;
+	for (size_t i = 0; i < name.size(); i++){
+		SHADER_MACRO m = { name[i].c_str(), value[i].c_str() };
+		macros.push_back(m);
+	}
+	SHADER_MACRO end = { nullptr, nullptr };
+	macros.push_back(end);
+
+	ShaderCache::KEY k = ShaderCache::key(argv[0], argv[1], argv[2], &macros[0], 0);
+	if (!k){
+		fprintf(stderr, "cannot read %s\n", argv[0]);
+		return 1;
+	}
+	printf("%016llx\n", k);
+	return 0;
+}
+
+static int list(const char *dir)
+{
+	ShaderCache cache(dir);
+	for (auto k : cache.keys()){
+		printf("%016llx\n", k);
+	}
+	printf("%u blobs, %u bytes\n", (unsigned)cache.count(), (unsigned)cache.size());
+	return 0;
+}
+
+static int check(const char *dir)
+{
+	ShaderCache cache(dir);
+	std::vector<char> blob;
+	unsigned bad = 0;
+	for (auto k : cache.keys()){
+		if (!cache.load(k, &blob)){
+			printf("%016llx dropped\n", k);
+			bad++;
+		}
+	}
+	printf("%u blobs ok, %u dropped\n", (unsigned)cache.count(), bad);
+	return bad ? 1 : 0;
+}
+
+static int trim(const char *dir, size_t bytes)
+{
+	ShaderCache cache(dir);
+	cache.trim(bytes);
+	printf("%u evicted, %u blobs, %u bytes\n", cache.stats().evictions, (unsigned)cache.count(), (unsigned)cache.size());
+	return 0;
+}
+
+static int selftest(const char *dir)
+{
+	{ ShaderCache create(dir); }
+	std::string src = std::string(dir) + "/selftest.hlsl";
+	std::string inc = std::string(dir) + "/selftest_inc.hlsl";
+	FILE *fp = fopen(inc.c_str(), "wb");
+	EXPECT(fp);
+	fputs("float4 c;\n", fp);
+	fclose(fp);
+	fp = fopen(src.c_str(), "wb");
+	EXPECT(fp);
+	fputs("  #  include \"selftest_inc.hlsl\"\nfloat4 PS() : SV_Target { return c; }\n", fp);
+	fclose(fp);
+
+	// key: every input counts
+	SHADER_MACRO a[] = { { "BEZIER_HS_PARTITION", "\"integer\"" }, { nullptr, nullptr } };
+	SHADER_MACRO b[] = { { "BEZIER_HS_PARTITION", "\"fractional_even\"" }, { nullptr, nullptr } };
+	ShaderCache::KEY k = ShaderCache::key(src.c_str(), "PS", "ps_5_0", a, 0);
+	EXPECT(k != 0);
+	EXPECT(k == ShaderCache::key(src.c_str(), "PS", "ps_5_0", a, 0));
+	EXPECT(k != ShaderCache::key(src.c_str(), "PS", "ps_5_0", b, 0));
+	EXPECT(k != ShaderCache::key(src.c_str(), "PS", "ps_5_0", nullptr, 0));
+	EXPECT(k != ShaderCache::key(src.c_str(), "VS", "ps_5_0", a, 0));
+	EXPECT(k != ShaderCache::key(src.c_str(), "PS", "ps_4_0", a, 0));
+	EXPECT(k != ShaderCache::key(src.c_str(), "PS", "ps_5_0", a, 1));
+	EXPECT(0 == ShaderCache::key((src + ".missing").c_str(), "PS", "ps_5_0", a, 0));
+
+	fp = fopen(inc.c_str(), "ab");
+	EXPECT(fp);
+	fputs("float4 d;\n", fp);
+	fclose(fp);
+	EXPECT(k != ShaderCache::key(src.c_str(), "PS", "ps_5_0", a, 0)); // include edited
+
+	std::vector<char> blob(1000), out;
+	for (size_t i = 0; i < blob.size(); i++) blob[i] = (char)(i * 7);
+	{
+		ShaderCache cache(dir, 2500);
+		cache.trim(0);
+		EXPECT(!cache.load(k, &out));
+		EXPECT(cache.store(k, blob.data(), blob.size()));
+		EXPECT(cache.load(k, &out) && out == blob);
+		EXPECT(cache.store(k + 1, blob.data(), blob.size()));
+		EXPECT(cache.load(k, &out));			// k + 1 is now the oldest
+		EXPECT(cache.store(k + 2, blob.data(), blob.size()));	// over the cap
+		EXPECT(cache.stats().evictions == 1 && cache.count() == 2);
+		EXPECT(!cache.load(k + 1, &out));
+	}
+	{
+		// index and blobs persist
+		ShaderCache cache(dir, 2500);
+		EXPECT(cache.count() == 2);
+		EXPECT(cache.load(k, &out) && out == blob);
+
+		// a corrupted blob is a miss and is dropped
+		char name[32];
+		sprintf(name, "/%016llx.bin", k + 2);
+		fp = fopen((std::string(dir) + name).c_str(), "r+b");
+		EXPECT(fp);
+		fseek(fp, 40, SEEK_SET);
+		fputc(0x55, fp);
+		fclose(fp);
+		EXPECT(!cache.load(k + 2, &out));
+		EXPECT(cache.count() == 1);
+		cache.trim(0);
+	}
+	{
+		// threads storing and loading the same keys, files written outside the lock
+		ShaderCache cache(dir);
+		const unsigned THREADS = 4, ITERATIONS = 64, KEYS = 8;
+		unsigned bad[THREADS] = {};
+		std::vector<std::thread> threads;
+		for (unsigned t = 0; t < THREADS; t++){
+			threads.push_back(std::thread([&, t](){
+				std::vector<char> got;
+				for (unsigned i = 0; i < ITERATIONS; i++){
+					ShaderCache::KEY kk = k + 16 + (t + i) % KEYS;
+					if (!cache.store(kk, blob.data(), blob.size())) bad[t]++;
+					if (cache.load(kk, &got) && got != blob) bad[t]++;
+				}
+			}));
+		}
+		for (auto &th : threads) th.join();
+		for (unsigned t = 0; t < THREADS; t++) EXPECT(bad[t] == 0);
+		EXPECT(cache.count() == KEYS && cache.size() == KEYS * blob.size());
+		ShaderCache::STATS s = cache.stats();
+		EXPECT(s.stores == THREADS * ITERATIONS && s.hits + s.misses == THREADS * ITERATIONS);
+		for (unsigned i = 0; i < KEYS; i++) EXPECT(cache.load(k + 16 + i, &out) && out == blob);
+		cache.trim(0);
+		EXPECT(cache.count() == 0 && cache.size() == 0);
+	}
+	remove(src.c_str());
+	remove(inc.c_str());
+	printf("selftest ok\n");
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int r = 2;
+	if (3 <= argc && strcmp(argv[1], "key") == 0 && 5 <= argc) r = key(argc - 2, argv + 2);
+	else if (argc == 3 && strcmp(argv[1], "list") == 0) r = list(argv[2]);
+	else if (argc == 3 && strcmp(argv[1], "check") == 0) r = check(argv[2]);
+	else if (argc == 4 && strcmp(argv[1], "trim") == 0) r = trim(argv[2], (size_t)atof(argv[3]));
+	else if (argc == 3 && strcmp(argv[1], "selftest") == 0) r = selftest(argv[2]);
+
+	if (r == 2){
+		fprintf(stderr, "usage: shader_cache key FILE ENTRY PROFILE [NAME=VALUE ...] | list DIR | check DIR | trim DIR BYTES | selftest DIR\n");
+	}
+	return r;
+}
@@ -0,0 +1,1114 @@
+//--------------------------------------------------------------------------------------
+// File: taa_cpu.cpp
+//
+// Headless driver for the CPU reference TAA kernels in tpot/.
+// No D3D dependency, e.g.:
+//   g++ -O2 -std=c++11 -pthread -Itpot tools/taa_cpu.cpp tpot/TaaResolve.cpp tpot/TaaUpsample.cpp
+//       tpot/TaaReproject.cpp tpot/Matrix.cpp tpot/TestScene.cpp tpot/ImageMetrics.cpp
+//       tpot/JitterSequence.cpp tpot/ThreadPool.cpp tpot/image.cpp tpot/simd.cpp tpot/TaaHistory.cpp
+//       tpot/TileConvergence.cpp tpot/TaaPresent.cpp tpot/TaaVariance.cpp tpot/TaaDisocclusion.cpp
+//       tpot/TaaCheckerboard.cpp
+//
+//   taa_cpu resolve  [options] out_prefix frame0.pfm frame1.pfm ...
+//   taa_cpu bench    [options]
+//   taa_cpu upsample [options]    quality / cost of temporal upsampling on the test scene
+//   taa_cpu reproject [options]   convergence with a moving camera, with and without reprojection
+//   taa_cpu jitter   [options]    discrepancy and convergence of the jitter sequences per blend weight
+//   taa_cpu history  [options]    YCoCg history round trip checks, then PS against PS_YCoCg
+//   taa_cpu tiles    [options]    resolve work saved by skipping converged tiles, the camera moves half way
+//   taa_cpu present  [options]    fused resolve + present against the two passes: equality, then cost
+//   taa_cpu variance [options]    variance clipping: simd paths against scalar, quality and cost against PS
+//   taa_cpu depth    [options]    depth rejection checks on synthetic depth edges, then PSNR per blend weight
+//   taa_cpu checkerboard [options] reconstruction checks, then error and shading cost against full shading
+//
+// options:
+//   -simd scalar|sse4|avx2   kernel path (default: best available)
+//   -threads N               worker threads, 0: single threaded (default: hardware)
+//   -blend N                 g_iBlendWeight (1..32)
+//   -blur N                  g_iBlurSize (0..10)
+//   -size WxH                bench image size (default 1920x1080)
+//   -frames N                bench iterations / accumulated frames (default 20)
+//   -jitter TYPE             halton|grid|r2|sobol|bluenoise (default halton)
+//--------------------------------------------------------------------------------------
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include "TaaResolve.h"
+#include "TaaUpsample.h"
+#include "TaaReproject.h"
+#include "TaaHistory.h"
+#include "TileConvergence.h"
+#include "TaaVariance.h"
+#include "TaaCheckerboard.h"
+#include "TestScene.h"
+#include "ImageMetrics.h"
+#include "JitterSequence.h"
+#include "ThreadPool.h"
+
+using namespace tpot;
+
+struct OPTIONS
+{
+	SIMD::ID simd = SIMD::best();
+	int threads = -1;
+	unsigned blend = 8;
+	unsigned blur = 2;
+	int width = 1920;
+	int height = 1080;
+	int frames = 20;
+	JITTER::TYPE jitter = JITTER::HALTON;
+	std::vector<const char*> args;
+};
+
+static bool parseOptions(int argc, char *argv[], OPTIONS &opt)
+{
+	for (int i = 0; i < argc; i++){
+		const char *a = argv[i];
+		bool has_value = i + 1 < argc;
+		if (strcmp(a, "-simd") == 0 && has_value){
+			if (!SIMD::parse(argv[++i], &opt.simd)) return false;
+		}else if (strcmp(a, "-threads") == 0 && has_value){
+			opt.threads = atoi(argv[++i]);
+		}else if (strcmp(a, "-blend") == 0 && has_value){
+			opt.blend = (unsigned)atoi(argv[++i]);
+		}else if (strcmp(a, "-blur") == 0 && has_value){
+			opt.blur = (unsigned)atoi(argv[++i]);
+		}else if (strcmp(a, "-size") == 0 && has_value){
+			if (sscanf(argv[++i], "%dx%d", &opt.width, &opt.height) != 2) return false;
+		}else if (strcmp(a, "-frames") == 0 && has_value){
+			opt.frames = atoi(argv[++i]);
+		}else if (strcmp(a, "-jitter") == 0 && has_value){
+			if (!JITTER::parse(argv[++i], &opt.jitter)) return false;
+		}else if (a[0] == '-'){
+			return false;
+		}else{
+			opt.args.push_back(a);
+		}
+	}
+	if (opt.blend < 1 || 32 < opt.blend || 10 < opt.blur) return false;
+	if (opt.width <= 0 || opt.height <= 0 || opt.frames <= 0) return false;
+	return true;
+}
+
+static std::unique_ptr<ThreadPool> createPool(const OPTIONS &opt)
+{
+	if (opt.threads == 0) return nullptr;
+	return std::unique_ptr<ThreadPool>(new ThreadPool(opt.threads < 0 ? 0 : (unsigned)opt.threads));
+}
+
+// Same values OnD3D11FrameRender writes to CB_TAA
+static TAA_PARAM makeParam(const OPTIONS &opt, int width, int height)
+{
+	TAA_PARAM param;
+	param.inv_screen_size[0] = 1.0f / (float)width;
+	param.inv_screen_size[1] = 1.0f / (float)height;
+	param.fRate = 1.0f / (float)opt.blend;
+	param.fBlurSize = 0.1f * (float)opt.blur;
+	return param;
+}
+
+static void fillNoise(Image &img, unsigned seed)
+{
+	for (auto &v : img.pixels){
+		seed = seed * 1664525u + 1013904223u;
+		v = (float)(seed >> 8) * (1.0f / 16777216.0f);
+	}
+}
+
+static double elapsedMs(std::chrono::high_resolution_clock::time_point t0)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+}
+
+static int resolve(const OPTIONS &opt)
+{
+	if (opt.args.size() < 2) return 1;
+
+	std::unique_ptr<ThreadPool> pool = createPool(opt);
+	Image acc, scene, out;
+
+	for (size_t i = 1; i < opt.args.size(); i++){
+		if (!LoadPFM(opt.args[i], &scene)){
+			fprintf(stderr, "failed to load %s\n", opt.args[i]);
+			return 1;
+		}
+		if (acc.width != scene.width || acc.height != scene.height){
+			acc = scene;// first frame, history starts from the current image
+		}
+
+		ResolveTAA(out, acc, scene, makeParam(opt, scene.width, scene.height), opt.simd, pool.get());
+
+		std::string path = std::string(opt.args[0]) + std::to_string(i - 1) + ".pfm";
+		if (!SavePFM(path.c_str(), out)){
+			fprintf(stderr, "failed to save %s\n", path.c_str());
+			return 1;
+		}
+		std::swap(acc, out);
+	}
+	return 0;
+}
+
+static int bench(const OPTIONS &opt)
+{
+	std::unique_ptr<ThreadPool> pool = createPool(opt);
+	Image acc(opt.width, opt.height), scene(opt.width, opt.height), out;
+	fillNoise(acc, 1);
+	fillNoise(scene, 2);
+	TAA_PARAM param = makeParam(opt, opt.width, opt.height);
+
+	printf("simd,threads,width,height,ms_per_frame,ns_per_pixel\n");
+	for (int s = 0; s < SIMD::MAX; s++){
+		SIMD::ID simd = (SIMD::ID)s;
+		if (!SIMD::supported(simd) || opt.simd < simd) continue;
+
+		ResolveTAA(out, acc, scene, param, simd, pool.get());// warm up
+		auto t0 = std::chrono::high_resolution_clock::now();
+		for (int f = 0; f < opt.frames; f++){
+			ResolveTAA(out, acc, scene, param, simd, pool.get());
+		}
+		auto t1 = std::chrono::high_resolution_clock::now();
+
+		double ms = std::chrono::duration<double, std::milli>(t1 - t0).count() / opt.frames;
+		printf("%s,%u,%d,%d,%.3f,%.3f\n", SIMD::name(simd), pool ? pool->size() : 0,
+			opt.width, opt.height, ms, ms * 1.0e6 / ((double)opt.width * opt.height));
+	}
+	return 0;
+}
+
+// Static camera, accumulates opt.frames jittered frames per render scale and
+// compares the history against a 4x4 supersampled reference.
+static int upsample(const OPTIONS &opt)
+{
+	static const int scales[] = { 50, 60, 67, 75, 85, 100 };
+
+	std::unique_ptr<ThreadPool> pool = createPool(opt);
+	TEST_CAMERA cam = TestScene::camera();
+	Image reference;
+	TestScene::renderReference(reference, opt.width, opt.height, cam, 4, pool.get());
+
+	printf("scale,render_width,render_height,shaded_pixels,render_ms,reconstruct_ms,psnr_db\n");
+	for (int scale : scales){
+		int rw = (opt.width * scale + 50) / 100;
+		int rh = (opt.height * scale + 50) / 100;
+
+		TAA_UPSAMPLE_PARAM param;
+		param.taa = makeParam(opt, opt.width, opt.height);
+		param.render_size[0] = (float)rw;
+		param.render_size[1] = (float)rh;
+
+		JitterSequence sequence(opt.jitter);
+		sequence.setBlendWeight(opt.blend);
+
+		Image scene, acc(opt.width, opt.height), out;
+		double render_ms = 0.0, reconstruct_ms = 0.0;
+		for (int f = 0; f < opt.frames; f++){
+			const float *offset = sequence.next();
+			param.jitter[0] = offset[0] - 0.5f;
+			param.jitter[1] = offset[1] - 0.5f;
+
+			auto t0 = std::chrono::high_resolution_clock::now();
+			TestScene::render(scene, nullptr, rw, rh, cam, param.jitter[0], param.jitter[1], pool.get());
+			render_ms += elapsedMs(t0);
+
+			param.taa.fRate = (f == 0) ? 1.0f : 1.0f / (float)opt.blend;
+			t0 = std::chrono::high_resolution_clock::now();
+			UpsampleTAA(out, acc, scene, param, pool.get());
+			reconstruct_ms += elapsedMs(t0);
+			std::swap(acc, out);
+		}
+
+		printf("%d,%d,%d,%d,%.3f,%.3f,%.2f\n", scale, rw, rh, rw * rh,
+			render_ms / opt.frames, reconstruct_ms / opt.frames, ImagePSNR(acc, reference));
+	}
+	return 0;
+}
+
+// Orbiting camera at 60 fps. Each frame the raw scene, taa.hlsl PS, the PS_Reproject
+// kernel with the history at the same uv (no motion compensation), PS_Reproject and
+// PS_Reproject with depth rejection are compared against a 4x4 supersampled
+// reference of that frame.
+static int reproject(const OPTIONS &opt)
+{
+	const float dt = 1.0f / 60.0f;
+	const float aspect = (float)opt.width / (float)opt.height;
+
+	std::unique_ptr<ThreadPool> pool = createPool(opt);
+	TAA_REPROJECT_PARAM param;
+	param.taa = makeParam(opt, opt.width, opt.height);
+	param.render_size[0] = (float)opt.width;
+	param.render_size[1] = (float)opt.height;
+	param.depth_reject = MakeDepthReject(MatrixIdentity(), 0.0f);
+
+	TAA_REPROJECT_PARAM still = param;
+	TAA_REPROJECT_PARAM reject = param;
+	TEST_CAMERA cam0 = TestScene::camera();
+	reject.depth_reject = MakeDepthReject(MatrixPerspectiveFovLH(cam0.fovy, aspect, cam0.znear, cam0.zfar), TAA_DEPTH_THRESHOLD);
+
+	JitterSequence sequence(opt.jitter);
+	sequence.setBlendWeight(opt.blend);
+
+	Image scene, depth, prev_depth, reference, acc_resolve, acc_still, acc_reproject, acc_reject, out;
+	MATRIX prev_vp;
+
+	printf("frame,psnr_scene_db,psnr_resolve_db,psnr_same_uv_db,psnr_reproject_db,psnr_depth_reject_db\n");
+	for (int f = 0; f < opt.frames; f++){
+		TEST_CAMERA cam = TestScene::camera(dt * (float)f);
+		const float *offset = sequence.next();
+		float jx = offset[0] - 0.5f;
+		float jy = offset[1] - 0.5f;
+		TestScene::render(scene, &depth, opt.width, opt.height, cam, jx, jy, pool.get());
+		TestScene::renderReference(reference, opt.width, opt.height, cam, 4, pool.get());
+
+		// same matrices as OnD3D11FrameRender
+		MATRIX vp = TestScene::viewProjection(cam, aspect);
+		MATRIX jittered = MatrixMultiply(vp, MatrixTranslation(-2.0f * jx / (float)opt.width, 2.0f * jy / (float)opt.height, 0.0f));
+		if (f == 0) prev_vp = vp;
+		MATRIX inv;
+		MatrixInverse(&inv, jittered);
+		param.reprojection = MatrixMultiply(inv, prev_vp);
+		still.reprojection = MatrixMultiply(inv, vp);
+		reject.reprojection = param.reprojection;
+		prev_vp = vp;
+
+		if (f == 0){
+			acc_resolve = acc_still = acc_reproject = acc_reject = scene;
+		}else{
+			ResolveTAA(out, acc_resolve, scene, param.taa, opt.simd, pool.get());
+			std::swap(acc_resolve, out);
+
+			ReprojectTAA(out, acc_still, scene, depth, Image(), still, pool.get());
+			std::swap(acc_still, out);
+
+			ReprojectTAA(out, acc_reproject, scene, depth, Image(), param, pool.get());
+			std::swap(acc_reproject, out);
+
+			ReprojectTAA(out, acc_reject, scene, depth, prev_depth, reject, pool.get());
+			std::swap(acc_reject, out);
+		}
+		std::swap(prev_depth, depth);
+
+		printf("%d,%.2f,%.2f,%.2f,%.2f,%.2f\n", f, ImagePSNR(scene, reference), ImagePSNR(acc_resolve, reference),
+			ImagePSNR(acc_still, reference), ImagePSNR(acc_reproject, reference), ImagePSNR(acc_reject, reference));
+	}
+	return 0;
+}
+
+// Steady state RMS error of the pixel coverage of random edges when the history
+// is an exponential moving average with rate 1/blend_weight over the sequence.
+static double coverageError(const JitterSequence &sequence, unsigned blend_weight)
+{
+	const int EDGES = 256;
+	const int GRID = 64;	// for the exact coverage
+	const unsigned length = sequence.length();
+	const double rate = 1.0 / (double)blend_weight;
+	const double norm = 1.0 / (1.0 - pow(1.0 - rate, (double)length));
+
+	unsigned seed = 12345;
+	auto rnd = [&seed](){
+		seed = seed * 1664525u + 1013904223u;
+		return (double)(seed >> 8) * (1.0 / 16777216.0);
+	};
+
+	double sum = 0.0;
+	for (int e = 0; e < EDGES; e++){
+		double px = rnd(), py = rnd(), a = 6.283185307179586 * rnd();
+		double nx = cos(a), ny = sin(a);
+		auto inside = [&](double x, double y){ return 0.0 < (x - px) * nx + (y - py) * ny; };
+
+		int covered = 0;
+		for (int y = 0; y < GRID; y++){
+			for (int x = 0; x < GRID; x++){
+				covered += inside((x + 0.5) / GRID, (y + 0.5) / GRID) ? 1 : 0;
+			}
+		}
+		double exact = (double)covered / (GRID * GRID);
+
+		for (unsigned f = 0; f < length; f++){// every phase of the sequence
+			double estimate = 0.0;
+			for (unsigned j = 0; j < length; j++){
+				const float *p = sequence.point(j);
+				unsigned age = (f + length - j) % length;
+				double w = rate * pow(1.0 - rate, (double)age) * norm;
+				estimate += inside(p[0], p[1]) ? w : 0.0;
+			}
+			sum += (estimate - exact) * (estimate - exact);
+		}
+	}
+	return sqrt(sum / ((double)EDGES * length));
+}
+
+// Discrepancy per length, then the coverage error per blend weight and the
+// shortest length within 10% of the longest sequence of the same type.
+static int jitter(const OPTIONS &opt)
+{
+	static const unsigned lengths[] = { 1, 2, 4, 8, 16, 32, 64 };
+	static const unsigned weights[] = { 1, 2, 4, 8, 16, 32 };
+	(void)opt;
+
+	printf("type,length,l2_star_discrepancy\n");
+	for (int t = 0; t < JITTER::MAX; t++){
+		for (unsigned length : lengths){
+			JitterSequence sequence((JITTER::TYPE)t, length);
+			if (sequence.length() != length) continue;
+			printf("%s,%u,%.5f\n", JITTER::name((JITTER::TYPE)t), length, JitterSequence::discrepancy(sequence.point(0), length));
+		}
+	}
+
+	printf("\ntype,blend_weight,length,coverage_rms,converged,recommended\n");
+	for (unsigned weight : weights){
+		for (int t = 0; t < JITTER::MAX; t++){
+			double best = coverageError(JitterSequence((JITTER::TYPE)t, 64), weight);
+			unsigned shortest = 0;
+			for (unsigned length : lengths){
+				JitterSequence sequence((JITTER::TYPE)t, length);
+				if (sequence.length() != length) continue;
+				double e = coverageError(sequence, weight);
+				bool converged = e <= 1.1 * best;
+				if (converged && shortest == 0) shortest = length;
+				printf("%s,%u,%u,%.5f,%d,%u\n", JITTER::name((JITTER::TYPE)t), weight, length, e, converged ? 1 : 0,
+					JitterSequence::recommendedLength((JITTER::TYPE)t, weight));
+			}
+			fprintf(stderr, "%s blend %u: shortest converged length %u\n", JITTER::name((JITTER::TYPE)t), weight, shortest);
+		}
+	}
+	return 0;
+}
+
+// Largest RGB error of encode, pack, unpack, decode over random colours in [0,1]
+static float roundTripError(TAA_HISTORY::ID id, double *rms)
+{
+	unsigned seed = 777;
+	auto rnd = [&seed](){
+		seed = seed * 1664525u + 1013904223u;
+		return (float)(seed >> 8) * (1.0f / 16777215.0f);
+	};
+
+	const int COLORS = 1 << 20;
+	float max_err = 0.0f;
+	double sum = 0.0;
+	for (int i = 0; i < COLORS; i++){
+		float rgba[4] = { rnd(), rnd(), rnd(), 1.0f }, texel[4], back[4];
+		EncodeYCoCg(rgba, texel);
+		if (id == TAA_HISTORY::YCOCG64) UnpackRGBA16F(PackRGBA16F(texel), texel);
+		if (id == TAA_HISTORY::YCOCG32) UnpackRGB10A2(PackRGB10A2(texel), texel);
+		DecodeYCoCg(texel, back);
+		for (int c = 0; c < 3; c++){
+			float e = fabsf(back[c] - rgba[c]);
+			max_err = (max_err < e) ? e : max_err;
+			sum += (double)e * e;
+		}
+	}
+	*rms = sqrt(sum / (3.0 * COLORS));
+	return max_err;
+}
+
+static bool checkHalf()
+{
+	bool ok = true;
+	for (unsigned h = 0; h < 0x10000; h++){// every half survives the float trip, NaNs stay NaN
+		float f = HalfToFloat((unsigned short)h);
+		unsigned short back = FloatToHalf(f);
+		bool nan = (h & 0x7c00) == 0x7c00 && (h & 0x3ff);
+		if (nan ? !(f != f) || (back & 0x7fff) != 0x7e00 : back != h) ok = false;
+	}
+
+	static const struct { float f; unsigned short h; } cases[] = {
+		{ 1.0f, 0x3c00 },
+		{ -2.0f, 0xc000 },
+		{ 65504.0f, 0x7bff },
+		{ 65520.0f, 0x7c00 },		// rounds to infinity
+		{ 5.9604645e-8f, 0x0001 },	// smallest subnormal
+		{ 2.9802322e-8f, 0x0000 },	// tie to even
+		{ 1.00048828125f, 0x3c00 },	// 1 + 2^-11, tie to even
+		{ 1.00146484375f, 0x3c02 },	// 1 + 3 * 2^-11, tie to even
+		{ 0.5f, 0x3800 },
+	};
+	for (auto &c : cases){
+		if (FloatToHalf(c.f) != c.h) ok = false;
+	}
+	return ok;
+}
+
+// Round trip errors with limits of half a step per channel, summed over
+// the three YCoCg terms of a decoded channel. Then PS on an RGBA32F history
+// and PS_YCoCg on the packed ones: cost per frame, bytes of history per
+// pixel and PSNR of the accumulated test scene against a 4x4 reference.
+static int history(const OPTIONS &opt)
+{
+	static const float limit[TAA_HISTORY::MAX] = {
+		1.0e-6f,
+		3.0f * 0.5f / 1024.0f,
+		3.0f * 0.5f / 1023.0f,
+	};
+
+	bool ok = checkHalf();
+	printf("check,max_error,rms_error,limit,result\n");
+	printf("half,,,,%s\n", ok ? "ok" : "FAIL");
+	for (int h = 0; h < TAA_HISTORY::MAX; h++){
+		double rms;
+		float e = roundTripError((TAA_HISTORY::ID)h, &rms);
+		bool pass = e <= limit[h];
+		ok = ok && pass;
+		printf("%s,%.6f,%.6f,%.6f,%s\n", (h == TAA_HISTORY::RGB) ? "ycocg_float" : TAA_HISTORY::name((TAA_HISTORY::ID)h),
+			e, rms, limit[h], pass ? "ok" : "FAIL");
+	}
+
+	std::unique_ptr<ThreadPool> pool = createPool(opt);
+	TAA_PARAM param = makeParam(opt, opt.width, opt.height);
+	TEST_CAMERA cam = TestScene::camera();
+	Image reference, acc, out;
+	TestScene::renderReference(reference, opt.width, opt.height, cam, 4, pool.get());
+
+	std::vector<Image> frames(opt.frames);
+	JitterSequence sequence(opt.jitter);
+	sequence.setBlendWeight(opt.blend);
+	for (auto &frame : frames){
+		const float *offset = sequence.next();
+		TestScene::render(frame, nullptr, opt.width, opt.height, cam, -0.5f * offset[0], 0.5f * offset[1], pool.get());
+	}
+
+	printf("\nhistory,simd,threads,width,height,history_bytes_per_pixel,ms_per_frame,ns_per_pixel,psnr_db\n");
+	for (int h = 0; h < TAA_HISTORY::MAX; h++){
+		TAA_HISTORY::ID id = (TAA_HISTORY::ID)h;
+		for (int s = 0; s < SIMD::MAX; s++){
+			SIMD::ID simd = (SIMD::ID)s;
+			if (!SIMD::supported(simd) || opt.simd < simd) continue;
+			if (id != TAA_HISTORY::RGB && simd != SIMD::SCALAR) continue;// PS_YCoCg is scalar only
+
+			HistoryImage hacc, hout;
+			double ms = 0.0;
+			for (int f = 0; f < opt.frames; f++){
+				auto t0 = std::chrono::high_resolution_clock::now();
+				if (id == TAA_HISTORY::RGB){
+					if (f == 0) acc = frames[0];
+					ResolveTAA(out, acc, frames[f], param, simd, pool.get());
+					std::swap(acc, out);
+				}else{
+					if (f == 0) EncodeHistory(hacc, frames[0], id);
+					ResolveTAAYCoCg(hout, hacc, frames[f], param, pool.get());
+					std::swap(hacc, hout);
+				}
+				ms += elapsedMs(t0);
+			}
+			if (id != TAA_HISTORY::RGB) DecodeHistory(acc, hacc);
+
+			unsigned bytes = (id == TAA_HISTORY::RGB) ? 16 : 4 * HistoryImage::wordsPerPixel(id);
+			ms /= opt.frames;
+			printf("%s,%s,%u,%d,%d,%u,%.3f,%.3f,%.2f\n", TAA_HISTORY::name(id), SIMD::name(simd), pool ? pool->size() : 0,
+				opt.width, opt.height, bytes, ms, ms * 1.0e6 / ((double)opt.width * opt.height), ImagePSNR(acc, reference));
+		}
+	}
+	return ok ? 0 : 1;
+}
+
+// Still camera on the test scene, which stands in for ColumnScene, with one
+// step of the orbit half way. Each frame runs the full PS resolve and the
+// one that only resolves the tiles TileConvergence has not marked converged.
+static int tiles(const OPTIONS &opt)
+{
+	std::unique_ptr<ThreadPool> pool = createPool(opt);
+	TAA_PARAM param = makeParam(opt, opt.width, opt.height);
+	JitterSequence sequence(opt.jitter);
+	sequence.setBlendWeight(opt.blend);
+
+	TileConvergence mask;
+	std::vector<PIXEL_RECT> rects;
+	Image scene, reference, acc_full, acc_tile, out_full, out_tile;
+	unsigned long long full_pixels = 0, tile_pixels = 0;
+	double full_ms = 0.0, tile_ms = 0.0;
+
+	printf("frame,converged_tiles,tiles,resolved_pixels,full_ms,tile_ms,mask_ms,psnr_full_db,psnr_tile_db,psnr_tile_vs_full_db\n");
+	for (int f = 0; f < opt.frames; f++){
+		bool moved = (f == opt.frames / 2);
+		TEST_CAMERA cam = TestScene::camera(moved || opt.frames / 2 < f ? 1.0f / 60.0f : 0.0f);
+		if (f == 0 || moved){
+			TestScene::renderReference(reference, opt.width, opt.height, cam, 4, pool.get());
+		}
+
+		const float *offset = sequence.next();
+		TestScene::render(scene, nullptr, opt.width, opt.height, cam, -0.5f * offset[0], 0.5f * offset[1], pool.get());
+
+		if (f == 0 || moved){// as TaaFrame: a new view starts the mask over
+			mask.reset(opt.width, opt.height);
+		}
+		if (f == 0){
+			acc_full = acc_tile = out_full = out_tile = scene;
+		}
+
+		auto t0 = std::chrono::high_resolution_clock::now();
+		ResolveTAA(out_full, acc_full, scene, param, opt.simd, pool.get());
+		double ms_full = elapsedMs(t0);
+
+		t0 = std::chrono::high_resolution_clock::now();
+		mask.schedule(rects);
+		ResolveTAARects(out_tile, acc_tile, scene, param, rects, opt.simd, pool.get());
+		double ms_tile = elapsedMs(t0);
+
+		t0 = std::chrono::high_resolution_clock::now();
+		mask.update(out_tile, acc_tile, pool.get());
+		double ms_mask = elapsedMs(t0);
+
+		unsigned long long resolved = TileConvergence::pixels(rects);
+		full_pixels += (unsigned long long)opt.width * opt.height;
+		tile_pixels += resolved;
+		full_ms += ms_full;
+		tile_ms += ms_tile + ms_mask;
+
+		// out_tile keeps the frame before last where nothing was resolved, as rt_taa does
+		std::swap(acc_full, out_full);
+		std::swap(acc_tile, out_tile);
+
+		printf("%d,%u,%d,%llu,%.3f,%.3f,%.3f,%.2f,%.2f,%.2f\n", f, mask.convergedTiles(), mask.tilesX() * mask.tilesY(), resolved,
+			ms_full, ms_tile, ms_mask, ImagePSNR(acc_full, reference), ImagePSNR(acc_tile, reference), ImagePSNR(acc_tile, acc_full));
+	}
+
+	fprintf(stderr, "resolved %.1f%% of the pixels, %.1f%% of the time (mask included)\n",
+		100.0 * (double)tile_pixels / (double)full_pixels, 100.0 * tile_ms / full_ms);
+	return 0;
+}
+
+// The back buffer of ResolvePresentTAA must be the one of ResolveTAA then
+// PresentTAA for every present setting, the history too. The timed part
+// is the two passes against the fused one on HDR noise.
+static int present(const OPTIONS &opt)
+{
+	std::unique_ptr<ThreadPool> pool = createPool(opt);
+	Image acc(opt.width, opt.height), scene(opt.width, opt.height), out_two, out_fused;
+	fillNoise(acc, 1);
+	fillNoise(scene, 2);
+	for (auto &v : acc.pixels) v *= 4.0f;// above 1 for the tone map
+	for (auto &v : scene.pixels) v *= 4.0f;
+	TAA_PARAM param = makeParam(opt, opt.width, opt.height);
+	PresentImage present_two, present_fused;
+
+	bool ok = true;
+	printf("tonemap,exposure,dither,pixels_differing,history_equal,result\n");
+	for (int t = 0; t < TONEMAP::MAX; t++){
+		for (int e = 0; e < 2; e++){
+			for (int d = 0; d < 2; d++){
+				TAA_PRESENT_PARAM pp = { (TONEMAP::ID)t, e ? 0.25f : 1.0f, d != 0, 17 };
+				ResolveTAA(out_two, acc, scene, param, opt.simd, pool.get());
+				PresentTAA(present_two, out_two, pp, pool.get());
+				ResolvePresentTAA(out_fused, present_fused, acc, scene, param, pp, opt.simd, pool.get());
+
+				size_t differing = 0;
+				for (size_t i = 0; i < present_two.pixels.size(); i++){
+					differing += (present_two.pixels[i] != present_fused.pixels[i]) ? 1 : 0;
+				}
+				bool history_equal = (out_two.pixels == out_fused.pixels);
+				bool pass = (differing == 0) && history_equal;
+				ok = ok && pass;
+				printf("%s,%.2f,%d,%u,%d,%s\n", TONEMAP::name(pp.tonemap), pp.exposure, d, (unsigned)differing,
+					history_equal ? 1 : 0, pass ? "ok" : "FAIL");
+			}
+		}
+	}
+
+	TAA_PRESENT_PARAM pp = { TONEMAP::REINHARD, 1.0f, true, 0 };
+	double two_ms = 0.0, fused_ms = 0.0;
+	for (int f = 0; f < opt.frames; f++){
+		pp.frame = (unsigned)f;
+		auto t0 = std::chrono::high_resolution_clock::now();
+		ResolveTAA(out_two, acc, scene, param, opt.simd, pool.get());
+		PresentTAA(present_two, out_two, pp, pool.get());
+		two_ms += elapsedMs(t0);
+
+		t0 = std::chrono::high_resolution_clock::now();
+		ResolvePresentTAA(out_fused, present_fused, acc, scene, param, pp, opt.simd, pool.get());
+		fused_ms += elapsedMs(t0);
+	}
+	printf("\npath,simd,threads,width,height,ms_per_frame\n");
+	printf("two_pass,%s,%u,%d,%d,%.3f\n", SIMD::name(opt.simd), pool ? pool->size() : 0, opt.width, opt.height, two_ms / opt.frames);
+	printf("fused,%s,%u,%d,%d,%.3f\n", SIMD::name(opt.simd), pool ? pool->size() : 0, opt.width, opt.height, fused_ms / opt.frames);
+	return ok ? 0 : 1;
+}
+
+// Every simd path and thread count of ResolveTAAVariance must give the scalar
+// bits, on a size that is no multiple of the tile. Then the test scene, still
+// for the first half of the frames and orbiting after, against a 4x4
+// supersampled reference with each clamp, and the cost of both on noise.
+static int variance(const OPTIONS &opt)
+{
+	std::unique_ptr<ThreadPool> pool = createPool(opt);
+
+	bool ok = true;
+	{
+		const int w = 333, h = 187;
+		Image acc(w, h), scene(w, h), expected, out;
+		fillNoise(acc, 1);
+		fillNoise(scene, 2);
+		for (auto &v : scene.pixels) v *= 2.0f;
+		TAA_PARAM param = makeParam(opt, w, h);
+		ResolveTAAVariance(expected, acc, scene, param, SIMD::SCALAR, nullptr);
+
+		printf("simd,threads,pixels_differing,result\n");
+		for (int s = 0; s < SIMD::MAX; s++){
+			SIMD::ID simd = (SIMD::ID)s;
+			if (!SIMD::supported(simd)) continue;
+			ResolveTAAVariance(out, acc, scene, param, simd, pool.get());
+			size_t differing = 0;
+			for (size_t i = 0; i < out.pixels.size(); i += 4){
+				differing += (memcmp(&out.pixels[i], &expected.pixels[i], 4 * sizeof(float)) != 0) ? 1 : 0;
+			}
+			ok = ok && differing == 0;
+			printf("%s,%u,%u,%s\n", SIMD::name(simd), pool ? pool->size() : 0, (unsigned)differing, differing ? "FAIL" : "ok");
+		}
+	}
+
+	TAA_PARAM param = makeParam(opt, opt.width, opt.height);
+	JitterSequence sequence(opt.jitter);
+	sequence.setBlendWeight(opt.blend);
+	Image scene, reference, acc_chroma, acc_variance, out;
+
+	printf("\nframe,moving,psnr_scene_db,psnr_chroma_db,psnr_variance_db\n");
+	for (int f = 0; f < opt.frames; f++){
+		bool moving = opt.frames / 2 <= f;
+		TEST_CAMERA cam = TestScene::camera(moving ? (float)(f - opt.frames / 2 + 1) / 60.0f : 0.0f);
+		if (f == 0 || moving){
+			TestScene::renderReference(reference, opt.width, opt.height, cam, 4, pool.get());
+		}
+		const float *offset = sequence.next();
+		TestScene::render(scene, nullptr, opt.width, opt.height, cam, -0.5f * offset[0], 0.5f * offset[1], pool.get());
+
+		if (f == 0){
+			acc_chroma = acc_variance = scene;
+		}else{
+			ResolveTAA(out, acc_chroma, scene, param, opt.simd, pool.get());
+			std::swap(acc_chroma, out);
+			ResolveTAAVariance(out, acc_variance, scene, param, opt.simd, pool.get());
+			std::swap(acc_variance, out);
+		}
+		printf("%d,%d,%.2f,%.2f,%.2f\n", f, moving ? 1 : 0, ImagePSNR(scene, reference),
+			ImagePSNR(acc_chroma, reference), ImagePSNR(acc_variance, reference));
+	}
+
+	Image acc(opt.width, opt.height);
+	fillNoise(acc, 1);
+	fillNoise(scene, 2);
+	printf("\nclamp,simd,threads,width,height,ms_per_frame,ns_per_pixel\n");
+	for (int c = 0; c < TAA_CLAMP::MAX; c++){
+		for (int s = 0; s < SIMD::MAX; s++){
+			SIMD::ID simd = (SIMD::ID)s;
+			if (!SIMD::supported(simd) || opt.simd < simd) continue;
+
+			auto run = [&](){
+				if (c == TAA_CLAMP::VARIANCE){
+					ResolveTAAVariance(out, acc, scene, param, simd, pool.get());
+				}else{
+					ResolveTAA(out, acc, scene, param, simd, pool.get());
+				}
+			};
+			run();// warm up
+			auto t0 = std::chrono::high_resolution_clock::now();
+			for (int f = 0; f < opt.frames; f++) run();
+			double ms = elapsedMs(t0) / opt.frames;
+			printf("%s,%s,%u,%d,%d,%.3f,%.3f\n", TAA_CLAMP::name((TAA_CLAMP::ID)c), SIMD::name(simd), pool ? pool->size() : 0,
+				opt.width, opt.height, ms, ms * 1.0e6 / ((double)opt.width * opt.height));
+		}
+	}
+	return ok ? 0 : 1;
+}
+
+// Synthetic depth edge: a slab x in [-1, 1] at view z 5 in front of a wall
+// at z 20, seen from the origin and from dx to the side, looking along +z.
+struct DEPTH_EDGE
+{
+	enum{
+		WIDTH = 256,
+		HEIGHT = 128,
+	};
+	float tan_x, tan_y;
+	MATRIX proj;
+
+	DEPTH_EDGE() : tan_x(0.0f), tan_y(tanf(0.5f * 0.785398163f))
+	{
+		tan_x = tan_y * (float)WIDTH / (float)HEIGHT;
+		proj = MatrixPerspectiveFovLH(0.785398163f, (float)WIDTH / (float)HEIGHT, 0.1f, 100.0f);
+	}
+
+	// view z of what the camera at eye_x sees through pixel centre x
+	float hit(float eye_x, int x) const
+	{
+		float rx = (((float)x + 0.5f) / (float)WIDTH * 2.0f - 1.0f) * tan_x;
+		float sx = eye_x + 5.0f * rx;
+		return (-1.0f <= sx && sx <= 1.0f) ? 5.0f : 20.0f;
+	}
+
+	void render(Image &depth, float eye_x) const
+	{
+		depth.resize(WIDTH, HEIGHT);
+		for (int y = 0; y < HEIGHT; y++){
+			for (int x = 0; x < WIDTH; x++){
+				float z = hit(eye_x, x);
+				depth.at(x, y)[0] = proj.m[2][2] + proj.m[3][2] / z;
+			}
+		}
+	}
+
+	// Whether the origin camera saw the surface of pixel x of the eye_x camera
+	bool visible(float eye_x, int x) const
+	{
+		float z = hit(eye_x, x);
+		if (z == 5.0f) return true;
+		float rx = (((float)x + 0.5f) / (float)WIDTH * 2.0f - 1.0f) * tan_x;
+		float wx = eye_x + z * rx;	// on the wall
+		float sx = wx * 5.0f / 20.0f;// where the origin ray to it crosses z 5
+		return !(-1.0f <= sx && sx <= 1.0f);
+	}
+};
+
+// DepthRejected against hand picked depths, then every pixel of a camera
+// shift over DEPTH_EDGE against the analytic visibility: a pixel may only
+// be misclassified next to the edge in the previous depth. Then the orbit
+// of the test scene per blend weight, PS_Reproject with and without rejection.
+static int depth(const OPTIONS &opt)
+{
+	DEPTH_EDGE edge;
+	TAA_DEPTH_REJECT param = MakeDepthReject(edge.proj, TAA_DEPTH_THRESHOLD);
+	TAA_DEPTH_REJECT off = MakeDepthReject(edge.proj, 0.0f);
+	auto d = [&](float z){ return edge.proj.m[2][2] + edge.proj.m[3][2] / z; };
+
+	struct CHECK{ const char *name; bool pass; };
+	const CHECK checks[] = {
+		{ "linear_depth", fabsf(LinearDepth(param, d(7.0f)) - 7.0f) < 7.0e-4f && fabsf(LinearDepth(param, d(0.1f)) - 0.1f) < 1.0e-5f },
+		{ "same_depth", !DepthRejected(param, d(10.0f), d(10.0f)) },
+		{ "within_threshold", !DepthRejected(param, d(10.0f), d(10.4f)) && !DepthRejected(param, d(10.0f), d(9.6f)) },
+		{ "beyond_threshold", DepthRejected(param, d(10.0f), d(10.6f)) && DepthRejected(param, d(10.0f), d(9.4f)) },
+		{ "edge_step", DepthRejected(param, d(20.0f), d(5.0f)) && DepthRejected(param, d(5.0f), d(20.0f)) },
+		{ "nan_rejects", DepthRejected(param, d(10.0f), sqrtf(-1.0f)) },
+		{ "off", !DepthRejected(off, d(20.0f), d(5.0f)) },
+	};
+
+	bool ok = true;
+	printf("check,result\n");
+	for (const CHECK &c : checks){
+		ok = ok && c.pass;
+		printf("%s,%s\n", c.name, c.pass ? "ok" : "FAIL");
+	}
+
+	static const float shifts[] = { -1.0f, -0.25f, 0.05f, 0.25f, 1.0f };
+	printf("\nshift,pixels,occluded,rejected,missed,false_rejects,unexplained,result\n");
+	Image prev_depth, cur_depth;
+	edge.render(prev_depth, 0.0f);
+	for (float dx : shifts){
+		edge.render(cur_depth, dx);
+		MATRIX inv;
+		MatrixInverse(&inv, MatrixMultiply(MatrixTranslation(-dx, 0.0f, 0.0f), edge.proj));
+		MATRIX reprojection = MatrixMultiply(inv, edge.proj);
+
+		unsigned occluded = 0, rejected = 0, missed = 0, false_rejects = 0, unexplained = 0, pixels = 0;
+		for (int y = 0; y < DEPTH_EDGE::HEIGHT; y++){
+			for (int x = 0; x < DEPTH_EDGE::WIDTH; x++){
+				float u = ((float)x + 0.5f) / (float)DEPTH_EDGE::WIDTH;
+				float v = ((float)y + 0.5f) / (float)DEPTH_EDGE::HEIGHT;
+				float hu, hv;
+				DISOCCLUSION::ID id = TestHistory(reprojection, prev_depth, u, v, cur_depth.at(x, y)[0], param, &hu, &hv);
+				if (id == DISOCCLUSION::OFF_SCREEN) continue;
+				pixels++;
+
+				bool truth = !edge.visible(dx, x);
+				bool test = (id == DISOCCLUSION::OCCLUDED);
+				occluded += truth ? 1 : 0;
+				rejected += test ? 1 : 0;
+				if (truth == test) continue;
+				(truth ? missed : false_rejects)++;
+
+				// the nearest texel may fall on either side of an edge
+				int px = (int)(hu * (float)DEPTH_EDGE::WIDTH);
+				bool near_edge = false;
+				for (int n = -1; n <= 1; n++){
+					int a = px + n, b = px + n + 1;
+					if (0 <= a && b < DEPTH_EDGE::WIDTH && prev_depth.at(a, y)[0] != prev_depth.at(b, y)[0]) near_edge = true;
+				}
+				unexplained += near_edge ? 0 : 1;
+			}
+		}
+		bool pass = (unexplained == 0) && (0 < occluded);
+		ok = ok && pass;
+		printf("%.2f,%u,%u,%u,%u,%u,%u,%s\n", dx, pixels, occluded, rejected, missed, false_rejects, unexplained, pass ? "ok" : "FAIL");
+	}
+
+	// With rejection a disoccluded pixel starts over from the scene instead of
+	// fading out stale history, so a higher blend weight stays usable in motion
+	static const unsigned weights[] = { 4, 8, 16, 32 };
+	const float dt = 1.0f / 60.0f;
+	const float aspect = (float)opt.width / (float)opt.height;
+	std::unique_ptr<ThreadPool> pool = createPool(opt);
+	TEST_CAMERA cam0 = TestScene::camera();
+	printf("\nblend,frames,psnr_reproject_db,psnr_depth_reject_db,rejected_percent\n");
+	for (unsigned w : weights){
+		OPTIONS o = opt;
+		o.blend = w;
+		TAA_REPROJECT_PARAM plain;
+		plain.taa = makeParam(o, opt.width, opt.height);
+		plain.render_size[0] = (float)opt.width;
+		plain.render_size[1] = (float)opt.height;
+		plain.depth_reject = MakeDepthReject(MatrixIdentity(), 0.0f);
+		TAA_REPROJECT_PARAM reject = plain;
+		reject.depth_reject = MakeDepthReject(MatrixPerspectiveFovLH(cam0.fovy, aspect, cam0.znear, cam0.zfar), TAA_DEPTH_THRESHOLD);
+
+		JitterSequence sequence(opt.jitter);
+		sequence.setBlendWeight(w);
+		Image scene, cur, prev, reference, acc_plain, acc_reject, out;
+		MATRIX prev_vp;
+		double psnr_plain = 0.0, psnr_reject = 0.0, rejected = 0.0;
+		int measured = 0;
+		for (int f = 0; f < opt.frames; f++){
+			TEST_CAMERA cam = TestScene::camera(dt * (float)f);
+			const float *offset = sequence.next();
+			float jx = offset[0] - 0.5f, jy = offset[1] - 0.5f;
+			TestScene::render(scene, &cur, opt.width, opt.height, cam, jx, jy, pool.get());
+
+			MATRIX vp = TestScene::viewProjection(cam, aspect);
+			MATRIX jittered = MatrixMultiply(vp, MatrixTranslation(-2.0f * jx / (float)opt.width, 2.0f * jy / (float)opt.height, 0.0f));
+			if (f == 0) prev_vp = vp;
+			MATRIX inv;
+			MatrixInverse(&inv, jittered);
+			plain.reprojection = reject.reprojection = MatrixMultiply(inv, prev_vp);
+			prev_vp = vp;
+
+			if (f == 0){
+				acc_plain = acc_reject = scene;
+			}else{
+				ReprojectTAA(out, acc_plain, scene, cur, Image(), plain, pool.get());
+				std::swap(acc_plain, out);
+				ReprojectTAA(out, acc_reject, scene, cur, prev, reject, pool.get());
+				std::swap(acc_reject, out);
+
+				unsigned count = 0;
+				for (int y = 0; y < opt.height; y++){
+					for (int x = 0; x < opt.width; x++){
+						float hu, hv;
+						count += (TestHistory(reject.reprojection, prev, ((float)x + 0.5f) / (float)opt.width, ((float)y + 0.5f) / (float)opt.height,
+							cur.at(x, y)[0], reject.depth_reject, &hu, &hv) == DISOCCLUSION::OCCLUDED) ? 1 : 0;
+					}
+				}
+				if (opt.frames / 2 <= f){// after the history has filled
+					TestScene::renderReference(reference, opt.width, opt.height, cam, 4, pool.get());
+					psnr_plain += ImagePSNR(acc_plain, reference);
+					psnr_reject += ImagePSNR(acc_reject, reference);
+					rejected += 100.0 * (double)count / ((double)opt.width * opt.height);
+					measured++;
+				}
+			}
+			std::swap(prev, cur);
+		}
+		measured = (0 < measured) ? measured : 1;
+		printf("%u,%d,%.2f,%.2f,%.2f\n", w, opt.frames, psnr_plain / measured, psnr_reject / measured, rejected / measured);
+	}
+	return ok ? 0 : 1;
+}
+
+// Shades the pixels of one checkerboard phase only, as the scene pass does
+// behind PS_CheckerMask, and leaves the others as MaskCheckerboard.
+static void renderCheckerboard(Image &color, Image &depth, int width, int height, const TEST_CAMERA &cam,
+	unsigned phase, const float clear[4], ThreadPool *pool)
+{
+	color.resize(width, height);
+	depth.resize(width, height);
+	const float q = cam.zfar / (cam.zfar - cam.znear);
+
+	auto row = [&](unsigned y){
+		for (int x = 0; x < width; x++){
+			float *p = color.at(x, y);
+			float *d = depth.at(x, y);
+			if (!CheckerboardShaded(x, y, phase)){
+				for (int c = 0; c < 4; c++) p[c] = clear[c];
+				continue;
+			}
+			float z;
+			TestScene::shade(cam, width, height, x + 0.5f, y + 0.5f, p, &z);
+			p[3] = 1.0f;
+			d[0] = q - q * cam.znear / z;
+			d[1] = z;
+			d[3] = 1.0f;
+		}
+	};
+	if (pool){
+		pool->parallelFor(height, row);
+	}else{
+		for (int y = 0; y < height; y++) row(y);
+	}
+}
+
+static int checkerboard(const OPTIONS &opt)
+{
+	std::unique_ptr<ThreadPool> pool = createPool(opt);
+	const float clear[4] = { 8.0f / 255.0f, 8.0f / 255.0f, 8.0f / 255.0f, 1.0f };
+	const float nan = sqrtf(-1.0f);
+	const float poison[4] = { nan, nan, nan, nan };
+
+	bool ok = true;
+	printf("check,result\n");
+	{
+		bool cover = true;
+		for (int y = 0; y < 4; y++){
+			for (int x = 0; x < 4; x++) cover = cover && CheckerboardShaded(x, y, 0) != CheckerboardShaded(x, y, 1);
+		}
+
+		// a plane comes back exactly but in the corners, where both pairs are mirrored
+		Image plane(17, 9), out;
+		for (int y = 0; y < plane.height; y++){
+			for (int x = 0; x < plane.width; x++){
+				float *p = plane.at(x, y);
+				p[0] = p[1] = p[2] = 0.25f + 0.03125f * (float)x + 0.0625f * (float)y;
+				p[3] = 1.0f;
+			}
+		}
+		Image masked = plane;
+		MaskCheckerboard(masked, nullptr, 1, poison);
+		InterpolateCheckerboard(out, masked, 1, pool.get());
+		bool exact = true;
+		for (int y = 0; y < plane.height; y++){
+			for (int x = 0; x < plane.width; x++){
+				bool corner = (x == 0 || x == plane.width - 1) && (y == 0 || y == plane.height - 1);
+				if (!corner && memcmp(out.at(x, y), plane.at(x, y), 4 * sizeof(float)) != 0) exact = false;
+			}
+		}
+
+		// A still camera: from the second frame on the history holds last
+		// phase's pixels and full shading is rebuilt within a step of 8 bits
+		// (the rounding of the reprojection), without reading a pixel the
+		// scene pass left out
+		const int w = 160, h = 90;
+		TEST_CAMERA cam = TestScene::camera();
+		MATRIX vp = TestScene::viewProjection(cam, (float)w / (float)h);
+		TAA_CHECKERBOARD_PARAM param;
+		param.inv_screen_size[0] = 1.0f / (float)w;
+		param.inv_screen_size[1] = 1.0f / (float)h;
+		MATRIX inv;
+		MatrixInverse(&inv, vp);
+		param.reprojection = MatrixMultiply(inv, vp);
+		param.depth_reject = MakeDepthReject(MatrixPerspectiveFovLH(cam.fovy, (float)w / (float)h, cam.znear, cam.zfar), TAA_DEPTH_THRESHOLD);
+		Image full, full_depth, scene, depth, prev_depth, history;
+		TestScene::render(full, &full_depth, w, h, cam, 0.0f, 0.0f, pool.get());
+		size_t nans = 0;
+		float max_error = 0.0f;
+		for (unsigned f = 0; f < 3; f++){
+			param.phase = f & 1;
+			param.fRate = (f == 0) ? 1.0f : 0.125f;
+			renderCheckerboard(scene, depth, w, h, cam, param.phase, poison, pool.get());
+			ReconstructCheckerboard(out, history, scene, depth, prev_depth, param, pool.get());
+			std::swap(history, out);
+			std::swap(prev_depth, depth);
+			if (f == 0) continue;
+			for (size_t i = 0; i < full.pixels.size(); i++){
+				float e = fabsf(history.pixels[i] - full.pixels[i]);
+				max_error = (max_error < e) ? e : max_error;
+				nans += (history.pixels[i] != history.pixels[i]) ? 1 : 0;
+			}
+		}
+
+		struct CHECK{ const char *name; bool pass; };
+		const CHECK checks[] = {
+			{ "phases_cover", cover },
+			{ "plane_interpolated", exact },
+			{ "still_rebuilt", max_error < 1.0f / 255.0f },
+			{ "no_unshaded_reads", nans == 0 },
+		};
+		for (const CHECK &c : checks){
+			ok = ok && c.pass;
+			printf("%s,%s\n", c.name, c.pass ? "ok" : "FAIL");
+		}
+	}
+
+	// Error against full shading of the same frame: the camera stands still,
+	// then orbits from the second half on
+	const float aspect = (float)opt.width / (float)opt.height;
+	TEST_CAMERA cam0 = TestScene::camera();
+	TAA_CHECKERBOARD_PARAM param;
+	param.inv_screen_size[0] = 1.0f / (float)opt.width;
+	param.inv_screen_size[1] = 1.0f / (float)opt.height;
+	param.depth_reject = MakeDepthReject(MatrixPerspectiveFovLH(cam0.fovy, aspect, cam0.znear, cam0.zfar), TAA_DEPTH_THRESHOLD);
+	TAA_CHECKERBOARD_PARAM no_test = param;
+	no_test.depth_reject = MakeDepthReject(MatrixIdentity(), 0.0f);
+
+	Image full, scene, depth, prev_depth, spatial, acc_history, acc_depth_test, out;
+	MATRIX prev_vp;
+	double sum[2][6] = {};
+	int count[2] = {};
+	double full_ms = 0.0, checker_ms = 0.0, reconstruct_ms = 0.0;
+	typedef std::chrono::high_resolution_clock CLOCK;
+
+	printf("\nframe,moving,psnr_spatial_db,psnr_history_db,psnr_depth_test_db,ssim_spatial,ssim_history,ssim_depth_test\n");
+	for (int f = 0; f < opt.frames; f++){
+		bool moving = opt.frames / 2 <= f;
+		TEST_CAMERA cam = TestScene::camera(moving ? (float)(f - opt.frames / 2 + 1) / 60.0f : 0.0f);
+		MATRIX vp = TestScene::viewProjection(cam, aspect);
+		if (f == 0) prev_vp = vp;
+		MATRIX inv;
+		MatrixInverse(&inv, vp);
+		param.reprojection = no_test.reprojection = MatrixMultiply(inv, prev_vp);
+		prev_vp = vp;
+		param.phase = no_test.phase = (unsigned)f & 1;
+		param.fRate = no_test.fRate = (f == 0) ? 1.0f : 0.125f;
+
+		CLOCK::time_point t0 = CLOCK::now();
+		TestScene::render(full, nullptr, opt.width, opt.height, cam, 0.0f, 0.0f, pool.get());
+		full_ms += elapsedMs(t0);
+		t0 = CLOCK::now();
+		renderCheckerboard(scene, depth, opt.width, opt.height, cam, param.phase, clear, pool.get());
+		checker_ms += elapsedMs(t0);
+
+		InterpolateCheckerboard(spatial, scene, param.phase, pool.get());
+		ReconstructCheckerboard(out, acc_history, scene, depth, Image(), no_test, pool.get());
+		std::swap(acc_history, out);
+		t0 = CLOCK::now();
+		ReconstructCheckerboard(out, acc_depth_test, scene, depth, prev_depth, param, pool.get());
+		reconstruct_ms += elapsedMs(t0);
+		std::swap(acc_depth_test, out);
+		std::swap(prev_depth, depth);
+
+		double m[6] = {
+			ImagePSNR(spatial, full), ImagePSNR(acc_history, full), ImagePSNR(acc_depth_test, full),
+			ImageSSIM(spatial, full), ImageSSIM(acc_history, full), ImageSSIM(acc_depth_test, full),
+		};
+		printf("%d,%d,%.2f,%.2f,%.2f,%.4f,%.4f,%.4f\n", f, moving ? 1 : 0, m[0], m[1], m[2], m[3], m[4], m[5]);
+		if (f == 0 || f == opt.frames / 2) continue;// the history starts over / has not seen motion
+		for (int i = 0; i < 6; i++) sum[moving][i] += m[i];
+		count[moving]++;
+	}
+
+	printf("\ncamera,frames,psnr_spatial_db,psnr_history_db,psnr_depth_test_db,ssim_spatial,ssim_history,ssim_depth_test\n");
+	for (int i = 0; i < 2; i++){
+		double n = (0 < count[i]) ? (double)count[i] : 1.0;
+		printf("%s,%d,%.2f,%.2f,%.2f,%.4f,%.4f,%.4f\n", i ? "orbit" : "still", count[i],
+			sum[i][0] / n, sum[i][1] / n, sum[i][2] / n, sum[i][3] / n, sum[i][4] / n, sum[i][5] / n);
+	}
+
+	double n = (double)opt.frames;
+	printf("\nwidth,height,threads,shaded_percent,full_shade_ms,checker_shade_ms,reconstruct_ms\n");
+	printf("%d,%d,%u,%.1f,%.3f,%.3f,%.3f\n", opt.width, opt.height, pool ? pool->size() : 0, 50.0,
+		full_ms / n, checker_ms / n, reconstruct_ms / n);
+	return ok ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+	OPTIONS opt;
+	if (argc < 2 || !parseOptions(argc - 2, argv + 2, opt)){
+		fprintf(stderr, "usage: taa_cpu resolve|bench|upsample|reproject|jitter|history|tiles|present|variance|depth|checkerboard [options] ...\n");
+		return 1;
+	}
+
+	std::string cmd = argv[1];
+	if (cmd == "resolve") return resolve(opt);
+	if (cmd == "bench") return bench(opt);
+	if (cmd == "upsample") return upsample(opt);
+	if (cmd == "reproject") return reproject(opt);
+	if (cmd == "jitter") return jitter(opt);
+	if (cmd == "history") return history(opt);
+	if (cmd == "tiles") return tiles(opt);
+	if (cmd == "present") return present(opt);
+	if (cmd == "variance") return variance(opt);
+	if (cmd == "depth") return depth(opt);
+	if (cmd == "checkerboard") return checkerboard(opt);
+
+	fprintf(stderr, "unknown command %s\n", argv[1]);
+	return 1;
+}
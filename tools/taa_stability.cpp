@@ -0,0 +1,324 @@
+//--------------------------------------------------------------------------------------
+// File: taa_stability.cpp
+//
+// Temporal stability of TAA output: flicker on a still camera and ghosting
+// behind moving edges (Move Camera), from the CPU reference TAA or from dumped
+// frames, without Windows or a GPU, e.g.:
+//   g++ -O2 -std=c++11 -pthread -Itpot tools/taa_stability.cpp tpot/TemporalMetrics.cpp
+//       tpot/TaaResolve.cpp tpot/TaaReproject.cpp tpot/TaaVariance.cpp tpot/TaaDisocclusion.cpp
+//       tpot/TaaPresent.cpp tpot/Matrix.cpp tpot/TestScene.cpp tpot/JitterSequence.cpp
+//       tpot/ThreadPool.cpp tpot/image.cpp tpot/simd.cpp
+//
+//   taa_stability selftest
+//   taa_stability flicker prefix N          frames prefix0.pfm .. prefixN-1.pfm of a still camera
+//   taa_stability ghost out_prefix ref_prefix N
+//                                           output frames against references of the same frames
+//   taa_stability cpu [options]             the CPU resolves: one CSV line each, flicker of the
+//                                           still camera, ghosting on the orbit
+//
+// Dumps are named as taa_cpu resolve writes them. Flicker is the mean over the
+// pixels of the temporal standard deviation of the luma; ghosting the RMS luma
+// error where the reference changed by more than -threshold since the last frame,
+// and the lag: the part of that change the output has not followed.
+//
+// options:
+//   -threshold F     luma change that marks a pixel for ghosting (default 0.05)
+//   -warmup N        frames left out, the history converging is not flicker (default 16)
+// cpu only:
+//   -size WxH        (default 320x180)
+//   -frames N        frames measured after the warm up (default 48)
+//   -blend N, -blur N, -jitter TYPE, -simd, -threads    as taa_cpu
+//   -max_flicker F   FAIL a TAA line whose flicker stddev is above F
+//   -max_ghost F     FAIL a TAA line whose ghost lag is above F; either exits 1
+//--------------------------------------------------------------------------------------
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "TemporalMetrics.h"
+#include "TaaResolve.h"
+#include "TaaReproject.h"
+#include "TaaVariance.h"
+#include "TestScene.h"
+#include "JitterSequence.h"
+#include "ThreadPool.h"
+#include "selftest.h"
+
+using namespace tpot;
+
+struct OPTIONS
+{
+	float threshold = 0.05f;
+	int warmup = 16;
+	int width = 320;
+	int height = 180;
+	int frames = 48;
+	unsigned blend = 8;
+	unsigned blur = 2;
+	JITTER::TYPE jitter = JITTER::HALTON;
+	SIMD::ID simd = SIMD::best();
+	int threads = -1;
+	double max_flicker = 0.0;	// 0: no limit
+	double max_ghost = 0.0;
+	std::vector<const char*> args;
+};
+
+static bool parseOptions(int argc, char *argv[], OPTIONS &opt)
+{
+	for (int i = 0; i < argc; i++){
+		const char *a = argv[i];
+		bool has_value = i + 1 < argc;
+		if (strcmp(a, "-threshold") == 0 && has_value){
+			opt.threshold = (float)atof(argv[++i]);
+		}else if (strcmp(a, "-warmup") == 0 && has_value){
+			opt.warmup = atoi(argv[++i]);
+		}else if (strcmp(a, "-size") == 0 && has_value){
+			if (sscanf(argv[++i], "%dx%d", &opt.width, &opt.height) != 2) return false;
+		}else if (strcmp(a, "-frames") == 0 && has_value){
+			opt.frames = atoi(argv[++i]);
+		}else if (strcmp(a, "-blend") == 0 && has_value){
+			opt.blend = (unsigned)atoi(argv[++i]);
+		}else if (strcmp(a, "-blur") == 0 && has_value){
+			opt.blur = (unsigned)atoi(argv[++i]);
+		}else if (strcmp(a, "-jitter") == 0 && has_value){
+			if (!JITTER::parse(argv[++i], &opt.jitter)) return false;
+		}else if (strcmp(a, "-simd") == 0 && has_value){
+			if (!SIMD::parse(argv[++i], &opt.simd)) return false;
+		}else if (strcmp(a, "-threads") == 0 && has_value){
+			opt.threads = atoi(argv[++i]);
+		}else if (strcmp(a, "-max_flicker") == 0 && has_value){
+			opt.max_flicker = atof(argv[++i]);
+		}else if (strcmp(a, "-max_ghost") == 0 && has_value){
+			opt.max_ghost = atof(argv[++i]);
+		}else if (a[0] == '-'){
+			return false;
+		}else{
+			opt.args.push_back(a);
+		}
+	}
+	if (opt.blend < 1 || 32 < opt.blend || 10 < opt.blur) return false;
+	if (opt.width <= 0 || opt.height <= 0 || opt.frames <= 1 || opt.warmup < 0) return false;
+	return true;
+}
+
+static bool loadFrame(const char *prefix, int index, Image *img)
+{
+	std::string path = std::string(prefix) + std::to_string(index) + ".pfm";
+	if (LoadPFM(path.c_str(), img)) return true;
+	fprintf(stderr, "failed to load %s\n", path.c_str());
+	return false;
+}
+
+static void fill(Image &img, float v)
+{
+	for (size_t i = 0; i < img.pixels.size(); i++) img.pixels[i] = (i % 4 == 3) ? 1.0f : v;
+}
+
+static int selftest()
+{
+	Image a(8, 4), b(8, 4), c(3, 3);
+	fill(a, 0.25f);
+	fill(b, 0.75f);
+
+	// a still image does not flicker
+	FlickerMeter flicker;
+	for (int i = 0; i < 10; i++) EXPECT(flicker.add(a));
+	EXPECT(flicker.frames() == 10 && flicker.variance() == 0.0 && flicker.stddev() == 0.0 && flicker.meanDelta() == 0.0);
+
+	// alternating 0.25 / 0.75: luma 1 for grey, the sample variance of 2N values
+	flicker.reset();
+	const int N = 50;
+	for (int i = 0; i < 2 * N; i++) EXPECT(flicker.add((i & 1) ? b : a));
+	double expected = 0.25 * 0.25 * (2.0 * N) / (2.0 * N - 1.0);
+	EXPECT(fabs(flicker.variance() - expected) < 1e-9);
+	EXPECT(fabs(flicker.stddev() - sqrt(expected)) < 1e-9);
+	EXPECT(fabs(flicker.meanDelta() - 0.5) < 1e-6);
+	EXPECT(!flicker.add(c) && flicker.frames() == 2 * N);	// another size is left out
+
+	// no change in the reference: nothing is marked
+	GhostMeter ghost(0.05f);
+	EXPECT(ghost.add(a, a) && ghost.add(b, a));
+	EXPECT(ghost.rms() == 0.0 && ghost.coverage() == 0.0);
+
+	// the reference moves on, the output keeps the last frame: all of the error is ghosting
+	ghost.reset();
+	EXPECT(ghost.add(a, a) && ghost.add(a, b));
+	EXPECT(fabs(ghost.rms() - 0.5) < 1e-6 && ghost.coverage() == 1.0 && fabs(ghost.lag() - 1.0) < 1e-9);
+	// the output following the reference has none
+	ghost.reset();
+	EXPECT(ghost.add(a, a) && ghost.add(b, b));
+	EXPECT(ghost.rms() == 0.0 && ghost.coverage() == 1.0 && ghost.lag() == 0.0);
+	EXPECT(!ghost.add(a, c));
+
+	// overshooting away from the last frame is error, not lag
+	Image d(8, 4);
+	fill(d, 1.0f);
+	ghost.reset();
+	EXPECT(ghost.add(a, a) && ghost.add(d, b));
+	EXPECT(fabs(ghost.rms() - 0.25) < 1e-6 && ghost.lag() == 0.0);
+
+	printf("selftest ok\n");
+	return 0;
+}
+
+static int flickerFiles(const OPTIONS &opt)
+{
+	if (opt.args.size() != 2) return 2;
+	int count = atoi(opt.args[1]);
+	FlickerMeter meter;
+	Image frame;
+	for (int i = opt.warmup; i < count; i++){
+		if (!loadFrame(opt.args[0], i, &frame)) return 1;
+		if (!meter.add(frame)){
+			fprintf(stderr, "frame %d: size differs\n", i);
+			return 1;
+		}
+	}
+	printf("frames,flicker_variance,flicker_stddev,mean_delta\n");
+	printf("%u,%.8f,%.6f,%.6f\n", meter.frames(), meter.variance(), meter.stddev(), meter.meanDelta());
+	return 0;
+}
+
+static int ghostFiles(const OPTIONS &opt)
+{
+	if (opt.args.size() != 3) return 2;
+	int count = atoi(opt.args[2]);
+	GhostMeter meter(opt.threshold);
+	Image out, ref;
+	for (int i = 0; i < count; i++){
+		if (!loadFrame(opt.args[0], i, &out) || !loadFrame(opt.args[1], i, &ref)) return 1;
+		if (i < opt.warmup) continue;
+		if (!meter.add(out, ref)){
+			fprintf(stderr, "frame %d: sizes differ\n", i);
+			return 1;
+		}
+	}
+	printf("frames,ghost_rms,ghost_lag,ghost_coverage\n");
+	printf("%u,%.6f,%.4f,%.4f\n", meter.frames(), meter.rms(), meter.lag(), meter.coverage());
+	return 0;
+}
+
+enum RESOLVE
+{
+	SCENE,			// no TAA, the jittered frames as they are
+	PS,
+	VARIANCE,
+	SAME_UV,		// PS_Reproject without motion compensation
+	REPROJECT,
+	DEPTH_REJECT,	// PS_Reproject with depth rejection
+
+	RESOLVE_MAX,
+};
+
+static const char *RESOLVE_NAME[RESOLVE_MAX] = { "scene", "ps", "variance", "same_uv", "reproject", "depth_reject" };
+
+// Still camera for SCENE, PS and VARIANCE, the orbit of taa_cpu reproject for
+// the others. Jitter and matrices as TaaFrame::render.
+static void runResolve(RESOLVE resolve, bool moving, const OPTIONS &opt, ThreadPool *pool,
+	FlickerMeter *flicker, GhostMeter *ghost)
+{
+	const float dt = moving ? 1.0f / 60.0f : 0.0f;
+	const float aspect = (float)opt.width / (float)opt.height;
+	TEST_CAMERA cam0 = TestScene::camera();
+
+	TAA_REPROJECT_PARAM param;
+	param.taa.inv_screen_size[0] = 1.0f / (float)opt.width;
+	param.taa.inv_screen_size[1] = 1.0f / (float)opt.height;
+	param.taa.fRate = 1.0f / (float)opt.blend;
+	param.taa.fBlurSize = 0.1f * (float)opt.blur;
+	param.render_size[0] = (float)opt.width;
+	param.render_size[1] = (float)opt.height;
+	param.depth_reject = MakeDepthReject(MatrixPerspectiveFovLH(cam0.fovy, aspect, cam0.znear, cam0.zfar),
+		(resolve == DEPTH_REJECT) ? TAA_DEPTH_THRESHOLD : 0.0f);
+
+	JitterSequence sequence(opt.jitter);
+	sequence.setBlendWeight(opt.blend);
+
+	Image scene, depth, prev_depth, reference, acc, out;
+	MATRIX prev_vp;
+	for (int f = 0; f < opt.warmup + opt.frames; f++){
+		TEST_CAMERA cam = TestScene::camera(dt * (float)f);
+		const float *offset = sequence.next();
+		float jx = -0.5f * offset[0];
+		float jy = +0.5f * offset[1];
+		TestScene::render(scene, &depth, opt.width, opt.height, cam, jx, jy, pool);
+
+		MATRIX vp = TestScene::viewProjection(cam, aspect);
+		MATRIX jittered = MatrixMultiply(vp, MatrixTranslation(-2.0f * jx / (float)opt.width, 2.0f * jy / (float)opt.height, 0.0f));
+		if (f == 0) prev_vp = vp;
+		MATRIX inv;
+		MatrixInverse(&inv, jittered);
+		param.reprojection = MatrixMultiply(inv, (resolve == SAME_UV) ? vp : prev_vp);
+		prev_vp = vp;
+
+		if (f == 0 || resolve == SCENE){
+			acc = scene;
+		}else{
+			switch (resolve){
+			case PS: ResolveTAA(out, acc, scene, param.taa, opt.simd, pool); break;
+			case VARIANCE: ResolveTAAVariance(out, acc, scene, param.taa, opt.simd, pool); break;
+			default: ReprojectTAA(out, acc, scene, depth, prev_depth, param, pool); break;
+			}
+			std::swap(acc, out);
+		}
+		std::swap(prev_depth, depth);
+
+		if (f < opt.warmup) continue;
+		if (flicker) flicker->add(acc);
+		if (ghost){
+			TestScene::renderReference(reference, opt.width, opt.height, cam, 4, pool);
+			ghost->add(acc, reference);
+		}
+	}
+}
+
+static int cpu(const OPTIONS &opt)
+{
+	std::unique_ptr<ThreadPool> pool;
+	if (opt.threads != 0) pool.reset(new ThreadPool(opt.threads < 0 ? 0 : (unsigned)opt.threads));
+
+	bool ok = true;
+	printf("resolve,camera,flicker_stddev,mean_delta,ghost_rms,ghost_lag,ghost_coverage,status\n");
+	for (int r = 0; r < RESOLVE_MAX; r++){
+		RESOLVE resolve = (RESOLVE)r;
+		bool still = (resolve == SCENE || resolve == PS || resolve == VARIANCE);
+		const char *status = "ok";
+		if (still){
+			FlickerMeter flicker;
+			runResolve(resolve, false, opt, pool.get(), &flicker, nullptr);
+			if (resolve != SCENE && 0.0 < opt.max_flicker && opt.max_flicker < flicker.stddev()) status = "FAIL";
+			printf("%s,still,%.6f,%.6f,,,,%s\n", RESOLVE_NAME[r], flicker.stddev(), flicker.meanDelta(), status);
+		}
+		if (resolve == SCENE || !still){
+			GhostMeter ghost(opt.threshold);
+			runResolve(resolve, true, opt, pool.get(), nullptr, &ghost);
+			if (resolve != SCENE && 0.0 < opt.max_ghost && opt.max_ghost < ghost.lag()) status = "FAIL";
+			printf("%s,orbit,,,%.6f,%.4f,%.4f,%s\n", RESOLVE_NAME[r], ghost.rms(), ghost.lag(), ghost.coverage(), status);
+		}
+		if (strcmp(status, "ok") != 0) ok = false;
+	}
+	return ok ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+	OPTIONS opt;
+	if (argc == 2 && strcmp(argv[1], "selftest") == 0) return selftest();
+	if (3 <= argc || (argc == 2 && strcmp(argv[1], "cpu") == 0)){
+		if (parseOptions(argc - 2, argv + 2, opt)){
+			int r = 2;
+			if (strcmp(argv[1], "flicker") == 0) r = flickerFiles(opt);
+			else if (strcmp(argv[1], "ghost") == 0) r = ghostFiles(opt);
+			else if (strcmp(argv[1], "cpu") == 0 && opt.args.empty()) r = cpu(opt);
+			if (r != 2) return r;
+		}
+	}
+
+	fprintf(stderr, "usage: taa_stability selftest | flicker [options] prefix N | ghost [options] out_prefix ref_prefix N\n"
+		"                     | cpu [-size WxH] [-frames N] [-warmup N] [-threshold F] [-blend N] [-blur N]\n"
+		"                           [-jitter TYPE] [-simd scalar|sse4|avx2] [-threads N] [-max_flicker F] [-max_ghost F]\n");
+	return 2;
+}
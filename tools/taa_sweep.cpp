@@ -0,0 +1,330 @@
+//--------------------------------------------------------------------------------------
+// File: taa_sweep.cpp
+//
+// Plays a camera path of the test scene through the CPU reference TAA over a grid
+// of g_iBlendWeight, g_iBlurSize and jitter length. Each configuration gets PSNR and
+// SSIM against an 8x8 (64 sample) supersampled reference of every frame and the
+// cost of its resolve, without Windows or a GPU, e.g.:
+//   g++ -O2 -std=c++11 -pthread -Itpot tools/taa_sweep.cpp tpot/TaaResolve.cpp tpot/TaaReproject.cpp
+//       tpot/TaaVariance.cpp tpot/TaaDisocclusion.cpp tpot/TaaPresent.cpp tpot/Matrix.cpp
+//       tpot/TestScene.cpp tpot/ImageMetrics.cpp tpot/JitterSequence.cpp tpot/ThreadPool.cpp
+//       tpot/image.cpp tpot/simd.cpp
+//
+//   taa_sweep [options] > sweep.csv
+//
+// Each resolve reads only some of the knobs, as on the GPU: taa.hlsl PS averages
+// the clamped history neighbours g_iBlurSize / 10 texels apart and ignores the
+// blend rate, PS_Reproject and CS_Variance blend at 1 / g_iBlendWeight and have
+// no blur. The blend weight also picks the jitter length when -length is 0.
+//
+// One line per configuration; quality is the mean over the frames after -warmup.
+// With -min_psnr / -min_ssim the configurations that meet both are marked and the
+// cheapest of them, then the shortest jitter, then the best PSNR, goes to stderr.
+//
+// options:
+//   -blend LIST      blend weights, e.g. 4,8,16 (default 1,2,4,8,16,32)
+//   -blur LIST       blur sizes 0..10 (default 0,2,4,6,8,10)
+//   -length LIST     jitter lengths, 0: JitterSequence::recommendedLength (default 4,8,16,32)
+//   -jitter TYPE     halton|grid|r2|sobol|bluenoise (default halton)
+//   -size WxH        (default 320x180)
+//   -frames N        frames of the path (default 48)
+//   -warmup N        frames left out of the mean (default 16)
+//   -resolve ps|variance|reproject
+//                    taa.hlsl PS or CS_Variance on a still camera (TAA mode), or
+//                    PS_Reproject on the orbit (Move Camera) (default ps)
+//   -speed F         orbit speed of reproject, 1 is taa_cpu reproject (default 1)
+//   -no_depth_reject PS_Reproject keeps disoccluded history
+//   -min_psnr DB, -min_ssim S    quality bar
+//   -json            a JSON array instead of CSV
+//   -simd scalar|sse4|avx2, -threads N    as taa_cpu
+//--------------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include "TaaResolve.h"
+#include "TaaReproject.h"
+#include "TaaVariance.h"
+#include "TestScene.h"
+#include "ImageMetrics.h"
+#include "JitterSequence.h"
+#include "ThreadPool.h"
+
+using namespace tpot;
+
+enum RESOLVE
+{
+	RESOLVE_PS,
+	RESOLVE_VARIANCE,
+	RESOLVE_REPROJECT,
+};
+
+static const char *RESOLVE_NAME[] = { "ps", "variance", "reproject" };
+
+struct OPTIONS
+{
+	std::vector<unsigned> blend = { 1, 2, 4, 8, 16, 32 };
+	std::vector<unsigned> blur = { 0, 2, 4, 6, 8, 10 };
+	std::vector<unsigned> length = { 4, 8, 16, 32 };
+	JITTER::TYPE jitter = JITTER::HALTON;
+	SIMD::ID simd = SIMD::best();
+	int threads = -1;
+	int width = 320;
+	int height = 180;
+	int frames = 48;
+	int warmup = 16;
+	RESOLVE resolve = RESOLVE_PS;
+	float speed = 1.0f;
+	bool depth_reject = true;
+	double min_psnr = 0.0;
+	double min_ssim = 0.0;
+	bool json = false;
+};
+
+struct RESULT
+{
+	unsigned blend;
+	unsigned blur;
+	unsigned length;
+	double psnr;
+	double ssim;
+	double psnr_min;	// worst measured frame
+	double resolve_ms;	// per frame
+	bool meets;
+};
+
+// Frames of the path at one jitter length, shared by every blend weight and blur size
+struct PATH
+{
+	std::vector<Image> scene;
+	std::vector<Image> depth;
+	std::vector<MATRIX> reprojection;
+};
+
+static bool parseList(const char *str, std::vector<unsigned> *list)
+{
+	list->clear();
+	while (*str){
+		char *end;
+		unsigned long v = strtoul(str, &end, 10);
+		if (end == str) return false;
+		list->push_back((unsigned)v);
+		str = (*end == ',') ? end + 1 : end;
+		if (*end && *end != ',') return false;
+	}
+	return !list->empty();
+}
+
+static bool parseOptions(int argc, char *argv[], OPTIONS &opt)
+{
+	for (int i = 0; i < argc; i++){
+		const char *a = argv[i];
+		bool has_value = i + 1 < argc;
+		if (strcmp(a, "-blend") == 0 && has_value){
+			if (!parseList(argv[++i], &opt.blend)) return false;
+		}else if (strcmp(a, "-blur") == 0 && has_value){
+			if (!parseList(argv[++i], &opt.blur)) return false;
+		}else if (strcmp(a, "-length") == 0 && has_value){
+			if (!parseList(argv[++i], &opt.length)) return false;
+		}else if (strcmp(a, "-jitter") == 0 && has_value){
+			if (!JITTER::parse(argv[++i], &opt.jitter)) return false;
+		}else if (strcmp(a, "-simd") == 0 && has_value){
+			if (!SIMD::parse(argv[++i], &opt.simd)) return false;
+		}else if (strcmp(a, "-threads") == 0 && has_value){
+			opt.threads = atoi(argv[++i]);
+		}else if (strcmp(a, "-size") == 0 && has_value){
+			if (sscanf(argv[++i], "%dx%d", &opt.width, &opt.height) != 2) return false;
+		}else if (strcmp(a, "-frames") == 0 && has_value){
+			opt.frames = atoi(argv[++i]);
+		}else if (strcmp(a, "-warmup") == 0 && has_value){
+			opt.warmup = atoi(argv[++i]);
+		}else if (strcmp(a, "-resolve") == 0 && has_value){
+			const char *r = argv[++i];
+			if (strcmp(r, "ps") == 0) opt.resolve = RESOLVE_PS;
+			else if (strcmp(r, "variance") == 0) opt.resolve = RESOLVE_VARIANCE;
+			else if (strcmp(r, "reproject") == 0) opt.resolve = RESOLVE_REPROJECT;
+			else return false;
+		}else if (strcmp(a, "-speed") == 0 && has_value){
+			opt.speed = (float)atof(argv[++i]);
+		}else if (strcmp(a, "-no_depth_reject") == 0){
+			opt.depth_reject = false;
+		}else if (strcmp(a, "-min_psnr") == 0 && has_value){
+			opt.min_psnr = atof(argv[++i]);
+		}else if (strcmp(a, "-min_ssim") == 0 && has_value){
+			opt.min_ssim = atof(argv[++i]);
+		}else if (strcmp(a, "-json") == 0){
+			opt.json = true;
+		}else{
+			return false;
+		}
+	}
+	for (unsigned b : opt.blend) if (b < 1 || 32 < b) return false;
+	for (unsigned b : opt.blur) if (10 < b) return false;
+	if (opt.resolve != RESOLVE_REPROJECT) opt.speed = 0.0f;
+	if (opt.width <= 0 || opt.height <= 0 || opt.frames <= 0) return false;
+	return 0 <= opt.warmup && opt.warmup < opt.frames;
+}
+
+static double elapsedMs(std::chrono::high_resolution_clock::time_point t0)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+}
+
+// Same matrices and jitter as TaaFrame::render
+static void renderPath(PATH &path, JitterSequence &sequence, const OPTIONS &opt, ThreadPool *pool)
+{
+	const float dt = opt.speed / 60.0f;
+	const float aspect = (float)opt.width / (float)opt.height;
+	path.scene.resize(opt.frames);
+	path.depth.resize(opt.frames);
+	path.reprojection.resize(opt.frames);
+
+	MATRIX prev_vp;
+	for (int f = 0; f < opt.frames; f++){
+		TEST_CAMERA cam = TestScene::camera(dt * (float)f);
+		const float *offset = sequence.next();
+		float jx = -0.5f * offset[0];
+		float jy = +0.5f * offset[1];
+		TestScene::render(path.scene[f], &path.depth[f], opt.width, opt.height, cam, jx, jy, pool);
+
+		MATRIX vp = TestScene::viewProjection(cam, aspect);
+		MATRIX jittered = MatrixMultiply(vp, MatrixTranslation(-2.0f * jx / (float)opt.width, 2.0f * jy / (float)opt.height, 0.0f));
+		if (f == 0) prev_vp = vp;
+		MATRIX inv;
+		MatrixInverse(&inv, jittered);
+		path.reprojection[f] = MatrixMultiply(inv, prev_vp);
+		prev_vp = vp;
+	}
+}
+
+static RESULT run(const PATH &path, const std::vector<Image> &reference, unsigned blend, unsigned blur,
+	const OPTIONS &opt, ThreadPool *pool)
+{
+	const float aspect = (float)opt.width / (float)opt.height;
+	TEST_CAMERA cam = TestScene::camera();
+
+	TAA_REPROJECT_PARAM param;
+	param.taa.inv_screen_size[0] = 1.0f / (float)opt.width;
+	param.taa.inv_screen_size[1] = 1.0f / (float)opt.height;
+	param.taa.fRate = 1.0f / (float)blend;
+	param.taa.fBlurSize = 0.1f * (float)blur;
+	param.render_size[0] = (float)opt.width;
+	param.render_size[1] = (float)opt.height;
+	param.depth_reject = MakeDepthReject(MatrixPerspectiveFovLH(cam.fovy, aspect, cam.znear, cam.zfar),
+		opt.depth_reject ? TAA_DEPTH_THRESHOLD : 0.0f);
+
+	RESULT r = {};
+	r.blend = blend;
+	r.blur = blur;
+	r.psnr_min = 99.0;
+	Image acc, out;
+	double ms = 0.0;
+	for (int f = 0; f < opt.frames; f++){
+		if (f == 0){
+			acc = path.scene[0];
+		}else{
+			param.reprojection = path.reprojection[f];
+			auto t0 = std::chrono::high_resolution_clock::now();
+			switch (opt.resolve){
+			case RESOLVE_PS: ResolveTAA(out, acc, path.scene[f], param.taa, opt.simd, pool); break;
+			case RESOLVE_VARIANCE: ResolveTAAVariance(out, acc, path.scene[f], param.taa, opt.simd, pool); break;
+			case RESOLVE_REPROJECT: ReprojectTAA(out, acc, path.scene[f], path.depth[f], path.depth[f - 1], param, pool); break;
+			}
+			ms += elapsedMs(t0);
+			std::swap(acc, out);
+		}
+		if (f < opt.warmup) continue;
+
+		double psnr = ImagePSNR(acc, reference[f]);
+		r.psnr += psnr;
+		r.ssim += ImageSSIM(acc, reference[f]);
+		r.psnr_min = (psnr < r.psnr_min) ? psnr : r.psnr_min;
+	}
+	int measured = opt.frames - opt.warmup;
+	r.psnr /= measured;
+	r.ssim /= measured;
+	r.resolve_ms = (1 < opt.frames) ? ms / (opt.frames - 1) : 0.0;
+	r.meets = opt.min_psnr <= r.psnr && opt.min_ssim <= r.ssim;
+	return r;
+}
+
+int main(int argc, char *argv[])
+{
+	OPTIONS opt;
+	if (!parseOptions(argc - 1, argv + 1, opt)){
+		fprintf(stderr, "usage: taa_sweep [-blend LIST] [-blur LIST] [-length LIST] [-jitter TYPE] [-size WxH]\n"
+			"                 [-frames N] [-warmup N] [-resolve ps|variance|reproject] [-speed F] [-no_depth_reject] [-min_psnr DB] [-min_ssim S]\n"
+			"                 [-json] [-simd scalar|sse4|avx2] [-threads N]\n");
+		return 2;
+	}
+
+	std::unique_ptr<ThreadPool> pool;
+	if (opt.threads != 0) pool.reset(new ThreadPool(opt.threads < 0 ? 0 : (unsigned)opt.threads));
+
+	std::vector<Image> reference(opt.frames);
+	for (int f = opt.warmup; f < opt.frames; f++){
+		if (opt.speed == 0.0f && opt.warmup < f){
+			reference[f] = reference[opt.warmup];
+		}else{
+			TestScene::renderReference(reference[f], opt.width, opt.height, TestScene::camera(opt.speed / 60.0f * (float)f), 8, pool.get());
+		}
+	}
+
+	std::vector<RESULT> results;
+	PATH path;
+	unsigned path_length = 0;
+	for (unsigned length : opt.length){
+		for (unsigned blend : opt.blend){
+			// 0: the length TaaFrame picks for each blend weight
+			JitterSequence sequence(opt.jitter, length ? length : JitterSequence::recommendedLength(opt.jitter, blend));
+			if (length && sequence.length() != length) continue;
+			if (sequence.length() != path_length){
+				renderPath(path, sequence, opt, pool.get());
+				path_length = sequence.length();
+			}
+			for (unsigned blur : opt.blur){
+				RESULT r = run(path, reference, blend, blur, opt, pool.get());
+				r.length = sequence.length();
+				results.push_back(r);
+			}
+		}
+	}
+
+	if (opt.json){
+		printf("[\n");
+		for (size_t i = 0; i < results.size(); i++){
+			const RESULT &r = results[i];
+			printf("  {\"resolve\":\"%s\",\"jitter\":\"%s\",\"length\":%u,\"blend_weight\":%u,\"blur_size\":%u,\"psnr_db\":%.3f,"
+				"\"ssim\":%.5f,\"psnr_min_db\":%.3f,\"resolve_ms\":%.4f,\"meets\":%s}%s\n",
+				RESOLVE_NAME[opt.resolve], JITTER::name(opt.jitter), r.length, r.blend, r.blur, r.psnr, r.ssim, r.psnr_min,
+				r.resolve_ms, r.meets ? "true" : "false", (i + 1 < results.size()) ? "," : "");
+		}
+		printf("]\n");
+	}else{
+		printf("resolve,jitter,length,blend_weight,blur_size,psnr_db,ssim,psnr_min_db,resolve_ms,meets\n");
+		for (const RESULT &r : results){
+			printf("%s,%s,%u,%u,%u,%.3f,%.5f,%.3f,%.4f,%d\n", RESOLVE_NAME[opt.resolve], JITTER::name(opt.jitter), r.length, r.blend, r.blur,
+				r.psnr, r.ssim, r.psnr_min, r.resolve_ms, r.meets ? 1 : 0);
+		}
+	}
+
+	// The resolve does the same work for every weight and blur, so costs within 5% are a tie
+	const RESULT *best = nullptr;
+	for (const RESULT &r : results){
+		if (!r.meets) continue;
+		if (!best || r.resolve_ms < 0.95 * best->resolve_ms){
+			best = &r;
+		}else if (r.resolve_ms <= 1.05 * best->resolve_ms){
+			if (r.length < best->length || (r.length == best->length && best->psnr < r.psnr)) best = &r;
+		}
+	}
+	if (best){
+		fprintf(stderr, "cheapest meeting the bar: length %u, blend weight %u, blur size %u (%.2f dB, SSIM %.4f, %.3f ms)\n",
+			best->length, best->blend, best->blur, best->psnr, best->ssim, best->resolve_ms);
+	}else{
+		fprintf(stderr, "no configuration meets the bar\n");
+	}
+	return 0;
+}
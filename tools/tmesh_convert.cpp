@@ -0,0 +1,543 @@
+//--------------------------------------------------------------------------------------
+// File: tmesh_convert.cpp
+//
+// .sdkmesh to .tmesh converter, checks and load time comparison, e.g.:
+//   g++ -O2 -std=c++11 -pthread -Itpot tools/tmesh_convert.cpp tpot/TMeshFile.cpp tpot/MeshOptimizer.cpp
+//       tpot/ThreadPool.cpp tpot/SDKMeshParser.cpp tpot/Lz4.cpp tpot/MappedFile.cpp
+//
+//   tmesh_convert convert in.sdkmesh out.tmesh [-lz4] [-index32] [-optimize]
+//   tmesh_convert check [file.sdkmesh ...]
+//       conversion keeps every vertex, index, subset, material and the draw
+//       order, -optimize the same triangles, the shipped .tmesh next to each
+//       source is up to date, and broken files are rejected
+//   tmesh_convert bench [-iterations N] [file.sdkmesh ...]
+//       read + parse + copy into the buffers a CreateBuffer would take:
+//       the SDKmesh path against .tmesh raw and LZ4
+//--------------------------------------------------------------------------------------
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "SDKMeshParser.h"
+#include "TMeshFile.h"
+#include "selftest.h"
+
+using namespace tpot;
+
+// Media/ColumnScene/Poles.sdkmesh -> Media/ColumnScene/Poles.tmesh
+static std::string tmeshPath(const std::string &sdkmesh)
+{
+	size_t dot = sdkmesh.rfind('.');
+	return ((dot == std::string::npos) ? sdkmesh : sdkmesh.substr(0, dot)) + ".tmesh";
+}
+
+static std::vector<const char*> mediaFiles(int argc, char *argv[], int first)
+{
+	std::vector<const char*> files;
+	for (int i = first; i < argc; i++){
+		if (argv[i][0] != '-') files.push_back(argv[i]);
+	}
+	if (files.empty()){
+		files.push_back("Media/ColumnScene/Poles.sdkmesh");
+		files.push_back("Media/ColumnScene/scene.sdkmesh");
+	}
+	return files;
+}
+
+static bool hasFlag(int argc, char *argv[], const char *flag)
+{
+	for (int i = 2; i < argc; i++){
+		if (strcmp(argv[i], flag) == 0) return true;
+	}
+	return false;
+}
+
+static bool loadSDKMesh(const char *path, std::vector<unsigned char> *bytes, SDKMeshParser *parser)
+{
+	if (!readFile(path, bytes)) return false;
+	SDKMESH_ERROR::ID id = parser->parse(bytes->data(), bytes->size());
+	if (id != SDKMESH_ERROR::NONE){
+		fprintf(stderr, "%s: %s, item %u\n", path, SDKMeshErrorName(id), parser->errorItem());
+		return false;
+	}
+	return true;
+}
+
+static int convert(int argc, char *argv[])
+{
+	if (argc < 4){
+		fprintf(stderr, "usage: tmesh_convert convert in.sdkmesh out.tmesh [-lz4] [-index32] [-optimize]\n");
+		return 1;
+	}
+	std::vector<unsigned char> bytes, out;
+	SDKMeshParser parser;
+	if (!loadSDKMesh(argv[2], &bytes, &parser)) return 1;
+
+	unsigned flags = (hasFlag(argc, argv, "-lz4") ? TMESH_CONVERT::LZ4 : 0) | (hasFlag(argc, argv, "-index32") ? TMESH_CONVERT::INDEX32 : 0)
+		| (hasFlag(argc, argv, "-optimize") ? TMESH_CONVERT::OPTIMIZE : 0);
+	std::string error;
+	if (!TMeshConvert(parser, flags, &out, &error)){
+		fprintf(stderr, "%s: %s\n", argv[2], error.c_str());
+		return 1;
+	}
+	if (!writeFile(argv[3], out)){
+		fprintf(stderr, "%s: cannot write\n", argv[3]);
+		return 1;
+	}
+
+	TMeshReader reader;
+	reader.parse(out.data(), out.size());
+	printf("%s,%u bytes -> %s,%u bytes,header_bytes=%u\n", argv[2], (unsigned)bytes.size(), argv[3],
+		(unsigned)out.size(), reader.header().header_bytes);
+	return 0;
+}
+
+// Every draw of the converted file fetches what the source drew
+static std::string compare(const SDKMeshParser &src, const TMeshReader &dst)
+{
+	if (dst.streams().size() != src.vertexBuffers().size()) return "stream count";
+	for (unsigned i = 0; i < dst.streams().size(); i++){
+		const TMESH_STREAM &s = dst.streams()[i];
+		std::vector<unsigned char> data((size_t)dst.sections()[s.section].bytes);
+		if (!dst.read(s.section, data.data())) return "vertex data " + std::to_string(i) + " unreadable";
+		if (s.stride != src.vertexBuffers()[i].StrideBytes || s.vertex_count != src.vertexBuffers()[i].NumVertices
+			|| memcmp(data.data(), src.vertexData(i).data(), data.size()) != 0) return "vertex data " + std::to_string(i);
+	}
+
+	if (dst.meshes().size() != src.meshes().size()) return "mesh count";
+	for (unsigned m = 0; m < dst.meshes().size(); m++){
+		const TMESH_MESH &mesh = dst.meshes()[m];
+		const SDKMESH_FILE_MESH &ref = src.meshes()[m];
+		const SDKMESH_FILE_INDEX_BUFFER &src_ib = src.indexBuffers()[ref.IndexBuffer];
+		const TMESH_INDEX_BUFFER &ib = dst.indexBuffers()[mesh.index_buffer];
+		std::vector<unsigned char> indices((size_t)dst.sections()[ib.section].bytes);
+		if (!dst.read(ib.section, indices.data())) return "index data unreadable";
+		if (mesh.subset_count != ref.NumSubsets || memcmp(mesh.center, src.meshBounds(m).center, sizeof(mesh.center)) != 0
+			|| memcmp(mesh.extents, src.meshBounds(m).extents, sizeof(mesh.extents)) != 0) return "mesh " + std::to_string(m);
+
+		for (unsigned k = 0; k < mesh.subset_count; k++){
+			const TMESH_SUBSET &subset = dst.subsets()[mesh.first_subset + k];
+			const SDKMESH_FILE_SUBSET &s = src.subsets()[src.meshSubsets(m)[k]];
+			if (subset.index_start != s.IndexStart || subset.index_count != s.IndexCount || (unsigned)subset.base_vertex != s.VertexStart
+				|| subset.material != s.MaterialID || strcmp(dst.string(subset.name), s.Name) != 0) return "subset " + std::to_string(k);
+			for (unsigned i = subset.index_start; i < subset.index_start + subset.index_count; i++){
+				unsigned a = 0, b = 0;
+				memcpy(&a, indices.data() + i * TMeshFormatBytes(ib.format), TMeshFormatBytes(ib.format));
+				memcpy(&b, src.indexData(ref.IndexBuffer).data() + i * (src_ib.IndexType ? 4 : 2), src_ib.IndexType ? 4 : 2);
+				if (a != b) return "index " + std::to_string(i);
+			}
+		}
+	}
+
+	if (dst.materials().size() != src.materials().size()) return "material count";
+	for (unsigned i = 0; i < dst.materials().size(); i++){
+		const TMESH_MATERIAL &m = dst.materials()[i];
+		const SDKMESH_FILE_MATERIAL &s = src.materials()[i];
+		if (strcmp(dst.string(m.diffuse_texture), s.DiffuseTexture) != 0 || strcmp(dst.string(m.normal_texture), s.NormalTexture) != 0
+			|| strcmp(dst.string(m.specular_texture), s.SpecularTexture) != 0
+			|| memcmp(m.diffuse, s.Diffuse, sizeof(m.diffuse)) != 0) return "material " + std::to_string(i);
+	}
+
+	// the sample files have one frame drawing mesh 0
+	if (dst.draws().size() != src.frames().size() || (!dst.draws().empty() && dst.draws()[0] != src.frames()[0].Mesh)) return "draws";
+	return "";
+}
+
+// Vertex data of a mesh's streams and its indices, either side
+struct MESH_VIEW
+{
+	std::vector<const unsigned char*> vertices;
+	std::vector<unsigned> strides;
+	unsigned vertex_count;
+	const unsigned char *indices;
+	unsigned index_bytes;
+};
+
+// The subset's triangles by the bytes of their vertices, each rotated to
+// start at its smallest vertex so the winding still counts, sorted
+static bool subsetTriangles(const MESH_VIEW &view, unsigned start, unsigned count, unsigned base_vertex, std::vector<std::string> *out)
+{
+	out->clear();
+	for (unsigned i = start; i + 3 <= start + count; i += 3){
+		std::string key[3];
+		for (unsigned k = 0; k < 3; k++){
+			unsigned v = 0;
+			memcpy(&v, view.indices + (size_t)(i + k) * view.index_bytes, view.index_bytes);
+			v += base_vertex;
+			if (view.vertex_count <= v) return false;
+			for (size_t s = 0; s < view.vertices.size(); s++) key[k].append((const char*)view.vertices[s] + (size_t)v * view.strides[s], view.strides[s]);
+		}
+		unsigned first = (key[1] < key[0]) ? 1 : 0;
+		first = (key[2] < key[first]) ? 2 : first;
+		out->push_back(key[first] + key[(first + 1) % 3] + key[(first + 2) % 3]);
+	}
+	std::sort(out->begin(), out->end());
+	return true;
+}
+
+// An optimized conversion draws the same triangles from the same vertices,
+// in its own order and under its own vertex ids
+static std::string compareOptimized(const SDKMeshParser &src, const TMeshReader &dst)
+{
+	if (!(dst.header().flags & TMESH_FLAG::OPTIMIZED)) return "flag";
+	if (dst.streams().size() != src.vertexBuffers().size() || dst.meshes().size() != src.meshes().size()) return "counts";
+
+	std::vector<std::vector<unsigned char> > sections(dst.sections().size());
+	for (unsigned i = 0; i < dst.sections().size(); i++){
+		if (dst.sections()[i].type < TMESH_SECTION_TYPE::VERTEX_DATA) continue;
+		sections[i].resize((size_t)dst.sections()[i].bytes);
+		if (!dst.read(i, sections[i].data())) return "section " + std::to_string(i) + " unreadable";
+	}
+
+	for (unsigned i = 0; i < dst.streams().size(); i++){
+		const TMESH_STREAM &s = dst.streams()[i];
+		const SDKMESH_FILE_VERTEX_BUFFER &vb = src.vertexBuffers()[i];
+		if (s.stride != vb.StrideBytes || s.vertex_count != vb.NumVertices) return "stream " + std::to_string(i);
+		std::vector<std::string> a, b;
+		for (unsigned v = 0; v < s.vertex_count; v++){
+			a.push_back(std::string((const char*)src.vertexData(i).data() + (size_t)v * s.stride, s.stride));
+			b.push_back(std::string((const char*)sections[s.section].data() + (size_t)v * s.stride, s.stride));
+		}
+		std::sort(a.begin(), a.end());
+		std::sort(b.begin(), b.end());
+		if (a != b) return "vertices of stream " + std::to_string(i);
+	}
+
+	for (unsigned m = 0; m < dst.meshes().size(); m++){
+		const TMESH_MESH &mesh = dst.meshes()[m];
+		const SDKMESH_FILE_MESH &ref = src.meshes()[m];
+		if (mesh.subset_count != ref.NumSubsets || mesh.stream_count != ref.NumVertexBuffers) return "mesh " + std::to_string(m);
+
+		MESH_VIEW from, to;
+		from.vertex_count = to.vertex_count = ~0u;
+		for (unsigned s = 0; s < mesh.stream_count; s++){
+			const TMESH_STREAM &stream = dst.streams()[mesh.streams[s]];
+			from.vertices.push_back(src.vertexData(ref.VertexBuffers[s]).data());
+			to.vertices.push_back(sections[stream.section].data());
+			from.strides.push_back(stream.stride);
+			to.strides.push_back(stream.stride);
+			from.vertex_count = to.vertex_count = std::min(to.vertex_count, stream.vertex_count);
+		}
+		const TMESH_INDEX_BUFFER &ib = dst.indexBuffers()[mesh.index_buffer];
+		from.indices = src.indexData(ref.IndexBuffer).data();
+		from.index_bytes = src.indexBuffers()[ref.IndexBuffer].IndexType ? 4 : 2;
+		to.indices = sections[ib.section].data();
+		to.index_bytes = TMeshFormatBytes(ib.format);
+
+		for (unsigned k = 0; k < mesh.subset_count; k++){
+			const TMESH_SUBSET &subset = dst.subsets()[mesh.first_subset + k];
+			const SDKMESH_FILE_SUBSET &s = src.subsets()[src.meshSubsets(m)[k]];
+			if (subset.index_start != s.IndexStart || subset.index_count != s.IndexCount || (unsigned)subset.base_vertex != s.VertexStart
+				|| subset.material != s.MaterialID) return "subset " + std::to_string(k);
+			std::vector<std::string> a, b;
+			if (!subsetTriangles(from, subset.index_start, subset.index_count, subset.base_vertex, &a)
+				|| !subsetTriangles(to, subset.index_start, subset.index_count, subset.base_vertex, &b)) return "index range of subset " + std::to_string(k);
+			if (a != b) return "triangles of subset " + std::to_string(k);
+		}
+	}
+	return "";
+}
+
+static TMESH_SECTION &sectionAt(std::vector<unsigned char> &b, unsigned i)
+{
+	return *(TMESH_SECTION*)&b[sizeof(TMESH_HEADER) + i * sizeof(TMESH_SECTION)];
+}
+
+template<class T>
+static T &metadataAt(std::vector<unsigned char> &b, TMESH_SECTION_TYPE::ID type, unsigned i)
+{
+	return *(T*)&b[(size_t)sectionAt(b, type).offset + i * sizeof(T)];
+}
+
+static const CORRUPTION<TMeshReader, TMESH_ERROR::ID> CORRUPTIONS[] = {
+	{ "magic", TMESH_ERROR::MAGIC, [](std::vector<unsigned char> &b, const TMeshReader &){
+		((TMESH_HEADER*)b.data())->magic ^= 1;
+	} },
+	{ "version", TMESH_ERROR::VERSION, [](std::vector<unsigned char> &b, const TMeshReader &){
+		((TMESH_HEADER*)b.data())->version = TMESH_VERSION + 1;
+	} },
+	{ "header_bytes_past_file", TMESH_ERROR::TRUNCATED, [](std::vector<unsigned char> &b, const TMeshReader &){
+		((TMESH_HEADER*)b.data())->header_bytes = (unsigned)b.size() + 64;
+	} },
+	{ "section_count", TMESH_ERROR::SECTION, [](std::vector<unsigned char> &b, const TMeshReader &){
+		((TMESH_HEADER*)b.data())->section_count = 0x10000000;
+	} },
+	{ "section_misaligned", TMESH_ERROR::SECTION, [](std::vector<unsigned char> &b, const TMeshReader &){
+		sectionAt(b, TMESH_SECTION_TYPE::VERTEX_DATA).offset += 4;
+	} },
+	{ "section_past_file", TMESH_ERROR::SECTION, [](std::vector<unsigned char> &b, const TMeshReader &){
+		sectionAt(b, TMESH_SECTION_TYPE::VERTEX_DATA).stored_bytes = ~0ull;
+	} },
+	{ "metadata_compressed", TMESH_ERROR::SECTION, [](std::vector<unsigned char> &b, const TMeshReader &){
+		sectionAt(b, TMESH_SECTION_TYPE::MESHES).compression = TMESH_COMPRESSION::LZ4;
+	} },
+	{ "mesh_count", TMESH_ERROR::SECTION, [](std::vector<unsigned char> &b, const TMeshReader &){
+		((TMESH_HEADER*)b.data())->mesh_count += 1;
+	} },
+	{ "stream_format", TMESH_ERROR::STREAM, [](std::vector<unsigned char> &b, const TMeshReader &){
+		metadataAt<TMESH_STREAM>(b, TMESH_SECTION_TYPE::STREAMS, 0).elements[0].format = 1;
+	} },
+	{ "stream_element_offset", TMESH_ERROR::STREAM, [](std::vector<unsigned char> &b, const TMeshReader &){
+		TMESH_STREAM &s = metadataAt<TMESH_STREAM>(b, TMESH_SECTION_TYPE::STREAMS, 0);
+		s.elements[0].offset = s.stride - 4;
+	} },
+	{ "stream_vertex_count", TMESH_ERROR::STREAM, [](std::vector<unsigned char> &b, const TMeshReader &){
+		metadataAt<TMESH_STREAM>(b, TMESH_SECTION_TYPE::STREAMS, 0).vertex_count += 1;
+	} },
+	{ "index_format", TMESH_ERROR::INDEX_BUFFER, [](std::vector<unsigned char> &b, const TMeshReader &){
+		metadataAt<TMESH_INDEX_BUFFER>(b, TMESH_SECTION_TYPE::INDEX_BUFFERS, 0).format = TMESH_FORMAT::R32_FLOAT;
+	} },
+	{ "mesh_stream", TMESH_ERROR::MESH, [](std::vector<unsigned char> &b, const TMeshReader &){
+		metadataAt<TMESH_MESH>(b, TMESH_SECTION_TYPE::MESHES, 0).streams[0] = 7;
+	} },
+	{ "mesh_subsets", TMESH_ERROR::MESH, [](std::vector<unsigned char> &b, const TMeshReader &){
+		metadataAt<TMESH_MESH>(b, TMESH_SECTION_TYPE::MESHES, 0).subset_count = 2;
+	} },
+	{ "subset_index_range", TMESH_ERROR::SUBSET, [](std::vector<unsigned char> &b, const TMeshReader &){
+		metadataAt<TMESH_SUBSET>(b, TMESH_SECTION_TYPE::SUBSETS, 0).index_count = ~0u;
+	} },
+	{ "subset_topology", TMESH_ERROR::SUBSET, [](std::vector<unsigned char> &b, const TMeshReader &){
+		metadataAt<TMESH_SUBSET>(b, TMESH_SECTION_TYPE::SUBSETS, 0).topology = 7;
+	} },
+	{ "draw_mesh", TMESH_ERROR::DRAW, [](std::vector<unsigned char> &b, const TMeshReader &){
+		metadataAt<unsigned>(b, TMESH_SECTION_TYPE::DRAWS, 0) = 1;
+	} },
+	{ "strings_unterminated", TMESH_ERROR::STRING, [](std::vector<unsigned char> &b, const TMeshReader &r){
+		b[(size_t)(sectionAt(b, TMESH_SECTION_TYPE::STRINGS).offset + r.header().string_bytes - 1)] = 'x';
+	} },
+	{ "material_texture", TMESH_ERROR::STRING, [](std::vector<unsigned char> &b, const TMeshReader &r){
+		metadataAt<TMESH_MATERIAL>(b, TMESH_SECTION_TYPE::MATERIALS, 0).diffuse_texture = r.header().string_bytes;
+	} },
+};
+
+static int check(const std::vector<const char*> &files)
+{
+	CheckReport report;
+
+	printf("file,check,result,detail\n");
+	for (const char *path : files){
+		std::vector<unsigned char> bytes;
+		SDKMeshParser parser;
+		bool loaded = loadSDKMesh(path, &bytes, &parser);
+		report(path, "source", loaded, "");
+		if (!loaded) continue;
+
+		static const struct{ const char *name; unsigned flags; } VARIANTS[] = {
+			{ "raw", 0 }, { "lz4", TMESH_CONVERT::LZ4 }, { "index32", TMESH_CONVERT::INDEX32 }, { "optimize", TMESH_CONVERT::OPTIMIZE },
+			{ "optimize_lz4", TMESH_CONVERT::OPTIMIZE | TMESH_CONVERT::LZ4 },
+		};
+		std::vector<unsigned char> raw, optimized;
+		for (const auto &v : VARIANTS){
+			std::vector<unsigned char> out;
+			std::string error;
+			TMeshReader reader;
+			bool converted = TMeshConvert(parser, v.flags, &out, &error);
+			TMESH_ERROR::ID id = converted ? reader.parse(out.data(), out.size()) : TMESH_ERROR::MAX;
+			bool reordered = (v.flags & TMESH_CONVERT::OPTIMIZE) != 0;
+			std::string diff = (id != TMESH_ERROR::NONE) ? std::string(converted ? TMeshErrorName(id) : error)
+				: reordered ? compareOptimized(parser, reader) : compare(parser, reader);
+			char detail[160];
+			snprintf(detail, sizeof(detail), "%u bytes header_bytes=%u %s", (unsigned)out.size(), reader.header().header_bytes, diff.c_str());
+			report(path, std::string("convert_") + v.name, diff.empty(), detail);
+			if (v.flags == 0) raw = out;
+			if (v.flags == TMESH_CONVERT::OPTIMIZE) optimized = out;
+		}
+		if (raw.empty()) continue;
+
+		// what a load without the offline pass does to the raw file
+		TMeshData data;
+		std::string raw_path = "tmesh_check_raw.tmesh";
+		bool written = writeFile(raw_path.c_str(), raw) && data.load(raw_path.c_str()) == TMESH_ERROR::NONE;
+		unsigned reordered = written ? data.optimize() : 0;
+		bool same = written;
+		for (unsigned i = 0; same && i < data.reader().sections().size(); i++){
+			const TMESH_SECTION &s = data.reader().sections()[i];
+			if (s.type < TMESH_SECTION_TYPE::VERTEX_DATA) continue;
+			const TMESH_SECTION &o = sectionAt(optimized, i);
+			same = s.bytes == o.bytes && (s.bytes == 0 || memcmp(data.data(i), optimized.data() + o.offset, (size_t)s.bytes) == 0);
+		}
+		remove(raw_path.c_str());
+		report(path, "load_time_optimize", same, "subsets=" + std::to_string(reordered));
+
+		// the image cut at header_bytes: all metadata, no data
+		TMeshReader full;
+		full.parse(raw.data(), raw.size());
+		TMeshReader head;
+		std::vector<unsigned char> prefix(raw.begin(), raw.begin() + full.header().header_bytes);
+		TMESH_ERROR::ID head_id = head.parse(prefix.data(), prefix.size());
+		bool no_data = true;
+		for (unsigned i = 0; i < head.sections().size(); i++){
+			if (TMESH_SECTION_TYPE::VERTEX_DATA <= head.sections()[i].type && head.hasData(i)) no_data = false;
+		}
+		report(path, "header_only_image", head_id == TMESH_ERROR::NONE && no_data && head.meshes().size() == full.meshes().size(), TMeshErrorName(head_id));
+
+		unsigned accepted = 0;
+		for (size_t n = 0; n < full.header().header_bytes; n++){
+			std::vector<unsigned char> cut(raw.begin(), raw.begin() + n);
+			TMeshReader r;
+			if (r.parse(cut.empty() ? nullptr : cut.data(), n) == TMESH_ERROR::NONE) accepted++;
+		}
+		report(path, "truncated_headers_rejected", accepted == 0, "accepted=" + std::to_string(accepted));
+
+		checkCorruptions(report, path, raw, full, CORRUPTIONS, TMeshErrorName);
+
+		// a damaged LZ4 block fails to decode instead of writing past its buffer
+		std::vector<unsigned char> lz4;
+		std::string error;
+		TMeshConvert(parser, TMESH_CONVERT::LZ4, &lz4, &error);
+		TMeshReader packed;
+		packed.parse(lz4.data(), lz4.size());
+		unsigned decoded = 0, tried = 0;
+		for (unsigned i = 0; i < packed.sections().size(); i++){
+			const TMESH_SECTION &s = packed.sections()[i];
+			if (s.compression != TMESH_COMPRESSION::LZ4) continue;
+			for (unsigned long long k = 0; k < s.stored_bytes; k += 7){
+				std::vector<unsigned char> bad = lz4;
+				bad[(size_t)(s.offset + k)] ^= 0x5a;
+				TMeshReader r;
+				if (r.parse(bad.data(), bad.size()) != TMESH_ERROR::NONE) continue;
+				std::vector<unsigned char> dst((size_t)s.bytes);
+				tried++;
+				if (r.read(i, dst.data())) decoded++;
+			}
+		}
+		report(path, "lz4_damage", true, "damaged=" + std::to_string(tried) + " still_decoded=" + std::to_string(decoded));
+
+		std::string shipped = tmeshPath(path);
+		std::vector<unsigned char> on_disk;
+		bool present = readFile(shipped.c_str(), &on_disk);
+		report(path, "shipped_tmesh_current", present && on_disk == optimized, shipped + (present ? "" : " missing"));
+	}
+	return report.ok() ? 0 : 1;
+}
+
+// The loads being compared, each up to the bytes a CreateBuffer would copy
+// from: one heap block per buffer, standing in for the initial data
+struct UPLOAD
+{
+	std::vector<std::vector<unsigned char> > buffers;
+	unsigned reads;
+};
+
+static bool loadSDKMeshPath(const char *path, UPLOAD *up)
+{
+	std::vector<unsigned char> bytes;
+	SDKMeshParser parser;
+	if (!readFile(path, &bytes) || parser.parse(bytes.data(), bytes.size()) != SDKMESH_ERROR::NONE) return false;
+	std::vector<unsigned char> heap(bytes.begin(), bytes.begin() + parser.staticSize());	// the fixup copy
+	up->buffers.clear();
+	for (unsigned i = 0; i < parser.vertexBuffers().size(); i++){
+		Span<unsigned char> d = parser.vertexData(i);
+		up->buffers.push_back(std::vector<unsigned char>(d.begin(), d.end()));
+	}
+	for (unsigned i = 0; i < parser.indexBuffers().size(); i++){
+		Span<unsigned char> d = parser.indexData(i);
+		up->buffers.push_back(std::vector<unsigned char>(d.begin(), d.end()));
+	}
+	up->reads = 1;
+	return !heap.empty();
+}
+
+// One read for the header and metadata, then each data section read
+// straight into its buffer, or into scratch and decoded there
+static bool loadTMeshPath(const char *path, UPLOAD *up)
+{
+	FILE *fp = fopen(path, "rb");
+	if (!fp) return false;
+	TMESH_HEADER header;
+	std::vector<unsigned long long> head;
+	TMeshReader reader;
+	bool ok = fread(&header, sizeof(header), 1, fp) == 1 && sizeof(header) <= header.header_bytes;
+	if (ok){
+		head.resize((header.header_bytes + 7) / 8);
+		memcpy(head.data(), &header, sizeof(header));
+		ok = fread((char*)head.data() + sizeof(header), 1, header.header_bytes - sizeof(header), fp) == header.header_bytes - sizeof(header)
+			&& reader.parse(head.data(), header.header_bytes) == TMESH_ERROR::NONE;
+	}
+	up->buffers.clear();
+	up->reads = 2;
+	std::vector<unsigned char> scratch;
+	for (unsigned i = 0; ok && i < reader.sections().size(); i++){
+		const TMESH_SECTION &s = reader.sections()[i];
+		if (s.type < TMESH_SECTION_TYPE::VERTEX_DATA) continue;
+		up->buffers.push_back(std::vector<unsigned char>((size_t)s.bytes));
+		std::vector<unsigned char> &dst = up->buffers.back();
+		bool packed = s.compression != TMESH_COMPRESSION::NONE;
+		if (packed) scratch.resize((size_t)s.stored_bytes);
+		ok = fseek(fp, (long)s.offset, SEEK_SET) == 0
+			&& fread(packed ? scratch.data() : dst.data(), 1, (size_t)s.stored_bytes, fp) == s.stored_bytes
+			&& (!packed || TMeshReader::decode(s, scratch.data(), dst.data()));
+		up->reads++;
+	}
+	fclose(fp);
+	return ok;
+}
+
+static int bench(const std::vector<const char*> &files, int iterations)
+{
+	typedef std::chrono::high_resolution_clock CLOCK;
+	printf("file,format,file_bytes,buffer_bytes,reads,load_us\n");
+	for (const char *path : files){
+		std::vector<unsigned char> bytes;
+		SDKMeshParser parser;
+		if (!loadSDKMesh(path, &bytes, &parser)) return 1;
+
+		// converted variants go next to the tool's working files
+		std::string raw_path = std::string("tmesh_bench_raw.tmesh"), lz4_path = std::string("tmesh_bench_lz4.tmesh");
+		std::vector<unsigned char> raw, lz4;
+		std::string error;
+		if (!TMeshConvert(parser, 0, &raw, &error) || !TMeshConvert(parser, TMESH_CONVERT::LZ4, &lz4, &error)
+			|| !writeFile(raw_path.c_str(), raw) || !writeFile(lz4_path.c_str(), lz4)){
+			fprintf(stderr, "%s: %s\n", path, error.c_str());
+			return 1;
+		}
+
+		struct CASE{ const char *name; std::string file; bool (*load)(const char*, UPLOAD*); size_t bytes; };
+		const CASE cases[] = {
+			{ "sdkmesh", path, loadSDKMeshPath, bytes.size() },
+			{ "tmesh", raw_path, loadTMeshPath, raw.size() },
+			{ "tmesh_lz4", lz4_path, loadTMeshPath, lz4.size() },
+		};
+		for (const CASE &c : cases){
+			UPLOAD up;
+			if (!c.load(c.file.c_str(), &up)){
+				printf("%s,%s,FAIL\n", path, c.name);
+				return 1;
+			}
+			size_t buffer_bytes = 0;
+			for (const std::vector<unsigned char> &b : up.buffers) buffer_bytes += b.size();
+
+			CLOCK::time_point t0 = CLOCK::now();
+			for (int i = 0; i < iterations; i++) c.load(c.file.c_str(), &up);
+			double us = std::chrono::duration<double, std::micro>(CLOCK::now() - t0).count() / iterations;
+			printf("%s,%s,%u,%u,%u,%.1f\n", path, c.name, (unsigned)c.bytes, (unsigned)buffer_bytes, up.reads, us);
+		}
+		remove(raw_path.c_str());
+		remove(lz4_path.c_str());
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	std::string cmd = (1 < argc) ? argv[1] : "";
+	int iterations = 2000;
+	for (int i = 2; i + 1 < argc; i++){
+		if (strcmp(argv[i], "-iterations") == 0){
+			iterations = atoi(argv[i + 1]);
+			argv[i + 1] = (char*)"-";
+		}
+	}
+	iterations = (0 < iterations) ? iterations : 1;
+
+	if (cmd == "convert") return convert(argc, argv);
+	if (cmd == "check") return check(mediaFiles(argc, argv, 2));
+	if (cmd == "bench") return bench(mediaFiles(argc, argv, 2), iterations);
+
+	fprintf(stderr, "usage: tmesh_convert convert|check|bench ...\n");
+	return 1;
+}
@@ -0,0 +1,189 @@
+#include "AsyncLoader.h"
+
+namespace tpot
+{
+
+AsyncLoader::AsyncLoader(unsigned thread_count)
+	: completed_(0), quit_(false), stats_(), pool_(thread_count)
+{
+}
+
+AsyncLoader::~AsyncLoader()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	quit_ = true;
+}
+
+AsyncLoader::JOB AsyncLoader::submit(WORK load, WORK create, size_t cost, const std::vector<JOB> &after)
+{
+	JOB job;
+	bool queue = (bool)load;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		items_.push_back(ITEM());
+		job = items_.size();
+		ITEM &item = items_.back();
+		item.load = std::move(load);
+		item.create = std::move(create);
+		item.cost = cost;
+		for (JOB a : after){
+			if (a != 0 && a < job) item.after.push_back(a);
+		}
+		item.state = queue ? LOAD_STATE::QUEUED : LOAD_STATE::LOADED;
+	}
+	if (queue){
+		pool_.submit([this, job]{ run(job); });
+	}else{
+		loaded_cv_.notify_all();
+	}
+	return job;
+}
+
+void AsyncLoader::run(JOB job)
+{
+	WORK load;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		ITEM &item = items_[job - 1];
+		if (quit_ || item.state != LOAD_STATE::QUEUED) return;
+		item.state = LOAD_STATE::LOADING;
+		load = std::move(item.load);
+	}
+
+	bool ok = load();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		ITEM &item = items_[job - 1];
+		if (item.state == LOAD_STATE::LOADING){	// not cancelled meanwhile
+			if (ok){
+				item.state = LOAD_STATE::LOADED;
+				stats_.loaded++;
+			}else{
+				item.state = LOAD_STATE::FAILED;
+				item.create = nullptr;
+				stats_.failed++;
+				advance();
+			}
+		}
+	}
+	loaded_cv_.notify_all();
+}
+
+AsyncLoader::JOB AsyncLoader::nextCreate(size_t spent, size_t budget) const
+{
+	for (JOB job = completed_ + 1; job <= items_.size(); job++){
+		const ITEM &item = items_[job - 1];
+		if (item.state != LOAD_STATE::LOADED) continue;
+
+		bool waiting = false;
+		for (JOB a : item.after){
+			if (!finished(items_[a - 1].state)) waiting = true;
+		}
+		if (waiting) continue;
+
+		// in order: a later, smaller job does not overtake one over budget
+		return (spent == 0 || item.cost <= budget - spent) ? job : 0;
+	}
+	return 0;
+}
+
+void AsyncLoader::advance()
+{
+	while (completed_ < items_.size() && finished(items_[completed_].state)) completed_++;
+}
+
+unsigned AsyncLoader::pump(size_t budget)
+{
+	unsigned count = 0;
+	size_t spent = 0;
+	for (;;){
+		JOB job;
+		WORK create;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			job = nextCreate(spent, budget);
+			if (job == 0) break;
+			ITEM &item = items_[job - 1];
+			create = std::move(item.create);
+			spent += item.cost;
+		}
+
+		// may submit(); items_ is only appended to meanwhile
+		bool ok = !create || create();
+		count++;
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		ITEM &item = items_[job - 1];
+		if (item.state != LOAD_STATE::LOADED) continue;	// cancelled by its own create()
+		item.state = ok ? LOAD_STATE::READY : LOAD_STATE::FAILED;
+		if (ok) stats_.created++;
+		else stats_.failed++;
+		advance();
+	}
+
+	if (count){
+		std::lock_guard<std::mutex> lock(mutex_);
+		stats_.pumps++;
+		if (stats_.max_pump_cost < spent) stats_.max_pump_cost = spent;
+	}
+	return count;
+}
+
+void AsyncLoader::finish(JOB job)
+{
+	for (;;){
+		pump();
+
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (job == 0 ? items_.size() <= completed_ : (items_.size() < job || job <= completed_ || finished(items_[job - 1].state))) return;
+		if (nextCreate(0, ~(size_t)0) != 0) continue;
+		loaded_cv_.wait(lock);
+	}
+}
+
+void AsyncLoader::cancel(JOB job)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (job == 0 || items_.size() < job) return;
+	ITEM &item = items_[job - 1];
+	if (finished(item.state)) return;
+
+	// a running load() keeps its own state alive; only create() is dropped
+	item.state = LOAD_STATE::CANCELLED;
+	if (item.load) item.load = nullptr;
+	item.create = nullptr;
+	stats_.cancelled++;
+	advance();
+}
+
+LOAD_STATE::ID AsyncLoader::state(JOB job) const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return (job == 0 || items_.size() < job) ? LOAD_STATE::CANCELLED : items_[job - 1].state;
+}
+
+bool AsyncLoader::isFinished(JOB job) const
+{
+	return finished(state(job));
+}
+
+AsyncLoader::JOB AsyncLoader::submitted() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return items_.size();
+}
+
+AsyncLoader::JOB AsyncLoader::completed() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return completed_;
+}
+
+AsyncLoader::STATS AsyncLoader::stats() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return stats_;
+}
+
+}// namespace tpot
@@ -0,0 +1,105 @@
+#ifndef TPOT_ASYNC_LOADER_H__
+#define TPOT_ASYNC_LOADER_H__
+
+#include <stddef.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include "ThreadPool.h"
+
+namespace tpot
+{
+
+	struct LOAD_STATE{
+		enum ID{
+			QUEUED,
+			LOADING,	// load() running on a worker
+			LOADED,		// waiting for pump() on the device thread
+			READY,		// create() succeeded
+			FAILED,		// load() or create() returned false
+			CANCELLED,
+
+			MAX,
+		};
+	};
+
+	// Background loading split the way D3D11 wants it: load() does file I/O
+	// and decoding on a worker, create() makes the GPU objects on the device
+	// thread from pump(), a budget at a time so a frame never stalls on a
+	// whole scene. load() must not touch the device, create() must not block.
+	//
+	// Jobs are numbered from 1 in submission order and double as fences:
+	// completed() is the latest job up to which every job is finished.
+	// A job may wait for earlier ones, finished either way, before its
+	// create() runs.
+	class AsyncLoader
+	{
+	public:
+		typedef unsigned long long JOB;	// 0: none
+		typedef std::function<bool()> WORK;
+
+		struct STATS
+		{
+			unsigned loaded;		// load() calls that returned true
+			unsigned created;		// create() calls that returned true
+			unsigned failed;
+			unsigned cancelled;
+			unsigned pumps;			// pump() calls that created something
+			size_t   max_pump_cost;	// largest cost created by one pump()
+		};
+
+	private:
+		struct ITEM
+		{
+			WORK             load;
+			WORK             create;
+			size_t           cost;
+			std::vector<JOB> after;
+			LOAD_STATE::ID   state;
+		};
+
+		mutable std::mutex      mutex_;
+		std::condition_variable loaded_cv_;
+		std::deque<ITEM>        items_;	// items_[job - 1]
+		JOB                     completed_;
+		bool                    quit_;
+		STATS                   stats_;
+		ThreadPool              pool_;	// last: joined before the rest goes away
+
+		static bool finished(LOAD_STATE::ID s){ return s == LOAD_STATE::READY || s == LOAD_STATE::FAILED || s == LOAD_STATE::CANCELLED; }
+		void run(JOB job);
+		JOB nextCreate(size_t spent, size_t budget) const;
+		void advance();
+
+		AsyncLoader(const AsyncLoader &);
+		AsyncLoader &operator=(const AsyncLoader &);
+
+	public:
+		explicit AsyncLoader(unsigned thread_count = 0);	// 0: hardware concurrency
+		~AsyncLoader();	// queued loads are skipped, running ones finish, no create() runs
+
+		// Any thread, create() included. cost counts against the pump() budget
+		// (bytes uploaded, say); after lists earlier jobs, later ones are ignored.
+		JOB submit(WORK load, WORK create, size_t cost = 0, const std::vector<JOB> &after = std::vector<JOB>());
+
+		// Device thread: create() of loaded jobs whose waits are over, oldest
+		// first, until budget is spent; the first always runs. A job still
+		// loading holds back no later one.
+		// Returns the number of create() calls.
+		unsigned pump(size_t budget = ~(size_t)0);
+		// Device thread: pumps and waits until job, 0 for every job, is finished
+		void finish(JOB job = 0);
+		// Device thread: create() of the job will not run
+		void cancel(JOB job);
+
+		LOAD_STATE::ID state(JOB job) const;	// CANCELLED for an unknown job
+		bool isFinished(JOB job) const;
+		JOB submitted() const;
+		JOB completed() const;
+		STATS stats() const;
+	};
+
+}// namespace tpot
+#endif // TPOT_ASYNC_LOADER_H__
@@ -0,0 +1,1063 @@
+#include "DXUT.h"
+#include "SDKmisc.h"
+#include <d3d11_1.h>
+#include <array>
+#include <string>
+#include "RenderTarget.h"
+#include "D3D11Device.h"
+#include "UploadRing.h"
+#include "ShaderCache.h"
+#include "ShaderPermutation.h"
+#include "ThreadPool.h"
+#include "AsyncLoader.h"
+#include "mesh.h"
+
+namespace tpot
+{
+
+class RasterStates
+{
+public:
+
+private:
+	ID3D11RasterizerState* pRasterizerStates_[RASTERIZER_STATE::MAX];
+
+public:
+
+	RasterStates( ID3D11Device *pd3dDevice );
+	~RasterStates();
+
+	void set(RASTERIZER_STATE::ID id, ID3D11DeviceContext *pd3dImmediateContext);
+};
+
+class SamplerStates
+{
+public:
+
+private:
+	ID3D11SamplerState* pSamplerStates_[SAMPLER_STATE::MAX];
+
+public:
+
+	SamplerStates(ID3D11Device *pd3dDevice);
+	~SamplerStates();
+
+	void set(UINT slot, SAMPLER_STATE::ID id, ID3D11DeviceContext *pd3dImmediateContext);
+};
+
+class DepthStencilStates
+{
+public:
+
+private:
+	ID3D11DepthStencilState* pDepthStencilStates_[DEPTH_STATE::MAX];
+
+public:
+
+	DepthStencilStates(ID3D11Device *pd3dDevice);
+	~DepthStencilStates();
+
+	void set(DEPTH_STATE::ID id, ID3D11DeviceContext *pd3dImmediateContext);
+};
+
+
+class ConstantBuffer
+{
+	ID3D11Buffer*                       pCB_;
+public:
+	ConstantBuffer( UINT size, ID3D11Device *pd3dDevice );
+	~ConstantBuffer();
+
+	void *Map(ID3D11DeviceContext *pd3dImmediateContext);
+	void UmMap(ID3D11DeviceContext *pd3dImmediateContext);
+	ID3D11Buffer* const *get();
+};
+
+
+ConstantBuffer::ConstantBuffer( UINT size, ID3D11Device *pd3dDevice )
+{
+
+	D3D11_BUFFER_DESC Desc;
+	Desc.Usage = D3D11_USAGE_DYNAMIC;
+	Desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	Desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	Desc.MiscFlags = 0;
+
+	Desc.ByteWidth = size;
+	HRESULT hr = pd3dDevice->CreateBuffer( &Desc, NULL, &pCB_ );
+	if ( hr != S_OK )
+	{
+		return;
+	}
+
+	DXUT_SetDebugName( pCB_, "CB_DEFAULT" );
+}
+
+
+ConstantBuffer::~ConstantBuffer()
+{
+	SAFE_RELEASE( pCB_ );
+}
+
+
+void *ConstantBuffer::Map(ID3D11DeviceContext *pd3dImmediateContext)
+{
+	D3D11_MAPPED_SUBRESOURCE MappedResource;
+	pd3dImmediateContext->Map( pCB_, 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedResource );
+
+	return MappedResource.pData;
+}
+
+
+void ConstantBuffer::UmMap(ID3D11DeviceContext *pd3dImmediateContext)
+{
+	pd3dImmediateContext->Unmap( pCB_, 0 );
+}
+
+
+ID3D11Buffer* const *ConstantBuffer::get()
+{
+	return &pCB_;
+}
+
+
+// Constant data of every VS in one dynamic buffer, bound by offset
+// (D3D11.1). Frames are fenced with event queries and their space is
+// reused once the GPU is past them, so the buffer is only ever mapped
+// NO_OVERWRITE. Disabled where the runtime cannot offset constant buffers;
+// the per VS ConstantBuffer is used then.
+class ConstantRing
+{
+	enum{
+		SIZE = 256 * 1024,
+		QUERY_MAX = 4,	// frames in flight
+	};
+
+	ID3D11DeviceContext1 *pContext1_;
+	ID3D11Buffer         *pBuffer_;
+	ID3D11Query          *pQuery_[QUERY_MAX];
+	UploadRing           ring_;
+	UploadRing::FENCE    fence_;		// frame being built
+	UploadRing::FENCE    completed_;
+	bool                 discarded_;	// the first Map must discard
+
+	bool poll(UploadRing::FENCE fence, bool wait);
+public:
+	ConstantRing( ID3D11Device *pd3dDevice, ID3D11DeviceContext *pd3dImmediateContext );
+	~ConstantRing();
+
+	bool enabled() const { return pBuffer_ != nullptr; }
+
+	void beginFrame();
+	UINT allocate(UINT size); // ~0: the current frame alone fills the ring
+	void *Map(UINT offset);
+	void UmMap();
+	void set(STAGE::ID stage, UINT offset, UINT size);
+};
+
+ConstantRing::ConstantRing( ID3D11Device *pd3dDevice, ID3D11DeviceContext *pd3dImmediateContext )
+	: pContext1_(nullptr), pBuffer_(nullptr), ring_(SIZE), fence_(1), completed_(0), discarded_(false)
+{
+	for (auto &x : pQuery_) x = nullptr;
+
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	if (FAILED(pd3dDevice->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options)))) return;
+	if (!options.ConstantBufferOffsetting || !options.MapNoOverwriteOnDynamicConstantBuffer) return;
+	if (FAILED(pd3dImmediateContext->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)&pContext1_))) return;
+
+	D3D11_QUERY_DESC qd = { D3D11_QUERY_EVENT, 0 };
+	for (auto &x : pQuery_){
+		if (FAILED(pd3dDevice->CreateQuery(&qd, &x))) return;
+	}
+
+	D3D11_BUFFER_DESC Desc;
+	Desc.Usage = D3D11_USAGE_DYNAMIC;
+	Desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	Desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	Desc.MiscFlags = 0;
+	Desc.StructureByteStride = 0;
+	Desc.ByteWidth = SIZE;
+	if (FAILED(pd3dDevice->CreateBuffer(&Desc, NULL, &pBuffer_))){
+		pBuffer_ = nullptr;
+		return;
+	}
+	DXUT_SetDebugName(pBuffer_, "CB_RING");
+}
+
+ConstantRing::~ConstantRing()
+{
+	SAFE_RELEASE(pBuffer_);
+	for (auto &x : pQuery_) SAFE_RELEASE(x);
+	SAFE_RELEASE(pContext1_);
+}
+
+// true when the GPU has passed fence
+bool ConstantRing::poll(UploadRing::FENCE fence, bool wait)
+{
+	while (completed_ < fence){
+		ID3D11Query *pQuery = pQuery_[(completed_ + 1) % QUERY_MAX];
+		HRESULT hr;
+		while ((hr = pContext1_->GetData(pQuery, NULL, 0, wait ? 0 : D3D11_ASYNC_GETDATA_DONOTFLUSH)) == S_FALSE){
+			if (!wait) return false;
+			SwitchToThread();
+		}
+		completed_++; // S_OK, or a lost device that will not signal anyway
+	}
+	ring_.retire(completed_);
+	return true;
+}
+
+void ConstantRing::beginFrame()
+{
+	if (!enabled()) return;
+
+	// the query of fence_ is the one of fence_ - QUERY_MAX
+	if (QUERY_MAX <= fence_ - completed_) poll(fence_ - QUERY_MAX, true);
+
+	pContext1_->End(pQuery_[fence_ % QUERY_MAX]);
+	ring_.endFrame(fence_);
+	fence_++;
+
+	poll(fence_ - 1, false);
+}
+
+UINT ConstantRing::allocate(UINT size)
+{
+	UINT offset = ring_.allocate(size);
+	while (offset == ~0u && ring_.framesInFlight()){
+		poll(ring_.oldestFence(), true);
+		offset = ring_.allocate(size);
+	}
+	return offset;
+}
+
+void *ConstantRing::Map(UINT offset)
+{
+	D3D11_MAPPED_SUBRESOURCE MappedResource;
+	if (FAILED(pContext1_->Map(pBuffer_, 0, discarded_ ? D3D11_MAP_WRITE_NO_OVERWRITE : D3D11_MAP_WRITE_DISCARD, 0, &MappedResource))){
+		return nullptr;
+	}
+	discarded_ = true;
+	return (BYTE*)MappedResource.pData + offset;
+}
+
+void ConstantRing::UmMap()
+{
+	pContext1_->Unmap(pBuffer_, 0);
+}
+
+void ConstantRing::set(STAGE::ID stage, UINT offset, UINT size)
+{
+	// in shader constants, multiples of 16
+	UINT first = offset / 16;
+	UINT num = UploadRing::align(size) / 16;
+
+	switch (stage){
+	case STAGE::VS: pContext1_->VSSetConstantBuffers1(0, 1, &pBuffer_, &first, &num); break;
+	case STAGE::HS: pContext1_->HSSetConstantBuffers1(0, 1, &pBuffer_, &first, &num); break;
+	case STAGE::DS: pContext1_->DSSetConstantBuffers1(0, 1, &pBuffer_, &first, &num); break;
+	case STAGE::GS: pContext1_->GSSetConstantBuffers1(0, 1, &pBuffer_, &first, &num); break;
+	case STAGE::PS: pContext1_->PSSetConstantBuffers1(0, 1, &pBuffer_, &first, &num); break;
+	case STAGE::CS: pContext1_->CSSetConstantBuffers1(0, 1, &pBuffer_, &first, &num); break;
+	}
+}
+
+
+// GPU time from beginFrame() to endFrame(): a disjoint query around two
+// timestamps per frame, read back without waiting. A frame whose queries
+// are still out when its slot comes round again is dropped.
+class GpuTimer
+{
+	enum{
+		QUERY_MAX = 4,	// frames in flight
+	};
+
+	ID3D11DeviceContext *pContext_;
+	ID3D11Query         *pDisjoint_[QUERY_MAX];
+	ID3D11Query         *pBegin_[QUERY_MAX];
+	ID3D11Query         *pEnd_[QUERY_MAX];
+	UINT64               issued_;	// frames closed by end()
+	UINT64               read_;		// frames read back or dropped
+	bool                 open_;
+	bool                 valid_;
+	float                ms_;
+
+	void poll();
+public:
+	GpuTimer( ID3D11Device *pd3dDevice, ID3D11DeviceContext *pd3dImmediateContext );
+	~GpuTimer();
+
+	bool enabled() const { return pDisjoint_[QUERY_MAX - 1] != nullptr && pEnd_[QUERY_MAX - 1] != nullptr; }
+
+	void begin();
+	void end();
+	bool get(float *ms);
+};
+
+GpuTimer::GpuTimer( ID3D11Device *pd3dDevice, ID3D11DeviceContext *pd3dImmediateContext )
+	: pContext_(pd3dImmediateContext), issued_(0), read_(0), open_(false), valid_(false), ms_(0.0f)
+{
+	for (auto &x : pDisjoint_) x = nullptr;
+	for (auto &x : pBegin_) x = nullptr;
+	for (auto &x : pEnd_) x = nullptr;
+
+	D3D11_QUERY_DESC disjoint = { D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
+	D3D11_QUERY_DESC timestamp = { D3D11_QUERY_TIMESTAMP, 0 };
+	for (int i = 0; i < QUERY_MAX; i++){
+		if (FAILED(pd3dDevice->CreateQuery(&disjoint, &pDisjoint_[i]))) return;
+		if (FAILED(pd3dDevice->CreateQuery(&timestamp, &pBegin_[i]))) return;
+		if (FAILED(pd3dDevice->CreateQuery(&timestamp, &pEnd_[i]))) return;
+	}
+}
+
+GpuTimer::~GpuTimer()
+{
+	for (auto &x : pDisjoint_) SAFE_RELEASE(x);
+	for (auto &x : pBegin_) SAFE_RELEASE(x);
+	for (auto &x : pEnd_) SAFE_RELEASE(x);
+}
+
+void GpuTimer::poll()
+{
+	while (read_ < issued_){
+		UINT i = (UINT)(read_ % QUERY_MAX);
+		D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+		UINT64 t0, t1;
+		if (pContext_->GetData(pDisjoint_[i], &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) return;
+		if (pContext_->GetData(pBegin_[i], &t0, sizeof(t0), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) return;
+		if (pContext_->GetData(pEnd_[i], &t1, sizeof(t1), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) return;
+		if (!disjoint.Disjoint && disjoint.Frequency && t0 <= t1){// else the clock changed, skip the frame
+			ms_ = (float)(1000.0 * (double)(t1 - t0) / (double)disjoint.Frequency);
+			valid_ = true;
+		}
+		read_++;
+	}
+}
+
+void GpuTimer::begin()
+{
+	if (!enabled() || open_) return;
+	poll();
+	if (QUERY_MAX <= issued_ - read_) read_ = issued_ - QUERY_MAX + 1;
+
+	UINT i = (UINT)(issued_ % QUERY_MAX);
+	pContext_->Begin(pDisjoint_[i]);
+	pContext_->End(pBegin_[i]);
+	open_ = true;
+}
+
+void GpuTimer::end()
+{
+	if (!open_) return;
+	UINT i = (UINT)(issued_ % QUERY_MAX);
+	pContext_->End(pEnd_[i]);
+	pContext_->End(pDisjoint_[i]);
+	issued_++;
+	open_ = false;
+}
+
+bool GpuTimer::get(float *ms)
+{
+	poll();
+	if (valid_) *ms = ms_;
+	return valid_;
+}
+
+
+RasterStates::RasterStates( ID3D11Device *pd3dDevice )
+{
+	HRESULT hr;
+
+	D3D11_RASTERIZER_DESC RasterDesc;
+	ZeroMemory( &RasterDesc, sizeof( D3D11_RASTERIZER_DESC ) );
+	RasterDesc.FillMode = D3D11_FILL_SOLID;
+	RasterDesc.CullMode = D3D11_CULL_NONE;
+	RasterDesc.DepthClipEnable = TRUE;
+
+	hr = pd3dDevice->CreateRasterizerState(&RasterDesc, &pRasterizerStates_[RASTERIZER_STATE::SOLID]);
+	if( hr != S_OK )
+	{
+		return;
+	}
+	DXUT_SetDebugName(pRasterizerStates_[RASTERIZER_STATE::SOLID], "Solid");
+
+	RasterDesc.FillMode = D3D11_FILL_WIREFRAME;
+	hr = pd3dDevice->CreateRasterizerState(&RasterDesc, &pRasterizerStates_[RASTERIZER_STATE::WIREFRAME]);
+	if( hr != S_OK )
+	{
+		return;
+	}
+	DXUT_SetDebugName(pRasterizerStates_[RASTERIZER_STATE::WIREFRAME], "Wireframe");
+}
+
+
+RasterStates::~RasterStates()
+{
+	for( auto it : pRasterizerStates_ ){
+		SAFE_RELEASE( it );
+	}
+}
+
+void RasterStates::set(RASTERIZER_STATE::ID id, ID3D11DeviceContext *pd3dImmediateContext)
+{
+	pd3dImmediateContext->RSSetState( pRasterizerStates_[id] );
+}
+
+SamplerStates::SamplerStates(ID3D11Device *pd3dDevice)
+{
+	HRESULT hr;
+
+	// Point
+	D3D11_SAMPLER_DESC SamDesc;
+	SamDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
+	SamDesc.AddressU = D3D11_TEXTURE_ADDRESS_BORDER;
+	SamDesc.AddressV = D3D11_TEXTURE_ADDRESS_BORDER;
+	SamDesc.AddressW = D3D11_TEXTURE_ADDRESS_BORDER;
+	SamDesc.MipLODBias = 0.0f;
+	SamDesc.MaxAnisotropy = 1;
+	SamDesc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
+	SamDesc.BorderColor[0] = SamDesc.BorderColor[1] = SamDesc.BorderColor[2] = SamDesc.BorderColor[3] = 1.0;
+	SamDesc.MinLOD = 0;
+	SamDesc.MaxLOD = D3D11_FLOAT32_MAX;
+	V(pd3dDevice->CreateSamplerState(&SamDesc, &pSamplerStates_[SAMPLER_STATE::POINT]));
+	DXUT_SetDebugName(pSamplerStates_[SAMPLER_STATE::POINT], "Point");
+
+	// Linear
+	SamDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	SamDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
+	SamDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
+	SamDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
+	V(pd3dDevice->CreateSamplerState(&SamDesc, &pSamplerStates_[SAMPLER_STATE::LINEAR]));
+	DXUT_SetDebugName(pSamplerStates_[SAMPLER_STATE::LINEAR], "Linear");
+
+}
+
+SamplerStates::~SamplerStates()
+{
+	for( auto it : pSamplerStates_ )
+	{
+	    SAFE_RELEASE( it );
+	}
+}
+
+void SamplerStates::set(UINT slot, SAMPLER_STATE::ID id, ID3D11DeviceContext *pd3dImmediateContext)
+{
+	pd3dImmediateContext->PSSetSamplers(slot, 1, &pSamplerStates_[id]);
+}
+
+DepthStencilStates::DepthStencilStates(ID3D11Device *pd3dDevice)
+{
+	HRESULT hr;
+
+	pDepthStencilStates_[DEPTH_STATE::UNUSED] = nullptr;
+
+	D3D11_DEPTH_STENCIL_DESC Desc;
+
+	ZeroMemory(&Desc, sizeof(Desc));
+	V(pd3dDevice->CreateDepthStencilState(&Desc, &pDepthStencilStates_[DEPTH_STATE::DISABLE]));
+
+}
+
+DepthStencilStates::~DepthStencilStates()
+{
+	for (auto it : pDepthStencilStates_)
+	{
+		SAFE_RELEASE(it);
+	}
+}
+
+void DepthStencilStates::set(DEPTH_STATE::ID id, ID3D11DeviceContext *pd3dImmediateContext)
+{
+	pd3dImmediateContext->OMSetDepthStencilState(pDepthStencilStates_[id], 0);
+}
+
+class Shader
+{
+	std::array<ID3D11VertexShader*,		VS::MAX>	pVertexShader_;
+	std::array<ID3D11HullShader*,		HS::MAX>	pHullShader_;
+	std::array<ID3D11DomainShader*,		DS::MAX>	pDomainShader_;
+	std::array<ID3D11GeometryShader*,	GS::MAX>	pGeometryShader_;
+	std::array<ID3D11PixelShader*,		PS::MAX>	pPixelShader_;
+	std::array<ID3D11ComputeShader*,	CS::MAX>	pComputeShader_;
+
+	std::array<ID3D11InputLayout*,		VS::MAX>	pLayout_;
+	std::array<ConstantBuffer*,			VS::MAX>	pCB_;
+
+	UINT								vs_current_;
+
+public:
+	Shader( ID3D11Device *pd3dDevice, ID3D11DeviceContext *pd3dImmediateContext );
+	~Shader();
+
+	void setVS(VS::ID id, ID3D11DeviceContext *pd3dImmediateContext );
+	void setHS(HS::ID id, ID3D11DeviceContext *pd3dImmediateContext );
+	void setDS(DS::ID id, ID3D11DeviceContext *pd3dImmediateContext);
+	void setGS(GS::ID id, ID3D11DeviceContext *pd3dImmediateContext);
+	void setPS(PS::ID id, ID3D11DeviceContext *pd3dImmediateContext);
+	void setCS(CS::ID id, ID3D11DeviceContext *pd3dImmediateContext );
+
+	void setCB_VS( ID3D11DeviceContext *pd3dImmediateContext );
+	void setCB_HS( ID3D11DeviceContext *pd3dImmediateContext );
+	void setCB_DS( ID3D11DeviceContext *pd3dImmediateContext );
+	void setCB_GS( ID3D11DeviceContext *pd3dImmediateContext );
+	void setCB_PS( ID3D11DeviceContext *pd3dImmediateContext );
+	void setCB_CS( ID3D11DeviceContext *pd3dImmediateContext );
+
+	void *Map(ID3D11DeviceContext *pd3dImmediateContext);
+	void UmMap(ID3D11DeviceContext *pd3dImmediateContext);
+
+	ID3D11InputLayout *InputLayout(VS::ID id);
+};
+
+
+//--------------------------------------------------------------------------------------
+// Compile the shader at str, or load it from pCache. Thread safe.
+//--------------------------------------------------------------------------------------
+HRESULT CompileShader( ShaderCache *pCache, const WCHAR* str, D3D_SHADER_MACRO* pDefines, LPCSTR szEntryPoint,
+                       LPCSTR szShaderModel, ID3DBlob** ppBlobOut )
+{
+	HRESULT hr = S_OK;
+
+	DWORD dwShaderFlags = D3DCOMPILE_ENABLE_STRICTNESS;
+#if defined( DEBUG ) || defined( _DEBUG )
+	// Set the D3DCOMPILE_DEBUG flag to embed debug information in the shaders.
+	// Setting this flag improves the shader debugging experience, but still allows
+	// the shaders to be optimized and to run exactly the way they will run in
+	// the release configuration of this program.
+	dwShaderFlags |= D3DCOMPILE_DEBUG;
+#endif
+
+	// D3D_SHADER_MACRO and SHADER_MACRO share the layout; the compiler
+	// version goes into the flags so a new d3dcompiler misses
+	ShaderCache::KEY key = 0;
+	char path[MAX_PATH];
+	if (pCache && WideCharToMultiByte(CP_ACP, 0, str, -1, path, MAX_PATH, NULL, NULL)){
+		key = ShaderCache::key(path, szEntryPoint, szShaderModel, (const SHADER_MACRO*)pDefines,
+			dwShaderFlags ^ (D3D_COMPILER_VERSION << 24));
+		std::vector<char> blob;
+		if (key && pCache->load(key, &blob) && SUCCEEDED(D3DCreateBlob(blob.size(), ppBlobOut))){
+			memcpy((*ppBlobOut)->GetBufferPointer(), blob.data(), blob.size());
+			return S_OK;
+		}
+	}
+
+	ID3DBlob* pErrorBlob;
+	hr = D3DX11CompileFromFile( str, pDefines, NULL, szEntryPoint, szShaderModel,
+	                            dwShaderFlags, 0, NULL, ppBlobOut, &pErrorBlob, NULL );
+	if( FAILED( hr ) )
+	{
+		if( pErrorBlob != NULL )
+		{
+			OutputDebugStringA( ( char* )pErrorBlob->GetBufferPointer() );
+		}
+		SAFE_RELEASE( pErrorBlob );
+		return hr;
+	}
+	SAFE_RELEASE( pErrorBlob );
+
+	if (key) pCache->store(key, (*ppBlobOut)->GetBufferPointer(), (*ppBlobOut)->GetBufferSize());
+
+	return S_OK;
+}
+
+//--------------------------------------------------------------------------------------
+// Vertex input of each VS, matching the VTX_* structures
+//--------------------------------------------------------------------------------------
+const D3D11_INPUT_ELEMENT_DESC *InputLayoutDesc( VS::ID id, UINT *count )
+{
+	static const D3D11_INPUT_ELEMENT_DESC SceneLayout[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXTURE", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	};
+	static const D3D11_INPUT_ELEMENT_DESC DecalLayout[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXTURE", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	};
+	// BEZIER_CONTROL_POINT and the shadow pass: position only
+	static const D3D11_INPUT_ELEMENT_DESC PositionLayout[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	};
+
+	switch (id){
+	case VS::SCENE: *count = ARRAYSIZE(SceneLayout); return SceneLayout;
+	case VS::DECAL:
+	case VS::TAA: *count = ARRAYSIZE(DecalLayout); return DecalLayout;
+	default: *count = ARRAYSIZE(PositionLayout); return PositionLayout;
+	}
+}
+
+Shader::Shader( ID3D11Device *pd3dDevice, ID3D11DeviceContext *pd3dImmediateContext )
+{
+	vs_current_ = VS::MAX;
+
+	pVertexShader_.fill(nullptr);
+	pHullShader_.fill(nullptr);
+	pDomainShader_.fill(nullptr);
+	pGeometryShader_.fill(nullptr);
+	pPixelShader_.fill(nullptr);
+	pComputeShader_.fill(nullptr);
+	pLayout_.fill(nullptr);
+	pCB_.fill(nullptr);
+
+	// Compiled blobs persist between runs; the index is written when cache goes out of scope
+	ShaderCache cache("ShaderCache");
+
+	// Media search is not thread safe, every path is resolved up front
+	UINT count;
+	const SHADER_PERMUTATION *perm = ShaderPermutations(&count);
+	std::vector<std::wstring> path(count);
+	for (UINT i = 0; i < count; i++){
+		WCHAR name[MAX_PATH], str[MAX_PATH];
+		MultiByteToWideChar(CP_ACP, 0, perm[i].file, -1, name, MAX_PATH);
+		if (SUCCEEDED(DXUTFindDXSDKMediaFileCch(str, MAX_PATH, name))) path[i] = str;
+	}
+
+	// Compile on the pool
+	auto compile = [&](UINT i, std::vector<char> *blob){
+		ID3DBlob *pBlob = NULL;
+		if (path[i].empty()) return false;
+		if (FAILED(CompileShader(&cache, path[i].c_str(), (D3D_SHADER_MACRO*)perm[i].macros,
+			perm[i].entry, perm[i].profile, &pBlob))) return false;
+
+		const char *p = (const char*)pBlob->GetBufferPointer();
+		blob->assign(p, p + pBlob->GetBufferSize());
+		SAFE_RELEASE(pBlob);
+		return true;
+	};
+
+	// Create on this thread as each blob arrives
+	auto create = [&](UINT i, const std::vector<char> &blob){
+		const SHADER_PERMUTATION &sp = perm[i];
+		HRESULT hr = E_FAIL;
+		switch (sp.stage){
+		case STAGE::VS:
+		{
+			hr = pd3dDevice->CreateVertexShader(blob.data(), blob.size(), NULL, &pVertexShader_[sp.id]);
+			if (FAILED(hr)) break;
+			DXUT_SetDebugName(pVertexShader_[sp.id], sp.name);
+
+			UINT n;
+			const D3D11_INPUT_ELEMENT_DESC *layout = InputLayoutDesc((VS::ID)sp.id, &n);
+			hr = pd3dDevice->CreateInputLayout(layout, n, blob.data(), blob.size(), &pLayout_[sp.id]);
+			if (FAILED(hr)) break;
+			DXUT_SetDebugName(pLayout_[sp.id], sp.name);
+
+			pCB_[sp.id] = new ConstantBuffer(VS::getCBSize((VS::ID)sp.id), pd3dDevice);
+			break;
+		}
+		case STAGE::HS:
+			hr = pd3dDevice->CreateHullShader(blob.data(), blob.size(), NULL, &pHullShader_[sp.id]);
+			if (SUCCEEDED(hr)) DXUT_SetDebugName(pHullShader_[sp.id], sp.name);
+			break;
+		case STAGE::DS:
+			hr = pd3dDevice->CreateDomainShader(blob.data(), blob.size(), NULL, &pDomainShader_[sp.id]);
+			if (SUCCEEDED(hr)) DXUT_SetDebugName(pDomainShader_[sp.id], sp.name);
+			break;
+		case STAGE::PS:
+			hr = pd3dDevice->CreatePixelShader(blob.data(), blob.size(), NULL, &pPixelShader_[sp.id]);
+			if (SUCCEEDED(hr)) DXUT_SetDebugName(pPixelShader_[sp.id], sp.name);
+			break;
+		case STAGE::CS:
+			hr = pd3dDevice->CreateComputeShader(blob.data(), blob.size(), NULL, &pComputeShader_[sp.id]);
+			if (SUCCEEDED(hr)) DXUT_SetDebugName(pComputeShader_[sp.id], sp.name);
+			break;
+		default:
+			break;
+		}
+		return SUCCEEDED(hr);
+	};
+
+	ThreadPool pool;
+	SHADER_BUILD_STATS stats;
+	BuildShaders(&pool, count, compile, create, &stats);
+
+#if defined( DEBUG ) || defined( _DEBUG )
+	char sz[256];
+	sprintf_s(sz, "Shaders: %u of %u built, %.0f ms (%.0f ms compiling on %u threads)\n",
+		count - stats.failed, count, stats.wall_ms, stats.compile_ms, pool.size());
+	OutputDebugStringA(sz);
+#endif
+}
+
+
+Shader::~Shader()
+{
+	std::for_each(pCB_.begin(), pCB_.end(), [](ConstantBuffer* it) {
+		SAFE_DELETE(it);
+	});
+
+	std::for_each(pLayout_.begin(), pLayout_.end(), [](ID3D11InputLayout* it) {
+		SAFE_RELEASE(it);
+	});
+
+	std::for_each( pVertexShader_.begin(), pVertexShader_.end(), [](ID3D11VertexShader* it) {
+		SAFE_RELEASE( it );
+	});
+	std::for_each( pHullShader_.begin(),pHullShader_.end(), [](ID3D11HullShader* it) {
+		SAFE_RELEASE( it );
+	});
+	std::for_each( pDomainShader_.begin(),pDomainShader_.end(), [](ID3D11DomainShader* it) {
+		SAFE_RELEASE( it );
+	});
+	std::for_each( pGeometryShader_.begin(),pGeometryShader_.end(), [](ID3D11GeometryShader* it) {
+		SAFE_RELEASE( it );
+	});
+	std::for_each( pPixelShader_.begin(),pPixelShader_.end(), [](ID3D11PixelShader* it) {
+		SAFE_RELEASE( it );
+	});
+	std::for_each( pComputeShader_.begin(),pComputeShader_.end(), [](ID3D11ComputeShader* it) {
+		SAFE_RELEASE( it );
+	});
+}
+
+void Shader::setVS( VS::ID id, ID3D11DeviceContext *pd3dImmediateContext )
+{
+	vs_current_ = id;
+	pd3dImmediateContext->VSSetShader( pVertexShader_[id], NULL, 0 );
+}
+void Shader::setHS(HS::ID id, ID3D11DeviceContext *pd3dImmediateContext)
+{
+	pd3dImmediateContext->HSSetShader( pHullShader_[id], NULL, 0 );
+}
+void Shader::setDS(DS::ID id, ID3D11DeviceContext *pd3dImmediateContext)
+{
+	pd3dImmediateContext->DSSetShader( pDomainShader_[id], NULL, 0 );
+}
+void Shader::setGS(GS::ID id, ID3D11DeviceContext *pd3dImmediateContext)
+{
+	pd3dImmediateContext->GSSetShader( pGeometryShader_[id], NULL, 0 );
+}
+void Shader::setPS(PS::ID id, ID3D11DeviceContext *pd3dImmediateContext)
+{
+	pd3dImmediateContext->PSSetShader( pPixelShader_[id], NULL, 0 );
+}
+void Shader::setCS(CS::ID id, ID3D11DeviceContext *pd3dImmediateContext)
+{
+	pd3dImmediateContext->CSSetShader( pComputeShader_[id], NULL, 0 );
+}
+
+void Shader::setCB_VS( ID3D11DeviceContext *pd3dImmediateContext )
+{
+	pd3dImmediateContext->VSSetConstantBuffers(0, 1, pCB_[vs_current_]->get());
+}
+void Shader::setCB_HS( ID3D11DeviceContext *pd3dImmediateContext )
+{
+	pd3dImmediateContext->HSSetConstantBuffers(0, 1, pCB_[vs_current_]->get());
+}
+void Shader::setCB_DS( ID3D11DeviceContext *pd3dImmediateContext )
+{
+	pd3dImmediateContext->DSSetConstantBuffers(0, 1, pCB_[vs_current_]->get());
+}
+void Shader::setCB_GS( ID3D11DeviceContext *pd3dImmediateContext )
+{
+	pd3dImmediateContext->GSSetConstantBuffers(0, 1, pCB_[vs_current_]->get());
+}
+void Shader::setCB_PS( ID3D11DeviceContext *pd3dImmediateContext )
+{
+	pd3dImmediateContext->PSSetConstantBuffers(0, 1, pCB_[vs_current_]->get());
+}
+void Shader::setCB_CS( ID3D11DeviceContext *pd3dImmediateContext )
+{
+	pd3dImmediateContext->CSSetConstantBuffers(0, 1, pCB_[vs_current_]->get());
+}
+
+void *Shader::Map(ID3D11DeviceContext *pd3dImmediateContext)
+{
+	return pCB_[vs_current_]->Map(pd3dImmediateContext);
+}
+void Shader::UmMap(ID3D11DeviceContext *pd3dImmediateContext)
+{
+	pCB_[vs_current_]->UmMap(pd3dImmediateContext);
+}
+
+ID3D11InputLayout *Shader::InputLayout(VS::ID id)
+{
+	return pLayout_[id];
+}
+
+D3D11Device::D3D11Device( ID3D11Device *pd3dDevice )
+{
+	pd3dDevice_ = pd3dDevice;
+	pd3dImmediateContext_ = DXUTGetD3D11DeviceContext();
+
+	TR_ = new RenderTargets(pd3dDevice);
+	RS_ = new RasterStates(pd3dDevice);
+	SAMP_ = new SamplerStates(pd3dDevice);
+	DSS_ = new DepthStencilStates(pd3dDevice);
+	Shader_ = new Shader(pd3dDevice, pd3dImmediateContext_);
+	CR_ = new ConstantRing(pd3dDevice, pd3dImmediateContext_);
+	GT_ = new GpuTimer(pd3dDevice, pd3dImmediateContext_);
+	loader_ = new AsyncLoader(2);	// file I/O bound, decoding is short
+
+	vs_current_ = VS::MAX;
+	for (auto &x : cb_offset_) x = ~0u;
+	cb_ring_mapped_ = false;
+	for (auto &x : srv_) x = nullptr;
+}
+
+D3D11Device::~D3D11Device()
+{
+	for (auto &x : aMesh_){
+		SAFE_DELETE(x);
+	}
+	SAFE_DELETE(loader_);	// after the meshes cancelled their creates
+
+	SAFE_DELETE(GT_);
+	SAFE_DELETE(CR_);
+	SAFE_DELETE(Shader_);
+	SAFE_DELETE(DSS_);
+	SAFE_DELETE(SAMP_);
+	SAFE_DELETE(RS_);
+	SAFE_DELETE(TR_);
+
+	pd3dDevice_ = nullptr;
+	pd3dImmediateContext_ = nullptr;
+}
+
+ID3D11DeviceContext *D3D11Device::pd3dImmediateContext()
+{
+	return pd3dImmediateContext_;
+}
+
+void D3D11Device::beginFrame()
+{
+	loader_->pump(LOAD_BUDGET);
+	CR_->beginFrame();
+	TR_->beginFrame();
+	GT_->begin();
+}
+
+void D3D11Device::endFrame()
+{
+	GT_->end();
+}
+
+bool D3D11Device::getGpuTime(float *ms)
+{
+	return GT_->get(ms);
+}
+
+void D3D11Device::ResizedSwapChain(UINT width, UINT height)
+{
+	DXGI_SURFACE_DESC desc = *DXUTGetDXGIBackBufferSurfaceDesc();
+	desc.Width = width;
+	desc.Height = height;
+
+	TR_->ResizedSwapChain(pd3dDevice_, &desc);
+}
+void D3D11Device::ReleasingSwapChain()
+{
+	TR_->ReleasingSwapChain();
+}
+
+UINT D3D11Device::createRenderTarget(RENDER_TARGET::TYPE type, UINT width, UINT height, float scale, RENDER_TARGET::FORMAT format)
+{
+	return TR_->create(pd3dDevice_, type, width, height, scale, format);
+}
+
+void D3D11Device::setScale(UINT id, float scale)
+{
+	TR_->setScale(id, scale, pd3dDevice_);
+}
+
+void D3D11Device::setFormat(UINT id, RENDER_TARGET::FORMAT format)
+{
+	TR_->setFormat(id, format);
+}
+
+void D3D11Device::getSize(UINT id, UINT *width, UINT *height)
+{
+	TR_->getSize(id, width, height);
+}
+
+void D3D11Device::getTextureSize(UINT id, UINT *width, UINT *height)
+{
+	TR_->getTextureSize(id, width, height);
+}
+
+unsigned long long D3D11Device::getBytes(UINT id)
+{
+	return TR_->getBytes(id);
+}
+
+UINT D3D11Device::getGeneration(UINT id)
+{
+	return TR_->getGeneration(id);
+}
+
+unsigned long long D3D11Device::getTotalBytes()
+{
+	return TR_->getTotalBytes();
+}
+
+void D3D11Device::setRenderTarget(UINT id)
+{
+	TR_->set(id, pd3dImmediateContext_);
+}
+void D3D11Device::pushRenderTarget()
+{
+	TR_->pushDefault(pd3dImmediateContext_);
+}
+void D3D11Device::popRenderTarget()
+{
+	TR_->popDefault(pd3dImmediateContext_);
+}
+void D3D11Device::setPresentTarget(UINT id)
+{
+	TR_->setPresent(id, pd3dImmediateContext_);
+}
+
+void D3D11Device::Clear( UINT color )
+{
+	TR_->Clear(color, pd3dImmediateContext_);
+}
+
+void D3D11Device::ClearDepth( float depth )
+{
+	TR_->ClearDepth(depth, pd3dImmediateContext_);
+}
+
+UINT D3D11Device::createMesh(MESH_TYPE type, void *param)
+{
+	aMesh_.push_back(Mesh::create(type, pd3dDevice_, param, loader_));
+
+	return aMesh_.size() - 1;
+}
+
+bool D3D11Device::isMeshReady(UINT mesh)
+{
+	return mesh < aMesh_.size() && aMesh_[mesh]->ready();
+}
+
+void D3D11Device::setTexture(UINT slot, UINT id)
+{
+	ID3D11ShaderResourceView *pSRV = (~0 == id) ? nullptr : TR_->get(id);
+	pd3dImmediateContext_->PSSetShaderResources(slot, 1, &pSRV);
+	if (slot < CS_TEXTURE_MAX) srv_[slot] = pSRV;
+}
+
+void D3D11Device::setInputLayout(VS::ID id)
+{
+	// Set the input assembler
+	// This sample uses patches with 16 control points each
+	// Although the Mobius strip only needs to use a vertex buffer,
+	// you can use an index buffer as well by calling IASetIndexBuffer().
+	pd3dImmediateContext_->IASetInputLayout(Shader_->InputLayout(id));
+}
+
+void D3D11Device::Draw( UINT mesh )
+{
+	aMesh_[mesh]->Draw(pd3dImmediateContext_);
+}
+
+void D3D11Device::set(RASTERIZER_STATE::ID id)
+{
+	RS_->set(id, pd3dImmediateContext_);
+}
+void D3D11Device::set(UINT slot, SAMPLER_STATE::ID id)
+{
+	SAMP_->set(slot, id, pd3dImmediateContext_);
+}
+void D3D11Device::set(VS::ID id)
+{
+	vs_current_ = id;
+	Shader_->setVS( id , pd3dImmediateContext_ );
+}
+void D3D11Device::set(HS::ID id)
+{
+	Shader_->setHS( id , pd3dImmediateContext_ );
+}
+void D3D11Device::set(DS::ID id)
+{
+	Shader_->setDS( id , pd3dImmediateContext_ );
+}
+void D3D11Device::set(GS::ID id)
+{
+	Shader_->setGS( id , pd3dImmediateContext_ );
+}
+void D3D11Device::set(PS::ID id)
+{
+	Shader_->setPS( id , pd3dImmediateContext_ );
+}
+void D3D11Device::set(CS::ID id)
+{
+	Shader_->setCS( id, pd3dImmediateContext_ );
+}
+void D3D11Device::set(DEPTH_STATE::ID id)
+{
+	DSS_->set(id, pd3dImmediateContext_);
+}
+
+void D3D11Device::disable(STAGE::ID stage)
+{
+	switch (stage){
+	case STAGE::VS: pd3dImmediateContext_->VSSetShader( NULL, NULL, 0 ); break;
+	case STAGE::HS: pd3dImmediateContext_->HSSetShader( NULL, NULL, 0 ); break;
+	case STAGE::DS: pd3dImmediateContext_->DSSetShader( NULL, NULL, 0 ); break;
+	case STAGE::GS: pd3dImmediateContext_->GSSetShader( NULL, NULL, 0 ); break;
+	case STAGE::PS: pd3dImmediateContext_->PSSetShader( NULL, NULL, 0 ); break;
+	case STAGE::CS: pd3dImmediateContext_->CSSetShader( NULL, NULL, 0 ); break;
+	}
+}
+
+void D3D11Device::Dispatch(UINT id, UINT groups_x, UINT groups_y)
+{
+	// The PS textures are mirrored to the CS for the dispatch only, so no
+	// render target stays bound to it
+	ID3D11UnorderedAccessView *pUAV = TR_->getUnorderedAccessView(id);
+	pd3dImmediateContext_->CSSetShaderResources(0, CS_TEXTURE_MAX, srv_);
+	pd3dImmediateContext_->CSSetUnorderedAccessViews(0, 1, &pUAV, nullptr);
+
+	pd3dImmediateContext_->Dispatch(groups_x, groups_y, 1);
+
+	ID3D11ShaderResourceView *pNullSRV[CS_TEXTURE_MAX] = {};
+	ID3D11UnorderedAccessView *pNullUAV = nullptr;
+	pd3dImmediateContext_->CSSetShaderResources(0, CS_TEXTURE_MAX, pNullSRV);
+	pd3dImmediateContext_->CSSetUnorderedAccessViews(0, 1, &pNullUAV, nullptr);
+}
+
+void D3D11Device::setCB(STAGE::ID stage)
+{
+	if (vs_current_ < VS::MAX && cb_offset_[vs_current_] != ~0u){
+		CR_->set(stage, cb_offset_[vs_current_], VS::getCBSize(vs_current_));
+		return;
+	}
+
+	switch (stage){
+	case STAGE::VS: Shader_->setCB_VS( pd3dImmediateContext_ ); break;
+	case STAGE::HS: Shader_->setCB_HS( pd3dImmediateContext_ ); break;
+	case STAGE::DS: Shader_->setCB_DS( pd3dImmediateContext_ ); break;
+	case STAGE::GS: Shader_->setCB_GS( pd3dImmediateContext_ ); break;
+	case STAGE::PS: Shader_->setCB_PS( pd3dImmediateContext_ ); break;
+	case STAGE::CS: Shader_->setCB_CS( pd3dImmediateContext_ ); break;
+	}
+}
+
+void *D3D11Device::Map()
+{
+	cb_ring_mapped_ = false;
+	if (VS::MAX <= vs_current_) return nullptr;
+
+	UINT offset = CR_->enabled() ? CR_->allocate(VS::getCBSize(vs_current_)) : ~0u;
+	cb_offset_[vs_current_] = offset;
+	if (offset == ~0u){
+		return Shader_->Map(pd3dImmediateContext_);
+	}
+	cb_ring_mapped_ = true;
+	return CR_->Map(offset);
+}
+void D3D11Device::UmMap()
+{
+	if (cb_ring_mapped_){
+		CR_->UmMap();
+	}else{
+		Shader_->UmMap(pd3dImmediateContext_);
+	}
+	cb_ring_mapped_ = false;
+}
+
+}// namespace tpot
\ No newline at end of file
@@ -0,0 +1,98 @@
+#ifndef TPOT_D3D11_DEVICE_H__
+#define TPOT_D3D11_DEVICE_H__
+
+#include <vector>
+#include "device.h"
+
+namespace tpot
+{
+
+	class RenderTargets;
+	class RasterStates;
+	class DepthStencilStates;
+	class SamplerStates;
+	class Shader;
+	class ConstantRing;
+	class GpuTimer;
+	class Mesh;
+	class AsyncLoader;
+
+	// Device on the DXUT immediate context
+	class D3D11Device : public Device
+	{
+		enum{
+			CS_TEXTURE_MAX = 8,	// setTexture() slots Dispatch() binds
+			LOAD_BUDGET = 4 * 1024 * 1024,	// bytes of mesh data made into buffers per frame
+		};
+
+		ID3D11Device *pd3dDevice_;
+		ID3D11DeviceContext *pd3dImmediateContext_;
+
+		RenderTargets *TR_;
+		RasterStates *RS_;
+		DepthStencilStates *DSS_;
+		SamplerStates *SAMP_;
+		Shader       *Shader_;
+		ConstantRing *CR_;
+		GpuTimer     *GT_;
+
+		std::vector<Mesh*> aMesh_;
+		AsyncLoader  *loader_;	// background mesh and texture loads
+		VS::ID       vs_current_;
+		UINT         cb_offset_[VS::MAX];	// latest constant data per VS in CR_, ~0: in Shader's buffer
+		bool         cb_ring_mapped_;
+		ID3D11ShaderResourceView *srv_[CS_TEXTURE_MAX];	// bound by setTexture()
+
+	public:
+		D3D11Device( ID3D11Device *pd3dDevice );
+		~D3D11Device();
+
+		ID3D11DeviceContext *pd3dImmediateContext();
+
+		void beginFrame();
+		void endFrame();
+		bool getGpuTime(float *ms);
+		void ResizedSwapChain(UINT width, UINT height);
+		void ReleasingSwapChain();
+
+		UINT createRenderTarget(RENDER_TARGET::TYPE type, UINT width, UINT height, float scale, RENDER_TARGET::FORMAT format);
+		void setScale(UINT id, float scale);
+		void setFormat(UINT id, RENDER_TARGET::FORMAT format);
+		void getSize(UINT id, UINT *width, UINT *height);
+		void getTextureSize(UINT id, UINT *width, UINT *height);
+		unsigned long long getBytes(UINT id);
+		UINT getGeneration(UINT id);
+		unsigned long long getTotalBytes();
+		void setRenderTarget(UINT id);
+		void pushRenderTarget();
+		void popRenderTarget();
+		void setPresentTarget(UINT id);
+
+		void Clear(UINT color);
+		void ClearDepth(float depth);
+
+		UINT createMesh(MESH_TYPE type, void *param);
+		bool isMeshReady(UINT mesh);
+		void setTexture(UINT slot, UINT id);
+		void setInputLayout(VS::ID id);
+		void Draw(UINT mesh);
+
+		void set(RASTERIZER_STATE::ID id);
+		void set(UINT slot, SAMPLER_STATE::ID id);
+		void set(DEPTH_STATE::ID id);
+		void set(VS::ID id);
+		void set(HS::ID id);
+		void set(DS::ID id);
+		void set(GS::ID id);
+		void set(PS::ID id);
+		void set(CS::ID id);
+		void disable(STAGE::ID stage);
+		void Dispatch(UINT id, UINT groups_x, UINT groups_y);
+
+		void setCB(STAGE::ID stage);
+		void *Map();
+		void UmMap();
+	};
+
+}// namespace tpot
+#endif // TPOT_D3D11_DEVICE_H__
@@ -0,0 +1,91 @@
+#include <math.h>
+#include "DynamicResolution.h"
+
+namespace tpot
+{
+
+DYNAMIC_RESOLUTION_PARAM MakeDynamicResolutionParam(float target_ms)
+{
+	DYNAMIC_RESOLUTION_PARAM param;
+	param.target_ms = target_ms;
+	param.min_scale = 50;	// the Render Scale slider
+	param.max_scale = 100;
+	param.step = 5;
+	param.smoothing = 0.1f;
+	param.shrink_above = 1.0f;
+	param.grow_below = 0.8f;
+	param.aim = 0.9f;
+	param.cooldown = 8;		// GPU timings come back a few frames late
+	return param;
+}
+
+DynamicResolution::DynamicResolution(const DYNAMIC_RESOLUTION_PARAM &param)
+	: param_(param)
+{
+	reset(param.max_scale);
+}
+
+void DynamicResolution::setParam(const DYNAMIC_RESOLUTION_PARAM &param)
+{
+	param_ = param;
+	scale_ = quantize((float)scale_);
+}
+
+void DynamicResolution::reset(unsigned scale)
+{
+	scale_ = quantize((float)scale);
+	cpu_ms_ = -1.0f;
+	gpu_ms_ = -1.0f;
+	hold_ = 0;
+	changes_ = 0;
+}
+
+// Down to a multiple of step, within the bounds
+unsigned DynamicResolution::quantize(float scale) const
+{
+	unsigned step = param_.step ? param_.step : 1;
+	unsigned s = (0.0f < scale) ? (unsigned)scale : 0;// NaN goes to 0
+	s = (s / step) * step;
+	if (s < param_.min_scale) s = param_.min_scale;
+	if (param_.max_scale < s) s = param_.max_scale;
+	return s;
+}
+
+bool DynamicResolution::cpuBound() const
+{
+	float limit = param_.shrink_above * param_.target_ms;
+	return limit < cpu_ms_ && gpu_ms_ <= limit;
+}
+
+unsigned DynamicResolution::update(float cpu_ms, float gpu_ms)
+{
+	if (!(0.0f <= cpu_ms)) return scale_;	// nothing measured
+	if (!(0.0f <= gpu_ms)) gpu_ms = cpu_ms;
+
+	if (hold_){
+		hold_--;
+		return scale_;
+	}
+
+	float a = param_.smoothing;
+	cpu_ms_ = (cpu_ms_ < 0.0f) ? cpu_ms : cpu_ms_ + a * (cpu_ms - cpu_ms_);
+	gpu_ms_ = (gpu_ms_ < 0.0f) ? gpu_ms : gpu_ms_ + a * (gpu_ms - gpu_ms_);
+
+	float target = param_.target_ms;
+	bool shrink = param_.shrink_above * target < gpu_ms_;
+	bool grow = gpu_ms_ < param_.grow_below * target;
+	if (!shrink && !grow) return scale_;
+
+	float wanted = (float)scale_ * sqrtf(param_.aim * target / (0.001f < gpu_ms_ ? gpu_ms_ : 0.001f));
+	unsigned scale = quantize(wanted);
+	if (shrink ? scale_ <= scale : scale <= scale_) return scale_;
+
+	float ratio = (float)scale / (float)scale_;
+	gpu_ms_ *= ratio * ratio;
+	scale_ = scale;
+	hold_ = param_.cooldown;
+	changes_++;
+	return scale_;
+}
+
+}// namespace tpot
@@ -0,0 +1,66 @@
+#ifndef TPOT_DYNAMIC_RESOLUTION_H__
+#define TPOT_DYNAMIC_RESOLUTION_H__
+
+namespace tpot
+{
+
+	struct DYNAMIC_RESOLUTION_PARAM
+	{
+		float    target_ms;		// frame time to hold
+		unsigned min_scale;		// TAA_FRAME_PARAM::render_scale bounds, percent per axis
+		unsigned max_scale;
+		unsigned step;			// the scale is a multiple of step percent
+		float    smoothing;		// weight of a new timing in the running averages, (0, 1]
+		float    shrink_above;	// shrinks once the frame takes more than this part of target_ms,
+		float    grow_below;	// grows once less than this part: the band in between holds the scale
+		float    aim;			// a change aims at this part of target_ms, within the band
+		unsigned cooldown;		// frames a change holds, timings of them are not averaged
+	};
+
+	// The defaults for a target, 1000 / 60 at 60 Hz
+	DYNAMIC_RESOLUTION_PARAM MakeDynamicResolutionParam(float target_ms);
+
+	// Picks the scene resolution of the next frame from the timings of the
+	// finished ones. The GPU time is taken to go with the pixel count, so a
+	// change is the square root of the time ratio; the averages are moved
+	// along with it and the timings of the next cooldown frames, still in
+	// flight at the old scale, are dropped.
+	//
+	// Only the GPU time decides: a CPU bound frame does not get faster with
+	// fewer pixels. Without a GPU time the CPU one stands for both.
+	//
+	// Pure arithmetic on the timings handed in, so a recorded trace gives
+	// the same scales on every run and machine.
+	class DynamicResolution
+	{
+		DYNAMIC_RESOLUTION_PARAM param_;
+		unsigned scale_;
+		float    cpu_ms_;	// running averages, < 0: no timing yet
+		float    gpu_ms_;
+		unsigned hold_;		// frames left of the cooldown
+		unsigned changes_;
+
+		unsigned quantize(float scale) const;
+
+	public:
+		explicit DynamicResolution(const DYNAMIC_RESOLUTION_PARAM &param);
+
+		const DYNAMIC_RESOLUTION_PARAM &param() const { return param_; }
+		void setParam(const DYNAMIC_RESOLUTION_PARAM &param); // the scale is kept within the new bounds
+
+		// Starts over at scale, e.g. when the controller is switched on
+		void reset(unsigned scale);
+
+		// Timings of a finished frame in ms, gpu_ms < 0 when there is none.
+		// Returns the scale of the next frame.
+		unsigned update(float cpu_ms, float gpu_ms);
+
+		unsigned scale() const { return scale_; }
+		float cpuTime() const { return cpu_ms_; }	// averages, < 0: none yet
+		float gpuTime() const { return gpu_ms_; }
+		bool cpuBound() const;	// the CPU alone misses the target
+		unsigned changes() const { return changes_; }	// since reset()
+	};
+
+}// namespace tpot
+#endif // TPOT_DYNAMIC_RESOLUTION_H__
@@ -0,0 +1,101 @@
+#include <math.h>
+#include <vector>
+#include "ImageMetrics.h"
+
+namespace tpot
+{
+
+double ImageMSE(const Image &a, const Image &b)
+{
+	if (a.width != b.width || a.height != b.height || a.empty()) return 0.0;
+
+	double sum = 0.0;
+	size_t n = (size_t)a.width * a.height;
+	for (size_t i = 0; i < n; i++){
+		for (int c = 0; c < 3; c++){
+			double d = (double)a.pixels[i * 4 + c] - (double)b.pixels[i * 4 + c];
+			sum += d * d;
+		}
+	}
+	return sum / (double)(n * 3);
+}
+
+double ImagePSNR(const Image &a, const Image &b)
+{
+	double mse = ImageMSE(a, b);
+	if (mse <= 0.0) return 99.0;
+	return 10.0 * log10(1.0 / mse);
+}
+
+namespace
+{
+	const int SSIM_RADIUS = 5;
+
+	// Separable Gaussian of src into dst, both width x height
+	void blurSSIM(std::vector<float> &dst, const std::vector<float> &src, int width, int height, const float *w)
+	{
+		std::vector<float> tmp(src.size());
+		for (int y = 0; y < height; y++){
+			for (int x = 0; x < width; x++){
+				float sum = 0.0f;
+				for (int k = -SSIM_RADIUS; k <= SSIM_RADIUS; k++){
+					int xx = x + k;
+					xx = (xx < 0) ? 0 : (width <= xx) ? width - 1 : xx;
+					sum += w[k + SSIM_RADIUS] * src[(size_t)y * width + xx];
+				}
+				tmp[(size_t)y * width + x] = sum;
+			}
+		}
+		dst.resize(src.size());
+		for (int y = 0; y < height; y++){
+			for (int x = 0; x < width; x++){
+				float sum = 0.0f;
+				for (int k = -SSIM_RADIUS; k <= SSIM_RADIUS; k++){
+					int yy = y + k;
+					yy = (yy < 0) ? 0 : (height <= yy) ? height - 1 : yy;
+					sum += w[k + SSIM_RADIUS] * tmp[(size_t)yy * width + x];
+				}
+				dst[(size_t)y * width + x] = sum;
+			}
+		}
+	}
+}// namespace
+
+double ImageSSIM(const Image &a, const Image &b)
+{
+	if (a.width != b.width || a.height != b.height || a.empty()) return 0.0;
+
+	float w[2 * SSIM_RADIUS + 1], norm = 0.0f;
+	for (int k = -SSIM_RADIUS; k <= SSIM_RADIUS; k++){
+		w[k + SSIM_RADIUS] = expf(-(float)(k * k) / (2.0f * 1.5f * 1.5f));
+		norm += w[k + SSIM_RADIUS];
+	}
+	for (auto &x : w) x /= norm;
+
+	size_t n = (size_t)a.width * a.height;
+	std::vector<float> la(n), lb(n), aa(n), bb(n), ab(n);
+	for (size_t i = 0; i < n; i++){
+		const float *pa = &a.pixels[i * 4], *pb = &b.pixels[i * 4];
+		la[i] = 0.2126f * pa[0] + 0.7152f * pa[1] + 0.0722f * pa[2];
+		lb[i] = 0.2126f * pb[0] + 0.7152f * pb[1] + 0.0722f * pb[2];
+		aa[i] = la[i] * la[i];
+		bb[i] = lb[i] * lb[i];
+		ab[i] = la[i] * lb[i];
+	}
+	blurSSIM(la, la, a.width, a.height, w);
+	blurSSIM(lb, lb, a.width, a.height, w);
+	blurSSIM(aa, aa, a.width, a.height, w);
+	blurSSIM(bb, bb, a.width, a.height, w);
+	blurSSIM(ab, ab, a.width, a.height, w);
+
+	const double C1 = 0.01 * 0.01, C2 = 0.03 * 0.03;
+	double sum = 0.0;
+	for (size_t i = 0; i < n; i++){
+		double ma = la[i], mb = lb[i];
+		double va = aa[i] - ma * ma, vb = bb[i] - mb * mb, cov = ab[i] - ma * mb;
+		sum += ((2.0 * ma * mb + C1) * (2.0 * cov + C2)) / ((ma * ma + mb * mb + C1) * (va + vb + C2));
+	}
+	return sum / (double)n;
+}
+
+}// namespace tpot
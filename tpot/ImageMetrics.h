@@ -0,0 +1,20 @@
+#ifndef TPOT_IMAGE_METRICS_H__
+#define TPOT_IMAGE_METRICS_H__
+
+#include "image.h"
+
+namespace tpot
+{
+
+	// Mean squared error over RGB, images must have the same size
+	double ImageMSE(const Image &a, const Image &b);
+
+	// Peak signal to noise ratio in dB for a peak of 1.0
+	double ImagePSNR(const Image &a, const Image &b);
+
+	// Mean structural similarity of the Rec.709 luma for a peak of 1.0:
+	// 11x11 Gaussian window of sigma 1.5, clamped at the edges (Wang et al. 2004)
+	double ImageSSIM(const Image &a, const Image &b);
+
+}// namespace tpot
+#endif // TPOT_IMAGE_METRICS_H__
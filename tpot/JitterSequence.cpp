@@ -0,0 +1,223 @@
+#include <math.h>
+#include <string.h>
+#include "JitterSequence.h"
+
+namespace tpot
+{
+
+namespace
+{
+	const unsigned TABLE_LENGTH = 64;
+
+#define TPOT_JITTER_4(P, i)  P(i), P(i + 1), P(i + 2), P(i + 3)
+#define TPOT_JITTER_16(P, i) TPOT_JITTER_4(P, i), TPOT_JITTER_4(P, i + 4), TPOT_JITTER_4(P, i + 8), TPOT_JITTER_4(P, i + 12)
+#define TPOT_JITTER_64(P)    TPOT_JITTER_16(P, 0), TPOT_JITTER_16(P, 16), TPOT_JITTER_16(P, 32), TPOT_JITTER_16(P, 48)
+
+	// Halton starts at index 1 as the original offset_tbl did
+#define TPOT_HALTON_23(i) { Halton((i) + 1, 2), Halton((i) + 1, 3) }
+#define TPOT_R2(i)        { R2(i, 0), R2(i, 1) }
+#define TPOT_SOBOL(i)     { Sobol(i, 0), Sobol(i, 1) }
+
+	const float HALTON_23_TABLE[TABLE_LENGTH][2] = { TPOT_JITTER_64(TPOT_HALTON_23) };
+	const float R2_TABLE[TABLE_LENGTH][2] = { TPOT_JITTER_64(TPOT_R2) };
+	const float SOBOL_TABLE[TABLE_LENGTH][2] = { TPOT_JITTER_64(TPOT_SOBOL) };
+
+#undef TPOT_SOBOL
+#undef TPOT_R2
+#undef TPOT_HALTON_23
+#undef TPOT_JITTER_64
+#undef TPOT_JITTER_16
+#undef TPOT_JITTER_4
+
+	// the #if 0 table of the original OnD3D11FrameRender
+	const float GRID_TABLE[16][2] = {
+		{ 0.0f / 4.0f, 0.0f / 4.0f },
+		{ 0.0f / 4.0f, 2.0f / 4.0f },
+		{ 2.0f / 4.0f, 2.0f / 4.0f },
+		{ 2.0f / 4.0f, 0.0f / 4.0f },
+
+		{ 1.0f / 4.0f, 0.0f / 4.0f },
+		{ 1.0f / 4.0f, 2.0f / 4.0f },
+		{ 3.0f / 4.0f, 2.0f / 4.0f },
+		{ 3.0f / 4.0f, 0.0f / 4.0f },
+
+		{ 0.0f / 4.0f, 1.0f / 4.0f },
+		{ 0.0f / 4.0f, 3.0f / 4.0f },
+		{ 2.0f / 4.0f, 3.0f / 4.0f },
+		{ 2.0f / 4.0f, 1.0f / 4.0f },
+
+		{ 1.0f / 4.0f, 1.0f / 4.0f },
+		{ 1.0f / 4.0f, 3.0f / 4.0f },
+		{ 3.0f / 4.0f, 3.0f / 4.0f },
+		{ 3.0f / 4.0f, 1.0f / 4.0f },
+	};
+
+	// Mitchell's best candidate with toroidal distance; every prefix stays well spread
+	void blueNoise(std::vector<float> &points, unsigned length)
+	{
+		unsigned seed = 0x9e3779b9u;
+		auto rnd = [&seed](){
+			seed = seed * 1664525u + 1013904223u;
+			return (float)(seed >> 8) * (1.0f / 16777216.0f);
+		};
+
+		for (unsigned i = 0; i < length; i++){
+			float best_x = 0.0f, best_y = 0.0f, best_d = -1.0f;
+			unsigned candidates = 8 * i + 1;
+			for (unsigned c = 0; c < candidates; c++){
+				float x = rnd(), y = rnd();
+				float nearest = 2.0f;
+				for (unsigned j = 0; j < i; j++){
+					float dx = x - points[2 * j], dy = y - points[2 * j + 1];
+					dx = (dx < 0.0f) ? -dx : dx;
+					dy = (dy < 0.0f) ? -dy : dy;
+					dx = (0.5f < dx) ? 1.0f - dx : dx;
+					dy = (0.5f < dy) ? 1.0f - dy : dy;
+					float d = dx * dx + dy * dy;
+					nearest = (d < nearest) ? d : nearest;
+				}
+				if (best_d < nearest){
+					best_d = nearest;
+					best_x = x;
+					best_y = y;
+				}
+			}
+			points[2 * i] = best_x;
+			points[2 * i + 1] = best_y;
+		}
+	}
+
+	// Columns are blend weight 1, 2, 4, 8, 16, 32; measured with taa_cpu jitter
+	const unsigned RECOMMENDED_LENGTH[JITTER::MAX][6] = {
+		{ 1, 8, 16, 32, 64, 64 },		// HALTON
+		{ 4, 16, 16, 16, 16, 16 },		// GRID
+		{ 1, 8, 16, 32, 64, 64 },		// R2
+		{ 2, 4, 16, 32, 64, 64 },		// SOBOL
+		{ 1, 4, 8, 8, 16, 64 },			// BLUE_NOISE
+	};
+}// namespace
+
+const char *JITTER::name(JITTER::TYPE type)
+{
+	static const char *names[JITTER::MAX] = {
+		"halton",
+		"grid",
+		"r2",
+		"sobol",
+		"bluenoise",
+	};
+	return (type < JITTER::MAX) ? names[type] : "unknown";
+}
+
+bool JITTER::parse(const char *str, JITTER::TYPE *type)
+{
+	for (int i = 0; i < JITTER::MAX; i++){
+		if (strcmp(str, name((JITTER::TYPE)i)) == 0){
+			*type = (JITTER::TYPE)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+JitterSequence::JitterSequence(JITTER::TYPE type, unsigned length, unsigned base_x, unsigned base_y)
+	: type_(type), frame_(0)
+{
+	base_[0] = (base_x < 2) ? 2 : base_x;
+	base_[1] = (base_y < 2) ? 3 : base_y;
+	generate(length);
+}
+
+void JitterSequence::reset(JITTER::TYPE type, unsigned length)
+{
+	type_ = type;
+	frame_ = 0;
+	generate(length);
+}
+
+void JitterSequence::generate(unsigned length)
+{
+	if (length < 1) length = 1;
+	if (type_ == JITTER::GRID && 16 < length) length = 16;
+	points_.resize(2 * length);
+
+	const float (*table)[2] = nullptr;
+	switch (type_){
+	case JITTER::HALTON:
+		if (base_[0] == 2 && base_[1] == 3) table = HALTON_23_TABLE;
+		break;
+	case JITTER::GRID:
+		table = GRID_TABLE;
+		break;
+	case JITTER::R2:
+		table = R2_TABLE;
+		break;
+	case JITTER::SOBOL:
+		table = SOBOL_TABLE;
+		break;
+	case JITTER::BLUE_NOISE:
+		blueNoise(points_, length);
+		return;
+	default:
+		break;
+	}
+
+	for (unsigned i = 0; i < length; i++){
+		if (table && i < TABLE_LENGTH){
+			points_[2 * i] = table[i][0];
+			points_[2 * i + 1] = table[i][1];
+		}else if (type_ == JITTER::R2){
+			points_[2 * i] = R2(i, 0);
+			points_[2 * i + 1] = R2(i, 1);
+		}else if (type_ == JITTER::SOBOL){
+			points_[2 * i] = Sobol(i, 0);
+			points_[2 * i + 1] = Sobol(i, 1);
+		}else{
+			points_[2 * i] = Halton(i + 1, base_[0]);
+			points_[2 * i + 1] = Halton(i + 1, base_[1]);
+		}
+	}
+}
+
+const float *JitterSequence::next()
+{
+	frame_ = (frame_ + 1) % length();
+	return point(frame_);
+}
+
+void JitterSequence::setBlendWeight(unsigned blend_weight)
+{
+	unsigned length = recommendedLength(type_, blend_weight);
+	if (length != this->length()){
+		reset(type_, length);
+	}
+}
+
+unsigned JitterSequence::recommendedLength(JITTER::TYPE type, unsigned blend_weight)
+{
+	if (JITTER::MAX <= type) type = JITTER::HALTON;
+	int row = 0;
+	while (row < 5 && (2u << row) <= blend_weight) row++;	// floor(log2), capped at 32
+	return RECOMMENDED_LENGTH[type][row];
+}
+
+double JitterSequence::discrepancy(const float *points, unsigned count)
+{
+	if (count == 0) return 0.0;
+
+	double sum1 = 0.0, sum2 = 0.0;
+	for (unsigned i = 0; i < count; i++){
+		double x = points[2 * i], y = points[2 * i + 1];
+		sum1 += (1.0 - x * x) * (1.0 - y * y);
+		for (unsigned j = 0; j < count; j++){
+			double mx = (x < points[2 * j]) ? points[2 * j] : x;
+			double my = (y < points[2 * j + 1]) ? points[2 * j + 1] : y;
+			sum2 += (1.0 - mx) * (1.0 - my);
+		}
+	}
+	double n = (double)count;
+	double d2 = 1.0 / 9.0 - sum1 / (2.0 * n) + sum2 / (n * n);
+	return (0.0 < d2) ? sqrt(d2) : 0.0;
+}
+
+}// namespace tpot
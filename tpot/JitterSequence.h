@@ -0,0 +1,100 @@
+#ifndef TPOT_JITTER_SEQUENCE_H__
+#define TPOT_JITTER_SEQUENCE_H__
+
+#include <vector>
+
+// v120 has no constexpr; the generators are then plain inline functions
+// and the tables are filled at static initialisation.
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define TPOT_CONSTEXPR inline
+#else
+#define TPOT_CONSTEXPR constexpr
+#endif
+
+namespace tpot
+{
+	struct JITTER{
+		enum TYPE
+		{
+			HALTON,		// Halton(2,3) by default, the sample's original table
+			GRID,		// 4x4 ordered grid (at most 16 points)
+			R2,
+			SOBOL,
+			BLUE_NOISE,	// best candidate on the torus, fixed seed
+
+			MAX,
+		};
+
+		static const char *name(JITTER::TYPE type);
+		static bool parse(const char *str, JITTER::TYPE *type);
+	};
+
+	// Generators, all in [0,1)
+	TPOT_CONSTEXPR float JitterUnit(double v)
+	{
+		return (v < 0.99999994) ? (float)v : 0.99999994f;
+	}
+
+	TPOT_CONSTEXPR double RadicalInverse(unsigned index, unsigned base, double digit)
+	{
+		return (index == 0) ? 0.0 : (double)(index % base) * digit + RadicalInverse(index / base, base, digit / (double)base);
+	}
+
+	TPOT_CONSTEXPR float Halton(unsigned index, unsigned base)
+	{
+		return JitterUnit(RadicalInverse(index, base, 1.0 / (double)base));
+	}
+
+	// Plastic constant based additive recurrence (Roberts 2018)
+	TPOT_CONSTEXPR float R2(unsigned index, unsigned axis)
+	{
+		return JitterUnit(0.5 + (axis == 0 ? 0.7548776662466927 : 0.5698402909980532) * (double)index
+			- (double)(unsigned long long)(0.5 + (axis == 0 ? 0.7548776662466927 : 0.5698402909980532) * (double)index));
+	}
+
+	// First two Sobol dimensions: bit reversal, and direction numbers v ^= v >> 1
+	TPOT_CONSTEXPR unsigned SobolBits(unsigned index, unsigned v, unsigned axis)
+	{
+		return (index == 0) ? 0u : (((index & 1u) ? v : 0u) ^ SobolBits(index >> 1, (axis == 0) ? (v >> 1) : (v ^ (v >> 1)), axis));
+	}
+
+	TPOT_CONSTEXPR float Sobol(unsigned index, unsigned axis)
+	{
+		return (float)(SobolBits(index, 0x80000000u, axis) >> 8) * (1.0f / 16777216.0f);
+	}
+
+	// Sub-pixel offsets for the scene pass. Points are in [0,1) like the
+	// original offset_tbl; how they map to jitter is up to the caller.
+	class JitterSequence
+	{
+		JITTER::TYPE type_;
+		unsigned base_[2];
+		unsigned frame_;
+		std::vector<float> points_;	// x, y pairs
+
+		void generate(unsigned length);
+	public:
+		JitterSequence(JITTER::TYPE type = JITTER::HALTON, unsigned length = 8, unsigned base_x = 2, unsigned base_y = 3);
+
+		void reset(JITTER::TYPE type, unsigned length); // restarts at frame 0
+
+		JITTER::TYPE type() const { return type_; }
+		unsigned length() const { return (unsigned)(points_.size() / 2); }
+		const float *point(unsigned index) const { return &points_[2 * (index % length())]; }
+
+		// Per frame: advances and returns the point for the new frame
+		const float *next();
+
+		// Picks recommendedLength() for the blend weight, restarting only when the length changes
+		void setBlendWeight(unsigned blend_weight);
+
+		// Shortest length whose steady state edge coverage error at blend weight
+		// 1/blend_weight is within 10% of the 64 point sequence of the same type (taa_cpu jitter)
+		static unsigned recommendedLength(JITTER::TYPE type, unsigned blend_weight);
+
+		// L2 star discrepancy of count points (Warnock's formula)
+		static double discrepancy(const float *points, unsigned count);
+	};
+
+}// namespace tpot
+#endif // TPOT_JITTER_SEQUENCE_H__
@@ -0,0 +1,110 @@
+#include "JobGraph.h"
+#include "ThreadPool.h"
+
+namespace tpot
+{
+
+JobGraph::JobGraph()
+	: remaining_(0), running_(0), pool_(nullptr)
+{
+}
+
+unsigned JobGraph::add(std::function<bool()> fn, AFFINITY::ID affinity)
+{
+	JOB job;
+	job.fn = std::move(fn);
+	job.affinity = affinity;
+	job.waiting = 0;
+	job.dependency_failed = false;
+	job.state = STATE::PENDING;
+	jobs_.push_back(std::move(job));
+	return (unsigned)jobs_.size() - 1;
+}
+
+void JobGraph::depend(unsigned job, unsigned on)
+{
+	jobs_[on].dependents.push_back(job);
+	jobs_[job].waiting++;
+}
+
+// mutex_ held
+void JobGraph::ready(unsigned job)
+{
+	JOB &j = jobs_[job];
+	if (j.dependency_failed){
+		j.state = STATE::SKIPPED;
+		complete(job, false);
+		return;
+	}
+
+	if (j.affinity == AFFINITY::OWNER || !pool_){
+		owner_.push_back(job);
+		cv_.notify_all();
+		return;
+	}
+
+	running_++;
+	pool_->submit([this, job]{
+		bool ok = jobs_[job].fn();
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		running_--;
+		complete(job, ok);
+		cv_.notify_all();
+	});
+}
+
+// mutex_ held
+void JobGraph::complete(unsigned job, bool ok)
+{
+	JOB &j = jobs_[job];
+	if (j.state == STATE::PENDING) j.state = ok ? STATE::DONE : STATE::FAILED;
+	remaining_--;
+
+	for (unsigned d : j.dependents){
+		if (!ok) jobs_[d].dependency_failed = true;
+		if (--jobs_[d].waiting == 0) ready(d);
+	}
+}
+
+bool JobGraph::run(ThreadPool *pool)
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	pool_ = (pool && pool->size()) ? pool : nullptr;
+	remaining_ = (unsigned)jobs_.size();
+	running_ = 0;
+
+	for (unsigned i = 0; i < jobs_.size(); i++){
+		if (jobs_[i].state == STATE::PENDING && jobs_[i].waiting == 0) ready(i);
+	}
+
+	while (remaining_){
+		if (!owner_.empty()){
+			unsigned job = owner_.front();
+			owner_.pop_front();
+
+			lock.unlock();
+			bool ok = jobs_[job].fn();
+			lock.lock();
+			complete(job, ok);
+			continue;
+		}
+
+		if (!running_){
+			// nothing can make progress: the rest waits on a cycle
+			for (auto &j : jobs_){
+				if (j.state == STATE::PENDING) j.state = STATE::SKIPPED;
+			}
+			break;
+		}
+		cv_.wait(lock);
+	}
+	pool_ = nullptr;
+
+	for (auto &j : jobs_){
+		if (j.state != STATE::DONE) return false;
+	}
+	return true;
+}
+
+}// namespace tpot
@@ -0,0 +1,80 @@
+#ifndef TPOT_JOB_GRAPH_H__
+#define TPOT_JOB_GRAPH_H__
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace tpot
+{
+
+	class ThreadPool;
+
+	struct AFFINITY{
+		enum ID
+		{
+			WORKER,	// any ThreadPool thread
+			OWNER,	// the thread calling JobGraph::run(), e.g. for D3D object creation
+
+			MAX,
+		};
+	};
+
+	// Jobs with dependencies, run once each. A job starts when every job it
+	// depends on has succeeded; if one failed it is skipped, and so are its
+	// dependents. OWNER jobs run as soon as they are ready, interleaved with
+	// the WORKER jobs still in flight.
+	class JobGraph
+	{
+	public:
+		struct STATE{
+			enum ID
+			{
+				PENDING,
+				DONE,
+				FAILED,	// returned false
+				SKIPPED,	// a dependency failed, or a cycle
+
+				MAX,
+			};
+		};
+
+	private:
+		struct JOB
+		{
+			std::function<bool()> fn;
+			AFFINITY::ID affinity;
+			std::vector<unsigned> dependents;
+			unsigned waiting;	// dependencies not yet done
+			bool dependency_failed;
+			STATE::ID state;
+		};
+
+		std::vector<JOB> jobs_;
+		std::deque<unsigned> owner_;	// ready for the calling thread
+		unsigned remaining_;
+		unsigned running_;	// on workers
+		std::mutex mutex_;
+		std::condition_variable cv_;
+		ThreadPool *pool_;
+
+		void ready(unsigned job);
+		void complete(unsigned job, bool ok);
+	public:
+		JobGraph();
+
+		unsigned add(std::function<bool()> fn, AFFINITY::ID affinity = AFFINITY::WORKER);
+		void depend(unsigned job, unsigned on); // job runs after on
+
+		// Runs every job and returns when all are finished; true if all
+		// succeeded. Without a pool everything runs on the calling thread.
+		bool run(ThreadPool *pool);
+
+		unsigned size() const { return (unsigned)jobs_.size(); }
+		STATE::ID state(unsigned job) const { return jobs_[job].state; }
+	};
+
+}// namespace tpot
+#endif // TPOT_JOB_GRAPH_H__
@@ -0,0 +1,143 @@
+#include <string.h>
+#include <vector>
+#include "Lz4.h"
+
+namespace tpot
+{
+
+namespace
+{
+	enum{
+		MIN_MATCH = 4,
+		LAST_LITERALS = 5,	// a block ends with at least this many literals
+		MF_LIMIT = 12,		// no match starts in the last MF_LIMIT bytes
+		MAX_OFFSET = 65535,
+		HASH_BITS = 12,
+	};
+
+	inline unsigned read32(const unsigned char *p)
+	{
+		unsigned v;
+		memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	inline unsigned hash(unsigned sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HASH_BITS);
+	}
+
+	// 15 in the token nibble, then 255s and the remainder
+	inline bool putLength(unsigned char *&op, const unsigned char *oend, size_t length)
+	{
+		for (; 255 <= length; length -= 255){
+			if (oend <= op) return false;
+			*op++ = 255;
+		}
+		if (oend <= op) return false;
+		*op++ = (unsigned char)length;
+		return true;
+	}
+
+	inline bool getLength(const unsigned char *&ip, const unsigned char *iend, size_t *length)
+	{
+		for (;;){
+			if (iend <= ip) return false;
+			unsigned char b = *ip++;
+			*length += b;
+			if (b != 255) return true;
+		}
+	}
+
+	bool putSequence(unsigned char *&op, const unsigned char *oend,
+		const unsigned char *literals, size_t literal_length, size_t offset, size_t match_length)
+	{
+		if (oend <= op) return false;
+		unsigned char *token = op++;
+		*token = (unsigned char)(((literal_length < 15) ? literal_length : 15) << 4);
+		if (15 <= literal_length && !putLength(op, oend, literal_length - 15)) return false;
+		if ((size_t)(oend - op) < literal_length) return false;
+		if (literal_length) memcpy(op, literals, literal_length);
+		op += literal_length;
+		if (match_length == 0) return true;	// the last sequence
+
+		if (oend - op < 2) return false;
+		*op++ = (unsigned char)(offset & 0xff);
+		*op++ = (unsigned char)(offset >> 8);
+		size_t ml = match_length - MIN_MATCH;
+		*token |= (unsigned char)((ml < 15) ? ml : 15);
+		return (ml < 15) || putLength(op, oend, ml - 15);
+	}
+}// namespace
+
+size_t Lz4Compress(const void *src, size_t size, void *dst, size_t capacity)
+{
+	const unsigned char *base = (const unsigned char*)src;
+	const unsigned char *ip = base, *anchor = base, *end = base + size;
+	unsigned char *op = (unsigned char*)dst, *oend = op + capacity;
+
+	if (MF_LIMIT < size){
+		std::vector<unsigned> table(1u << HASH_BITS, 0);
+		const unsigned char *mflimit = end - MF_LIMIT;
+		const unsigned char *matchlimit = end - LAST_LITERALS;
+		while (ip < mflimit){
+			unsigned sequence = read32(ip);
+			unsigned &slot = table[hash(sequence)];
+			const unsigned char *ref = base + slot;
+			slot = (unsigned)(ip - base);
+			if (ip <= ref || MAX_OFFSET < ip - ref || read32(ref) != sequence){
+				ip++;
+				continue;
+			}
+
+			const unsigned char *m = ip + MIN_MATCH, *r = ref + MIN_MATCH;
+			while (m < matchlimit && *m == *r){
+				m++;
+				r++;
+			}
+			if (!putSequence(op, oend, anchor, ip - anchor, ip - ref, m - ip)) return 0;
+			ip = anchor = m;
+		}
+	}
+	if (!putSequence(op, oend, anchor, end - anchor, 0, 0)) return 0;
+	return op - (unsigned char*)dst;
+}
+
+bool Lz4Decompress(const void *src, size_t size, void *dst, size_t dst_size)
+{
+	const unsigned char *ip = (const unsigned char*)src, *iend = ip + size;
+	unsigned char *op = (unsigned char*)dst, *oend = op + dst_size;
+
+	while (ip < iend){
+		unsigned char token = *ip++;
+		size_t literal_length = token >> 4;
+		if (literal_length == 15 && !getLength(ip, iend, &literal_length)) return false;
+		if ((size_t)(iend - ip) < literal_length || (size_t)(oend - op) < literal_length) return false;
+		if (literal_length) memcpy(op, ip, literal_length);
+		ip += literal_length;
+		op += literal_length;
+		if (ip == iend) break;	// the last sequence has no match
+
+		if (iend - ip < 2) return false;
+		size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || (size_t)(op - (unsigned char*)dst) < offset) return false;
+
+		size_t match_length = token & 15;
+		if (match_length == 15 && !getLength(ip, iend, &match_length)) return false;
+		match_length += MIN_MATCH;
+		if ((size_t)(oend - op) < match_length) return false;
+
+		// overlapping copies repeat the last offset bytes
+		const unsigned char *match = op - offset;
+		if (match_length <= offset){
+			memcpy(op, match, match_length);
+			op += match_length;
+		}else{
+			for (size_t i = 0; i < match_length; i++) *op++ = *match++;
+		}
+	}
+	return op == oend;
+}
+
+}// namespace tpot
@@ -0,0 +1,24 @@
+#ifndef TPOT_LZ4_H__
+#define TPOT_LZ4_H__
+
+#include <stddef.h>
+
+namespace tpot
+{
+
+	// LZ4 block format (no frame, no checksum), readable by any LZ4
+	// decoder. The compressor is the greedy single hash probe of the
+	// reference fast mode; decompression is what a loader pays for.
+
+	// Capacity that always fits Lz4Compress of size bytes
+	inline size_t Lz4CompressBound(size_t size){ return size + size / 255 + 16; }
+
+	// Compressed size, 0 when capacity is too small
+	size_t Lz4Compress(const void *src, size_t size, void *dst, size_t capacity);
+
+	// Exactly dst_size bytes out; false on a malformed or short block.
+	// Never reads or writes outside of the two buffers.
+	bool Lz4Decompress(const void *src, size_t size, void *dst, size_t dst_size);
+
+}// namespace tpot
+#endif // TPOT_LZ4_H__
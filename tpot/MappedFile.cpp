@@ -0,0 +1,127 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace tpot
+{
+
+#ifdef _WIN32
+
+namespace
+{
+	// Shared by both open() overloads once the file is open
+	bool mapHandle(HANDLE file, HANDLE *mapping, const unsigned char **data, size_t *size)
+	{
+		LARGE_INTEGER file_size;
+		if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart <= 0) return false;
+		if ((unsigned long long)file_size.QuadPart != (size_t)file_size.QuadPart) return false;
+
+		*mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!*mapping) return false;
+		*data = (const unsigned char*)MapViewOfFile(*mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!*data){
+			CloseHandle(*mapping);
+			*mapping = nullptr;
+			return false;
+		}
+		*size = (size_t)file_size.QuadPart;
+		return true;
+	}
+}// namespace
+
+MappedFile::MappedFile()
+	: data_(nullptr), size_(0), file_(INVALID_HANDLE_VALUE), mapping_(nullptr)
+{
+}
+
+bool MappedFile::open(const char *path)
+{
+	close();
+	file_ = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file_ == INVALID_HANDLE_VALUE) return false;
+	HANDLE mapping = nullptr;
+	if (!mapHandle(file_, &mapping, &data_, &size_)){
+		close();
+		return false;
+	}
+	mapping_ = mapping;
+	return true;
+}
+
+bool MappedFile::open(const wchar_t *path)
+{
+	close();
+	file_ = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file_ == INVALID_HANDLE_VALUE) return false;
+	HANDLE mapping = nullptr;
+	if (!mapHandle(file_, &mapping, &data_, &size_)){
+		close();
+		return false;
+	}
+	mapping_ = mapping;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (data_) UnmapViewOfFile(data_);
+	if (mapping_) CloseHandle(mapping_);
+	if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+	data_ = nullptr;
+	size_ = 0;
+	mapping_ = nullptr;
+	file_ = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+MappedFile::MappedFile()
+	: data_(nullptr), size_(0), fd_(-1)
+{
+}
+
+bool MappedFile::open(const char *path)
+{
+	close();
+	fd_ = ::open(path, O_RDONLY);
+	if (fd_ < 0) return false;
+
+	struct stat st;
+	if (fstat(fd_, &st) != 0 || st.st_size <= 0){
+		close();
+		return false;
+	}
+	void *p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd_, 0);
+	if (p == MAP_FAILED){
+		close();
+		return false;
+	}
+	data_ = (const unsigned char*)p;
+	size_ = (size_t)st.st_size;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (data_) munmap((void*)data_, size_);
+	if (0 <= fd_) ::close(fd_);
+	data_ = nullptr;
+	size_ = 0;
+	fd_ = -1;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+}// namespace tpot
@@ -0,0 +1,43 @@
+#ifndef TPOT_MAPPED_FILE_H__
+#define TPOT_MAPPED_FILE_H__
+
+#include <stddef.h>
+
+namespace tpot
+{
+
+	// Read only view of a whole file: file mapping on Windows, mmap elsewhere.
+	// Pages are read on first touch and are backed by the file, so they cost
+	// no committed memory and can be dropped under pressure. Writing through
+	// data() faults.
+	class MappedFile
+	{
+		const unsigned char *data_;
+		size_t size_;
+#ifdef _WIN32
+		void *file_;
+		void *mapping_;
+#else
+		int fd_;
+#endif
+
+		MappedFile(const MappedFile &);
+		MappedFile &operator=(const MappedFile &);
+
+	public:
+		MappedFile();
+		~MappedFile();
+
+		bool open(const char *path);	// false: missing, unreadable or empty
+#ifdef _WIN32
+		bool open(const wchar_t *path);
+#endif
+		void close();
+
+		bool isOpen() const { return data_ != nullptr; }
+		const unsigned char *data() const { return data_; }
+		size_t size() const { return size_; }
+	};
+
+}// namespace tpot
+#endif // TPOT_MAPPED_FILE_H__
@@ -0,0 +1,151 @@
+#include <math.h>
+#include <string.h>
+#include "Matrix.h"
+
+namespace tpot
+{
+
+MATRIX MatrixIdentity()
+{
+	MATRIX r;
+	memset(&r, 0, sizeof(r));
+	r.m[0][0] = r.m[1][1] = r.m[2][2] = r.m[3][3] = 1.0f;
+	return r;
+}
+
+MATRIX MatrixMultiply(const MATRIX &a, const MATRIX &b)
+{
+	MATRIX r;
+	for (int i = 0; i < 4; i++){
+		for (int j = 0; j < 4; j++){
+			r.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j] + a.m[i][3] * b.m[3][j];
+		}
+	}
+	return r;
+}
+
+// Gauss-Jordan with partial pivoting
+bool MatrixInverse(MATRIX *out, const MATRIX &a)
+{
+	double t[4][8];
+	for (int i = 0; i < 4; i++){
+		for (int j = 0; j < 4; j++){
+			t[i][j] = a.m[i][j];
+			t[i][j + 4] = (i == j) ? 1.0 : 0.0;
+		}
+	}
+
+	for (int c = 0; c < 4; c++){
+		int pivot = c;
+		for (int r = c + 1; r < 4; r++){
+			if (fabs(t[pivot][c]) < fabs(t[r][c])) pivot = r;
+		}
+		if (fabs(t[pivot][c]) < 1e-12) return false;
+		if (pivot != c){
+			for (int j = 0; j < 8; j++){
+				double s = t[c][j]; t[c][j] = t[pivot][j]; t[pivot][j] = s;
+			}
+		}
+
+		double inv = 1.0 / t[c][c];
+		for (int j = 0; j < 8; j++) t[c][j] *= inv;
+		for (int r = 0; r < 4; r++){
+			if (r == c) continue;
+			double f = t[r][c];
+			for (int j = 0; j < 8; j++) t[r][j] -= f * t[c][j];
+		}
+	}
+
+	for (int i = 0; i < 4; i++){
+		for (int j = 0; j < 4; j++){
+			out->m[i][j] = (float)t[i][j + 4];
+		}
+	}
+	return true;
+}
+
+MATRIX MatrixTranslation(float x, float y, float z)
+{
+	MATRIX r = MatrixIdentity();
+	r.m[3][0] = x;
+	r.m[3][1] = y;
+	r.m[3][2] = z;
+	return r;
+}
+
+MATRIX MatrixScaling(float x, float y, float z)
+{
+	MATRIX r = MatrixIdentity();
+	r.m[0][0] = x;
+	r.m[1][1] = y;
+	r.m[2][2] = z;
+	return r;
+}
+
+MATRIX MatrixTranspose(const MATRIX &a)
+{
+	MATRIX r;
+	for (int i = 0; i < 4; i++){
+		for (int j = 0; j < 4; j++){
+			r.m[i][j] = a.m[j][i];
+		}
+	}
+	return r;
+}
+
+MATRIX MatrixLookAtLH(const float eye[3], const float at[3], const float up[3])
+{
+	float z[3] = { at[0] - eye[0], at[1] - eye[1], at[2] - eye[2] };
+	float zl = sqrtf(z[0] * z[0] + z[1] * z[1] + z[2] * z[2]);
+	z[0] /= zl; z[1] /= zl; z[2] /= zl;
+
+	float x[3] = { up[1] * z[2] - up[2] * z[1], up[2] * z[0] - up[0] * z[2], up[0] * z[1] - up[1] * z[0] };
+	float xl = sqrtf(x[0] * x[0] + x[1] * x[1] + x[2] * x[2]);
+	x[0] /= xl; x[1] /= xl; x[2] /= xl;
+
+	float y[3] = { z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0] };
+
+	MATRIX r = MatrixIdentity();
+	for (int i = 0; i < 3; i++){
+		r.m[i][0] = x[i];
+		r.m[i][1] = y[i];
+		r.m[i][2] = z[i];
+	}
+	r.m[3][0] = -(x[0] * eye[0] + x[1] * eye[1] + x[2] * eye[2]);
+	r.m[3][1] = -(y[0] * eye[0] + y[1] * eye[1] + y[2] * eye[2]);
+	r.m[3][2] = -(z[0] * eye[0] + z[1] * eye[1] + z[2] * eye[2]);
+	return r;
+}
+
+MATRIX MatrixPerspectiveFovLH(float fovy, float aspect, float zn, float zf)
+{
+	float ys = 1.0f / tanf(0.5f * fovy);
+
+	MATRIX r;
+	memset(&r, 0, sizeof(r));
+	r.m[0][0] = ys / aspect;
+	r.m[1][1] = ys;
+	r.m[2][2] = zf / (zf - zn);
+	r.m[2][3] = 1.0f;
+	r.m[3][2] = -zn * zf / (zf - zn);
+	return r;
+}
+
+MATRIX MatrixOrthoRH(float w, float h, float zn, float zf)
+{
+	MATRIX r = MatrixIdentity();
+	r.m[0][0] = 2.0f / w;
+	r.m[1][1] = 2.0f / h;
+	r.m[2][2] = 1.0f / (zn - zf);
+	r.m[3][2] = zn / (zn - zf);
+	return r;
+}
+
+void TransformCoord(const MATRIX &a, const float v[3], float out[4])
+{
+	for (int j = 0; j < 4; j++){
+		out[j] = v[0] * a.m[0][j] + v[1] * a.m[1][j] + v[2] * a.m[2][j] + a.m[3][j];
+	}
+}
+
+}// namespace tpot
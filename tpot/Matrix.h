@@ -0,0 +1,28 @@
+#ifndef TPOT_MATRIX_H__
+#define TPOT_MATRIX_H__
+
+namespace tpot
+{
+
+	// Portable row-vector 4x4 matrix with the D3DX conventions (v' = v * M),
+	// so CPU code reproduces the matrices built in sample.cpp
+	struct MATRIX
+	{
+		float m[4][4];
+	};
+
+	MATRIX MatrixIdentity();
+	MATRIX MatrixMultiply(const MATRIX &a, const MATRIX &b);
+	bool   MatrixInverse(MATRIX *out, const MATRIX &a);
+	MATRIX MatrixTranslation(float x, float y, float z);
+	MATRIX MatrixScaling(float x, float y, float z);
+	MATRIX MatrixTranspose(const MATRIX &a);
+	MATRIX MatrixLookAtLH(const float eye[3], const float at[3], const float up[3]);
+	MATRIX MatrixPerspectiveFovLH(float fovy, float aspect, float zn, float zf);
+	MATRIX MatrixOrthoRH(float w, float h, float zn, float zf);
+
+	// (x, y, z, 1) * M
+	void   TransformCoord(const MATRIX &a, const float v[3], float out[4]);
+
+}// namespace tpot
+#endif // TPOT_MATRIX_H__
@@ -0,0 +1,548 @@
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include "MeshOptimizer.h"
+
+namespace tpot
+{
+
+namespace
+{
+	// Triangles of every vertex; counts are the triangles still to emit
+	struct ADJACENCY
+	{
+		std::vector<unsigned> offsets;
+		std::vector<unsigned> triangles;
+		std::vector<unsigned> counts;
+
+		void build(const unsigned *indices, size_t index_count, size_t vertex_count)
+		{
+			counts.assign(vertex_count, 0);
+			for (size_t i = 0; i < index_count; i++) counts[indices[i]]++;
+			offsets.assign(vertex_count + 1, 0);
+			for (size_t v = 0; v < vertex_count; v++) offsets[v + 1] = offsets[v] + counts[v];
+			triangles.resize(index_count);
+			std::vector<unsigned> fill(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < index_count; i++) triangles[fill[indices[i]]++] = (unsigned)(i / 3);
+		}
+	};
+
+	// A vertex is cached while fewer than size others came in after it
+	class FifoCache
+	{
+		std::vector<unsigned> stamp_;
+		unsigned time_;
+		unsigned size_;
+
+	public:
+		FifoCache(size_t vertex_count, unsigned size) : stamp_(vertex_count, 0), time_(size + 1), size_(size){}
+
+		bool miss(unsigned v)
+		{
+			if (time_ - stamp_[v] <= size_) return false;
+			stamp_[v] = time_++;
+			return true;
+		}
+		unsigned age(unsigned v) const { return time_ - stamp_[v]; }
+		unsigned time() const { return time_; }
+		void reset(){ time_ += size_; }
+	};
+
+	void position(float *p, const float *positions, size_t stride, unsigned v)
+	{
+		memcpy(p, (const char*)positions + v * stride, 3 * sizeof(float));
+	}
+
+	unsigned triangleMisses(FifoCache &cache, const unsigned *tri)
+	{
+		return (unsigned)cache.miss(tri[0]) + (unsigned)cache.miss(tri[1]) + (unsigned)cache.miss(tri[2]);
+	}
+
+	// Forsyth's scoring, an LRU of FORSYTH_CACHE
+	enum{
+		FORSYTH_CACHE = 32,
+		FORSYTH_VALENCE = 32,	// valences past this score as this
+		OVERDRAW_GRID = 256,
+		FETCH_LINE = 64,
+		FETCH_LINES = 256,
+	};
+
+	struct FORSYTH_SCORES
+	{
+		float cache[FORSYTH_CACHE];
+		float valence[FORSYTH_VALENCE + 1];
+
+		FORSYTH_SCORES()
+		{
+			for (int i = 0; i < FORSYTH_CACHE; i++){
+				// the last triangle's vertices score alike, so no order is forced within it
+				cache[i] = (i < 3) ? 0.75f : powf(1.0f - (float)(i - 3) / (FORSYTH_CACHE - 3), 1.5f);
+			}
+			valence[0] = 0.0f;
+			for (int i = 1; i <= FORSYTH_VALENCE; i++) valence[i] = 2.0f / sqrtf((float)i);
+		}
+
+		float score(int cache_position, unsigned live) const
+		{
+			if (live == 0) return -1.0f;
+			float s = (0 <= cache_position) ? cache[cache_position] : 0.0f;
+			return s + valence[std::min<unsigned>(live, FORSYTH_VALENCE)];
+		}
+	};
+
+	// OptimizeMeshOrder's measure, lower is better on both
+	struct ORDER_COST
+	{
+		unsigned transformed;
+		float    overdraw;	// 0 without positions
+
+		bool beats(const ORDER_COST &o) const
+		{
+			return transformed <= o.transformed && overdraw <= o.overdraw
+				&& (transformed < o.transformed || overdraw < o.overdraw);
+		}
+	};
+
+	// The overdraw raster is the expensive part, skipped where the misses
+	// already lose to max_transformed
+	ORDER_COST orderCost(const unsigned *indices, size_t index_count, const float *positions, size_t vertex_count,
+		size_t stride, unsigned cache_size, unsigned max_transformed = ~0u)
+	{
+		ORDER_COST c;
+		c.transformed = AnalyzeVertexCache(indices, index_count, vertex_count, cache_size).transformed;
+		c.overdraw = (positions && c.transformed <= max_transformed)
+			? AnalyzeOverdraw(indices, index_count, positions, vertex_count, stride).overdraw : 0.0f;
+		return c;
+	}
+}// namespace
+
+VCACHE_STATS AnalyzeVertexCache(const unsigned *indices, size_t index_count, size_t vertex_count, unsigned cache_size)
+{
+	VCACHE_STATS stats = {};
+	FifoCache cache(vertex_count, cache_size);
+	std::vector<char> seen(vertex_count, 0);
+	for (size_t i = 0; i < index_count; i++){
+		unsigned v = indices[i];
+		stats.transformed += cache.miss(v);
+		if (!seen[v]){
+			seen[v] = 1;
+			stats.vertices++;
+		}
+	}
+	stats.triangles = (unsigned)(index_count / 3);
+	stats.acmr = stats.triangles ? (float)stats.transformed / stats.triangles : 0.0f;
+	stats.atvr = stats.vertices ? (float)stats.transformed / stats.vertices : 0.0f;
+	return stats;
+}
+
+OVERDRAW_STATS AnalyzeOverdraw(const unsigned *indices, size_t index_count, const float *positions, size_t vertex_count, size_t stride)
+{
+	OVERDRAW_STATS stats = {};
+	float lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (size_t i = 0; i < index_count; i++){
+		float p[3];
+		position(p, positions, stride, indices[i]);
+		for (int k = 0; k < 3; k++){
+			lo[k] = std::min(lo[k], p[k]);
+			hi[k] = std::max(hi[k], p[k]);
+		}
+	}
+	float extent = std::max(hi[0] - lo[0], std::max(hi[1] - lo[1], hi[2] - lo[2]));
+	if (index_count < 3 || !(0.0f < extent)){
+		stats.overdraw = 1.0f;
+		return stats;
+	}
+	(void)vertex_count;
+
+	std::vector<float> depth(OVERDRAW_GRID * OVERDRAW_GRID);
+	std::vector<char> covered(OVERDRAW_GRID * OVERDRAW_GRID);
+	float scale = OVERDRAW_GRID / extent;
+	for (int axis = 0; axis < 3; axis++){
+		int u = (axis + 1) % 3, w = (axis + 2) % 3;
+		for (int dir = 0; dir < 2; dir++){
+			std::fill(depth.begin(), depth.end(), FLT_MAX);
+			std::fill(covered.begin(), covered.end(), 0);
+
+			for (size_t t = 0; t + 2 < index_count; t += 3){
+				float x[3], y[3], z[3];
+				for (int k = 0; k < 3; k++){
+					float p[3];
+					position(p, positions, stride, indices[t + k]);
+					// looking down -axis or +axis; mirroring x keeps front faces counter clockwise
+					x[k] = (p[u] - lo[u]) * scale;
+					y[k] = (p[w] - lo[w]) * scale;
+					z[k] = p[axis] - lo[axis];
+					if (dir){
+						x[k] = OVERDRAW_GRID - x[k];
+						z[k] = hi[axis] - p[axis];
+					}
+				}
+				// clockwise is front facing, as D3D11 rasterizes by default; then
+				// turned counter clockwise for the edge functions below
+				float area = (x[2] - x[0]) * (y[1] - y[0]) - (x[1] - x[0]) * (y[2] - y[0]);
+				if (!(0.0f < area)) continue;	// back facing or degenerate
+				std::swap(x[1], x[2]);
+				std::swap(y[1], y[2]);
+				std::swap(z[1], z[2]);
+
+				int x0 = std::max(0, (int)floorf(std::min(x[0], std::min(x[1], x[2]))));
+				int x1 = std::min(OVERDRAW_GRID - 1, (int)ceilf(std::max(x[0], std::max(x[1], x[2]))));
+				int y0 = std::max(0, (int)floorf(std::min(y[0], std::min(y[1], y[2]))));
+				int y1 = std::min(OVERDRAW_GRID - 1, (int)ceilf(std::max(y[0], std::max(y[1], y[2]))));
+				for (int py = y0; py <= y1; py++){
+					for (int px = x0; px <= x1; px++){
+						float cx = px + 0.5f, cy = py + 0.5f;
+						float e0 = (x[2] - x[1]) * (cy - y[1]) - (y[2] - y[1]) * (cx - x[1]);
+						float e1 = (x[0] - x[2]) * (cy - y[2]) - (y[0] - y[2]) * (cx - x[2]);
+						float e2 = (x[1] - x[0]) * (cy - y[0]) - (y[1] - y[0]) * (cx - x[0]);
+						if (e0 < 0.0f || e1 < 0.0f || e2 < 0.0f) continue;
+
+						float d = (e0 * z[0] + e1 * z[1] + e2 * z[2]) / area;
+						size_t pixel = (size_t)py * OVERDRAW_GRID + px;
+						if (!covered[pixel]){
+							covered[pixel] = 1;
+							stats.covered++;
+						}
+						if (d < depth[pixel]){
+							depth[pixel] = d;
+							stats.shaded++;
+						}
+					}
+				}
+			}
+		}
+	}
+	stats.overdraw = stats.covered ? (float)stats.shaded / stats.covered : 1.0f;
+	return stats;
+}
+
+VFETCH_STATS AnalyzeVertexFetch(const unsigned *indices, size_t index_count, size_t vertex_count, size_t vertex_size)
+{
+	VFETCH_STATS stats = {};
+	FifoCache post_transform(vertex_count, 16);
+	std::vector<size_t> tag(FETCH_LINES, ~(size_t)0);
+	std::vector<char> seen(vertex_count, 0);
+	size_t referenced = 0;
+	for (size_t i = 0; i < index_count; i++){
+		unsigned v = indices[i];
+		if (!seen[v]){
+			seen[v] = 1;
+			referenced++;
+		}
+		if (!post_transform.miss(v) || vertex_size == 0) continue;
+
+		size_t first = v * vertex_size / FETCH_LINE, last = (v * vertex_size + vertex_size - 1) / FETCH_LINE;
+		for (size_t line = first; line <= last; line++){
+			size_t &slot = tag[line % FETCH_LINES];
+			if (slot == line) continue;
+			slot = line;
+			stats.bytes_fetched += FETCH_LINE;
+		}
+	}
+	stats.overfetch = referenced ? (float)((double)stats.bytes_fetched / ((double)referenced * vertex_size)) : 0.0f;
+	return stats;
+}
+
+void OptimizeVertexCacheForsyth(unsigned *dst, const unsigned *indices, size_t index_count, size_t vertex_count)
+{
+	static const FORSYTH_SCORES SCORES;
+	size_t triangle_count = index_count / 3;
+	if (triangle_count == 0) return;
+
+	ADJACENCY adjacency;
+	adjacency.build(indices, triangle_count * 3, vertex_count);
+
+	std::vector<int> cache_position(vertex_count, -1);
+	std::vector<float> vertex_score(vertex_count);
+	for (size_t v = 0; v < vertex_count; v++) vertex_score[v] = SCORES.score(-1, adjacency.counts[v]);
+
+	std::vector<float> triangle_score(triangle_count);
+	std::vector<char> emitted(triangle_count, 0);
+	size_t best = 0;
+	for (size_t t = 0; t < triangle_count; t++){
+		const unsigned *tri = indices + t * 3;
+		triangle_score[t] = vertex_score[tri[0]] + vertex_score[tri[1]] + vertex_score[tri[2]];
+		if (triangle_score[best] < triangle_score[t]) best = t;
+	}
+
+	unsigned cache[FORSYTH_CACHE + 3];
+	unsigned cache_count = 0;
+	size_t cursor = 0;
+	for (size_t out = 0; out < triangle_count; out++){
+		if (best == ~(size_t)0){
+			// nothing cached is left: the next triangle in input order
+			while (emitted[cursor]) cursor++;
+			best = cursor;
+		}
+		const unsigned *tri = indices + best * 3;
+		memcpy(dst + out * 3, tri, 3 * sizeof(unsigned));
+		emitted[best] = 1;
+
+		// its vertices go to the front, the rest move back
+		unsigned next[FORSYTH_CACHE + 3];
+		unsigned next_count = 0;
+		for (int k = 0; k < 3; k++){
+			unsigned v = tri[k];
+			unsigned *list = &adjacency.triangles[adjacency.offsets[v]];
+			unsigned &count = adjacency.counts[v];
+			for (unsigned i = 0; i < count; i++){
+				if (list[i] != best) continue;
+				list[i] = list[--count];
+				break;
+			}
+			if (std::find(next, next + next_count, v) == next + next_count) next[next_count++] = v;
+		}
+		for (unsigned i = 0; i < cache_count; i++){
+			unsigned v = cache[i];
+			if (v != tri[0] && v != tri[1] && v != tri[2]) next[next_count++] = v;
+		}
+
+		for (unsigned i = 0; i < next_count; i++){
+			unsigned v = next[i];
+			cache_position[v] = (i < FORSYTH_CACHE) ? (int)i : -1;
+			vertex_score[v] = SCORES.score(cache_position[v], adjacency.counts[v]);
+		}
+		cache_count = std::min<unsigned>(next_count, FORSYTH_CACHE);
+		memcpy(cache, next, cache_count * sizeof(unsigned));
+
+		// only triangles touching the cache changed score
+		best = ~(size_t)0;
+		float best_score = -1.0f;
+		for (unsigned i = 0; i < next_count; i++){
+			unsigned v = next[i];
+			const unsigned *list = &adjacency.triangles[adjacency.offsets[v]];
+			for (unsigned k = 0; k < adjacency.counts[v]; k++){
+				unsigned t = list[k];
+				const unsigned *u = indices + t * 3;
+				float s = vertex_score[u[0]] + vertex_score[u[1]] + vertex_score[u[2]];
+				triangle_score[t] = s;
+				if (best_score < s){
+					best_score = s;
+					best = t;
+				}
+			}
+		}
+	}
+}
+
+void OptimizeVertexCacheTipsify(unsigned *dst, const unsigned *indices, size_t index_count, size_t vertex_count,
+	unsigned cache_size, std::vector<unsigned> *clusters)
+{
+	size_t triangle_count = index_count / 3;
+	if (clusters) clusters->clear();
+	if (triangle_count == 0) return;
+
+	ADJACENCY adjacency;
+	adjacency.build(indices, triangle_count * 3, vertex_count);
+	std::vector<unsigned> &live = adjacency.counts;	// not reduced by emission below, Tipsify keeps its own
+	std::vector<unsigned> remaining(live);
+	std::vector<char> emitted(triangle_count, 0);
+	std::vector<unsigned> dead_end, candidates;
+	FifoCache cache(vertex_count, cache_size);
+
+	size_t cursor = 0;
+	while (cursor < vertex_count && remaining[cursor] == 0) cursor++;
+	long long fan = (long long)cursor;
+	size_t out = 0;
+	if (clusters) clusters->push_back(0);
+
+	while (0 <= fan && (size_t)fan < vertex_count){
+		candidates.clear();
+		const unsigned *list = &adjacency.triangles[adjacency.offsets[fan]];
+		for (unsigned k = 0; k < live[fan]; k++){
+			unsigned t = list[k];
+			if (emitted[t]) continue;
+			emitted[t] = 1;
+			const unsigned *tri = indices + t * 3;
+			for (int j = 0; j < 3; j++){
+				unsigned v = tri[j];
+				dst[out++] = v;
+				dead_end.push_back(v);
+				candidates.push_back(v);
+				remaining[v]--;
+				cache.miss(v);
+			}
+		}
+
+		// the candidate that stays in the cache longest once fanned
+		long long next = -1;
+		long long priority = -1;
+		for (unsigned v : candidates){
+			if (remaining[v] == 0) continue;
+			long long p = 0;
+			if (cache.age(v) + 2 * remaining[v] <= cache_size) p = cache.age(v);
+			if (priority < p){
+				priority = p;
+				next = v;
+			}
+		}
+
+		if (next < 0){
+			// dead end: recent vertices first, then the input order; the cache starts over
+			while (!dead_end.empty() && next < 0){
+				unsigned d = dead_end.back();
+				dead_end.pop_back();
+				if (remaining[d]) next = d;
+			}
+			while (next < 0 && cursor < vertex_count){
+				if (remaining[cursor]) next = (long long)cursor;
+				else cursor++;
+			}
+			if (0 <= next && clusters && clusters->back() != out / 3) clusters->push_back((unsigned)(out / 3));
+		}
+		fan = next;
+	}
+}
+
+void OptimizeOverdraw(unsigned *dst, const unsigned *indices, size_t index_count, const float *positions, size_t vertex_count,
+	size_t stride, const std::vector<unsigned> &clusters, float threshold, unsigned cache_size)
+{
+	size_t triangle_count = index_count / 3;
+	if (triangle_count == 0) return;
+
+	// hard boundaries, then soft ones where the running ACMR comes within threshold of the cluster's
+	std::vector<unsigned> hard;
+	for (unsigned c : clusters){
+		if (c < triangle_count && (hard.empty() || hard.back() < c)) hard.push_back(c);
+	}
+	if (hard.empty() || hard[0] != 0) hard.insert(hard.begin(), 0);
+	hard.push_back((unsigned)triangle_count);
+
+	std::vector<unsigned> starts;
+	FifoCache cache(vertex_count, cache_size);
+	for (size_t h = 0; h + 1 < hard.size(); h++){
+		unsigned a = hard[h], b = hard[h + 1];
+		cache.reset();
+		unsigned misses = 0;
+		for (unsigned t = a; t < b; t++) misses += triangleMisses(cache, indices + t * 3);
+		float acmr = (float)misses / (b - a);
+
+		cache.reset();
+		starts.push_back(a);
+		unsigned start = a, running = 0;
+		for (unsigned t = a; t < b; t++){
+			running += triangleMisses(cache, indices + t * 3);
+			if (t + 1 < b && (float)running <= threshold * acmr * (t + 1 - start)){
+				start = t + 1;
+				starts.push_back(start);
+				running = 0;
+				cache.reset();
+			}
+		}
+	}
+	starts.push_back((unsigned)triangle_count);
+
+	// outward facing clusters, away from the centre, draw first
+	float centre[3] = { 0, 0, 0 };
+	float total_area = 0;
+	struct CLUSTER
+	{
+		unsigned start, end;
+		float    centroid[3];
+		float    normal[3];
+		float    area;
+		float    key;
+	};
+	std::vector<CLUSTER> list(starts.size() - 1);
+	for (size_t c = 0; c + 1 < starts.size(); c++){
+		CLUSTER &cl = list[c];
+		memset(&cl, 0, sizeof(cl));
+		cl.start = starts[c];
+		cl.end = starts[c + 1];
+		for (unsigned t = cl.start; t < cl.end; t++){
+			float p0[3], p1[3], p2[3];
+			position(p0, positions, stride, indices[t * 3]);
+			position(p1, positions, stride, indices[t * 3 + 1]);
+			position(p2, positions, stride, indices[t * 3 + 2]);
+			float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			for (int k = 0; k < 3; k++){
+				cl.centroid[k] += (p0[k] + p1[k] + p2[k]) / 3.0f * area;
+				cl.normal[k] += n[k];
+			}
+			cl.area += area;
+		}
+		for (int k = 0; k < 3; k++) centre[k] += cl.centroid[k];
+		total_area += cl.area;
+	}
+	for (int k = 0; k < 3; k++) centre[k] = (0.0f < total_area) ? centre[k] / total_area : 0.0f;
+
+	for (CLUSTER &cl : list){
+		float length = sqrtf(cl.normal[0] * cl.normal[0] + cl.normal[1] * cl.normal[1] + cl.normal[2] * cl.normal[2]);
+		cl.key = 0.0f;
+		if (0.0f < cl.area && 0.0f < length){
+			for (int k = 0; k < 3; k++) cl.key += (cl.centroid[k] / cl.area - centre[k]) * cl.normal[k] / length;
+		}
+	}
+	std::stable_sort(list.begin(), list.end(), [](const CLUSTER &a, const CLUSTER &b){ return a.key > b.key; });
+
+	size_t out = 0;
+	for (const CLUSTER &cl : list){
+		memcpy(dst + out, indices + cl.start * 3, (cl.end - cl.start) * 3 * sizeof(unsigned));
+		out += (cl.end - cl.start) * 3;
+	}
+}
+
+MESH_ORDER::ID OptimizeMeshOrder(unsigned *dst, const unsigned *indices, size_t index_count, const float *positions, size_t vertex_count,
+	size_t stride, unsigned cache_size)
+{
+	std::vector<unsigned> best(indices, indices + index_count), candidate(index_count), cached(index_count), clusters;
+	ORDER_COST best_cost = orderCost(indices, index_count, positions, vertex_count, stride, cache_size);
+	MESH_ORDER::ID kept = MESH_ORDER::INPUT;
+	OptimizeVertexCacheTipsify(cached.data(), indices, index_count, vertex_count, cache_size, &clusters);
+
+	for (int o = MESH_ORDER::TIPSIFY_OVERDRAW; o < MESH_ORDER::MAX; o++){
+		switch (o){
+		case MESH_ORDER::TIPSIFY_OVERDRAW:
+			if (!positions) continue;
+			OptimizeOverdraw(candidate.data(), cached.data(), index_count, positions, vertex_count, stride, clusters, 1.05f, cache_size);
+			break;
+		case MESH_ORDER::TIPSIFY:
+			candidate = cached;
+			break;
+		default:
+			OptimizeVertexCacheForsyth(candidate.data(), indices, index_count, vertex_count);
+			break;
+		}
+		ORDER_COST cost = orderCost(candidate.data(), index_count, positions, vertex_count, stride, cache_size, best_cost.transformed);
+		if (cost.transformed <= best_cost.transformed && cost.beats(best_cost)){
+			best.swap(candidate);
+			best_cost = cost;
+			kept = (MESH_ORDER::ID)o;
+		}
+	}
+	std::copy(best.begin(), best.end(), dst);
+	return kept;
+}
+
+size_t OptimizeVertexFetchRemap(unsigned *remap, const unsigned *indices, size_t index_count, size_t vertex_count)
+{
+	std::fill(remap, remap + vertex_count, ~0u);
+	unsigned next = 0;
+	for (size_t i = 0; i < index_count; i++){
+		unsigned &r = remap[indices[i]];
+		if (r == ~0u) r = next++;
+	}
+	size_t referenced = next;
+	for (size_t v = 0; v < vertex_count; v++){
+		if (remap[v] == ~0u) remap[v] = next++;
+	}
+	return referenced;
+}
+
+void RemapIndices(unsigned *dst, const unsigned *indices, size_t index_count, const unsigned *remap)
+{
+	for (size_t i = 0; i < index_count; i++) dst[i] = remap[indices[i]];
+}
+
+void RemapVertices(void *dst, const void *src, size_t vertex_count, size_t stride, const unsigned *remap)
+{
+	for (size_t v = 0; v < vertex_count; v++){
+		memcpy((char*)dst + (size_t)remap[v] * stride, (const char*)src + v * stride, stride);
+	}
+}
+
+}// namespace tpot
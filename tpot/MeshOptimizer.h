@@ -0,0 +1,85 @@
+#ifndef TPOT_MESH_OPTIMIZER_H__
+#define TPOT_MESH_OPTIMIZER_H__
+
+#include <stddef.h>
+#include <vector>
+
+namespace tpot
+{
+
+	// Triangle list reordering for the post-transform vertex cache, overdraw
+	// and vertex fetch, with the statistics to judge them. Indices are
+	// unsigned and below vertex_count; positions are three floats at the
+	// start of every stride bytes. dst may not alias the source indices.
+
+	struct VCACHE_STATS
+	{
+		unsigned triangles;
+		unsigned vertices;		// referenced
+		unsigned transformed;	// post-transform cache misses
+		float    acmr;			// transformed per triangle, 0.5 at best on a large grid
+		float    atvr;			// transformed per referenced vertex, 1 at best
+	};
+	// FIFO cache of cache_size entries, as most hardware since D3D10
+	VCACHE_STATS AnalyzeVertexCache(const unsigned *indices, size_t index_count, size_t vertex_count, unsigned cache_size = 16);
+
+	struct OVERDRAW_STATS
+	{
+		unsigned long long covered;	// pixels with at least one triangle
+		unsigned long long shaded;	// pixels passing the depth test in draw order
+		float              overdraw;	// shaded per covered, 1 at best
+	};
+	// Software raster of the six axis views, depth LESS, counter clockwise
+	// back faces culled as D3D11's default rasterizer state does
+	OVERDRAW_STATS AnalyzeOverdraw(const unsigned *indices, size_t index_count, const float *positions, size_t vertex_count, size_t stride);
+
+	struct VFETCH_STATS
+	{
+		unsigned long long bytes_fetched;	// whole cache lines
+		float              overfetch;		// fetched per referenced vertex byte, 1 at best
+	};
+	// Fetches of the vertex cache misses through a 16 KB direct mapped cache of 64 byte lines
+	VFETCH_STATS AnalyzeVertexFetch(const unsigned *indices, size_t index_count, size_t vertex_count, size_t vertex_size);
+
+	// Forsyth's linear speed vertex cache optimisation, an LRU cache of 32
+	void OptimizeVertexCacheForsyth(unsigned *dst, const unsigned *indices, size_t index_count, size_t vertex_count);
+
+	// Tipsify (Sander, Nehab, Barczak 2007) for a FIFO of cache_size.
+	// clusters, when given, gets the first triangle of every run that
+	// starts with a cold cache: the hard boundaries OptimizeOverdraw keeps.
+	void OptimizeVertexCacheTipsify(unsigned *dst, const unsigned *indices, size_t index_count, size_t vertex_count,
+		unsigned cache_size = 16, std::vector<unsigned> *clusters = nullptr);
+
+	// Splits the cache ordered list at clusters and again where the local
+	// ACMR stays within threshold of the cluster's, then draws outward
+	// facing clusters first so they occlude the rest. Cache order within a
+	// cluster is kept.
+	void OptimizeOverdraw(unsigned *dst, const unsigned *indices, size_t index_count, const float *positions, size_t vertex_count,
+		size_t stride, const std::vector<unsigned> &clusters, float threshold = 1.05f, unsigned cache_size = 16);
+
+	struct MESH_ORDER{
+		enum ID
+		{
+			INPUT,
+			TIPSIFY_OVERDRAW,
+			TIPSIFY,
+			FORSYTH,
+
+			MAX,
+		};
+	};
+	// Tries the orders after INPUT in turn and keeps one only where it
+	// beats the order kept so far: no worse on the FIFO misses and the
+	// overdraw, better on one. Without positions (nullptr) the misses
+	// alone decide and TIPSIFY_OVERDRAW is skipped. Returns the order kept.
+	MESH_ORDER::ID OptimizeMeshOrder(unsigned *dst, const unsigned *indices, size_t index_count, const float *positions, size_t vertex_count,
+		size_t stride, unsigned cache_size = 16);
+
+	// New vertex ids in first use order, unreferenced vertices last.
+	// remap has vertex_count entries; returns the referenced count.
+	size_t OptimizeVertexFetchRemap(unsigned *remap, const unsigned *indices, size_t index_count, size_t vertex_count);
+	void RemapIndices(unsigned *dst, const unsigned *indices, size_t index_count, const unsigned *remap);
+	void RemapVertices(void *dst, const void *src, size_t vertex_count, size_t stride, const unsigned *remap);
+
+}// namespace tpot
+#endif // TPOT_MESH_OPTIMIZER_H__
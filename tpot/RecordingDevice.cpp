@@ -0,0 +1,416 @@
+#include <string.h>
+#include "RecordingDevice.h"
+
+namespace tpot
+{
+
+namespace
+{
+	const UINT ARG_MAX = 0xffffff;
+
+	// as RenderTargets
+	UINT scaled(UINT size, float scale)
+	{
+		UINT s = (UINT)((float)size * scale + 0.5f);
+		return (s < 1) ? 1 : s;
+	}
+
+	// fixed payload sizes, UNMAP carries its own
+	const UINT PAYLOAD_SIZE[COMMAND::MAX] = {
+		2,	// RESIZE
+		0,	// RELEASE
+		4,	// CREATE_RENDER_TARGET
+		1,	// SET_SCALE
+		0,	// SET_RENDER_TARGET
+		0,	// PUSH_RENDER_TARGET
+		0,	// POP_RENDER_TARGET
+		1,	// CLEAR
+		1,	// CLEAR_DEPTH
+		0,	// CREATE_MESH
+		1,	// SET_TEXTURE
+		0,	// DRAW
+		0,	// SET_RASTERIZER
+		0,	// SET_SAMPLER
+		0,	// SET_DEPTH
+		0,	// SET_VS
+		0,	// SET_HS
+		0,	// SET_DS
+		0,	// SET_GS
+		0,	// SET_PS
+		0,	// DISABLE
+		1,	// SET_CB
+		1,	// MAP
+		0,	// UNMAP
+		0,	// SET_INPUT_LAYOUT
+		2,	// BEGIN_FRAME
+		1,	// SET_FORMAT
+		0,	// SET_PRESENT_TARGET
+		0,	// SET_CS
+		2,	// DISPATCH
+	};
+}// namespace
+
+const char *COMMAND::name(COMMAND::ID id)
+{
+	static const char *names[COMMAND::MAX] = {
+		"resize",
+		"release",
+		"create_render_target",
+		"set_scale",
+		"set_render_target",
+		"push_render_target",
+		"pop_render_target",
+		"clear",
+		"clear_depth",
+		"create_mesh",
+		"set_texture",
+		"draw",
+		"set_rasterizer",
+		"set_sampler",
+		"set_depth",
+		"set_vs",
+		"set_hs",
+		"set_ds",
+		"set_gs",
+		"set_ps",
+		"disable",
+		"set_cb",
+		"map",
+		"unmap",
+		"set_input_layout",
+		"begin_frame",
+		"set_format",
+		"set_present_target",
+		"set_cs",
+		"dispatch",
+	};
+	return (id < COMMAND::MAX) ? names[id] : "unknown";
+}
+
+RecordingDevice::RecordingDevice(UINT ring_size)
+	: pool_([](unsigned, const RT_SURFACE_DESC &){}, [](unsigned){})
+	, nMesh_(0), vs_current_(VS::MAX), ring_(ring_size), fence_(1), waits_(0)
+{
+	for (auto &x : cb_offset_) x = ~0u;
+	reset();
+}
+
+RecordingDevice::~RecordingDevice()
+{
+}
+
+void RecordingDevice::reset()
+{
+	stream_.clear();
+	memset(count_, 0, sizeof(count_));
+}
+
+void RecordingDevice::record(COMMAND::ID id, UINT arg)
+{
+	if (ARG_MAX < arg) arg = ARG_MAX;
+	stream_.push_back((arg << 8) | (UINT)id);
+	count_[id]++;
+}
+
+void RecordingDevice::payload(float v)
+{
+	UINT u;
+	memcpy(&u, &v, sizeof(u));
+	stream_.push_back(u);
+}
+
+bool RecordingDevice::read(size_t *pos, RECORD *record) const
+{
+	if (stream_.size() <= *pos) return false;
+
+	UINT word = stream_[*pos];
+	record->id = (COMMAND::ID)(word & 0xff);
+	record->arg = word >> 8;
+	if (record->arg == ARG_MAX) record->arg = ~0u;
+	if (COMMAND::MAX <= record->id) return false;
+
+	record->payload_size = (record->id == COMMAND::UNMAP) ? record->arg : PAYLOAD_SIZE[record->id];
+	if (stream_.size() < *pos + 1 + record->payload_size) return false;
+	record->payload = record->payload_size ? &stream_[*pos + 1] : nullptr;
+
+	*pos += 1 + record->payload_size;
+	return true;
+}
+
+UploadRing::STATS RecordingDevice::takeRingStats(UINT *waits)
+{
+	if (waits) *waits = waits_;
+	waits_ = 0;
+	return ring_.takeStats();
+}
+
+void RecordingDevice::beginFrame()
+{
+	UploadRing::FENCE completed = (LATENCY < fence_) ? fence_ - LATENCY : 0;
+	ring_.endFrame(fence_);
+	ring_.retire(completed);
+
+	record(COMMAND::BEGIN_FRAME);
+	payload((UINT)fence_);
+	payload((UINT)completed);
+	fence_++;
+
+	pool_.tick();
+}
+
+void RecordingDevice::endFrame()
+{
+}
+
+bool RecordingDevice::getGpuTime(float *)
+{
+	return false;	// nothing runs
+}
+
+void RecordingDevice::ResizedSwapChain(UINT width, UINT height)
+{
+	record(COMMAND::RESIZE);
+	payload(width);
+	payload(height);
+
+	for (UINT id = 0; id < aRT_.size(); id++){
+		RT &rt = aRT_[id];
+		switch (rt.type){
+		case RENDER_TARGET::DEPTH:
+		case RENDER_TARGET::HDR_SCREEN:
+			rt.width = width;
+			rt.height = height;
+			resize(id);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+void RecordingDevice::ReleasingSwapChain()
+{
+	record(COMMAND::RELEASE);
+}
+
+UINT RecordingDevice::createRenderTarget(RENDER_TARGET::TYPE type, UINT width, UINT height, float scale, RENDER_TARGET::FORMAT format)
+{
+	record(COMMAND::CREATE_RENDER_TARGET, type);
+	payload(width);
+	payload(height);
+	payload(scale);
+	payload((UINT)format);
+
+	RT rt = { type, width, height, scale, format };
+	aRT_.push_back(rt);
+	return pool_.create(format, 0, scaled(width, scale), scaled(height, scale));
+}
+
+void RecordingDevice::resize(UINT id)
+{
+	const RT &rt = aRT_[id];
+	pool_.resize(id, scaled(rt.width, rt.scale), scaled(rt.height, rt.scale));
+}
+
+void RecordingDevice::setScale(UINT id, float scale)
+{
+	if (aRT_[id].scale == scale) return; // as RenderTargets::setScale
+	aRT_[id].scale = scale;
+	resize(id);
+
+	record(COMMAND::SET_SCALE, id);
+	payload(scale);
+}
+
+void RecordingDevice::setFormat(UINT id, RENDER_TARGET::FORMAT format)
+{
+	if (aRT_[id].format == format) return;
+	aRT_[id].format = format;
+	pool_.setFormat(id, format);
+
+	record(COMMAND::SET_FORMAT, id);
+	payload((UINT)format);
+}
+
+void RecordingDevice::getSize(UINT id, UINT *width, UINT *height)
+{
+	*width = pool_.width(id);
+	*height = pool_.height(id);
+}
+
+void RecordingDevice::getTextureSize(UINT id, UINT *width, UINT *height)
+{
+	const RT_SURFACE_DESC &desc = pool_.desc(pool_.surface(id));
+	*width = desc.width;
+	*height = desc.height;
+}
+
+unsigned long long RecordingDevice::getBytes(UINT id)
+{
+	const RT_SURFACE_DESC &desc = pool_.desc(pool_.surface(id));
+	return RENDER_TARGET::bytes((RENDER_TARGET::FORMAT)desc.format, desc.width, desc.height);
+}
+
+UINT RecordingDevice::getGeneration(UINT id)
+{
+	return pool_.generation(id);
+}
+
+unsigned long long RecordingDevice::getTotalBytes()
+{
+	unsigned long long bytes = 0;
+	for (UINT i = 0; i < pool_.surfaceSlots(); i++){
+		const RT_SURFACE_DESC &desc = pool_.desc(i);
+		if (pool_.alive(i)) bytes += RENDER_TARGET::bytes((RENDER_TARGET::FORMAT)desc.format, desc.width, desc.height);
+	}
+	return bytes;
+}
+
+void RecordingDevice::setRenderTarget(UINT id)
+{
+	record(COMMAND::SET_RENDER_TARGET, id);
+}
+
+void RecordingDevice::pushRenderTarget()
+{
+	record(COMMAND::PUSH_RENDER_TARGET);
+}
+
+void RecordingDevice::popRenderTarget()
+{
+	record(COMMAND::POP_RENDER_TARGET);
+}
+
+void RecordingDevice::setPresentTarget(UINT id)
+{
+	record(COMMAND::SET_PRESENT_TARGET, id);
+}
+
+void RecordingDevice::Clear(UINT color)
+{
+	record(COMMAND::CLEAR);
+	payload(color);
+}
+
+void RecordingDevice::ClearDepth(float depth)
+{
+	record(COMMAND::CLEAR_DEPTH);
+	payload(depth);
+}
+
+UINT RecordingDevice::createMesh(MESH_TYPE type, void *)
+{
+	record(COMMAND::CREATE_MESH, type);
+	return nMesh_++;
+}
+
+bool RecordingDevice::isMeshReady(UINT mesh)
+{
+	return mesh < nMesh_ && !(mesh < loading_.size() && loading_[mesh]);
+}
+
+void RecordingDevice::setLoading(UINT mesh, bool loading)
+{
+	if (loading_.size() <= mesh) loading_.resize(mesh + 1, false);
+	loading_[mesh] = loading;
+}
+
+void RecordingDevice::setTexture(UINT slot, UINT id)
+{
+	record(COMMAND::SET_TEXTURE, slot);
+	payload(id);
+}
+
+void RecordingDevice::setInputLayout(VS::ID id)
+{
+	record(COMMAND::SET_INPUT_LAYOUT, id);
+}
+
+void RecordingDevice::Draw(UINT mesh)
+{
+	record(COMMAND::DRAW, mesh);
+}
+
+void RecordingDevice::set(RASTERIZER_STATE::ID id)
+{
+	record(COMMAND::SET_RASTERIZER, id);
+}
+void RecordingDevice::set(UINT slot, SAMPLER_STATE::ID id)
+{
+	record(COMMAND::SET_SAMPLER, (slot << 8) | id);
+}
+void RecordingDevice::set(DEPTH_STATE::ID id)
+{
+	record(COMMAND::SET_DEPTH, id);
+}
+void RecordingDevice::set(VS::ID id)
+{
+	vs_current_ = id;
+	record(COMMAND::SET_VS, id);
+}
+void RecordingDevice::set(HS::ID id)
+{
+	record(COMMAND::SET_HS, id);
+}
+void RecordingDevice::set(DS::ID id)
+{
+	record(COMMAND::SET_DS, id);
+}
+void RecordingDevice::set(GS::ID id)
+{
+	record(COMMAND::SET_GS, id);
+}
+void RecordingDevice::set(PS::ID id)
+{
+	record(COMMAND::SET_PS, id);
+}
+void RecordingDevice::set(CS::ID id)
+{
+	record(COMMAND::SET_CS, id);
+}
+void RecordingDevice::disable(STAGE::ID stage)
+{
+	record(COMMAND::DISABLE, stage);
+}
+
+void RecordingDevice::Dispatch(UINT id, UINT groups_x, UINT groups_y)
+{
+	record(COMMAND::DISPATCH, id);
+	payload(groups_x);
+	payload(groups_y);
+}
+
+void RecordingDevice::setCB(STAGE::ID stage)
+{
+	record(COMMAND::SET_CB, stage);
+	payload((vs_current_ < VS::MAX) ? cb_offset_[vs_current_] : ~0u);
+}
+
+void *RecordingDevice::Map()
+{
+	UINT size = (vs_current_ < VS::MAX) ? VS::getCBSize(vs_current_) : 0;
+	UINT offset = ~0u;
+	if (size){
+		offset = ring_.allocate(size);
+		while (offset == ~0u && ring_.framesInFlight()){
+			// D3D11Device spins on the oldest event query here
+			ring_.retire(ring_.oldestFence());
+			waits_++;
+			offset = ring_.allocate(size);
+		}
+		cb_offset_[vs_current_] = offset;
+	}
+	record(COMMAND::MAP);
+	payload(offset);
+
+	cb_.assign((size + sizeof(UINT) - 1) / sizeof(UINT), 0);
+	return cb_.empty() ? nullptr : &cb_[0];
+}
+
+void RecordingDevice::UmMap()
+{
+	record(COMMAND::UNMAP, (UINT)cb_.size());
+	stream_.insert(stream_.end(), cb_.begin(), cb_.end());
+}
+
+}// namespace tpot
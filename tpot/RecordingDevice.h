@@ -0,0 +1,169 @@
+#ifndef TPOT_RECORDING_DEVICE_H__
+#define TPOT_RECORDING_DEVICE_H__
+
+#include <vector>
+#include "device.h"
+#include "UploadRing.h"
+#include "RenderTargetPool.h"
+
+namespace tpot
+{
+	struct COMMAND{
+		enum ID
+		{
+			RESIZE,				// payload: width, height
+			RELEASE,
+			CREATE_RENDER_TARGET,	// arg: type; payload: width, height, scale, format
+			SET_SCALE,			// arg: id; payload: scale
+			SET_RENDER_TARGET,	// arg: id
+			PUSH_RENDER_TARGET,
+			POP_RENDER_TARGET,
+			CLEAR,				// payload: color
+			CLEAR_DEPTH,		// payload: depth
+			CREATE_MESH,		// arg: type
+			SET_TEXTURE,		// arg: slot; payload: id
+			DRAW,				// arg: mesh
+			SET_RASTERIZER,		// arg: id
+			SET_SAMPLER,		// arg: slot << 8 | id
+			SET_DEPTH,			// arg: id
+			SET_VS,				// arg: id
+			SET_HS,
+			SET_DS,
+			SET_GS,
+			SET_PS,
+			DISABLE,			// arg: stage
+			SET_CB,				// arg: stage; payload: ring offset
+			MAP,				// payload: ring offset
+			UNMAP,				// arg: payload size; payload: the constant buffer
+			SET_INPUT_LAYOUT,	// arg: VS id
+			BEGIN_FRAME,		// payload: fence of the frame before, completed fence
+			SET_FORMAT,			// arg: id; payload: format
+			SET_PRESENT_TARGET,	// arg: UAV id
+			SET_CS,				// arg: id
+			DISPATCH,			// arg: UAV id; payload: groups x, y
+
+			MAX,
+		};
+
+		static const char *name(COMMAND::ID id);
+	};
+
+	// One decoded command. Ids that do not fit the 24 bit arg (~0) read back as ~0.
+	struct RECORD
+	{
+		COMMAND::ID id;
+		UINT        arg;
+		const UINT  *payload;	// floats are stored by bit pattern
+		UINT        payload_size;	// in UINTs
+	};
+
+	// Null backend: nothing is drawn, every call is appended to a command
+	// stream of 32 bit words, (arg << 8 | command) then the payload.
+	// Render target sizes follow the same rules as RenderTargets so frame
+	// code reads back what it would get on D3D11, and constant data goes
+	// through an UploadRing whose fences complete LATENCY frames late.
+	class RecordingDevice : public Device
+	{
+	public:
+		enum{
+			RING_SIZE = 64 * 1024,
+			LATENCY = 2,	// frames the simulated GPU runs behind
+		};
+
+	private:
+		struct RT
+		{
+			RENDER_TARGET::TYPE type;
+			UINT  width;
+			UINT  height;
+			float scale;
+			RENDER_TARGET::FORMAT format;
+		};
+
+		std::vector<UINT> stream_;
+		std::vector<RT>   aRT_;
+		RenderTargetPool  pool_;	// no textures, the sizes only
+		UINT              nMesh_;
+		std::vector<bool> loading_;	// by mesh, setLoading
+		UINT              count_[COMMAND::MAX];
+		VS::ID            vs_current_;
+		std::vector<UINT> cb_;	// the mapped constant buffer
+		UploadRing        ring_;
+		UploadRing::FENCE fence_;	// of the frame being recorded
+		UINT              cb_offset_[VS::MAX];	// latest allocation per VS
+		UINT              waits_;
+
+		void record(COMMAND::ID id, UINT arg = 0);
+		void payload(UINT v){ stream_.push_back(v); }
+		void payload(float v);
+		void resize(UINT id);
+
+	public:
+		explicit RecordingDevice(UINT ring_size = RING_SIZE);
+		~RecordingDevice();
+
+		// recorded stream
+		const std::vector<UINT> &stream() const { return stream_; }
+		size_t size() const { return stream_.size() * sizeof(UINT); } // bytes
+		UINT count(COMMAND::ID id) const { return count_[id]; }
+		void reset(); // drops the stream and the counts, resources are kept
+
+		// Constant data since the last call; waits: allocations that had to wait for a fence
+		UploadRing::STATS takeRingStats(UINT *waits);
+		// Render target surfaces since the last call
+		RenderTargetPool::STATS takePoolStats(){ return pool_.takeStats(); }
+		const RenderTargetPool &pool() const { return pool_; }
+
+		// isMeshReady is false until cleared, as for a TMesh still loading
+		void setLoading(UINT mesh, bool loading);
+
+		// Decodes the command at *pos and advances it; false at the end
+		bool read(size_t *pos, RECORD *record) const;
+
+		void beginFrame();
+		void endFrame();
+		bool getGpuTime(float *ms);
+		void ResizedSwapChain(UINT width, UINT height);
+		void ReleasingSwapChain();
+
+		UINT createRenderTarget(RENDER_TARGET::TYPE type, UINT width, UINT height, float scale, RENDER_TARGET::FORMAT format);
+		void setScale(UINT id, float scale);
+		void setFormat(UINT id, RENDER_TARGET::FORMAT format);
+		void getSize(UINT id, UINT *width, UINT *height);
+		void getTextureSize(UINT id, UINT *width, UINT *height);
+		unsigned long long getBytes(UINT id);
+		UINT getGeneration(UINT id);
+		unsigned long long getTotalBytes();
+		void setRenderTarget(UINT id);
+		void pushRenderTarget();
+		void popRenderTarget();
+		void setPresentTarget(UINT id);
+
+		void Clear(UINT color);
+		void ClearDepth(float depth);
+
+		UINT createMesh(MESH_TYPE type, void *param);
+		bool isMeshReady(UINT mesh);
+		void setTexture(UINT slot, UINT id);
+		void setInputLayout(VS::ID id);
+		void Draw(UINT mesh);
+
+		void set(RASTERIZER_STATE::ID id);
+		void set(UINT slot, SAMPLER_STATE::ID id);
+		void set(DEPTH_STATE::ID id);
+		void set(VS::ID id);
+		void set(HS::ID id);
+		void set(DS::ID id);
+		void set(GS::ID id);
+		void set(PS::ID id);
+		void set(CS::ID id);
+		void disable(STAGE::ID stage);
+		void Dispatch(UINT id, UINT groups_x, UINT groups_y);
+
+		void setCB(STAGE::ID stage);
+		void *Map();
+		void UmMap();
+	};
+
+}// namespace tpot
+#endif // TPOT_RECORDING_DEVICE_H__
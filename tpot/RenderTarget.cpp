@@ -3,7 +3,49 @@
 
 namespace tpot
 {
-	Texture::Texture(ID3D11Device *pd3dDevice, TEX::TYPE type, UINT width, UINT height)
+	namespace
+	{
+		struct DXGI_FORMATS
+		{
+			DXGI_FORMAT texture;	// typeless for depth, so it can also be sampled
+			DXGI_FORMAT view;		// RTV or DSV
+			DXGI_FORMAT srv;
+		};
+
+		const DXGI_FORMATS FORMATS[RENDER_TARGET::FORMAT_MAX] = {
+			{ DXGI_FORMAT_R32G32B32A32_FLOAT, DXGI_FORMAT_R32G32B32A32_FLOAT, DXGI_FORMAT_R32G32B32A32_FLOAT },
+			{ DXGI_FORMAT_R16G16B16A16_FLOAT, DXGI_FORMAT_R16G16B16A16_FLOAT, DXGI_FORMAT_R16G16B16A16_FLOAT },
+			{ DXGI_FORMAT_R11G11B10_FLOAT, DXGI_FORMAT_R11G11B10_FLOAT, DXGI_FORMAT_R11G11B10_FLOAT },
+			{ DXGI_FORMAT_R10G10B10A2_UNORM, DXGI_FORMAT_R10G10B10A2_UNORM, DXGI_FORMAT_R10G10B10A2_UNORM },
+			{ DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_R8G8B8A8_UNORM },
+			{ DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, DXGI_FORMAT_R8G8B8A8_UNORM_SRGB },
+			{ DXGI_FORMAT_R24G8_TYPELESS, DXGI_FORMAT_D24_UNORM_S8_UINT, DXGI_FORMAT_R24_UNORM_X8_TYPELESS },
+			{ DXGI_FORMAT_R32_TYPELESS, DXGI_FORMAT_D32_FLOAT, DXGI_FORMAT_R32_FLOAT },
+		};
+
+		UINT bindFlags(RENDER_TARGET::FORMAT format)
+		{
+			if (RENDER_TARGET::isDepth(format)) return D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_DEPTH_STENCIL;
+			UINT flags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+			if (RENDER_TARGET::unorderedAccess(format)) flags |= D3D11_BIND_UNORDERED_ACCESS;// fused TAA present
+			return flags;
+		}
+
+		// Binds the colour target with no UAV once one was set
+		void setTargets(ID3D11DeviceContext *pd3dImmediateContext, ID3D11RenderTargetView *pRTV, ID3D11DepthStencilView *pDSV, ID3D11UnorderedAccessView **ppUAV)
+		{
+			ID3D11RenderTargetView* aRTViews[1] = { pRTV };
+			if (*ppUAV == nullptr){
+				pd3dImmediateContext->OMSetRenderTargets(1, aRTViews, pDSV);
+				return;
+			}
+			ID3D11UnorderedAccessView* aUAViews[1] = { nullptr };
+			pd3dImmediateContext->OMSetRenderTargetsAndUnorderedAccessViews(1, aRTViews, pDSV, 1, 1, aUAViews, nullptr);
+			*ppUAV = nullptr;
+		}
+	}// namespace
+
+	Texture::Texture(ID3D11Device *pd3dDevice, RENDER_TARGET::FORMAT format, UINT width, UINT height)
 	{
 		D3D11_TEXTURE2D_DESC Desc;
 		ZeroMemory(&Desc, sizeof(D3D11_TEXTURE2D_DESC));
@@ -13,28 +55,13 @@ namespace tpot
 		Desc.Height = height;
 		Desc.Width = width;
 		Desc.Usage = D3D11_USAGE_DEFAULT;
-
-		char *name = nullptr;
-		
-		switch (type){
-		case TEX::RGBA32:
-			// Desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-			Desc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-			Desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-			name = "TEX::RGBA32";
-			break;
-
-		case TEX::DEPTH:
-			Desc.Format = DXGI_FORMAT_R24G8_TYPELESS;
-			Desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_DEPTH_STENCIL;
-			name = "TEX::DEPTH";
-			break;
-		}
+		Desc.Format = FORMATS[format].texture;
+		Desc.BindFlags = bindFlags(format);
 
 		HRESULT hr;
 		V(pd3dDevice->CreateTexture2D(&Desc, nullptr, &pTex_));
 
-		DXUT_SetDebugName(pTex_, name);
+		DXUT_SetDebugName(pTex_, RENDER_TARGET::name(format));
 	}
 	Texture::~Texture()
 	{
@@ -47,12 +74,12 @@ namespace tpot
 		pDSView_ = pDS_View;
 	}
 
-	DepthStencilView::DepthStencilView(ID3D11Device *pd3dDevice, DS_VIEW::TYPE type, ID3D11Resource *pResource)
+	DepthStencilView::DepthStencilView(ID3D11Device *pd3dDevice, RENDER_TARGET::FORMAT format, ID3D11Resource *pResource)
 		: mustRelease(true)
 	{
 		D3D11_DEPTH_STENCIL_VIEW_DESC Desc;
 		ZeroMemory(&Desc, sizeof(D3D11_DEPTH_STENCIL_VIEW_DESC));
-		Desc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+		Desc.Format = FORMATS[format].view;
 		Desc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
 		Desc.Texture2D.MipSlice = 0;
 
@@ -71,22 +98,13 @@ namespace tpot
 		}
 	}
 
-	ShaderResourceView::ShaderResourceView(ID3D11Device *pd3dDevice, SR_VIEW::TYPE type, ID3D11Resource *pResource)
+	ShaderResourceView::ShaderResourceView(ID3D11Device *pd3dDevice, RENDER_TARGET::FORMAT format, ID3D11Resource *pResource)
 	{
 		D3D11_SHADER_RESOURCE_VIEW_DESC Desc;
 		ZeroMemory(&Desc, sizeof(D3D11_SHADER_RESOURCE_VIEW_DESC));
 		Desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
 		Desc.Texture2D.MipLevels = 1;
-
-		switch (type){
-		case SR_VIEW::RGBA32:
-			// Desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-			Desc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-			break;
-		case SR_VIEW::DEPTH:
-			Desc.Format = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
-			break;
-		}
+		Desc.Format = FORMATS[format].srv;
 
 		HRESULT hr;
 		V(pd3dDevice->CreateShaderResourceView( pResource, &Desc, &pSRView_));
@@ -97,18 +115,12 @@ namespace tpot
 		SAFE_RELEASE(pSRView_);
 	}
 
-	RenderTargetView::RenderTargetView(ID3D11Device *pd3dDevice, RT_VIEW::TYPE type, ID3D11Resource *pResource)
+	RenderTargetView::RenderTargetView(ID3D11Device *pd3dDevice, RENDER_TARGET::FORMAT format, ID3D11Resource *pResource)
 	{
 		D3D11_RENDER_TARGET_VIEW_DESC Desc;
 		ZeroMemory(&Desc, sizeof(D3D11_RENDER_TARGET_VIEW_DESC));
 		Desc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-
-		switch (type){
-		case RT_VIEW::RGBA32:
-			// Desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-			Desc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-			break;
-		}
+		Desc.Format = FORMATS[format].view;
 
 		HRESULT hr;
 		V(pd3dDevice->CreateRenderTargetView(
@@ -123,36 +135,54 @@ namespace tpot
 		SAFE_RELEASE(pRTView_);
 	}
 
-	void RenderTarget::create(ID3D11Device *pd3dDevice, RENDER_TARGET::TYPE type, UINT width, UINT height)
+	UnorderedAccessView::UnorderedAccessView(ID3D11Device *pd3dDevice, RENDER_TARGET::FORMAT format, ID3D11Resource *pResource)
+	{
+		D3D11_UNORDERED_ACCESS_VIEW_DESC Desc;
+		ZeroMemory(&Desc, sizeof(D3D11_UNORDERED_ACCESS_VIEW_DESC));
+		Desc.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D;
+		Desc.Format = FORMATS[format].view;
+
+		HRESULT hr;
+		V(pd3dDevice->CreateUnorderedAccessView(pResource, &Desc, &pUAView_));
+	}
+
+	UnorderedAccessView::~UnorderedAccessView()
 	{
-		switch (type){
+		SAFE_RELEASE(pUAView_);
+	}
+
+	void RenderTarget::create(ID3D11Device *pd3dDevice)
+	{
+		pTex_ = new Texture(pd3dDevice, format_, width_, height_);
+		pSR_View_ = new ShaderResourceView(pd3dDevice, format_, pTex_->get());
+		pUA_View_ = RENDER_TARGET::unorderedAccess(format_) ? new UnorderedAccessView(pd3dDevice, format_, pTex_->get()) : nullptr;
+
+		switch (type_){
 		case RENDER_TARGET::DEPTH:
-			pTex_ = new Texture(pd3dDevice, TEX::DEPTH, width, height);
-			pDS_View_ = new DepthStencilView(pd3dDevice, DS_VIEW::DEPTH, pTex_->get());
-			pSR_View_ = new ShaderResourceView(pd3dDevice, SR_VIEW::DEPTH, pTex_->get());
+			pDS_View_ = new DepthStencilView(pd3dDevice, format_, pTex_->get());
 			pRT_View_ = nullptr;
 			break;
 
 		case RENDER_TARGET::HDR_SCREEN:
-			pTex_ = new Texture(pd3dDevice, TEX::RGBA32, width, height);
 			pDS_View_ = nullptr;
-			pSR_View_ = new ShaderResourceView(pd3dDevice, SR_VIEW::RGBA32, pTex_->get());
-			pRT_View_ = new RenderTargetView(pd3dDevice, RT_VIEW::RGBA32, pTex_->get());
+			pRT_View_ = new RenderTargetView(pd3dDevice, format_, pTex_->get());
 			break;
 		}
 	}
 	void RenderTarget::release()
 	{
 		SAFE_DELETE(pRT_View_);
+		SAFE_DELETE(pUA_View_);
 		SAFE_DELETE(pSR_View_);
 		SAFE_DELETE(pDS_View_);
 		SAFE_DELETE(pTex_);
 	}
 
-	RenderTarget::RenderTarget(ID3D11Device *pd3dDevice, RENDER_TARGET::TYPE type, UINT width, UINT height)
-		: type_(type)
+	RenderTarget::RenderTarget(ID3D11Device *pd3dDevice, RENDER_TARGET::FORMAT format, UINT width, UINT height)
+		: type_(RENDER_TARGET::isDepth(format) ? RENDER_TARGET::DEPTH : RENDER_TARGET::HDR_SCREEN)
+		, format_(format), width_(width), height_(height)
 	{
-		create(pd3dDevice, type, width, height);
+		create(pd3dDevice);
 	}
 
 	RenderTarget::~RenderTarget()
@@ -160,35 +190,25 @@ namespace tpot
 		release();
 	}
 
-	void RenderTarget::ResizedSwapChain(ID3D11Device* pd3dDevice, const DXGI_SURFACE_DESC* pBackBufferSurfaceDesc)
+	namespace
 	{
-		UINT width = pBackBufferSurfaceDesc->Width;
-		UINT height = pBackBufferSurfaceDesc->Height;
-
-		switch (type_){
-		case RENDER_TARGET::DEPTH:
-			break;
-
-		case RENDER_TARGET::HDR_SCREEN:
-			release();
-			create(pd3dDevice, type_, width, height);
-			break;
-		}
-	}
-
-	void RenderTarget::ReleasingSwapChain(){
-		switch (type_){
-		case RENDER_TARGET::DEPTH:
-			break;
-
-		case RENDER_TARGET::HDR_SCREEN:
-			release();
-			break;
+		UINT scaled(UINT size, float scale)
+		{
+			UINT s = (UINT)((float)size * scale + 0.5f);
+			return (s < 1) ? 1 : s;
 		}
-	}
+	}// namespace
 
 	RenderTargets::RenderTargets(ID3D11Device *pd3dDevice)
-		: pOrigRTV_(nullptr), pOrigDSV_(nullptr)
+		: pool_(
+			[this, pd3dDevice](unsigned surface, const RT_SURFACE_DESC &desc){
+				if (aRT_.size() <= surface) aRT_.resize(surface + 1, nullptr);
+				aRT_[surface] = new RenderTarget(pd3dDevice, (RENDER_TARGET::FORMAT)desc.format, desc.width, desc.height);
+			},
+			[this](unsigned surface){
+				SAFE_DELETE(aRT_[surface]);
+			})
+		, pOrigRTV_(nullptr), pOrigDSV_(nullptr)
 	{
 	}
 
@@ -199,26 +219,90 @@ namespace tpot
 		}
 	}
 
+	void RenderTargets::resize(UINT id)
+	{
+		const TARGET &t = aTarget_[id];
+		pool_.resize(id, scaled(t.width, t.scale), scaled(t.height, t.scale));
+	}
+
+	void RenderTargets::beginFrame()
+	{
+		pool_.tick();
+	}
+
 	void RenderTargets::ResizedSwapChain(ID3D11Device* pd3dDevice, const DXGI_SURFACE_DESC* pBackBufferSurfaceDesc)
 	{
-		for (auto &p : aRT_){
-			p->ResizedSwapChain(pd3dDevice, pBackBufferSurfaceDesc);
+		for (UINT id = 0; id < aTarget_.size(); id++){
+			TARGET &t = aTarget_[id];
+			switch (t.type){
+			case RENDER_TARGET::DEPTH:
+			case RENDER_TARGET::HDR_SCREEN:
+				t.width = pBackBufferSurfaceDesc->Width;
+				t.height = pBackBufferSurfaceDesc->Height;
+				resize(id);
+				break;
+			}
 		}
 	}
 
 	void RenderTargets::ReleasingSwapChain()
 	{
-		for (auto &p : aRT_){
-			p->ReleasingSwapChain();
-		}
+		// the surfaces do not depend on the swap chain, they are kept for ResizedSwapChain
+	}
+
+	UINT RenderTargets::create(ID3D11Device *pd3dDevice, RENDER_TARGET::TYPE type, UINT width, UINT height, float scale, RENDER_TARGET::FORMAT format)
+	{
+		TARGET t = { type, width, height, scale, format };
+		aTarget_.push_back(t);
+
+		// keyed by the format, the bind flags follow from it
+		return pool_.create(format, bindFlags(format), scaled(width, scale), scaled(height, scale));
+	}
+
+	void RenderTargets::setScale(UINT id, float scale, ID3D11Device *pd3dDevice)
+	{
+		if (aTarget_[id].scale == scale) return;
+		aTarget_[id].scale = scale;
+		resize(id);
+	}
+
+	void RenderTargets::setFormat(UINT id, RENDER_TARGET::FORMAT format)
+	{
+		if (aTarget_[id].format == format) return;
+		aTarget_[id].format = format;
+		pool_.setFormat(id, format);
+	}
+
+	void RenderTargets::getSize(UINT id, UINT *width, UINT *height)
+	{
+		*width = pool_.width(id);
+		*height = pool_.height(id);
 	}
 
-	UINT RenderTargets::create(ID3D11Device *pd3dDevice, RENDER_TARGET::TYPE type, UINT width, UINT height)
+	void RenderTargets::getTextureSize(UINT id, UINT *width, UINT *height)
 	{
-		RenderTarget *p = new RenderTarget(pd3dDevice, type, width, height);
-		aRT_.push_back(p);
+		const RT_SURFACE_DESC &desc = pool_.desc(pool_.surface(id));
+		*width = desc.width;
+		*height = desc.height;
+	}
+
+	unsigned long long RenderTargets::getBytes(UINT id)
+	{
+		return aRT_[pool_.surface(id)]->bytes();
+	}
+
+	UINT RenderTargets::getGeneration(UINT id)
+	{
+		return pool_.generation(id);
+	}
 
-		return aRT_.size() - 1;
+	unsigned long long RenderTargets::getTotalBytes()
+	{
+		unsigned long long bytes = 0;
+		for (auto &p : aRT_){
+			if (p) bytes += p->bytes();
+		}
+		return bytes;
 	}
 
 	void RenderTargets::Clear(UINT color, ID3D11DeviceContext *pd3dImmediateContext)
@@ -243,36 +327,55 @@ namespace tpot
 	{
 		if (~0 == id){
 			// UAȒldepth 邱ƂɂđΉ
-			ID3D11RenderTargetView*      pRTV[1] = { pCurrentRTV_ };
-			pd3dImmediateContext->OMSetRenderTargets(1, pRTV, nullptr);
+			setTargets(pd3dImmediateContext, pCurrentRTV_, nullptr, &pCurrentUAV_);
 			return;
 		}
 
-		RenderTarget* pRT = aRT_[id];
+		RenderTarget* pRT = aRT_[pool_.surface(id)];
 
 		if (pRT->type() == RENDER_TARGET::HDR_SCREEN){
 			pCurrentRTV_ = pRT->getRenderTargetView();
+
+			// the surface may be larger, draw into the top left of it
+			D3D11_VIEWPORT vp = { 0.0f, 0.0f, (float)pool_.width(id), (float)pool_.height(id), 0.0f, 1.0f };
+			pd3dImmediateContext->RSSetViewports(1, &vp);
 		}
 		else if (pRT->type() == RENDER_TARGET::DEPTH){
 			pCurrentDSV_ = pRT->getDepthStencilView();
 		}
-		ID3D11RenderTargetView*      pRTV[1] = { pCurrentRTV_ };
-		pd3dImmediateContext->OMSetRenderTargets(1, pRTV, pCurrentDSV_);
+		setTargets(pd3dImmediateContext, pCurrentRTV_, pCurrentDSV_, &pCurrentUAV_);
 	}
 	ID3D11ShaderResourceView *RenderTargets::get(UINT id)
 	{
-		return aRT_[id]->getShaderResourceView();
+		return aRT_[pool_.surface(id)]->getShaderResourceView();
+	}
+	ID3D11UnorderedAccessView *RenderTargets::getUnorderedAccessView(UINT id)
+	{
+		return aRT_[pool_.surface(id)]->getUnorderedAccessView();
+	}
+	void RenderTargets::setPresent(UINT id, ID3D11DeviceContext *pd3dImmediateContext)
+	{
+		pCurrentRTV_ = pOrigRTV_;
+		pCurrentDSV_ = nullptr;
+		pCurrentUAV_ = (~0 == id) ? nullptr : aRT_[pool_.surface(id)]->getUnorderedAccessView();
+
+		ID3D11RenderTargetView* aRTViews[1] = { pCurrentRTV_ };
+		ID3D11UnorderedAccessView* aUAViews[1] = { pCurrentUAV_ };
+		pd3dImmediateContext->OMSetRenderTargetsAndUnorderedAccessViews(1, aRTViews, nullptr, 1, 1, aUAViews, nullptr);
+		pd3dImmediateContext->RSSetViewports(1, &OrigViewport_);
 	}
 	void RenderTargets::pushDefault(ID3D11DeviceContext *pd3dImmediateContext)
 	{
 		pd3dImmediateContext->OMGetRenderTargets(1, &pOrigRTV_, &pOrigDSV_);
+		UINT nViewports = 1;
+		pd3dImmediateContext->RSGetViewports(&nViewports, &OrigViewport_);
 		pCurrentRTV_ = pOrigRTV_;
 		pCurrentDSV_ = pOrigDSV_;
 	}
 	void RenderTargets::popDefault(ID3D11DeviceContext *pd3dImmediateContext)
 	{
-		ID3D11RenderTargetView* aRTViews[1] = { pOrigRTV_ };
-		pd3dImmediateContext->OMSetRenderTargets(1, aRTViews, pOrigDSV_);
+		setTargets(pd3dImmediateContext, pOrigRTV_, pOrigDSV_, &pCurrentUAV_);
+		pd3dImmediateContext->RSSetViewports(1, &OrigViewport_);
 
 		SAFE_RELEASE(pOrigRTV_);
 		SAFE_RELEASE(pOrigDSV_);
@@ -3,117 +3,117 @@
 
 #include <vector>
 #include "renderer.h"
+#include "RenderTargetPool.h"
 
 namespace tpot
 {
-	struct TEX{
-		enum TYPE
-		{
-			RGBA32,
-			DEPTH,
-
-			TYPE_MAX,
-		};
-	};
-
 	class Texture
 	{
 		ID3D11Texture2D* pTex_;
 
 	public:
-		Texture(ID3D11Device *pd3dDevice, TEX::TYPE type, UINT width, UINT height);
+		Texture(ID3D11Device *pd3dDevice, RENDER_TARGET::FORMAT format, UINT width, UINT height);
 		~Texture();
 
 		ID3D11Resource *get(){ return pTex_; }
 	};
 
-	struct DS_VIEW{
-		enum TYPE
-		{
-			DEPTH,
-
-			TYPE_MAX,
-		};
-	};
 	class DepthStencilView
 	{
 		ID3D11DepthStencilView *pDSView_;
 		bool                   mustRelease;
 	public:
-		DepthStencilView(ID3D11Device *pd3dDevice, DS_VIEW::TYPE type, ID3D11Resource *pResource);
+		DepthStencilView(ID3D11Device *pd3dDevice, RENDER_TARGET::FORMAT format, ID3D11Resource *pResource);
 		DepthStencilView(ID3D11DepthStencilView *pDS_View);
 		~DepthStencilView();
 
 		ID3D11DepthStencilView *get(){ return pDSView_; }
 	};
 
-	struct SR_VIEW{
-		enum TYPE
-		{
-			RGBA32,
-			DEPTH,
-
-			TYPE_MAX,
-		};
-	};
 	class ShaderResourceView
 	{
 		ID3D11ShaderResourceView *pSRView_;
 	public:
-		ShaderResourceView(ID3D11Device *pd3dDevice, SR_VIEW::TYPE type, ID3D11Resource *pResource);
+		ShaderResourceView(ID3D11Device *pd3dDevice, RENDER_TARGET::FORMAT format, ID3D11Resource *pResource);
 		~ShaderResourceView();
 
 		ID3D11ShaderResourceView *get(){ return pSRView_; }
 	};
 
-	struct RT_VIEW{
-		enum TYPE
-		{
-			RGBA32,
-
-			TYPE_MAX,
-		};
-	};
 	class RenderTargetView
 	{
 		ID3D11RenderTargetView *pRTView_;
 	public:
-		RenderTargetView(ID3D11Device *pd3dDevice, RT_VIEW::TYPE type, ID3D11Resource *pResource);
+		RenderTargetView(ID3D11Device *pd3dDevice, RENDER_TARGET::FORMAT format, ID3D11Resource *pResource);
 		~RenderTargetView();
 
 		ID3D11RenderTargetView *get(){ return pRTView_; }
 	};
 
+	class UnorderedAccessView
+	{
+		ID3D11UnorderedAccessView *pUAView_;
+	public:
+		UnorderedAccessView(ID3D11Device *pd3dDevice, RENDER_TARGET::FORMAT format, ID3D11Resource *pResource);
+		~UnorderedAccessView();
+
+		ID3D11UnorderedAccessView *get(){ return pUAView_; }
+	};
+
+	// Texture and views of one RenderTargetPool surface
 	class RenderTarget
 	{
 		RENDER_TARGET::TYPE type_;
+		RENDER_TARGET::FORMAT format_;
+		UINT width_;
+		UINT height_;
 		RenderTargetView *pRT_View_;
 		DepthStencilView *pDS_View_;
 		Texture *pTex_;
 		ShaderResourceView *pSR_View_;
+		UnorderedAccessView *pUA_View_;	// RENDER_TARGET::unorderedAccess() formats
 
 		ID3D11RenderTargetView  *pRT_View11_;
 
-		void create(ID3D11Device *pd3dDevice, RENDER_TARGET::TYPE type, UINT width, UINT height);
+		void create(ID3D11Device *pd3dDevice);
 		void release();
 	public:
-		RenderTarget(ID3D11Device *pd3dDevice, RENDER_TARGET::TYPE type, UINT width, UINT height);
+		RenderTarget(ID3D11Device *pd3dDevice, RENDER_TARGET::FORMAT format, UINT width, UINT height);
 		~RenderTarget();
 
-		void ResizedSwapChain(ID3D11Device* pd3dDevice, const DXGI_SURFACE_DESC* pBackBufferSurfaceDesc);
-		void ReleasingSwapChain();
+		UINT width() const { return width_; }	// actual texture size
+		UINT height() const { return height_; }
 
 		ID3D11RenderTargetView *getRenderTargetView(){ return pRT_View_->get(); }
 		ID3D11DepthStencilView *getDepthStencilView(){ return pDS_View_->get(); }
 		ID3D11ShaderResourceView *getShaderResourceView(){ return pSR_View_->get(); }
+		ID3D11UnorderedAccessView *getUnorderedAccessView(){ return pUA_View_ ? pUA_View_->get() : nullptr; }
 		ID3D11Resource *getTexture(){ return pTex_->get(); }
 
 		RENDER_TARGET::TYPE type() const { return type_; }
+		RENDER_TARGET::FORMAT format() const { return format_; }
+		unsigned long long bytes() const { return RENDER_TARGET::bytes(format_, width_, height_); }
 	};
 
+	// Ids are RenderTargetPool targets: a resize only re-creates a texture
+	// when it outgrows its surface or has settled for a few frames, and
+	// the viewport covers the used part of it.
 	class  RenderTargets
 	{
-		std::vector < RenderTarget* > aRT_;
+		struct TARGET
+		{
+			RENDER_TARGET::TYPE type;
+			UINT  width;	// back buffer size for HDR_SCREEN and DEPTH
+			UINT  height;
+			float scale;
+			RENDER_TARGET::FORMAT format;
+		};
+
+		std::vector < TARGET > aTarget_;
+		std::vector < RenderTarget* > aRT_;	// by pool surface
+		RenderTargetPool pool_;
+
+		void resize(UINT id);
 
 		// eNX`_Op̃Jg̃obt@̊m
 		ID3D11RenderTargetView* pOrigRTV_;
@@ -121,20 +121,33 @@ namespace tpot
 
 		ID3D11RenderTargetView* pCurrentRTV_ = nullptr;
 		ID3D11DepthStencilView* pCurrentDSV_ = nullptr;
+		ID3D11UnorderedAccessView* pCurrentUAV_ = nullptr;	// setPresent()
+		D3D11_VIEWPORT          OrigViewport_;
 	public:
 		RenderTargets(ID3D11Device *pd3dDevice);
 		~RenderTargets();
 
+		void beginFrame(); // settled sizes get their own surface, idle ones are freed
 		void ResizedSwapChain(ID3D11Device* pd3dDevice, const DXGI_SURFACE_DESC* pBackBufferSurfaceDesc);
 		void ReleasingSwapChain();
 
-		UINT create(ID3D11Device *pd3dDevice, RENDER_TARGET::TYPE type, UINT width, UINT height);
+		UINT create(ID3D11Device *pd3dDevice, RENDER_TARGET::TYPE type, UINT width, UINT height, float scale, RENDER_TARGET::FORMAT format);
+		void setScale(UINT id, float scale, ID3D11Device *pd3dDevice);
+		void setFormat(UINT id, RENDER_TARGET::FORMAT format);
+		void getSize(UINT id, UINT *width, UINT *height);
+		void getTextureSize(UINT id, UINT *width, UINT *height);
+		unsigned long long getBytes(UINT id);
+		UINT getGeneration(UINT id);
+		unsigned long long getTotalBytes(); // idle pooled surfaces included
 
 		void Clear(UINT color, ID3D11DeviceContext *pd3dImmediateContext); // AARRGGBB
 		void ClearDepth(float depth, ID3D11DeviceContext *pd3dImmediateContext);
 
 		void set(UINT id, ID3D11DeviceContext *pd3dImmediateContext);
 		ID3D11ShaderResourceView *get(UINT id);
+		ID3D11UnorderedAccessView *getUnorderedAccessView(UINT id);
+		// Original RTV and viewport of pushDefault(), no depth, id as UAV u1 of the pixel shader
+		void setPresent(UINT id, ID3D11DeviceContext *pd3dImmediateContext);
 
 		void pushDefault(ID3D11DeviceContext *pd3dImmediateContext);
 		void popDefault(ID3D11DeviceContext *pd3dImmediateContext);
@@ -0,0 +1,70 @@
+#include <string.h>
+#include "types.h"
+
+namespace tpot
+{
+
+namespace
+{
+	struct FORMAT_INFO
+	{
+		const char *name;
+		UINT        bytes;	// per pixel
+		bool        depth;
+		bool        uav;	// typed UAV store
+	};
+
+	const FORMAT_INFO FORMATS[RENDER_TARGET::FORMAT_MAX] = {
+		{ "rgba32f",    16, false, true },
+		{ "rgba16f",     8, false, true },
+		{ "r11g11b10f",  4, false, true },
+		{ "rgb10a2",     4, false, true },
+		{ "rgba8",       4, false, true },
+		{ "rgba8_srgb",  4, false, false },
+		{ "d24s8",       4, true,  false },
+		{ "d32f",        4, true,  false },
+	};
+}// namespace
+
+RENDER_TARGET::FORMAT RENDER_TARGET::defaultFormat(TYPE type)
+{
+	return (type == DEPTH) ? D24S8 : RGBA32F;
+}
+
+bool RENDER_TARGET::isDepth(FORMAT format)
+{
+	return format < FORMAT_MAX && FORMATS[format].depth;
+}
+
+bool RENDER_TARGET::unorderedAccess(FORMAT format)
+{
+	return format < FORMAT_MAX && FORMATS[format].uav;
+}
+
+UINT RENDER_TARGET::bytesPerPixel(FORMAT format)
+{
+	return (format < FORMAT_MAX) ? FORMATS[format].bytes : 0;
+}
+
+unsigned long long RENDER_TARGET::bytes(FORMAT format, UINT width, UINT height)
+{
+	return (unsigned long long)bytesPerPixel(format) * width * height;
+}
+
+const char *RENDER_TARGET::name(FORMAT format)
+{
+	return (format < FORMAT_MAX) ? FORMATS[format].name : "unknown";
+}
+
+bool RENDER_TARGET::parse(const char *str, FORMAT *format)
+{
+	for (int i = 0; i < FORMAT_MAX; i++){
+		if (strcmp(str, FORMATS[i].name) == 0){
+			*format = (FORMAT)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+}// namespace tpot
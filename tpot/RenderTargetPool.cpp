@@ -0,0 +1,138 @@
+#include <string.h>
+#include "RenderTargetPool.h"
+
+namespace tpot
+{
+
+RenderTargetPool::RenderTargetPool(CREATE create, DESTROY destroy, unsigned granularity, unsigned stable_frames)
+	: create_(create), destroy_(destroy)
+	, granularity_(granularity ? granularity : 1), stable_frames_(stable_frames)
+{
+	memset(&stats_, 0, sizeof(stats_));
+}
+
+RT_SURFACE_DESC RenderTargetPool::fit(const TARGET &t) const
+{
+	RT_SURFACE_DESC desc = {
+		t.format, t.bind,
+		bucket(t.width ? t.width : 1, granularity_),
+		bucket(t.height ? t.height : 1, granularity_),
+	};
+	return desc;
+}
+
+unsigned RenderTargetPool::acquire(const RT_SURFACE_DESC &desc)
+{
+	unsigned slot = ~0u;
+	for (unsigned i = 0; i < surfaces_.size(); i++){
+		SURFACE &s = surfaces_[i];
+		if (s.alive && !s.used && s.desc == desc){
+			s.used = true;
+			stats_.reused++;
+			return i;
+		}
+		if (!s.alive && slot == ~0u) slot = i;
+	}
+
+	if (slot == ~0u){
+		slot = (unsigned)surfaces_.size();
+		surfaces_.push_back(SURFACE());
+	}
+	SURFACE &s = surfaces_[slot];
+	s.desc = desc;
+	s.alive = true;
+	s.used = true;
+	create_(slot, desc);
+	stats_.created++;
+	return slot;
+}
+
+void RenderTargetPool::release(unsigned surface)
+{
+	surfaces_[surface].used = false;
+}
+
+void RenderTargetPool::reallocate(TARGET &t)
+{
+	RT_SURFACE_DESC desc = fit(t);
+	if (desc == surfaces_[t.surface].desc) return;
+
+	unsigned old = t.surface;
+	t.surface = acquire(desc);
+	t.generation++;
+	release(old);
+}
+
+unsigned RenderTargetPool::create(unsigned format, unsigned bind, unsigned width, unsigned height)
+{
+	TARGET t = { format, bind, width, height, ~0u, 0, 0 };
+	t.surface = acquire(fit(t));
+	targets_.push_back(t);
+	return (unsigned)targets_.size() - 1;
+}
+
+void RenderTargetPool::resize(unsigned id, unsigned width, unsigned height)
+{
+	TARGET &t = targets_[id];
+	if (t.width == width && t.height == height) return;
+	t.width = width;
+	t.height = height;
+	t.stable = 0;
+	stats_.resized++;
+
+	const RT_SURFACE_DESC &desc = surfaces_[t.surface].desc;
+	if (width <= desc.width && height <= desc.height){// fits, shrink later if it stays
+		stats_.deferred++;
+		return;
+	}
+	reallocate(t);
+}
+
+void RenderTargetPool::setFormat(unsigned id, unsigned format)
+{
+	TARGET &t = targets_[id];
+	if (t.format == format) return;
+	t.format = format;
+	reallocate(t);
+}
+
+void RenderTargetPool::tick()
+{
+	for (unsigned i = 0; i < surfaces_.size(); i++){
+		SURFACE &s = surfaces_[i];
+		if (!s.alive || s.used) continue;
+		destroy_(i);
+		s.alive = false;
+		stats_.destroyed++;
+	}
+
+	for (auto &t : targets_){
+		if (t.stable < stable_frames_) t.stable++;
+		if (stable_frames_ <= t.stable) reallocate(t);
+	}
+}
+
+unsigned RenderTargetPool::surfaceCount() const
+{
+	unsigned n = 0;
+	for (auto &s : surfaces_) n += s.alive ? 1 : 0;
+	return n;
+}
+
+unsigned long long RenderTargetPool::pixels() const
+{
+	unsigned long long n = 0;
+	for (auto &s : surfaces_){
+		if (s.alive) n += (unsigned long long)s.desc.width * s.desc.height;
+	}
+	return n;
+}
+
+RenderTargetPool::STATS RenderTargetPool::takeStats()
+{
+	STATS s = stats_;
+	memset(&stats_, 0, sizeof(stats_));
+	return s;
+}
+
+}// namespace tpot
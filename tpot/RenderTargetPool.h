@@ -0,0 +1,121 @@
+#ifndef TPOT_RENDER_TARGET_POOL_H__
+#define TPOT_RENDER_TARGET_POOL_H__
+
+#include <vector>
+#include <functional>
+
+namespace tpot
+{
+
+	// What a pooled texture is created with. format and bind are the
+	// backend's (DXGI_FORMAT, D3D11_BIND_*), the pool only compares them.
+	struct RT_SURFACE_DESC
+	{
+		unsigned format;
+		unsigned bind;
+		unsigned width;
+		unsigned height;
+
+		bool operator==(const RT_SURFACE_DESC &o) const {
+			return format == o.format && bind == o.bind && width == o.width && height == o.height;
+		}
+	};
+
+	// Render targets backed by pooled surfaces, so resizing a window does
+	// not destroy and create every screen sized texture each frame.
+	//
+	// Surfaces are allocated with the size rounded up to granularity and a
+	// target draws into the top left width() x height() of its surface.
+	// Growing past the surface takes a new one at once; a target that
+	// would fit a smaller bucket keeps its surface until the size has been
+	// stable for stable_frames ticks. Released surfaces stay in the pool
+	// until the next tick and are handed out again to an exact match.
+	//
+	// create and destroy are called for the backend objects of a surface,
+	// from create(), resize() and tick() only. The pool going away destroys
+	// nothing, the backend releases what it still holds.
+	class RenderTargetPool
+	{
+	public:
+		enum{
+			GRANULARITY = 128,	// pixels
+			STABLE_FRAMES = 8,
+		};
+
+		typedef std::function<void(unsigned surface, const RT_SURFACE_DESC &desc)> CREATE;
+		typedef std::function<void(unsigned surface)> DESTROY;
+
+		struct STATS
+		{
+			unsigned created;	// surfaces
+			unsigned destroyed;
+			unsigned reused;	// taken from the pool instead of created
+			unsigned resized;	// target size changes
+			unsigned deferred;	// size changes that kept the surface
+		};
+
+	private:
+		struct TARGET
+		{
+			unsigned format;
+			unsigned bind;
+			unsigned width;		// requested
+			unsigned height;
+			unsigned surface;
+			unsigned stable;	// ticks at this size
+			unsigned generation;	// surface changes
+		};
+
+		struct SURFACE
+		{
+			RT_SURFACE_DESC desc;
+			bool     alive;
+			bool     used;
+		};
+
+		CREATE   create_;
+		DESTROY  destroy_;
+		unsigned granularity_;
+		unsigned stable_frames_;
+		std::vector<TARGET>  targets_;
+		std::vector<SURFACE> surfaces_;	// slots are recycled, ids stay below surfaceSlots()
+		STATS    stats_;
+
+		RT_SURFACE_DESC fit(const TARGET &t) const;
+		unsigned acquire(const RT_SURFACE_DESC &desc);
+		void release(unsigned surface);
+		void reallocate(TARGET &t);
+
+	public:
+		RenderTargetPool(CREATE create, DESTROY destroy,
+			unsigned granularity = GRANULARITY, unsigned stable_frames = STABLE_FRAMES);
+
+		unsigned create(unsigned format, unsigned bind, unsigned width, unsigned height); // target id
+		void resize(unsigned id, unsigned width, unsigned height);
+		void setFormat(unsigned id, unsigned format); // a new surface at once
+
+		// Once per frame, before anything of the frame is bound
+		void tick();
+
+		unsigned width(unsigned id) const { return targets_[id].width; }	// viewport
+		unsigned height(unsigned id) const { return targets_[id].height; }
+		unsigned surface(unsigned id) const { return targets_[id].surface; }
+		// Changes with the surface, whose contents are then undefined
+		unsigned generation(unsigned id) const { return targets_[id].generation; }
+		const RT_SURFACE_DESC &desc(unsigned surface) const { return surfaces_[surface].desc; }
+
+		unsigned surfaceSlots() const { return (unsigned)surfaces_.size(); }
+		bool alive(unsigned surface) const { return surfaces_[surface].alive; }
+		unsigned surfaceCount() const; // alive, free ones included
+		unsigned long long pixels() const; // of the alive surfaces
+
+		// Since the last call
+		STATS takeStats();
+
+		static unsigned bucket(unsigned size, unsigned granularity){
+			return ((size + granularity - 1) / granularity) * granularity;
+		}
+	};
+
+}// namespace tpot
+#endif // TPOT_RENDER_TARGET_POOL_H__
@@ -0,0 +1,130 @@
+#ifndef TPOT_SDKMESH_FORMAT_H__
+#define TPOT_SDKMESH_FORMAT_H__
+
+namespace tpot
+{
+
+	// File layout of DXUT/Optional/SDKmesh.h, without the D3D types. The
+	// unions of pointers and offsets are the 64 bit offsets as stored.
+	const unsigned SDKMESH_VERSION = 101;
+	const unsigned SDKMESH_INVALID = ~0u;	// INVALID_FRAME, INVALID_MESH, ...
+
+	enum{
+		SDKMESH_MAX_VERTEX_ELEMENTS = 32,
+		SDKMESH_MAX_VERTEX_STREAMS = 16,
+		SDKMESH_MAX_NAME = 100,
+		SDKMESH_MAX_PATH = 260,	// MAX_PATH
+		SDKMESH_PRIMITIVE_TYPES = 11,	// SDKMESH_PRIMITIVE_TYPE, PT_TRIANGLE_LIST..PT_TRIANGLE_PATCH_LIST
+	};
+
+	struct SDKMESH_FILE_HEADER
+	{
+		unsigned           Version;
+		unsigned char      IsBigEndian;
+		unsigned long long HeaderSize;
+		unsigned long long NonBufferDataSize;
+		unsigned long long BufferDataSize;
+
+		unsigned           NumVertexBuffers;
+		unsigned           NumIndexBuffers;
+		unsigned           NumMeshes;
+		unsigned           NumTotalSubsets;
+		unsigned           NumFrames;
+		unsigned           NumMaterials;
+
+		unsigned long long VertexStreamHeadersOffset;
+		unsigned long long IndexStreamHeadersOffset;
+		unsigned long long MeshDataOffset;
+		unsigned long long SubsetDataOffset;
+		unsigned long long FrameDataOffset;
+		unsigned long long MaterialDataOffset;
+	};
+
+	struct SDKMESH_FILE_VERTEX_ELEMENT	// D3DVERTEXELEMENT9
+	{
+		unsigned short Stream;
+		unsigned short Offset;
+		unsigned char  Type;
+		unsigned char  Method;
+		unsigned char  Usage;
+		unsigned char  UsageIndex;
+	};
+
+	struct SDKMESH_FILE_VERTEX_BUFFER
+	{
+		unsigned long long NumVertices;
+		unsigned long long SizeBytes;
+		unsigned long long StrideBytes;
+		SDKMESH_FILE_VERTEX_ELEMENT Decl[SDKMESH_MAX_VERTEX_ELEMENTS];
+		unsigned long long DataOffset;	// from the start of the file
+	};
+
+	struct SDKMESH_FILE_INDEX_BUFFER
+	{
+		unsigned long long NumIndices;
+		unsigned long long SizeBytes;
+		unsigned           IndexType;	// 0: 16 bit, 1: 32 bit
+		unsigned long long DataOffset;
+	};
+
+	struct SDKMESH_FILE_MESH
+	{
+		char               Name[SDKMESH_MAX_NAME];
+		unsigned char      NumVertexBuffers;
+		unsigned           VertexBuffers[SDKMESH_MAX_VERTEX_STREAMS];
+		unsigned           IndexBuffer;
+		unsigned           NumSubsets;
+		unsigned           NumFrameInfluences;
+		float              BoundingBoxCenter[3];
+		float              BoundingBoxExtents[3];
+		unsigned long long SubsetOffset;	// unsigned[NumSubsets], indices into the subset table
+		unsigned long long FrameInfluenceOffset;	// unsigned[NumFrameInfluences]
+	};
+
+	struct SDKMESH_FILE_SUBSET
+	{
+		char               Name[SDKMESH_MAX_NAME];
+		unsigned           MaterialID;
+		unsigned           PrimitiveType;
+		unsigned long long IndexStart;
+		unsigned long long IndexCount;
+		unsigned long long VertexStart;	// base vertex of DrawIndexed
+		unsigned long long VertexCount;
+	};
+
+	struct SDKMESH_FILE_FRAME
+	{
+		char               Name[SDKMESH_MAX_NAME];
+		unsigned           Mesh;
+		unsigned           ParentFrame;
+		unsigned           ChildFrame;
+		unsigned           SiblingFrame;
+		float              Matrix[16];
+		unsigned           AnimationDataIndex;
+	};
+
+	struct SDKMESH_FILE_MATERIAL
+	{
+		char               Name[SDKMESH_MAX_NAME];
+		char               MaterialInstancePath[SDKMESH_MAX_PATH];
+		char               DiffuseTexture[SDKMESH_MAX_PATH];
+		char               NormalTexture[SDKMESH_MAX_PATH];
+		char               SpecularTexture[SDKMESH_MAX_PATH];
+		float              Diffuse[4];
+		float              Ambient[4];
+		float              Specular[4];
+		float              Emissive[4];
+		float              Power;
+		unsigned long long Textures[6];	// texture and view pointers once loaded
+	};
+
+	static_assert(sizeof(SDKMESH_FILE_HEADER) == 104, "SDKMESH_HEADER");
+	static_assert(sizeof(SDKMESH_FILE_VERTEX_BUFFER) == 288, "SDKMESH_VERTEX_BUFFER_HEADER");
+	static_assert(sizeof(SDKMESH_FILE_INDEX_BUFFER) == 32, "SDKMESH_INDEX_BUFFER_HEADER");
+	static_assert(sizeof(SDKMESH_FILE_MESH) == 224, "SDKMESH_MESH");
+	static_assert(sizeof(SDKMESH_FILE_SUBSET) == 144, "SDKMESH_SUBSET");
+	static_assert(sizeof(SDKMESH_FILE_FRAME) == 184, "SDKMESH_FRAME");
+	static_assert(sizeof(SDKMESH_FILE_MATERIAL) == 1256, "SDKMESH_MATERIAL");
+
+}// namespace tpot
+#endif // TPOT_SDKMESH_FORMAT_H__
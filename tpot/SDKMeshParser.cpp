@@ -0,0 +1,283 @@
+#include <float.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#include "SDKMeshParser.h"
+
+namespace tpot
+{
+
+namespace
+{
+	const char *const ERROR_NAME[SDKMESH_ERROR::MAX] = {
+		"none",
+		"truncated",
+		"version",
+		"endian",
+		"static_size",
+		"table",
+		"vertex_buffer",
+		"index_buffer",
+		"mesh",
+		"subset",
+		"index_value",
+		"frame",
+		"name",
+	};
+
+	// [offset, offset + bytes) inside [0, limit), without wrapping
+	inline bool fits(unsigned long long offset, unsigned long long bytes, unsigned long long limit)
+	{
+		return offset <= limit && bytes <= limit - offset;
+	}
+
+	template<size_t N>
+	inline bool terminated(const char(&s)[N])
+	{
+		return memchr(s, 0, N) != nullptr;
+	}
+
+	inline bool link(unsigned id, unsigned count)
+	{
+		return id == SDKMESH_INVALID || id < count;
+	}
+
+	// Checks every index of [start, start + count) plus base against the
+	// vertex count and grows the box around the positions they fetch
+	template<class INDEX>
+	bool scanIndices(const unsigned char *indices, unsigned long long start, unsigned long long count,
+		unsigned long long base, unsigned long long vertices,
+		const unsigned char *positions, unsigned long long stride, float lower[3], float upper[3])
+	{
+		const unsigned char *p = indices + start * sizeof(INDEX);
+		for (unsigned long long i = 0; i < count; i++, p += sizeof(INDEX)){
+			INDEX index;
+			memcpy(&index, p, sizeof(index));
+			unsigned long long v = base + index;
+			if (vertices <= v) return false;
+			if (!positions) continue;
+
+			float pos[3];
+			memcpy(pos, positions + v * stride, sizeof(pos));
+			for (int c = 0; c < 3; c++){
+				lower[c] = (pos[c] < lower[c]) ? pos[c] : lower[c];
+				upper[c] = (upper[c] < pos[c]) ? pos[c] : upper[c];
+			}
+		}
+		return true;
+	}
+}// namespace
+
+const char *SDKMeshErrorName(SDKMESH_ERROR::ID id)
+{
+	return (0 <= id && id < SDKMESH_ERROR::MAX) ? ERROR_NAME[id] : "unknown";
+}
+
+SDKMeshParser::SDKMeshParser()
+{
+	clear();
+}
+
+void SDKMeshParser::clear()
+{
+	data_ = nullptr;
+	size_ = 0;
+	memset(&header_, 0, sizeof(header_));
+	error_ = SDKMESH_ERROR::NONE;
+	error_item_ = 0;
+
+	vertex_buffers_ = Span<SDKMESH_FILE_VERTEX_BUFFER>();
+	index_buffers_ = Span<SDKMESH_FILE_INDEX_BUFFER>();
+	meshes_ = Span<SDKMESH_FILE_MESH>();
+	subsets_ = Span<SDKMESH_FILE_SUBSET>();
+	frames_ = Span<SDKMESH_FILE_FRAME>();
+	materials_ = Span<SDKMESH_FILE_MATERIAL>();
+
+	vertex_data_.clear();
+	index_data_.clear();
+	mesh_subsets_.clear();
+	mesh_influences_.clear();
+	bounds_.clear();
+}
+
+// Drops every view, keeps the header for the report
+SDKMESH_ERROR::ID SDKMeshParser::fail(SDKMESH_ERROR::ID id, unsigned item)
+{
+	SDKMESH_FILE_HEADER header = header_;
+	clear();
+	header_ = header;
+	error_ = id;
+	error_item_ = item;
+	return id;
+}
+
+// count elements at offset, inside the non buffer data and aligned for T
+template<class T>
+bool SDKMeshParser::table(unsigned long long offset, unsigned long long count, Span<T> *out) const
+{
+	*out = Span<T>();
+	if (count == 0) return true;
+
+	unsigned long long static_size = header_.HeaderSize + header_.NonBufferDataSize;
+	if (offset < sizeof(SDKMESH_FILE_HEADER) || static_size < offset) return false;
+	if ((static_size - offset) / sizeof(T) < count) return false;
+	const unsigned char *p = data_ + offset;
+	if ((uintptr_t)p % std::alignment_of<T>::value != 0) return false;
+
+	*out = Span<T>((const T*)p, (size_t)count);
+	return true;
+}
+
+SDKMESH_ERROR::ID SDKMeshParser::parse(const void *data, size_t size)
+{
+	clear();
+	if (!data || size < sizeof(header_)) return fail(SDKMESH_ERROR::TRUNCATED, 0);
+	memcpy(&header_, data, sizeof(header_));
+	if (header_.Version != SDKMESH_VERSION) return fail(SDKMESH_ERROR::VERSION, 0);
+	if (header_.IsBigEndian) return fail(SDKMESH_ERROR::ENDIAN, 0);
+	if (header_.HeaderSize < sizeof(header_) || !fits(header_.HeaderSize, header_.NonBufferDataSize, size)){
+		return fail(SDKMESH_ERROR::STATIC_SIZE, 0);
+	}
+	if (!fits(header_.HeaderSize + header_.NonBufferDataSize, header_.BufferDataSize, size)) return fail(SDKMESH_ERROR::TRUNCATED, 0);
+
+	data_ = (const unsigned char*)data;
+	size_ = size;
+	if (!table(header_.VertexStreamHeadersOffset, header_.NumVertexBuffers, &vertex_buffers_)) return fail(SDKMESH_ERROR::TABLE, 0);
+	if (!table(header_.IndexStreamHeadersOffset, header_.NumIndexBuffers, &index_buffers_)) return fail(SDKMESH_ERROR::TABLE, 1);
+	if (!table(header_.MeshDataOffset, header_.NumMeshes, &meshes_)) return fail(SDKMESH_ERROR::TABLE, 2);
+	if (!table(header_.SubsetDataOffset, header_.NumTotalSubsets, &subsets_)) return fail(SDKMESH_ERROR::TABLE, 3);
+	if (!table(header_.FrameDataOffset, header_.NumFrames, &frames_)) return fail(SDKMESH_ERROR::TABLE, 4);
+	if (!table(header_.MaterialDataOffset, header_.NumMaterials, &materials_)) return fail(SDKMESH_ERROR::TABLE, 5);
+
+	SDKMESH_ERROR::ID id = parseBuffers();
+	if (id == SDKMESH_ERROR::NONE) id = parseMaterials();
+	if (id == SDKMESH_ERROR::NONE) id = parseMeshes();
+	if (id == SDKMESH_ERROR::NONE) id = parseFrames();
+	return id;
+}
+
+SDKMESH_ERROR::ID SDKMeshParser::parseBuffers()
+{
+	unsigned long long static_size = staticSize();
+
+	vertex_data_.resize(vertex_buffers_.size());
+	for (unsigned i = 0; i < vertex_buffers_.size(); i++){
+		const SDKMESH_FILE_VERTEX_BUFFER &vb = vertex_buffers_[i];
+		if (vb.DataOffset < static_size || !fits(vb.DataOffset, vb.SizeBytes, size_)) return fail(SDKMESH_ERROR::VERTEX_BUFFER, i);
+		if (vb.StrideBytes ? vb.SizeBytes / vb.StrideBytes < vb.NumVertices : vb.NumVertices != 0) return fail(SDKMESH_ERROR::VERTEX_BUFFER, i);
+		vertex_data_[i] = Span<unsigned char>(data_ + vb.DataOffset, (size_t)vb.SizeBytes);
+	}
+
+	index_data_.resize(index_buffers_.size());
+	for (unsigned i = 0; i < index_buffers_.size(); i++){
+		const SDKMESH_FILE_INDEX_BUFFER &ib = index_buffers_[i];
+		if (ib.DataOffset < static_size || !fits(ib.DataOffset, ib.SizeBytes, size_)) return fail(SDKMESH_ERROR::INDEX_BUFFER, i);
+		if (1 < ib.IndexType || ib.SizeBytes / (ib.IndexType ? 4 : 2) < ib.NumIndices) return fail(SDKMESH_ERROR::INDEX_BUFFER, i);
+		index_data_[i] = Span<unsigned char>(data_ + ib.DataOffset, (size_t)ib.SizeBytes);
+	}
+	return SDKMESH_ERROR::NONE;
+}
+
+SDKMESH_ERROR::ID SDKMeshParser::parseMaterials()
+{
+	for (unsigned i = 0; i < materials_.size(); i++){
+		const SDKMESH_FILE_MATERIAL &m = materials_[i];
+		if (!terminated(m.Name) || !terminated(m.MaterialInstancePath) || !terminated(m.DiffuseTexture)
+			|| !terminated(m.NormalTexture) || !terminated(m.SpecularTexture)) return fail(SDKMESH_ERROR::NAME, i);
+	}
+	return SDKMESH_ERROR::NONE;
+}
+
+SDKMESH_ERROR::ID SDKMeshParser::parseMeshes()
+{
+	for (unsigned i = 0; i < subsets_.size(); i++){
+		const SDKMESH_FILE_SUBSET &subset = subsets_[i];
+		if (!terminated(subset.Name)) return fail(SDKMESH_ERROR::NAME, i);
+		if (SDKMESH_PRIMITIVE_TYPES <= subset.PrimitiveType || header_.NumMaterials <= subset.MaterialID){
+			return fail(SDKMESH_ERROR::SUBSET, i);
+		}
+	}
+
+	mesh_subsets_.resize(meshes_.size());
+	mesh_influences_.resize(meshes_.size());
+	bounds_.resize(meshes_.size());
+	for (unsigned m = 0; m < meshes_.size(); m++){
+		const SDKMESH_FILE_MESH &mesh = meshes_[m];
+		if (!terminated(mesh.Name)) return fail(SDKMESH_ERROR::NAME, m);
+		if (mesh.NumVertexBuffers == 0 || SDKMESH_MAX_VERTEX_STREAMS < mesh.NumVertexBuffers
+			|| header_.NumIndexBuffers <= mesh.IndexBuffer) return fail(SDKMESH_ERROR::MESH, m);
+
+		// a draw may fetch any stream, so the shortest one bounds the indices
+		unsigned long long vertices = ~0ull;
+		for (unsigned s = 0; s < mesh.NumVertexBuffers; s++){
+			if (header_.NumVertexBuffers <= mesh.VertexBuffers[s]) return fail(SDKMESH_ERROR::MESH, m);
+			unsigned long long n = vertex_buffers_[mesh.VertexBuffers[s]].NumVertices;
+			vertices = (n < vertices) ? n : vertices;
+		}
+
+		if (!table(mesh.SubsetOffset, mesh.NumSubsets, &mesh_subsets_[m])
+			|| !table(mesh.FrameInfluenceOffset, mesh.NumFrameInfluences, &mesh_influences_[m])) return fail(SDKMESH_ERROR::MESH, m);
+		for (unsigned frame : mesh_influences_[m]){
+			if (header_.NumFrames <= frame) return fail(SDKMESH_ERROR::MESH, m);
+		}
+
+		const SDKMESH_FILE_INDEX_BUFFER &ib = index_buffers_[mesh.IndexBuffer];
+		const SDKMESH_FILE_VERTEX_BUFFER &stream0 = vertex_buffers_[mesh.VertexBuffers[0]];
+		const unsigned char *indices = index_data_[mesh.IndexBuffer].data();
+		const unsigned char *positions = (12 <= stream0.StrideBytes) ? vertex_data_[mesh.VertexBuffers[0]].data() : nullptr;
+
+		float lower[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float upper[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (unsigned id : mesh_subsets_[m]){
+			if (header_.NumTotalSubsets <= id) return fail(SDKMESH_ERROR::MESH, m);
+			const SDKMESH_FILE_SUBSET &subset = subsets_[id];
+			if (!fits(subset.IndexStart, subset.IndexCount, ib.NumIndices) || !fits(subset.VertexStart, subset.VertexCount, vertices)){
+				return fail(SDKMESH_ERROR::SUBSET, id);
+			}
+
+			bool in_range = ib.IndexType
+				? scanIndices<unsigned>(indices, subset.IndexStart, subset.IndexCount, subset.VertexStart, vertices, positions, stream0.StrideBytes, lower, upper)
+				: scanIndices<unsigned short>(indices, subset.IndexStart, subset.IndexCount, subset.VertexStart, vertices, positions, stream0.StrideBytes, lower, upper);
+			if (!in_range) return fail(SDKMESH_ERROR::INDEX_VALUE, m);
+		}
+
+		BOUNDS &b = bounds_[m];
+		for (int c = 0; c < 3; c++){
+			float half = (lower[c] <= upper[c]) ? 0.5f * (upper[c] - lower[c]) : 0.0f;
+			b.center[c] = (lower[c] <= upper[c]) ? lower[c] + half : 0.0f;
+			b.extents[c] = half;
+		}
+	}
+	return SDKMESH_ERROR::NONE;
+}
+
+SDKMESH_ERROR::ID SDKMeshParser::parseFrames()
+{
+	unsigned count = (unsigned)frames_.size();
+	for (unsigned i = 0; i < count; i++){
+		const SDKMESH_FILE_FRAME &f = frames_[i];
+		if (!terminated(f.Name)) return fail(SDKMESH_ERROR::NAME, i);
+		if (!link(f.Mesh, header_.NumMeshes) || !link(f.ParentFrame, count)
+			|| !link(f.ChildFrame, count) || !link(f.SiblingFrame, count)) return fail(SDKMESH_ERROR::FRAME, i);
+	}
+
+	// The hierarchy is walked recursively through child and sibling links
+	// from frame 0 and from the roots: each frame must be reached once
+	std::vector<unsigned char> visited(count, 0);
+	std::vector<unsigned> stack;
+	for (unsigned root = 0; root < count; root++){
+		if (visited[root] || (root != 0 && frames_[root].ParentFrame != SDKMESH_INVALID)) continue;
+		stack.push_back(root);
+		while (!stack.empty()){
+			unsigned f = stack.back();
+			stack.pop_back();
+			if (visited[f]) return fail(SDKMESH_ERROR::FRAME, f);
+			visited[f] = 1;
+			if (frames_[f].SiblingFrame != SDKMESH_INVALID) stack.push_back(frames_[f].SiblingFrame);
+			if (frames_[f].ChildFrame != SDKMESH_INVALID) stack.push_back(frames_[f].ChildFrame);
+		}
+	}
+	return SDKMESH_ERROR::NONE;
+}
+
+}// namespace tpot
@@ -0,0 +1,110 @@
+#ifndef TPOT_SDKMESH_PARSER_H__
+#define TPOT_SDKMESH_PARSER_H__
+
+#include <stddef.h>
+#include <vector>
+#include "SDKMeshFormat.h"
+#include "Span.h"
+
+namespace tpot
+{
+
+	struct SDKMESH_ERROR{
+		enum ID{
+			NONE,
+			TRUNCATED,		// smaller than the header, or than the sizes it gives
+			VERSION,
+			ENDIAN,			// big endian files are not converted
+			STATIC_SIZE,	// header + non buffer data past the end of the file
+			TABLE,			// a table outside of the non buffer data, or misaligned
+			VERTEX_BUFFER,	// data outside of the buffer data, or vertices past it
+			INDEX_BUFFER,
+			MESH,			// stream, index buffer, subset or frame out of range
+			SUBSET,			// ranges past the buffers, unknown primitive or material
+			INDEX_VALUE,	// an index past the vertex buffer
+			FRAME,			// mesh or link out of range, or a cycle
+			NAME,			// a name or path without its terminating zero
+
+			MAX,
+		};
+	};
+	const char *SDKMeshErrorName(SDKMESH_ERROR::ID id);
+
+	// Validating reader of an .sdkmesh image in memory, read or mapped. It
+	// never writes to the data and never follows an offset it has not
+	// checked, so a broken or hostile file is rejected instead of read out
+	// of bounds. Every table and buffer is a view into the data, which must
+	// outlive the parser.
+	//
+	// Everything a consumer needs after parse() is resolved up front, so the
+	// consumer may overwrite the offsets in its own copy (CDXUTSDKMesh puts
+	// buffer and texture pointers there).
+	class SDKMeshParser
+	{
+	public:
+		struct BOUNDS
+		{
+			float center[3];
+			float extents[3];
+		};
+
+	private:
+		const unsigned char *data_;
+		size_t size_;
+		SDKMESH_FILE_HEADER header_;
+		SDKMESH_ERROR::ID error_;
+		unsigned error_item_;
+
+		Span<SDKMESH_FILE_VERTEX_BUFFER> vertex_buffers_;
+		Span<SDKMESH_FILE_INDEX_BUFFER> index_buffers_;
+		Span<SDKMESH_FILE_MESH> meshes_;
+		Span<SDKMESH_FILE_SUBSET> subsets_;
+		Span<SDKMESH_FILE_FRAME> frames_;
+		Span<SDKMESH_FILE_MATERIAL> materials_;
+
+		std::vector<Span<unsigned char> > vertex_data_;
+		std::vector<Span<unsigned char> > index_data_;
+		std::vector<Span<unsigned> > mesh_subsets_;
+		std::vector<Span<unsigned> > mesh_influences_;
+		std::vector<BOUNDS> bounds_;
+
+		SDKMESH_ERROR::ID fail(SDKMESH_ERROR::ID id, unsigned item);
+		template<class T> bool table(unsigned long long offset, unsigned long long count, Span<T> *out) const;
+		SDKMESH_ERROR::ID parseBuffers();
+		SDKMESH_ERROR::ID parseMeshes();
+		SDKMESH_ERROR::ID parseFrames();
+		SDKMESH_ERROR::ID parseMaterials();
+
+	public:
+		SDKMeshParser();
+
+		SDKMESH_ERROR::ID parse(const void *data, size_t size);
+		void clear();
+
+		SDKMESH_ERROR::ID error() const { return error_; }
+		unsigned errorItem() const { return error_item_; }	// index of the failing buffer, mesh, ...
+		bool valid() const { return data_ != nullptr; }
+
+		const SDKMESH_FILE_HEADER &header() const { return header_; }
+		// Header and non buffer data: the part a consumer copies to fix up
+		size_t staticSize() const { return (size_t)(header_.HeaderSize + header_.NonBufferDataSize); }
+
+		Span<SDKMESH_FILE_VERTEX_BUFFER> vertexBuffers() const { return vertex_buffers_; }
+		Span<SDKMESH_FILE_INDEX_BUFFER> indexBuffers() const { return index_buffers_; }
+		Span<SDKMESH_FILE_MESH> meshes() const { return meshes_; }
+		Span<SDKMESH_FILE_SUBSET> subsets() const { return subsets_; }
+		Span<SDKMESH_FILE_FRAME> frames() const { return frames_; }
+		Span<SDKMESH_FILE_MATERIAL> materials() const { return materials_; }
+
+		Span<unsigned char> vertexData(unsigned vb) const { return vertex_data_[vb]; }
+		Span<unsigned char> indexData(unsigned ib) const { return index_data_[ib]; }
+		Span<unsigned> meshSubsets(unsigned mesh) const { return mesh_subsets_[mesh]; }	// into subsets()
+		Span<unsigned> meshFrameInfluences(unsigned mesh) const { return mesh_influences_[mesh]; }
+
+		// Of the positions (float3 at the start of stream 0) every subset
+		// draws; zero for a mesh that draws nothing
+		const BOUNDS &meshBounds(unsigned mesh) const { return bounds_[mesh]; }
+	};
+
+}// namespace tpot
+#endif // TPOT_SDKMESH_PARSER_H__
@@ -0,0 +1,376 @@
+#include <stdio.h>
+#include <string.h>
+#include <set>
+#include <algorithm>
+#include "ShaderCache.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace tpot
+{
+
+namespace
+{
+	const char INDEX_NAME[] = "index.txt";
+	const char INDEX_MAGIC[] = "tpot_shader_cache 1";
+
+	struct BLOB_HEADER
+	{
+		char               magic[4];	// "TSC1"
+		unsigned           reserved;
+		unsigned long long key;
+		unsigned long long size;
+		unsigned long long checksum;	// ShaderCache::hash of the blob
+	};
+
+	bool readFile(const std::string &path, std::string *text)
+	{
+		FILE *fp = fopen(path.c_str(), "rb");
+		if (!fp) return false;
+		text->clear();
+		char buf[4096];
+		size_t n;
+		while ((n = fread(buf, 1, sizeof(buf), fp)) != 0) text->append(buf, n);
+		fclose(fp);
+		return true;
+	}
+
+	// tmp then rename, the destination is never half written
+	bool writeFile(const std::string &path, const std::string &tmp, const void *head, size_t head_size, const void *data, size_t size)
+	{
+		FILE *fp = fopen(tmp.c_str(), "wb");
+		if (!fp) return false;
+		bool ok = (fwrite(head, 1, head_size, fp) == head_size);
+		if (size) ok = ok && (fwrite(data, 1, size, fp) == size);
+		ok = (fclose(fp) == 0) && ok;
+#ifdef _WIN32
+		ok = ok && MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING);
+#else
+		ok = ok && (rename(tmp.c_str(), path.c_str()) == 0);
+#endif
+		if (!ok) remove(tmp.c_str());
+		return ok;
+	}
+
+	void makeDir(const std::string &dir)
+	{
+#ifdef _WIN32
+		_mkdir(dir.c_str());
+#else
+		mkdir(dir.c_str(), 0777);
+#endif
+	}
+
+	std::string directory(const std::string &path)
+	{
+		size_t pos = path.find_last_of("/\\");
+		return (pos == std::string::npos) ? std::string() : path.substr(0, pos + 1);
+	}
+
+	// #include "name" and <name>, anywhere a line starts with #
+	void findIncludes(const std::string &text, std::vector<std::string> *names)
+	{
+		size_t pos = 0;
+		while (pos < text.size()){
+			size_t end = text.find('\n', pos);
+			if (end == std::string::npos) end = text.size();
+
+			size_t i = text.find_first_not_of(" \t", pos);
+			if (i < end && text[i] == '#'){
+				i = text.find_first_not_of(" \t", i + 1);
+				if (i < end && text.compare(i, 7, "include") == 0){
+					i = text.find_first_not_of(" \t", i + 7);
+					if (i < end && (text[i] == '"' || text[i] == '<')){
+						char close = (text[i] == '"') ? '"' : '>';
+						size_t e = text.find(close, i + 1);
+						if (e < end) names->push_back(text.substr(i + 1, e - i - 1));
+					}
+				}
+			}
+			pos = end + 1;
+		}
+	}
+
+	ShaderCache::KEY hashString(const char *s, ShaderCache::KEY h)
+	{
+		// length first, so ("ab","c") and ("a","bc") differ
+		size_t n = s ? strlen(s) + 1 : 0;
+		h = ShaderCache::hash(&n, sizeof(n), h);
+		return ShaderCache::hash(s, n, h);
+	}
+
+	bool hashSource(const std::string &path, std::set<std::string> *visited, ShaderCache::KEY *h)
+	{
+		if (!visited->insert(path).second) return true;
+
+		std::string text;
+		bool found = readFile(path, &text);
+		*h = hashString(path.c_str(), *h);
+		*h = hashString(found ? text.c_str() : nullptr, *h);
+		if (!found) return false;
+
+		std::vector<std::string> names;
+		findIncludes(text, &names);
+		std::string base = directory(path);
+		for (auto &name : names){
+			// a missing include fails the compile anyway, its name still counts
+			hashSource(base + name, visited, h);
+		}
+		return true;
+	}
+}// namespace
+
+ShaderCache::KEY ShaderCache::hash(const void *data, size_t size, KEY seed)
+{
+	const unsigned char *p = (const unsigned char*)data;
+	KEY h = seed;
+	for (size_t i = 0; i < size; i++){
+		h ^= p[i];
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+ShaderCache::KEY ShaderCache::key(const char *source_path, const char *entry, const char *profile,
+	const SHADER_MACRO *macros, unsigned flags)
+{
+	std::set<std::string> visited;
+	KEY h = hash(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+	if (!hashSource(source_path, &visited, &h)) return 0;
+
+	h = hashString(entry, h);
+	h = hashString(profile, h);
+	for (const SHADER_MACRO *m = macros; m && m->Name; m++){
+		h = hashString(m->Name, h);
+		h = hashString(m->Definition, h);
+	}
+	h = hash(&flags, sizeof(flags), h);
+	return h ? h : 1;
+}
+
+ShaderCache::ShaderCache(const char *dir, size_t max_bytes)
+	: dir_(dir), max_bytes_(max_bytes), total_(0), tick_(0), dirty_(false), serial_(0)
+{
+	memset(&stats_, 0, sizeof(stats_));
+	if (!dir_.empty() && dir_[dir_.size() - 1] != '/' && dir_[dir_.size() - 1] != '\\') dir_ += '/';
+	makeDir(dir_);
+	loadIndex();
+}
+
+ShaderCache::~ShaderCache()
+{
+	flush();
+}
+
+std::string ShaderCache::path(KEY key) const
+{
+	char name[32];
+	sprintf(name, "%016llx.bin", key);
+	return dir_ + name;
+}
+
+// Per call, so two threads writing the same file never share one
+std::string ShaderCache::tmpPath(const std::string &path)
+{
+	char suffix[32];
+	sprintf(suffix, ".%u.tmp", serial_++);
+	return path + suffix;
+}
+
+void ShaderCache::loadIndex()
+{
+	std::string text;
+	if (!readFile(dir_ + INDEX_NAME, &text)) return;
+	if (text.compare(0, sizeof(INDEX_MAGIC) - 1, INDEX_MAGIC) != 0) return; // other version: start over
+
+	size_t pos = text.find('\n');
+	while (pos != std::string::npos && pos < text.size()){
+		unsigned long long key, size;
+		unsigned last_use;
+		if (sscanf(text.c_str() + pos + 1, "%llx %llu %u", &key, &size, &last_use) == 3){
+			ENTRY e = { (size_t)size, last_use };
+			index_[key] = e;
+			total_ += e.size;
+			tick_ = std::max(tick_, last_use + 1);
+		}
+		pos = text.find('\n', pos + 1);
+	}
+}
+
+bool ShaderCache::flush()
+{
+	std::lock_guard<std::mutex> flush_lock(flush_mutex_);
+	std::string text = INDEX_MAGIC;
+	text += '\n';
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (!dirty_) return true;
+		char line[64];
+		for (auto &it : index_){
+			sprintf(line, "%016llx %llu %u\n", it.first, (unsigned long long)it.second.size, it.second.last_use);
+			text += line;
+		}
+		dirty_ = false;
+	}
+
+	std::string index_path = dir_ + INDEX_NAME;
+	if (writeFile(index_path, tmpPath(index_path), text.data(), text.size(), nullptr, 0)) return true;
+	std::lock_guard<std::mutex> lock(mutex_);
+	dirty_ = true;
+	return false;
+}
+
+// mutex_ held, the caller removes the file after unlocking
+void ShaderCache::erase(KEY key)
+{
+	auto it = index_.find(key);
+	if (it == index_.end()) return;
+	total_ -= it->second.size;
+	index_.erase(it);
+	dirty_ = true;
+}
+
+void ShaderCache::removeFiles(const std::vector<KEY> &keys)
+{
+	for (auto k : keys) remove(path(k).c_str());
+}
+
+bool ShaderCache::load(KEY key, std::vector<char> *blob)
+{
+	unsigned last_use = 0;
+	bool found = false;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto it = index_.find(key);
+		found = (key != 0 && it != index_.end());
+		if (found) last_use = it->second.last_use;
+		else stats_.misses++;
+	}
+	if (!found) return false;
+
+	std::string data;
+	bool ok = readFile(path(key), &data);
+	BLOB_HEADER head;
+	ok = ok && (sizeof(head) <= data.size());
+	if (ok){
+		memcpy(&head, data.data(), sizeof(head));
+		ok = memcmp(head.magic, "TSC1", 4) == 0 && head.key == key
+			&& head.size == data.size() - sizeof(head)
+			&& head.checksum == hash(data.data() + sizeof(head), (size_t)head.size);
+	}
+	if (ok) blob->assign(data.begin() + sizeof(head), data.end());
+
+	bool stale = false;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto it = index_.find(key);
+		if (!ok){
+			// dropped unless another thread stored or used it meanwhile
+			stale = (it != index_.end() && it->second.last_use == last_use);
+			if (stale) erase(key);
+			stats_.misses++;
+		}else{
+			if (it != index_.end()){// may have been evicted meanwhile
+				it->second.last_use = tick_++;
+				dirty_ = true;
+			}
+			stats_.hits++;
+		}
+	}
+	if (stale) remove(path(key).c_str());
+	return ok;
+}
+
+bool ShaderCache::store(KEY key, const void *data, size_t size)
+{
+	if (key == 0) return false;
+
+	BLOB_HEADER head;
+	memcpy(head.magic, "TSC1", 4);
+	head.reserved = 0;
+	head.key = key;
+	head.size = size;
+	head.checksum = hash(data, size);
+	std::string blob_path = path(key);
+	if (!writeFile(blob_path, tmpPath(blob_path), &head, sizeof(head), data, size)) return false;
+
+	std::vector<KEY> removed;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto it = index_.find(key);
+		if (it != index_.end()) total_ -= it->second.size;
+		ENTRY e = { size, tick_++ };
+		index_[key] = e;
+		total_ += size;
+		dirty_ = true;
+		stats_.stores++;
+
+		if (max_bytes_ < total_) evict(max_bytes_, &removed);
+	}
+	removeFiles(removed);
+	return true;
+}
+
+ShaderCache::STATS ShaderCache::stats() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return stats_;
+}
+
+size_t ShaderCache::size() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return total_;
+}
+
+size_t ShaderCache::count() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return index_.size();
+}
+
+std::vector<ShaderCache::KEY> ShaderCache::keys() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return order();
+}
+
+// mutex_ held
+std::vector<ShaderCache::KEY> ShaderCache::order() const
+{
+	std::vector<std::pair<unsigned, KEY> > order;
+	for (auto &it : index_) order.push_back(std::make_pair(it.second.last_use, it.first));
+	std::sort(order.begin(), order.end());
+
+	std::vector<KEY> result;
+	for (auto &it : order) result.push_back(it.second);
+	return result;
+}
+
+void ShaderCache::trim(size_t max_bytes)
+{
+	std::vector<KEY> removed;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		evict(max_bytes, &removed);
+	}
+	removeFiles(removed);
+}
+
+// mutex_ held, appends the keys whose files are to be removed
+void ShaderCache::evict(size_t max_bytes, std::vector<KEY> *removed)
+{
+	std::vector<KEY> keys = order();
+	for (size_t i = 0; i < keys.size() && max_bytes < total_; i++){
+		erase(keys[i]);
+		removed->push_back(keys[i]);
+		stats_.evictions++;
+	}
+}
+
+}// namespace tpot
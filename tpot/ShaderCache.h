@@ -0,0 +1,104 @@
+#ifndef TPOT_SHADER_CACHE_H__
+#define TPOT_SHADER_CACHE_H__
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+
+namespace tpot
+{
+
+	// Same layout as D3D_SHADER_MACRO, terminated by a null Name
+	struct SHADER_MACRO
+	{
+		const char *Name;
+		const char *Definition;
+	};
+
+	// Compiled shader blobs on disk, content addressed. The key hashes the
+	// source, every file it #includes, entry point, profile, macros and
+	// compile flags, so an edit to any of them is a miss; nothing is ever
+	// invalidated by hand.
+	//
+	//   dir/XXXXXXXXXXXXXXXX.bin   header + blob
+	//   dir/index.txt              key size last_use, for LRU eviction
+	//
+	// Files are written to a temporary name and renamed into place, so a
+	// crash leaves either the old or the new file. Blobs are checksummed and
+	// a bad one is dropped and reported as a miss. Thread safe; files are
+	// read, written and checksummed outside the lock.
+	class ShaderCache
+	{
+	public:
+		typedef unsigned long long KEY;
+
+		enum{
+			DEFAULT_MAX_BYTES = 64 * 1024 * 1024,
+		};
+
+		struct STATS
+		{
+			unsigned hits;
+			unsigned misses;
+			unsigned stores;
+			unsigned evictions;
+		};
+
+	private:
+		struct ENTRY
+		{
+			size_t   size;	// blob bytes
+			unsigned last_use;
+		};
+
+		std::string dir_;
+		size_t max_bytes_;
+		size_t total_;
+		unsigned tick_;
+		bool dirty_;
+		std::map<KEY, ENTRY> index_;
+		STATS stats_;
+		mutable std::mutex mutex_;	// index_, total_, tick_, dirty_, stats_
+		std::mutex flush_mutex_;	// one index write at a time, newest last
+		std::atomic<unsigned> serial_;	// unique temporary file names
+
+		std::string path(KEY key) const;
+		std::string tmpPath(const std::string &path);
+		void loadIndex();
+		void erase(KEY key);
+		void evict(size_t max_bytes, std::vector<KEY> *removed);
+		void removeFiles(const std::vector<KEY> &keys);
+		std::vector<KEY> order() const;
+
+	public:
+		explicit ShaderCache(const char *dir, size_t max_bytes = DEFAULT_MAX_BYTES);
+		~ShaderCache(); // flush()
+
+		// 0 when the source cannot be read
+		static KEY key(const char *source_path, const char *entry, const char *profile,
+			const SHADER_MACRO *macros, unsigned flags);
+
+		bool load(KEY key, std::vector<char> *blob);
+		bool store(KEY key, const void *data, size_t size);
+
+		// Evicts least recently used blobs down to max_bytes
+		void trim(size_t max_bytes);
+		bool flush(); // writes the index if it changed
+
+		const std::string &dir() const { return dir_; }
+		size_t size() const; // blob bytes
+		size_t count() const;
+		STATS stats() const;
+
+		// For listing: keys oldest use first
+		std::vector<KEY> keys() const;
+
+		// FNV-1a 64
+		static KEY hash(const void *data, size_t size, KEY seed = 0xcbf29ce484222325ULL);
+	};
+
+}// namespace tpot
+#endif // TPOT_SHADER_CACHE_H__
@@ -0,0 +1,98 @@
+#include <string.h>
+#include <chrono>
+#include <atomic>
+#include "ShaderPermutation.h"
+#include "JobGraph.h"
+
+namespace tpot
+{
+
+namespace
+{
+	// The hull shader is compiled once per partition mode
+	const SHADER_MACRO INTEGER_PARTITIONING[] = { { "BEZIER_HS_PARTITION", "\"integer\"" }, { nullptr, nullptr } };
+	const SHADER_MACRO FRAC_EVEN_PARTITIONING[] = { { "BEZIER_HS_PARTITION", "\"fractional_even\"" }, { nullptr, nullptr } };
+	const SHADER_MACRO FRAC_ODD_PARTITIONING[] = { { "BEZIER_HS_PARTITION", "\"fractional_odd\"" }, { nullptr, nullptr } };
+
+	const SHADER_PERMUTATION PERMUTATIONS[] = {
+		{ STAGE::VS, VS::BEZIER, "sample.hlsl", "BezierVS", "vs_5_0", nullptr, "BezierVS" },
+		{ STAGE::HS, HS::PARTITION_INTEGER, "sample.hlsl", "BezierHS", "hs_5_0", INTEGER_PARTITIONING, "BezierHS int" },
+		{ STAGE::HS, HS::PARTITION_FRACTIONAL_EVEN, "sample.hlsl", "BezierHS", "hs_5_0", FRAC_EVEN_PARTITIONING, "BezierHS frac even" },
+		{ STAGE::HS, HS::PARTITION_FRACTIONAL_ODD, "sample.hlsl", "BezierHS", "hs_5_0", FRAC_ODD_PARTITIONING, "BezierHS frac odd" },
+		{ STAGE::DS, DS::BEZIER, "sample.hlsl", "BezierDS", "ds_5_0", nullptr, "BezierDS" },
+		{ STAGE::PS, PS::BEZIER, "sample.hlsl", "BezierPS", "ps_5_0", nullptr, "BezierPS" },
+		{ STAGE::PS, PS::SOLID_COLOR, "sample.hlsl", "SolidColorPS", "ps_5_0", nullptr, "SolidColorPS" },
+
+		{ STAGE::VS, VS::SCENE, "scene.hlsl", "VS_RenderScene", "vs_5_0", nullptr, "SceneVS" },
+		{ STAGE::PS, PS::SCENE, "scene.hlsl", "PS_RenderScene", "ps_5_0", nullptr, "ScenePS" },
+
+		{ STAGE::VS, VS::DECAL, "decal.hlsl", "VS", "vs_5_0", nullptr, "DecalVS" },
+		{ STAGE::PS, PS::DECAL, "decal.hlsl", "PS", "ps_5_0", nullptr, "DecalPS" },
+		{ STAGE::PS, PS::DECAL_YCOCG, "decal.hlsl", "PS_YCoCg", "ps_5_0", nullptr, "DecalPS YCoCg" },
+
+		{ STAGE::VS, VS::SHADOW, "shadow.hlsl", "VSMain", "vs_5_0", nullptr, "ShadowVS" },
+		{ STAGE::PS, PS::SHADOW, "shadow.hlsl", "PSMain", "ps_5_0", nullptr, "ShadowPS" },
+
+		{ STAGE::VS, VS::TAA, "taa.hlsl", "VS", "vs_5_0", nullptr, "TAA VS" },
+		{ STAGE::PS, PS::TAA, "taa.hlsl", "PS", "ps_5_0", nullptr, "TAA PS" },
+		{ STAGE::PS, PS::TAA_UPSAMPLE, "taa.hlsl", "PS_Upsample", "ps_5_0", nullptr, "TAA Upsample PS" },
+		{ STAGE::PS, PS::TAA_REPROJECT, "taa.hlsl", "PS_Reproject", "ps_5_0", nullptr, "TAA Reproject PS" },
+		{ STAGE::PS, PS::TAA_YCOCG, "taa.hlsl", "PS_YCoCg", "ps_5_0", nullptr, "TAA YCoCg PS" },
+		{ STAGE::PS, PS::TAA_TILE_MASK, "taa.hlsl", "PS_TileMask", "ps_5_0", nullptr, "TAA Tile Mask PS" },
+		{ STAGE::PS, PS::TAA_PRESENT, "taa.hlsl", "PS_Present", "ps_5_0", nullptr, "TAA Present PS" },
+		{ STAGE::PS, PS::TAA_YCOCG_PRESENT, "taa.hlsl", "PS_PresentYCoCg", "ps_5_0", nullptr, "TAA YCoCg Present PS" },
+		{ STAGE::PS, PS::TAA_CHECKER_MASK, "taa.hlsl", "PS_CheckerMask", "ps_5_0", nullptr, "TAA Checker Mask PS" },
+		{ STAGE::PS, PS::TAA_CHECKERBOARD, "taa.hlsl", "PS_Checkerboard", "ps_5_0", nullptr, "TAA Checkerboard PS" },
+		{ STAGE::CS, CS::TAA_VARIANCE, "taa.hlsl", "CS_Variance", "cs_5_0", nullptr, "TAA Variance CS" },
+	};
+}// namespace
+
+const SHADER_PERMUTATION *ShaderPermutations(UINT *count)
+{
+	*count = sizeof(PERMUTATIONS) / sizeof(PERMUTATIONS[0]);
+	return PERMUTATIONS;
+}
+
+bool BuildShaders(ThreadPool *pool, UINT count,
+	const std::function<bool(UINT index, std::vector<char> *blob)> &compile,
+	const std::function<bool(UINT index, const std::vector<char> &blob)> &create,
+	SHADER_BUILD_STATS *stats)
+{
+	typedef std::chrono::high_resolution_clock CLOCK;
+	CLOCK::time_point t0 = CLOCK::now();
+
+	std::vector<std::vector<char> > blob(count);
+	std::atomic<long long> compile_us(0);
+
+	JobGraph graph;
+	for (UINT i = 0; i < count; i++){
+		unsigned c = graph.add([&, i]{
+			CLOCK::time_point t = CLOCK::now();
+			bool ok = compile(i, &blob[i]);
+			compile_us += std::chrono::duration_cast<std::chrono::microseconds>(CLOCK::now() - t).count();
+			return ok;
+		});
+		unsigned d = graph.add([&, i]{
+			bool ok = create(i, blob[i]);
+			std::vector<char>().swap(blob[i]);
+			return ok;
+		}, AFFINITY::OWNER);
+		graph.depend(d, c);
+	}
+
+	bool ok = graph.run(pool);
+
+	if (stats){
+		stats->compiled = 0;
+		stats->failed = 0;
+		for (unsigned i = 0; i < graph.size(); i += 2){
+			if (graph.state(i) == JobGraph::STATE::DONE) stats->compiled++;
+			if (graph.state(i + 1) != JobGraph::STATE::DONE) stats->failed++;
+		}
+		stats->compile_ms = 0.001 * (double)compile_us.load();
+		stats->wall_ms = std::chrono::duration<double, std::milli>(CLOCK::now() - t0).count();
+	}
+	return ok;
+}
+
+}// namespace tpot
@@ -0,0 +1,46 @@
+#ifndef TPOT_SHADER_PERMUTATION_H__
+#define TPOT_SHADER_PERMUTATION_H__
+
+#include <vector>
+#include <functional>
+#include "types.h"
+#include "ShaderCache.h"
+
+namespace tpot
+{
+
+	class ThreadPool;
+
+	// One compiled shader: where it comes from and which VS::ID, HS::ID, ... it fills
+	struct SHADER_PERMUTATION
+	{
+		STAGE::ID          stage;
+		UINT               id;
+		const char         *file;
+		const char         *entry;
+		const char         *profile;
+		const SHADER_MACRO *macros;	// null terminated, may be null
+		const char         *name;	// debug name
+	};
+
+	// Every shader Shader creates
+	const SHADER_PERMUTATION *ShaderPermutations(UINT *count);
+
+	struct SHADER_BUILD_STATS
+	{
+		UINT   compiled;
+		UINT   failed;		// compile or create, dependents skipped
+		double compile_ms;	// summed over the workers
+		double wall_ms;
+	};
+
+	// Compiles permutations 0..count-1 on the pool and hands each blob to create()
+	// on the calling thread as soon as it is ready, while the other compiles
+	// run on. compile() must be thread safe. True if everything succeeded.
+	bool BuildShaders(ThreadPool *pool, UINT count,
+		const std::function<bool(UINT index, std::vector<char> *blob)> &compile,
+		const std::function<bool(UINT index, const std::vector<char> &blob)> &create,
+		SHADER_BUILD_STATS *stats = nullptr);
+
+}// namespace tpot
+#endif // TPOT_SHADER_PERMUTATION_H__
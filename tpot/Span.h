@@ -0,0 +1,31 @@
+#ifndef TPOT_SPAN_H__
+#define TPOT_SPAN_H__
+
+#include <stddef.h>
+
+namespace tpot
+{
+
+	// Read only view of count elements owned by someone else
+	template<class T>
+	class Span
+	{
+		const T *data_;
+		size_t size_;
+
+	public:
+		Span() : data_(nullptr), size_(0){}
+		Span(const T *data, size_t size) : data_(data), size_(size){}
+
+		const T *data() const { return data_; }
+		size_t size() const { return size_; }
+		size_t bytes() const { return size_ * sizeof(T); }
+		bool empty() const { return size_ == 0; }
+
+		const T &operator[](size_t i) const { return data_[i]; }
+		const T *begin() const { return data_; }
+		const T *end() const { return data_ + size_; }
+	};
+
+}// namespace tpot
+#endif // TPOT_SPAN_H__
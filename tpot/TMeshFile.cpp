@@ -0,0 +1,824 @@
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include "Lz4.h"
+#include "MeshOptimizer.h"
+#include "SDKMeshParser.h"
+#include "ThreadPool.h"
+#include "TMeshFile.h"
+
+namespace tpot
+{
+
+namespace
+{
+	const char *const ERROR_NAME[TMESH_ERROR::MAX] = {
+		"none",
+		"truncated",
+		"magic",
+		"version",
+		"section",
+		"stream",
+		"index_buffer",
+		"mesh",
+		"subset",
+		"draw",
+		"string",
+	};
+
+	inline bool fits(unsigned long long offset, unsigned long long bytes, unsigned long long limit)
+	{
+		return offset <= limit && bytes <= limit - offset;
+	}
+
+	inline bool metadataType(unsigned type)
+	{
+		return type < TMESH_SECTION_TYPE::VERTEX_DATA;
+	}
+
+	// D3D11_PRIMITIVE_TOPOLOGY values a draw may use
+	inline bool validTopology(unsigned topology)
+	{
+		return (1 <= topology && topology <= 5) || (10 <= topology && topology <= 13) || (33 <= topology && topology <= 64);
+	}
+
+	// SDKMESH_PRIMITIVE_TYPE to D3D11_PRIMITIVE_TOPOLOGY
+	const unsigned TOPOLOGY[SDKMESH_PRIMITIVE_TYPES] = { 4, 5, 2, 3, 1, 12, 13, 10, 11, 36, 35 };
+
+	// D3DDECLTYPE to DXGI_FORMAT; D3DDECLTYPE_DEC3N has no DXGI twin
+	const unsigned DECL_TYPES = 17;
+	const unsigned DECL_FORMAT[DECL_TYPES] = {
+		TMESH_FORMAT::R32_FLOAT,
+		TMESH_FORMAT::R32G32_FLOAT,
+		TMESH_FORMAT::R32G32B32_FLOAT,
+		TMESH_FORMAT::R32G32B32A32_FLOAT,
+		TMESH_FORMAT::B8G8R8A8_UNORM,
+		TMESH_FORMAT::R8G8B8A8_UINT,
+		TMESH_FORMAT::R16G16_SINT,
+		TMESH_FORMAT::R16G16B16A16_SINT,
+		TMESH_FORMAT::R8G8B8A8_UNORM,
+		TMESH_FORMAT::R16G16_SNORM,
+		TMESH_FORMAT::R16G16B16A16_SNORM,
+		TMESH_FORMAT::R16G16_UNORM,
+		TMESH_FORMAT::R16G16B16A16_UNORM,
+		TMESH_FORMAT::R10G10B10A2_UINT,
+		TMESH_FORMAT::UNKNOWN,
+		TMESH_FORMAT::R16G16_FLOAT,
+		TMESH_FORMAT::R16G16B16A16_FLOAT,
+	};
+	const unsigned DECL_TYPE_UNUSED = 17;
+	const unsigned DECL_END_STREAM = 0xff;
+
+	// D3DDECLUSAGE to HLSL semantic names
+	const unsigned DECL_USAGES = 14;
+	const char *const DECL_SEMANTIC[DECL_USAGES] = {
+		"POSITION", "BLENDWEIGHT", "BLENDINDICES", "NORMAL", "PSIZE", "TEXCOORD", "TANGENT",
+		"BINORMAL", "TESSFACTOR", "POSITIONT", "COLOR", "FOG", "DEPTH", "SAMPLE",
+	};
+
+	// Zero terminated names, each stored once
+	class StringTable
+	{
+		std::vector<char> bytes_;
+		std::map<std::string, unsigned> ids_;
+
+	public:
+		unsigned add(const char *s)
+		{
+			if (!s || !s[0]) return TMESH_NO_STRING;
+			std::map<std::string, unsigned>::iterator it = ids_.find(s);
+			if (it != ids_.end()) return it->second;
+			unsigned id = (unsigned)bytes_.size();
+			bytes_.insert(bytes_.end(), s, s + strlen(s) + 1);
+			ids_[s] = id;
+			return id;
+		}
+		const std::vector<char> &bytes() const { return bytes_; }
+	};
+
+	template<class T>
+	void appendBytes(std::vector<unsigned char> *blob, const T *p, size_t count)
+	{
+		const unsigned char *b = (const unsigned char*)p;
+		blob->insert(blob->end(), b, b + count * sizeof(T));
+	}
+
+	inline void alignTo(std::vector<unsigned char> *out, size_t alignment)
+	{
+		out->resize((out->size() + alignment - 1) / alignment * alignment, 0);
+	}
+
+	// Meshes in the order RenderFrame draws them: a frame, its children,
+	// then its siblings, from frame 0. Every mesh once without frames.
+	std::vector<unsigned> drawList(const SDKMeshParser &src)
+	{
+		std::vector<unsigned> draws;
+		Span<SDKMESH_FILE_FRAME> frames = src.frames();
+		if (frames.empty()){
+			for (unsigned m = 0; m < src.meshes().size(); m++) draws.push_back(m);
+			return draws;
+		}
+		std::vector<unsigned> stack(1, 0);
+		while (!stack.empty()){
+			const SDKMESH_FILE_FRAME &f = frames[stack.back()];
+			stack.pop_back();
+			if (f.Mesh != SDKMESH_INVALID) draws.push_back(f.Mesh);
+			if (f.SiblingFrame != SDKMESH_INVALID) stack.push_back(f.SiblingFrame);
+			if (f.ChildFrame != SDKMESH_INVALID) stack.push_back(f.ChildFrame);
+		}
+		return draws;
+	}
+
+	const unsigned TOPOLOGY_TRIANGLELIST = 4;
+
+	// What optimizeMeshes() works on: the tables, parsed or about to be
+	// written, and vertex and index data it may rewrite in place
+	struct MESH_TABLES
+	{
+		Span<TMESH_STREAM>          streams;
+		Span<TMESH_INDEX_BUFFER>    index_buffers;
+		Span<TMESH_MESH>            meshes;
+		Span<TMESH_SUBSET>          subsets;
+		Span<char>                  strings;
+		std::vector<unsigned char*> vertices;	// per stream
+		std::vector<unsigned char*> indices;	// per index buffer
+	};
+
+	// One triangle list subset, reordered on its own
+	struct OPTIMIZE_TASK
+	{
+		unsigned            *indices;
+		unsigned            index_count;
+		const unsigned char *positions;	// nullptr: vertex cache order only
+		unsigned            stride;
+		unsigned            index_buffer;
+	};
+
+	// POSITION as three floats, base_vertex not applied
+	const unsigned char *meshPositions(const MESH_TABLES &t, const TMESH_MESH &mesh, unsigned *stride)
+	{
+		for (unsigned s = 0; s < mesh.stream_count; s++){
+			const TMESH_STREAM &stream = t.streams[mesh.streams[s]];
+			for (unsigned e = 0; e < stream.element_count; e++){
+				const TMESH_VERTEX_ELEMENT &element = stream.elements[e];
+				if (element.semantic < t.strings.size() && strcmp(t.strings.data() + element.semantic, "POSITION") == 0
+					&& element.semantic_index == 0 && element.format == TMESH_FORMAT::R32G32B32_FLOAT && t.vertices[mesh.streams[s]]){
+					*stride = stream.stride;
+					return t.vertices[mesh.streams[s]] + element.offset;
+				}
+			}
+		}
+		return nullptr;
+	}
+
+	// OptimizeMeshOrder for every triangle list subset, then fetch
+	// order for meshes that alone use their streams and index buffer, with
+	// no base_vertex. Subsets sharing indices are left alone.
+	unsigned optimizeMeshes(const MESH_TABLES &t, ThreadPool *pool)
+	{
+		std::vector<std::vector<unsigned> > wide(t.index_buffers.size());
+		for (unsigned i = 0; i < t.index_buffers.size(); i++){
+			const TMESH_INDEX_BUFFER &ib = t.index_buffers[i];
+			wide[i].resize(ib.index_count);
+			for (unsigned k = 0; k < ib.index_count; k++){
+				if (ib.format == TMESH_FORMAT::R32_UINT){
+					memcpy(&wide[i][k], t.indices[i] + k * 4, 4);
+				}else{
+					unsigned short v;
+					memcpy(&v, t.indices[i] + k * 2, 2);
+					wide[i][k] = v;
+				}
+			}
+		}
+
+		std::vector<unsigned> stream_users(t.streams.size(), 0), index_users(t.index_buffers.size(), 0);
+		std::vector<char> usable(t.meshes.size(), 1);
+		std::vector<unsigned> vertex_counts(t.meshes.size(), ~0u);
+		for (unsigned m = 0; m < t.meshes.size(); m++){
+			const TMESH_MESH &mesh = t.meshes[m];
+			if (TMESH_MAX_STREAMS < mesh.stream_count || t.index_buffers.size() <= mesh.index_buffer
+				|| t.subsets.size() < (size_t)mesh.first_subset + mesh.subset_count){
+				usable[m] = 0;
+				continue;
+			}
+			for (unsigned s = 0; s < mesh.stream_count; s++){
+				if (t.streams.size() <= mesh.streams[s]){
+					usable[m] = 0;
+					break;
+				}
+				stream_users[mesh.streams[s]]++;
+				vertex_counts[m] = std::min(vertex_counts[m], t.streams[mesh.streams[s]].vertex_count);
+			}
+			index_users[mesh.index_buffer]++;
+		}
+
+		std::vector<OPTIMIZE_TASK> tasks;
+		std::vector<std::vector<std::pair<unsigned, unsigned> > > ranges(t.index_buffers.size());
+		for (unsigned m = 0; m < t.meshes.size(); m++){
+			const TMESH_MESH &mesh = t.meshes[m];
+			if (!usable[m] || mesh.stream_count == 0) continue;
+			unsigned stride = 0;
+			const unsigned char *positions = meshPositions(t, mesh, &stride);
+			const std::vector<unsigned> &indices = wide[mesh.index_buffer];
+			for (unsigned k = 0; k < mesh.subset_count; k++){
+				const TMESH_SUBSET &subset = t.subsets[mesh.first_subset + k];
+				unsigned count = subset.index_count / 3 * 3;
+				if (subset.topology != TOPOLOGY_TRIANGLELIST || count < 6 || subset.base_vertex < 0
+					|| vertex_counts[m] <= (unsigned)subset.base_vertex || indices.size() < (size_t)subset.index_start + count) continue;
+				unsigned vertex_count = vertex_counts[m] - (unsigned)subset.base_vertex;
+				bool in_range = true;
+				for (unsigned i = 0; i < count; i++) in_range = in_range && indices[subset.index_start + i] < vertex_count;
+				if (!in_range) continue;
+
+				OPTIMIZE_TASK task;
+				task.indices = &wide[mesh.index_buffer][subset.index_start];
+				task.index_count = count;
+				task.positions = positions ? positions + (size_t)subset.base_vertex * stride : nullptr;
+				task.stride = stride;
+				task.index_buffer = mesh.index_buffer;
+				tasks.push_back(task);
+				ranges[mesh.index_buffer].push_back(std::make_pair(subset.index_start, count));
+			}
+		}
+
+		std::vector<char> shared(t.index_buffers.size(), 0);
+		for (unsigned i = 0; i < ranges.size(); i++){
+			std::sort(ranges[i].begin(), ranges[i].end());
+			for (size_t k = 1; k < ranges[i].size(); k++){
+				if (ranges[i][k].first < ranges[i][k - 1].first + ranges[i][k - 1].second) shared[i] = 1;
+			}
+		}
+		tasks.erase(std::remove_if(tasks.begin(), tasks.end(), [&](const OPTIMIZE_TASK &task){ return shared[task.index_buffer] != 0; }),
+			tasks.end());
+
+		// on dense ids in the same order, so the cost follows the subset and
+		// not the vertex buffer it shares with the others
+		auto reorder = [&](unsigned i){
+			const OPTIMIZE_TASK &task = tasks[i];
+			std::vector<unsigned> used(task.indices, task.indices + task.index_count);
+			std::sort(used.begin(), used.end());
+			used.erase(std::unique(used.begin(), used.end()), used.end());
+			std::vector<unsigned> local(task.index_count), ordered(task.index_count);
+			for (unsigned k = 0; k < task.index_count; k++){
+				local[k] = (unsigned)(std::lower_bound(used.begin(), used.end(), task.indices[k]) - used.begin());
+			}
+
+			std::vector<float> positions;
+			if (task.positions){
+				positions.resize(used.size() * 3);
+				for (size_t v = 0; v < used.size(); v++) memcpy(&positions[v * 3], task.positions + (size_t)used[v] * task.stride, 3 * sizeof(float));
+			}
+			OptimizeMeshOrder(ordered.data(), local.data(), local.size(), task.positions ? positions.data() : nullptr, used.size(), 3 * sizeof(float));
+			for (unsigned k = 0; k < task.index_count; k++) task.indices[k] = used[ordered[k]];
+		};
+		if (pool){
+			pool->parallelFor((unsigned)tasks.size(), reorder);
+		}else{
+			for (unsigned i = 0; i < tasks.size(); i++) reorder(i);
+		}
+
+		std::vector<char> dirty(t.index_buffers.size(), 0);
+		for (const OPTIMIZE_TASK &task : tasks) dirty[task.index_buffer] = 1;
+
+		// a strip's cut value or a base_vertex would need more than a relabelling
+		for (unsigned m = 0; m < t.meshes.size(); m++){
+			const TMESH_MESH &mesh = t.meshes[m];
+			if (!usable[m] || mesh.stream_count == 0 || index_users[mesh.index_buffer] != 1 || shared[mesh.index_buffer]) continue;
+			bool owned = true;
+			for (unsigned s = 0; s < mesh.stream_count; s++){
+				const TMESH_STREAM &stream = t.streams[mesh.streams[s]];
+				owned = owned && stream_users[mesh.streams[s]] == 1 && stream.vertex_count == vertex_counts[m] && t.vertices[mesh.streams[s]];
+			}
+			for (unsigned k = 0; k < mesh.subset_count; k++){
+				const TMESH_SUBSET &subset = t.subsets[mesh.first_subset + k];
+				owned = owned && subset.topology == TOPOLOGY_TRIANGLELIST && subset.base_vertex == 0;
+			}
+			std::vector<unsigned> &indices = wide[mesh.index_buffer];
+			for (size_t i = 0; owned && i < indices.size(); i++) owned = indices[i] < vertex_counts[m];
+			if (!owned || indices.empty()) continue;
+
+			std::vector<unsigned> remap(vertex_counts[m]);
+			OptimizeVertexFetchRemap(remap.data(), indices.data(), indices.size(), remap.size());
+			RemapIndices(indices.data(), indices.data(), indices.size(), remap.data());
+			for (unsigned s = 0; s < mesh.stream_count; s++){
+				const TMESH_STREAM &stream = t.streams[mesh.streams[s]];
+				unsigned char *data = t.vertices[mesh.streams[s]];
+				std::vector<unsigned char> copy(data, data + (size_t)stream.vertex_count * stream.stride);
+				RemapVertices(data, copy.data(), stream.vertex_count, stream.stride, remap.data());
+			}
+			dirty[mesh.index_buffer] = 1;
+		}
+
+		for (unsigned i = 0; i < t.index_buffers.size(); i++){
+			if (!dirty[i]) continue;
+			for (unsigned k = 0; k < wide[i].size(); k++){
+				if (t.index_buffers[i].format == TMESH_FORMAT::R32_UINT){
+					memcpy(t.indices[i] + k * 4, &wide[i][k], 4);
+				}else{
+					unsigned short v = (unsigned short)wide[i][k];
+					memcpy(t.indices[i] + k * 2, &v, 2);
+				}
+			}
+		}
+		return (unsigned)tasks.size();
+	}
+}// namespace
+
+const char *TMeshErrorName(TMESH_ERROR::ID id)
+{
+	return (0 <= id && id < TMESH_ERROR::MAX) ? ERROR_NAME[id] : "unknown";
+}
+
+unsigned TMeshFormatBytes(unsigned format)
+{
+	switch (format){
+	case TMESH_FORMAT::R32G32B32A32_FLOAT: return 16;
+	case TMESH_FORMAT::R32G32B32_FLOAT: return 12;
+	case TMESH_FORMAT::R16G16B16A16_FLOAT:
+	case TMESH_FORMAT::R16G16B16A16_UNORM:
+	case TMESH_FORMAT::R16G16B16A16_SNORM:
+	case TMESH_FORMAT::R16G16B16A16_SINT:
+	case TMESH_FORMAT::R32G32_FLOAT: return 8;
+	case TMESH_FORMAT::R10G10B10A2_UINT:
+	case TMESH_FORMAT::R8G8B8A8_UNORM:
+	case TMESH_FORMAT::R8G8B8A8_UINT:
+	case TMESH_FORMAT::R16G16_FLOAT:
+	case TMESH_FORMAT::R16G16_UNORM:
+	case TMESH_FORMAT::R16G16_SNORM:
+	case TMESH_FORMAT::R16G16_SINT:
+	case TMESH_FORMAT::R32_FLOAT:
+	case TMESH_FORMAT::R32_UINT:
+	case TMESH_FORMAT::B8G8R8A8_UNORM: return 4;
+	case TMESH_FORMAT::R16_UINT: return 2;
+	}
+	return 0;
+}
+
+TMeshReader::TMeshReader()
+{
+	clear();
+}
+
+void TMeshReader::clear()
+{
+	data_ = nullptr;
+	size_ = 0;
+	memset(&header_, 0, sizeof(header_));
+	error_ = TMESH_ERROR::NONE;
+	error_item_ = 0;
+
+	sections_ = Span<TMESH_SECTION>();
+	streams_ = Span<TMESH_STREAM>();
+	index_buffers_ = Span<TMESH_INDEX_BUFFER>();
+	meshes_ = Span<TMESH_MESH>();
+	subsets_ = Span<TMESH_SUBSET>();
+	materials_ = Span<TMESH_MATERIAL>();
+	draws_ = Span<unsigned>();
+	strings_ = Span<char>();
+}
+
+TMESH_ERROR::ID TMeshReader::fail(TMESH_ERROR::ID id, unsigned item)
+{
+	TMESH_HEADER header = header_;
+	clear();
+	header_ = header;
+	error_ = id;
+	error_item_ = item;
+	return id;
+}
+
+// The first section of the type, count elements; none at all for 0
+template<class T>
+bool TMeshReader::metadata(TMESH_SECTION_TYPE::ID type, unsigned count, Span<T> *out) const
+{
+	*out = Span<T>();
+	for (const TMESH_SECTION &s : sections_){
+		if (s.type != (unsigned)type) continue;
+		if (s.bytes != (unsigned long long)count * sizeof(T)) return false;
+		*out = Span<T>((const T*)(data_ + s.offset), count);
+		return true;
+	}
+	return count == 0;
+}
+
+bool TMeshReader::dataSection(unsigned section, TMESH_SECTION_TYPE::ID type, unsigned long long bytes) const
+{
+	return section < sections_.size() && sections_[section].type == (unsigned)type && sections_[section].bytes == bytes;
+}
+
+TMESH_ERROR::ID TMeshReader::parse(const void *data, size_t size)
+{
+	clear();
+	if (!data || size < sizeof(header_)) return fail(TMESH_ERROR::TRUNCATED, 0);
+	memcpy(&header_, data, sizeof(header_));
+	if (header_.magic != TMESH_MAGIC) return fail(TMESH_ERROR::MAGIC, 0);
+	if (header_.version != TMESH_VERSION) return fail(TMESH_ERROR::VERSION, 0);
+	if (size < header_.header_bytes || header_.file_bytes < header_.header_bytes) return fail(TMESH_ERROR::TRUNCATED, 0);
+	if (header_.header_bytes < sizeof(header_)
+		|| (header_.header_bytes - sizeof(header_)) / sizeof(TMESH_SECTION) < header_.section_count) return fail(TMESH_ERROR::SECTION, 0);
+	if ((size_t)data % sizeof(unsigned long long) != 0) return fail(TMESH_ERROR::SECTION, 0);	// for the tables in place
+
+	data_ = (const unsigned char*)data;
+	size_ = size;
+	sections_ = Span<TMESH_SECTION>((const TMESH_SECTION*)(data_ + sizeof(header_)), header_.section_count);
+	for (unsigned i = 0; i < sections_.size(); i++){
+		const TMESH_SECTION &s = sections_[i];
+		if (TMESH_SECTION_TYPE::MAX <= s.type || TMESH_COMPRESSION::MAX <= s.compression
+			|| s.offset % TMESH_ALIGNMENT != 0) return fail(TMESH_ERROR::SECTION, i);
+		if (metadataType(s.type)){
+			// inside the single read, as is
+			if (s.compression != TMESH_COMPRESSION::NONE || s.stored_bytes != s.bytes
+				|| s.offset < sizeof(header_) + sections_.bytes() || !fits(s.offset, s.bytes, header_.header_bytes)) return fail(TMESH_ERROR::SECTION, i);
+		}else{
+			if (s.offset < header_.header_bytes || !fits(s.offset, s.stored_bytes, header_.file_bytes)) return fail(TMESH_ERROR::SECTION, i);
+			if (s.compression == TMESH_COMPRESSION::NONE ? s.stored_bytes != s.bytes : Lz4CompressBound((size_t)s.bytes) < s.stored_bytes){
+				return fail(TMESH_ERROR::SECTION, i);
+			}
+		}
+	}
+
+	if (!metadata(TMESH_SECTION_TYPE::STREAMS, header_.stream_count, &streams_)
+		|| !metadata(TMESH_SECTION_TYPE::INDEX_BUFFERS, header_.index_buffer_count, &index_buffers_)
+		|| !metadata(TMESH_SECTION_TYPE::MESHES, header_.mesh_count, &meshes_)
+		|| !metadata(TMESH_SECTION_TYPE::SUBSETS, header_.subset_count, &subsets_)
+		|| !metadata(TMESH_SECTION_TYPE::MATERIALS, header_.material_count, &materials_)
+		|| !metadata(TMESH_SECTION_TYPE::DRAWS, header_.draw_count, &draws_)) return fail(TMESH_ERROR::SECTION, header_.section_count);
+	if (!metadata(TMESH_SECTION_TYPE::STRINGS, header_.string_bytes, &strings_)
+		|| (!strings_.empty() && strings_[strings_.size() - 1] != 0)) return fail(TMESH_ERROR::STRING, 0);
+
+	for (unsigned i = 0; i < streams_.size(); i++){
+		const TMESH_STREAM &s = streams_[i];
+		if (!dataSection(s.section, TMESH_SECTION_TYPE::VERTEX_DATA, (unsigned long long)s.vertex_count * s.stride)
+			|| TMESH_MAX_ELEMENTS < s.element_count) return fail(TMESH_ERROR::STREAM, i);
+		for (unsigned e = 0; e < s.element_count; e++){
+			const TMESH_VERTEX_ELEMENT &element = s.elements[e];
+			unsigned bytes = TMeshFormatBytes(element.format);
+			if (element.semantic == TMESH_NO_STRING || !validString(element.semantic)) return fail(TMESH_ERROR::STRING, i);
+			if (bytes == 0 || !fits(element.offset, bytes, s.stride)) return fail(TMESH_ERROR::STREAM, i);
+		}
+	}
+
+	for (unsigned i = 0; i < index_buffers_.size(); i++){
+		const TMESH_INDEX_BUFFER &ib = index_buffers_[i];
+		if (ib.format != TMESH_FORMAT::R16_UINT && ib.format != TMESH_FORMAT::R32_UINT) return fail(TMESH_ERROR::INDEX_BUFFER, i);
+		if (!dataSection(ib.section, TMESH_SECTION_TYPE::INDEX_DATA, (unsigned long long)ib.index_count * TMeshFormatBytes(ib.format))){
+			return fail(TMESH_ERROR::INDEX_BUFFER, i);
+		}
+	}
+
+	for (unsigned i = 0; i < subsets_.size(); i++){
+		const TMESH_SUBSET &subset = subsets_[i];
+		if (!validString(subset.name)) return fail(TMESH_ERROR::STRING, i);
+		if (!validTopology(subset.topology) || header_.material_count <= subset.material || subset.base_vertex < 0){
+			return fail(TMESH_ERROR::SUBSET, i);
+		}
+	}
+
+	for (unsigned i = 0; i < meshes_.size(); i++){
+		const TMESH_MESH &mesh = meshes_[i];
+		if (!validString(mesh.name)) return fail(TMESH_ERROR::STRING, i);
+		if (mesh.stream_count == 0 || TMESH_MAX_STREAMS < mesh.stream_count || header_.index_buffer_count <= mesh.index_buffer
+			|| !fits(mesh.first_subset, mesh.subset_count, header_.subset_count)) return fail(TMESH_ERROR::MESH, i);
+		unsigned vertices = ~0u;
+		for (unsigned s = 0; s < mesh.stream_count; s++){
+			if (header_.stream_count <= mesh.streams[s]) return fail(TMESH_ERROR::MESH, i);
+			unsigned n = streams_[mesh.streams[s]].vertex_count;
+			vertices = (n < vertices) ? n : vertices;
+		}
+		const TMESH_INDEX_BUFFER &ib = index_buffers_[mesh.index_buffer];
+		for (unsigned k = 0; k < mesh.subset_count; k++){
+			const TMESH_SUBSET &subset = subsets_[mesh.first_subset + k];
+			if (!fits(subset.index_start, subset.index_count, ib.index_count) || vertices < (unsigned)subset.base_vertex){
+				return fail(TMESH_ERROR::SUBSET, mesh.first_subset + k);
+			}
+		}
+	}
+
+	for (unsigned i = 0; i < materials_.size(); i++){
+		const TMESH_MATERIAL &m = materials_[i];
+		if (!validString(m.name) || !validString(m.diffuse_texture) || !validString(m.normal_texture)
+			|| !validString(m.specular_texture)) return fail(TMESH_ERROR::STRING, i);
+	}
+
+	for (unsigned i = 0; i < draws_.size(); i++){
+		if (header_.mesh_count <= draws_[i]) return fail(TMESH_ERROR::DRAW, i);
+	}
+	return TMESH_ERROR::NONE;
+}
+
+bool TMeshReader::hasData(unsigned section) const
+{
+	return section < sections_.size() && fits(sections_[section].offset, sections_[section].stored_bytes, size_);
+}
+
+bool TMeshReader::read(unsigned section, void *dst) const
+{
+	if (!hasData(section)) return false;
+	return decode(sections_[section], data_ + sections_[section].offset, dst);
+}
+
+bool TMeshReader::decode(const TMESH_SECTION &section, const void *stored, void *dst)
+{
+	switch (section.compression){
+	case TMESH_COMPRESSION::NONE:
+		if (section.bytes) memcpy(dst, stored, (size_t)section.bytes);
+		return true;
+	case TMESH_COMPRESSION::LZ4:
+		return Lz4Decompress(stored, (size_t)section.stored_bytes, dst, (size_t)section.bytes);
+	}
+	return false;
+}
+
+TMESH_ERROR::ID TMeshData::load(const char *path)
+{
+	if (!file_.open(path)) return TMESH_ERROR::TRUNCATED;
+	return decodeAll();
+}
+
+#ifdef _WIN32
+TMESH_ERROR::ID TMeshData::load(const wchar_t *path)
+{
+	if (!file_.open(path)) return TMESH_ERROR::TRUNCATED;
+	return decodeAll();
+}
+#endif
+
+TMESH_ERROR::ID TMeshData::decodeAll()
+{
+	TMESH_ERROR::ID id = reader_.parse(file_.data(), file_.size());
+	if (id != TMESH_ERROR::NONE) return id;
+
+	decoded_.clear();
+	decoded_.reserve(reader_.sections().size());	// data_ points into them
+	data_.assign(reader_.sections().size(), nullptr);
+	for (unsigned i = 0; i < reader_.sections().size(); i++){
+		const TMESH_SECTION &s = reader_.sections()[i];
+		if (s.type < TMESH_SECTION_TYPE::VERTEX_DATA) continue;
+		if (s.compression == TMESH_COMPRESSION::NONE){
+			data_[i] = file_.data() + s.offset;
+			continue;
+		}
+		decoded_.push_back(std::vector<unsigned char>((size_t)s.bytes));
+		if (!reader_.read(i, decoded_.back().data())) return TMESH_ERROR::SECTION;
+		data_[i] = decoded_.back().data();
+	}
+	return TMESH_ERROR::NONE;
+}
+
+unsigned TMeshData::optimize(ThreadPool *pool)
+{
+	if (!reader_.valid()) return 0;
+
+	const unsigned char *mapped = file_.data();
+	for (unsigned i = 0; i < data_.size(); i++){
+		const TMESH_SECTION &s = reader_.sections()[i];
+		if (!data_[i] || s.bytes == 0 || data_[i] < mapped || mapped + file_.size() <= data_[i]) continue;
+		decoded_.push_back(std::vector<unsigned char>(data_[i], data_[i] + (size_t)s.bytes));
+		data_[i] = decoded_.back().data();
+	}
+
+	// every data section with bytes now lives in decoded_
+	MESH_TABLES t;
+	t.streams = reader_.streams();
+	t.index_buffers = reader_.indexBuffers();
+	t.meshes = reader_.meshes();
+	t.subsets = reader_.subsets();
+	t.strings = Span<char>(reader_.string(0), reader_.header().string_bytes);
+	for (const TMESH_STREAM &s : reader_.streams()) t.vertices.push_back(s.vertex_count ? const_cast<unsigned char*>(data_[s.section]) : nullptr);
+	for (const TMESH_INDEX_BUFFER &ib : reader_.indexBuffers()) t.indices.push_back(ib.index_count ? const_cast<unsigned char*>(data_[ib.section]) : nullptr);
+	return optimizeMeshes(t, pool);
+}
+
+size_t TMeshData::decodedBytes() const
+{
+	size_t bytes = 0;
+	for (const auto &d : decoded_) bytes += d.size();
+	return bytes;
+}
+
+bool TMeshConvert(const SDKMeshParser &src, unsigned flags, std::vector<unsigned char> *out, std::string *error)
+{
+	if (!src.valid()){
+		*error = "source not parsed";
+		return false;
+	}
+
+	StringTable strings;
+	std::vector<TMESH_STREAM> streams;
+	std::vector<TMESH_INDEX_BUFFER> index_buffers;
+	std::vector<TMESH_MESH> meshes;
+	std::vector<TMESH_SUBSET> subsets;
+	std::vector<TMESH_MATERIAL> materials;
+	std::vector<std::vector<unsigned char> > vertex_data, index_data;
+
+	for (unsigned i = 0; i < src.vertexBuffers().size(); i++){
+		const SDKMESH_FILE_VERTEX_BUFFER &vb = src.vertexBuffers()[i];
+		if (0xffffffffull < vb.NumVertices || 0xffffffffull < vb.StrideBytes){
+			*error = "vertex buffer " + std::to_string(i) + ": count past 32 bits";
+			return false;
+		}
+		TMESH_STREAM s;
+		memset(&s, 0, sizeof(s));
+		s.vertex_count = (unsigned)vb.NumVertices;
+		s.stride = (unsigned)vb.StrideBytes;
+		for (const SDKMESH_FILE_VERTEX_ELEMENT &e : vb.Decl){
+			if (e.Stream == DECL_END_STREAM || e.Type == DECL_TYPE_UNUSED) break;
+			if (DECL_TYPES <= e.Type || DECL_FORMAT[e.Type] == TMESH_FORMAT::UNKNOWN || DECL_USAGES <= e.Usage){
+				*error = "vertex buffer " + std::to_string(i) + ": no DXGI format for D3DDECLTYPE " + std::to_string(e.Type);
+				return false;
+			}
+			if (TMESH_MAX_ELEMENTS <= s.element_count){
+				*error = "vertex buffer " + std::to_string(i) + ": more than " + std::to_string(TMESH_MAX_ELEMENTS) + " elements";
+				return false;
+			}
+			TMESH_VERTEX_ELEMENT &element = s.elements[s.element_count++];
+			element.semantic = strings.add(DECL_SEMANTIC[e.Usage]);
+			element.semantic_index = e.UsageIndex;
+			element.format = DECL_FORMAT[e.Type];
+			element.offset = e.Offset;
+		}
+		streams.push_back(s);
+
+		// padding past the last vertex is dropped
+		const unsigned char *p = src.vertexData(i).data();
+		vertex_data.push_back(std::vector<unsigned char>(p, p + (size_t)(vb.NumVertices * vb.StrideBytes)));
+	}
+
+	for (unsigned i = 0; i < src.indexBuffers().size(); i++){
+		const SDKMESH_FILE_INDEX_BUFFER &ib = src.indexBuffers()[i];
+		if (0xffffffffull < ib.NumIndices){
+			*error = "index buffer " + std::to_string(i) + ": count past 32 bits";
+			return false;
+		}
+		std::vector<unsigned> indices((size_t)ib.NumIndices);
+		unsigned max_index = 0;
+		const unsigned char *p = src.indexData(i).data();
+		for (size_t k = 0; k < indices.size(); k++){
+			if (ib.IndexType){
+				memcpy(&indices[k], p + k * 4, 4);
+			}else{
+				unsigned short v;
+				memcpy(&v, p + k * 2, 2);
+				indices[k] = v;
+			}
+			max_index = (max_index < indices[k]) ? indices[k] : max_index;
+		}
+
+		// 0xffff is the strip cut value, so narrowing stops below it
+		TMESH_INDEX_BUFFER t;
+		memset(&t, 0, sizeof(t));
+		t.index_count = (unsigned)ib.NumIndices;
+		t.format = (ib.IndexType && ((flags & TMESH_CONVERT::INDEX32) || 0xffff <= max_index)) ? TMESH_FORMAT::R32_UINT : TMESH_FORMAT::R16_UINT;
+		index_buffers.push_back(t);
+
+		std::vector<unsigned char> data;
+		if (t.format == TMESH_FORMAT::R32_UINT){
+			appendBytes(&data, indices.data(), indices.size());
+		}else{
+			std::vector<unsigned short> narrow(indices.begin(), indices.end());
+			appendBytes(&data, narrow.data(), narrow.size());
+		}
+		index_data.push_back(data);
+	}
+
+	for (unsigned m = 0; m < src.meshes().size(); m++){
+		const SDKMESH_FILE_MESH &mesh = src.meshes()[m];
+		TMESH_MESH t;
+		memset(&t, 0, sizeof(t));
+		t.name = strings.add(mesh.Name);
+		t.stream_count = mesh.NumVertexBuffers;
+		for (unsigned s = 0; s < mesh.NumVertexBuffers; s++) t.streams[s] = mesh.VertexBuffers[s];
+		t.index_buffer = mesh.IndexBuffer;
+		t.first_subset = (unsigned)subsets.size();
+		t.subset_count = mesh.NumSubsets;
+		const SDKMeshParser::BOUNDS &bounds = src.meshBounds(m);
+		memcpy(t.center, bounds.center, sizeof(t.center));
+		memcpy(t.extents, bounds.extents, sizeof(t.extents));
+		meshes.push_back(t);
+
+		for (unsigned id : src.meshSubsets(m)){
+			const SDKMESH_FILE_SUBSET &subset = src.subsets()[id];
+			if (0xffffffffull < subset.IndexStart + subset.IndexCount || 0x7fffffffull < subset.VertexStart){
+				*error = "subset " + std::to_string(id) + ": range past 32 bits";
+				return false;
+			}
+			TMESH_SUBSET s;
+			s.name = strings.add(subset.Name);
+			s.topology = TOPOLOGY[subset.PrimitiveType];
+			s.material = subset.MaterialID;
+			s.index_start = (unsigned)subset.IndexStart;
+			s.index_count = (unsigned)subset.IndexCount;
+			s.base_vertex = (int)subset.VertexStart;
+			subsets.push_back(s);
+		}
+	}
+
+	for (const SDKMESH_FILE_MATERIAL &m : src.materials()){
+		TMESH_MATERIAL t;
+		memset(&t, 0, sizeof(t));
+		t.name = strings.add(m.Name);
+		t.diffuse_texture = strings.add(m.DiffuseTexture);
+		t.normal_texture = strings.add(m.NormalTexture);
+		t.specular_texture = strings.add(m.SpecularTexture);
+		memcpy(t.diffuse, m.Diffuse, sizeof(t.diffuse));
+		memcpy(t.ambient, m.Ambient, sizeof(t.ambient));
+		memcpy(t.specular, m.Specular, sizeof(t.specular));
+		memcpy(t.emissive, m.Emissive, sizeof(t.emissive));
+		t.power = m.Power;
+		materials.push_back(t);
+	}
+
+	std::vector<unsigned> draws = drawList(src);
+
+	// metadata blobs in section order, then the data
+	struct BLOB
+	{
+		TMESH_SECTION_TYPE::ID type;
+		std::vector<unsigned char> bytes;
+	};
+	std::vector<BLOB> blobs(TMESH_SECTION_TYPE::VERTEX_DATA);
+	for (unsigned t = 0; t < blobs.size(); t++) blobs[t].type = (TMESH_SECTION_TYPE::ID)t;
+	if (flags & TMESH_CONVERT::OPTIMIZE){
+		MESH_TABLES t;
+		t.streams = Span<TMESH_STREAM>(streams.data(), streams.size());
+		t.index_buffers = Span<TMESH_INDEX_BUFFER>(index_buffers.data(), index_buffers.size());
+		t.meshes = Span<TMESH_MESH>(meshes.data(), meshes.size());
+		t.subsets = Span<TMESH_SUBSET>(subsets.data(), subsets.size());
+		t.strings = Span<char>(strings.bytes().data(), strings.bytes().size());
+		for (std::vector<unsigned char> &v : vertex_data) t.vertices.push_back(v.empty() ? nullptr : v.data());
+		for (std::vector<unsigned char> &i : index_data) t.indices.push_back(i.empty() ? nullptr : i.data());
+		optimizeMeshes(t, nullptr);
+	}
+	appendBytes(&blobs[TMESH_SECTION_TYPE::MESHES].bytes, meshes.data(), meshes.size());
+	appendBytes(&blobs[TMESH_SECTION_TYPE::SUBSETS].bytes, subsets.data(), subsets.size());
+	appendBytes(&blobs[TMESH_SECTION_TYPE::MATERIALS].bytes, materials.data(), materials.size());
+	appendBytes(&blobs[TMESH_SECTION_TYPE::DRAWS].bytes, draws.data(), draws.size());
+	appendBytes(&blobs[TMESH_SECTION_TYPE::STRINGS].bytes, strings.bytes().data(), strings.bytes().size());
+
+	// stream i is section VERTEX_DATA + i, index buffer i follows the streams;
+	// their tables go in once the section ids are known
+	for (unsigned i = 0; i < streams.size(); i++){
+		streams[i].section = (unsigned)blobs.size();
+		BLOB b = { TMESH_SECTION_TYPE::VERTEX_DATA, vertex_data[i] };
+		blobs.push_back(b);
+	}
+	for (unsigned i = 0; i < index_buffers.size(); i++){
+		index_buffers[i].section = (unsigned)blobs.size();
+		BLOB b = { TMESH_SECTION_TYPE::INDEX_DATA, index_data[i] };
+		blobs.push_back(b);
+	}
+	appendBytes(&blobs[TMESH_SECTION_TYPE::STREAMS].bytes, streams.data(), streams.size());
+	appendBytes(&blobs[TMESH_SECTION_TYPE::INDEX_BUFFERS].bytes, index_buffers.data(), index_buffers.size());
+
+	TMESH_HEADER header;
+	memset(&header, 0, sizeof(header));
+	header.magic = TMESH_MAGIC;
+	header.version = TMESH_VERSION;
+	header.section_count = (unsigned)blobs.size();
+	header.stream_count = (unsigned)streams.size();
+	header.index_buffer_count = (unsigned)index_buffers.size();
+	header.mesh_count = (unsigned)meshes.size();
+	header.subset_count = (unsigned)subsets.size();
+	header.material_count = (unsigned)materials.size();
+	header.draw_count = (unsigned)draws.size();
+	header.string_bytes = (unsigned)strings.bytes().size();
+	header.flags = (flags & TMESH_CONVERT::OPTIMIZE) ? TMESH_FLAG::OPTIMIZED : 0;
+
+	std::vector<TMESH_SECTION> sections(blobs.size());
+	out->assign(sizeof(header) + sections.size() * sizeof(TMESH_SECTION), 0);
+	for (unsigned i = 0; i < blobs.size(); i++){
+		TMESH_SECTION &s = sections[i];
+		const std::vector<unsigned char> &raw = blobs[i].bytes;
+		s.type = blobs[i].type;
+		s.compression = TMESH_COMPRESSION::NONE;
+		s.bytes = raw.size();
+		if (i == TMESH_SECTION_TYPE::VERTEX_DATA){
+			alignTo(out, TMESH_ALIGNMENT);
+			header.header_bytes = (unsigned)out->size();
+		}
+
+		std::vector<unsigned char> packed;
+		if ((flags & TMESH_CONVERT::LZ4) && !metadataType(s.type) && !raw.empty()){
+			packed.resize(Lz4CompressBound(raw.size()));
+			packed.resize(Lz4Compress(raw.data(), raw.size(), packed.data(), packed.size()));
+			if (packed.size() < raw.size()) s.compression = TMESH_COMPRESSION::LZ4;
+		}
+		const std::vector<unsigned char> &stored = (s.compression == TMESH_COMPRESSION::LZ4) ? packed : raw;
+		alignTo(out, TMESH_ALIGNMENT);
+		s.offset = out->size();
+		s.stored_bytes = stored.size();
+		out->insert(out->end(), stored.begin(), stored.end());
+	}
+	if (blobs.size() == TMESH_SECTION_TYPE::VERTEX_DATA){
+		alignTo(out, TMESH_ALIGNMENT);
+		header.header_bytes = (unsigned)out->size();
+	}
+	alignTo(out, TMESH_ALIGNMENT);
+	header.file_bytes = out->size();
+
+	memcpy(out->data(), &header, sizeof(header));
+	memcpy(out->data() + sizeof(header), sections.data(), sections.size() * sizeof(TMESH_SECTION));
+	return true;
+}
+
+}// namespace tpot
@@ -0,0 +1,143 @@
+#ifndef TPOT_TMESH_FILE_H__
+#define TPOT_TMESH_FILE_H__
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "Span.h"
+#include "TMeshFormat.h"
+
+namespace tpot
+{
+
+	class SDKMeshParser;
+	class ThreadPool;
+
+	struct TMESH_ERROR{
+		enum ID{
+			NONE,
+			TRUNCATED,		// smaller than the header or header_bytes
+			MAGIC,
+			VERSION,
+			SECTION,		// misaligned, outside of the file, unknown type or compression
+			STREAM,			// data size, element format or offset
+			INDEX_BUFFER,
+			MESH,			// stream, index buffer or subset range out of range
+			SUBSET,			// index range, topology or material
+			DRAW,			// a mesh id out of range
+			STRING,			// outside of the strings, or strings not terminated
+
+			MAX,
+		};
+	};
+	const char *TMeshErrorName(TMESH_ERROR::ID id);
+
+	// Bytes of one element of a TMESH_FORMAT, 0 for an unknown one
+	unsigned TMeshFormatBytes(unsigned format);
+
+	// Validating reader of a .tmesh image. The image may stop at
+	// header_bytes: the metadata is then complete and the data sections are
+	// read by the caller straight into their destination and decoded with
+	// decode(). Views point into the image, which must outlive the reader.
+	class TMeshReader
+	{
+		const unsigned char *data_;
+		size_t size_;
+		TMESH_HEADER header_;
+		TMESH_ERROR::ID error_;
+		unsigned error_item_;
+
+		Span<TMESH_SECTION> sections_;
+		Span<TMESH_STREAM> streams_;
+		Span<TMESH_INDEX_BUFFER> index_buffers_;
+		Span<TMESH_MESH> meshes_;
+		Span<TMESH_SUBSET> subsets_;
+		Span<TMESH_MATERIAL> materials_;
+		Span<unsigned> draws_;
+		Span<char> strings_;
+
+		TMESH_ERROR::ID fail(TMESH_ERROR::ID id, unsigned item);
+		template<class T> bool metadata(TMESH_SECTION_TYPE::ID type, unsigned count, Span<T> *out) const;
+		bool validString(unsigned id) const { return id == TMESH_NO_STRING || id < strings_.size(); }
+		bool dataSection(unsigned section, TMESH_SECTION_TYPE::ID type, unsigned long long bytes) const;
+
+	public:
+		TMeshReader();
+
+		TMESH_ERROR::ID parse(const void *data, size_t size);
+		void clear();
+
+		TMESH_ERROR::ID error() const { return error_; }
+		unsigned errorItem() const { return error_item_; }
+		bool valid() const { return data_ != nullptr; }
+
+		const TMESH_HEADER &header() const { return header_; }
+		Span<TMESH_SECTION> sections() const { return sections_; }
+		Span<TMESH_STREAM> streams() const { return streams_; }
+		Span<TMESH_INDEX_BUFFER> indexBuffers() const { return index_buffers_; }
+		Span<TMESH_MESH> meshes() const { return meshes_; }
+		Span<TMESH_SUBSET> subsets() const { return subsets_; }
+		Span<TMESH_MATERIAL> materials() const { return materials_; }
+		Span<unsigned> draws() const { return draws_; }
+		const char *string(unsigned id) const { return (id < strings_.size()) ? strings_.data() + id : ""; }
+
+		// Stored bytes of a section when the image holds them
+		bool hasData(unsigned section) const;
+		// Decoded into dst, sections()[section].bytes long
+		bool read(unsigned section, void *dst) const;
+		static bool decode(const TMESH_SECTION &section, const void *stored, void *dst);
+	};
+
+	// The CPU half of loading a .tmesh, safe on a loader thread: the file
+	// mapped, validated and every compressed section decoded. data() is
+	// what goes to CreateBuffer, uncompressed sections straight from the
+	// mapping, which stays open as long as this does.
+	class TMeshData
+	{
+		MappedFile file_;
+		TMeshReader reader_;
+		std::vector<std::vector<unsigned char> > decoded_;
+		std::vector<const unsigned char*> data_;	// per section, nullptr for metadata
+
+		TMeshData(const TMeshData &);
+		TMeshData &operator=(const TMeshData &);
+
+		TMESH_ERROR::ID decodeAll();
+
+	public:
+		TMeshData(){}
+
+		// TRUNCATED for a missing or empty file, SECTION for a damaged compressed one
+		TMESH_ERROR::ID load(const char *path);
+#ifdef _WIN32
+		TMESH_ERROR::ID load(const wchar_t *path);
+#endif
+
+		// Triangle lists into OptimizeMeshOrder's order, subsets in
+		// parallel on pool when given, and vertices into fetch order where a
+		// mesh owns its buffers: what TMESH_CONVERT::OPTIMIZE does offline,
+		// for files without TMESH_FLAG::OPTIMIZED. Uncompressed sections are
+		// copied out of the mapping first. Returns the subsets reordered.
+		unsigned optimize(ThreadPool *pool = nullptr);
+
+		const TMeshReader &reader() const { return reader_; }
+		const void *data(unsigned section) const { return (section < data_.size()) ? data_[section] : nullptr; }
+		size_t decodedBytes() const;	// heap taken by compressed sections
+	};
+
+	struct TMESH_CONVERT{
+		enum{
+			LZ4 = 1,		// compress vertex and index data where it gets smaller
+			INDEX32 = 2,	// keep 32 bit indices that would fit in 16
+			OPTIMIZE = 4,	// see TMeshData::optimize(), sets TMESH_FLAG::OPTIMIZED
+		};
+	};
+
+	// .sdkmesh, already parsed, to .tmesh. false with the reason when the
+	// source has something .tmesh cannot hold (a D3D9 only vertex type,
+	// more than TMESH_MAX_ELEMENTS elements, counts past 32 bits).
+	bool TMeshConvert(const SDKMeshParser &src, unsigned flags, std::vector<unsigned char> *out, std::string *error);
+
+}// namespace tpot
+#endif // TPOT_TMESH_FILE_H__
@@ -0,0 +1,185 @@
+#ifndef TPOT_TMESH_FORMAT_H__
+#define TPOT_TMESH_FORMAT_H__
+
+namespace tpot
+{
+
+	// .tmesh: meshes laid out for the GPU, written by tools/tmesh_convert.
+	//
+	//   TMESH_HEADER
+	//   TMESH_SECTION[section_count]
+	//   metadata sections: streams, index buffers, meshes, subsets,
+	//                      materials, draw list, strings
+	//   ---- header_bytes: everything above comes in one read
+	//   vertex and index data sections, LZ4 compressed or not
+	//
+	// Every section starts on a TMESH_ALIGNMENT boundary. Formats and
+	// topologies are stored as their DXGI_FORMAT and
+	// D3D11_PRIMITIVE_TOPOLOGY values, names as offsets into the strings.
+	// Subsets of a mesh are contiguous, and the draw list is the frame
+	// hierarchy already walked, so nothing is resolved at load time.
+	const unsigned TMESH_MAGIC = 0x48534d54;	// "TMSH"
+	const unsigned TMESH_VERSION = 1;
+	const unsigned TMESH_NO_STRING = ~0u;
+
+	enum{
+		TMESH_ALIGNMENT = 64,
+		TMESH_MAX_ELEMENTS = 8,
+		TMESH_MAX_STREAMS = 16,
+	};
+
+	struct TMESH_FLAG{
+		enum{
+			OPTIMIZED = 1,	// triangle lists in vertex cache and overdraw order, vertices in fetch order
+		};
+	};
+
+	struct TMESH_SECTION_TYPE{
+		enum ID{
+			STREAMS,		// TMESH_STREAM[]
+			INDEX_BUFFERS,	// TMESH_INDEX_BUFFER[]
+			MESHES,			// TMESH_MESH[]
+			SUBSETS,		// TMESH_SUBSET[]
+			MATERIALS,		// TMESH_MATERIAL[]
+			DRAWS,			// unsigned[], mesh ids in drawing order
+			STRINGS,		// zero terminated, the last byte is 0
+			VERTEX_DATA,
+			INDEX_DATA,
+
+			MAX,
+		};
+	};
+
+	struct TMESH_COMPRESSION{
+		enum ID{
+			NONE,
+			LZ4,		// one LZ4 block, see Lz4.h
+
+			MAX,
+		};
+	};
+
+	// Values of DXGI_FORMAT
+	struct TMESH_FORMAT{
+		enum ID{
+			UNKNOWN = 0,
+			R32G32B32A32_FLOAT = 2,
+			R32G32B32_FLOAT = 6,
+			R16G16B16A16_FLOAT = 10,
+			R16G16B16A16_UNORM = 11,
+			R16G16B16A16_SNORM = 13,
+			R16G16B16A16_SINT = 14,
+			R32G32_FLOAT = 16,
+			R10G10B10A2_UINT = 25,
+			R8G8B8A8_UNORM = 28,
+			R8G8B8A8_UINT = 30,
+			R16G16_FLOAT = 34,
+			R16G16_UNORM = 35,
+			R16G16_SNORM = 37,
+			R16G16_SINT = 38,
+			R32_FLOAT = 41,
+			R32_UINT = 42,
+			R16_UINT = 57,
+			B8G8R8A8_UNORM = 87,
+		};
+	};
+
+	struct TMESH_HEADER
+	{
+		unsigned           magic;
+		unsigned           version;
+		unsigned           header_bytes;	// header, section table and metadata
+		unsigned           section_count;
+		unsigned long long file_bytes;
+		unsigned           stream_count;
+		unsigned           index_buffer_count;
+		unsigned           mesh_count;
+		unsigned           subset_count;
+		unsigned           material_count;
+		unsigned           draw_count;
+		unsigned           string_bytes;
+		unsigned           flags;			// TMESH_FLAG
+		unsigned           reserved[2];
+	};
+
+	struct TMESH_SECTION
+	{
+		unsigned           type;			// TMESH_SECTION_TYPE
+		unsigned           compression;	// TMESH_COMPRESSION
+		unsigned long long offset;
+		unsigned long long stored_bytes;	// in the file
+		unsigned long long bytes;			// once decompressed
+	};
+
+	struct TMESH_VERTEX_ELEMENT	// D3D11_INPUT_ELEMENT_DESC of one stream
+	{
+		unsigned semantic;		// string
+		unsigned semantic_index;
+		unsigned format;		// TMESH_FORMAT
+		unsigned offset;
+	};
+
+	struct TMESH_STREAM
+	{
+		unsigned section;		// VERTEX_DATA, vertex_count * stride bytes
+		unsigned vertex_count;
+		unsigned stride;
+		unsigned element_count;
+		TMESH_VERTEX_ELEMENT elements[TMESH_MAX_ELEMENTS];
+	};
+
+	struct TMESH_INDEX_BUFFER
+	{
+		unsigned section;		// INDEX_DATA
+		unsigned index_count;
+		unsigned format;		// R16_UINT or R32_UINT
+		unsigned reserved;
+	};
+
+	struct TMESH_MESH
+	{
+		unsigned name;
+		unsigned stream_count;
+		unsigned streams[TMESH_MAX_STREAMS];	// bound to input slots 0..stream_count-1
+		unsigned index_buffer;
+		unsigned first_subset;
+		unsigned subset_count;
+		float    center[3];
+		float    extents[3];
+		unsigned reserved;
+	};
+
+	struct TMESH_SUBSET
+	{
+		unsigned name;
+		unsigned topology;		// D3D11_PRIMITIVE_TOPOLOGY
+		unsigned material;
+		unsigned index_start;
+		unsigned index_count;
+		int      base_vertex;
+	};
+
+	struct TMESH_MATERIAL
+	{
+		unsigned name;
+		unsigned diffuse_texture;	// strings, TMESH_NO_STRING when there is none
+		unsigned normal_texture;
+		unsigned specular_texture;
+		float    diffuse[4];
+		float    ambient[4];
+		float    specular[4];
+		float    emissive[4];
+		float    power;
+		unsigned reserved[3];
+	};
+
+	static_assert(sizeof(TMESH_HEADER) == 64, "TMESH_HEADER");
+	static_assert(sizeof(TMESH_SECTION) == 32, "TMESH_SECTION");
+	static_assert(sizeof(TMESH_STREAM) == 144, "TMESH_STREAM");
+	static_assert(sizeof(TMESH_INDEX_BUFFER) == 16, "TMESH_INDEX_BUFFER");
+	static_assert(sizeof(TMESH_MESH) == 112, "TMESH_MESH");
+	static_assert(sizeof(TMESH_SUBSET) == 24, "TMESH_SUBSET");
+	static_assert(sizeof(TMESH_MATERIAL) == 96, "TMESH_MATERIAL");
+
+}// namespace tpot
+#endif // TPOT_TMESH_FORMAT_H__
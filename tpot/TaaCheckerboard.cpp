@@ -0,0 +1,182 @@
+#include <math.h>
+#include "TaaCheckerboard.h"
+#include "TaaReproject.h"
+#include "ThreadPool.h"
+
+namespace tpot
+{
+
+namespace
+{
+	// Neighbours past the edge are mirrored, which keeps them on shaded pixels
+	inline int mirror(int v, int size)
+	{
+		if (size < 2) return 0;
+		return (v < 0) ? -v : (size <= v) ? 2 * (size - 1) - v : v;
+	}
+
+	inline int clampi(int v, int lo, int hi){ return (v < lo) ? lo : (hi < v) ? hi : v; }
+
+	// Same weights as RGB2YCbCr
+	inline float luma(const float *rgba){ return rgba[0] * 0.29900f + rgba[1] * 0.58700f + rgba[2] * 0.11400f; }
+
+	template<class ROW>
+	void forRows(int height, ThreadPool *pool, const ROW &row)
+	{
+		if (pool){
+			pool->parallelFor(height, row);
+		}else{
+			for (int y = 0; y < height; y++) row((unsigned)y);
+		}
+	}
+
+	// Left, right, up, down of (x, y), all shaded when (x, y) is not
+	struct CROSS
+	{
+		const float *color[4];
+		int x[4], y[4];
+		bool edge_x, edge_y;	// the pair is one pixel twice
+
+		CROSS(const Image &scene, int px, int py)
+			: edge_x(px == 0 || px == scene.width - 1), edge_y(py == 0 || py == scene.height - 1)
+		{
+			static const int dx[4] = { -1, 1, 0, 0 };
+			static const int dy[4] = { 0, 0, -1, 1 };
+			for (int i = 0; i < 4; i++){
+				x[i] = mirror(px + dx[i], scene.width);
+				y[i] = mirror(py + dy[i], scene.height);
+				color[i] = scene.at(x[i], y[i]);
+			}
+		}
+
+		// Mean of the pair across the weaker luma gradient, of all four on a tie.
+		// On the edge of the image the pair along it is used.
+		void interpolate(float dst[4]) const
+		{
+			float h = fabsf(luma(color[0]) - luma(color[1]));
+			float v = fabsf(luma(color[2]) - luma(color[3]));
+			if (edge_x != edge_y){
+				h = edge_x ? 1.0f : 0.0f;
+				v = edge_y ? 1.0f : 0.0f;
+			}
+			for (int c = 0; c < 4; c++){
+				float horizontal = 0.5f * (color[0][c] + color[1][c]);
+				float vertical = 0.5f * (color[2][c] + color[3][c]);
+				dst[c] = (h < v) ? horizontal : (v < h) ? vertical : 0.5f * (horizontal + vertical);
+			}
+		}
+	};
+}// namespace
+
+bool CheckerboardDisoccluded(const TAA_DEPTH_REJECT &param, const Image &prev_depth, float u, float v, float d_min, float d_max)
+{
+	if (!(0.0f < param.threshold)) return false;
+	float z_min = LinearDepth(param, d_min) * (1.0f - param.threshold);
+	float z_max = LinearDepth(param, d_max) * (1.0f + param.threshold);
+
+	// the 2x2 texels of the bilinear history fetch, any of them may match
+	int x0 = (int)floorf(u * (float)prev_depth.width - 0.5f);
+	int y0 = (int)floorf(v * (float)prev_depth.height - 0.5f);
+	for (int j = 0; j < 2; j++){
+		for (int i = 0; i < 2; i++){
+			int x = clampi(x0 + i, 0, prev_depth.width - 1);
+			int y = clampi(y0 + j, 0, prev_depth.height - 1);
+			float z = LinearDepth(param, prev_depth.at(x, y)[0]);
+			if (z_min <= z && z <= z_max) return false;
+		}
+	}
+	return true;
+}
+
+void MaskCheckerboard(Image &color, Image *depth, unsigned phase, const float clear[4])
+{
+	for (int y = 0; y < color.height; y++){
+		for (int x = 0; x < color.width; x++){
+			if (CheckerboardShaded(x, y, phase)) continue;
+			float *dst = color.at(x, y);
+			for (int c = 0; c < 4; c++) dst[c] = clear[c];
+			if (depth && !depth->empty()){
+				float *d = depth->at(x, y);
+				d[0] = d[1] = 0.0f;
+			}
+		}
+	}
+}
+
+void InterpolateCheckerboard(Image &out, const Image &scene, unsigned phase, ThreadPool *pool)
+{
+	if (scene.empty()) return;
+	if (out.width != scene.width || out.height != scene.height){
+		out.resize(scene.width, scene.height);
+	}
+
+	forRows(out.height, pool, [&](unsigned y){
+		for (int x = 0; x < out.width; x++){
+			float *dst = out.at(x, y);
+			if (CheckerboardShaded(x, y, phase)){
+				const float *src = scene.at(x, y);
+				for (int c = 0; c < 4; c++) dst[c] = src[c];
+			}else{
+				CROSS(scene, x, y).interpolate(dst);
+			}
+		}
+	});
+}
+
+// Mirrors taa.hlsl PS_Checkerboard
+void ReconstructCheckerboard(Image &out, const Image &history, const Image &scene, const Image &depth, const Image &prev_depth,
+	const TAA_CHECKERBOARD_PARAM &param, ThreadPool *pool)
+{
+	if (scene.empty() || depth.empty()) return;
+	if (1.0f <= param.fRate || history.width != scene.width || history.height != scene.height){
+		InterpolateCheckerboard(out, scene, param.phase, pool);
+		return;
+	}
+	if (out.width != scene.width || out.height != scene.height){
+		out.resize(scene.width, scene.height);
+	}
+
+	forRows(out.height, pool, [&](unsigned y){
+		float v = ((float)y + 0.5f) * param.inv_screen_size[1];
+		for (int x = 0; x < out.width; x++){
+			float *dst = out.at(x, y);
+			if (CheckerboardShaded(x, y, param.phase)){
+				const float *src = scene.at(x, y);
+				for (int c = 0; c < 4; c++) dst[c] = src[c];
+				continue;
+			}
+
+			CROSS cross(scene, x, y);
+			float d_min = 1.0f, d_max = 0.0f;
+			for (int i = 0; i < 4; i++){
+				float n = depth.at(cross.x[i], cross.y[i])[0];
+				d_min = (n < d_min) ? n : d_min;
+				d_max = (d_max < n) ? n : d_max;
+			}
+
+			// the nearest surface around the hole decides where to look in the history
+			float u = ((float)x + 0.5f) * param.inv_screen_size[0];
+			float hu, hv;
+			if (!ReprojectUV(param.reprojection, u, v, d_min, &hu, &hv)
+				|| (!prev_depth.empty() && CheckerboardDisoccluded(param.depth_reject, prev_depth, hu, hv, d_min, d_max))){
+				cross.interpolate(dst);
+				continue;
+			}
+			// Between texels the bilinear fetch blurs the history, which has the
+			// aliasing of single sample shading, so the weight falls from 1 on a
+			// texel centre to 0 halfway, where the neighbours are as good
+			float fx = hu * (float)history.width - 0.5f;
+			float fy = hv * (float)history.height - 0.5f;
+			fx = fabsf(fx - floorf(fx + 0.5f));
+			fy = fabsf(fy - floorf(fy + 0.5f));
+			float weight = (1.0f - 2.0f * fx) * (1.0f - 2.0f * fy);
+
+			float h[4], s[4];
+			SampleLinear(history, hu, hv, h);
+			cross.interpolate(s);
+			for (int c = 0; c < 4; c++) dst[c] = s[c] + (h[c] - s[c]) * weight;
+		}
+	});
+}
+
+}// namespace tpot
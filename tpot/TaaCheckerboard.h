@@ -0,0 +1,55 @@
+#ifndef TPOT_TAA_CHECKERBOARD_H__
+#define TPOT_TAA_CHECKERBOARD_H__
+
+#include "image.h"
+#include "Matrix.h"
+#include "TaaDisocclusion.h"
+
+namespace tpot
+{
+	class ThreadPool;
+
+	// CPU twin of CB_TAA for taa.hlsl PS_Checkerboard
+	struct TAA_CHECKERBOARD_PARAM
+	{
+		float inv_screen_size[2];
+		float fRate;			// 1: no history yet, the missing pixels are interpolated
+		unsigned phase;			// of this frame, 0 or 1
+		MATRIX reprojection;	// inverse(view projection) * previous view projection, both unjittered
+		TAA_DEPTH_REJECT depth_reject;
+	};
+
+	// Whether the scene pass shades (x, y) in this phase. The phase alternates
+	// each frame, so two frames cover every pixel.
+	inline bool CheckerboardShaded(int x, int y, unsigned phase)
+	{
+		return (((unsigned)(x + y) + phase) & 1u) == 0;
+	}
+
+	// What the scene pass leaves in the pixels it does not shade: the clear
+	// colour, and the depth 0 of PS_CheckerMask that fails every later depth test.
+	// depth may be null.
+	void MaskCheckerboard(Image &color, Image *depth, unsigned phase, const float clear[4]);
+
+	// A pixel that was not shaded has no depth of its own, so its history at
+	// (u, v) is kept when any of the 2x2 texels of prev_depth there lies within
+	// the view depth range of the four shaded neighbours, d_min to d_max,
+	// widened by param.threshold. The texels the mask left at 0 never do.
+	bool CheckerboardDisoccluded(const TAA_DEPTH_REJECT &param, const Image &prev_depth, float u, float v, float d_min, float d_max);
+
+	// Runs taa.hlsl PS_Checkerboard over every pixel of out. Shaded pixels are
+	// copied from scene. The others take the history where the nearest
+	// neighbour's surface was last frame, weighted from 1 on a history texel
+	// centre to 0 halfway between texels, against the mean of the two shaded
+	// neighbours across the weaker gradient; the mean alone when
+	// CheckerboardDisoccluded.
+	// All images have the output size; depth and prev_depth as MaskCheckerboard
+	// leaves them, prev_depth empty: no depth test.
+	void ReconstructCheckerboard(Image &out, const Image &history, const Image &scene, const Image &depth, const Image &prev_depth,
+		const TAA_CHECKERBOARD_PARAM &param, ThreadPool *pool = nullptr);
+
+	// The spatial part alone, the fallback of the first frame
+	void InterpolateCheckerboard(Image &out, const Image &scene, unsigned phase, ThreadPool *pool = nullptr);
+
+}// namespace tpot
+#endif // TPOT_TAA_CHECKERBOARD_H__
@@ -0,0 +1,59 @@
+#include <math.h>
+#include "TaaDisocclusion.h"
+
+namespace tpot
+{
+
+namespace
+{
+	const char *NAMES[DISOCCLUSION::MAX] = {
+		"visible",
+		"off_screen",
+		"occluded",
+	};
+
+	inline int clampi(int v, int lo, int hi){ return (v < lo) ? lo : (hi < v) ? hi : v; }
+}// namespace
+
+
+const char *DISOCCLUSION::name(DISOCCLUSION::ID id)
+{
+	return (0 <= id && id < MAX) ? NAMES[id] : "?";
+}
+
+TAA_DEPTH_REJECT MakeDepthReject(const MATRIX &proj, float threshold)
+{
+	TAA_DEPTH_REJECT param;
+	param.proj[0] = proj.m[2][2];
+	param.proj[1] = proj.m[3][2];
+	param.threshold = threshold;
+	return param;
+}
+
+DISOCCLUSION::ID TestHistory(const MATRIX &reprojection, const Image &prev_depth, float u, float v, float depth,
+	const TAA_DEPTH_REJECT &param, float *prev_u, float *prev_v)
+{
+	float clip[3] = { u * 2.0f - 1.0f, 1.0f - v * 2.0f, depth };
+	float prev[4];
+	TransformCoord(reprojection, clip, prev);
+
+	*prev_u = 0.5f * prev[0] / prev[3] + 0.5f;
+	*prev_v = -0.5f * prev[1] / prev[3] + 0.5f;
+	if (!(0.0f <= *prev_u && *prev_u <= 1.0f && 0.0f <= *prev_v && *prev_v <= 1.0f)) return DISOCCLUSION::OFF_SCREEN;
+	if (prev_depth.empty()) return DISOCCLUSION::VISIBLE;
+
+	// the 2x2 texels of the bilinear history fetch, any of them may match
+	float expected = prev[2] / prev[3];
+	int x0 = (int)floorf(*prev_u * (float)prev_depth.width - 0.5f);
+	int y0 = (int)floorf(*prev_v * (float)prev_depth.height - 0.5f);
+	for (int j = 0; j < 2; j++){
+		for (int i = 0; i < 2; i++){
+			int x = clampi(x0 + i, 0, prev_depth.width - 1);
+			int y = clampi(y0 + j, 0, prev_depth.height - 1);
+			if (!DepthRejected(param, expected, prev_depth.at(x, y)[0])) return DISOCCLUSION::VISIBLE;
+		}
+	}
+	return DISOCCLUSION::OCCLUDED;
+}
+
+}// namespace tpot
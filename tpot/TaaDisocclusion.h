@@ -0,0 +1,67 @@
+#ifndef TPOT_TAA_DISOCCLUSION_H__
+#define TPOT_TAA_DISOCCLUSION_H__
+
+#include <math.h>
+#include "image.h"
+#include "Matrix.h"
+
+namespace tpot
+{
+	// Depth test of the reprojected history, g_fDepthReject of taa.hlsl
+	struct TAA_DEPTH_REJECT
+	{
+		float proj[2];		// _33, _43 of the projection: view z = proj[1] / (d - proj[0])
+		float threshold;	// view depth difference, relative to the expected depth, that rejects; 0: off
+	};
+
+	// Depth is per pixel, so this stays above the steps of d24 at the far plane
+	const float TAA_DEPTH_THRESHOLD = 0.05f;
+
+	TAA_DEPTH_REJECT MakeDepthReject(const MATRIX &proj, float threshold);
+
+	inline void CopyDepthReject(float cb[4], const TAA_DEPTH_REJECT &param)
+	{
+		cb[0] = param.proj[0];
+		cb[1] = param.proj[1];
+		cb[2] = param.threshold;
+		cb[3] = 0.0f;
+	}
+
+	// Depth buffer value -> view space z
+	inline float LinearDepth(const TAA_DEPTH_REJECT &param, float depth)
+	{
+		return param.proj[1] / (depth - param.proj[0]);
+	}
+
+	// expected: the depth buffer value the surface had in the previous frame
+	// (reprojected z / w), history: what the previous depth buffer holds there.
+	// Written so that NaN rejects.
+	inline bool DepthRejected(const TAA_DEPTH_REJECT &param, float expected, float history)
+	{
+		if (!(0.0f < param.threshold)) return false;
+		float z = LinearDepth(param, expected);
+		return !(fabsf(LinearDepth(param, history) - z) <= param.threshold * z);
+	}
+
+	struct DISOCCLUSION{
+		enum ID
+		{
+			VISIBLE,	// the history at the reprojected position is this surface
+			OFF_SCREEN,
+			OCCLUDED,	// something else was in front last frame
+
+			MAX,
+		};
+
+		static const char *name(DISOCCLUSION::ID id);
+	};
+
+	// The test of taa.hlsl PS_Reproject for the pixel at (u, v) with depth
+	// buffer value depth. prev_depth is last frame's depth buffer (red, as
+	// TestScene::render) and is read at the nearest texel. prev_u, prev_v
+	// receive the history position unless the result is OFF_SCREEN.
+	DISOCCLUSION::ID TestHistory(const MATRIX &reprojection, const Image &prev_depth, float u, float v, float depth,
+		const TAA_DEPTH_REJECT &param, float *prev_u, float *prev_v);
+
+}// namespace tpot
+#endif // TPOT_TAA_DISOCCLUSION_H__
@@ -0,0 +1,357 @@
+#include <string.h>
+#include "TaaFrame.h"
+#include "renderer.h"
+
+namespace tpot
+{
+
+namespace
+{
+	// Render targets draw into the top left of a pooled texture
+	void uvScale(Renderer *pRenderer, UINT id, float *scale)
+	{
+		UINT width, height, tex_width, tex_height;
+		pRenderer->getSize(id, &width, &height);
+		pRenderer->getTextureSize(id, &tex_width, &tex_height);
+		scale[0] = (float)width / (float)tex_width;
+		scale[1] = (float)height / (float)tex_height;
+	}
+
+	// Percent the scene pass renders at: only PS_Upsample reconstructs a
+	// smaller one, the other modes would show a plain bilinear upscale
+	UINT renderScale(const TAA_FRAME_PARAM &param)
+	{
+		return (param.mode == TAA_MODE::TAA && param.render_scale < 100) ? param.render_scale : 100;
+	}
+}// namespace
+
+TaaFrame::TaaFrame()
+	: width_(640), height_(480), frame_(0), count_(0), init_(false), resized_(true)
+	, history_(TAA_HISTORY::RGB), history_format_(RENDER_TARGET::FORMAT_MAX)
+{
+	res_.rt_color = ~0u;
+	res_.rt_depth[0] = res_.rt_depth[1] = ~0u;
+	res_.rt_taa[0] = res_.rt_taa[1] = ~0u;
+	res_.scene_mesh = res_.pole_mesh = res_.quad_mesh = ~0u;
+	res_.rt_tile[0] = res_.rt_tile[1] = ~0u;
+	memset(&last_, 0, sizeof(last_));
+	memset(generation_, 0, sizeof(generation_));
+}
+
+void TaaFrame::create(const TAA_FRAME_RESOURCES &res)
+{
+	res_ = res;
+}
+
+void TaaFrame::resize(UINT width, UINT height)
+{
+	width_ = width;
+	height_ = height;
+	resized_ = true;
+}
+
+// Whether this frame's history continues last frame's, as far as the tile mask goes
+bool TaaFrame::sameHistory(const TAA_FRAME_PARAM &param) const
+{
+	return !resized_
+		&& memcmp(&param.mView, &last_.mView, sizeof(MATRIX)) == 0
+		&& memcmp(&param.mProj, &last_.mProj, sizeof(MATRIX)) == 0
+		&& param.mode == last_.mode
+		&& param.blend_weight == last_.blend_weight
+		&& param.blur_size == last_.blur_size
+		&& renderScale(param) == renderScale(last_)
+		&& param.jitter == last_.jitter
+		&& param.format == last_.format
+		&& param.history == last_.history
+		&& param.tile_skip == last_.tile_skip
+		&& param.clamp == last_.clamp
+		&& param.scene_revision == last_.scene_revision;
+}
+
+// The pool moved a target last frame wrote to a new surface, its contents are undefined
+bool TaaFrame::historyLost(Renderer *pRenderer) const
+{
+	UINT last = frame_;	// not flipped yet
+	return pRenderer->getGeneration(res_.rt_taa[last]) != generation_[0][last]
+		|| pRenderer->getGeneration(res_.rt_depth[last]) != generation_[1][last]
+		|| pRenderer->getGeneration(res_.rt_tile[last]) != generation_[2][last];
+}
+
+void TaaFrame::keepGenerations(Renderer *pRenderer)
+{
+	for (UINT i = 0; i < 2; i++){
+		generation_[0][i] = pRenderer->getGeneration(res_.rt_taa[i]);
+		generation_[1][i] = pRenderer->getGeneration(res_.rt_depth[i]);
+		generation_[2][i] = pRenderer->getGeneration(res_.rt_tile[i]);
+	}
+}
+
+void TaaFrame::render(Renderer *pRenderer, const TAA_FRAME_PARAM &param)
+{
+	pRenderer->beginFrame();
+
+	// WVP
+	MATRIX mViewProjection;
+	MATRIX mViewProj = MatrixMultiply(param.mView, param.mProj);
+
+	if (jitter_seq_.type() != param.jitter){
+		jitter_seq_.reset(param.jitter, jitter_seq_.length());
+	}
+	jitter_seq_.setBlendWeight(param.blend_weight);
+	const float *offset = jitter_seq_.next();	// [0,1)
+
+	// Temporal upsampling: the scene pass runs at render_scale percent and
+	// PS_Upsample reconstructs the full size history.
+	bool bJitter = (param.mode == TAA_MODE::TAA || param.mode == TAA_MODE::CAMMOVE);
+	// Checkerboard: the scene pass shades one phase, unjittered, and the
+	// resolve fills the other from rt_taa. It needs the output size.
+	bool bCheckerboard = (param.mode == TAA_MODE::CHECKERBOARD);
+	bool bTaa = bJitter || bCheckerboard;
+	float render_scale = 0.01f * (float)renderScale(param);
+	bool bUpsample = renderScale(param) < 100;
+	// CS_Variance writes an RGB history as a UAV, after the scene pass
+	bool bVariance = (param.clamp == TAA_CLAMP::VARIANCE) && (param.mode == TAA_MODE::TAA) && !bUpsample
+		&& RENDER_TARGET::unorderedAccess(param.format);
+	// PS_Upsample and PS_Reproject blend RGB, only PS keeps a YCoCg history
+	bool bYCoCg = (param.mode == TAA_MODE::TAA) && !bUpsample && !bVariance && (param.history != TAA_HISTORY::RGB);
+	TAA_HISTORY::ID history = bYCoCg ? param.history : TAA_HISTORY::RGB;
+	RENDER_TARGET::FORMAT history_format = TAA_HISTORY::format(history, param.format);
+	// Tiles of PS / PS_YCoCg whose history stopped changing are skipped until the view changes
+	bool bTileSkip = param.tile_skip && (param.mode == TAA_MODE::TAA) && !bUpsample && !bVariance;
+	// PS / PS_YCoCg can present as they resolve, the history becomes a UAV
+	bool bFused = param.fused_present && (param.mode == TAA_MODE::TAA) && !bUpsample && !bVariance
+		&& RENDER_TARGET::unorderedAccess(history_format);
+	TAA_PRESENT_PARAM present = { param.tonemap, param.exposure, param.dither, count_++ };
+	float present_cb[4];
+	CopyPresentParam(present_cb, present);
+	pRenderer->setFormat(res_.rt_color, param.format);
+	pRenderer->setFormat(res_.rt_taa[0], history_format);
+	pRenderer->setFormat(res_.rt_taa[1], history_format);
+	pRenderer->setScale(res_.rt_color, render_scale);
+	pRenderer->setScale(res_.rt_depth[0], render_scale);
+	pRenderer->setScale(res_.rt_depth[1], render_scale);
+	pRenderer->setScale(res_.rt_tile[0], 1.0f / (float)TAA_TILE_SIZE);
+	pRenderer->setScale(res_.rt_tile[1], 1.0f / (float)TAA_TILE_SIZE);
+	// after a deferred shrink or a new history encoding or format it starts over, as on the first frame
+	bool bHistoryLost = init_ && (historyLost(pRenderer) || history != history_ || history_format != history_format_);
+	bool bTileReset = !init_ || bHistoryLost || !sameHistory(param);
+	UINT render_width, render_height;
+	pRenderer->getSize(res_.rt_color, &render_width, &render_height);
+
+	float jitter[2] = {// sample offset in render pixels
+		-0.5f * offset[0],
+		+0.5f * offset[1],
+	};
+	if (bUpsample){// cover a whole render pixel so every output pixel gets hit
+		jitter[0] = offset[0] - 0.5f;
+		jitter[1] = offset[1] - 0.5f;
+	}
+	MATRIX mOffset = MatrixTranslation(-2.0f * jitter[0] / (float)render_width, 2.0f * jitter[1] / (float)render_height, 0.0f);
+
+	if (bJitter){
+		mViewProjection = MatrixMultiply(mViewProj, mOffset);
+	}
+	else{
+		mViewProjection = mViewProj;
+	}
+	pRenderer->setViewProjection(mViewProj);
+
+	// Camera motion: PS_Reproject maps this frame's (jittered) clip space to the last frame's
+	bool bReproject = (param.mode == TAA_MODE::CAMMOVE);
+	// last frame's depth is there from the second frame on, and not right after a resize
+	bool bDepthReject = bReproject && param.depth_reject && init_ && !resized_ && !bHistoryLost
+		&& renderScale(param) == renderScale(last_);
+	// rt_taa and last frame's depth are a checkerboard frame's from the second one on
+	bool bCheckerHistory = bCheckerboard && init_ && !resized_ && !bHistoryLost && last_.mode == TAA_MODE::CHECKERBOARD;
+	bDepthReject = bDepthReject || (bCheckerHistory && param.depth_reject);
+	MATRIX mReprojection;
+	if (!MatrixInverse(&mReprojection, mViewProjection)){
+		mReprojection = MatrixIdentity();
+	}
+	mReprojection = MatrixMultiply(mReprojection, pRenderer->prevViewProjection());
+
+	pRenderer->pushRenderTarget();
+
+	frame_ = 1 - frame_;
+
+	pRenderer->setRenderTarget(res_.rt_color);
+	pRenderer->setDepth(res_.rt_depth[frame_]);
+
+	// Clear the render target and depth stencil
+	pRenderer->Clear( 0xff080808 );
+	pRenderer->ClearDepth( 1.0f );
+
+	if (bCheckerboard){// depth 0 where this phase does not shade, the depth test does the rest
+		pRenderer->set(VS::TAA);
+		pRenderer->set(PS::TAA_CHECKER_MASK);
+		CB_TAA* pCBtaa = (CB_TAA*)pRenderer->Map();
+		memset(pCBtaa, 0, sizeof(CB_TAA));
+		pCBtaa->mViewProjection = MatrixTranspose(MatrixMultiply(MatrixScaling((float)width_, (float)height_, 1.0f), pRenderer->screenProjMatrix()));
+		pCBtaa->checkerboard[0] = (float)frame_;
+		pRenderer->UmMap();
+		pRenderer->setCB_VS();
+		pRenderer->setCB_PS();
+		pRenderer->Draw(res_.quad_mesh);
+	}
+
+	pRenderer->set(VS::SCENE);
+	pRenderer->set(PS::SCENE);
+	pRenderer->set(0, SAMPLER_STATE::LINEAR);
+
+	CB_SCENE* pCBscene = (CB_SCENE*)pRenderer->Map();
+	pCBscene->mViewProjection = MatrixTranspose(mViewProjection);
+	pRenderer->UmMap();
+
+	pRenderer->setCB_VS();
+
+	pRenderer->Draw(res_.scene_mesh);
+	pRenderer->Draw(res_.pole_mesh);
+
+	if (bTaa)
+	{
+		if (bFused){
+			pRenderer->setPresentTarget(res_.rt_taa[frame_]);
+		}else if (bVariance){// rt_color and rt_taa must not stay bound as targets
+			pRenderer->popRenderTarget();
+		}else{
+			pRenderer->setRenderTarget(res_.rt_taa[frame_]);
+			pRenderer->setDepth(~(UINT)0);
+		}
+		pRenderer->set(DEPTH_STATE::DISABLE);
+
+		MATRIX m = MatrixScaling((float)width_, (float)height_, 1.0f);
+		mViewProjection = MatrixMultiply(m, pRenderer->screenProjMatrix());
+
+		pRenderer->setTexture(0, res_.rt_taa[1 - frame_]);
+		pRenderer->setTexture(1, res_.rt_color);
+		pRenderer->setTexture(2, res_.rt_depth[frame_]);
+		if (bTileSkip) pRenderer->setTexture(3, res_.rt_tile[1 - frame_]);
+		if (bDepthReject) pRenderer->setTexture(4, res_.rt_depth[1 - frame_]);
+		pRenderer->set(VS::TAA);
+		if (bVariance){
+			pRenderer->set(CS::TAA_VARIANCE);
+		}else if (bFused){
+			pRenderer->set(bYCoCg ? PS::TAA_YCOCG_PRESENT : PS::TAA_PRESENT);
+		}else{
+			pRenderer->set(bCheckerboard ? PS::TAA_CHECKERBOARD : bReproject ? PS::TAA_REPROJECT
+				: bUpsample ? PS::TAA_UPSAMPLE : bYCoCg ? PS::TAA_YCOCG : PS::TAA);
+		}
+		pRenderer->set(0, SAMPLER_STATE::LINEAR);
+		CB_TAA cb;// the mask pass reads the same constants
+		cb.mViewProjection = MatrixTranspose(mViewProjection);
+		cb.fRate = 1.0f / (float)param.blend_weight;
+		if (!init_ || bHistoryLost || (bCheckerboard && !bCheckerHistory)){
+			init_ = true;
+			cb.fRate = 1.0f;
+		}
+		cb.inv_screen_size[0] = 1.0f / (float)width_;
+		cb.inv_screen_size[1] = 1.0f / (float)height_;
+		cb.fBlurSize = 0.1f * (float)param.blur_size;
+		cb.render_size[0] = (float)render_width;
+		cb.render_size[1] = (float)render_height;
+		cb.jitter[0] = jitter[0];
+		cb.jitter[1] = jitter[1];
+		cb.mReprojection = MatrixTranspose(mReprojection);
+		uvScale(pRenderer, res_.rt_taa[1 - frame_], &cb.uv_scale[0]);
+		uvScale(pRenderer, res_.rt_color, &cb.uv_scale[2]);
+		cb.tile[0] = TAA_TILE_THRESHOLD;
+		cb.tile[1] = (float)TAA_TILE_FRAMES;
+		cb.tile[2] = (bTileSkip && !bTileReset) ? 0.0f : 1.0f;
+		cb.tile[3] = 0.0f;
+		memcpy(cb.present, present_cb, sizeof(cb.present));
+		CopyDepthReject(cb.depth_reject, MakeDepthReject(param.mProj, bDepthReject ? TAA_DEPTH_THRESHOLD : 0.0f));
+		cb.checkerboard[0] = (float)frame_;
+		cb.checkerboard[1] = cb.checkerboard[2] = cb.checkerboard[3] = 0.0f;
+		*(CB_TAA*)pRenderer->Map() = cb;
+		pRenderer->UmMap();
+		if (bVariance){
+			pRenderer->setCB_CS();
+			pRenderer->Dispatch(res_.rt_taa[frame_],
+				(width_ + TAA_VARIANCE_GROUP - 1) / TAA_VARIANCE_GROUP, (height_ + TAA_VARIANCE_GROUP - 1) / TAA_VARIANCE_GROUP);
+		}else{
+			pRenderer->setCB_VS();
+			pRenderer->setCB_PS();
+			pRenderer->Draw(res_.quad_mesh);
+		}
+
+		if (bTileSkip){// convergence of this resolve, read by the next one
+			pRenderer->setRenderTarget(res_.rt_tile[frame_]);
+			pRenderer->setTexture(0, res_.rt_taa[frame_]);
+			pRenderer->setTexture(1, res_.rt_taa[1 - frame_]);
+			pRenderer->setTexture(3, res_.rt_tile[1 - frame_]);
+			pRenderer->set(PS::TAA_TILE_MASK);
+			*(CB_TAA*)pRenderer->Map() = cb;
+			pRenderer->UmMap();
+			pRenderer->setCB_VS();
+			pRenderer->setCB_PS();
+			pRenderer->Draw(res_.quad_mesh);
+		}
+
+		if (!bVariance) pRenderer->popRenderTarget();
+		if (bFused){// the resolve covered the back buffer
+			pRenderer->ClearDepth(1.0f);
+		}else{
+			pRenderer->Clear(0x00101010);
+			pRenderer->ClearDepth(1.0f);
+
+			pRenderer->setTexture(0, res_.rt_taa[frame_]);
+			pRenderer->set(VS::DECAL);
+			pRenderer->set(bYCoCg ? PS::DECAL_YCOCG : PS::DECAL);
+			CB_DECAL* pCBdecal = (CB_DECAL*)pRenderer->Map();
+			pCBdecal->mViewProjection = MatrixTranspose(mViewProjection);
+			uvScale(pRenderer, res_.rt_taa[frame_], pCBdecal->uv_scale);
+			memcpy(pCBdecal->present, present_cb, sizeof(pCBdecal->present));
+			pRenderer->setCB_VS();
+			pRenderer->UmMap();
+			pRenderer->Draw(res_.quad_mesh);
+		}
+	}
+	else{
+		pRenderer->popRenderTarget();
+		pRenderer->Clear(0x00101010);
+		pRenderer->set(DEPTH_STATE::DISABLE);
+
+		MATRIX m = MatrixScaling((float)width_, (float)height_, 1.0f);
+		mViewProjection = MatrixMultiply(m, pRenderer->screenProjMatrix());
+
+		pRenderer->setTexture(0, res_.rt_color);
+		pRenderer->set(VS::DECAL);
+		pRenderer->set(PS::DECAL);
+		CB_DECAL* pCBdecal = (CB_DECAL*)pRenderer->Map();
+		pCBdecal->mViewProjection = MatrixTranspose(mViewProjection);
+		uvScale(pRenderer, res_.rt_color, pCBdecal->uv_scale);
+		memcpy(pCBdecal->present, present_cb, sizeof(pCBdecal->present));
+		pRenderer->setCB_VS();
+		pRenderer->UmMap();
+		pRenderer->Draw(res_.quad_mesh);
+	}
+
+#if 1
+	{// render target thumbnail
+		MATRIX mS = MatrixScaling(100.0f, 100.0f, 1.0f);
+		MATRIX m = MatrixTranslation(0.0f, (float)height_ - 100.0f, 0.0f);
+		mViewProjection = MatrixMultiply(MatrixMultiply(mS, m), pRenderer->screenProjMatrix());
+
+		pRenderer->setTexture(0, res_.rt_color);
+		pRenderer->set(VS::DECAL);
+		pRenderer->set(PS::DECAL);
+		CB_DECAL* pCBdecal = (CB_DECAL*)pRenderer->Map();
+		pCBdecal->mViewProjection = MatrixTranspose(mViewProjection);
+		uvScale(pRenderer, res_.rt_color, pCBdecal->uv_scale);
+		memcpy(pCBdecal->present, present_cb, sizeof(pCBdecal->present));
+		pRenderer->UmMap();
+		pRenderer->setCB_VS();
+		pRenderer->Draw(res_.quad_mesh);
+	}
+#endif
+
+	pRenderer->set(DEPTH_STATE::UNUSED);
+
+	keepGenerations(pRenderer);
+	history_ = history;
+	history_format_ = history_format;
+	last_ = param;
+	resized_ = false;
+}
+
+}// namespace tpot
@@ -0,0 +1,97 @@
+#ifndef TPOT_TAA_FRAME_H__
+#define TPOT_TAA_FRAME_H__
+
+#include "types.h"
+#include "JitterSequence.h"
+#include "TaaHistory.h"
+#include "TileConvergence.h"
+#include "TaaPresent.h"
+#include "TaaVariance.h"
+#include "TaaDisocclusion.h"
+
+namespace tpot
+{
+	class Renderer;
+
+	struct TAA_MODE{// same order as E_MODE in hud.h
+		enum ID
+		{
+			OFF,
+			TAA,
+			CAMMOVE,
+			CHECKERBOARD,	// half the pixels shaded per frame, PS_Checkerboard fills the rest
+
+			MAX,
+		};
+	};
+
+	// Created by the application: render targets and meshes of the Renderer
+	struct TAA_FRAME_RESOURCES
+	{
+		UINT rt_color;
+		UINT rt_depth[2];	// this frame's and last frame's, for PS_Reproject
+		UINT rt_taa[2];
+		UINT scene_mesh;
+		UINT pole_mesh;
+		UINT quad_mesh;	// unit quad, MESH_TYPE_TRIANGLELIST of VTX_DECAL
+		UINT rt_tile[2];	// convergence mask, RGBA16F, scaled to 1 / TAA_TILE_SIZE
+	};
+
+	struct TAA_FRAME_PARAM
+	{
+		MATRIX       mView;
+		MATRIX       mProj;
+		TAA_MODE::ID mode;
+		UINT         blend_weight;
+		UINT         blur_size;
+		UINT         render_scale;	// scene resolution in percent per axis, TAA mode only
+		JITTER::TYPE jitter;
+		RENDER_TARGET::FORMAT format;	// of rt_color and rt_taa
+		TAA_HISTORY::ID history;	// rt_taa of the TAA resolve, RGB in the other modes
+		bool         tile_skip;	// TAA resolve: skip tiles whose history has converged
+		bool         fused_present;	// TAA resolve writes the back buffer too, no DECAL pass of rt_taa
+		TAA_CLAMP::ID clamp;	// VARIANCE: CS_Variance resolve into an RGB history, no tile skip or fused present
+		bool         depth_reject;	// CAMMOVE, CHECKERBOARD: no history where last frame's depth has another surface
+		TONEMAP::ID  tonemap;	// of everything drawn to the back buffer
+		float        exposure;
+		bool         dither;
+		UINT         scene_revision;	// changes when the scene pass draws something new, e.g. a mesh finished loading
+	};
+
+	// The command stream of OnD3D11FrameRender: scene pass, TAA resolve,
+	// present and the render target thumbnail. With fused_present the PS
+	// resolve draws into the back buffer and writes rt_taa as a UAV; sRGB
+	// history formats cannot be UAVs and keep the DECAL pass, and so does
+	// the CS_Variance resolve. CHECKERBOARD masks the scene pass with
+	// PS_CheckerMask. Only TAA renders below full size. Backend agnostic so the
+	// same frame can be built on RecordingDevice (tools/frame_bench).
+	class TaaFrame
+	{
+		TAA_FRAME_RESOURCES res_;
+		UINT                width_;	// back buffer
+		UINT                height_;
+		JitterSequence      jitter_seq_;
+		unsigned int        frame_;
+		unsigned int        count_;	// frames rendered, seeds the dither
+		bool                init_;
+		TAA_FRAME_PARAM     last_;	// for the mask reset
+		bool                resized_;
+		UINT                generation_[3][2];	// of rt_taa, rt_depth, rt_tile as last rendered
+		TAA_HISTORY::ID     history_;	// rt_taa as last written
+		RENDER_TARGET::FORMAT history_format_;
+
+		bool sameHistory(const TAA_FRAME_PARAM &param) const;
+		bool historyLost(Renderer *pRenderer) const;
+		void keepGenerations(Renderer *pRenderer);
+
+	public:
+		TaaFrame();
+
+		void create(const TAA_FRAME_RESOURCES &res);
+		void resize(UINT width, UINT height);
+
+		void render(Renderer *pRenderer, const TAA_FRAME_PARAM &param);
+	};
+
+}// namespace tpot
+#endif // TPOT_TAA_FRAME_H__
@@ -0,0 +1,311 @@
+#include <math.h>
+#include <string.h>
+#include "TaaHistory.h"
+#include "ThreadPool.h"
+
+namespace tpot
+{
+
+namespace
+{
+	enum{
+		NEIGHBOR_MAX = 4,
+	};
+
+	const char *NAMES[TAA_HISTORY::MAX] = {
+		"rgb",
+		"ycocg64",
+		"ycocg32",
+	};
+
+	inline unsigned int floatBits(float f){ unsigned int u; memcpy(&u, &f, sizeof(u)); return u; }
+	inline float bitsFloat(unsigned int u){ float f; memcpy(&f, &u, sizeof(f)); return f; }
+
+	// NaN goes to 0 as the output merger does
+	inline unsigned int unorm(float v, unsigned int max)
+	{
+		if (!(0.0f < v)) return 0;
+		if (1.0f <= v) return max;
+		return (unsigned int)(v * (float)max + 0.5f);
+	}
+
+	inline int wrap(int i, int n)
+	{
+		i %= n;
+		return (i < 0) ? i + n : i;
+	}
+
+	// Neighbour fetches of taa.hlsl, as two taps along the offset axis (see TaaResolve.cpp)
+	struct TAPS
+	{
+		int   dy[NEIGHBOR_MAX][2];
+		float w[NEIGHBOR_MAX][2];
+		std::vector<int> col[NEIGHBOR_MAX][2];// wrapped column per x
+	};
+
+	void setupTaps(TAPS &taps, const TAA_PARAM &param, int width, int height)
+	{
+		static const float neighbor_offset[NEIGHBOR_MAX][2] = {
+			{ 0, +1 },
+			{ 0, -1 },
+			{ +1, 0 },
+			{ -1, 0 },
+		};
+
+		for (int i = 0; i < NEIGHBOR_MAX; i++){
+			float sx = neighbor_offset[i][0] * param.inv_screen_size[0] * param.fBlurSize * (float)width;
+			float sy = neighbor_offset[i][1] * param.inv_screen_size[1] * param.fBlurSize * (float)height;
+			float fx = floorf(sx), fy = floorf(sy);
+			int ix = (int)fx, iy = (int)fy;
+			float wx = sx - fx, wy = sy - fy;
+
+			int dx[2];
+			if (neighbor_offset[i][0] != 0){
+				dx[0] = ix; dx[1] = ix + 1; taps.dy[i][0] = taps.dy[i][1] = iy;
+				taps.w[i][0] = 1.0f - wx; taps.w[i][1] = wx;
+			}else{
+				dx[0] = dx[1] = ix; taps.dy[i][0] = iy; taps.dy[i][1] = iy + 1;
+				taps.w[i][0] = 1.0f - wy; taps.w[i][1] = wy;
+			}
+
+			for (int t = 0; t < 2; t++){
+				taps.col[i][t].resize(width);
+				for (int x = 0; x < width; x++){
+					taps.col[i][t][x] = wrap(x + dx[t], width);
+				}
+			}
+		}
+	}
+
+	// Texel access of one encoding, so the resolve loop has no per fetch switch
+	struct YCOCG32_TEXELS
+	{
+		const unsigned int *src;
+		unsigned int *dst;
+		void load(size_t pixel, float texel[4]) const { UnpackRGB10A2(src[pixel], texel); }
+		void store(size_t pixel, const float texel[4]) const { dst[pixel] = PackRGB10A2(texel); }
+	};
+
+	struct YCOCG64_TEXELS
+	{
+		const unsigned int *src;
+		unsigned int *dst;
+		void load(size_t pixel, float texel[4]) const {
+			UnpackRGBA16F((unsigned long long)src[pixel * 2] | ((unsigned long long)src[pixel * 2 + 1] << 32), texel);
+		}
+		void store(size_t pixel, const float texel[4]) const {
+			unsigned long long word = PackRGBA16F(texel);
+			dst[pixel * 2] = (unsigned int)word;
+			dst[pixel * 2 + 1] = (unsigned int)(word >> 32);
+		}
+	};
+
+	template<class TEXELS>
+	void resolveRow(const TEXELS &texels, const TAPS &taps, const Image &scene, int width, int height, int y)
+	{
+		size_t rows[NEIGHBOR_MAX][2];
+		for (int i = 0; i < NEIGHBOR_MAX; i++){
+			for (int t = 0; t < 2; t++){
+				rows[i][t] = (size_t)wrap(y + taps.dy[i][t], height) * width;
+			}
+		}
+
+		for (int x = 0; x < width; x++){
+			float center[4];
+			EncodeYCoCg(scene.at(x, y), center);
+			float sum[4] = { center[0], center[1], center[2], center[3] };
+
+			for (int i = 0; i < NEIGHBOR_MAX; i++){
+				float a[4], b[4], neighbor[4];
+				texels.load(rows[i][0] + taps.col[i][0][x], a);
+				texels.load(rows[i][1] + taps.col[i][1][x], b);
+				for (int c = 0; c < 4; c++){
+					neighbor[c] = a[c] * taps.w[i][0] + b[c] * taps.w[i][1];
+				}
+
+				float dco = neighbor[1] - center[1];
+				float dcg = neighbor[2] - center[2];
+				float cocg_len = sqrtf(dco * dco + dcg * dcg);
+				if (TAA_COCG_THRESHOLD < cocg_len){
+					float s = TAA_COCG_THRESHOLD / cocg_len;
+					neighbor[0] = center[0] + (neighbor[0] - center[0]) * s;
+					neighbor[1] = center[1] + dco * s;
+					neighbor[2] = center[2] + dcg * s;
+				}
+				for (int c = 0; c < 4; c++) sum[c] += neighbor[c];
+			}
+
+			for (int c = 0; c < 4; c++) sum[c] /= 5.0f;
+			texels.store((size_t)y * width + x, sum);
+		}
+	}
+}// namespace
+
+
+const char *TAA_HISTORY::name(TAA_HISTORY::ID id)
+{
+	return (0 <= id && id < MAX) ? NAMES[id] : "?";
+}
+
+bool TAA_HISTORY::parse(const char *str, TAA_HISTORY::ID *id)
+{
+	for (int i = 0; i < MAX; i++){
+		if (strcmp(str, NAMES[i]) == 0){
+			*id = (TAA_HISTORY::ID)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+RENDER_TARGET::FORMAT TAA_HISTORY::format(TAA_HISTORY::ID id, RENDER_TARGET::FORMAT rgb)
+{
+	switch (id){
+	case YCOCG64: return RENDER_TARGET::RGBA16F;
+	case YCOCG32: return RENDER_TARGET::RGB10A2;
+	default: return rgb;
+	}
+}
+
+// Bit exact with the D3D conversion, no tables
+unsigned short FloatToHalf(float f)
+{
+	const unsigned int f32_infinity = 255u << 23;
+	const unsigned int f16_max = (127u + 16u) << 23;	// 2^16, everything above is infinity
+	const unsigned int denorm_magic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+	unsigned int u = floatBits(f);
+	unsigned int sign = u & 0x80000000u;
+	u ^= sign;
+
+	unsigned int h;
+	if (f16_max <= u){
+		h = (f32_infinity < u) ? 0x7e00 : 0x7c00;
+	}else if (u < (113u << 23)){// half subnormal or zero, the fpu rounds
+		h = floatBits(bitsFloat(u) + bitsFloat(denorm_magic)) - denorm_magic;
+	}else{
+		unsigned int mant_odd = (u >> 13) & 1;
+		u += ((unsigned int)(15 - 127) << 23) + 0xfff;
+		u += mant_odd;
+		h = u >> 13;
+	}
+	return (unsigned short)(h | (sign >> 16));
+}
+
+float HalfToFloat(unsigned short h)
+{
+	const unsigned int shifted_exp = 0x7c00u << 13;
+
+	unsigned int u = ((unsigned int)h & 0x7fff) << 13;
+	unsigned int exp = shifted_exp & u;
+	u += (127u - 15u) << 23;
+	if (exp == shifted_exp){// infinity, NaN
+		u += (128u - 16u) << 23;
+	}else if (exp == 0){// subnormal
+		u += 1u << 23;
+		u = floatBits(bitsFloat(u) - bitsFloat(113u << 23));
+	}
+	return bitsFloat(u | (((unsigned int)h & 0x8000) << 16));
+}
+
+unsigned int PackRGB10A2(const float texel[4])
+{
+	return unorm(texel[0], 1023) | (unorm(texel[1], 1023) << 10) | (unorm(texel[2], 1023) << 20) | (unorm(texel[3], 3) << 30);
+}
+
+void UnpackRGB10A2(unsigned int word, float texel[4])
+{
+	texel[0] = (float)(word & 1023) * (1.0f / 1023.0f);
+	texel[1] = (float)((word >> 10) & 1023) * (1.0f / 1023.0f);
+	texel[2] = (float)((word >> 20) & 1023) * (1.0f / 1023.0f);
+	texel[3] = (float)(word >> 30) * (1.0f / 3.0f);
+}
+
+unsigned long long PackRGBA16F(const float texel[4])
+{
+	return (unsigned long long)FloatToHalf(texel[0])
+		| ((unsigned long long)FloatToHalf(texel[1]) << 16)
+		| ((unsigned long long)FloatToHalf(texel[2]) << 32)
+		| ((unsigned long long)FloatToHalf(texel[3]) << 48);
+}
+
+void UnpackRGBA16F(unsigned long long word, float texel[4])
+{
+	for (int c = 0; c < 4; c++){
+		texel[c] = HalfToFloat((unsigned short)(word >> (16 * c)));
+	}
+}
+
+void HistoryImage::load(size_t pixel, float texel[4]) const
+{
+	if (id == TAA_HISTORY::YCOCG64){
+		UnpackRGBA16F((unsigned long long)words[pixel * 2] | ((unsigned long long)words[pixel * 2 + 1] << 32), texel);
+	}else{
+		UnpackRGB10A2(words[pixel], texel);
+	}
+}
+
+void HistoryImage::store(size_t pixel, const float texel[4])
+{
+	if (id == TAA_HISTORY::YCOCG64){
+		unsigned long long word = PackRGBA16F(texel);
+		words[pixel * 2] = (unsigned int)word;
+		words[pixel * 2 + 1] = (unsigned int)(word >> 32);
+	}else{
+		words[pixel] = PackRGB10A2(texel);
+	}
+}
+
+void EncodeHistory(HistoryImage &out, const Image &rgba, TAA_HISTORY::ID id)
+{
+	if (id == TAA_HISTORY::RGB) return;
+	out.resize(id, rgba.width, rgba.height);
+	size_t n = (size_t)rgba.width * rgba.height;
+	for (size_t p = 0; p < n; p++){
+		float texel[4];
+		EncodeYCoCg(&rgba.pixels[p * 4], texel);
+		out.store(p, texel);
+	}
+}
+
+void DecodeHistory(Image &out, const HistoryImage &history)
+{
+	out.resize(history.width, history.height);
+	size_t n = (size_t)history.width * history.height;
+	for (size_t p = 0; p < n; p++){
+		float texel[4];
+		history.load(p, texel);
+		DecodeYCoCg(texel, &out.pixels[p * 4]);
+	}
+}
+
+// Mirrors taa.hlsl PS_YCoCg
+void ResolveTAAYCoCg(HistoryImage &out, const HistoryImage &acc, const Image &scene, const TAA_PARAM &param, ThreadPool *pool)
+{
+	if (scene.empty() || acc.width != scene.width || acc.height != scene.height) return;
+	if (out.id != acc.id || out.width != acc.width || out.height != acc.height){
+		out.resize(acc.id, acc.width, acc.height);
+	}
+
+	const int width = acc.width, height = acc.height;
+	TAPS taps;
+	setupTaps(taps, param, width, height);
+
+	YCOCG32_TEXELS texels32 = { acc.words.data(), out.words.data() };
+	YCOCG64_TEXELS texels64 = { acc.words.data(), out.words.data() };
+	auto row = [&](unsigned y){
+		if (acc.id == TAA_HISTORY::YCOCG64){
+			resolveRow(texels64, taps, scene, width, height, (int)y);
+		}else{
+			resolveRow(texels32, taps, scene, width, height, (int)y);
+		}
+	};
+
+	if (pool){
+		pool->parallelFor(height, row);
+	}else{
+		for (int y = 0; y < height; y++) row(y);
+	}
+}
+
+}// namespace tpot
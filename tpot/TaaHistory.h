@@ -0,0 +1,87 @@
+#ifndef TPOT_TAA_HISTORY_H__
+#define TPOT_TAA_HISTORY_H__
+
+#include <vector>
+#include "types.h"
+#include "TaaResolve.h"
+
+namespace tpot
+{
+	class ThreadPool;
+
+	// How rt_taa holds the accumulated image. The YCoCg texel is
+	// (Y, Co + 0.5, Cg + 0.5, A), as EncodeYCoCg in taa.hlsl.
+	struct TAA_HISTORY{
+		enum ID
+		{
+			RGB,		// RGBA in the frame format, taa.hlsl PS
+			YCOCG64,	// RGBA16F, 8 bytes
+			YCOCG32,	// RGB10A2 UNORM, 4 bytes; Y saturates at 1, 2 bit alpha
+
+			MAX,
+		};
+
+		static const char *name(TAA_HISTORY::ID id);
+		static bool parse(const char *str, TAA_HISTORY::ID *id);
+		static RENDER_TARGET::FORMAT format(TAA_HISTORY::ID id, RENDER_TARGET::FORMAT rgb);
+	};
+
+	// Co and Cg of an RGB difference are half as long as its G and B,
+	// so this matches TAA_CBCR_THRESHOLD
+	const float TAA_COCG_THRESHOLD = 0.16f;
+
+	inline void EncodeYCoCg(const float rgba[4], float texel[4])
+	{
+		texel[0] = 0.25f * rgba[0] + 0.5f * rgba[1] + 0.25f * rgba[2];
+		texel[1] = 0.5f * rgba[0] - 0.5f * rgba[2] + 0.5f;
+		texel[2] = -0.25f * rgba[0] + 0.5f * rgba[1] - 0.25f * rgba[2] + 0.5f;
+		texel[3] = rgba[3];
+	}
+
+	inline void DecodeYCoCg(const float texel[4], float rgba[4])
+	{
+		float co = texel[1] - 0.5f;
+		float cg = texel[2] - 0.5f;
+		float t = texel[0] - cg;
+		rgba[0] = t + co;
+		rgba[1] = texel[0] + cg;
+		rgba[2] = t - co;
+		rgba[3] = texel[3];
+	}
+
+	// DXGI_FORMAT_R16_FLOAT, round to nearest even
+	unsigned short FloatToHalf(float f);
+	float HalfToFloat(unsigned short h);
+
+	// Texel <-> memory layout of the history format, R in the low bits
+	unsigned int PackRGB10A2(const float texel[4]);
+	void UnpackRGB10A2(unsigned int word, float texel[4]);
+	unsigned long long PackRGBA16F(const float texel[4]);
+	void UnpackRGBA16F(unsigned long long word, float texel[4]);
+
+	// CPU side rt_taa in one of the YCoCg encodings
+	struct HistoryImage
+	{
+		TAA_HISTORY::ID id = TAA_HISTORY::YCOCG32;
+		int width = 0;
+		int height = 0;
+		std::vector<unsigned int> words;	// 1 (YCOCG32) or 2 (YCOCG64) per pixel
+
+		static unsigned wordsPerPixel(TAA_HISTORY::ID id){ return (id == TAA_HISTORY::YCOCG64) ? 2 : 1; }
+		void resize(TAA_HISTORY::ID i, int w, int h){ id = i; width = w; height = h; words.assign((size_t)w * h * wordsPerPixel(i), 0); }
+		bool empty() const { return words.empty(); }
+
+		void load(size_t pixel, float texel[4]) const;
+		void store(size_t pixel, const float texel[4]);
+	};
+
+	void EncodeHistory(HistoryImage &out, const Image &rgba, TAA_HISTORY::ID id);
+	void DecodeHistory(Image &out, const HistoryImage &history);
+
+	// taa.hlsl PS_YCoCg: the neighbours are clamped in the stored space and
+	// only the scene centre is converted. out gets the encoding of acc.
+	void ResolveTAAYCoCg(HistoryImage &out, const HistoryImage &acc, const Image &scene, const TAA_PARAM &param,
+		ThreadPool *pool = nullptr);
+
+}// namespace tpot
+#endif // TPOT_TAA_HISTORY_H__
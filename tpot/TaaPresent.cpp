@@ -0,0 +1,109 @@
+#include <math.h>
+#include <string.h>
+#include "TaaPresent.h"
+#include "ThreadPool.h"
+
+namespace tpot
+{
+
+namespace
+{
+	enum{
+		BAND_ROWS = 8,	// rows per task
+	};
+
+	const char *NAMES[TONEMAP::MAX] = {
+		"none",
+		"reinhard",
+	};
+
+	// Same integer hash as PresentHash in the shaders (Wang)
+	inline unsigned int presentHash(unsigned int x, unsigned int y, unsigned int frame)
+	{
+		unsigned int h = x * 1973u + y * 9277u + frame * 26699u;
+		h = (h ^ 61u) ^ (h >> 16);
+		h *= 9u;
+		h ^= h >> 4;
+		h *= 0x27d4eb2du;
+		h ^= h >> 15;
+		return h;
+	}
+
+	inline float saturate(float v)
+	{
+		return (0.0f < v) ? ((v < 1.0f) ? v : 1.0f) : 0.0f;// NaN goes to 0
+	}
+
+	inline float linearToSRGB(float c)
+	{
+		return (c <= 0.0031308f) ? 12.92f * c : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+	}
+
+	inline unsigned int unorm8(float v)
+	{
+		return (unsigned int)(saturate(v) * 255.0f + 0.5f);
+	}
+}// namespace
+
+
+const char *TONEMAP::name(TONEMAP::ID id)
+{
+	return (0 <= id && id < MAX) ? NAMES[id] : "?";
+}
+
+bool TONEMAP::parse(const char *str, TONEMAP::ID *id)
+{
+	for (int i = 0; i < MAX; i++){
+		if (strcmp(str, NAMES[i]) == 0){
+			*id = (TONEMAP::ID)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+unsigned int PresentPixel(const float rgba[4], int x, int y, const TAA_PRESENT_PARAM &param)
+{
+	float d = 0.0f;
+	if (param.dither){
+		d = ((float)(presentHash((unsigned)x, (unsigned)y, param.frame & 0xffff) & 0xffff) * (1.0f / 65536.0f) - 0.5f) * (1.0f / 255.0f);
+	}
+
+	unsigned int word = unorm8(rgba[3]) << 24;
+	for (int c = 0; c < 3; c++){
+		float v = rgba[c] * param.exposure;
+		if (param.tonemap == TONEMAP::REINHARD) v = v / (1.0f + v);
+		word |= unorm8(linearToSRGB(saturate(v)) + d) << (8 * c);
+	}
+	return word;
+}
+
+void PresentRows(PresentImage &out, const Image &src, int y0, int y1, const TAA_PRESENT_PARAM &param)
+{
+	for (int y = y0; y < y1; y++){
+		unsigned int *dst = &out.pixels[(size_t)y * out.width];
+		for (int x = 0; x < src.width; x++){
+			dst[x] = PresentPixel(src.at(x, y), x, y, param);
+		}
+	}
+}
+
+void PresentTAA(PresentImage &out, const Image &history, const TAA_PRESENT_PARAM &param, ThreadPool *pool)
+{
+	if (out.width != history.width || out.height != history.height) out.resize(history.width, history.height);
+
+	unsigned bands = (unsigned)(history.height + BAND_ROWS - 1) / BAND_ROWS;
+	auto band = [&](unsigned i){
+		int y0 = (int)i * BAND_ROWS;
+		int y1 = (y0 + BAND_ROWS < history.height) ? y0 + BAND_ROWS : history.height;
+		PresentRows(out, history, y0, y1, param);
+	};
+
+	if (pool){
+		pool->parallelFor(bands, band);
+	}else{
+		for (unsigned i = 0; i < bands; i++) band(i);
+	}
+}
+
+}// namespace tpot
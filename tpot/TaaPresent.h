@@ -0,0 +1,63 @@
+#ifndef TPOT_TAA_PRESENT_H__
+#define TPOT_TAA_PRESENT_H__
+
+#include <vector>
+#include "image.h"
+
+namespace tpot
+{
+	class ThreadPool;
+
+	struct TONEMAP{
+		enum ID
+		{
+			NONE,		// clamp to [0,1]
+			REINHARD,	// c / (1 + c) per channel
+
+			MAX,
+		};
+
+		static const char *name(TONEMAP::ID id);
+		static bool parse(const char *str, TONEMAP::ID *id);
+	};
+
+	// What the back buffer gets of the history, g_fPresent of decal.hlsl and taa.hlsl
+	struct TAA_PRESENT_PARAM
+	{
+		TONEMAP::ID tonemap;
+		float       exposure;	// scales the linear colour before the tone map
+		bool        dither;		// +-0.5 of an 8 bit sRGB step before quantization
+		unsigned int frame;		// dither seed, the low 16 bits are used
+	};
+
+	inline void CopyPresentParam(float cb[4], const TAA_PRESENT_PARAM &param)
+	{
+		cb[0] = (float)param.tonemap;
+		cb[1] = param.exposure;
+		cb[2] = param.dither ? 1.0f : 0.0f;
+		cb[3] = (float)(param.frame & 0xffff);
+	}
+
+	// The DXUT back buffer, DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, R in the low byte
+	struct PresentImage
+	{
+		int width = 0;
+		int height = 0;
+		std::vector<unsigned int> pixels;
+
+		void resize(int w, int h){ width = w; height = h; pixels.assign((size_t)w * h, 0); }
+	};
+
+	// Present() of the shaders: exposure, tone map, dither, then the sRGB
+	// encode of the render target view. The GPU encodes with its own
+	// conversion, which may be one step off the one here.
+	unsigned int PresentPixel(const float rgba[4], int x, int y, const TAA_PRESENT_PARAM &param);
+
+	// Rows [y0, y1) of src into out, which has the size of src
+	void PresentRows(PresentImage &out, const Image &src, int y0, int y1, const TAA_PRESENT_PARAM &param);
+
+	// decal.hlsl PS over the whole history: the second pass of the two pass present
+	void PresentTAA(PresentImage &out, const Image &history, const TAA_PRESENT_PARAM &param, ThreadPool *pool = nullptr);
+
+}// namespace tpot
+#endif // TPOT_TAA_PRESENT_H__
@@ -0,0 +1,82 @@
+#include "TaaReproject.h"
+#include "ThreadPool.h"
+
+namespace tpot
+{
+
+namespace
+{
+	inline float clampf(float v, float lo, float hi){ return (v < lo) ? lo : (hi < v) ? hi : v; }
+	inline int clampi(int v, int lo, int hi){ return (v < lo) ? lo : (hi < v) ? hi : v; }
+}// namespace
+
+bool ReprojectUV(const MATRIX &reprojection, float u, float v, float depth, float *prev_u, float *prev_v)
+{
+	float clip[3] = { u * 2.0f - 1.0f, 1.0f - v * 2.0f, depth };
+	float prev[4];
+	TransformCoord(reprojection, clip, prev);
+
+	*prev_u = 0.5f * prev[0] / prev[3] + 0.5f;
+	*prev_v = -0.5f * prev[1] / prev[3] + 0.5f;
+	// written so that NaN also counts as off screen, as any(uv != saturate(uv))
+	return (0.0f <= *prev_u && *prev_u <= 1.0f && 0.0f <= *prev_v && *prev_v <= 1.0f);
+}
+
+// Mirrors taa.hlsl PS_Reproject
+void ReprojectTAA(Image &out, const Image &acc, const Image &scene, const Image &depth, const Image &prev_depth,
+	const TAA_REPROJECT_PARAM &param, ThreadPool *pool)
+{
+	if (acc.empty() || scene.empty() || depth.empty()) return;
+	if (out.width != acc.width || out.height != acc.height){
+		out.resize(acc.width, acc.height);
+	}
+
+	const int rw = (int)param.render_size[0], rh = (int)param.render_size[1];
+	const float rate = param.taa.fRate;
+
+	auto row = [&](unsigned y){
+		float v = ((float)y + 0.5f) * param.taa.inv_screen_size[1];
+		for (int x = 0; x < out.width; x++){
+			float u = ((float)x + 0.5f) * param.taa.inv_screen_size[0];
+			float *dst = out.at(x, y);
+
+			float center[4];
+			SampleLinear(scene, u, v, center);
+
+			int ix = clampi((int)(u * (float)rw), 0, rw - 1);
+			int iy = clampi((int)(v * (float)rh), 0, rh - 1);
+			float hu, hv;
+			if (1.0f <= rate || TestHistory(param.reprojection, prev_depth, u, v, depth.at(ix, iy)[0], param.depth_reject, &hu, &hv) != DISOCCLUSION::VISIBLE){
+				for (int c = 0; c < 4; c++) dst[c] = center[c];
+				continue;
+			}
+
+			float color_min[4] = { center[0], center[1], center[2], center[3] };
+			float color_max[4] = { center[0], center[1], center[2], center[3] };
+			for (int ny = -1; ny <= 1; ny++){
+				for (int nx = -1; nx <= 1; nx++){
+					const float *n = scene.at(clampi(ix + nx, 0, rw - 1), clampi(iy + ny, 0, rh - 1));
+					for (int c = 0; c < 4; c++){
+						color_min[c] = (n[c] < color_min[c]) ? n[c] : color_min[c];
+						color_max[c] = (color_max[c] < n[c]) ? n[c] : color_max[c];
+					}
+				}
+			}
+
+			float history[4];
+			SampleLinear(acc, hu, hv, history);
+			for (int c = 0; c < 4; c++){
+				float h = clampf(history[c], color_min[c], color_max[c]);
+				dst[c] = h + (center[c] - h) * rate;
+			}
+		}
+	};
+
+	if (pool){
+		pool->parallelFor(out.height, row);
+	}else{
+		for (int y = 0; y < out.height; y++) row(y);
+	}
+}
+
+}// namespace tpot
@@ -0,0 +1,33 @@
+#ifndef TPOT_TAA_REPROJECT_H__
+#define TPOT_TAA_REPROJECT_H__
+
+#include "TaaResolve.h"
+#include "Matrix.h"
+#include "TaaDisocclusion.h"
+
+namespace tpot
+{
+	class ThreadPool;
+
+	// CPU twin of CB_TAA for taa.hlsl PS_Reproject
+	struct TAA_REPROJECT_PARAM
+	{
+		TAA_PARAM taa;
+		float render_size[2];	// size of scene and depth
+		MATRIX reprojection;	// inverse(jittered view projection) * previous unjittered view projection
+		TAA_DEPTH_REJECT depth_reject;
+	};
+
+	// Where the surface seen at (u, v) with depth buffer value depth was in the
+	// previous frame, in texture coordinates. Returns false when it was off screen.
+	bool ReprojectUV(const MATRIX &reprojection, float u, float v, float depth, float *prev_u, float *prev_v);
+
+	// Runs taa.hlsl PS_Reproject over every pixel of out.
+	// acc and out have the output size, scene and depth have render_size.
+	// depth holds the depth buffer value in its red channel (TestScene::render),
+	// prev_depth last frame's; empty, no history is rejected for depth.
+	void ReprojectTAA(Image &out, const Image &acc, const Image &scene, const Image &depth, const Image &prev_depth,
+		const TAA_REPROJECT_PARAM &param, ThreadPool *pool = nullptr);
+
+}// namespace tpot
+#endif // TPOT_TAA_REPROJECT_H__
@@ -0,0 +1,356 @@
+#include <vector>
+#include "TaaResolve.h"
+#include "ThreadPool.h"
+
+namespace tpot
+{
+
+namespace
+{
+	enum{
+		TILE_SIZE = 64,
+		PRESENT_ROWS = 8,	// ResolvePresentTAA rows per task
+		NEIGHBOR_MAX = 4,
+	};
+
+	// Every neighbour is an axis aligned offset of fBlurSize texels,
+	// so the bilinear fetch collapses to two taps with constant weights.
+	struct RESOLVE_CONTEXT
+	{
+		const float *acc;
+		const float *scene;
+		float *dst;
+		int width;
+		int height;
+
+		int   tap_dy[NEIGHBOR_MAX][2];
+		float tap_w[NEIGHBOR_MAX][2];
+		std::vector<int> tap_col[NEIGHBOR_MAX][2];// wrapped column per x
+	};
+
+	inline int wrap(int i, int n)
+	{
+		i %= n;
+		return (i < 0) ? i + n : i;
+	}
+
+	void setup(RESOLVE_CONTEXT &ctx, const TAA_PARAM &param)
+	{
+		static const float neighbor_offset[NEIGHBOR_MAX][2] = {
+			{ 0, +1 },
+			{ 0, -1 },
+			{ +1, 0 },
+			{ -1, 0 },
+		};
+
+		for (int i = 0; i < NEIGHBOR_MAX; i++){
+			// uv offset -> texel offset, as the sampler does with the resource size
+			float sx = neighbor_offset[i][0] * param.inv_screen_size[0] * param.fBlurSize * (float)ctx.width;
+			float sy = neighbor_offset[i][1] * param.inv_screen_size[1] * param.fBlurSize * (float)ctx.height;
+			float fx = floorf(sx), fy = floorf(sy);
+			int ix = (int)fx, iy = (int)fy;
+			float wx = sx - fx, wy = sy - fy;
+
+			int dx[2], dy[2];
+			if (neighbor_offset[i][0] != 0){
+				dx[0] = ix; dx[1] = ix + 1; dy[0] = dy[1] = iy;
+				ctx.tap_w[i][0] = 1.0f - wx; ctx.tap_w[i][1] = wx;
+			}else{
+				dx[0] = dx[1] = ix; dy[0] = iy; dy[1] = iy + 1;
+				ctx.tap_w[i][0] = 1.0f - wy; ctx.tap_w[i][1] = wy;
+			}
+
+			for (int t = 0; t < 2; t++){
+				ctx.tap_dy[i][t] = dy[t];
+				ctx.tap_col[i][t].resize(ctx.width);
+				for (int x = 0; x < ctx.width; x++){
+					ctx.tap_col[i][t][x] = wrap(x + dx[t], ctx.width);
+				}
+			}
+		}
+	}
+
+	void tapRows(const RESOLVE_CONTEXT &ctx, int y, const float *rows[NEIGHBOR_MAX][2])
+	{
+		for (int i = 0; i < NEIGHBOR_MAX; i++){
+			for (int t = 0; t < 2; t++){
+				rows[i][t] = ctx.acc + (size_t)wrap(y + ctx.tap_dy[i][t], ctx.height) * ctx.width * 4;
+			}
+		}
+	}
+
+	inline void resolvePixelScalar(const RESOLVE_CONTEXT &ctx, const float *rows[NEIGHBOR_MAX][2], const float *center, float *dst, int x)
+	{
+		float neighbor_sum[4] = { center[0], center[1], center[2], center[3] };
+
+		for (int i = 0; i < NEIGHBOR_MAX; i++){
+			const float *a = rows[i][0] + ctx.tap_col[i][0][x] * 4;
+			const float *b = rows[i][1] + ctx.tap_col[i][1][x] * 4;
+			float w0 = ctx.tap_w[i][0], w1 = ctx.tap_w[i][1];
+			float neighbor[4] = {
+				a[0] * w0 + b[0] * w1,
+				a[1] * w0 + b[1] * w1,
+				a[2] * w0 + b[2] * w1,
+				a[3] * w0 + b[3] * w1,
+			};
+			TaaClampNeighbor(neighbor, center);
+			neighbor_sum[0] += neighbor[0];
+			neighbor_sum[1] += neighbor[1];
+			neighbor_sum[2] += neighbor[2];
+			neighbor_sum[3] += neighbor[3];
+		}
+
+		dst[0] = neighbor_sum[0] / 5.0f;
+		dst[1] = neighbor_sum[1] / 5.0f;
+		dst[2] = neighbor_sum[2] / 5.0f;
+		dst[3] = neighbor_sum[3] / 5.0f;
+	}
+
+	void resolveRowScalar(const RESOLVE_CONTEXT &ctx, int y, int x0, int x1)
+	{
+		const float *rows[NEIGHBOR_MAX][2];
+		tapRows(ctx, y, rows);
+		const float *scene = ctx.scene + (size_t)y * ctx.width * 4;
+		float *dst = ctx.dst + (size_t)y * ctx.width * 4;
+
+		for (int x = x0; x < x1; x++){
+			resolvePixelScalar(ctx, rows, scene + x * 4, dst + x * 4, x);
+		}
+	}
+
+#if TPOT_X86
+	// One pixel per register: RGBA maps onto the four lanes
+	TPOT_TARGET_SSE4 void resolveRowSSE4(const RESOLVE_CONTEXT &ctx, int y, int x0, int x1)
+	{
+		const float *rows[NEIGHBOR_MAX][2];
+		tapRows(ctx, y, rows);
+		const float *scene = ctx.scene + (size_t)y * ctx.width * 4;
+		float *dst = ctx.dst + (size_t)y * ctx.width * 4;
+
+		const __m128 sign = _mm_set1_ps(-0.0f);
+		const __m128 rgb2y = _mm_setr_ps(0.29900f, 0.58700f, 0.11400f, 0.0f);
+		const __m128 rgb2cb = _mm_setr_ps(-0.16874f, -0.33126f, 0.50000f, 0.0f);
+		const __m128 rgb2cr = _mm_setr_ps(0.50000f, -0.41869f, -0.081f, 0.0f);
+		const __m128 ycc2r = _mm_setr_ps(1.0f, 0.00000f, 1.40200f, 0.0f);
+		const __m128 ycc2g = _mm_setr_ps(1.0f, -0.34414f, -0.71414f, 0.0f);
+		const __m128 ycc2b = _mm_setr_ps(1.0f, 1.77200f, 1.40200f, 0.0f);
+		const __m128 threshold = _mm_set1_ps(TAA_CBCR_THRESHOLD);
+		const __m128 five = _mm_set1_ps(5.0f);
+
+		__m128 w[NEIGHBOR_MAX][2];
+		for (int i = 0; i < NEIGHBOR_MAX; i++){
+			w[i][0] = _mm_set1_ps(ctx.tap_w[i][0]);
+			w[i][1] = _mm_set1_ps(ctx.tap_w[i][1]);
+		}
+
+		for (int x = x0; x < x1; x++){
+			__m128 center = _mm_loadu_ps(scene + x * 4);
+			__m128 sum = center;
+
+			for (int i = 0; i < NEIGHBOR_MAX; i++){
+				__m128 a = _mm_loadu_ps(rows[i][0] + ctx.tap_col[i][0][x] * 4);
+				__m128 b = _mm_loadu_ps(rows[i][1] + ctx.tap_col[i][1][x] * 4);
+				__m128 neighbor = _mm_add_ps(_mm_mul_ps(a, w[i][0]), _mm_mul_ps(b, w[i][1]));
+
+				__m128 diff = _mm_andnot_ps(sign, _mm_sub_ps(neighbor, center));
+				__m128 ycc = _mm_or_ps(_mm_or_ps(
+					_mm_dp_ps(diff, rgb2y, 0x71),
+					_mm_dp_ps(diff, rgb2cb, 0x72)),
+					_mm_dp_ps(diff, rgb2cr, 0x74));
+				__m128 len = _mm_sqrt_ps(_mm_dp_ps(diff, diff, 0x6f));
+
+				ycc = _mm_mul_ps(ycc, _mm_div_ps(threshold, len));
+				__m128 rgb = _mm_or_ps(_mm_or_ps(
+					_mm_dp_ps(ycc, ycc2r, 0x71),
+					_mm_dp_ps(ycc, ycc2g, 0x72)),
+					_mm_dp_ps(ycc, ycc2b, 0x74));
+				__m128 clamped = _mm_blend_ps(_mm_add_ps(center, rgb), neighbor, 0x8);// keep alpha
+
+				neighbor = _mm_blendv_ps(neighbor, clamped, _mm_cmplt_ps(threshold, len));
+				sum = _mm_add_ps(sum, neighbor);
+			}
+
+			_mm_storeu_ps(dst + x * 4, _mm_div_ps(sum, five));
+		}
+	}
+
+	// Two pixels per register, one in each 128 bit lane
+	TPOT_TARGET_AVX2 void resolveRowAVX2(const RESOLVE_CONTEXT &ctx, int y, int x0, int x1)
+	{
+		const float *rows[NEIGHBOR_MAX][2];
+		tapRows(ctx, y, rows);
+		const float *scene = ctx.scene + (size_t)y * ctx.width * 4;
+		float *dst = ctx.dst + (size_t)y * ctx.width * 4;
+
+		const __m256 sign = _mm256_set1_ps(-0.0f);
+		const __m256 rgb2y = _mm256_setr_ps(0.29900f, 0.58700f, 0.11400f, 0.0f, 0.29900f, 0.58700f, 0.11400f, 0.0f);
+		const __m256 rgb2cb = _mm256_setr_ps(-0.16874f, -0.33126f, 0.50000f, 0.0f, -0.16874f, -0.33126f, 0.50000f, 0.0f);
+		const __m256 rgb2cr = _mm256_setr_ps(0.50000f, -0.41869f, -0.081f, 0.0f, 0.50000f, -0.41869f, -0.081f, 0.0f);
+		const __m256 ycc2r = _mm256_setr_ps(1.0f, 0.00000f, 1.40200f, 0.0f, 1.0f, 0.00000f, 1.40200f, 0.0f);
+		const __m256 ycc2g = _mm256_setr_ps(1.0f, -0.34414f, -0.71414f, 0.0f, 1.0f, -0.34414f, -0.71414f, 0.0f);
+		const __m256 ycc2b = _mm256_setr_ps(1.0f, 1.77200f, 1.40200f, 0.0f, 1.0f, 1.77200f, 1.40200f, 0.0f);
+		const __m256 threshold = _mm256_set1_ps(TAA_CBCR_THRESHOLD);
+		const __m256 five = _mm256_set1_ps(5.0f);
+
+		__m256 w[NEIGHBOR_MAX][2];
+		for (int i = 0; i < NEIGHBOR_MAX; i++){
+			w[i][0] = _mm256_set1_ps(ctx.tap_w[i][0]);
+			w[i][1] = _mm256_set1_ps(ctx.tap_w[i][1]);
+		}
+
+		int x = x0;
+		for (; x + 2 <= x1; x += 2){
+			__m256 center = _mm256_loadu_ps(scene + x * 4);
+			__m256 sum = center;
+
+			for (int i = 0; i < NEIGHBOR_MAX; i++){
+				const float *a0 = rows[i][0] + ctx.tap_col[i][0][x] * 4;
+				const float *a1 = rows[i][0] + ctx.tap_col[i][0][x + 1] * 4;
+				const float *b0 = rows[i][1] + ctx.tap_col[i][1][x] * 4;
+				const float *b1 = rows[i][1] + ctx.tap_col[i][1][x + 1] * 4;
+				__m256 a = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(a0)), _mm_loadu_ps(a1), 1);
+				__m256 b = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(b0)), _mm_loadu_ps(b1), 1);
+				__m256 neighbor = _mm256_add_ps(_mm256_mul_ps(a, w[i][0]), _mm256_mul_ps(b, w[i][1]));
+
+				__m256 diff = _mm256_andnot_ps(sign, _mm256_sub_ps(neighbor, center));
+				__m256 ycc = _mm256_or_ps(_mm256_or_ps(
+					_mm256_dp_ps(diff, rgb2y, 0x71),
+					_mm256_dp_ps(diff, rgb2cb, 0x72)),
+					_mm256_dp_ps(diff, rgb2cr, 0x74));
+				__m256 len = _mm256_sqrt_ps(_mm256_dp_ps(diff, diff, 0x6f));
+
+				ycc = _mm256_mul_ps(ycc, _mm256_div_ps(threshold, len));
+				__m256 rgb = _mm256_or_ps(_mm256_or_ps(
+					_mm256_dp_ps(ycc, ycc2r, 0x71),
+					_mm256_dp_ps(ycc, ycc2g, 0x72)),
+					_mm256_dp_ps(ycc, ycc2b, 0x74));
+				__m256 clamped = _mm256_blend_ps(_mm256_add_ps(center, rgb), neighbor, 0x88);// keep alpha
+
+				neighbor = _mm256_blendv_ps(neighbor, clamped, _mm256_cmp_ps(threshold, len, _CMP_LT_OQ));
+				sum = _mm256_add_ps(sum, neighbor);
+			}
+
+			_mm256_storeu_ps(dst + x * 4, _mm256_div_ps(sum, five));
+		}
+
+		if (x < x1){
+			resolvePixelScalar(ctx, rows, scene + x * 4, dst + x * 4, x);
+		}
+	}
+#endif // TPOT_X86
+
+	typedef void(*RESOLVE_ROW)(const RESOLVE_CONTEXT &ctx, int y, int x0, int x1);
+
+	RESOLVE_ROW selectRow(SIMD::ID simd)
+	{
+#if TPOT_X86
+		if (simd == SIMD::AVX2 && SIMD::supported(SIMD::AVX2)) return resolveRowAVX2;
+		if (simd != SIMD::SCALAR && SIMD::supported(SIMD::SSE4)) return resolveRowSSE4;
+#endif
+		return resolveRowScalar;
+	}
+
+	void setupContext(RESOLVE_CONTEXT &ctx, Image &out, const Image &acc, const Image &scene, const TAA_PARAM &param)
+	{
+		ctx.acc = acc.data();
+		ctx.scene = scene.data();
+		ctx.dst = out.data();
+		ctx.width = scene.width;
+		ctx.height = scene.height;
+		setup(ctx, param);
+	}
+
+}// namespace
+
+
+void ResolveTAA(Image &out, const Image &acc, const Image &scene, const TAA_PARAM &param, SIMD::ID simd, ThreadPool *pool)
+{
+	if (scene.empty() || acc.width != scene.width || acc.height != scene.height) return;
+	if (out.width != scene.width || out.height != scene.height){
+		out.resize(scene.width, scene.height);
+	}
+
+	RESOLVE_CONTEXT ctx;
+	setupContext(ctx, out, acc, scene, param);
+
+	RESOLVE_ROW row = selectRow(simd);
+
+	unsigned tiles_x = (ctx.width + TILE_SIZE - 1) / TILE_SIZE;
+	unsigned tiles_y = (ctx.height + TILE_SIZE - 1) / TILE_SIZE;
+	auto tile = [&](unsigned t){
+		int x0 = (t % tiles_x) * TILE_SIZE;
+		int y0 = (t / tiles_x) * TILE_SIZE;
+		int x1 = (x0 + TILE_SIZE < ctx.width) ? x0 + TILE_SIZE : ctx.width;
+		int y1 = (y0 + TILE_SIZE < ctx.height) ? y0 + TILE_SIZE : ctx.height;
+		for (int y = y0; y < y1; y++){
+			row(ctx, y, x0, x1);
+		}
+	};
+
+	if (pool){
+		pool->parallelFor(tiles_x * tiles_y, tile);
+	}else{
+		for (unsigned t = 0; t < tiles_x * tiles_y; t++) tile(t);
+	}
+}
+
+void ResolveTAARects(Image &out, const Image &acc, const Image &scene, const TAA_PARAM &param,
+	const std::vector<PIXEL_RECT> &rects, SIMD::ID simd, ThreadPool *pool)
+{
+	if (scene.empty() || acc.width != scene.width || acc.height != scene.height) return;
+	if (out.width != scene.width || out.height != scene.height) return;
+
+	RESOLVE_CONTEXT ctx;
+	setupContext(ctx, out, acc, scene, param);
+
+	RESOLVE_ROW row = selectRow(simd);
+
+	auto rect = [&](unsigned i){
+		const PIXEL_RECT &r = rects[i];
+		for (int y = r.y0; y < r.y1; y++){
+			row(ctx, y, r.x0, r.x1);
+		}
+	};
+
+	if (pool){
+		pool->parallelFor((unsigned)rects.size(), rect);
+	}else{
+		for (unsigned i = 0; i < rects.size(); i++) rect(i);
+	}
+}
+
+void ResolvePresentTAA(Image &out, PresentImage &present, const Image &acc, const Image &scene, const TAA_PARAM &param,
+	const TAA_PRESENT_PARAM &present_param, SIMD::ID simd, ThreadPool *pool)
+{
+	if (scene.empty() || acc.width != scene.width || acc.height != scene.height) return;
+	if (out.width != scene.width || out.height != scene.height){
+		out.resize(scene.width, scene.height);
+	}
+	if (present.width != scene.width || present.height != scene.height){
+		present.resize(scene.width, scene.height);
+	}
+
+	RESOLVE_CONTEXT ctx;
+	setupContext(ctx, out, acc, scene, param);
+
+	RESOLVE_ROW row = selectRow(simd);
+
+	// each row is presented while it is still in cache
+	unsigned bands = (unsigned)(ctx.height + PRESENT_ROWS - 1) / PRESENT_ROWS;
+	auto band = [&](unsigned i){
+		int y0 = (int)i * PRESENT_ROWS;
+		int y1 = (y0 + PRESENT_ROWS < ctx.height) ? y0 + PRESENT_ROWS : ctx.height;
+		for (int y = y0; y < y1; y++){
+			row(ctx, y, 0, ctx.width);
+			PresentRows(present, out, y, y + 1, present_param);
+		}
+	};
+
+	if (pool){
+		pool->parallelFor(bands, band);
+	}else{
+		for (unsigned i = 0; i < bands; i++) band(i);
+	}
+}
+
+}// namespace tpot
@@ -0,0 +1,84 @@
+#ifndef TPOT_TAA_RESOLVE_H__
+#define TPOT_TAA_RESOLVE_H__
+
+#include <math.h>
+#include "image.h"
+#include "simd.h"
+#include "TaaPresent.h"
+
+namespace tpot
+{
+	class ThreadPool;
+
+	// CPU twin of CB_TAA without the quad matrix
+	struct TAA_PARAM
+	{
+		float inv_screen_size[2];
+		float fRate;		// not read by taa.hlsl PS, kept for parity with CB_TAA
+		float fBlurSize;
+	};
+
+	const float TAA_CBCR_THRESHOLD = 0.32f;
+
+	// Same coefficients as taa.hlsl
+	inline void RGB2YCbCr(const float rgb[3], float ycc[3])
+	{
+		ycc[0] = rgb[0] * 0.29900f + rgb[1] * 0.58700f + rgb[2] * 0.11400f;
+		ycc[1] = rgb[0] * -0.16874f + rgb[1] * -0.33126f + rgb[2] * 0.50000f;
+		ycc[2] = rgb[0] * 0.50000f + rgb[1] * -0.41869f + rgb[2] * -0.081f;
+	}
+
+	inline void YCbCr2RGB(const float ycc[3], float rgb[3])
+	{
+		rgb[0] = ycc[0] * 1.0f + ycc[1] * 0.00000f + ycc[2] * 1.40200f;
+		rgb[1] = ycc[0] * 1.0f + ycc[1] * -0.34414f + ycc[2] * -0.71414f;
+		rgb[2] = ycc[0] * 1.0f + ycc[1] * 1.77200f + ycc[2] * 1.40200f;
+	}
+
+	// Chroma clamp of one history neighbour against the current centre (loop body of taa.hlsl PS)
+	inline void TaaClampNeighbor(float neighbor[4], const float center[4])
+	{
+		float color_diff[3] = {
+			fabsf(neighbor[0] - center[0]),
+			fabsf(neighbor[1] - center[1]),
+			fabsf(neighbor[2] - center[2]),
+		};
+		float ycc[3];
+		RGB2YCbCr(color_diff, ycc);
+		// taa.hlsl takes the length of color_diff.yz (not ycc.yz); kept as is
+		float cbcr_len = sqrtf(color_diff[1] * color_diff[1] + color_diff[2] * color_diff[2]);
+		if (TAA_CBCR_THRESHOLD < cbcr_len){
+			float s = TAA_CBCR_THRESHOLD / cbcr_len;
+			ycc[0] *= s; ycc[1] *= s; ycc[2] *= s;
+			float rgb[3];
+			YCbCr2RGB(ycc, rgb);
+			neighbor[0] = center[0] + rgb[0];
+			neighbor[1] = center[1] + rgb[1];
+			neighbor[2] = center[2] + rgb[2];
+		}
+	}
+
+	// Runs taa.hlsl PS over every pixel of out.
+	// acc is the previous g_rt_taa, scene is g_rt_color; all three must have the same size.
+	// The neighbours are bilinear taps wrapped within acc, as AccTap in taa.hlsl.
+	void ResolveTAA(Image &out, const Image &acc, const Image &scene, const TAA_PARAM &param,
+		SIMD::ID simd = SIMD::best(), ThreadPool *pool = nullptr);
+
+	struct PIXEL_RECT
+	{
+		int x0, y0;
+		int x1, y1;	// exclusive
+	};
+
+	// ResolveTAA of the given rectangles only, one task each. The rest of
+	// out is left as it is, so it must already have the scene size.
+	void ResolveTAARects(Image &out, const Image &acc, const Image &scene, const TAA_PARAM &param,
+		const std::vector<PIXEL_RECT> &rects, SIMD::ID simd = SIMD::best(), ThreadPool *pool = nullptr);
+
+	// taa.hlsl PS_Present: ResolveTAA and PresentTAA of out in one pass over
+	// the image. present matches the two passes bit for bit.
+	void ResolvePresentTAA(Image &out, PresentImage &present, const Image &acc, const Image &scene, const TAA_PARAM &param,
+		const TAA_PRESENT_PARAM &present_param, SIMD::ID simd = SIMD::best(), ThreadPool *pool = nullptr);
+
+}// namespace tpot
+#endif // TPOT_TAA_RESOLVE_H__
@@ -0,0 +1,76 @@
+#include <math.h>
+#include "TaaUpsample.h"
+#include "ThreadPool.h"
+
+namespace tpot
+{
+
+namespace
+{
+	inline float saturate(float v){ return (v < 0.0f) ? 0.0f : (1.0f < v) ? 1.0f : v; }
+	inline float clampf(float v, float lo, float hi){ return (v < lo) ? lo : (hi < v) ? hi : v; }
+	inline int clampi(int v, int lo, int hi){ return (v < lo) ? lo : (hi < v) ? hi : v; }
+}// namespace
+
+// Mirrors taa.hlsl PS_Upsample
+void UpsampleTAA(Image &out, const Image &acc, const Image &scene, const TAA_UPSAMPLE_PARAM &param, ThreadPool *pool)
+{
+	if (acc.empty() || scene.empty()) return;
+	if (out.width != acc.width || out.height != acc.height){
+		out.resize(acc.width, acc.height);
+	}
+
+	const float rw = param.render_size[0], rh = param.render_size[1];
+	const float jx = param.jitter[0], jy = param.jitter[1];
+	const float to_out_x = 1.0f / (rw * param.taa.inv_screen_size[0]);
+	const float to_out_y = 1.0f / (rh * param.taa.inv_screen_size[1]);
+	const float rate = param.taa.fRate;
+
+	auto row = [&](unsigned y){
+		float v = ((float)y + 0.5f) * param.taa.inv_screen_size[1];
+		for (int x = 0; x < out.width; x++){
+			float u = ((float)x + 0.5f) * param.taa.inv_screen_size[0];
+			float *dst = out.at(x, y);
+
+			if (1.0f <= rate){// no history yet
+				SampleLinear(scene, u, v, dst);
+				continue;
+			}
+
+			float px = u * rw, py = v * rh;
+			float sx = clampf(floorf(px - jx), 0.0f, rw - 1.0f);
+			float sy = clampf(floorf(py - jy), 0.0f, rh - 1.0f);
+			float dx = (px - (sx + 0.5f + jx)) * to_out_x;
+			float dy = (py - (sy + 0.5f + jy)) * to_out_y;
+			float w = saturate(1.0f - fabsf(dx)) * saturate(1.0f - fabsf(dy)) * rate;
+			const float *sample = scene.at((int)sx, (int)sy);
+
+			// clamp the history to the 3x3 neighbourhood of the current samples
+			float color_min[4] = { sample[0], sample[1], sample[2], sample[3] };
+			float color_max[4] = { sample[0], sample[1], sample[2], sample[3] };
+			for (int ny = -1; ny <= 1; ny++){
+				for (int nx = -1; nx <= 1; nx++){
+					const float *n = scene.at(clampi((int)sx + nx, 0, scene.width - 1), clampi((int)sy + ny, 0, scene.height - 1));
+					for (int c = 0; c < 4; c++){
+						color_min[c] = (n[c] < color_min[c]) ? n[c] : color_min[c];
+						color_max[c] = (color_max[c] < n[c]) ? n[c] : color_max[c];
+					}
+				}
+			}
+
+			const float *history = acc.at(x, y);
+			for (int c = 0; c < 4; c++){
+				float h = clampf(history[c], color_min[c], color_max[c]);
+				dst[c] = h + (sample[c] - h) * w;
+			}
+		}
+	};
+
+	if (pool){
+		pool->parallelFor(out.height, row);
+	}else{
+		for (int y = 0; y < out.height; y++) row(y);
+	}
+}
+
+}// namespace tpot
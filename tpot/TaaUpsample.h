@@ -0,0 +1,24 @@
+#ifndef TPOT_TAA_UPSAMPLE_H__
+#define TPOT_TAA_UPSAMPLE_H__
+
+#include "TaaResolve.h"
+
+namespace tpot
+{
+	class ThreadPool;
+
+	// CPU twin of CB_TAA for taa.hlsl PS_Upsample
+	struct TAA_UPSAMPLE_PARAM
+	{
+		TAA_PARAM taa;			// inv_screen_size is the output (history) size
+		float render_size[2];	// size of the low resolution scene
+		float jitter[2];		// sample position inside a render pixel, in render pixels
+	};
+
+	// Reconstructs the full size history acc + low resolution scene into out.
+	// acc and out have the output size, scene has render_size.
+	void UpsampleTAA(Image &out, const Image &acc, const Image &scene, const TAA_UPSAMPLE_PARAM &param,
+		ThreadPool *pool = nullptr);
+
+}// namespace tpot
+#endif // TPOT_TAA_UPSAMPLE_H__
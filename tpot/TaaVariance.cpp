@@ -0,0 +1,290 @@
+#include <math.h>
+#include <string.h>
+#include "TaaVariance.h"
+#include "ThreadPool.h"
+
+namespace tpot
+{
+
+namespace
+{
+	enum{
+		TILE_SIZE = 32,	// pixels per task and axis
+		CACHE_SIZE = TILE_SIZE + 2,	// with the apron
+		CACHE_STRIDE = CACHE_SIZE * 4,	// floats per row
+		SUM_STRIDE = TILE_SIZE * 4,
+	};
+
+	const char *NAMES[TAA_CLAMP::MAX] = {
+		"chroma",
+		"variance",
+	};
+
+	struct VARIANCE_CONTEXT
+	{
+		const float *acc;
+		const float *scene;
+		float *dst;
+		int width;
+		int height;
+		float rate;
+	};
+
+	// groupshared g_tile of CS_Variance, and the horizontal 3 sums of it
+	// (and of its squares) for the separable 3x3 moments
+	struct TILE_CACHE
+	{
+		float scene[CACHE_SIZE * CACHE_STRIDE];
+		float sum[CACHE_SIZE * SUM_STRIDE];
+		float sum2[CACHE_SIZE * SUM_STRIDE];
+	};
+
+	inline int clampi(int i, int lo, int hi)
+	{
+		return (i < lo) ? lo : (hi < i) ? hi : i;
+	}
+
+	// The tile and a one pixel apron, clamped to the edges as the Load of CS_Variance
+	void loadTile(const VARIANCE_CONTEXT &ctx, TILE_CACHE &cache, int x0, int y0, int x1, int y1)
+	{
+		int w = x1 - x0;
+		for (int ty = 0; ty < y1 - y0 + 2; ty++){
+			const float *src = ctx.scene + (size_t)clampi(y0 - 1 + ty, 0, ctx.height - 1) * ctx.width * 4;
+			float *dst = cache.scene + ty * CACHE_STRIDE;
+			memcpy(dst, src + clampi(x0 - 1, 0, ctx.width - 1) * 4, 4 * sizeof(float));
+			memcpy(dst + 4, src + x0 * 4, (size_t)w * 4 * sizeof(float));
+			memcpy(dst + (w + 1) * 4, src + clampi(x1, 0, ctx.width - 1) * 4, 4 * sizeof(float));
+		}
+	}
+
+	inline float max0(float v)
+	{
+		return (0.0f < v) ? v : 0.0f;
+	}
+
+	inline float maxf(float a, float b)
+	{
+		return (a < b) ? b : a;
+	}
+
+	// One output pixel from the three horizontal sums above, at and below it
+	inline void variancePixelScalar(const float *s0, const float *s1, const float *s2,
+		const float *q0, const float *q1, const float *q2,
+		const float *center, const float *history, float rate, float *dst)
+	{
+		float h[4] = { history[0], history[1], history[2], history[3] };
+		float m1[3], d[3], e[3];
+		for (int c = 0; c < 3; c++){
+			m1[c] = ((s0[c] + s1[c]) + s2[c]) / 9.0f;
+			float m2 = ((q0[c] + q1[c]) + q2[c]) / 9.0f;
+			float sigma = sqrtf(max0(m2 - m1[c] * m1[c]));
+			d[c] = h[c] - m1[c];
+			e[c] = fabsf(d[c]) / (TAA_VARIANCE_GAMMA * sigma + TAA_VARIANCE_EPSILON);
+		}
+
+		float t = maxf(maxf(e[0], e[1]), e[2]);
+		if (1.0f < t){
+			for (int c = 0; c < 3; c++) h[c] = m1[c] + d[c] / t;
+		}
+
+		for (int c = 0; c < 4; c++){
+			dst[c] = h[c] + (center[c] - h[c]) * rate;
+		}
+	}
+
+	void outputRowsScalar(const VARIANCE_CONTEXT &ctx, const TILE_CACHE &cache, int x0, int y0, int x1, int y1)
+	{
+		for (int y = 0; y < y1 - y0; y++){
+			const float *s = cache.sum + y * SUM_STRIDE;
+			const float *q = cache.sum2 + y * SUM_STRIDE;
+			const float *center = cache.scene + (y + 1) * CACHE_STRIDE + 4;
+			size_t row = ((size_t)(y0 + y) * ctx.width + x0) * 4;
+			for (int i = 0; i < (x1 - x0) * 4; i += 4){
+				variancePixelScalar(s + i, s + SUM_STRIDE + i, s + 2 * SUM_STRIDE + i,
+					q + i, q + SUM_STRIDE + i, q + 2 * SUM_STRIDE + i,
+					center + i, ctx.acc + row + i, ctx.rate, ctx.dst + row + i);
+			}
+		}
+	}
+
+	void varianceTileScalar(const VARIANCE_CONTEXT &ctx, TILE_CACHE &cache, int x0, int y0, int x1, int y1)
+	{
+		int n = (x1 - x0) * 4;
+		for (int ty = 0; ty < y1 - y0 + 2; ty++){
+			const float *c = cache.scene + ty * CACHE_STRIDE;
+			float *s = cache.sum + ty * SUM_STRIDE;
+			float *q = cache.sum2 + ty * SUM_STRIDE;
+			for (int i = 0; i < n; i++){
+				float a = c[i], b = c[i + 4], d = c[i + 8];
+				s[i] = (a + b) + d;
+				q[i] = (a * a + b * b) + d * d;
+			}
+		}
+		outputRowsScalar(ctx, cache, x0, y0, x1, y1);
+	}
+
+#if TPOT_X86
+	// One pixel per register: RGBA maps onto the four lanes
+	TPOT_TARGET_SSE4 void varianceTileSSE4(const VARIANCE_CONTEXT &ctx, TILE_CACHE &cache, int x0, int y0, int x1, int y1)
+	{
+		int n = (x1 - x0) * 4;
+		for (int ty = 0; ty < y1 - y0 + 2; ty++){
+			const float *c = cache.scene + ty * CACHE_STRIDE;
+			float *s = cache.sum + ty * SUM_STRIDE;
+			float *q = cache.sum2 + ty * SUM_STRIDE;
+			for (int i = 0; i < n; i += 4){
+				__m128 a = _mm_loadu_ps(c + i), b = _mm_loadu_ps(c + i + 4), d = _mm_loadu_ps(c + i + 8);
+				_mm_storeu_ps(s + i, _mm_add_ps(_mm_add_ps(a, b), d));
+				_mm_storeu_ps(q + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, a), _mm_mul_ps(b, b)), _mm_mul_ps(d, d)));
+			}
+		}
+
+		const __m128 sign = _mm_set1_ps(-0.0f);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 nine = _mm_set1_ps(9.0f);
+		const __m128 gamma = _mm_set1_ps(TAA_VARIANCE_GAMMA);
+		const __m128 epsilon = _mm_set1_ps(TAA_VARIANCE_EPSILON);
+		const __m128 rate = _mm_set1_ps(ctx.rate);
+
+		for (int y = 0; y < y1 - y0; y++){
+			const float *s = cache.sum + y * SUM_STRIDE;
+			const float *q = cache.sum2 + y * SUM_STRIDE;
+			const float *center = cache.scene + (y + 1) * CACHE_STRIDE + 4;
+			size_t row = ((size_t)(y0 + y) * ctx.width + x0) * 4;
+			for (int i = 0; i < n; i += 4){
+				__m128 m1 = _mm_div_ps(_mm_add_ps(_mm_add_ps(_mm_loadu_ps(s + i), _mm_loadu_ps(s + SUM_STRIDE + i)), _mm_loadu_ps(s + 2 * SUM_STRIDE + i)), nine);
+				__m128 m2 = _mm_div_ps(_mm_add_ps(_mm_add_ps(_mm_loadu_ps(q + i), _mm_loadu_ps(q + SUM_STRIDE + i)), _mm_loadu_ps(q + 2 * SUM_STRIDE + i)), nine);
+				__m128 sigma = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(m2, _mm_mul_ps(m1, m1)), zero));
+
+				__m128 h = _mm_loadu_ps(ctx.acc + row + i);
+				__m128 d = _mm_sub_ps(h, m1);
+				__m128 e = _mm_div_ps(_mm_andnot_ps(sign, d), _mm_add_ps(_mm_mul_ps(gamma, sigma), epsilon));
+				__m128 t = _mm_max_ps(_mm_max_ps(_mm_shuffle_ps(e, e, 0x00), _mm_shuffle_ps(e, e, 0x55)), _mm_shuffle_ps(e, e, 0xaa));
+				__m128 clipped = _mm_blend_ps(_mm_add_ps(m1, _mm_div_ps(d, t)), h, 0x8);// keep alpha
+				h = _mm_blendv_ps(h, clipped, _mm_cmplt_ps(one, t));
+
+				__m128 c = _mm_loadu_ps(center + i);
+				_mm_storeu_ps(ctx.dst + row + i, _mm_add_ps(h, _mm_mul_ps(_mm_sub_ps(c, h), rate)));
+			}
+		}
+	}
+
+	// Two pixels per register, one in each 128 bit lane
+	TPOT_TARGET_AVX2 void varianceTileAVX2(const VARIANCE_CONTEXT &ctx, TILE_CACHE &cache, int x0, int y0, int x1, int y1)
+	{
+		int n = (x1 - x0) * 4;
+		for (int ty = 0; ty < y1 - y0 + 2; ty++){
+			const float *c = cache.scene + ty * CACHE_STRIDE;
+			float *s = cache.sum + ty * SUM_STRIDE;
+			float *q = cache.sum2 + ty * SUM_STRIDE;
+			int i = 0;
+			for (; i + 8 <= n; i += 8){
+				__m256 a = _mm256_loadu_ps(c + i), b = _mm256_loadu_ps(c + i + 4), d = _mm256_loadu_ps(c + i + 8);
+				_mm256_storeu_ps(s + i, _mm256_add_ps(_mm256_add_ps(a, b), d));
+				_mm256_storeu_ps(q + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a, a), _mm256_mul_ps(b, b)), _mm256_mul_ps(d, d)));
+			}
+			for (; i < n; i++){
+				float a = c[i], b = c[i + 4], d = c[i + 8];
+				s[i] = (a + b) + d;
+				q[i] = (a * a + b * b) + d * d;
+			}
+		}
+
+		const __m256 sign = _mm256_set1_ps(-0.0f);
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 nine = _mm256_set1_ps(9.0f);
+		const __m256 gamma = _mm256_set1_ps(TAA_VARIANCE_GAMMA);
+		const __m256 epsilon = _mm256_set1_ps(TAA_VARIANCE_EPSILON);
+		const __m256 rate = _mm256_set1_ps(ctx.rate);
+
+		for (int y = 0; y < y1 - y0; y++){
+			const float *s = cache.sum + y * SUM_STRIDE;
+			const float *q = cache.sum2 + y * SUM_STRIDE;
+			const float *center = cache.scene + (y + 1) * CACHE_STRIDE + 4;
+			size_t row = ((size_t)(y0 + y) * ctx.width + x0) * 4;
+			int i = 0;
+			for (; i + 8 <= n; i += 8){
+				__m256 m1 = _mm256_div_ps(_mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(s + i), _mm256_loadu_ps(s + SUM_STRIDE + i)), _mm256_loadu_ps(s + 2 * SUM_STRIDE + i)), nine);
+				__m256 m2 = _mm256_div_ps(_mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(q + i), _mm256_loadu_ps(q + SUM_STRIDE + i)), _mm256_loadu_ps(q + 2 * SUM_STRIDE + i)), nine);
+				__m256 sigma = _mm256_sqrt_ps(_mm256_max_ps(_mm256_sub_ps(m2, _mm256_mul_ps(m1, m1)), zero));
+
+				__m256 h = _mm256_loadu_ps(ctx.acc + row + i);
+				__m256 d = _mm256_sub_ps(h, m1);
+				__m256 e = _mm256_div_ps(_mm256_andnot_ps(sign, d), _mm256_add_ps(_mm256_mul_ps(gamma, sigma), epsilon));
+				__m256 t = _mm256_max_ps(_mm256_max_ps(_mm256_permute_ps(e, 0x00), _mm256_permute_ps(e, 0x55)), _mm256_permute_ps(e, 0xaa));
+				__m256 clipped = _mm256_blend_ps(_mm256_add_ps(m1, _mm256_div_ps(d, t)), h, 0x88);// keep alpha
+				h = _mm256_blendv_ps(h, clipped, _mm256_cmp_ps(one, t, _CMP_LT_OQ));
+
+				__m256 c = _mm256_loadu_ps(center + i);
+				_mm256_storeu_ps(ctx.dst + row + i, _mm256_add_ps(h, _mm256_mul_ps(_mm256_sub_ps(c, h), rate)));
+			}
+			if (i < n){
+				variancePixelScalar(s + i, s + SUM_STRIDE + i, s + 2 * SUM_STRIDE + i,
+					q + i, q + SUM_STRIDE + i, q + 2 * SUM_STRIDE + i,
+					center + i, ctx.acc + row + i, ctx.rate, ctx.dst + row + i);
+			}
+		}
+	}
+#endif // TPOT_X86
+
+	typedef void(*VARIANCE_TILE)(const VARIANCE_CONTEXT &ctx, TILE_CACHE &cache, int x0, int y0, int x1, int y1);
+
+	VARIANCE_TILE selectTile(SIMD::ID simd)
+	{
+#if TPOT_X86
+		if (simd == SIMD::AVX2 && SIMD::supported(SIMD::AVX2)) return varianceTileAVX2;
+		if (simd != SIMD::SCALAR && SIMD::supported(SIMD::SSE4)) return varianceTileSSE4;
+#endif
+		return varianceTileScalar;
+	}
+}// namespace
+
+
+const char *TAA_CLAMP::name(TAA_CLAMP::ID id)
+{
+	return (0 <= id && id < MAX) ? NAMES[id] : "?";
+}
+
+bool TAA_CLAMP::parse(const char *str, TAA_CLAMP::ID *id)
+{
+	for (int i = 0; i < MAX; i++){
+		if (strcmp(str, NAMES[i]) == 0){
+			*id = (TAA_CLAMP::ID)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+void ResolveTAAVariance(Image &out, const Image &acc, const Image &scene, const TAA_PARAM &param, SIMD::ID simd, ThreadPool *pool)
+{
+	if (scene.empty() || acc.width != scene.width || acc.height != scene.height) return;
+	if (out.width != scene.width || out.height != scene.height){
+		out.resize(scene.width, scene.height);
+	}
+
+	VARIANCE_CONTEXT ctx = { acc.data(), scene.data(), out.data(), scene.width, scene.height, param.fRate };
+	VARIANCE_TILE kernel = selectTile(simd);
+
+	unsigned tiles_x = (ctx.width + TILE_SIZE - 1) / TILE_SIZE;
+	unsigned tiles_y = (ctx.height + TILE_SIZE - 1) / TILE_SIZE;
+	auto tile = [&](unsigned t){
+		int x0 = (t % tiles_x) * TILE_SIZE;
+		int y0 = (t / tiles_x) * TILE_SIZE;
+		int x1 = (x0 + TILE_SIZE < ctx.width) ? x0 + TILE_SIZE : ctx.width;
+		int y1 = (y0 + TILE_SIZE < ctx.height) ? y0 + TILE_SIZE : ctx.height;
+		TILE_CACHE cache;
+		loadTile(ctx, cache, x0, y0, x1, y1);
+		kernel(ctx, cache, x0, y0, x1, y1);
+	};
+
+	if (pool){
+		pool->parallelFor(tiles_x * tiles_y, tile);
+	}else{
+		for (unsigned t = 0; t < tiles_x * tiles_y; t++) tile(t);
+	}
+}
+
+}// namespace tpot
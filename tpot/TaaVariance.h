@@ -0,0 +1,37 @@
+#ifndef TPOT_TAA_VARIANCE_H__
+#define TPOT_TAA_VARIANCE_H__
+
+#include "TaaResolve.h"
+
+namespace tpot
+{
+	class ThreadPool;
+
+	// How the TAA resolve keeps the history from ghosting
+	struct TAA_CLAMP{
+		enum ID
+		{
+			CHROMA,		// taa.hlsl PS: each history neighbour against the scene centre
+			VARIANCE,	// taa.hlsl CS_Variance: the history within the 3x3 deviation of the scene
+
+			MAX,
+		};
+
+		static const char *name(TAA_CLAMP::ID id);
+		static bool parse(const char *str, TAA_CLAMP::ID *id);
+	};
+
+	const int   TAA_VARIANCE_GROUP = 8;	// CS_Variance threads per axis, pixels per group
+	const float TAA_VARIANCE_GAMMA = 1.0f;	// deviations the history may be off the mean
+	const float TAA_VARIANCE_EPSILON = 1.0e-4f;
+
+	// Runs taa.hlsl CS_Variance over every pixel of out: the history at the
+	// pixel is clipped toward the 3x3 mean of the scene and blended with
+	// param.fRate. Sizes as ResolveTAA; the scene is clamped at the edges.
+	// Each task caches a tile of the scene with its apron, as the group does;
+	// all simd paths give the same bits.
+	void ResolveTAAVariance(Image &out, const Image &acc, const Image &scene, const TAA_PARAM &param,
+		SIMD::ID simd = SIMD::best(), ThreadPool *pool = nullptr);
+
+}// namespace tpot
+#endif // TPOT_TAA_VARIANCE_H__
@@ -0,0 +1,123 @@
+#include <math.h>
+#include "TemporalMetrics.h"
+
+namespace tpot
+{
+
+FlickerMeter::FlickerMeter()
+{
+	reset();
+}
+
+void FlickerMeter::reset()
+{
+	width_ = height_ = 0;
+	frames_ = 0;
+	mean_.clear();
+	m2_.clear();
+	last_.clear();
+	delta_sum_ = 0.0;
+}
+
+bool FlickerMeter::add(const Image &frame)
+{
+	if (frames_ == 0){
+		width_ = frame.width;
+		height_ = frame.height;
+		size_t n = (size_t)width_ * height_;
+		mean_.assign(n, 0.0);
+		m2_.assign(n, 0.0);
+		last_.assign(n, 0.0f);
+	}else if (frame.width != width_ || frame.height != height_){
+		return false;
+	}
+
+	frames_++;
+	size_t n = mean_.size();
+	for (size_t i = 0; i < n; i++){
+		float y = Luma(&frame.pixels[i * 4]);
+		double d = (double)y - mean_[i];
+		mean_[i] += d / (double)frames_;
+		m2_[i] += d * ((double)y - mean_[i]);
+		if (1 < frames_) delta_sum_ += fabs((double)y - (double)last_[i]);
+		last_[i] = y;
+	}
+	return true;
+}
+
+double FlickerMeter::variance() const
+{
+	if (frames_ < 2 || m2_.empty()) return 0.0;
+	double sum = 0.0;
+	for (double m2 : m2_) sum += m2;
+	return sum / ((double)(frames_ - 1) * (double)m2_.size());
+}
+
+double FlickerMeter::stddev() const
+{
+	if (frames_ < 2 || m2_.empty()) return 0.0;
+	double sum = 0.0;
+	for (double m2 : m2_) sum += sqrt(m2 / (double)(frames_ - 1));
+	return sum / (double)m2_.size();
+}
+
+double FlickerMeter::meanDelta() const
+{
+	if (frames_ < 2 || mean_.empty()) return 0.0;
+	return delta_sum_ / ((double)(frames_ - 1) * (double)mean_.size());
+}
+
+
+GhostMeter::GhostMeter(float threshold)
+	: threshold_(threshold)
+{
+	reset();
+}
+
+void GhostMeter::reset()
+{
+	last_ = Image();
+	frames_ = 0;
+	sum_ = lag_ = change_ = marked_ = pixels_ = 0.0;
+}
+
+bool GhostMeter::add(const Image &output, const Image &reference)
+{
+	if (output.width != reference.width || output.height != reference.height) return false;
+
+	if (last_.width == reference.width && last_.height == reference.height){
+		size_t n = (size_t)reference.width * reference.height;
+		for (size_t i = 0; i < n; i++){
+			float y = Luma(&reference.pixels[i * 4]);
+			double d = (double)Luma(&last_.pixels[i * 4]) - (double)y;
+			if (!(threshold_ < fabs(d))) continue;
+			double e = (double)Luma(&output.pixels[i * 4]) - (double)y;
+			double along = e * d;
+			sum_ += e * e;
+			lag_ += (along < 0.0) ? 0.0 : (d * d < along) ? d * d : along;
+			change_ += d * d;
+			marked_ += 1.0;
+		}
+		pixels_ += (double)n;
+	}
+	last_ = reference;
+	frames_++;
+	return true;
+}
+
+double GhostMeter::rms() const
+{
+	return (0.0 < marked_) ? sqrt(sum_ / marked_) : 0.0;
+}
+
+double GhostMeter::lag() const
+{
+	return (0.0 < change_) ? lag_ / change_ : 0.0;
+}
+
+double GhostMeter::coverage() const
+{
+	return (0.0 < pixels_) ? marked_ / pixels_ : 0.0;
+}
+
+}// namespace tpot
@@ -0,0 +1,70 @@
+#ifndef TPOT_TEMPORAL_METRICS_H__
+#define TPOT_TEMPORAL_METRICS_H__
+
+#include <vector>
+#include "image.h"
+
+namespace tpot
+{
+
+	// Rec.709 luma, as ImageSSIM
+	inline float Luma(const float *rgba)
+	{
+		return 0.2126f * rgba[0] + 0.7152f * rgba[1] + 0.0722f * rgba[2];
+	}
+
+	// Flicker of a sequence from a still camera: how much the luma of each
+	// pixel moves around its own mean. Frames must keep the first one's size.
+	class FlickerMeter
+	{
+		int width_;
+		int height_;
+		unsigned frames_;
+		std::vector<double> mean_;	// per pixel, Welford
+		std::vector<double> m2_;
+		std::vector<float>  last_;
+		double delta_sum_;	// |luma - last frame's|, summed over pixels and frames
+
+	public:
+		FlickerMeter();
+
+		void reset();
+		bool add(const Image &frame); // false: the size differs, the frame is left out
+
+		unsigned frames() const { return frames_; }
+		double variance() const;	// mean over the pixels of the temporal luma variance
+		double stddev() const;		// mean over the pixels of its square root
+		double meanDelta() const;	// mean |luma change| between consecutive frames
+	};
+
+	// Ghosting of a sequence with motion: the error left where the scene
+	// changed since the last frame, the trail a stale history leaves behind
+	// a moving edge. The change mask comes from the reference, so the output
+	// is compared where an edge was or is, on every frame after the first.
+	// Aliasing adds to rms() as well; lag() keeps only the error toward the
+	// last frame's reference.
+	class GhostMeter
+	{
+		float  threshold_;	// luma change of the reference that marks a pixel
+		Image  last_;		// reference of the last frame
+		unsigned frames_;
+		double sum_;		// squared luma error over the marked pixels
+		double lag_;		// error along the change, clamped to [0, change^2]
+		double change_;		// squared luma change
+		double marked_;
+		double pixels_;
+
+	public:
+		explicit GhostMeter(float threshold = 0.05f);
+
+		void reset();
+		bool add(const Image &output, const Image &reference); // false: sizes differ
+
+		unsigned frames() const { return frames_; }
+		double rms() const;			// luma error over the marked pixels
+		double coverage() const;	// part of the pixels marked
+		double lag() const;			// 0: follows the reference, 1: shows the last frame
+	};
+
+}// namespace tpot
+#endif // TPOT_TEMPORAL_METRICS_H__
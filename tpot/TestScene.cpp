@@ -0,0 +1,209 @@
+#include <math.h>
+#include "TestScene.h"
+#include "ThreadPool.h"
+
+namespace tpot
+{
+
+namespace
+{
+	struct V3
+	{
+		float x, y, z;
+	};
+	inline V3 v3(float x, float y, float z){ V3 v = { x, y, z }; return v; }
+	inline V3 operator+(const V3 &a, const V3 &b){ return v3(a.x + b.x, a.y + b.y, a.z + b.z); }
+	inline V3 operator-(const V3 &a, const V3 &b){ return v3(a.x - b.x, a.y - b.y, a.z - b.z); }
+	inline V3 operator*(const V3 &a, float s){ return v3(a.x * s, a.y * s, a.z * s); }
+	inline float dot(const V3 &a, const V3 &b){ return a.x * b.x + a.y * b.y + a.z * b.z; }
+	inline V3 cross(const V3 &a, const V3 &b){ return v3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x); }
+	inline V3 normalize(const V3 &a){ return a * (1.0f / sqrtf(dot(a, a))); }
+
+	const float PI = 3.14159265f;
+	const float COLUMN_RADIUS = 0.5f;
+	const float COLUMN_HEIGHT = 4.0f;
+	const float COLUMN_SPACING = 4.0f;
+	const int   COLUMN_STRIPES = 16;
+	const float GRID_LINE = 0.04f;
+
+	const V3 LIGHT_DIR = { -0.37f, 0.80f, -0.47f };
+	const V3 BACKGROUND = { 0.03f, 0.03f, 0.03f };
+
+	float lambert(const V3 &n)
+	{
+		float d = dot(n, normalize(LIGHT_DIR));
+		return 0.2f + 0.8f * (0.0f < d ? d : 0.0f);
+	}
+
+	V3 floorAlbedo(float x, float z)
+	{
+		float fx = x - floorf(x), fz = z - floorf(z);
+		if (fx < GRID_LINE || fz < GRID_LINE) return v3(0.9f, 0.9f, 0.85f);
+		bool odd = (((int)floorf(x) + (int)floorf(z)) & 1) != 0;
+		return odd ? v3(0.45f, 0.32f, 0.22f) : v3(0.25f, 0.18f, 0.12f);
+	}
+
+	V3 columnAlbedo(float angle, float y)
+	{
+		int stripe = (int)floorf((angle + PI) * (COLUMN_STRIPES / (2.0f * PI)));
+		float band = y - floorf(y);
+		if (band < 0.05f) return v3(0.1f, 0.1f, 0.1f);
+		return (stripe & 1) ? v3(0.8f, 0.75f, 0.7f) : v3(0.6f, 0.2f, 0.15f);
+	}
+}// namespace
+
+TEST_CAMERA TestScene::camera(float time)
+{
+	// vecEye( 3.0f, 4.5f, -10.5f ), vecAt( 0, 0, 0 ), D3DX_PI / 4, 0.1f, 100.0f
+	const float radius = sqrtf(3.0f * 3.0f + 10.5f * 10.5f);
+	const float angle0 = atan2f(-10.5f, 3.0f);
+	float a = angle0 + 0.25f * time;
+
+	TEST_CAMERA cam;
+	cam.eye[0] = radius * cosf(a);
+	cam.eye[1] = 4.5f;
+	cam.eye[2] = radius * sinf(a);
+	cam.at[0] = cam.at[1] = cam.at[2] = 0.0f;
+	cam.fovy = PI / 4.0f;
+	cam.znear = 0.1f;
+	cam.zfar = 100.0f;
+	return cam;
+}
+
+MATRIX TestScene::viewProjection(const TEST_CAMERA &cam, float aspect)
+{
+	const float up[3] = { 0.0f, 1.0f, 0.0f };
+	return MatrixMultiply(MatrixLookAtLH(cam.eye, cam.at, up), MatrixPerspectiveFovLH(cam.fovy, aspect, cam.znear, cam.zfar));
+}
+
+void TestScene::shade(const TEST_CAMERA &cam, int width, int height, float px, float py, float rgb[3], float *z)
+{
+	V3 eye = v3(cam.eye[0], cam.eye[1], cam.eye[2]);
+	V3 fwd = normalize(v3(cam.at[0], cam.at[1], cam.at[2]) - eye);
+	V3 right = normalize(cross(v3(0, 1, 0), fwd));// left handed, as D3DXMatrixLookAtLH
+	V3 up = cross(fwd, right);
+
+	float t = tanf(0.5f * cam.fovy);
+	float nx = (px / (float)width * 2.0f - 1.0f) * t * ((float)width / (float)height);
+	float ny = (1.0f - py / (float)height * 2.0f) * t;
+	V3 dir = normalize(fwd + right * nx + up * ny);
+
+	float best = cam.zfar * 2.0f;
+	V3 color = BACKGROUND;
+
+	// floor
+	if (dir.y < 0.0f){
+		float tf = -eye.y / dir.y;
+		if (tf < best){
+			V3 p = eye + dir * tf;
+			best = tf;
+			color = floorAlbedo(p.x, p.z) * lambert(v3(0, 1, 0));
+		}
+	}
+
+	// columns
+	for (int i = -1; i <= 1; i++){
+		for (int j = -1; j <= 1; j++){
+			float cx = i * COLUMN_SPACING, cz = j * COLUMN_SPACING;
+			float ox = eye.x - cx, oz = eye.z - cz;
+			float a = dir.x * dir.x + dir.z * dir.z;
+			float b = ox * dir.x + oz * dir.z;
+			float c = ox * ox + oz * oz - COLUMN_RADIUS * COLUMN_RADIUS;
+			float disc = b * b - a * c;
+			if (a <= 0.0f || disc < 0.0f) continue;
+
+			float tc = (-b - sqrtf(disc)) / a;
+			if (0.0f < tc && tc < best){
+				V3 p = eye + dir * tc;
+				if (0.0f <= p.y && p.y <= COLUMN_HEIGHT){
+					V3 n = normalize(v3(p.x - cx, 0.0f, p.z - cz));
+					best = tc;
+					color = columnAlbedo(atan2f(n.z, n.x), p.y) * lambert(n);
+					continue;
+				}
+			}
+			// top cap
+			if (dir.y < 0.0f && COLUMN_HEIGHT < eye.y){
+				float tt = (COLUMN_HEIGHT - eye.y) / dir.y;
+				V3 p = eye + dir * tt;
+				float dx = p.x - cx, dz = p.z - cz;
+				if (tt < best && dx * dx + dz * dz <= COLUMN_RADIUS * COLUMN_RADIUS){
+					best = tt;
+					color = v3(0.7f, 0.7f, 0.7f) * lambert(v3(0, 1, 0));
+				}
+			}
+		}
+	}
+
+	rgb[0] = color.x;
+	rgb[1] = color.y;
+	rgb[2] = color.z;
+	if (z){
+		*z = (best < cam.zfar * 2.0f) ? dot(dir * best, fwd) : cam.zfar;
+	}
+}
+
+void TestScene::render(Image &color, Image *depth, int width, int height, const TEST_CAMERA &cam,
+	float jitter_x, float jitter_y, ThreadPool *pool)
+{
+	color.resize(width, height);
+	if (depth) depth->resize(width, height);
+
+	const float q = cam.zfar / (cam.zfar - cam.znear);
+
+	auto row = [&](unsigned y){
+		for (int x = 0; x < width; x++){
+			float z;
+			float *p = color.at(x, y);
+			shade(cam, width, height, x + 0.5f + jitter_x, y + 0.5f + jitter_y, p, &z);
+			p[3] = 1.0f;
+			if (depth){
+				float *d = depth->at(x, y);
+				d[0] = q - q * cam.znear / z;
+				d[1] = z;
+				d[2] = 0.0f;
+				d[3] = 1.0f;
+			}
+		}
+	};
+
+	if (pool){
+		pool->parallelFor(height, row);
+	}else{
+		for (int y = 0; y < height; y++) row(y);
+	}
+}
+
+void TestScene::renderReference(Image &color, int width, int height, const TEST_CAMERA &cam,
+	int samples_per_axis, ThreadPool *pool)
+{
+	color.resize(width, height);
+	float inv = 1.0f / (float)samples_per_axis;
+	float weight = inv * inv;
+
+	auto row = [&](unsigned y){
+		for (int x = 0; x < width; x++){
+			float sum[3] = { 0, 0, 0 };
+			for (int sy = 0; sy < samples_per_axis; sy++){
+				for (int sx = 0; sx < samples_per_axis; sx++){
+					float rgb[3];
+					shade(cam, width, height, x + (sx + 0.5f) * inv, y + (sy + 0.5f) * inv, rgb, nullptr);
+					sum[0] += rgb[0]; sum[1] += rgb[1]; sum[2] += rgb[2];
+				}
+			}
+			float *p = color.at(x, y);
+			p[0] = sum[0] * weight;
+			p[1] = sum[1] * weight;
+			p[2] = sum[2] * weight;
+			p[3] = 1.0f;
+		}
+	};
+
+	if (pool){
+		pool->parallelFor(height, row);
+	}else{
+		for (int y = 0; y < height; y++) row(y);
+	}
+}
+
+}// namespace tpot
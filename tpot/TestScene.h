@@ -0,0 +1,44 @@
+#ifndef TPOT_TEST_SCENE_H__
+#define TPOT_TEST_SCENE_H__
+
+#include "image.h"
+#include "Matrix.h"
+
+namespace tpot
+{
+	class ThreadPool;
+
+	// Same view set up as g_Camera in sample.cpp
+	struct TEST_CAMERA
+	{
+		float eye[3];
+		float at[3];
+		float fovy;
+		float znear;
+		float zfar;
+	};
+
+	// Analytic stand-in for Media/ColumnScene: a lit floor with a thin grid and
+	// a 3x3 array of striped columns, ray cast per sample. Lets the CPU
+	// reference pipeline render jittered frames and supersampled references headless.
+	class TestScene
+	{
+	public:
+		static TEST_CAMERA camera(float time = 0.0f); // orbit around the scene, time 0 is the sample's start view
+		static MATRIX viewProjection(const TEST_CAMERA &cam, float aspect); // unjittered, as mView * mProj
+
+		// jitter is the sample position inside each pixel in pixels, (0,0) is the centre.
+		// depth, when not null, receives the depth buffer value (z/w) in red and view space z in green.
+		static void render(Image &color, Image *depth, int width, int height, const TEST_CAMERA &cam,
+			float jitter_x, float jitter_y, ThreadPool *pool = nullptr);
+
+		// Box filtered reference with samples_per_axis^2 stratified samples per pixel
+		static void renderReference(Image &color, int width, int height, const TEST_CAMERA &cam,
+			int samples_per_axis, ThreadPool *pool = nullptr);
+
+		// Colour and view z of a single ray through (px, py) in pixel units
+		static void shade(const TEST_CAMERA &cam, int width, int height, float px, float py, float rgb[3], float *z);
+	};
+
+}// namespace tpot
+#endif // TPOT_TEST_SCENE_H__
@@ -0,0 +1,105 @@
+#include <atomic>
+#include <memory>
+#include "ThreadPool.h"
+
+namespace tpot
+{
+
+ThreadPool::ThreadPool(unsigned thread_count)
+{
+	if (thread_count == 0){
+		thread_count = std::thread::hardware_concurrency();
+		if (thread_count == 0) thread_count = 1;
+	}
+
+	for (unsigned i = 0; i < thread_count; i++){
+		workers_.emplace_back([this]{ worker(); });
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		quit_ = true;
+	}
+	cv_.notify_all();
+
+	for (auto &t : workers_){
+		t.join();
+	}
+}
+
+void ThreadPool::worker()
+{
+	for (;;){
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			cv_.wait(lock, [this]{ return quit_ || !queue_.empty(); });
+			if (queue_.empty()) return;// quit_
+			task = std::move(queue_.front());
+			queue_.pop_front();
+		}
+		task();
+	}
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		queue_.push_back(std::move(task));
+	}
+	cv_.notify_one();
+}
+
+void ThreadPool::parallelFor(unsigned count, const std::function<void(unsigned)> &fn)
+{
+	if (count == 0) return;
+	if (count == 1 || workers_.empty()){
+		for (unsigned i = 0; i < count; i++) fn(i);
+		return;
+	}
+
+	// Helpers may start after the caller has already finished every index,
+	// so the shared state outlives this call.
+	struct STATE
+	{
+		std::atomic<unsigned> next;
+		std::atomic<unsigned> done;
+		unsigned count;
+		std::function<void(unsigned)> fn;
+		std::mutex mutex;
+		std::condition_variable cv;
+	};
+	std::shared_ptr<STATE> s = std::make_shared<STATE>();
+	s->next = 0;
+	s->done = 0;
+	s->count = count;
+	s->fn = fn;
+
+	auto run = [](STATE &st){
+		for (;;){
+			unsigned i = st.next.fetch_add(1);
+			if (st.count <= i) return;
+			st.fn(i);
+			if (st.done.fetch_add(1) + 1 == st.count){
+				std::lock_guard<std::mutex> lock(st.mutex);
+				st.cv.notify_all();
+			}
+		}
+	};
+
+	unsigned helpers = (count - 1 < size()) ? count - 1 : size();
+	for (unsigned i = 0; i < helpers; i++){
+		submit([s, run]{ run(*s); });
+	}
+
+	run(*s);
+
+	std::unique_lock<std::mutex> lock(s->mutex);
+	s->cv.wait(lock, [&]{ return s->done.load() == s->count; });
+}
+
+}// namespace tpot
@@ -0,0 +1,38 @@
+#ifndef TPOT_THREAD_POOL_H__
+#define TPOT_THREAD_POOL_H__
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace tpot
+{
+
+	// Portable worker pool used by the CPU reference kernels
+	class ThreadPool
+	{
+		std::vector<std::thread> workers_;
+		std::deque<std::function<void()> > queue_;
+		std::mutex mutex_;
+		std::condition_variable cv_;
+		bool quit_ = false;
+
+		void worker();
+	public:
+		explicit ThreadPool(unsigned thread_count = 0); // 0: hardware concurrency
+		~ThreadPool();
+
+		unsigned size() const { return (unsigned)workers_.size(); }
+
+		void submit(std::function<void()> task);
+
+		// Runs fn(0..count-1) and returns when every index is done.
+		// The calling thread takes part, so it is safe to call from a worker.
+		void parallelFor(unsigned count, const std::function<void(unsigned)> &fn);
+	};
+
+}// namespace tpot
+#endif // TPOT_THREAD_POOL_H__
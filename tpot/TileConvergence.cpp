@@ -0,0 +1,99 @@
+#include <math.h>
+#include "TileConvergence.h"
+#include "ThreadPool.h"
+
+namespace tpot
+{
+
+TileConvergence::TileConvergence(float threshold, unsigned frames)
+	: width_(0), height_(0), tiles_x_(0), tiles_y_(0), threshold_(threshold), frames_(frames)
+{
+}
+
+void TileConvergence::reset(int width, int height)
+{
+	width_ = width;
+	height_ = height;
+	tiles_x_ = tiles(width);
+	tiles_y_ = tiles(height);
+	change_.assign((size_t)tiles_x_ * tiles_y_, 0.0f);
+	stable_.assign((size_t)tiles_x_ * tiles_y_, 0);
+}
+
+PIXEL_RECT TileConvergence::rect(int tx, int ty) const
+{
+	PIXEL_RECT r;
+	r.x0 = tx * TAA_TILE_SIZE;
+	r.y0 = ty * TAA_TILE_SIZE;
+	r.x1 = (tx == tiles_x_ - 1) ? width_ : r.x0 + TAA_TILE_SIZE;
+	r.y1 = (ty == tiles_y_ - 1) ? height_ : r.y0 + TAA_TILE_SIZE;
+	return r;
+}
+
+// Mirrors taa.hlsl PS_TileMask
+void TileConvergence::update(const Image &history, const Image &prev, ThreadPool *pool)
+{
+	if (history.width != width_ || history.height != height_ || prev.width != width_ || prev.height != height_) return;
+
+	auto tile_row = [&](unsigned ty){
+		for (int tx = 0; tx < tiles_x_; tx++){
+			size_t t = (size_t)ty * tiles_x_ + tx;
+			if (frames_ <= stable_[t]) continue;
+
+			PIXEL_RECT r = rect(tx, (int)ty);
+			float change = 0.0f;
+			for (int y = r.y0; y < r.y1; y++){
+				const float *a = history.at(r.x0, y);
+				const float *b = prev.at(r.x0, y);
+				for (int i = 0; i < (r.x1 - r.x0) * 4; i += 4){
+					for (int c = 0; c < 3; c++){
+						float d = fabsf(a[i + c] - b[i + c]);
+						change = (change < d) ? d : change;
+					}
+				}
+			}
+			change_[t] = change;
+			stable_[t] = (change < threshold_) ? stable_[t] + 1 : 0;
+		}
+	};
+
+	if (pool){
+		pool->parallelFor(tiles_y_, tile_row);
+	}else{
+		for (int ty = 0; ty < tiles_y_; ty++) tile_row(ty);
+	}
+}
+
+void TileConvergence::schedule(std::vector<PIXEL_RECT> &rects) const
+{
+	rects.clear();
+	for (int ty = 0; ty < tiles_y_; ty++){
+		for (int tx = 0; tx < tiles_x_; ){
+			if (converged(tx, ty)){
+				tx++;
+				continue;
+			}
+			PIXEL_RECT r = rect(tx, ty);
+			while (++tx < tiles_x_ && !converged(tx, ty)){
+				r.x1 = rect(tx, ty).x1;
+			}
+			rects.push_back(r);
+		}
+	}
+}
+
+unsigned TileConvergence::convergedTiles() const
+{
+	unsigned n = 0;
+	for (unsigned s : stable_) n += (frames_ <= s) ? 1 : 0;
+	return n;
+}
+
+unsigned long long TileConvergence::pixels(const std::vector<PIXEL_RECT> &rects)
+{
+	unsigned long long n = 0;
+	for (auto &r : rects) n += (unsigned long long)(r.x1 - r.x0) * (r.y1 - r.y0);
+	return n;
+}
+
+}// namespace tpot
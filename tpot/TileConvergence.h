@@ -0,0 +1,55 @@
+#ifndef TPOT_TILE_CONVERGENCE_H__
+#define TPOT_TILE_CONVERGENCE_H__
+
+#include <vector>
+#include "TaaResolve.h"
+
+namespace tpot
+{
+	class ThreadPool;
+
+	const int      TAA_TILE_SIZE = 16;				// pixels, TILE_SIZE in taa.hlsl
+	const float    TAA_TILE_THRESHOLD = 1.0f / 256.0f;	// largest change per frame of a converged tile
+	const unsigned TAA_TILE_FRAMES = 4;				// frames below the threshold before a tile is skipped
+
+	// Per tile convergence of the TAA history, CPU twin of taa.hlsl PS_TileMask.
+	// The grid is the size of rt_tile, the history size / TAA_TILE_SIZE rounded,
+	// so the last row and column of tiles take the remainder of the image.
+	// Converged tiles are not resolved and not compared again until reset().
+	class TileConvergence
+	{
+		int      width_;
+		int      height_;
+		int      tiles_x_;
+		int      tiles_y_;
+		float    threshold_;
+		unsigned frames_;
+		std::vector<float>    change_;	// largest RGB change of the last compare
+		std::vector<unsigned> stable_;	// frames below threshold_
+
+	public:
+		TileConvergence(float threshold = TAA_TILE_THRESHOLD, unsigned frames = TAA_TILE_FRAMES);
+
+		static int tiles(int size){ int n = (size + TAA_TILE_SIZE / 2) / TAA_TILE_SIZE; return (n < 1) ? 1 : n; }
+
+		// New history size, or the view / jitter changed: everything is resolved again
+		void reset(int width, int height);
+
+		// After a resolve of schedule(): history is the new one, prev the one it read
+		void update(const Image &history, const Image &prev, ThreadPool *pool = nullptr);
+
+		// Tiles to resolve, the runs of a tile row merged into one rectangle
+		void schedule(std::vector<PIXEL_RECT> &rects) const;
+
+		int tilesX() const { return tiles_x_; }
+		int tilesY() const { return tiles_y_; }
+		bool converged(int tx, int ty) const { return frames_ <= stable_[ty * tiles_x_ + tx]; }
+		float change(int tx, int ty) const { return change_[ty * tiles_x_ + tx]; }
+		unsigned convergedTiles() const;
+		PIXEL_RECT rect(int tx, int ty) const;
+
+		static unsigned long long pixels(const std::vector<PIXEL_RECT> &rects);
+	};
+
+}// namespace tpot
+#endif // TPOT_TILE_CONVERGENCE_H__
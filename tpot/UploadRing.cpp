@@ -0,0 +1,76 @@
+#include <string.h>
+#include "UploadRing.h"
+
+namespace tpot
+{
+
+UploadRing::UploadRing(unsigned size)
+{
+	reset(size);
+}
+
+void UploadRing::reset(unsigned size)
+{
+	size_ = size & ~(unsigned)(ALIGNMENT - 1);
+	head_ = 0;
+	used_ = 0;
+	frame_bytes_ = 0;
+	frames_.clear();
+	memset(&stats_, 0, sizeof(stats_));
+}
+
+unsigned UploadRing::allocate(unsigned size)
+{
+	unsigned bytes = align(size ? size : 1);
+
+	// The free space runs from head_ for size_ - used_ bytes, possibly
+	// across the end. An allocation never straddles it: the tail is padded.
+	unsigned pad = (size_ < head_ + bytes) ? size_ - head_ : 0;
+	if (size_ < bytes || size_ - used_ < pad + bytes){
+		stats_.failures++;
+		return ~0u;
+	}
+
+	if (pad) head_ = 0;
+	unsigned offset = head_;
+	head_ += bytes;
+	if (head_ == size_) head_ = 0;
+
+	used_ += pad + bytes;
+	frame_bytes_ += pad + bytes;
+	stats_.allocations++;
+	stats_.bytes += pad + bytes;
+	return offset;
+}
+
+void UploadRing::endFrame(FENCE fence)
+{
+	if (!frame_bytes_) return;
+
+	FRAME frame = { fence, frame_bytes_ };
+	frames_.push_back(frame);
+	frame_bytes_ = 0;
+}
+
+void UploadRing::retire(FENCE completed)
+{
+	while (!frames_.empty() && frames_.front().fence <= completed){
+		used_ -= frames_.front().bytes;
+		frames_.pop_front();
+	}
+	if (used_ == 0) head_ = 0; // idle: start over, no padding on the next wrap
+}
+
+UploadRing::FENCE UploadRing::oldestFence() const
+{
+	return frames_.empty() ? 0 : frames_.front().fence;
+}
+
+UploadRing::STATS UploadRing::takeStats()
+{
+	STATS s = stats_;
+	memset(&stats_, 0, sizeof(stats_));
+	return s;
+}
+
+}// namespace tpot
@@ -0,0 +1,68 @@
+#ifndef TPOT_UPLOAD_RING_H__
+#define TPOT_UPLOAD_RING_H__
+
+#include <deque>
+
+namespace tpot
+{
+
+	// Sub-allocator for a per-frame upload buffer (constant data).
+	// Allocations are ALIGNMENT bytes aligned offsets into one buffer of
+	// size() bytes and live until the GPU has passed the fence of the
+	// frame they were made in. Nothing is ever overwritten early: allocate()
+	// fails instead, and the caller waits for oldestFence() and retires.
+	class UploadRing
+	{
+	public:
+		enum{
+			ALIGNMENT = 256,	// D3D11.1 constant buffer offsets are in 16 constant steps
+		};
+		typedef unsigned long long FENCE;
+
+		struct STATS
+		{
+			unsigned allocations;
+			unsigned bytes;		// aligned, wrap padding included
+			unsigned failures;
+		};
+
+	private:
+		struct FRAME
+		{
+			FENCE    fence;
+			unsigned bytes;
+		};
+
+		unsigned size_;
+		unsigned head_;		// next free byte
+		unsigned used_;		// bytes in flight, this frame included
+		unsigned frame_bytes_;	// allocated since the last endFrame()
+		std::deque<FRAME> frames_;	// oldest first
+		STATS stats_;
+
+	public:
+		explicit UploadRing(unsigned size = 0);
+
+		void reset(unsigned size); // forgets every allocation
+		unsigned size() const { return size_; }
+		unsigned used() const { return used_; }
+
+		// Offset of size bytes, or ~0 when the free space is in use by the GPU
+		unsigned allocate(unsigned size);
+
+		// Closes the current frame; its allocations are freed by retire(fence)
+		void endFrame(FENCE fence);
+		// Frees every frame whose fence is <= completed
+		void retire(FENCE completed);
+
+		unsigned framesInFlight() const { return (unsigned)frames_.size(); }
+		FENCE oldestFence() const; // of the frames in flight, 0 if none
+
+		// Since the last call
+		STATS takeStats();
+
+		static unsigned align(unsigned size){ return (size + ALIGNMENT - 1) & ~(unsigned)(ALIGNMENT - 1); }
+	};
+
+}// namespace tpot
+#endif // TPOT_UPLOAD_RING_H__
@@ -0,0 +1,81 @@
+#ifndef TPOT_DEVICE_H__
+#define TPOT_DEVICE_H__
+
+#include "types.h"
+
+namespace tpot
+{
+
+	// The graphics API behind Renderer. D3D11Device drives the immediate
+	// context; RecordingDevice only records the calls, so frames can be
+	// built and timed without Windows or a GPU.
+	//
+	// Ids returned by createRenderTarget() and createMesh() count up from 0.
+	// ~0 as a render target id unbinds the depth buffer, as a texture clears the slot.
+	class Device
+	{
+	public:
+		virtual ~Device(){}
+
+		// Frame boundary: constant data of older frames is recycled once the GPU is past
+		// them, render targets may move to a surface of their settled size
+		virtual void beginFrame() = 0;
+		// After the last command of the frame, closes its GPU timing
+		virtual void endFrame() = 0;
+		// GPU time of the latest frame whose timing came back, a few frames
+		// late; false while there is none or the backend cannot time
+		virtual bool getGpuTime(float *ms) = 0;
+
+		virtual void ResizedSwapChain(UINT width, UINT height) = 0;
+		virtual void ReleasingSwapChain() = 0;
+
+		virtual UINT createRenderTarget(RENDER_TARGET::TYPE type, UINT width, UINT height, float scale, RENDER_TARGET::FORMAT format) = 0;
+		virtual void setScale(UINT id, float scale) = 0;
+		virtual void setFormat(UINT id, RENDER_TARGET::FORMAT format) = 0;
+		virtual void getSize(UINT id, UINT *width, UINT *height) = 0; // the viewport of setRenderTarget()
+		virtual void getTextureSize(UINT id, UINT *width, UINT *height) = 0; // allocated, getSize() is its top left
+		virtual unsigned long long getBytes(UINT id) = 0; // of its texture
+		virtual UINT getGeneration(UINT id) = 0; // changes with the texture, whose contents are then undefined
+		virtual unsigned long long getTotalBytes() = 0; // every render target texture, pooled ones included
+		virtual void setRenderTarget(UINT id) = 0; // HDR_SCREEN as colour, DEPTH as depth buffer
+		virtual void pushRenderTarget() = 0;
+		virtual void popRenderTarget() = 0;
+		// Between push and pop: the pushed colour target and its viewport, no depth,
+		// with HDR_SCREEN id as the pixel shader UAV u1 (~0 none). setRenderTarget() drops the UAV.
+		virtual void setPresentTarget(UINT id) = 0;
+
+		virtual void Clear(UINT color) = 0; // AARRGGBB
+		virtual void ClearDepth(float depth) = 0;
+
+		// A mesh may load in the background: Draw() of it does nothing until
+		// isMeshReady(); beginFrame() moves the loads along
+		virtual UINT createMesh(MESH_TYPE type, void *param) = 0;
+		virtual bool isMeshReady(UINT mesh) = 0;
+		virtual void setTexture(UINT slot, UINT id) = 0; // render target as PS resource
+		virtual void setInputLayout(VS::ID id) = 0;
+		virtual void Draw(UINT mesh) = 0;
+
+		virtual void set(RASTERIZER_STATE::ID id) = 0;
+		virtual void set(UINT slot, SAMPLER_STATE::ID id) = 0;
+		virtual void set(DEPTH_STATE::ID id) = 0;
+		virtual void set(VS::ID id) = 0;
+		virtual void set(HS::ID id) = 0;
+		virtual void set(DS::ID id) = 0;
+		virtual void set(GS::ID id) = 0;
+		virtual void set(PS::ID id) = 0;
+		virtual void set(CS::ID id) = 0;
+		virtual void disable(STAGE::ID stage) = 0;
+
+		// Runs the CS with the textures of setTexture() and HDR_SCREEN id as UAV u0.
+		// No render target may be one of them; both are unbound from the CS after.
+		virtual void Dispatch(UINT id, UINT groups_x, UINT groups_y) = 0;
+
+		// Constant data of the current VS. Every Map() hands out a fresh
+		// allocation; setCB() binds the latest one, before or after UmMap().
+		virtual void setCB(STAGE::ID stage) = 0;
+		virtual void *Map() = 0;
+		virtual void UmMap() = 0;
+	};
+
+}// namespace tpot
+#endif // TPOT_DEVICE_H__
@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "image.h"
+
+namespace tpot
+{
+
+static bool isLittleEndian()
+{
+	const unsigned int one = 1;
+	return *(const unsigned char*)&one == 1;
+}
+
+static void swapBytes(float *p, size_t count)
+{
+	for (size_t i = 0; i < count; i++){
+		unsigned char *b = (unsigned char*)&p[i];
+		unsigned char t;
+		t = b[0]; b[0] = b[3]; b[3] = t;
+		t = b[1]; b[1] = b[2]; b[2] = t;
+	}
+}
+
+void SampleLinear(const Image &img, float u, float v, float rgba[4])
+{
+	float tx = u * (float)img.width - 0.5f;
+	float ty = v * (float)img.height - 0.5f;
+	float fx = floorf(tx), fy = floorf(ty);
+	float wx = tx - fx, wy = ty - fy;
+
+	int x0 = (int)fx % img.width, y0 = (int)fy % img.height;
+	if (x0 < 0) x0 += img.width;
+	if (y0 < 0) y0 += img.height;
+	int x1 = (x0 + 1 == img.width) ? 0 : x0 + 1;
+	int y1 = (y0 + 1 == img.height) ? 0 : y0 + 1;
+
+	const float *p00 = img.at(x0, y0), *p10 = img.at(x1, y0);
+	const float *p01 = img.at(x0, y1), *p11 = img.at(x1, y1);
+	for (int c = 0; c < 4; c++){
+		float top = p00[c] + (p10[c] - p00[c]) * wx;
+		float bottom = p01[c] + (p11[c] - p01[c]) * wx;
+		rgba[c] = top + (bottom - top) * wy;
+	}
+}
+
+bool LoadPFM(const char *path, Image *img)
+{
+	FILE *fp = fopen(path, "rb");
+	if (!fp) return false;
+
+	char magic[3] = {};
+	int w = 0, h = 0;
+	float scale = 0.0f;
+	if (fscanf(fp, "%2s %d %d %f", magic, &w, &h, &scale) != 4 || fgetc(fp) == EOF ||
+		w <= 0 || h <= 0 || (strcmp(magic, "PF") != 0 && strcmp(magic, "Pf") != 0)){
+		fclose(fp);
+		return false;
+	}
+	int channels = (magic[1] == 'F') ? 3 : 1;
+
+	std::vector<float> row((size_t)w * channels);
+	img->resize(w, h);
+	bool swap = (scale < 0.0f) != isLittleEndian();
+	for (int y = h - 1; 0 <= y; y--){// PFM stores rows bottom to top
+		if (fread(row.data(), sizeof(float), row.size(), fp) != row.size()){
+			fclose(fp);
+			return false;
+		}
+		if (swap) swapBytes(row.data(), row.size());
+		for (int x = 0; x < w; x++){
+			float *p = img->at(x, y);
+			const float *s = &row[(size_t)x * channels];
+			p[0] = s[0];
+			p[1] = s[channels == 3 ? 1 : 0];
+			p[2] = s[channels == 3 ? 2 : 0];
+			p[3] = 1.0f;
+		}
+	}
+
+	fclose(fp);
+	return true;
+}
+
+bool SavePFM(const char *path, const Image &img)
+{
+	FILE *fp = fopen(path, "wb");
+	if (!fp) return false;
+
+	fprintf(fp, "PF\n%d %d\n%s\n", img.width, img.height, isLittleEndian() ? "-1.0" : "1.0");
+
+	std::vector<float> row((size_t)img.width * 3);
+	bool ok = true;
+	for (int y = img.height - 1; 0 <= y && ok; y--){
+		for (int x = 0; x < img.width; x++){
+			const float *p = img.at(x, y);
+			row[x * 3 + 0] = p[0];
+			row[x * 3 + 1] = p[1];
+			row[x * 3 + 2] = p[2];
+		}
+		ok = fwrite(row.data(), sizeof(float), row.size(), fp) == row.size();
+	}
+
+	fclose(fp);
+	return ok;
+}
+
+}// namespace tpot
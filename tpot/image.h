@@ -0,0 +1,37 @@
+#ifndef TPOT_IMAGE_H__
+#define TPOT_IMAGE_H__
+
+#include <stddef.h>
+#include <vector>
+
+namespace tpot
+{
+
+	// CPU side RGBA32F surface, same layout as RENDER_TARGET::RGBA32F
+	struct Image
+	{
+		int width = 0;
+		int height = 0;
+		std::vector<float> pixels;
+
+		Image(){}
+		Image(int w, int h) : width(w), height(h), pixels((size_t)w * h * 4, 0.0f){}
+
+		void resize(int w, int h){ width = w; height = h; pixels.assign((size_t)w * h * 4, 0.0f); }
+		bool empty() const { return pixels.empty(); }
+
+		float *data(){ return pixels.data(); }
+		const float *data() const { return pixels.data(); }
+		float *at(int x, int y){ return &pixels[((size_t)y * width + x) * 4]; }
+		const float *at(int x, int y) const { return &pixels[((size_t)y * width + x) * 4]; }
+	};
+
+	// Bilinear fetch wrapped within the image, as SampleAccWrap in taa.hlsl
+	void SampleLinear(const Image &img, float u, float v, float rgba[4]);
+
+	// Portable float map (RGB). Alpha is 1 on load and dropped on save.
+	bool LoadPFM(const char *path, Image *img);
+	bool SavePFM(const char *path, const Image &img);
+
+}// namespace tpot
+#endif // TPOT_IMAGE_H__
@@ -1,5 +1,12 @@
 #include "DXUT.h"
 #include "SDKmisc.h"
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+#include "TMeshFile.h"
 #include "mesh.h"
 
 namespace tpot
@@ -61,7 +68,7 @@ void SDKMesh::initialize(ID3D11Device *pd3dDevice, void *param)
 	WCHAR str[256];
 
 	V(DXUTFindDXSDKMediaFileCch(str, 256, path));
-	Mesh_.Create(pd3dDevice, str, false);
+	V(Mesh_.Create(pd3dDevice, str, false));	// fails on a file SDKMeshParser rejects
 }
 
 void SDKMesh::destroy()
@@ -74,10 +81,197 @@ void SDKMesh::Draw(ID3D11DeviceContext *pd3dImmediateContext)
 	Mesh_.Render( pd3dImmediateContext, 0 );
 }
 
+namespace
+{
+	// A texture decoded by D3DX on a loader thread and made a resource on
+	// the device thread: the two halves of a D3DX11 async texture processor
+	struct TEXTURE_LOAD
+	{
+		ID3DX11DataProcessor *processor;
+		std::wstring          path;
+
+		TEXTURE_LOAD() : processor(nullptr){}
+		~TEXTURE_LOAD(){ if (processor) processor->Destroy(); }
+
+		bool load()
+		{
+			MappedFile file;
+			return processor && file.open(path.c_str()) && SUCCEEDED(processor->Process((void*)file.data(), file.size()));
+		}
+
+		// sRGB copy of the UNORM texture, as CDXUTResourceCache makes it;
+		// D3DX would convert the texels if asked for the sRGB format
+		ID3D11ShaderResourceView *create(ID3D11Device *pd3dDevice)
+		{
+			ID3D11Texture2D *pUnorm = nullptr, *pSrgb = nullptr;
+			ID3D11ShaderResourceView *pSRV = nullptr;
+			if (FAILED(processor->CreateDeviceObject((void**)&pUnorm))) return nullptr;
+
+			D3D11_TEXTURE2D_DESC desc;
+			pUnorm->GetDesc(&desc);
+			desc.Format = MAKE_SRGB(desc.Format);
+			if (SUCCEEDED(pd3dDevice->CreateTexture2D(&desc, nullptr, &pSrgb))){
+				DXUTGetD3D11DeviceContext()->CopyResource(pSrgb, pUnorm);
+				pd3dDevice->CreateShaderResourceView(pSrgb, nullptr, &pSRV);
+			}
+			SAFE_RELEASE(pSrgb);
+			SAFE_RELEASE(pUnorm);
+			return pSRV;
+		}
+	};
+}// namespace
+
+TMesh::TMesh()
+{
+}
+
+TMesh::~TMesh()
+{
+	destroy();
+}
+
+void TMesh::initialize(ID3D11Device *pd3dDevice, void *param)
+{
+	HRESULT hr;
+	WCHAR str[MAX_PATH];
+	V(DXUTFindDXSDKMediaFileCch(str, MAX_PATH, (LPCWSTR)param));
+
+	TMeshData data;
+	if (data.load(str) != TMESH_ERROR::NONE){
+		DXUT_ERR(L"TMesh: missing or rejected by TMeshReader", E_FAIL);
+		return;
+	}
+	if (!(data.reader().header().flags & TMESH_FLAG::OPTIMIZED)) data.optimize();
+	create(pd3dDevice, data, str);
+}
+
+void TMesh::load(ID3D11Device *pd3dDevice, LPCWSTR path, AsyncLoader *loader)
+{
+	HRESULT hr;
+	WCHAR str[MAX_PATH];
+	V(DXUTFindDXSDKMediaFileCch(str, MAX_PATH, path));
+
+	// the decoded file lives in the jobs, this only while the create is due
+	loader_ = loader;
+	std::wstring file = str;
+	std::shared_ptr<TMeshData> data = std::make_shared<TMeshData>();
+	jobs_.push_back(loader->submit([data, file]{
+		if (data->load(file.c_str()) != TMESH_ERROR::NONE) return false;
+		if (!(data->reader().header().flags & TMESH_FLAG::OPTIMIZED)) data->optimize();
+		return true;
+	}, [this, pd3dDevice, data, file]{
+		create(pd3dDevice, *data, file.c_str());
+		return true;
+	}));
+}
+
+void TMesh::create(ID3D11Device *pd3dDevice, const TMeshData &data, LPCWSTR path)
+{
+	HRESULT hr;
+	const TMeshReader &reader = data.reader();
+
+	buffers_.resize(reader.sections().size(), nullptr);
+	for (UINT i = 0; i < reader.sections().size(); i++){
+		const TMESH_SECTION &s = reader.sections()[i];
+		if (!data.data(i) || s.bytes == 0) continue;
+
+		D3D11_BUFFER_DESC bd;
+		ZeroMemory(&bd, sizeof(bd));
+		bd.Usage = D3D11_USAGE_IMMUTABLE;
+		bd.ByteWidth = (UINT)s.bytes;
+		bd.BindFlags = (s.type == TMESH_SECTION_TYPE::VERTEX_DATA) ? D3D11_BIND_VERTEX_BUFFER : D3D11_BIND_INDEX_BUFFER;
+		D3D11_SUBRESOURCE_DATA InitData;
+		ZeroMemory(&InitData, sizeof(InitData));
+		InitData.pSysMem = data.data(i);
+		V(pd3dDevice->CreateBuffer(&bd, &InitData, &buffers_[i]));
+	}
+
+	// textures are relative to the file, as CDXUTSDKMesh loads them
+	std::wstring dir = path;
+	dir.resize(dir.find_last_of(L'\\') + 1);
+	diffuse_.resize(reader.materials().size(), nullptr);
+	for (UINT m = 0; m < reader.materials().size(); m++){
+		const char *texture = reader.string(reader.materials()[m].diffuse_texture);
+		if (texture[0] == '\0') continue;
+
+		std::shared_ptr<TEXTURE_LOAD> t = std::make_shared<TEXTURE_LOAD>();
+		WCHAR name[MAX_PATH];
+		swprintf_s(name, MAX_PATH, L"%S", texture);
+		t->path = dir + name;
+		if (FAILED(D3DX11CreateAsyncTextureProcessor(pd3dDevice, nullptr, &t->processor))) continue;
+
+		if (!loader_){
+			if (t->load()) diffuse_[m] = t->create(pd3dDevice);
+			continue;
+		}
+		ID3D11ShaderResourceView **slot = &diffuse_[m];
+		jobs_.push_back(loader_->submit([t]{ return t->load(); }, [t, slot, pd3dDevice]{
+			*slot = t->create(pd3dDevice);
+			return *slot != nullptr;
+		}));
+	}
+
+	// the metadata is small; keep a copy and let the mapping go
+	streams_.assign(reader.streams().begin(), reader.streams().end());
+	index_buffers_.assign(reader.indexBuffers().begin(), reader.indexBuffers().end());
+	meshes_.assign(reader.meshes().begin(), reader.meshes().end());
+	subsets_.assign(reader.subsets().begin(), reader.subsets().end());
+	draws_.assign(reader.draws().begin(), reader.draws().end());
+}
+
+bool TMesh::ready() const
+{
+	if (!loader_) return true;
+	if (jobs_.empty() || loader_->state(jobs_[0]) != LOAD_STATE::READY) return false;
+	for (AsyncLoader::JOB job : jobs_){
+		if (!loader_->isFinished(job)) return false;	// a texture that failed does not hold the mesh back
+	}
+	return true;
+}
+
+void TMesh::destroy()
+{
+	// pending creates write into this
+	if (loader_){
+		for (AsyncLoader::JOB job : jobs_) loader_->cancel(job);
+	}
+	jobs_.clear();
+	for (auto &x : buffers_) SAFE_RELEASE(x);
+	for (auto &x : diffuse_) SAFE_RELEASE(x);
+	buffers_.clear();
+	diffuse_.clear();
+	draws_.clear();
+}
+
+void TMesh::Draw(ID3D11DeviceContext *pd3dImmediateContext)
+{
+	if (!ready()) return;
+
+	for (UINT m : draws_){
+		const TMESH_MESH &mesh = meshes_[m];
+		ID3D11Buffer *vb[TMESH_MAX_STREAMS];
+		UINT strides[TMESH_MAX_STREAMS];
+		UINT offsets[TMESH_MAX_STREAMS] = {};
+		for (UINT i = 0; i < mesh.stream_count; i++){
+			const TMESH_STREAM &stream = streams_[mesh.streams[i]];
+			vb[i] = buffers_[stream.section];
+			strides[i] = stream.stride;
+		}
+		const TMESH_INDEX_BUFFER &ib = index_buffers_[mesh.index_buffer];
+		pd3dImmediateContext->IASetVertexBuffers(0, mesh.stream_count, vb, strides, offsets);
+		pd3dImmediateContext->IASetIndexBuffer(buffers_[ib.section], (DXGI_FORMAT)ib.format, 0);
+
+		for (UINT k = 0; k < mesh.subset_count; k++){
+			const TMESH_SUBSET &subset = subsets_[mesh.first_subset + k];
+			pd3dImmediateContext->IASetPrimitiveTopology((D3D11_PRIMITIVE_TOPOLOGY)subset.topology);
+			if (diffuse_[subset.material]) pd3dImmediateContext->PSSetShaderResources(0, 1, &diffuse_[subset.material]);
+			pd3dImmediateContext->DrawIndexed(subset.index_count, subset.index_start, subset.base_vertex);
+		}
+	}
+}
+
 TriangleListMesh::TriangleListMesh()
 {
-	p_SRV_[0] = nullptr;
-	p_SRV_[1] = nullptr;
 }
 
 TriangleListMesh::~TriangleListMesh()
@@ -96,6 +290,17 @@ void TriangleListMesh::initialize(ID3D11Device *pd3dDevice, void *param)
 
 	HRESULT hr;
 
+	// vertex cache then fetch order; the layout follows the VS, so no overdraw pass
+	std::vector<unsigned> indices(p->indicies, p->indicies + p->index_count), ordered(indices), remap(p->vertex_count);
+	std::vector<WORD> index_data(p->indicies, p->indicies + p->index_count);
+	std::vector<BYTE> vertex_data((BYTE*)p->verticies, (BYTE*)p->verticies + stride_ * p->vertex_count);
+	if (std::all_of(indices.begin(), indices.end(), [p](unsigned i){ return i < p->vertex_count; })){
+		OptimizeMeshOrder(ordered.data(), indices.data(), indices.size(), nullptr, p->vertex_count, 0);
+		OptimizeVertexFetchRemap(remap.data(), ordered.data(), ordered.size(), p->vertex_count);
+		for (size_t i = 0; i < ordered.size(); i++) index_data[i] = (WORD)remap[ordered[i]];
+		RemapVertices(vertex_data.data(), p->verticies, p->vertex_count, stride_, remap.data());
+	}
+
 	D3D11_BUFFER_DESC bd;
 	ZeroMemory(&bd, sizeof(bd));
 	bd.Usage = D3D11_USAGE_DEFAULT;
@@ -104,14 +309,14 @@ void TriangleListMesh::initialize(ID3D11Device *pd3dDevice, void *param)
 	bd.CPUAccessFlags = 0;
 	D3D11_SUBRESOURCE_DATA InitData;
 	ZeroMemory(&InitData, sizeof(InitData));
-	InitData.pSysMem = p->verticies;
+	InitData.pSysMem = vertex_data.data();
 	V(pd3dDevice->CreateBuffer(&bd, &InitData, &pVertexBuffer_));
 
 	bd.Usage = D3D11_USAGE_DEFAULT;
 	bd.ByteWidth = sizeof(WORD) * p->index_count;
 	bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
 	bd.CPUAccessFlags = 0;
-	InitData.pSysMem = p->indicies;
+	InitData.pSysMem = index_data.data();
 	V(pd3dDevice->CreateBuffer(&bd, &InitData, &pIndexBuffer_));
 }
 
@@ -119,44 +324,28 @@ void TriangleListMesh::destroy()
 {
 	SAFE_RELEASE(pVertexBuffer_);
 	SAFE_RELEASE(pIndexBuffer_);
-
-	for (UINT i = 0; i < nSRV_; i++){
-		p_SRV_[i] = nullptr;
-	}
-	nSRV_ = 0;
-}
-
-void TriangleListMesh::texture(ID3D11ShaderResourceView *pSRV, UINT slot)
-{
-	p_SRV_[slot] = pSRV;
-	if (nSRV_ < slot + 1){
-		nSRV_ = slot + 1;
-	}
 }
 
 void TriangleListMesh::Draw(ID3D11DeviceContext *pd3dImmediateContext)
 {
 	// Set vertex buffer
 	UINT offset = 0;
-	pd3dImmediateContext->PSSetShaderResources(0, nSRV_, p_SRV_);
 	pd3dImmediateContext->IASetVertexBuffers(0, 1, &pVertexBuffer_, &stride_, &offset);
 	pd3dImmediateContext->IASetIndexBuffer(pIndexBuffer_, DXGI_FORMAT_R16_UINT, 0);
 	pd3dImmediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 	pd3dImmediateContext->DrawIndexed(nIndicies_, 0, 0);
-
-	// OȂ܂܂ƎɃ_[^[Qbgɂɕ̂ŁAnullɃZbg(_[̍ŌɂׂH)
-	static ID3D11ShaderResourceView *nulls[TEXTURE_MAX];
-	for (UINT i = 0; i < nSRV_; i++){
-		nulls[i] = nullptr;
-	}
-	pd3dImmediateContext->PSSetShaderResources(0, nSRV_, nulls);
-	nSRV_ = 0;
 }
 
-Mesh *Mesh::create(MESH_TYPE type, ID3D11Device *pd3dDevice, void *param)
+Mesh *Mesh::create(MESH_TYPE type, ID3D11Device *pd3dDevice, void *param, AsyncLoader *loader)
 {
 	Mesh *p = nullptr;
 
+	if (type == MESH_TYPE_TMESH && loader){
+		TMesh *t = new TMesh();
+		t->load(pd3dDevice, (LPCWSTR)param, loader);
+		return t;
+	}
+
 	switch (type){
 	case MESH_TYPE_EMBEDDED:
 		p = new EmbeddedMesh();
@@ -169,6 +358,10 @@ Mesh *Mesh::create(MESH_TYPE type, ID3D11Device *pd3dDevice, void *param)
 	case MESH_TYPE_TRIANGLELIST:
 		p = new TriangleListMesh();
 		break;
+
+	case MESH_TYPE_TMESH:
+		p = new TMesh();
+		break;
 	}
 	p->initialize(pd3dDevice, param);
 
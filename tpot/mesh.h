@@ -1,18 +1,17 @@
 #ifndef MESH_H__
 #define MESH_H__
 
+#include <vector>
+#include "AsyncLoader.h"
 #include "MobiusStrip.h"
 #include "SDKMesh.h"
+#include "TMeshFormat.h"
 #include "types.h"
 
 namespace tpot
 {
 
-	enum MESH_TYPE{
-		MESH_TYPE_EMBEDDED,
-		MESH_TYPE_SDKMESH,
-		MESH_TYPE_TRIANGLELIST,
-	};
+	class TMeshData;
 
 	class Mesh
 	{
@@ -23,15 +22,15 @@ namespace tpot
 		virtual void initialize(ID3D11Device *pd3dDevice, void *param) = 0;
 		virtual void destroy() = 0;
 
-		static Mesh *create(MESH_TYPE type, ID3D11Device *pd3dDevice, void *param);
+		// With a loader, a type that can load in the background returns at once
+		static Mesh *create(MESH_TYPE type, ID3D11Device *pd3dDevice, void *param, AsyncLoader *loader = nullptr);
 
 		virtual void Draw(ID3D11DeviceContext *pd3dImmediateContext) = 0;
+		virtual bool ready() const { return true; }	// false while loading
 
 		virtual UINT stride() const { return 0; }
 		virtual ID3D11Buffer *VB()  { return nullptr; }
 		virtual UINT verticies_count() const { return 0; }
-
-		virtual void texture(ID3D11ShaderResourceView *pSRV, UINT slot = 0){}
 	};
 
 	class EmbeddedMesh : public Mesh
@@ -78,24 +77,40 @@ namespace tpot
 		void Draw(ID3D11DeviceContext *pd3dImmediateContext);
 	};
 
-	struct VERTEX_LIST_MESH_PARAM{
-		VS::ID vs;
-		void   *verticies;
-		UINT   vertex_count;
-		WORD   *indicies;
-		UINT   index_count;
+	// .tmesh: the file is mapped, validated by TMeshReader and its data
+	// sections become buffers as they are, with no fixups. load() does the
+	// file and the textures on loader threads and the D3D objects from
+	// AsyncLoader::pump(); Draw() skips the mesh until ready().
+	class TMesh : public Mesh {
+	private:
+		AsyncLoader                           *loader_ = nullptr;
+		std::vector<AsyncLoader::JOB>          jobs_;	// the mesh, then its textures
+		std::vector<ID3D11Buffer*>             buffers_;	// per section, nullptr for metadata
+		std::vector<ID3D11ShaderResourceView*> diffuse_;	// per material
+		std::vector<TMESH_STREAM>              streams_;
+		std::vector<TMESH_INDEX_BUFFER>        index_buffers_;
+		std::vector<TMESH_MESH>                meshes_;
+		std::vector<TMESH_SUBSET>              subsets_;
+		std::vector<UINT>                      draws_;
+
+		void create(ID3D11Device *pd3dDevice, const TMeshData &data, LPCWSTR path);
+
+	public:
+		TMesh();
+		~TMesh();
+
+		void initialize(ID3D11Device *pd3dDevice, void *param);
+		void load(ID3D11Device *pd3dDevice, LPCWSTR path, AsyncLoader *loader);
+		void destroy();
+
+		void Draw(ID3D11DeviceContext *pd3dImmediateContext);
+		bool ready() const;
 	};
 
 	class TriangleListMesh : public Mesh {
 	private:
-		enum{
-			TEXTURE_MAX = 8,
-		};
-
 		ID3D11Buffer*           pVertexBuffer_ = nullptr;
 		ID3D11Buffer*           pIndexBuffer_ = nullptr;
-		ID3D11ShaderResourceView *p_SRV_[TEXTURE_MAX];
-		UINT                      nSRV_ = 0;
 		UINT                    nIndicies_ = 0;
 		UINT					stride_ = 0;
 		VS::ID                  vs_id_;
@@ -106,8 +121,6 @@ namespace tpot
 		void initialize(ID3D11Device *pd3dDevice, void *param);
 		void destroy();
 
-		void texture(ID3D11ShaderResourceView *pSRV, UINT slot = 0);
-
 		void Draw(ID3D11DeviceContext *pd3dImmediateContext);
 	};
 
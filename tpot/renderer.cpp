@@ -1,729 +1,394 @@
-#include "DXUT.h"
-#include "SDKmisc.h"
-#include <array>
-#include "RenderTarget.h"
+#include <string.h>
 #include "renderer.h"
-#include "mesh.h"
+#include "device.h"
 
 namespace tpot
 {
 
-class RasterStates
+namespace
 {
-public:
+	const UINT UNKNOWN = ~0u;
+	const UINT DISABLED = ~0u - 1;
+}// namespace
 
-private:
-	ID3D11RasterizerState* pRasterizerStates_[RASTERIZER_STATE::MAX];
-
-public:
-
-	RasterStates( ID3D11Device *pd3dDevice );
-	~RasterStates();
-
-	void set(RASTERIZER_STATE::ID id, ID3D11DeviceContext *pd3dImmediateContext);
-};
-
-class SamplerStates
-{
-public:
-
-private:
-	ID3D11SamplerState* pSamplerStates_[SAMPLER_STATE::MAX];
-
-public:
-
-	SamplerStates(ID3D11Device *pd3dDevice);
-	~SamplerStates();
-
-	void set(UINT slot, SAMPLER_STATE::ID id, ID3D11DeviceContext *pd3dImmediateContext);
-};
-
-class DepthStencilStates
+const char *BINDING::name(BINDING::ID id)
 {
-public:
-
-private:
-	ID3D11DepthStencilState* pDepthStencilStates_[DEPTH_STATE::MAX];
-
-public:
-
-	DepthStencilStates(ID3D11Device *pd3dDevice);
-	~DepthStencilStates();
-
-	void set(DEPTH_STATE::ID id, ID3D11DeviceContext *pd3dImmediateContext);
-};
-
-
-class ConstantBuffer
-{
-	ID3D11Buffer*                       pCB_;
-public:
-	ConstantBuffer( UINT size, ID3D11Device *pd3dDevice );
-	~ConstantBuffer();
-
-	void *Map(ID3D11DeviceContext *pd3dImmediateContext);
-	void UmMap(ID3D11DeviceContext *pd3dImmediateContext);
-	ID3D11Buffer* const *get();
-};
-
-
-ConstantBuffer::ConstantBuffer( UINT size, ID3D11Device *pd3dDevice )
-{
-
-	D3D11_BUFFER_DESC Desc;
-	Desc.Usage = D3D11_USAGE_DYNAMIC;
-	Desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	Desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	Desc.MiscFlags = 0;
-
-	Desc.ByteWidth = size;
-	HRESULT hr = pd3dDevice->CreateBuffer( &Desc, NULL, &pCB_ );
-	if ( hr != S_OK )
-	{
-		return;
-	}
-
-	DXUT_SetDebugName( pCB_, "CB_DEFAULT" );
+	static const char *names[BINDING::MAX] = {
+		"shader",
+		"sampler",
+		"rasterizer",
+		"depth",
+		"constant_buffer",
+		"texture",
+		"input_layout",
+	};
+	return (id < BINDING::MAX) ? names[id] : "unknown";
 }
 
-
-ConstantBuffer::~ConstantBuffer()
+UINT BINDING_STATS::total(const UINT *count) const
 {
-	SAFE_RELEASE( pCB_ );
+	UINT n = 0;
+	for (int i = 0; i < BINDING::MAX; i++) n += count[i];
+	return n;
 }
 
-
-void *ConstantBuffer::Map(ID3D11DeviceContext *pd3dImmediateContext)
+Renderer::Renderer( Device *pDevice )
 {
-	D3D11_MAPPED_SUBRESOURCE MappedResource;
-	pd3dImmediateContext->Map( pCB_, 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedResource );
+	pDevice_ = pDevice;
+	width_ = 0;
+	height_ = 0;
+	mViewProjection_ = MatrixIdentity();
+	mPrevViewProjection_ = MatrixIdentity();
+	hasViewProjection_ = false;
 
-	return MappedResource.pData;
+	cache_ = true;
+	vs_ = UNKNOWN;
+	for (UINT i = 0; i < TEXTURE_SLOT_MAX; i++) texture_[i] = ~0u;
+	invalidate();
+	memset(&stats_, 0, sizeof(stats_));
 }
 
-
-void ConstantBuffer::UmMap(ID3D11DeviceContext *pd3dImmediateContext)
+Renderer::~Renderer()
 {
-	pd3dImmediateContext->Unmap( pCB_, 0 );
+	delete pDevice_;
+	pDevice_ = nullptr;
 }
 
-
-ID3D11Buffer* const *ConstantBuffer::get()
+Device *Renderer::device()
 {
-	return &pCB_;
+	return pDevice_;
 }
 
-
-RasterStates::RasterStates( ID3D11Device *pd3dDevice )
+void Renderer::invalidate()
 {
-	HRESULT hr;
-
-	D3D11_RASTERIZER_DESC RasterDesc;
-	ZeroMemory( &RasterDesc, sizeof( D3D11_RASTERIZER_DESC ) );
-	RasterDesc.FillMode = D3D11_FILL_SOLID;
-	RasterDesc.CullMode = D3D11_CULL_NONE;
-	RasterDesc.DepthClipEnable = TRUE;
-
-	hr = pd3dDevice->CreateRasterizerState(&RasterDesc, &pRasterizerStates_[RASTERIZER_STATE::SOLID]);
-	if( hr != S_OK )
-	{
-		return;
-	}
-	DXUT_SetDebugName(pRasterizerStates_[RASTERIZER_STATE::SOLID], "Solid");
-
-	RasterDesc.FillMode = D3D11_FILL_WIREFRAME;
-	hr = pd3dDevice->CreateRasterizerState(&RasterDesc, &pRasterizerStates_[RASTERIZER_STATE::WIREFRAME]);
-	if( hr != S_OK )
-	{
-		return;
-	}
-	DXUT_SetDebugName(pRasterizerStates_[RASTERIZER_STATE::WIREFRAME], "Wireframe");
+	for (auto &x : shader_) x = UNKNOWN;
+	for (auto &x : sampler_) x = UNKNOWN;
+	for (auto &x : cb_) x = UNKNOWN;
+	for (auto &x : texture_valid_) x = false;
+	rasterizer_ = UNKNOWN;
+	depth_ = UNKNOWN;
+	layout_ = UNKNOWN;
 }
 
-
-RasterStates::~RasterStates()
+void Renderer::beginFrame()
 {
-	for( auto it : pRasterizerStates_ ){
-		SAFE_RELEASE( it );
-	}
+	pDevice_->beginFrame();
+	invalidate();
+	memset(&stats_, 0, sizeof(stats_));
 }
 
-void RasterStates::set(RASTERIZER_STATE::ID id, ID3D11DeviceContext *pd3dImmediateContext)
+void Renderer::endFrame()
 {
-	pd3dImmediateContext->RSSetState( pRasterizerStates_[id] );
+	pDevice_->endFrame();
 }
 
-SamplerStates::SamplerStates(ID3D11Device *pd3dDevice)
+bool Renderer::getGpuTime(float *ms)
 {
-	HRESULT hr;
-
-	// Point
-	D3D11_SAMPLER_DESC SamDesc;
-	SamDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
-	SamDesc.AddressU = D3D11_TEXTURE_ADDRESS_BORDER;
-	SamDesc.AddressV = D3D11_TEXTURE_ADDRESS_BORDER;
-	SamDesc.AddressW = D3D11_TEXTURE_ADDRESS_BORDER;
-	SamDesc.MipLODBias = 0.0f;
-	SamDesc.MaxAnisotropy = 1;
-	SamDesc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
-	SamDesc.BorderColor[0] = SamDesc.BorderColor[1] = SamDesc.BorderColor[2] = SamDesc.BorderColor[3] = 1.0;
-	SamDesc.MinLOD = 0;
-	SamDesc.MaxLOD = D3D11_FLOAT32_MAX;
-	V(pd3dDevice->CreateSamplerState(&SamDesc, &pSamplerStates_[SAMPLER_STATE::POINT]));
-	DXUT_SetDebugName(pSamplerStates_[SAMPLER_STATE::POINT], "Point");
-
-	// Linear
-	SamDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
-	SamDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
-	SamDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
-	SamDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
-	V(pd3dDevice->CreateSamplerState(&SamDesc, &pSamplerStates_[SAMPLER_STATE::LINEAR]));
-	DXUT_SetDebugName(pSamplerStates_[SAMPLER_STATE::LINEAR], "Linear");
-
+	return pDevice_->getGpuTime(ms);
 }
 
-SamplerStates::~SamplerStates()
+const BINDING_STATS &Renderer::stats() const
 {
-	for( auto it : pSamplerStates_ )
-	{
-	    SAFE_RELEASE( it );
-	}
+	return stats_;
 }
 
-void SamplerStates::set(UINT slot, SAMPLER_STATE::ID id, ID3D11DeviceContext *pd3dImmediateContext)
+void Renderer::setStateCache(bool enable)
 {
-	pd3dImmediateContext->PSSetSamplers(slot, 1, &pSamplerStates_[id]);
+	cache_ = enable;
 }
 
-DepthStencilStates::DepthStencilStates(ID3D11Device *pd3dDevice)
+// true: already bound, drop the call
+bool Renderer::filter(BINDING::ID binding, UINT *bound, UINT id)
 {
-	HRESULT hr;
-
-	pDepthStencilStates_[DEPTH_STATE::UNUSED] = nullptr;
-
-	D3D11_DEPTH_STENCIL_DESC Desc;
-
-	ZeroMemory(&Desc, sizeof(Desc));
-	V(pd3dDevice->CreateDepthStencilState(&Desc, &pDepthStencilStates_[DEPTH_STATE::DISABLE]));
-
+	stats_.submitted[binding]++;
+	if (cache_ && id != UNKNOWN && *bound == id){
+		stats_.filtered[binding]++;
+		return true;
+	}
+	*bound = id;
+	stats_.forwarded[binding]++;
+	return false;
 }
 
-DepthStencilStates::~DepthStencilStates()
+// A render target must not stay bound as a shader resource
+void Renderer::unbindTexture(UINT id)
 {
-	for (auto it : pDepthStencilStates_)
-	{
-		SAFE_RELEASE(it);
+	if (~0u == id) return;
+	for (UINT i = 0; i < TEXTURE_SLOT_MAX; i++){
+		if (texture_[i] != id) continue;
+		pDevice_->setTexture(i, ~0u);
+		texture_[i] = ~0u;
+		texture_valid_[i] = true;
+		stats_.forwarded[BINDING::TEXTURE]++;
 	}
 }
 
-void DepthStencilStates::set(DEPTH_STATE::ID id, ID3D11DeviceContext *pd3dImmediateContext)
+void Renderer::ResizedSwapChain(UINT width, UINT height)
 {
-	pd3dImmediateContext->OMSetDepthStencilState(pDepthStencilStates_[id], 0);
-}
+	width_ = width;
+	height_ = height;
 
-class Shader
+	pDevice_->ResizedSwapChain(width, height);
+	invalidate();
+}
+void Renderer::ReleasingSwapChain()
 {
-	std::array<ID3D11VertexShader*,		VS::MAX>	pVertexShader_;
-	std::array<ID3D11HullShader*,		HS::MAX>	pHullShader_;
-	std::array<ID3D11DomainShader*,		DS::MAX>	pDomainShader_;
-	std::array<ID3D11GeometryShader*,	GS::MAX>	pGeometryShader_;
-	std::array<ID3D11PixelShader*,		PS::MAX>	pPixelShader_;
-
-	std::array<ID3D11InputLayout*,		VS::MAX>	pLayout_;
-	std::array<ConstantBuffer*,			VS::MAX>	pCB_;
-
-	UINT								vs_current_;
-
-public:
-	Shader( ID3D11Device *pd3dDevice, ID3D11DeviceContext *pd3dImmediateContext );
-	~Shader();
-
-	void setVS(VS::ID id, ID3D11DeviceContext *pd3dImmediateContext );
-	void setHS(HS::ID id, ID3D11DeviceContext *pd3dImmediateContext );
-	void setDS(DS::ID id, ID3D11DeviceContext *pd3dImmediateContext);
-	void setGS(GS::ID id, ID3D11DeviceContext *pd3dImmediateContext);
-	void setPS(PS::ID id, ID3D11DeviceContext *pd3dImmediateContext);
-	void setCS(ID3D11DeviceContext *pd3dImmediateContext );
-
-	void setCB_VS( ID3D11DeviceContext *pd3dImmediateContext );
-	void setCB_HS( ID3D11DeviceContext *pd3dImmediateContext );
-	void setCB_DS( ID3D11DeviceContext *pd3dImmediateContext );
-	void setCB_GS( ID3D11DeviceContext *pd3dImmediateContext );
-	void setCB_PS( ID3D11DeviceContext *pd3dImmediateContext );
-
-	void *Map(ID3D11DeviceContext *pd3dImmediateContext);
-	void UmMap(ID3D11DeviceContext *pd3dImmediateContext);
-
-	ID3D11InputLayout *InputLayout();
-};
+	pDevice_->ReleasingSwapChain();
+	invalidate();
+}
 
 
-//--------------------------------------------------------------------------------------
-// Find and compile the specified shader
-//--------------------------------------------------------------------------------------
-HRESULT CompileShaderFromFile( WCHAR* szFileName, D3D_SHADER_MACRO* pDefines, LPCSTR szEntryPoint,
-                               LPCSTR szShaderModel, ID3DBlob** ppBlobOut )
+UINT Renderer::createMesh(MESH_TYPE type, void *param)
 {
-	HRESULT hr = S_OK;
-
-	// find the file
-	WCHAR str[MAX_PATH];
-	V_RETURN( DXUTFindDXSDKMediaFileCch( str, MAX_PATH, szFileName ) );
-
-	DWORD dwShaderFlags = D3DCOMPILE_ENABLE_STRICTNESS;
-#if defined( DEBUG ) || defined( _DEBUG )
-	// Set the D3DCOMPILE_DEBUG flag to embed debug information in the shaders.
-	// Setting this flag improves the shader debugging experience, but still allows
-	// the shaders to be optimized and to run exactly the way they will run in
-	// the release configuration of this program.
-	dwShaderFlags |= D3DCOMPILE_DEBUG;
-#endif
-
-	ID3DBlob* pErrorBlob;
-	hr = D3DX11CompileFromFile( str, pDefines, NULL, szEntryPoint, szShaderModel,
-	                            dwShaderFlags, 0, NULL, ppBlobOut, &pErrorBlob, NULL );
-	if( FAILED( hr ) )
-	{
-		if( pErrorBlob != NULL )
-		{
-			OutputDebugStringA( ( char* )pErrorBlob->GetBufferPointer() );
-		}
-		SAFE_RELEASE( pErrorBlob );
-		return hr;
-	}
-	SAFE_RELEASE( pErrorBlob );
-
-	return S_OK;
+	UINT id = pDevice_->createMesh(type, param);
+	if (mesh_type_.size() <= id) mesh_type_.resize(id + 1, type);
+	mesh_type_[id] = type;
+	return id;
 }
 
-Shader::Shader( ID3D11Device *pd3dDevice, ID3D11DeviceContext *pd3dImmediateContext )
+bool Renderer::isMeshReady(UINT mesh)
 {
-	vs_current_ = VS::MAX;
-
-	// Compile shaders
-	ID3DBlob* pBlobVS = NULL;
-	ID3DBlob* pBlobHSInt = NULL;
-	ID3DBlob* pBlobHSFracEven = NULL;
-	ID3DBlob* pBlobHSFracOdd = NULL;
-	ID3DBlob* pBlobDS = NULL;
-	ID3DBlob* pBlobPS = NULL;
-	ID3DBlob* pBlobPSSolid = NULL;
-
-	// This macro is used to compile the hull shader with different partition modes
-	// Please see the partitioning mode attribute for the hull shader for more information
-	D3D_SHADER_MACRO integerPartitioning[] = { { "BEZIER_HS_PARTITION", "\"integer\"" }, { 0 } };
-	D3D_SHADER_MACRO fracEvenPartitioning[] = { { "BEZIER_HS_PARTITION", "\"fractional_even\"" }, { 0 } };
-	D3D_SHADER_MACRO fracOddPartitioning[] = { { "BEZIER_HS_PARTITION", "\"fractional_odd\"" }, { 0 } };
-
-	HRESULT hr;
-	V( CompileShaderFromFile( L"sample.hlsl", NULL, "BezierVS", "vs_5_0",  &pBlobVS ) );
-	V( CompileShaderFromFile( L"sample.hlsl", integerPartitioning, "BezierHS", "hs_5_0", &pBlobHSInt ) );
-	V( CompileShaderFromFile( L"sample.hlsl", fracEvenPartitioning, "BezierHS", "hs_5_0", &pBlobHSFracEven ) );
-	V( CompileShaderFromFile( L"sample.hlsl", fracOddPartitioning, "BezierHS", "hs_5_0", &pBlobHSFracOdd ) );
-	V( CompileShaderFromFile( L"sample.hlsl", NULL, "BezierDS", "ds_5_0", &pBlobDS ) );
-	V( CompileShaderFromFile( L"sample.hlsl", NULL, "BezierPS", "ps_5_0", &pBlobPS ) );
-	V( CompileShaderFromFile( L"sample.hlsl", NULL, "SolidColorPS", "ps_5_0", &pBlobPSSolid ) );
-
-	// Create shaders
-	V(pd3dDevice->CreateVertexShader(pBlobVS->GetBufferPointer(), pBlobVS->GetBufferSize(), NULL, &pVertexShader_[VS::BEZIER]));
-	DXUT_SetDebugName(pVertexShader_[VS::BEZIER], "BezierVS");
-
-	V(pd3dDevice->CreateHullShader(pBlobHSInt->GetBufferPointer(), pBlobHSInt->GetBufferSize(), NULL, &pHullShader_[HS::PARTITION_INTEGER]));
-	DXUT_SetDebugName( pHullShader_[HS::PARTITION_INTEGER], "BezierHS int" );
-
-	V(pd3dDevice->CreateHullShader(pBlobHSFracEven->GetBufferPointer(), pBlobHSFracEven->GetBufferSize(), NULL, &pHullShader_[HS::PARTITION_FRACTIONAL_EVEN]));
-	DXUT_SetDebugName(pHullShader_[HS::PARTITION_FRACTIONAL_EVEN], "BezierHS frac even");
-
-	V(pd3dDevice->CreateHullShader(pBlobHSFracOdd->GetBufferPointer(), pBlobHSFracOdd->GetBufferSize(), NULL, &pHullShader_[HS::PARTITION_FRACTIONAL_ODD]));
-	DXUT_SetDebugName(pHullShader_[HS::PARTITION_FRACTIONAL_ODD], "BezierHS frac odd");
-
-	V(pd3dDevice->CreateDomainShader(pBlobDS->GetBufferPointer(), pBlobDS->GetBufferSize(), NULL, &pDomainShader_[DS::BEZIER]));
-	DXUT_SetDebugName(pDomainShader_[DS::BEZIER], "BezierDS");
-
-	V(pd3dDevice->CreatePixelShader(pBlobPS->GetBufferPointer(), pBlobPS->GetBufferSize(), NULL, &pPixelShader_[PS::BEZIER]));
-	DXUT_SetDebugName(pPixelShader_[PS::BEZIER], "BezierPS");
-
-	V(pd3dDevice->CreatePixelShader(pBlobPSSolid->GetBufferPointer(), pBlobPSSolid->GetBufferSize(), NULL, &pPixelShader_[PS::SOLID_COLOR]));
-	DXUT_SetDebugName(pPixelShader_[PS::SOLID_COLOR], "SolidColorPS");
-
-	// Create our vertex input layout - this matches the BEZIER_CONTROL_POINT structure
-	const D3D11_INPUT_ELEMENT_DESC layout_BEZIER[] =
-	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,  D3D11_INPUT_PER_VERTEX_DATA, 0 },
-	};
-
-	V(pd3dDevice->CreateInputLayout(layout_BEZIER, ARRAYSIZE(layout_BEZIER), pBlobVS->GetBufferPointer(),
-		pBlobVS->GetBufferSize(), &pLayout_[VS::BEZIER]));
-	DXUT_SetDebugName(pLayout_[VS::BEZIER], "Primary");
-
-	SAFE_RELEASE( pBlobVS );
-	SAFE_RELEASE( pBlobHSInt );
-	SAFE_RELEASE( pBlobHSFracEven );
-	SAFE_RELEASE( pBlobHSFracOdd );
-	SAFE_RELEASE( pBlobDS );
-	SAFE_RELEASE( pBlobPS );
-	SAFE_RELEASE( pBlobPSSolid );
-
-	pCB_[VS::BEZIER] = new ConstantBuffer(sizeof(CB_BEZIER), pd3dDevice);
-
-	// Render Scene
-	V(CompileShaderFromFile(L"scene.hlsl", NULL, "VS_RenderScene", "vs_5_0", &pBlobVS));
-	V(CompileShaderFromFile(L"scene.hlsl", NULL, "PS_RenderScene", "ps_5_0", &pBlobPS));
-	V(pd3dDevice->CreateVertexShader(pBlobVS->GetBufferPointer(), pBlobVS->GetBufferSize(), NULL, &pVertexShader_[VS::SCENE]));
-	DXUT_SetDebugName(pVertexShader_[VS::SCENE], "SceneVS");
-	V(pd3dDevice->CreatePixelShader(pBlobPS->GetBufferPointer(), pBlobPS->GetBufferSize(), NULL, &pPixelShader_[PS::SCENE]));
-	DXUT_SetDebugName(pPixelShader_[PS::SCENE], "ScenePS");
-
-	const D3D11_INPUT_ELEMENT_DESC SceneLayout[] =
-	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "TEXTURE", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-	};
-	hr = pd3dDevice->CreateInputLayout(SceneLayout, ARRAYSIZE(SceneLayout), pBlobVS->GetBufferPointer(),
-		pBlobVS->GetBufferSize(), &pLayout_[VS::SCENE]);
-	DXUT_SetDebugName(pLayout_[VS::SCENE], "SceneLayout");
-
-	SAFE_RELEASE(pBlobVS);
-	SAFE_RELEASE(pBlobPS);
-
-	pCB_[VS::SCENE] = new ConstantBuffer(sizeof(CB_SCENE), pd3dDevice);
-
-	// Render Decal
-	V(CompileShaderFromFile(L"decal.hlsl", NULL, "VS", "vs_5_0", &pBlobVS));
-	V(CompileShaderFromFile(L"decal.hlsl", NULL, "PS", "ps_5_0", &pBlobPS));
-	V(pd3dDevice->CreateVertexShader(pBlobVS->GetBufferPointer(), pBlobVS->GetBufferSize(), NULL, &pVertexShader_[VS::DECAL]));
-	DXUT_SetDebugName(pVertexShader_[VS::DECAL], "DecalVS");
-	V(pd3dDevice->CreatePixelShader(pBlobPS->GetBufferPointer(), pBlobPS->GetBufferSize(), NULL, &pPixelShader_[PS::DECAL]));
-	DXUT_SetDebugName(pPixelShader_[PS::DECAL], "DecalPS");
-
-	const D3D11_INPUT_ELEMENT_DESC DecalLayout[] =
-	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "TEXTURE", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-	};
-	hr = pd3dDevice->CreateInputLayout(DecalLayout, ARRAYSIZE(DecalLayout), pBlobVS->GetBufferPointer(),
-		pBlobVS->GetBufferSize(), &pLayout_[VS::DECAL]);
-	DXUT_SetDebugName(pLayout_[VS::DECAL], "DecalLayout");
-
-	SAFE_RELEASE(pBlobVS);
-	SAFE_RELEASE(pBlobPS);
-
-	pCB_[VS::DECAL] = new ConstantBuffer(sizeof(CB_DECAL), pd3dDevice);
-
-	// Render Shadow maps
-	V(CompileShaderFromFile(L"shadow.hlsl", NULL, "VSMain", "vs_5_0", &pBlobVS));
-	V(CompileShaderFromFile(L"shadow.hlsl", NULL, "PSMain", "ps_5_0", &pBlobPS));
-	V(pd3dDevice->CreateVertexShader(pBlobVS->GetBufferPointer(), pBlobVS->GetBufferSize(), NULL, &pVertexShader_[VS::SHADOW]));
-	DXUT_SetDebugName(pVertexShader_[VS::SHADOW], "ShadowVS");
-	V(pd3dDevice->CreatePixelShader(pBlobPS->GetBufferPointer(), pBlobPS->GetBufferSize(), NULL, &pPixelShader_[PS::SHADOW]));
-	DXUT_SetDebugName(pPixelShader_[PS::SHADOW], "ShadowPS");
-
-	const D3D11_INPUT_ELEMENT_DESC LayoutShadow[] =
-	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-	};
-	hr = pd3dDevice->CreateInputLayout(LayoutShadow, ARRAYSIZE(LayoutShadow), pBlobVS->GetBufferPointer(),
-		pBlobVS->GetBufferSize(), &pLayout_[VS::SHADOW]);
-	DXUT_SetDebugName(pLayout_[VS::SHADOW], "ShadowLayout");
-
-	SAFE_RELEASE(pBlobVS);
-	SAFE_RELEASE(pBlobPS);
-
-	pCB_[VS::SHADOW] = new ConstantBuffer(sizeof(CB_SHADOW), pd3dDevice);
-
-	// TAA
-	V(CompileShaderFromFile(L"taa.hlsl", NULL, "VS", "vs_5_0", &pBlobVS));
-	V(CompileShaderFromFile(L"taa.hlsl", NULL, "PS", "ps_5_0", &pBlobPS));
-	V(pd3dDevice->CreateVertexShader(pBlobVS->GetBufferPointer(), pBlobVS->GetBufferSize(), NULL, &pVertexShader_[VS::TAA]));
-	DXUT_SetDebugName(pVertexShader_[VS::TAA], "TAA VS");
-	V(pd3dDevice->CreatePixelShader(pBlobPS->GetBufferPointer(), pBlobPS->GetBufferSize(), NULL, &pPixelShader_[PS::TAA]));
-	DXUT_SetDebugName(pPixelShader_[PS::TAA], "TAA PS");
-
-	const D3D11_INPUT_ELEMENT_DESC LayoutTaa[] =
-	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "TEXTURE", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-	};
-	hr = pd3dDevice->CreateInputLayout(LayoutTaa, ARRAYSIZE(LayoutTaa), pBlobVS->GetBufferPointer(),
-		pBlobVS->GetBufferSize(), &pLayout_[VS::TAA]);
-	DXUT_SetDebugName(pLayout_[VS::TAA], "TAA Layout");
-
-	SAFE_RELEASE(pBlobVS);
-	SAFE_RELEASE(pBlobPS);
-
-	pCB_[VS::TAA] = new ConstantBuffer(sizeof(CB_TAA), pd3dDevice);
+	return pDevice_->isMeshReady(mesh);
 }
 
-
-Shader::~Shader()
+void Renderer::Draw( UINT mesh )
 {
-	std::for_each(pCB_.begin(), pCB_.end(), [](ConstantBuffer* it) {
-		SAFE_DELETE(it);
-	});
+	if (vs_ < VS::MAX && !filter(BINDING::INPUT_LAYOUT, &layout_, vs_)){
+		pDevice_->setInputLayout((VS::ID)vs_);
+	}
 
-	std::for_each(pLayout_.begin(), pLayout_.end(), [](ID3D11InputLayout* it) {
-		SAFE_RELEASE(it);
-	});
+	pDevice_->Draw(mesh);
 
-	std::for_each( pVertexShader_.begin(), pVertexShader_.end(), [](ID3D11VertexShader* it) {
-		SAFE_RELEASE( it );
-	});
-	std::for_each( pHullShader_.begin(),pHullShader_.end(), [](ID3D11HullShader* it) {
-		SAFE_RELEASE( it );
-	});
-	std::for_each( pDomainShader_.begin(),pDomainShader_.end(), [](ID3D11DomainShader* it) {
-		SAFE_RELEASE( it );
-	});
-	std::for_each( pGeometryShader_.begin(),pGeometryShader_.end(), [](ID3D11GeometryShader* it) {
-		SAFE_RELEASE( it );
-	});
-	std::for_each( pPixelShader_.begin(),pPixelShader_.end(), [](ID3D11PixelShader* it) {
-		SAFE_RELEASE( it );
-	});
+	// CDXUTSDKMesh::Render and TMesh::Draw bind their diffuse textures to slot 0
+	if (mesh < mesh_type_.size() && (mesh_type_[mesh] == MESH_TYPE_SDKMESH || mesh_type_[mesh] == MESH_TYPE_TMESH)){
+		texture_[0] = ~0u;
+		texture_valid_[0] = false;
+	}
 }
 
-void Shader::setVS( VS::ID id, ID3D11DeviceContext *pd3dImmediateContext )
-{
-	vs_current_ = id;
-	pd3dImmediateContext->VSSetShader( pVertexShader_[id], NULL, 0 );
-}
-void Shader::setHS(HS::ID id, ID3D11DeviceContext *pd3dImmediateContext)
-{
-	pd3dImmediateContext->HSSetShader( pHullShader_[id], NULL, 0 );
-}
-void Shader::setDS(DS::ID id, ID3D11DeviceContext *pd3dImmediateContext)
-{
-	pd3dImmediateContext->DSSetShader( pDomainShader_[id], NULL, 0 );
-}
-void Shader::setGS(GS::ID id, ID3D11DeviceContext *pd3dImmediateContext)
+void Renderer::Dispatch( UINT id, UINT groups_x, UINT groups_y )
 {
-	pd3dImmediateContext->GSSetShader( pGeometryShader_[id], NULL, 0 );
-}
-void Shader::setPS(PS::ID id, ID3D11DeviceContext *pd3dImmediateContext)
-{
-	pd3dImmediateContext->PSSetShader( pPixelShader_[id], NULL, 0 );
-}
-void Shader::setCS( ID3D11DeviceContext *pd3dImmediateContext )
-{
-	pd3dImmediateContext->CSSetShader(NULL, NULL, 0);
+	unbindTexture(id);
+	pDevice_->Dispatch(id, groups_x, groups_y);
 }
 
-void Shader::setCB_VS( ID3D11DeviceContext *pd3dImmediateContext )
-{
-	pd3dImmediateContext->VSSetConstantBuffers(0, 1, pCB_[vs_current_]->get());
-}
-void Shader::setCB_HS( ID3D11DeviceContext *pd3dImmediateContext )
-{
-	pd3dImmediateContext->HSSetConstantBuffers(0, 1, pCB_[vs_current_]->get());
-}
-void Shader::setCB_DS( ID3D11DeviceContext *pd3dImmediateContext )
+UINT Renderer::create(RENDER_TARGET::TYPE type, UINT width, UINT height, float scale, RENDER_TARGET::FORMAT format)
 {
-	pd3dImmediateContext->DSSetConstantBuffers(0, 1, pCB_[vs_current_]->get());
-}
-void Shader::setCB_GS( ID3D11DeviceContext *pd3dImmediateContext )
-{
-	pd3dImmediateContext->GSSetConstantBuffers(0, 1, pCB_[vs_current_]->get());
-}
-void Shader::setCB_PS( ID3D11DeviceContext *pd3dImmediateContext )
-{
-	pd3dImmediateContext->PSSetConstantBuffers(0, 1, pCB_[vs_current_]->get());
+	if (RENDER_TARGET::FORMAT_MAX <= format) format = RENDER_TARGET::defaultFormat(type);
+	return pDevice_->createRenderTarget(type, width, height, scale, format);
 }
 
-void *Shader::Map(ID3D11DeviceContext *pd3dImmediateContext)
+void Renderer::setScale(UINT id, float scale)
 {
-	return pCB_[vs_current_]->Map(pd3dImmediateContext);
-}
-void Shader::UmMap(ID3D11DeviceContext *pd3dImmediateContext)
-{
-	pCB_[vs_current_]->UmMap(pd3dImmediateContext);
-}
+	pDevice_->setScale(id, scale);
 
-ID3D11InputLayout *Shader::InputLayout()
-{
-	return pLayout_[vs_current_];
+	// may have been re-created, the bound view is stale
+	for (UINT i = 0; i < TEXTURE_SLOT_MAX; i++){
+		if (texture_[i] == id) texture_valid_[i] = false;
+	}
 }
 
-Renderer::Renderer( ID3D11Device *pd3dDevice )
+void Renderer::setFormat(UINT id, RENDER_TARGET::FORMAT format)
 {
-	pd3dDevice_ = pd3dDevice;
-	pd3dImmediateContext_ = DXUTGetD3D11DeviceContext();
+	pDevice_->setFormat(id, format);
 
-	TR_ = new RenderTargets(pd3dDevice);
-	RS_ = new RasterStates(pd3dDevice);
-	SAMP_ = new SamplerStates(pd3dDevice);
-	DSS_ = new DepthStencilStates(pd3dDevice);
-	Shader_ = new Shader(pd3dDevice, pd3dImmediateContext_);
+	for (UINT i = 0; i < TEXTURE_SLOT_MAX; i++){
+		if (texture_[i] == id) texture_valid_[i] = false;
+	}
 }
 
-Renderer::~Renderer()
+void Renderer::getSize(UINT id, UINT *width, UINT *height)
 {
-	SAFE_DELETE(Shader_);
-	SAFE_DELETE(DSS_);
-	SAFE_DELETE(SAMP_);
-	SAFE_DELETE(RS_);
-	SAFE_DELETE(TR_);
-
-	pd3dDevice_ = nullptr;
-	pd3dImmediateContext_ = nullptr;
+	pDevice_->getSize(id, width, height);
 }
 
-void Renderer::ResizedSwapChain(ID3D11Device* pd3dDevice, const DXGI_SURFACE_DESC* pBackBufferSurfaceDesc)
-{
-	pBackBufferSurfaceDesc_ = *pBackBufferSurfaceDesc;
-
-	TR_->ResizedSwapChain(pd3dDevice, pBackBufferSurfaceDesc);
-}
-void Renderer::ReleasingSwapChain()
+void Renderer::getTextureSize(UINT id, UINT *width, UINT *height)
 {
-	TR_->ReleasingSwapChain();
+	pDevice_->getTextureSize(id, width, height);
 }
 
-
-void Renderer::Draw( Mesh *pMesh )
+unsigned long long Renderer::getBytes(UINT id)
 {
-	// Set the input assembler
-	// This sample uses patches with 16 control points each
-	// Although the Mobius strip only needs to use a vertex buffer,
-	// you can use an index buffer as well by calling IASetIndexBuffer().
-	pd3dImmediateContext_->IASetInputLayout(Shader_->InputLayout());
-
-	pMesh->Draw(pd3dImmediateContext_);
+	return pDevice_->getBytes(id);
 }
 
-ID3D11DeviceContext *Renderer::pd3dImmediateContext()
+UINT Renderer::getGeneration(UINT id)
 {
-	return pd3dImmediateContext_;
+	return pDevice_->getGeneration(id);
 }
 
-UINT Renderer::create(RENDER_TARGET::TYPE type, UINT width, UINT height)
+unsigned long long Renderer::getTotalBytes()
 {
-	return TR_->create(pd3dDevice_, type, width, height);
+	return pDevice_->getTotalBytes();
 }
 
 void Renderer::setRenderTarget(UINT id)
 {
-	TR_->set(id, pd3dImmediateContext_);
+	unbindTexture(id);
+	pDevice_->setRenderTarget(id);
 }
 void Renderer::setDepth(UINT id)
 {
-	TR_->set(id, pd3dImmediateContext_);
+	unbindTexture(id);
+	pDevice_->setRenderTarget(id);
 }
-ID3D11ShaderResourceView *Renderer::getTexture(UINT id)
+void Renderer::setTexture(UINT slot, UINT id)
 {
-	return TR_->get(id);
+	if (TEXTURE_SLOT_MAX <= slot){
+		pDevice_->setTexture(slot, id);
+		return;
+	}
+
+	stats_.submitted[BINDING::TEXTURE]++;
+	if (cache_ && texture_valid_[slot] && texture_[slot] == id){
+		stats_.filtered[BINDING::TEXTURE]++;
+		return;
+	}
+	texture_[slot] = id;
+	texture_valid_[slot] = true;
+	stats_.forwarded[BINDING::TEXTURE]++;
+	pDevice_->setTexture(slot, id);
 }
 void Renderer::pushRenderTarget()
 {
-	TR_->pushDefault(pd3dImmediateContext_);
+	pDevice_->pushRenderTarget();
 }
 void Renderer::popRenderTarget()
 {
-	TR_->popDefault(pd3dImmediateContext_);
+	pDevice_->popRenderTarget();
+}
+void Renderer::setPresentTarget(UINT id)
+{
+	unbindTexture(id);
+	pDevice_->setPresentTarget(id);
 }
-D3DXMATRIX Renderer::screenProjMatrix()
+void Renderer::setViewProjection(const MATRIX &m)
 {
-	D3DXMATRIX mP, mT, mS;
-	D3DXMatrixOrthoRH(&mP, (float)pBackBufferSurfaceDesc_.Width, (float)pBackBufferSurfaceDesc_.Height, 0, 1.0f);
-	D3DXMatrixScaling(&mS, 1.0f, -1.0f, 1.0f);
-	D3DXMatrixTranslation(&mT, -1.0f, +1.0f, 0.0f);
+	mPrevViewProjection_ = hasViewProjection_ ? mViewProjection_ : m;
+	mViewProjection_ = m;
+	hasViewProjection_ = true;
+}
+const MATRIX &Renderer::prevViewProjection() const
+{
+	return mPrevViewProjection_;
+}
+MATRIX Renderer::screenProjMatrix()
+{
+	MATRIX mP = MatrixOrthoRH((float)width_, (float)height_, 0, 1.0f);
+	MATRIX mS = MatrixScaling(1.0f, -1.0f, 1.0f);
+	MATRIX mT = MatrixTranslation(-1.0f, +1.0f, 0.0f);
 
-	return  mP * mS * mT;
+	return MatrixMultiply(MatrixMultiply(mP, mS), mT);
 }
 
 
 void Renderer::Clear( UINT color )
 {
-	TR_->Clear(color, pd3dImmediateContext_);
+	pDevice_->Clear(color);
 }
 
 void Renderer::ClearDepth( float depth )
 {
-	TR_->ClearDepth(depth, pd3dImmediateContext_);
+	pDevice_->ClearDepth(depth);
 }
 
 void Renderer::set(RASTERIZER_STATE::ID id)
 {
-	RS_->set(id, pd3dImmediateContext_);
+	if (!filter(BINDING::RASTERIZER, &rasterizer_, id)) pDevice_->set(id);
 }
 void Renderer::set(UINT slot, SAMPLER_STATE::ID id)
 {
-	SAMP_->set(slot, id, pd3dImmediateContext_);
+	UINT dummy = UNKNOWN;
+	if (!filter(BINDING::SAMPLER, (slot < SAMPLER_SLOT_MAX) ? &sampler_[slot] : &dummy, id)) pDevice_->set(slot, id);
 }
 void Renderer::set(VS::ID id)
 {
-	Shader_->setVS( id , pd3dImmediateContext_ );
+	vs_ = id;
+	if (!filter(BINDING::SHADER, &shader_[STAGE::VS], id)) pDevice_->set(id);
 }
 void Renderer::set(HS::ID id)
 {
-	Shader_->setHS( id , pd3dImmediateContext_ );
+	if (!filter(BINDING::SHADER, &shader_[STAGE::HS], id)) pDevice_->set(id);
 }
 void Renderer::set(DS::ID id)
 {
-	Shader_->setDS( id , pd3dImmediateContext_ );
+	if (!filter(BINDING::SHADER, &shader_[STAGE::DS], id)) pDevice_->set(id);
 }
 void Renderer::set(GS::ID id)
 {
-	Shader_->setGS( id , pd3dImmediateContext_ );
+	if (!filter(BINDING::SHADER, &shader_[STAGE::GS], id)) pDevice_->set(id);
 }
 void Renderer::set(PS::ID id)
 {
-	Shader_->setPS( id , pd3dImmediateContext_ );
+	if (!filter(BINDING::SHADER, &shader_[STAGE::PS], id)) pDevice_->set(id);
+}
+void Renderer::set(CS::ID id)
+{
+	if (!filter(BINDING::SHADER, &shader_[STAGE::CS], id)) pDevice_->set(id);
 }
 void Renderer::set(DEPTH_STATE::ID id)
 {
-	DSS_->set(id, pd3dImmediateContext_);
+	if (!filter(BINDING::DEPTH, &depth_, id)) pDevice_->set(id);
 }
 
 void Renderer::disableVS()
 {
-	pd3dImmediateContext_->VSSetShader( NULL, NULL, 0 );
+	if (!filter(BINDING::SHADER, &shader_[STAGE::VS], DISABLED)) pDevice_->disable(STAGE::VS);
 }
 void Renderer::disableHS()
 {
-	pd3dImmediateContext_->HSSetShader( NULL, NULL, 0 );
+	if (!filter(BINDING::SHADER, &shader_[STAGE::HS], DISABLED)) pDevice_->disable(STAGE::HS);
 }
 void Renderer::disableDS()
 {
-	pd3dImmediateContext_->DSSetShader( NULL, NULL, 0 );
+	if (!filter(BINDING::SHADER, &shader_[STAGE::DS], DISABLED)) pDevice_->disable(STAGE::DS);
 }
 void Renderer::disableGS()
 {
-	pd3dImmediateContext_->GSSetShader( NULL, NULL, 0 );
+	if (!filter(BINDING::SHADER, &shader_[STAGE::GS], DISABLED)) pDevice_->disable(STAGE::GS);
 }
 void Renderer::disablePS()
 {
-	pd3dImmediateContext_->PSSetShader( NULL, NULL, 0 );
+	if (!filter(BINDING::SHADER, &shader_[STAGE::PS], DISABLED)) pDevice_->disable(STAGE::PS);
 }
 
+// The constant buffer belongs to the current VS, so the binding is that VS
 void Renderer::setCB_VS()
 {
-	Shader_->setCB_VS( pd3dImmediateContext_ );
+	if (!filter(BINDING::CONSTANT_BUFFER, &cb_[STAGE::VS], vs_)) pDevice_->setCB(STAGE::VS);
 }
 void Renderer::setCB_HS()
 {
-	Shader_->setCB_HS( pd3dImmediateContext_ );
+	if (!filter(BINDING::CONSTANT_BUFFER, &cb_[STAGE::HS], vs_)) pDevice_->setCB(STAGE::HS);
 }
 void Renderer::setCB_DS()
 {
-	Shader_->setCB_DS( pd3dImmediateContext_ );
+	if (!filter(BINDING::CONSTANT_BUFFER, &cb_[STAGE::DS], vs_)) pDevice_->setCB(STAGE::DS);
 }
 void Renderer::setCB_GS()
 {
-	Shader_->setCB_GS( pd3dImmediateContext_ );
+	if (!filter(BINDING::CONSTANT_BUFFER, &cb_[STAGE::GS], vs_)) pDevice_->setCB(STAGE::GS);
 }
 void Renderer::setCB_PS()
 {
-	Shader_->setCB_PS( pd3dImmediateContext_ );
+	if (!filter(BINDING::CONSTANT_BUFFER, &cb_[STAGE::PS], vs_)) pDevice_->setCB(STAGE::PS);
+}
+void Renderer::setCB_CS()
+{
+	if (!filter(BINDING::CONSTANT_BUFFER, &cb_[STAGE::CS], vs_)) pDevice_->setCB(STAGE::CS);
 }
 
 void *Renderer::Map()
 {
-	return Shader_->Map(pd3dImmediateContext_);
+	// new allocation, stages bound to the old one of this VS must rebind
+	for (auto &x : cb_){
+		if (x == vs_) x = UNKNOWN;
+	}
+	return pDevice_->Map();
 }
 void Renderer::UmMap()
 {
-	Shader_->UmMap(pd3dImmediateContext_);
+	pDevice_->UmMap();
 }
 
 }// namespace tpot
\ No newline at end of file
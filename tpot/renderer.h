@@ -1,47 +1,112 @@
 #ifndef RENDERER_H__
 #define RENDERER_H__
 
+#include <vector>
 #include "types.h"
 
 namespace tpot
 {
 
-	class RenderTargets;
-	class RasterStates;
-	class DepthStencilStates;
-	class SamplerStates;
-	class ConstantBuffer;
-	class Shader;
-	class Mesh;
+	class Device;
 
-	class Renderer
+	struct BINDING{
+		enum ID
+		{
+			SHADER,
+			SAMPLER,
+			RASTERIZER,
+			DEPTH,
+			CONSTANT_BUFFER,
+			TEXTURE,
+			INPUT_LAYOUT,
+
+			MAX,
+		};
+
+		static const char *name(BINDING::ID id);
+	};
+
+	// Per frame, since beginFrame()
+	struct BINDING_STATS
 	{
-		ID3D11Device *pd3dDevice_;
-		ID3D11DeviceContext *pd3dImmediateContext_;
-		DXGI_SURFACE_DESC pBackBufferSurfaceDesc_;
+		UINT submitted[BINDING::MAX];	// calls from the frame code, input layout once per Draw
+		UINT filtered[BINDING::MAX];	// dropped, already bound
+		UINT forwarded[BINDING::MAX];	// reached the Device, render target hazard unbinds included
+
+		UINT total(const UINT *count) const;
+	};
 
-		RenderTargets *TR_;
-		RasterStates *RS_;
-		DepthStencilStates *DSS_;
-		SamplerStates *SAMP_;
-		Shader       *Shader_;
+	class Renderer
+	{
+		enum{
+			TEXTURE_SLOT_MAX = 8,
+			SAMPLER_SLOT_MAX = 16,
+		};
+
+		Device *pDevice_;
+		UINT   width_;	// back buffer
+		UINT   height_;
+
+		// Shadow copy of what is bound on the Device, so redundant
+		// bindings never reach it. UNKNOWN after beginFrame() since the
+		// HUD and the settings dialog bind their own state.
+		bool   cache_;
+		UINT   vs_;
+		UINT   shader_[STAGE::MAX];
+		UINT   sampler_[SAMPLER_SLOT_MAX];
+		UINT   rasterizer_;
+		UINT   depth_;
+		UINT   cb_[STAGE::MAX];		// VS whose latest constant data is bound
+		UINT   texture_[TEXTURE_SLOT_MAX];	// last render target bound, kept for hazards
+		bool   texture_valid_[TEXTURE_SLOT_MAX];
+		UINT   layout_;
+		std::vector<MESH_TYPE> mesh_type_;
+		BINDING_STATS stats_;
+
+		bool filter(BINDING::ID binding, UINT *bound, UINT id);
+		void invalidate();
+		void unbindTexture(UINT id);
+
+		MATRIX mViewProjection_;		// unjittered, this frame
+		MATRIX mPrevViewProjection_;	// unjittered, last frame
+		bool   hasViewProjection_;
 
 	public:
-		Renderer( ID3D11Device *pd3dDevice );
+		Renderer( Device *pDevice ); // takes ownership
 		~Renderer();
 
-		void ResizedSwapChain(ID3D11Device* pd3dDevice, const DXGI_SURFACE_DESC* pBackBufferSurfaceDesc);
-		void ReleasingSwapChain();
+		Device *device();
+
+		// Once per frame before the first binding: resets the statistics
+		// and forgets the shadow state
+		void beginFrame();
+		void endFrame();	// after the last draw of the frame, the HUD included
+		bool getGpuTime(float *ms);	// Device::getGpuTime
+		const BINDING_STATS &stats() const;
+		void setStateCache(bool enable); // off forwards every binding, for comparison
 
-		ID3D11DeviceContext *pd3dImmediateContext();
+		void ResizedSwapChain(UINT width, UINT height);
+		void ReleasingSwapChain();
 
-		UINT create(RENDER_TARGET::TYPE type, UINT width, UINT height);
+		// FORMAT_MAX: RENDER_TARGET::defaultFormat(type)
+		UINT create(RENDER_TARGET::TYPE type, UINT width, UINT height, float scale = 1.0f,
+			RENDER_TARGET::FORMAT format = RENDER_TARGET::FORMAT_MAX);
+		void setScale(UINT id, float scale); // HDR_SCREEN: size relative to the back buffer
+		void setFormat(UINT id, RENDER_TARGET::FORMAT format);
+		void getSize(UINT id, UINT *width, UINT *height);
+		void getTextureSize(UINT id, UINT *width, UINT *height); // >= getSize(), sample with getSize() / this
+		unsigned long long getBytes(UINT id);	// texture memory
+		UINT getGeneration(UINT id);	// changes when the contents are lost
+		unsigned long long getTotalBytes();
 		void setRenderTarget(UINT id);
 		void setDepth(UINT id);
-		ID3D11ShaderResourceView *getTexture(UINT id);
+		void setTexture(UINT slot, UINT id); // for the next Draw
 		void pushRenderTarget();
 		void popRenderTarget();
-		D3DXMATRIX screenProjMatrix();
+		void setPresentTarget(UINT id); // back buffer as colour, id written as UAV u1 (Device::setPresentTarget)
+		MATRIX screenProjMatrix();
+		void setViewProjection(const MATRIX &m); // once per frame, without jitter
+		const MATRIX &prevViewProjection() const;
 
 		void Clear( UINT color ); // AARRGGBB
 		void ClearDepth( float depth );
@@ -53,6 +118,7 @@ namespace tpot
 		void set(DS::ID id);
 		void set(GS::ID id);
 		void set(PS::ID id);
+		void set(CS::ID id);
 		void set(DEPTH_STATE::ID type);
 
 		void disableVS();
@@ -66,11 +132,15 @@ namespace tpot
 		void setCB_DS();
 		void setCB_GS();
 		void setCB_PS();
+		void setCB_CS();
 
 		void *Map();
 		void UmMap();
 
-		void Draw( Mesh *pMesh );
+		UINT createMesh(MESH_TYPE type, void *param);
+		bool isMeshReady(UINT mesh);
+		void Draw( UINT mesh );
+		void Dispatch( UINT id, UINT groups_x, UINT groups_y ); // id written as UAV u0 (Device::Dispatch)
 	};
 
 }// namespace tpot
@@ -0,0 +1,82 @@
+#include <string.h>
+#include "simd.h"
+#if TPOT_X86 && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace tpot
+{
+
+#if TPOT_X86
+static bool cpuHasSSE4()
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	return (info[2] & (1 << 19)) != 0; // SSE4.1
+#else
+	return __builtin_cpu_supports("sse4.1") != 0;
+#endif
+}
+
+static bool cpuHasAVX2()
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx) return false;
+	if ((_xgetbv(0) & 0x6) != 0x6) return false; // XMM/YMM state enabled by the OS
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#endif // TPOT_X86
+
+bool SIMD::supported(SIMD::ID id)
+{
+	switch (id){
+	case SIMD::SCALAR:
+		return true;
+#if TPOT_X86
+	case SIMD::SSE4:
+		return cpuHasSSE4();
+	case SIMD::AVX2:
+		return cpuHasAVX2();
+#endif
+	default:
+		return false;
+	}
+}
+
+SIMD::ID SIMD::best()
+{
+	static const SIMD::ID id = supported(SIMD::AVX2) ? SIMD::AVX2 : supported(SIMD::SSE4) ? SIMD::SSE4 : SIMD::SCALAR;
+	return id;
+}
+
+const char *SIMD::name(SIMD::ID id)
+{
+	static const char *names[SIMD::MAX] = {
+		"scalar",
+		"sse4",
+		"avx2",
+	};
+	return (id < SIMD::MAX) ? names[id] : "unknown";
+}
+
+bool SIMD::parse(const char *str, SIMD::ID *id)
+{
+	for (int i = 0; i < SIMD::MAX; i++){
+		if (strcmp(str, name((SIMD::ID)i)) == 0){
+			*id = (SIMD::ID)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+}// namespace tpot
@@ -0,0 +1,40 @@
+#ifndef TPOT_SIMD_H__
+#define TPOT_SIMD_H__
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define TPOT_X86 1
+#else
+#define TPOT_X86 0
+#endif
+
+#if TPOT_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define TPOT_TARGET_SSE4
+#define TPOT_TARGET_AVX2
+#else
+#define TPOT_TARGET_SSE4 __attribute__((target("sse4.1")))
+#define TPOT_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif // TPOT_X86
+
+namespace tpot
+{
+	struct SIMD{
+		enum ID
+		{
+			SCALAR,
+			SSE4,
+			AVX2,
+
+			MAX,
+		};
+
+		static bool supported(SIMD::ID id);
+		static SIMD::ID best();
+		static const char *name(SIMD::ID id);
+		static bool parse(const char *str, SIMD::ID *id);
+	};
+
+}// namespace tpot
+#endif // TPOT_SIMD_H__
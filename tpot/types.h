@@ -1,6 +1,13 @@
 #ifndef TPOT_TYPES_H__
 #define TPOT_TYPES_H__
 
+#include "Matrix.h"
+
+// No <windows.h> here, so Renderer and RecordingDevice build anywhere.
+// Same typedefs as <windows.h>, harmless when both are seen.
+typedef unsigned int   UINT;
+typedef unsigned short WORD;
+
 namespace tpot
 {
 	struct RASTERIZER_STATE{
@@ -35,28 +42,28 @@ namespace tpot
 
 	struct VTX_SCENE
 	{
-		D3DXVECTOR3 pos;
-		D3DXVECTOR3 normal;
-		D3DXVECTOR2 uv;
+		float pos[3];
+		float normal[3];
+		float uv[2];
 	};
 
 	struct VTX_DECAL
 	{
-		D3DXVECTOR3 pos;
-		D3DXVECTOR2 uv;
+		float pos[3];
+		float uv[2];
 	};
 
 	struct VTX_SHADOW
 	{
-		D3DXVECTOR3 pos;
-		D3DXVECTOR3 normal;
-		D3DXVECTOR2 uv;
+		float pos[3];
+		float normal[3];
+		float uv[2];
 	};
 
 	struct VTX_TAA
 	{
-		D3DXVECTOR3 pos;
-		D3DXVECTOR2 uv;
+		float pos[3];
+		float uv[2];
 	};
 
 	struct VS{// VERTEX_SHADER
@@ -79,6 +86,7 @@ namespace tpot
 			};
 			return stride[id];
 		};
+		static UINT getCBSize(VS::ID id); // each VS owns one constant buffer
 	};
 
 	struct HS{// HULL_SHADER
@@ -117,6 +125,38 @@ namespace tpot
 			SHADOW,
 			BEZIER,
 			TAA,
+			TAA_UPSAMPLE,
+			TAA_REPROJECT,
+			TAA_YCOCG,		// TAA_HISTORY::YCOCG*
+			DECAL_YCOCG,	// present of a YCoCg history
+			TAA_TILE_MASK,	// convergence per tile of the history
+			TAA_PRESENT,	// TAA resolve that also writes the back buffer
+			TAA_YCOCG_PRESENT,
+			TAA_CHECKER_MASK,	// depth 0 on the pixels the scene pass leaves out this frame
+			TAA_CHECKERBOARD,	// fills them from the history and the shaded neighbours
+
+			MAX,
+		};
+	};
+
+	struct CS{// COMPUTE_SHADER
+		enum ID
+		{
+			TAA_VARIANCE,	// TAA resolve with 3x3 variance clipping, TAA_VARIANCE_GROUP^2 threads
+
+			MAX,
+		};
+	};
+
+	struct STAGE{// pipeline stage for disable() and setCB()
+		enum ID
+		{
+			VS,
+			HS,
+			DS,
+			GS,
+			PS,
+			CS,
 
 			MAX,
 		};
@@ -130,36 +170,96 @@ namespace tpot
 
 			TYPE_MAX,
 		};
+
+		enum FORMAT
+		{
+			RGBA32F,	// HDR_SCREEN default, 16 bytes per pixel
+			RGBA16F,
+			R11G11B10F,	// no alpha
+			RGB10A2,
+			RGBA8,
+			RGBA8_SRGB,
+			D24S8,		// DEPTH default
+			D32F,
+
+			FORMAT_MAX,
+		};
+
+		// RenderTargetFormat.cpp
+		static FORMAT defaultFormat(TYPE type);
+		static bool isDepth(FORMAT format);
+		static bool unorderedAccess(FORMAT format); // typed UAV stores, no sRGB
+		static UINT bytesPerPixel(FORMAT format);
+		static unsigned long long bytes(FORMAT format, UINT width, UINT height);
+		static const char *name(FORMAT format);
+		static bool parse(const char *str, FORMAT *format);
 	};
 	
 	struct CB_BEZIER
 	{
-		D3DXMATRIX mViewProjection;
-		D3DXVECTOR3 vCameraPosWorld;
+		MATRIX mViewProjection;
+		float vCameraPosWorld[3];
 		float fTessellationFactor;
 	};
 
 	struct CB_SCENE
 	{
-		D3DXMATRIX mViewProjection;
+		MATRIX mViewProjection;
 	};
 
 	struct CB_SHADOW
 	{
-		D3DXMATRIX mViewProjection;
+		MATRIX mViewProjection;
 	};
 
 	struct CB_DECAL
 	{
-		D3DXMATRIX mViewProjection;
+		MATRIX mViewProjection;
+		float  uv_scale[2];	// used part of the pooled texture
+		float  dummy[2];
+		float  present[4];	// TAA_PRESENT_PARAM, CopyPresentParam()
 	};
 
 	struct CB_TAA
 	{
-		D3DXMATRIX mViewProjection;
+		MATRIX     mViewProjection;
 		float      inv_screen_size[2];
 		float      fRate;
 		float      fBlurSize;
+		float      render_size[2];	// PS_Upsample only
+		float      jitter[2];		// render pixels
+		MATRIX     mReprojection;	// PS_Reproject only
+		float      uv_scale[4];		// used part of the pooled textures: history xy, scene zw
+		float      tile[4];			// threshold, frames to converge, 1: ignore and reset the mask, unused
+		float      present[4];		// PS::TAA_*PRESENT, as CB_DECAL
+		float      depth_reject[4];	// PS_Reproject, PS_Checkerboard: projection _33, _43, threshold (0: off), unused
+		float      checkerboard[4];	// PS_Checker*: phase of this frame (0, 1), unused
+	};
+
+	inline UINT VS::getCBSize(VS::ID id){
+		static const UINT size[VS::MAX] = {
+			sizeof(CB_SCENE),
+			sizeof(CB_DECAL),
+			sizeof(CB_SHADOW),
+			sizeof(CB_BEZIER),
+			sizeof(CB_TAA),
+		};
+		return size[id];
+	}
+
+	enum MESH_TYPE{
+		MESH_TYPE_EMBEDDED,
+		MESH_TYPE_SDKMESH,		// param: media path, LPCWSTR
+		MESH_TYPE_TRIANGLELIST,	// param: VERTEX_LIST_MESH_PARAM
+		MESH_TYPE_TMESH,		// param: media path, LPCWSTR
+	};
+
+	struct VERTEX_LIST_MESH_PARAM{
+		VS::ID vs;
+		void   *verticies;
+		UINT   vertex_count;
+		WORD   *indicies;
+		UINT   index_count;
 	};
 
 }// namespace tpot